@@ -0,0 +1,321 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <deque>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../corvid/containers.h"
+#include "../corvid/enums.h"
+#include "../corvid/strings.h"
+
+using namespace std::literals;
+using namespace corvid;
+
+enum class bench_id : uint32_t { missing };
+
+template<>
+constexpr inline auto registry::enum_spec_v<bench_id> =
+    sequence::make_sequence_enum_spec<bench_id, "missing">();
+
+// Each benchmark of a Corvid container is followed by its `std` baseline. The
+// argument is the number of elements.
+
+namespace {
+
+// Distinct keys, long enough to defeat the small-string optimization.
+std::vector<std::string> make_keys(size_t count) {
+  std::vector<std::string> keys;
+  keys.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+    keys.push_back("key-for-interning-" + std::to_string(i));
+  return keys;
+}
+
+// Intern each key once, then look them all up again, which is the common
+// case.
+void InternTable_Intern(benchmark::State& state) {
+  const auto keys = make_keys(state.range(0));
+  auto table = intern_table<std::string, bench_id>::make();
+  for (const auto& key : keys) benchmark::DoNotOptimize(table->intern(key));
+  for (auto _ : state)
+    for (const auto& key : keys)
+      benchmark::DoNotOptimize(table->intern(key));
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(InternTable_Intern)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+void Std_UnorderedMap_Intern(benchmark::State& state) {
+  const auto keys = make_keys(state.range(0));
+  std::unordered_map<std::string, uint32_t> table;
+  auto intern = [&](const std::string& key) {
+    return table.try_emplace(key, table.size() + 1).first->second;
+  };
+  for (const auto& key : keys) benchmark::DoNotOptimize(intern(key));
+  for (auto _ : state)
+    for (const auto& key : keys) benchmark::DoNotOptimize(intern(key));
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(Std_UnorderedMap_Intern)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+// Look up keys, half of them missing, at the head of a chain of frozen
+// tables of 1024 values each, where the argument is the number of tables. The
+// bloom filters let misses skip the tables. Then the same, after compacting
+// the chain into one table.
+using bench_intern_table = intern_table<std::string, bench_id>;
+
+bench_intern_table::const_pointer
+make_intern_chain(const std::vector<std::string>& keys, size_t depth) {
+  bench_intern_table::const_pointer chain;
+  for (size_t level = 0; level < depth; ++level) {
+    auto table = chain ? chain->make_next(static_cast<bench_id>(
+                             *chain->max_id() + 1024))
+                       : bench_intern_table::make(bench_id{}, bench_id{1024});
+    for (size_t i = level * 1024; i < (level + 1) * 1024; ++i)
+      benchmark::DoNotOptimize(table->intern(keys[i]));
+    chain = table;
+  }
+  return chain->make_next();
+}
+
+void InternTable_ChainGet(benchmark::State& state) {
+  const auto depth = static_cast<size_t>(state.range(0));
+  const auto keys = make_keys(depth * 2048);
+  const auto head = make_intern_chain(keys, depth);
+  for (auto _ : state)
+    for (size_t i = 0; i < keys.size(); i += 7)
+      benchmark::DoNotOptimize(head->get(keys[i]));
+  state.SetItemsProcessed(state.iterations() * (keys.size() + 6) / 7);
+}
+BENCHMARK(InternTable_ChainGet)->RangeMultiplier(4)->Range(1, 64);
+
+void InternTable_CompactedGet(benchmark::State& state) {
+  const auto depth = static_cast<size_t>(state.range(0));
+  const auto keys = make_keys(depth * 2048);
+  const auto flat = make_intern_chain(keys, depth)->compact();
+  for (auto _ : state)
+    for (size_t i = 0; i < keys.size(); i += 7)
+      benchmark::DoNotOptimize(flat->get(keys[i]));
+  state.SetItemsProcessed(state.iterations() * (keys.size() + 6) / 7);
+}
+BENCHMARK(InternTable_CompactedGet)->RangeMultiplier(4)->Range(1, 64);
+
+// Intern distinct values from several threads at once, where the argument
+// is the number of threads, into one table and then into a sharded one.
+template<typename MAKE>
+void bench_concurrent_intern(benchmark::State& state, MAKE make) {
+  const auto thread_count = static_cast<size_t>(state.range(0));
+  constexpr size_t per_thread = 1 << 14;
+  std::vector<std::vector<std::string>> values(thread_count);
+  for (size_t t = 0; t < thread_count; ++t)
+    for (size_t i = 0; i < per_thread; ++i)
+      values[t].push_back(std::to_string(t * per_thread + i));
+  for (auto _ : state) {
+    auto table = make(thread_count * per_thread);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t)
+      threads.emplace_back([&, t] {
+        for (const auto& value : values[t])
+          benchmark::DoNotOptimize(table->intern(value));
+      });
+    for (auto& thread : threads) thread.join();
+  }
+  state.SetItemsProcessed(state.iterations() * thread_count * per_thread);
+}
+
+void InternTable_ConcurrentIntern(benchmark::State& state) {
+  bench_concurrent_intern(state,
+      [](size_t) { return bench_intern_table::make(); });
+}
+BENCHMARK(InternTable_ConcurrentIntern)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+
+void ShardedInternTable_ConcurrentIntern(benchmark::State& state) {
+  bench_concurrent_intern(state, [](size_t count) {
+    return sharded_intern_table<std::string, bench_id>::make(16, count);
+  });
+}
+BENCHMARK(ShardedInternTable_ConcurrentIntern)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+
+// Look up every key, by `std::string_view` or by `hashed_string_view`, whose
+// hashes were computed up front.
+template<typename K>
+void StringUnorderedMap_Find(benchmark::State& state) {
+  const auto keys = make_keys(state.range(0));
+  string_unordered_map<size_t> m;
+  for (const auto& key : keys) m.emplace(key, m.size());
+  const std::vector<K> lookups(keys.begin(), keys.end());
+  for (auto _ : state)
+    for (const auto& key : lookups) benchmark::DoNotOptimize(m.find(key));
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(StringUnorderedMap_Find<std::string_view>)
+    ->RangeMultiplier(8)
+    ->Range(8, 1 << 15);
+BENCHMARK(StringUnorderedMap_Find<strings::hashed_string_view>)
+    ->RangeMultiplier(8)
+    ->Range(8, 1 << 15);
+
+// Iterate over a full buffer whose contents wrap around the end.
+template<typename CB>
+void CircularBuffer_Iterate(benchmark::State& state) {
+  std::vector<int> storage(state.range(0));
+  CB cb{storage};
+  for (size_t i = 0; i < storage.size() + storage.size() / 2; ++i)
+    cb.push_back(static_cast<int>(i));
+  for (auto _ : state) {
+    int64_t sum{};
+    for (auto i : cb) sum += i;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * cb.size());
+}
+BENCHMARK(CircularBuffer_Iterate<circular_buffer<int>>)
+    ->RangeMultiplier(8)
+    ->Range(8, 1 << 15);
+BENCHMARK(CircularBuffer_Iterate<pow2_circular_buffer<int>>)
+    ->RangeMultiplier(8)
+    ->Range(8, 1 << 15);
+
+void Std_Deque_Iterate(benchmark::State& state) {
+  std::deque<int> d(state.range(0));
+  std::iota(d.begin(), d.end(), 0);
+  for (auto _ : state) {
+    int64_t sum{};
+    for (auto i : d) sum += i;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * d.size());
+}
+BENCHMARK(Std_Deque_Iterate)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+void RingDeque_Iterate(benchmark::State& state) {
+  ring_deque<int> d;
+  for (int i = 0; i < state.range(0); ++i) d.push_back(i);
+  for (auto _ : state) {
+    int64_t sum{};
+    for (auto i : d) sum += i;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * d.size());
+}
+BENCHMARK(RingDeque_Iterate)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+// Same, but over the two contiguous segments.
+void RingDeque_IterateSegments(benchmark::State& state) {
+  ring_deque<int> d;
+  for (int i = 0; i < state.range(0); ++i) d.push_back(i);
+  for (auto _ : state) {
+    int64_t sum{};
+    for (auto segment : d.segments())
+      for (auto i : segment) sum += i;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * d.size());
+}
+BENCHMARK(RingDeque_IterateSegments)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+// Queue-like use: a burst of pushes to the back, then draining the front.
+template<typename D>
+void Deque_Burst(benchmark::State& state) {
+  D d;
+  const auto n = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    for (int i = 0; i < n; ++i) d.push_back(i);
+    int64_t sum{};
+    while (!d.empty()) {
+      sum += d.front();
+      d.pop_front();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(Deque_Burst<std::deque<int>>)
+    ->RangeMultiplier(8)
+    ->Range(8, 1 << 15);
+BENCHMARK(Deque_Burst<ring_deque<int>>)
+    ->RangeMultiplier(8)
+    ->Range(8, 1 << 15);
+
+// Make and free a batch of request-sized objects.
+struct bench_request {
+  std::string method{"GET"};
+  std::string path;
+  int64_t id{};
+};
+
+void OwnPtr_MakeFree(benchmark::State& state) {
+  std::vector<own_ptr<bench_request>> v(state.range(0));
+  for (auto _ : state) {
+    for (auto& p : v) p = own_ptr<bench_request>::make();
+    for (auto& p : v) p.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+BENCHMARK(OwnPtr_MakeFree)->RangeMultiplier(8)->Range(8, 1 << 12);
+
+void ObjectPool_MakeFree(benchmark::State& state) {
+  using namespace corvid::container::pool;
+  object_pool<bench_request> pool;
+  std::vector<pooled_ptr<bench_request>> v(state.range(0));
+  for (auto _ : state) {
+    for (auto& p : v) p = pool.make();
+    for (auto& p : v) p.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+BENCHMARK(ObjectPool_MakeFree)->RangeMultiplier(8)->Range(8, 1 << 12);
+
+// Build a large output, one short line at a time.
+template<typename T>
+void bench_append_lines(T& target, int64_t lines) {
+  for (int64_t i = 0; i < lines; ++i)
+    strings::append(target, "line ", i, ": some report text\n");
+}
+
+void String_AppendLarge(benchmark::State& state) {
+  for (auto _ : state) {
+    std::string s;
+    bench_append_lines(s, state.range(0));
+    benchmark::DoNotOptimize(s.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(String_AppendLarge)->RangeMultiplier(16)->Range(1 << 10, 1 << 18);
+
+void Rope_AppendLarge(benchmark::State& state) {
+  for (auto _ : state) {
+    rope_ostream os;
+    bench_append_lines(os, state.range(0));
+    benchmark::DoNotOptimize(os.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Rope_AppendLarge)->RangeMultiplier(16)->Range(1 << 10, 1 << 18);
+
+} // namespace
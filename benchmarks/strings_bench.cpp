@@ -0,0 +1,208 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../corvid/strings.h"
+
+using namespace std::literals;
+using namespace corvid;
+
+// Each benchmark of a Corvid function is followed by its `std` baseline. The
+// argument is the size of the input.
+
+namespace {
+
+// Haystack of `size` letters with the needle at the very end.
+std::string make_haystack(size_t size, char needle) {
+  std::string s(size, 'a');
+  if (size) s.back() = needle;
+  return s;
+}
+
+// Comma-separated list of `fields` short numbers.
+std::string make_csv(size_t fields) {
+  std::string s;
+  for (size_t i = 0; i < fields; ++i) {
+    if (i) s += ',';
+    s += std::to_string(i);
+  }
+  return s;
+}
+
+// Like `make_csv`, but with spaces around each field.
+std::string make_padded_csv(size_t fields) {
+  std::string s;
+  for (size_t i = 0; i < fields; ++i) {
+    if (i) s += ',';
+    s += "  " + std::to_string(i) + " ";
+  }
+  return s;
+}
+
+void Locate_Char(benchmark::State& state) {
+  const auto s = make_haystack(state.range(0), 'z');
+  for (auto _ : state) benchmark::DoNotOptimize(strings::locate(s, 'z'));
+  state.SetBytesProcessed(state.iterations() * s.size());
+}
+BENCHMARK(Locate_Char)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+void Std_Find_Char(benchmark::State& state) {
+  const auto s = make_haystack(state.range(0), 'z');
+  for (auto _ : state) benchmark::DoNotOptimize(s.find('z'));
+  state.SetBytesProcessed(state.iterations() * s.size());
+}
+BENCHMARK(Std_Find_Char)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+void Locate_CharSet(benchmark::State& state) {
+  const auto s = make_haystack(state.range(0), '\n');
+  for (auto _ : state)
+    benchmark::DoNotOptimize(strings::locate(s, {' ', '\t', '\n', '\r'}));
+  state.SetBytesProcessed(state.iterations() * s.size());
+}
+BENCHMARK(Locate_CharSet)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+void Std_FindFirstOf(benchmark::State& state) {
+  const auto s = make_haystack(state.range(0), '\n');
+  for (auto _ : state) benchmark::DoNotOptimize(s.find_first_of(" \t\n\r"));
+  state.SetBytesProcessed(state.iterations() * s.size());
+}
+BENCHMARK(Std_FindFirstOf)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+void Split(benchmark::State& state) {
+  const auto s = make_csv(state.range(0));
+  for (auto _ : state) benchmark::DoNotOptimize(strings::split(s, ","));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Split)->RangeMultiplier(8)->Range(8, 1 << 12);
+
+void Std_Split(benchmark::State& state) {
+  const auto s = make_csv(state.range(0));
+  for (auto _ : state) {
+    std::vector<std::string_view> parts;
+    std::string_view whole{s};
+    for (;;) {
+      const auto comma = whole.find(',');
+      parts.emplace_back(whole.substr(0, comma));
+      if (comma == std::string_view::npos) break;
+      whole.remove_prefix(comma + 1);
+    }
+    benchmark::DoNotOptimize(parts);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Std_Split)->RangeMultiplier(8)->Range(8, 1 << 12);
+
+void CountLocated(benchmark::State& state) {
+  const auto s = make_padded_csv(state.range(0));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(strings::count_located(s, ','));
+  state.SetBytesProcessed(state.iterations() * s.size());
+}
+BENCHMARK(CountLocated)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+
+void Par_CountLocated(benchmark::State& state) {
+  const auto s = make_padded_csv(state.range(0));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(strings::par_count_located(s, ','));
+  state.SetBytesProcessed(state.iterations() * s.size());
+}
+BENCHMARK(Par_CountLocated)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 20)
+    ->UseRealTime();
+
+void SplitAndTrim(benchmark::State& state) {
+  const auto s = make_padded_csv(state.range(0));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(strings::split_and_trim(s, ","));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(SplitAndTrim)->RangeMultiplier(8)->Range(8, 1 << 12);
+
+void Split_Then_Trim(benchmark::State& state) {
+  const auto s = make_padded_csv(state.range(0));
+  for (auto _ : state) {
+    auto parts = strings::split(s, ",");
+    strings::trim(parts);
+    benchmark::DoNotOptimize(parts);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Split_Then_Trim)->RangeMultiplier(8)->Range(8, 1 << 12);
+
+void AppendJoin(benchmark::State& state) {
+  std::vector<int> v(state.range(0));
+  std::iota(v.begin(), v.end(), 0);
+  std::string s;
+  for (auto _ : state) {
+    s.clear();
+    strings::append_join(s, v);
+    benchmark::DoNotOptimize(s);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+BENCHMARK(AppendJoin)->RangeMultiplier(8)->Range(8, 1 << 12);
+
+void Std_AppendJoin(benchmark::State& state) {
+  std::vector<int> v(state.range(0));
+  std::iota(v.begin(), v.end(), 0);
+  std::string s;
+  for (auto _ : state) {
+    s.clear();
+    for (bool first = true; auto i : v) {
+      if (!first) s += ", ";
+      first = false;
+      s += std::to_string(i);
+    }
+    benchmark::DoNotOptimize(s);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+BENCHMARK(Std_AppendJoin)->RangeMultiplier(8)->Range(8, 1 << 12);
+
+void Format(benchmark::State& state) {
+  const auto name = "someone"sv;
+  unsigned id = 0;
+  for (auto _ : state) {
+    ++id;
+    benchmark::DoNotOptimize(
+        strings::format<"user={} id={:08x} n={}">(name, id, id * 7));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Format);
+
+void Concat_Format(benchmark::State& state) {
+  const auto name = "someone"sv;
+  unsigned id = 0;
+  for (auto _ : state) {
+    std::string s = strings::concat("user="sv, name, " id="sv);
+    strings::append_num<16, 8, '0'>(s, ++id);
+    strings::append(s, " n="sv, id * 7);
+    benchmark::DoNotOptimize(s);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Concat_Format);
+
+} // namespace
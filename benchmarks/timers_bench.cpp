@@ -0,0 +1,89 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../corvid/containers/timers.h"
+
+using namespace std::chrono_literals;
+using namespace corvid;
+using corvid::timers_ns::duration_t;
+using corvid::timers_ns::time_point_t;
+
+// The argument is the number of timers that are pending. Each iteration
+// advances a fake clock by 1ms and ticks, firing the timers that came due,
+// each of which rearms itself by recurring.
+
+namespace {
+
+// Spread the timers over the first second, so that about 1 in 1000 fires per
+// tick.
+duration_t spread(size_t i, size_t count) {
+  return duration_t{1 + static_cast<duration_t::rep>(i * 1000 / count)};
+}
+
+template<typename T>
+void Timers_Tick(benchmark::State& state) {
+  const size_t count = state.range(0);
+  T t;
+  time_point_t now{};
+  t.set_clock_callback([&now] { return now; });
+  size_t fired{};
+  for (size_t i = 0; i < count; ++i)
+    t.set(spread(i, count), [&fired](timer_event&) { ++fired; }, 1000ms);
+  for (auto _ : state) {
+    now += 1ms;
+    benchmark::DoNotOptimize(t.tick());
+  }
+  state.SetItemsProcessed(fired);
+}
+BENCHMARK(Timers_Tick<timers>)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK(Timers_Tick<wheel_timers>)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+// The baseline is the usual hand-rolled heap of deadlines and callbacks.
+void Std_PriorityQueue_Tick(benchmark::State& state) {
+  struct entry {
+    time_point_t at;
+    std::function<void()> callback;
+    bool operator<(const entry& rhs) const { return rhs.at < at; }
+  };
+  const size_t count = state.range(0);
+  std::priority_queue<entry> q;
+  time_point_t now{};
+  size_t fired{};
+  for (size_t i = 0; i < count; ++i)
+    q.push({now + spread(i, count), [&fired] { ++fired; }});
+  for (auto _ : state) {
+    now += 1ms;
+    while (!q.empty() && q.top().at <= now) {
+      auto e = std::move(const_cast<entry&>(q.top()));
+      q.pop();
+      e.callback();
+      e.at += 1000ms;
+      q.push(std::move(e));
+    }
+  }
+  state.SetItemsProcessed(fired);
+}
+BENCHMARK(Std_PriorityQueue_Tick)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+} // namespace
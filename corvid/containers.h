@@ -22,9 +22,24 @@
 #include "containers/own_ptr.h"
 #include "containers/ranges.h"
 #include "containers/transparent.h"
+#include "containers/flat_string_map.h"
 #include "containers/interval.h"
+#include "containers/interval_set.h"
+#include "containers/enum_map.h"
 #include "containers/indirect_key.h"
 #include "containers/sync_lock.h"
+#include "containers/instrumented_sync.h"
+#include "containers/instrumentation.h"
+#include "containers/segmented_vector.h"
+#include "containers/flat_index.h"
 #include "containers/intern.h"
+#include "containers/intern_image.h"
+#include "containers/string_pool.h"
+#include "containers/rope.h"
 #include "containers/circular_buffer.h"
+#include "containers/concurrent_ring.h"
+#include "containers/small_function.h"
+#include "containers/free_list.h"
+#include "containers/object_pool.h"
 #include "containers/timers.h"
+#include "containers/sharded_timers.h"
@@ -16,9 +16,111 @@
 // limitations under the License.
 #pragma once
 #include "containers_shared.h"
+#include "instrumentation.h"
+#include "../strings.h"
+
+#include <array>
+#include <memory>
+#include <mutex>
+
+// Whether `extensible_arena` keeps the counters reported by `stats`. Off by
+// default, since they cost a little on every allocation.
+#ifndef CORVID_ARENA_STATS
+#define CORVID_ARENA_STATS 0
+#endif
 
 namespace corvid { inline namespace container { namespace arena {
 
+// How the capacity of each new block of an `extensible_arena` relates to the
+// capacity of the last.
+enum class arena_growth : std::uint8_t {
+  // Every block has the initial capacity.
+  constant,
+  // Each block has double the capacity of the last, up to `max_block_size`.
+  doubling,
+};
+
+// What an `extensible_arena` does when an allocation would take it past its
+// `max_total`.
+enum class arena_exhausted : std::uint8_t {
+  // Throw `std::bad_alloc`.
+  throw_bad_alloc,
+  // Return `nullptr` from `extensible_arena::allocate`. Note that
+  // `arena_allocator` still throws, since standard containers require it.
+  return_null,
+};
+
+// Configuration for an `extensible_arena`.
+struct arena_options {
+  // Capacity of the first block, and of the rest unless `growth` says
+  // otherwise.
+  size_t block_size{4096};
+
+  // How the capacity of each new block is chosen.
+  arena_growth growth{arena_growth::constant};
+
+  // Largest capacity that `growth` may reach, or 0 for no limit.
+  size_t max_block_size{};
+
+  // Largest total capacity of all blocks, or 0 for no limit.
+  size_t max_total{};
+
+  // What to do when `max_total` would be exceeded.
+  arena_exhausted on_exhausted{arena_exhausted::throw_bad_alloc};
+
+  // How many blocks past the head to try before adding a new one. Limited to
+  // `extensible_arena::max_overflow_blocks`.
+  size_t overflow_blocks{2};
+};
+
+// Allocation statistics for an `extensible_arena`, as returned by `stats`.
+// Unless `CORVID_ARENA_STATS` is enabled, all fields are zero, except for
+// `bytes_reserved`, which is always tracked.
+struct arena_stats {
+  // Bytes passed to `allocate`, for allocations that succeeded.
+  size_t bytes_requested{};
+
+  // Total capacity of all blocks, including spares.
+  size_t bytes_reserved{};
+
+  // Number of blocks, including spares.
+  size_t block_count{};
+
+  // Number of allocations that were too large for a regular block.
+  size_t oversize_allocations{};
+
+  // Bytes skipped to align allocations.
+  size_t alignment_padding{};
+
+  // Bytes left unused at the end of blocks other than the head. Computed when
+  // the stats are requested.
+  size_t unused_tail_bytes{};
+
+  // Most bytes in use at any one time, including padding.
+  size_t high_water{};
+
+  template<AppendTarget A>
+  static auto& append_fn(A& target, const arena_stats& s) {
+    return append_join_with_fn<strings::join_opt::json>(target,
+        strings::delim{", "}, s);
+  }
+
+  template<auto opt = strings::join_opt::braced, char open = 0, char close = 0,
+      AppendTarget A>
+  static A&
+  append_join_with_fn(A& target, strings::delim d, const arena_stats& s) {
+    using namespace std::string_view_literals;
+    return corvid::strings::append_join_with<opt, open, close>(target, d,
+        std::pair{"bytes_requested"sv, s.bytes_requested},
+        std::pair{"bytes_reserved"sv, s.bytes_reserved},
+        std::pair{"block_count"sv, s.block_count},
+        std::pair{"oversize_allocations"sv, s.oversize_allocations},
+        std::pair{"alignment_padding"sv, s.alignment_padding},
+        std::pair{"unused_tail_bytes"sv, s.unused_tail_bytes},
+        std::pair{"high_water"sv, s.high_water});
+  }
+};
+
 // Arena implemented as a singly-linked list of blocks.
 //
 // To use:
@@ -34,9 +136,21 @@ namespace corvid { inline namespace container { namespace arena {
 // containers (such as `arena_string`) as their standard counterparts (such as
 // `std::string`).
 //
-// Allocates new blocks as needed, chaining them together. Block size is
-// constant, except when it must be enlarged to satisfy an allocation. Only
-// frees when the entire arena is destroyed.
+// Allocates new blocks as needed, chaining them together, with capacities
+// chosen by `arena_options::growth`. An allocation that's too large to fit
+// in a block of that capacity gets a block of its own, sized to fit, which
+// doesn't affect the capacity of later blocks.
+//
+// When an allocation doesn't fit in the head block, it overflows to the next
+// few blocks in the chain. If none of them have room, a new block is added.
+// The new block only replaces the head if the head is sufficiently filled,
+// meaning that less than 1/4 of its capacity is free. Otherwise, it's added
+// behind the head, so that the head's remaining space isn't stranded.
+//
+// Only frees when the entire arena is destroyed, although `reset` discards all
+// allocations at once while keeping the blocks for reuse. Similarly, `rewind`
+// discards all allocations made since a `mark`, so that the arena can be used
+// as a stack for nested scratch work.
 //
 // If you make a container that uses an `arena_allocator`, it will still try to
 // destruct and free all of its elements. The free is a no-op, but pointless.
@@ -46,14 +160,6 @@ namespace corvid { inline namespace container { namespace arena {
 //
 // The expectation is that the arena is much larger than any single value, so
 // the waste from the last unfilled bit is minimal.
-//
-// TODO: Consider adding the ability to limit per-block sizes or total size.
-// Consider making the next block size constant, even when we had to blow past
-// the limit to accomodate an oversize allocation. Sufficiently filled should
-// be defined as having less than 1/4 of the capacity free, although it could
-// also be configured. Consider changing algorithm so that we keep the current
-// block as the head until it's sufficiently filled, overflowing as needed down
-// the chain.
 class extensible_arena {
   struct list_node;
   struct list_node_deleter {
@@ -65,18 +171,19 @@ class extensible_arena {
   };
   using pointer = std::unique_ptr<list_node, list_node_deleter>;
 
-  // Points to the head owned by the active container. Use
-  // `extensible_arena::scope` to install whenever an allocation is needed.
-  thread_local static inline pointer* tls_head_;
+  // Points to the active arena. Use `extensible_arena::scope` to install
+  // whenever an allocation is needed.
+  thread_local static inline extensible_arena* tls_arena_;
 
-  static auto& get_head() {
-    assert(tls_head_);
-    return *tls_head_;
+  static auto& get_arena() {
+    assert(tls_arena_);
+    return *tls_arena_;
   }
 
   struct list_node {
     size_t capacity_{};
     size_t size_{};
+    size_t serial_{};
     pointer next_;
     std::byte data_[1];
 
@@ -100,56 +207,420 @@ class extensible_arena {
     // Allocate a block of size `n` with `align` alignment from the current
     // node. If no room, returns `nullptr`.
     void* allocate(size_t n, size_t align) noexcept {
-      // Ensure alignment by rounding up to the nearest multiple of 'align'.
-      auto start_index = (size_ + align - 1) & ~(align - 1);
-      auto past_index = start_index + n;
-      if (past_index > capacity_) return nullptr;
-      size_ = past_index;
+      // Ensure alignment by rounding the address up to the nearest multiple
+      // of 'align'.
+      const auto base = reinterpret_cast<uintptr_t>(data_);
+      auto start_index = ((base + size_ + align - 1) & ~(align - 1)) - base;
+      if (start_index > capacity_ || n > capacity_ - start_index)
+        return nullptr;
+      size_ = start_index + n;
       return data_ + start_index;
     }
+
+    // Whether less than 1/4 of the capacity is free.
+    [[nodiscard]] bool is_filled() const noexcept {
+      return capacity_ - size_ < capacity_ / 4;
+    }
   };
 
-  // Allocate a block of size `n` with `align` alignment. If no room at `head`,
-  // replaces with new block, chaining the rest.
-  static void* allocate(pointer& head, size_t n, size_t align) {
-    if (auto start = head->allocate(n, align)) return start;
-    auto new_head = list_node::make(std::max(head->capacity_, n));
-    new_head->next_ = std::move(head);
-    head = std::move(new_head);
-    return head->allocate(n, align);
+  // Allocate from `node`, counting the allocation if it succeeds.
+  void* allocate_from(list_node& node, size_t n, size_t align) noexcept {
+#if CORVID_ARENA_STATS
+    const auto old_size = node.size_;
+    auto start = node.allocate(n, align);
+    if (!start) return nullptr;
+    counters_.bytes_requested += n;
+    counters_.alignment_padding += node.size_ - old_size - n;
+    in_use_ += node.size_ - old_size;
+    counters_.high_water = std::max(counters_.high_water, in_use_);
+    return start;
+#else
+    return node.allocate(n, align);
+#endif
+  }
+
+  // Allocate a block of size `n` with `align` alignment, trying the head and
+  // then overflowing down the chain. If no room, adds a new block.
+  void* do_allocate(size_t n, size_t align) {
+    if (auto start = allocate_from(*head_, n, align)) return start;
+
+    // Oversize allocations get their own block.
+    const auto needed = n + align - 1;
+    if (needed > next_block_size_) {
+      auto node = add_block(needed);
+      if (!node) return nullptr;
+      node->serial_ = ++serial_;
+      node->next_ = std::move(oversize_);
+      oversize_ = std::move(node);
+#if CORVID_ARENA_STATS
+      ++counters_.oversize_allocations;
+#endif
+      return allocate_from(*oversize_, n, align);
+    }
+
+    auto probe = head_->next_.get();
+    for (size_t i = 0; probe && i < options_.overflow_blocks; ++i) {
+      if (auto start = allocate_from(*probe, n, align)) return start;
+      probe = probe->next_.get();
+    }
+
+    auto node = take_spare(needed);
+    if (!node) {
+      node = add_block(next_block_size_);
+      if (!node) return nullptr;
+      grow();
+    }
+    node->serial_ = ++serial_;
+    auto start = allocate_from(*node, n, align);
+    if (head_->is_filled()) {
+      node->next_ = std::move(head_);
+      head_ = std::move(node);
+    } else {
+      node->next_ = std::move(head_->next_);
+      head_->next_ = std::move(node);
+    }
+    return start;
+  }
+
+  // Make a new block of `capacity`, unless that would exceed the total
+  // capacity, in which case, fails as per `on_exhausted`.
+  pointer add_block(size_t capacity) {
+    const auto max_total = options_.max_total;
+    if (max_total &&
+        (capacity > max_total || total_capacity_ > max_total - capacity))
+    {
+      if (options_.on_exhausted == arena_exhausted::throw_bad_alloc)
+        throw std::bad_alloc{};
+      return {};
+    }
+    total_capacity_ += capacity;
+#if CORVID_ARENA_STATS
+    ++counters_.block_count;
+#endif
+#if CORVID_INSTRUMENTATION
+    library_probes().arena_blocks.add();
+#endif
+    return list_node::make(capacity);
+  }
+
+  // Take the first spare block with at least `capacity`, if any.
+  pointer take_spare(size_t capacity) {
+    for (auto link = &spares_; *link; link = &(*link)->next_) {
+      if ((*link)->capacity_ < capacity) continue;
+      auto node = std::move(*link);
+      *link = std::move(node->next_);
+      return node;
+    }
+    return {};
+  }
+
+  // Choose the capacity of the next block.
+  void grow() noexcept {
+    if (options_.growth != arena_growth::doubling) return;
+    auto next = next_block_size_ * 2;
+    if (const auto max_block = options_.max_block_size)
+      next = std::min(next, max_block);
+    next_block_size_ = std::max(next_block_size_, next);
+  }
+
+  // Move the block at `link` to the spares, emptying it.
+  void spare(pointer& link) noexcept {
+    auto node = std::move(link);
+    link = std::move(node->next_);
+#if CORVID_ARENA_STATS
+    in_use_ -= node->size_;
+#endif
+    node->size_ = 0;
+    node->next_ = std::move(spares_);
+    spares_ = std::move(node);
+  }
+
+  // Free oversize blocks made after `serial`.
+  void free_oversize(size_t serial) noexcept {
+    while (oversize_ && oversize_->serial_ > serial) {
+      total_capacity_ -= oversize_->capacity_;
+#if CORVID_ARENA_STATS
+      in_use_ -= oversize_->size_;
+      --counters_.block_count;
+#endif
+      oversize_ = std::move(oversize_->next_);
+    }
   }
 
+public:
+  // Largest supported value of `arena_options::overflow_blocks`.
+  static constexpr size_t max_overflow_blocks = 3;
+
+  // Position returned by `mark`, for `rewind`.
+  class mark_t {
+    friend class extensible_arena;
+
+    // The blocks that the arena could still allocate from, and their sizes.
+    std::array<list_node*, max_overflow_blocks + 1> nodes_{};
+    std::array<size_t, max_overflow_blocks + 1> sizes_{};
+    size_t serial_{};
+    size_t resets_{};
+#if CORVID_ARENA_STATS
+    size_t in_use_{};
+#endif
+  };
+
+private:
+  arena_options options_;
+  size_t next_block_size_{};
+  size_t total_capacity_{};
+  // Serial number of the last block put in use, so `rewind` can tell which
+  // blocks came after a mark.
+  size_t serial_{};
+  // Number of times `reset` was called, to detect stale marks.
+  size_t resets_{};
+#if CORVID_ARENA_STATS
+  arena_stats counters_{.block_count = 1};
+  // Bytes currently in use, including padding.
+  size_t in_use_{};
+#endif
   pointer head_;
+  pointer spares_;
+  pointer oversize_;
 
 public:
-  explicit extensible_arena(size_t capacity) noexcept
-      : head_{list_node::make(capacity)} {}
+  explicit extensible_arena(size_t capacity)
+      : extensible_arena{arena_options{.block_size = capacity}} {}
+
+  explicit extensible_arena(const arena_options& options)
+      : options_{options}, next_block_size_{options.block_size},
+        total_capacity_{options.block_size},
+        head_{list_node::make(options.block_size)} {
+    options_.overflow_blocks =
+        std::min(options_.overflow_blocks, max_overflow_blocks);
+    grow();
+#if CORVID_INSTRUMENTATION
+    library_probes().arena_blocks.add();
+#endif
+  }
 
   static void* allocate(size_t n, size_t align) {
-    return allocate(get_head(), n, align);
+    return get_arena().do_allocate(n, align);
   }
 
-  static bool contains(const void* pv) {
-    for (auto next = get_head().get(); next; next = next->next_.get())
-      if (next->data_ <= pv && pv < next->data_ + next->size_) return true;
+  // Whether `pv` points into an allocation from the scoped arena.
+  static bool contains(const void* pv) { return get_arena().owns(pv); }
+
+  // Whether `pv` points into an allocation from this arena.
+  [[nodiscard]] bool owns(const void* pv) const noexcept {
+    for (auto chain : {head_.get(), oversize_.get()})
+      for (auto next = chain; next; next = next->next_.get())
+        if (next->data_ <= pv && pv < next->data_ + next->size_) return true;
 
     return false;
   }
 
-  // Sets thread-local scope for arena.
+  // Discard all allocations, keeping the blocks for reuse, except for those
+  // that were made for oversize allocations, which are freed.
+  //
+  // Any objects still using the arena are left dangling, so this is only
+  // safe once they've been destroyed or abandoned.
+  void reset() noexcept {
+    free_oversize(0);
+    head_->size_ = 0;
+    while (head_->next_) spare(head_->next_);
+#if CORVID_ARENA_STATS
+    in_use_ = 0;
+#endif
+    ++resets_;
+  }
+
+  // Returns the current position, so that `rewind` can later discard
+  // everything allocated after it.
+  [[nodiscard]] mark_t mark() const noexcept {
+    mark_t m;
+    auto node = head_.get();
+    for (size_t i = 0; node && i < m.nodes_.size(); ++i) {
+      m.nodes_[i] = node;
+      m.sizes_[i] = node->size_;
+      node = node->next_.get();
+    }
+    m.serial_ = serial_;
+    m.resets_ = resets_;
+#if CORVID_ARENA_STATS
+    m.in_use_ = in_use_;
+#endif
+    return m;
+  }
+
+  // Discard all allocations made since `m` was returned by `mark`. Blocks
+  // added since then become spares, except for oversize ones, which are
+  // freed.
+  //
+  // Marks must be rewound in LIFO order: rewinding to a mark invalidates any
+  // marks taken after it, and `reset` invalidates all marks. As with `reset`,
+  // any objects still using the discarded allocations are left dangling.
+  void rewind(const mark_t& m) noexcept {
+    assert(m.resets_ == resets_ && m.serial_ <= serial_);
+    free_oversize(m.serial_);
+
+    // Blocks are only ever added at or just behind the head, so removing the
+    // new ones restores the chain to what it was. And, since allocations
+    // only probe a few blocks from the head, the only old blocks that could
+    // have been allocated from are the ones the mark recorded.
+    for (pointer* link = &head_; *link;) {
+      if ((*link)->serial_ > m.serial_)
+        spare(*link);
+      else
+        link = &(*link)->next_;
+    }
+    for (size_t i = 0; i < m.nodes_.size() && m.nodes_[i]; ++i)
+      m.nodes_[i]->size_ = m.sizes_[i];
+#if CORVID_ARENA_STATS
+    in_use_ = m.in_use_;
+#endif
+  }
+
+  // Rewinds to the position at construction on destruction.
+  class checkpoint {
+  public:
+    explicit checkpoint(extensible_arena& arena) noexcept
+        : arena_{arena}, mark_{arena.mark()} {}
+
+    ~checkpoint() noexcept { arena_.rewind(mark_); }
+
+    checkpoint(const checkpoint&) = delete;
+    checkpoint& operator=(const checkpoint&) = delete;
+
+  private:
+    extensible_arena& arena_;
+    const mark_t mark_;
+  };
+
+  // Total capacity of all blocks, including spares.
+  [[nodiscard]] size_t total_capacity() const noexcept {
+    return total_capacity_;
+  }
+
+  // Returns allocation statistics. See `arena_stats` for details.
+  [[nodiscard]] arena_stats stats() const noexcept {
+    arena_stats result;
+#if CORVID_ARENA_STATS
+    result = counters_;
+    for (auto node = head_->next_.get(); node; node = node->next_.get())
+      result.unused_tail_bytes += node->capacity_ - node->size_;
+#endif
+    result.bytes_reserved = total_capacity_;
+    return result;
+  }
+
+  // Sets thread-local scope for arena, restoring the previous one on
+  // destruction, so scopes can be nested. Since the scope is per-thread, each
+  // thread may use its own arena concurrently, but an arena must only be in
+  // scope on one thread at a time.
   class scope {
   public:
-    explicit scope(extensible_arena& arena) noexcept : old_head{&arena.head_} {
-      tls_head_ = &arena.head_;
+    explicit scope(extensible_arena& arena) noexcept : old_arena_{tls_arena_} {
+      tls_arena_ = &arena;
     }
 
-    ~scope() noexcept { tls_head_ = old_head; }
+    ~scope() noexcept { tls_arena_ = old_arena_; }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
 
   private:
-    pointer* old_head;
+    extensible_arena* old_arena_;
   };
 };
 
+// Pool of arenas, one per thread.
+//
+// Each thread that calls `local` gets an arena of its own, created with the
+// pool's options, so that worker threads can build arena-allocated state
+// without locking or sharing blocks. Only the first call on each thread
+// locks. When the thread exits, its arena is reset and returned to the pool,
+// for reuse by the next thread. The arenas are freed when the pool is
+// destroyed, which must not happen while any thread is still using one.
+class thread_arena_pool {
+  struct state {
+    std::mutex mutex;
+    arena_options options;
+    std::vector<std::unique_ptr<extensible_arena>> idle;
+    size_t created{};
+  };
+
+  // This thread's arena for one pool. The raw pointer is for fast lookup,
+  // while the weak one detects a pool that was destroyed, even if another
+  // pool took its address.
+  struct local_arena {
+    state* raw;
+    std::weak_ptr<state> owner;
+    std::unique_ptr<extensible_arena> arena;
+  };
+
+  // On thread exit, returns each arena to its pool, if it still exists.
+  struct local_arenas: public std::vector<local_arena> {
+    ~local_arenas() {
+      for (auto& entry : *this) {
+        auto owner = entry.owner.lock();
+        if (!owner) continue;
+        entry.arena->reset();
+        std::scoped_lock lock{owner->mutex};
+        owner->idle.push_back(std::move(entry.arena));
+      }
+    }
+  };
+
+  thread_local static inline local_arenas tls_arenas_;
+
+public:
+  explicit thread_arena_pool(size_t capacity = 4096)
+      : thread_arena_pool{arena_options{.block_size = capacity}} {}
+
+  explicit thread_arena_pool(const arena_options& options)
+      : state_{std::make_shared<state>()} {
+    state_->options = options;
+  }
+
+  // Returns this thread's arena, creating it on first use.
+  [[nodiscard]] extensible_arena& local() {
+    for (auto& entry : tls_arenas_)
+      if (entry.raw == state_.get() && !entry.owner.expired())
+        return *entry.arena;
+    return add_local();
+  }
+
+  // Number of arenas created by the pool, across all threads.
+  [[nodiscard]] size_t size() const {
+    std::scoped_lock lock{state_->mutex};
+    return state_->created;
+  }
+
+  // Sets thread-local scope for this thread's arena.
+  class scope: public extensible_arena::scope {
+  public:
+    explicit scope(thread_arena_pool& pool)
+        : extensible_arena::scope{pool.local()} {}
+  };
+
+private:
+  std::shared_ptr<state> state_;
+
+  extensible_arena& add_local() {
+    // Forget about arenas from pools that were destroyed.
+    std::erase_if(tls_arenas_,
+        [](const local_arena& entry) { return entry.owner.expired(); });
+
+    std::unique_ptr<extensible_arena> arena;
+    if (std::scoped_lock lock{state_->mutex}; !state_->idle.empty()) {
+      arena = std::move(state_->idle.back());
+      state_->idle.pop_back();
+    } else {
+      arena = std::make_unique<extensible_arena>(state_->options);
+      ++state_->created;
+    }
+    return *tls_arenas_
+                .emplace_back(state_.get(), state_, std::move(arena))
+                .arena;
+  }
+};
+
 // Allocator that uses the `extensible_arena` that is currently in scope.
 template<typename T>
 class arena_allocator {
@@ -171,8 +642,9 @@ public:
   // Allocates a block of memory suitable for an array of `n` objects of type
   // `T`, using the scoped `extensible_arena`.
   [[nodiscard]] constexpr T* allocate(std::size_t n) {
-    return static_cast<T*>(
-        extensible_arena::allocate(n * sizeof(T), alignof(T)));
+    auto p = extensible_arena::allocate(n * sizeof(T), alignof(T));
+    if (!p) throw std::bad_alloc{};
+    return static_cast<T*>(p);
   }
 
   constexpr void deallocate(T*, std::size_t) {}
@@ -234,3 +706,16 @@ decltype(auto) arena_scope(extensible_arena& arena, F&& f) {
 }
 
 }}} // namespace corvid::container::arena
+
+namespace corvid::strings {
+// Register appends.
+template<corvid::AppendTarget A>
+constexpr auto append_override_fn<A, container::arena::arena_stats> =
+    container::arena::arena_stats::template append_fn<A>;
+
+template<join_opt opt, char open, char close, corvid::AppendTarget A>
+constexpr auto append_join_override_fn<opt, open, close, A,
+    container::arena::arena_stats> =
+    container::arena::arena_stats::template append_join_with_fn<opt, open,
+        close, A>;
+} // namespace corvid::strings
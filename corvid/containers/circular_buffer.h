@@ -15,18 +15,45 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #pragma once
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <memory>
 #include <span>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace corvid { inline namespace adapters {
 
+namespace details {
+// Trim a pair of segments to the last `n` elements.
+template<typename S>
+std::array<S, 2> window(const std::array<S, 2>& segments, size_t n) noexcept {
+  auto [first, second] = segments;
+  if (n >= first.size() + second.size()) return segments;
+  if (n <= second.size()) return {second.last(n), S{}};
+  return {first.last(n - second.size()), second};
+}
+} // namespace details
+
 // Circular buffer adapter over any container that supports `std::span`. Allows
 // access to the full range, with pushing to back and front, popping from back
 // and front, and random access. Does not own the underlying container.
 //
 // As an optimization, you may specialize on a SZ smaller than size_t, such as
 // uint32_t, if you know that your buffer will never be larger than that.
+//
+// When full, `push_back` and `push_front` evict the element at the other end
+// by assigning over it, so keeping the last N samples needs no separate pop,
+// and there's no destroy/construct pair. The `try_` versions fail instead.
+// To run a kernel over the newest values without copying, use
+// `back_segments`, or `linearize` to get them as a single span. To fill it in
+// place, such as by `readv`, use `spare_segments` and `commit_back_n`.
 template<typename T, typename SZ = size_t>
 class circular_buffer {
 public:
@@ -170,6 +197,113 @@ public:
     return result;
   }
 
+  // Push the values to the back of the buffer, overwriting as many of the
+  // frontmost values as needed to make room. If there are more values than
+  // capacity, only the last ones are kept. Returns the number pushed.
+  size_type push_back_range(std::span<const value_type> values) noexcept(
+      std::is_nothrow_copy_assignable_v<value_type>) {
+    if (values.size() >= capacity()) {
+      values = values.last(capacity());
+      clear();
+    } else if (const auto room = capacity() - size(); values.size() > room) {
+      const auto excess = static_cast<size_type>(values.size() - room);
+      front_ = wrap(front_ + excess);
+      size_ -= excess;
+    }
+    append_back(values);
+    return static_cast<size_type>(values.size());
+  }
+
+  // Try to push the values to the back of the buffer, without overwriting
+  // any. Pushes as many as fit, returning the number pushed.
+  size_type try_push_back_range(std::span<const value_type> values) noexcept(
+      std::is_nothrow_copy_assignable_v<value_type>) {
+    const size_t room = capacity() - size();
+    if (values.size() > room) values = values.first(room);
+    append_back(values);
+    return static_cast<size_type>(values.size());
+  }
+
+  // Pop as many values from the front as fit in `out`, moving them there.
+  // Returns the number popped.
+  size_type pop_front_into(std::span<value_type> out) noexcept(
+      std::is_nothrow_move_assignable_v<value_type>) {
+    const auto [first, second] = segments();
+    const auto n = std::min<size_t>(out.size(), size());
+    const auto from_first = std::min(n, first.size());
+    std::move(first.begin(), first.begin() + from_first, out.begin());
+    std::move(second.begin(), second.begin() + (n - from_first),
+        out.begin() + from_first);
+    drop_front_n(static_cast<size_type>(n));
+    return static_cast<size_type>(n);
+  }
+
+  // Drop `n` elements from the front, which must not be more than `size()`.
+  void drop_front_n(size_type n) noexcept {
+    assert(n <= size());
+    if (!n) return;
+    front_ = wrap(front_ + n);
+    size_ -= n;
+  }
+
+  // Return the contents, in order, as at most two contiguous spans. The
+  // second is empty unless the contents wrap around the end of the range.
+  [[nodiscard]] std::array<std::span<const value_type>, 2>
+  segments() const noexcept {
+    const auto first = std::min<size_t>(size(), capacity() - front_);
+    return {std::span<const value_type>{range_}.subspan(front_, first),
+        std::span<const value_type>{range_}.first(size() - first)};
+  }
+  [[nodiscard]] std::array<std::span<value_type>, 2> segments() noexcept {
+    const auto first = std::min<size_t>(size(), capacity() - front_);
+    return {range_.subspan(front_, first), range_.first(size() - first)};
+  }
+
+  // Return the unused space after the back, in order, as at most two
+  // contiguous spans, so that it can be filled in place, such as by `readv`.
+  // Then call `commit_back_n` with the number of elements filled.
+  [[nodiscard]] std::array<std::span<value_type>, 2>
+  spare_segments() noexcept {
+    const size_t room = capacity() - size();
+    const size_type start = room ? wrap(size_t{back_} + 1) : 0;
+    const auto first = std::min<size_t>(room, capacity() - start);
+    return {range_.subspan(start, first), range_.first(room - first)};
+  }
+
+  // Add `n` elements to the back, which must already have been filled in
+  // through `spare_segments`. Must not be more than the room left.
+  void commit_back_n(size_type n) noexcept {
+    assert(n <= capacity() - size());
+    if (!n) return;
+    back_ = wrap(size_t{back_} + n);
+    size_ += n;
+  }
+
+  // Return the last `n` elements, or all of them if there are fewer, as at
+  // most two contiguous spans. This is a zero-copy window over the newest
+  // values.
+  [[nodiscard]] std::array<std::span<const value_type>, 2>
+  back_segments(size_type n) const noexcept {
+    return details::window(segments(), n);
+  }
+  [[nodiscard]] std::array<std::span<value_type>, 2>
+  back_segments(size_type n) noexcept {
+    return details::window(segments(), n);
+  }
+
+  // Rotate the underlying range in place, if needed, so that the contents
+  // are contiguous, and return them as a single span. Only rotates when the
+  // contents wrap around.
+  std::span<value_type> linearize() noexcept(
+      std::is_nothrow_swappable_v<value_type>) {
+    if (size_t{front_} + size() > capacity()) {
+      std::rotate(range_.begin(), range_.begin() + front_, range_.end());
+      front_ = 0;
+      back_ = size_ - 1;
+    }
+    return range_.subspan(front_, size());
+  }
+
   // Size accessors. Note that capacity is full size of the underlying
   // range.
   [[nodiscard]] size_type capacity() const noexcept { return range_.size(); }
@@ -320,6 +454,27 @@ private:
     --back_;
   }
 
+  // Wrap an index that may be up to twice the capacity.
+  size_type wrap(size_t index) const noexcept {
+    return static_cast<size_type>(index >= capacity() ? index - capacity()
+                                                      : index);
+  }
+
+  // Copy `values` after the back. There must be room for them.
+  void append_back(std::span<const value_type> values) noexcept(
+      std::is_nothrow_copy_assignable_v<value_type>) {
+    const auto n = values.size();
+    assert(n <= size_t{capacity()} - size());
+    if (!n) return;
+    const size_type start = wrap(size_t{back_} + 1);
+    const auto first = std::min<size_t>(n, capacity() - start);
+    std::copy(values.begin(), values.begin() + first,
+        range_.begin() + start);
+    std::copy(values.begin() + first, values.end(), range_.begin());
+    back_ = wrap(size_t{back_} + n);
+    size_ += static_cast<size_type>(n);
+  }
+
   void adjust_size_for_front() noexcept {
     if (full())
       drop_back();
@@ -359,4 +514,881 @@ circular_buffer(std::array<T, N>&) -> circular_buffer<T>;
 
 template<typename T, std::size_t N, typename SZ>
 circular_buffer(std::array<T, N>&, SZ) -> circular_buffer<T>;
+
+// Circular buffer adapter with the same interface as `circular_buffer`, but
+// which requires the capacity to be a power of two.
+//
+// Instead of front and back indexes, it keeps free-running head and tail
+// counters, which are only masked when used as indexes. So the size is just
+// their difference, `empty` and `full` are single comparisons, and indexing
+// is an add and a mask, with no branches or modulo. The counters are allowed
+// to overflow, which is harmless because the capacity divides the range of
+// `SZ`.
+//
+// Unlike `circular_buffer`, `operator[]` does not wrap around the size: the
+// index must be less than `size()`.
+template<typename T, typename SZ = size_t>
+class pow2_circular_buffer {
+public:
+  using value_type = T;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using size_type = SZ;
+  static_assert(std::is_unsigned_v<size_type>);
+
+  // Default.
+  pow2_circular_buffer() noexcept = default;
+
+  // Move-only.
+  pow2_circular_buffer(pow2_circular_buffer&& other) noexcept {
+    steal(std::move(other));
+  }
+  pow2_circular_buffer& operator=(pow2_circular_buffer&& other) noexcept {
+    if (this != &other) steal(std::move(other));
+    return *this;
+  }
+
+  // Construct from any container that converts to std::span and whose size
+  // is a power of two. Starts off empty.
+  template<typename U>
+  explicit pow2_circular_buffer(U&& u) noexcept
+  requires std::convertible_to<U, std::span<T>>
+      : range_(std::forward<U>(u)), mask_(mask_for(range_.size())) {}
+
+  // Construct with an initial size, from container.
+  template<typename U>
+  explicit pow2_circular_buffer(U&& u, size_type size) noexcept
+      : range_(std::forward<U>(u)), mask_(mask_for(range_.size())),
+        tail_(size) {
+    assert(size <= capacity());
+  }
+
+  // Clear the buffer. Does not affect underlying container.
+  void clear() noexcept { head_ = tail_ = 0u; }
+
+  // Push the value to the front of the buffer, overwriting the backmost
+  // value if full. Returns reference to the new element.
+  auto& push_front(const value_type& value) noexcept(
+      noexcept(std::declval<T&>() = value)) {
+    if (full()) --tail_;
+    return (add_front() = value);
+  }
+  auto& push_front(value_type&& value) noexcept(
+      noexcept(std::declval<T&>() = std::move(value))) {
+    if (full()) --tail_;
+    return (add_front() = std::move(value));
+  }
+  template<class... Args>
+  auto& emplace_front(Args&&... args) noexcept(
+      noexcept(std::declval<T&>() = value_type{std::forward<Args>(args)...})) {
+    if (full()) --tail_;
+    return (add_front() = value_type{std::forward<Args>(args)...});
+  }
+
+  // Try to push the value to the front of the buffer. Returns pointer to the
+  // new element or nullptr if full.
+  auto* try_push_front(const value_type& value) noexcept(
+      noexcept(std::declval<T&>() = value)) {
+    if (full()) return pointer{};
+    return &(add_front() = value);
+  }
+  auto* try_push_front(value_type&& value) noexcept(
+      noexcept(std::declval<T&>() = std::move(value))) {
+    if (full()) return pointer{};
+    return &(add_front() = std::move(value));
+  }
+  template<class... Args>
+  auto* try_emplace_front(Args&&... args) noexcept(
+      noexcept(std::declval<T&>() = value_type{std::forward<Args>(args)...})) {
+    if (full()) return pointer{};
+    return &(add_front() = value_type{std::forward<Args>(args)...});
+  }
+
+  // Push the value to the back of the buffer, overwriting the frontmost
+  // value if full. Returns reference to the new element.
+  auto& push_back(const value_type& value) noexcept(
+      noexcept(std::declval<T&>() = value)) {
+    if (full()) ++head_;
+    return (add_back() = value);
+  }
+  auto& push_back(value_type&& value) noexcept(
+      noexcept(std::declval<T&>() = std::move(value))) {
+    if (full()) ++head_;
+    return (add_back() = std::move(value));
+  }
+  template<class... Args>
+  auto& emplace_back(Args&&... args) noexcept(
+      noexcept(std::declval<T&>() = value_type{std::forward<Args>(args)...})) {
+    if (full()) ++head_;
+    return (add_back() = value_type{std::forward<Args>(args)...});
+  }
+
+  // Try to push the value to the back of the buffer. Returns pointer to the
+  // new element or nullptr if full.
+  auto* try_push_back(const value_type& value) noexcept(
+      noexcept(std::declval<T&>() = value)) {
+    if (full()) return pointer{};
+    return &(add_back() = value);
+  }
+  auto* try_push_back(value_type&& value) noexcept(
+      noexcept(std::declval<T&>() = std::move(value))) {
+    if (full()) return pointer{};
+    return &(add_back() = std::move(value));
+  }
+  template<class... Args>
+  auto* try_emplace_back(Args&&... args) noexcept(
+      noexcept(std::declval<T&>() = value_type{std::forward<Args>(args)...})) {
+    if (full()) return pointer{};
+    return &(add_back() = value_type{std::forward<Args>(args)...});
+  }
+
+  // Remove front or back element, returning a reference to it. Must not be
+  // empty.
+  auto& pop_front() noexcept {
+    assert(!empty());
+    return slot(head_++);
+  }
+  auto& pop_back() noexcept {
+    assert(!empty());
+    return slot(--tail_);
+  }
+
+  // Push the values to the back of the buffer, overwriting as many of the
+  // frontmost values as needed to make room. If there are more values than
+  // capacity, only the last ones are kept. Returns the number pushed.
+  size_type push_back_range(std::span<const value_type> values) noexcept(
+      std::is_nothrow_copy_assignable_v<value_type>) {
+    if (values.size() > capacity()) values = values.last(capacity());
+    const auto n = static_cast<size_type>(values.size());
+    if (const size_type room = capacity() - size(); n > room)
+      head_ += n - room;
+    append_back(values);
+    return n;
+  }
+
+  // Try to push the values to the back of the buffer, without overwriting
+  // any. Pushes as many as fit, returning the number pushed.
+  size_type try_push_back_range(std::span<const value_type> values) noexcept(
+      std::is_nothrow_copy_assignable_v<value_type>) {
+    const size_t room = capacity() - size();
+    if (values.size() > room) values = values.first(room);
+    append_back(values);
+    return static_cast<size_type>(values.size());
+  }
+
+  // Pop as many values from the front as fit in `out`, moving them there.
+  // Returns the number popped.
+  size_type pop_front_into(std::span<value_type> out) noexcept(
+      std::is_nothrow_move_assignable_v<value_type>) {
+    const auto [first, second] = segments();
+    const auto n = std::min<size_t>(out.size(), size());
+    const auto from_first = std::min(n, first.size());
+    std::move(first.begin(), first.begin() + from_first, out.begin());
+    std::move(second.begin(), second.begin() + (n - from_first),
+        out.begin() + from_first);
+    head_ += static_cast<size_type>(n);
+    return static_cast<size_type>(n);
+  }
+
+  // Drop `n` elements from the front, which must not be more than `size()`.
+  void drop_front_n(size_type n) noexcept {
+    assert(n <= size());
+    head_ += n;
+  }
+
+  // Return the contents, in order, as at most two contiguous spans. The
+  // second is empty unless the contents wrap around the end of the range.
+  [[nodiscard]] std::array<std::span<const value_type>, 2>
+  segments() const noexcept {
+    const auto start = head_ & mask_;
+    const auto first = std::min<size_t>(size(), capacity() - start);
+    return {std::span<const value_type>{range_}.subspan(start, first),
+        std::span<const value_type>{range_}.first(size() - first)};
+  }
+  [[nodiscard]] std::array<std::span<value_type>, 2> segments() noexcept {
+    const auto start = head_ & mask_;
+    const auto first = std::min<size_t>(size(), capacity() - start);
+    return {range_.subspan(start, first), range_.first(size() - first)};
+  }
+
+  // Return the unused space after the back, in order, as at most two
+  // contiguous spans. Then call `commit_back_n` with the number filled.
+  [[nodiscard]] std::array<std::span<value_type>, 2>
+  spare_segments() noexcept {
+    const size_t start = tail_ & mask_;
+    const size_t room = capacity() - size();
+    const auto first = std::min<size_t>(room, capacity() - start);
+    return {range_.subspan(start, first), range_.first(room - first)};
+  }
+
+  // Add `n` elements to the back, which must already have been filled in
+  // through `spare_segments`. Must not be more than the room left.
+  void commit_back_n(size_type n) noexcept {
+    assert(n <= capacity() - size());
+    tail_ += n;
+  }
+
+  // Return the last `n` elements, or all of them if there are fewer, as at
+  // most two contiguous spans.
+  [[nodiscard]] std::array<std::span<const value_type>, 2>
+  back_segments(size_type n) const noexcept {
+    return details::window(segments(), n);
+  }
+  [[nodiscard]] std::array<std::span<value_type>, 2>
+  back_segments(size_type n) noexcept {
+    return details::window(segments(), n);
+  }
+
+  // Rotate the underlying range in place, if needed, so that the contents
+  // are contiguous, and return them as a single span.
+  std::span<value_type> linearize() noexcept(
+      std::is_nothrow_swappable_v<value_type>) {
+    const size_t start = head_ & mask_;
+    if (start + size() > capacity()) {
+      std::rotate(range_.begin(), range_.begin() + start, range_.end());
+      tail_ = size();
+      head_ = 0;
+    }
+    return range_.subspan(head_ & mask_, size());
+  }
+
+  // Size accessors. Note that capacity is full size of the underlying
+  // range.
+  [[nodiscard]] size_type capacity() const noexcept {
+    return static_cast<size_type>(range_.size());
+  }
+  [[nodiscard]] size_type size() const noexcept {
+    return static_cast<size_type>(tail_ - head_);
+  }
+  [[nodiscard]] bool empty() const noexcept { return head_ == tail_; }
+  [[nodiscard]] bool full() const noexcept { return size() == capacity(); }
+
+  // Front and back accessors. Must not be empty.
+  [[nodiscard]] const auto& front() const noexcept { return slot(head_); }
+  [[nodiscard]] auto& front() noexcept { return slot(head_); }
+  [[nodiscard]] const auto& back() const noexcept {
+    return slot(tail_ - 1u);
+  }
+  [[nodiscard]] auto& back() noexcept { return slot(tail_ - 1u); }
+
+  // Array operators require the index to be within the size, while `at`
+  // throws on out-of-range.
+  [[nodiscard]] const auto& operator[](size_type index) const noexcept {
+    assert(index < size());
+    return slot(head_ + index);
+  }
+  [[nodiscard]] auto& operator[](size_type index) noexcept {
+    assert(index < size());
+    return slot(head_ + index);
+  }
+  [[nodiscard]] const auto& at(size_type index) const {
+    if (index >= size()) throw std::out_of_range("index out of range");
+    return slot(head_ + index);
+  }
+  [[nodiscard]] auto& at(size_type index) {
+    if (index >= size()) throw std::out_of_range("index out of range");
+    return slot(head_ + index);
+  }
+
+private:
+  // Templated so that it can const or mutable. Holds a counter, not an
+  // index, so incrementing never needs to wrap.
+  template<typename CB>
+  class iterator_t {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using raw_value_type = pow2_circular_buffer::value_type;
+    using value_type = std::remove_const_t<raw_value_type>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<std::is_const_v<CB>,
+        const raw_value_type*, raw_value_type*>;
+    using reference = std::conditional_t<std::is_const_v<CB>,
+        const raw_value_type&, raw_value_type&>;
+
+    iterator_t() noexcept = default;
+    iterator_t(CB& buf, size_type counter) noexcept
+        : buf_(&buf), counter_(counter) {}
+
+    [[nodiscard]] reference operator*() const noexcept {
+      return buf_->slot(counter_);
+    }
+    [[nodiscard]] pointer operator->() const noexcept {
+      return &buf_->slot(counter_);
+    }
+    [[nodiscard]] reference operator[](difference_type n) const noexcept {
+      return buf_->slot(static_cast<size_type>(counter_ + n));
+    }
+
+    auto& operator++() noexcept {
+      ++counter_;
+      return *this;
+    }
+    auto operator++(int) noexcept {
+      auto tmp = *this;
+      ++counter_;
+      return tmp;
+    }
+    auto& operator--() noexcept {
+      --counter_;
+      return *this;
+    }
+    auto operator--(int) noexcept {
+      auto tmp = *this;
+      --counter_;
+      return tmp;
+    }
+    auto& operator+=(difference_type n) noexcept {
+      counter_ = static_cast<size_type>(counter_ + n);
+      return *this;
+    }
+    auto& operator-=(difference_type n) noexcept {
+      counter_ = static_cast<size_type>(counter_ - n);
+      return *this;
+    }
+    [[nodiscard]] friend iterator_t
+    operator+(iterator_t it, difference_type n) noexcept {
+      return it += n;
+    }
+    [[nodiscard]] friend iterator_t
+    operator+(difference_type n, iterator_t it) noexcept {
+      return it += n;
+    }
+    [[nodiscard]] friend iterator_t
+    operator-(iterator_t it, difference_type n) noexcept {
+      return it -= n;
+    }
+    // Counters are compared by their distance from the head, since they may
+    // have overflowed.
+    [[nodiscard]] friend difference_type
+    operator-(const iterator_t& a, const iterator_t& b) noexcept {
+      return static_cast<difference_type>(a.offset()) -
+             static_cast<difference_type>(b.offset());
+    }
+    [[nodiscard]] friend bool
+    operator==(const iterator_t& a, const iterator_t& b) noexcept {
+      return a.counter_ == b.counter_ && a.buf_ == b.buf_;
+    }
+    [[nodiscard]] friend auto
+    operator<=>(const iterator_t& a, const iterator_t& b) noexcept {
+      return a.offset() <=> b.offset();
+    }
+
+  private:
+    CB* buf_{};
+    size_type counter_{};
+
+    [[nodiscard]] size_type offset() const noexcept {
+      return static_cast<size_type>(counter_ - buf_->head_);
+    }
+  };
+
+public:
+  using iterator = iterator_t<pow2_circular_buffer>;
+  using const_iterator = iterator_t<const pow2_circular_buffer>;
+
+  [[nodiscard]] auto begin() const noexcept {
+    return const_iterator(*this, head_);
+  }
+  [[nodiscard]] auto begin() noexcept { return iterator(*this, head_); }
+  [[nodiscard]] auto cbegin() const noexcept { return begin(); }
+
+  [[nodiscard]] auto end() const noexcept {
+    return const_iterator(*this, tail_);
+  }
+  [[nodiscard]] auto end() noexcept { return iterator(*this, tail_); }
+  [[nodiscard]] auto cend() const noexcept { return end(); }
+
+private:
+  // Implementation details:
+  // The `head_` counter is the front element and `tail_` is one past the
+  // back element, both before masking. The counters only ever increase,
+  // except when pushing to the front or popping from the back, and their
+  // difference is the size.
+  std::span<T> range_;
+  size_type mask_{};
+  size_type head_{};
+  size_type tail_{};
+
+  static size_type mask_for(size_t capacity) noexcept {
+    assert(!capacity || std::has_single_bit(capacity));
+    assert(capacity <= (size_t{std::numeric_limits<size_type>::max()} >> 1) +
+                           1);
+    return static_cast<size_type>(capacity ? capacity - 1 : 0);
+  }
+
+  auto& slot(size_type counter) noexcept { return range_[counter & mask_]; }
+  auto& slot(size_type counter) const noexcept {
+    return range_[counter & mask_];
+  }
+
+  auto& add_front() noexcept { return slot(--head_); }
+  auto& add_back() noexcept { return slot(tail_++); }
+
+  // Copy `values` after the back. There must be room for them.
+  void append_back(std::span<const value_type> values) noexcept(
+      std::is_nothrow_copy_assignable_v<value_type>) {
+    const auto n = values.size();
+    assert(n <= size_t{capacity()} - size());
+    const size_t start = tail_ & mask_;
+    const auto first = std::min<size_t>(n, capacity() - start);
+    std::copy(values.begin(), values.begin() + first,
+        range_.begin() + start);
+    std::copy(values.begin() + first, values.end(), range_.begin());
+    tail_ += static_cast<size_type>(n);
+  }
+
+  void steal(pow2_circular_buffer&& other) {
+    range_ = std::exchange(other.range_, {});
+    mask_ = std::exchange(other.mask_, {});
+    head_ = std::exchange(other.head_, {});
+    tail_ = std::exchange(other.tail_, {});
+  }
+};
+
+// Deduction guides.
+template<typename T>
+pow2_circular_buffer(std::span<T>&) -> pow2_circular_buffer<T>;
+
+template<typename T, typename SZ>
+pow2_circular_buffer(std::span<T>&, SZ) -> pow2_circular_buffer<T>;
+
+template<typename T>
+pow2_circular_buffer(std::vector<T>&) -> pow2_circular_buffer<T>;
+
+template<typename T, typename SZ>
+pow2_circular_buffer(std::vector<T>&, SZ) -> pow2_circular_buffer<T>;
+
+template<typename T, std::size_t N>
+pow2_circular_buffer(std::array<T, N>&) -> pow2_circular_buffer<T>;
+
+template<typename T, std::size_t N, typename SZ>
+pow2_circular_buffer(std::array<T, N>&, SZ) -> pow2_circular_buffer<T>;
+
+// Growable, owning double-ended queue, stored as a ring.
+//
+// Like `pow2_circular_buffer`, it keeps free-running head and tail counters
+// over storage whose capacity is a power of two, so pushing and popping at
+// either end and indexing are O(1) and branch-free. Unlike it, it owns its
+// storage and never overwrites: when full, it allocates twice the capacity
+// and moves the elements over in a single pass, in order, so they start at
+// the beginning of the new storage. Trivially copyable elements are moved
+// with at most two `memcpy` calls.
+//
+// Elements are constructed and destroyed in place, so `T` need not be
+// default-constructible. The contents are at most two contiguous spans,
+// available from `segments`, so iterating over them is as fast as over a
+// `std::vector`, unlike `std::deque`, which scatters its elements over
+// fixed-size blocks. Iterators mask each counter, so they're slower.
+//
+// It's meant as a drop-in replacement for `std::deque` with queue-like use,
+// so it offers the same operations at the ends. Insertion and erasure in the
+// middle are not supported. As with `std::vector`, growing invalidates all
+// iterators, references, and spans.
+template<typename T, typename A = std::allocator<T>>
+class ring_deque {
+  using traits = std::allocator_traits<A>;
+
+public:
+  using value_type = T;
+  using allocator_type = A;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+
+  // Capacity of the first allocation.
+  static constexpr size_type min_capacity = 8;
+
+  ring_deque() noexcept(noexcept(A())) = default;
+  explicit ring_deque(const A& alloc) noexcept : alloc_(alloc) {}
+
+  // Construct from values.
+  ring_deque(std::initializer_list<value_type> values, const A& alloc = A())
+      : alloc_(alloc) {
+    reserve(values.size());
+    for (const auto& value : values) emplace_back(value);
+  }
+
+  ring_deque(const ring_deque& other)
+      : alloc_(traits::select_on_container_copy_construction(other.alloc_)) {
+    reserve(other.size());
+    for (const auto& value : other) emplace_back(value);
+  }
+  ring_deque(ring_deque&& other) noexcept
+      : alloc_(std::move(other.alloc_)),
+        data_(std::exchange(other.data_, nullptr)),
+        mask_(std::exchange(other.mask_, 0)),
+        head_(std::exchange(other.head_, 0)),
+        tail_(std::exchange(other.tail_, 0)) {}
+
+  ring_deque& operator=(const ring_deque& other) {
+    if (this != &other) {
+      clear();
+      reserve(other.size());
+      for (const auto& value : other) emplace_back(value);
+    }
+    return *this;
+  }
+  ring_deque& operator=(ring_deque&& other) noexcept {
+    if (this != &other) {
+      release();
+      alloc_ = std::move(other.alloc_);
+      data_ = std::exchange(other.data_, nullptr);
+      mask_ = std::exchange(other.mask_, 0);
+      head_ = std::exchange(other.head_, 0);
+      tail_ = std::exchange(other.tail_, 0);
+    }
+    return *this;
+  }
+
+  ~ring_deque() { release(); }
+
+  void swap(ring_deque& other) noexcept {
+    using std::swap;
+    swap(alloc_, other.alloc_);
+    std::swap(data_, other.data_);
+    std::swap(mask_, other.mask_);
+    std::swap(head_, other.head_);
+    std::swap(tail_, other.tail_);
+  }
+  friend void swap(ring_deque& a, ring_deque& b) noexcept { a.swap(b); }
+
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return alloc_;
+  }
+
+  // Push or emplace to the front or back, growing if full. Returns a
+  // reference to the new element.
+  auto& push_back(const value_type& value) { return emplace_back(value); }
+  auto& push_back(value_type&& value) {
+    return emplace_back(std::move(value));
+  }
+  template<typename... Args>
+  auto& emplace_back(Args&&... args) {
+    if (full()) return grow_and_emplace(false, std::forward<Args>(args)...);
+    traits::construct(alloc_, &slot(tail_), std::forward<Args>(args)...);
+    return slot(tail_++);
+  }
+
+  auto& push_front(const value_type& value) { return emplace_front(value); }
+  auto& push_front(value_type&& value) {
+    return emplace_front(std::move(value));
+  }
+  template<typename... Args>
+  auto& emplace_front(Args&&... args) {
+    if (full()) return grow_and_emplace(true, std::forward<Args>(args)...);
+    traits::construct(alloc_, &slot(head_ - 1), std::forward<Args>(args)...);
+    return slot(--head_);
+  }
+
+  // Remove and destroy the front or back element. Must not be empty.
+  void pop_front() noexcept {
+    assert(!empty());
+    traits::destroy(alloc_, &slot(head_++));
+  }
+  void pop_back() noexcept {
+    assert(!empty());
+    traits::destroy(alloc_, &slot(--tail_));
+  }
+
+  // Push copies of the values to the back, growing at most once.
+  void append_range(std::span<const value_type> values) {
+    reserve(size() + values.size());
+    for (const auto& value : values) emplace_back(value);
+  }
+
+  // Destroy all elements, keeping the storage.
+  void clear() noexcept {
+    if constexpr (!std::is_trivially_destructible_v<value_type>)
+      while (head_ != tail_) traits::destroy(alloc_, &slot(head_++));
+    head_ = tail_ = 0;
+  }
+
+  // Ensure room for at least `n` elements without growing. Throws
+  // `std::length_error` if `n` exceeds `max_size`.
+  void reserve(size_type n) {
+    if (n <= capacity()) return;
+    if (n > max_size()) throw std::length_error("ring_deque too long");
+    relocate(std::bit_ceil(std::max(n, min_capacity)));
+  }
+
+  // Reduce the capacity to the smallest power of two that fits, freeing the
+  // storage if empty.
+  void shrink_to_fit() {
+    if (empty()) {
+      release();
+      return;
+    }
+    if (const auto wanted = std::bit_ceil(size()); wanted < capacity())
+      relocate(wanted);
+  }
+
+  [[nodiscard]] size_type size() const noexcept { return tail_ - head_; }
+  [[nodiscard]] bool empty() const noexcept { return head_ == tail_; }
+  [[nodiscard]] size_type capacity() const noexcept {
+    return data_ ? mask_ + 1 : 0;
+  }
+  [[nodiscard]] size_type max_size() const noexcept {
+    return std::min<size_type>(traits::max_size(alloc_),
+        (std::numeric_limits<size_type>::max() >> 1) + 1);
+  }
+
+  // Return the contents, in order, as at most two contiguous spans. The
+  // second is empty unless the contents wrap around the end of the storage.
+  [[nodiscard]] std::array<std::span<const value_type>, 2>
+  segments() const noexcept {
+    const auto [first, second] = spans();
+    return {first, second};
+  }
+  [[nodiscard]] std::array<std::span<value_type>, 2> segments() noexcept {
+    return spans();
+  }
+
+  // Element access. The index must be less than `size()`, except for `at`,
+  // which throws.
+  [[nodiscard]] auto& front() const noexcept {
+    assert(!empty());
+    return slot(head_);
+  }
+  [[nodiscard]] auto& front() noexcept {
+    assert(!empty());
+    return slot(head_);
+  }
+  [[nodiscard]] auto& back() const noexcept {
+    assert(!empty());
+    return slot(tail_ - 1);
+  }
+  [[nodiscard]] auto& back() noexcept {
+    assert(!empty());
+    return slot(tail_ - 1);
+  }
+  [[nodiscard]] auto& operator[](size_type index) const noexcept {
+    assert(index < size());
+    return slot(head_ + index);
+  }
+  [[nodiscard]] auto& operator[](size_type index) noexcept {
+    assert(index < size());
+    return slot(head_ + index);
+  }
+  [[nodiscard]] const auto& at(size_type index) const {
+    if (index >= size()) throw std::out_of_range("index out of range");
+    return slot(head_ + index);
+  }
+  [[nodiscard]] auto& at(size_type index) {
+    if (index >= size()) throw std::out_of_range("index out of range");
+    return slot(head_ + index);
+  }
+
+  [[nodiscard]] friend bool
+  operator==(const ring_deque& a, const ring_deque& b) {
+    return std::ranges::equal(a, b);
+  }
+
+private:
+  // Like that of `pow2_circular_buffer`, but holding copies of the storage
+  // pointer and mask, so that dereferencing doesn't need to go through the
+  // container. These are only invalidated by growing, which invalidates all
+  // iterators anyway. Positions are compared by their unwrapped counters,
+  // so iterators made before and after pushing or popping at the front
+  // still agree.
+  template<typename RD>
+  class iterator_t {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using raw_value_type = ring_deque::value_type;
+    using value_type = raw_value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<std::is_const_v<RD>,
+        const raw_value_type*, raw_value_type*>;
+    using reference = std::conditional_t<std::is_const_v<RD>,
+        const raw_value_type&, raw_value_type&>;
+
+    iterator_t() noexcept = default;
+    iterator_t(RD& rd, size_type counter) noexcept
+        : data_(rd.data_), mask_(rd.mask_), counter_(counter) {}
+
+    // Convert a mutable iterator to a const one. This is a template so that
+    // it's never mistaken for the copy constructor.
+    template<typename U>
+    requires std::same_as<const U, RD> && (!std::same_as<U, RD>)
+    iterator_t(const iterator_t<U>& it) noexcept
+        : data_(it.data_), mask_(it.mask_), counter_(it.counter_) {}
+
+    [[nodiscard]] reference operator*() const noexcept {
+      return data_[counter_ & mask_];
+    }
+    [[nodiscard]] pointer operator->() const noexcept {
+      return &data_[counter_ & mask_];
+    }
+    [[nodiscard]] reference operator[](difference_type n) const noexcept {
+      return data_[(counter_ + n) & mask_];
+    }
+
+    auto& operator++() noexcept {
+      ++counter_;
+      return *this;
+    }
+    auto operator++(int) noexcept {
+      auto tmp = *this;
+      ++counter_;
+      return tmp;
+    }
+    auto& operator--() noexcept {
+      --counter_;
+      return *this;
+    }
+    auto operator--(int) noexcept {
+      auto tmp = *this;
+      --counter_;
+      return tmp;
+    }
+    auto& operator+=(difference_type n) noexcept {
+      counter_ += n;
+      return *this;
+    }
+    auto& operator-=(difference_type n) noexcept {
+      counter_ -= n;
+      return *this;
+    }
+    [[nodiscard]] friend iterator_t
+    operator+(iterator_t it, difference_type n) noexcept {
+      return it += n;
+    }
+    [[nodiscard]] friend iterator_t
+    operator+(difference_type n, iterator_t it) noexcept {
+      return it += n;
+    }
+    [[nodiscard]] friend iterator_t
+    operator-(iterator_t it, difference_type n) noexcept {
+      return it -= n;
+    }
+    [[nodiscard]] friend difference_type
+    operator-(const iterator_t& a, const iterator_t& b) noexcept {
+      return static_cast<difference_type>(a.counter_ - b.counter_);
+    }
+    [[nodiscard]] friend bool
+    operator==(const iterator_t& a, const iterator_t& b) noexcept {
+      return a.counter_ == b.counter_ && a.data_ == b.data_;
+    }
+    [[nodiscard]] friend auto
+    operator<=>(const iterator_t& a, const iterator_t& b) noexcept {
+      return a - b <=> 0;
+    }
+
+  private:
+    template<typename>
+    friend class iterator_t;
+
+    pointer data_{};
+    size_type mask_{};
+    size_type counter_{};
+  };
+
+public:
+  using iterator = iterator_t<ring_deque>;
+  using const_iterator = iterator_t<const ring_deque>;
+
+  [[nodiscard]] auto begin() const noexcept {
+    return const_iterator(*this, head_);
+  }
+  [[nodiscard]] auto begin() noexcept { return iterator(*this, head_); }
+  [[nodiscard]] auto cbegin() const noexcept { return begin(); }
+
+  [[nodiscard]] auto end() const noexcept {
+    return const_iterator(*this, tail_);
+  }
+  [[nodiscard]] auto end() noexcept { return iterator(*this, tail_); }
+  [[nodiscard]] auto cend() const noexcept { return end(); }
+
+private:
+  // Implementation details:
+  // The counters work as in `pow2_circular_buffer`. Only the slots between
+  // them hold live elements; the rest are raw storage. After relocating,
+  // `head_` is 0, so the contents are a single span.
+  [[no_unique_address]] A alloc_;
+  T* data_{};
+  size_type mask_{};
+  size_type head_{};
+  size_type tail_{};
+
+  auto& slot(size_type counter) noexcept { return data_[counter & mask_]; }
+  const auto& slot(size_type counter) const noexcept {
+    return data_[counter & mask_];
+  }
+
+  [[nodiscard]] bool full() const noexcept { return size() == capacity(); }
+
+  [[nodiscard]] std::array<std::span<value_type>, 2> spans() const noexcept {
+    if (!data_) return {};
+    const auto start = head_ & mask_;
+    const auto first = std::min(size(), capacity() - start);
+    return {std::span{data_ + start, first},
+        std::span{data_, size() - first}};
+  }
+
+  // Move the elements, in order, to the start of new storage of `capacity`,
+  // which must be a power of two that fits them, and free the old storage.
+  void relocate(size_type capacity) {
+    assert(std::has_single_bit(capacity) && capacity >= size());
+    if (capacity > max_size()) throw std::length_error("ring_deque too long");
+    auto fresh = traits::allocate(alloc_, capacity);
+    const auto [first, second] = spans();
+    if constexpr (std::is_trivially_copyable_v<value_type>) {
+      if (!first.empty())
+        std::memcpy(fresh, first.data(), first.size_bytes());
+      if (!second.empty())
+        std::memcpy(fresh + first.size(), second.data(), second.size_bytes());
+    } else {
+      size_type moved = 0;
+      try {
+        for (auto* segment : {&first, &second})
+          for (auto& value : *segment)
+            traits::construct(alloc_, fresh + moved++,
+                std::move_if_noexcept(value));
+      }
+      catch (...) {
+        while (moved) traits::destroy(alloc_, fresh + --moved);
+        traits::deallocate(alloc_, fresh, capacity);
+        throw;
+      }
+    }
+    const auto n = size();
+    release();
+    data_ = fresh;
+    mask_ = capacity - 1;
+    tail_ = n;
+  }
+
+  // Grow, then construct at the front or back. The new element is built
+  // first, since `args` may refer to an existing one.
+  template<typename... Args>
+  value_type& grow_and_emplace(bool at_front, Args&&... args) {
+    value_type value(std::forward<Args>(args)...);
+    if (capacity() > max_size() / 2)
+      throw std::length_error("ring_deque too long");
+    relocate(std::max(capacity() * 2, min_capacity));
+    if (at_front) {
+      traits::construct(alloc_, &slot(head_ - 1), std::move(value));
+      return slot(--head_);
+    }
+    traits::construct(alloc_, &slot(tail_), std::move(value));
+    return slot(tail_++);
+  }
+
+  // Destroy the elements and free the storage.
+  void release() noexcept {
+    clear();
+    if (data_) traits::deallocate(alloc_, data_, capacity());
+    data_ = nullptr;
+    mask_ = 0;
+  }
+};
+
+template<typename T>
+ring_deque(std::initializer_list<T>) -> ring_deque<T>;
+
 }} // namespace corvid::adapters
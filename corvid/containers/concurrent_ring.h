@@ -0,0 +1,327 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace corvid { inline namespace adapters {
+
+namespace details {
+// Assign `args` to `slot`, directly if it's a single `T`, or else through a
+// temporary constructed from them.
+template<typename T, typename... Args>
+void ring_assign(T& slot, Args&&... args) {
+  if constexpr (sizeof...(Args) == 1 &&
+                (std::is_same_v<std::remove_cvref_t<Args>, T> && ...))
+    slot = (std::forward<Args>(args), ...);
+  else
+    slot = T(std::forward<Args>(args)...);
+}
+} // namespace details
+
+// Size to align to, so that indexes owned by different threads don't share a
+// cache line. We avoid `std::hardware_destructive_interference_size` because
+// it may differ between translation units.
+inline constexpr size_t ring_cache_line_size = 64;
+
+// Wait-free, single-producer, single-consumer ring adapter over any
+// container that supports `std::span` and whose size is a power of two.
+// Does not own the underlying container.
+//
+// One thread may call the producer methods, `try_push`, `try_emplace`, and
+// `try_push_range`, while another calls the consumer methods, `try_pop` and
+// `try_pop_into`. Like `pow2_circular_buffer`, it keeps free-running head and
+// tail counters. Each side owns one, on its own cache line, and keeps a cached
+// copy of the other's, so it only reads the other side's cache line when the
+// ring looks full or empty.
+//
+// Elements are assigned to, not constructed, so the container holds live
+// objects throughout, just as with `circular_buffer`.
+template<typename T, typename SZ = size_t>
+class spsc_ring {
+public:
+  using value_type = T;
+  using size_type = SZ;
+  static_assert(std::is_unsigned_v<size_type>);
+
+  // Construct from any container that converts to std::span and whose size
+  // is a power of two. Starts off empty.
+  template<typename U>
+  explicit spsc_ring(U&& u) noexcept
+  requires std::convertible_to<U, std::span<T>>
+      : range_(std::forward<U>(u)),
+        mask_(static_cast<size_type>(range_.size() - 1)) {
+    assert(std::has_single_bit(range_.size()));
+    assert(range_.size() <=
+           (size_t{std::numeric_limits<size_type>::max()} >> 1) + 1);
+  }
+
+  spsc_ring(const spsc_ring&) = delete;
+  spsc_ring& operator=(const spsc_ring&) = delete;
+
+  // Producer.
+
+  // Try to push the value. Returns whether there was room.
+  bool try_push(const value_type& value) noexcept(
+      std::is_nothrow_copy_assignable_v<value_type>) {
+    return try_emplace(value);
+  }
+  bool try_push(value_type&& value) noexcept(
+      std::is_nothrow_move_assignable_v<value_type>) {
+    return try_emplace(std::move(value));
+  }
+  template<class... Args>
+  bool try_emplace(Args&&... args) {
+    const auto tail = tail_.load(std::memory_order::relaxed);
+    if (!room_for(tail, 1)) return false;
+    details::ring_assign(range_[tail & mask_], std::forward<Args>(args)...);
+    tail_.store(static_cast<size_type>(tail + 1), std::memory_order::release);
+    return true;
+  }
+
+  // Try to push the values, publishing them all at once. Pushes as many as
+  // fit, returning the number pushed.
+  size_type try_push_range(std::span<const value_type> values) noexcept(
+      std::is_nothrow_copy_assignable_v<value_type>) {
+    const auto tail = tail_.load(std::memory_order::relaxed);
+    auto n = static_cast<size_type>(std::min<size_t>(values.size(),
+        capacity()));
+    if (!room_for(tail, n))
+      n = static_cast<size_type>(capacity() -
+          static_cast<size_type>(tail - cached_head_));
+    if (!n) return 0;
+    const size_t start = tail & mask_;
+    const auto first = std::min<size_t>(n, capacity() - start);
+    std::copy(values.begin(), values.begin() + first,
+        range_.begin() + start);
+    std::copy(values.begin() + first, values.begin() + n, range_.begin());
+    tail_.store(static_cast<size_type>(tail + n), std::memory_order::release);
+    return n;
+  }
+
+  // Consumer.
+
+  // Try to pop a value into `out`. Returns whether there was one.
+  bool try_pop(value_type& out) noexcept(
+      std::is_nothrow_move_assignable_v<value_type>) {
+    const auto head = head_.load(std::memory_order::relaxed);
+    if (!available_from(head, 1)) return false;
+    out = std::move(range_[head & mask_]);
+    head_.store(static_cast<size_type>(head + 1), std::memory_order::release);
+    return true;
+  }
+
+  // Try to pop as many values as fit in `out`, moving them there. Returns
+  // the number popped.
+  size_type try_pop_into(std::span<value_type> out) noexcept(
+      std::is_nothrow_move_assignable_v<value_type>) {
+    const auto head = head_.load(std::memory_order::relaxed);
+    auto n =
+        static_cast<size_type>(std::min<size_t>(out.size(), capacity()));
+    if (!available_from(head, n))
+      n = static_cast<size_type>(cached_tail_ - head);
+    if (!n) return 0;
+    const size_t start = head & mask_;
+    const auto first = std::min<size_t>(n, capacity() - start);
+    auto segment = range_.subspan(start, first);
+    std::move(segment.begin(), segment.end(), out.begin());
+    segment = range_.first(n - first);
+    std::move(segment.begin(), segment.end(), out.begin() + first);
+    head_.store(static_cast<size_type>(head + n), std::memory_order::release);
+    return n;
+  }
+
+  // Either side.
+
+  [[nodiscard]] size_type capacity() const noexcept {
+    return static_cast<size_type>(range_.size());
+  }
+
+  // Snapshot of the size, which may be stale by the time it's returned.
+  [[nodiscard]] size_type size() const noexcept {
+    const auto head = head_.load(std::memory_order::acquire);
+    return static_cast<size_type>(
+        tail_.load(std::memory_order::acquire) - head);
+  }
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+  [[nodiscard]] bool full() const noexcept { return size() == capacity(); }
+
+private:
+  std::span<T> range_;
+  size_type mask_{};
+
+  // Owned by the producer.
+  alignas(ring_cache_line_size) std::atomic<size_type> tail_{};
+  size_type cached_head_{};
+
+  // Owned by the consumer.
+  alignas(ring_cache_line_size) std::atomic<size_type> head_{};
+  size_type cached_tail_{};
+
+  // Whether there's room for `n` more after `tail`, refreshing the cached
+  // head only if it looks like there isn't.
+  [[nodiscard]] bool room_for(size_type tail, size_type n) noexcept {
+    if (static_cast<size_type>(tail - cached_head_) + n <= capacity())
+      return true;
+    cached_head_ = head_.load(std::memory_order::acquire);
+    return static_cast<size_type>(tail - cached_head_) + n <= capacity();
+  }
+
+  // Whether there are `n` available from `head`, refreshing the cached tail
+  // only if it looks like there aren't.
+  [[nodiscard]] bool available_from(size_type head, size_type n) noexcept {
+    if (static_cast<size_type>(cached_tail_ - head) >= n) return true;
+    cached_tail_ = tail_.load(std::memory_order::acquire);
+    return static_cast<size_type>(cached_tail_ - head) >= n;
+  }
+};
+
+// Deduction guides.
+template<typename T>
+spsc_ring(std::span<T>&) -> spsc_ring<T>;
+
+template<typename T>
+spsc_ring(std::vector<T>&) -> spsc_ring<T>;
+
+template<typename T, std::size_t N>
+spsc_ring(std::array<T, N>&) -> spsc_ring<T>;
+
+// Bounded, lock-free, multi-producer, multi-consumer ring, after Dmitry
+// Vyukov's design.
+//
+// Any number of threads may push and pop. Each cell holds a sequence number
+// next to its value, which tells a producer whether the cell is free for the
+// position it claimed and tells a consumer whether it's been filled. So,
+// unlike `spsc_ring`, it has to own its storage, and the capacity, which is
+// rounded up to a power of two, is set on construction.
+//
+// Producers and consumers each claim positions with a CAS on their own
+// counter, on its own cache line, and never touch the other's. Since
+// positions are claimed one at a time, the range operations are a
+// convenience, not a batch: values from other threads may be interleaved.
+template<typename T>
+class mpmc_ring {
+  struct cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+public:
+  using value_type = T;
+  using size_type = size_t;
+
+  explicit mpmc_ring(size_t capacity)
+      : mask_{std::bit_ceil(std::max<size_t>(capacity, 2)) - 1},
+        cells_{std::make_unique<cell[]>(mask_ + 1)} {
+    for (size_t i = 0; i <= mask_; ++i)
+      cells_[i].sequence.store(i, std::memory_order::relaxed);
+  }
+
+  mpmc_ring(const mpmc_ring&) = delete;
+  mpmc_ring& operator=(const mpmc_ring&) = delete;
+
+  // Try to push the value. Returns whether there was room.
+  bool try_push(const value_type& value) { return try_emplace(value); }
+  bool try_push(value_type&& value) { return try_emplace(std::move(value)); }
+  template<class... Args>
+  bool try_emplace(Args&&... args) {
+    auto pos = enqueue_pos_.load(std::memory_order::relaxed);
+    cell* c;
+    for (;;) {
+      c = &cells_[pos & mask_];
+      const auto seq = c->sequence.load(std::memory_order::acquire);
+      const auto diff =
+          static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                std::memory_order::relaxed))
+          break;
+      } else if (diff < 0)
+        return false;
+      else
+        pos = enqueue_pos_.load(std::memory_order::relaxed);
+    }
+    details::ring_assign(c->value, std::forward<Args>(args)...);
+    c->sequence.store(pos + 1, std::memory_order::release);
+    return true;
+  }
+
+  // Try to pop a value into `out`. Returns whether there was one.
+  bool try_pop(value_type& out) {
+    auto pos = dequeue_pos_.load(std::memory_order::relaxed);
+    cell* c;
+    for (;;) {
+      c = &cells_[pos & mask_];
+      const auto seq = c->sequence.load(std::memory_order::acquire);
+      const auto diff = static_cast<std::intptr_t>(seq) -
+                        static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                std::memory_order::relaxed))
+          break;
+      } else if (diff < 0)
+        return false;
+      else
+        pos = dequeue_pos_.load(std::memory_order::relaxed);
+    }
+    out = std::move(c->value);
+    c->sequence.store(pos + mask_ + 1, std::memory_order::release);
+    return true;
+  }
+
+  // Try to push the values, one at a time, stopping when full. Returns the
+  // number pushed.
+  size_type try_push_range(std::span<const value_type> values) {
+    size_type n = 0;
+    while (n < values.size() && try_push(values[n])) ++n;
+    return n;
+  }
+
+  // Try to pop values into `out`, one at a time, stopping when empty.
+  // Returns the number popped.
+  size_type try_pop_into(std::span<value_type> out) {
+    size_type n = 0;
+    while (n < out.size() && try_pop(out[n])) ++n;
+    return n;
+  }
+
+  [[nodiscard]] size_type capacity() const noexcept { return mask_ + 1; }
+
+  // Snapshot of the size, which may be stale by the time it's returned.
+  [[nodiscard]] size_type size() const noexcept {
+    const auto dequeued = dequeue_pos_.load(std::memory_order::acquire);
+    const auto enqueued = enqueue_pos_.load(std::memory_order::acquire);
+    return enqueued > dequeued ? std::min(enqueued - dequeued, capacity())
+                               : 0;
+  }
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+
+private:
+  const size_t mask_;
+  const std::unique_ptr<cell[]> cells_;
+  alignas(ring_cache_line_size) std::atomic<size_t> enqueue_pos_{};
+  alignas(ring_cache_line_size) std::atomic<size_t> dequeue_pos_{};
+};
+
+}} // namespace corvid::adapters
@@ -93,7 +93,10 @@ public:
   custom_handle(std::nullptr_t) {}
   custom_handle(const custom_handle&) = default;
 
+  // When the element and resource ID types are the same, only the resource
+  // ID overloads are needed.
   custom_handle(element_type element)
+  requires(!std::is_same_v<element_type, resource_id_type>)
       : resource_{static_cast<resource_id_type>(element)} {}
   custom_handle(resource_id_type resource) : resource_(resource) {}
 
@@ -106,7 +109,9 @@ public:
     resource_ = resource;
     return *this;
   }
-  custom_handle& operator=(element_type element) {
+  custom_handle& operator=(element_type element)
+  requires(!std::is_same_v<element_type, resource_id_type>)
+  {
     resource_ = static_cast<resource_id_type>(element);
     return *this;
   }
@@ -0,0 +1,524 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+#include "interval.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+
+namespace corvid { inline namespace container { inline namespace enum_indexed {
+
+// `E` must be a sequence or bitmask enum, whose values can densely index an
+// array.
+template<typename E>
+concept DenseEnum = sequence::SequentialEnum<E> || bitmask::BitmaskEnum<E>;
+
+namespace details {
+// Largest number of values a dense enum container will hold.
+inline constexpr size_t max_dense_enum_size = size_t{1} << 16;
+
+// Map between the values of `E` and dense indexes.
+//
+// For a sequence enum, these are the offsets from `seq_min_v`. For a bitmask
+// enum, they're the values themselves, from zero up to `max_value`, so any
+// holes in the valid bits take up space.
+template<DenseEnum E>
+struct enum_index {
+  using U = as_underlying_t<E>;
+
+  static constexpr int64_t min = [] {
+    if constexpr (sequence::SequentialEnum<E>)
+      return static_cast<int64_t>(sequence::seq_min_num_v<E>);
+    else
+      return int64_t{};
+  }();
+  static constexpr size_t size = [] {
+    if constexpr (sequence::SequentialEnum<E>)
+      return static_cast<size_t>(sequence::seq_size_v<E>);
+    else
+      return static_cast<size_t>(as_underlying(bitmask::max_value<E>())) + 1;
+  }();
+  static_assert(size && size <= max_dense_enum_size,
+      "Enum range is too large for a dense container");
+
+  // Index of `e`, which is at least `size` if it's out of range.
+  [[nodiscard]] static constexpr size_t of(E e) noexcept {
+    return static_cast<size_t>(static_cast<int64_t>(as_underlying(e)) - min);
+  }
+
+  [[nodiscard]] static constexpr E at(size_t i) noexcept {
+    return static_cast<E>(static_cast<U>(min + static_cast<int64_t>(i)));
+  }
+
+  // Every value, in order, so that iterators can refer to them.
+  static constexpr auto values = [] {
+    std::array<E, size> result{};
+    for (size_t i = 0; i < size; ++i) result[i] = at(i);
+    return result;
+  }();
+};
+} // namespace details
+
+//
+// enum_set
+//
+
+// Set of values of a sequence or bitmask enum, stored as a bitset over the
+// enum's range.
+//
+// Fixed-size, allocation-free, and usable in constant expressions. Iterates
+// in enum order. Values outside the range of the enum are never contained,
+// and inserting one throws `std::out_of_range`.
+template<DenseEnum E>
+class enum_set {
+  using index = details::enum_index<E>;
+  static constexpr size_t word_count = (index::size + 63) / 64;
+
+public:
+  using key_type = E;
+  using value_type = E;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = const E&;
+  using const_reference = const E&;
+
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = E;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const E*;
+    using reference = const E&;
+
+    constexpr const_iterator() noexcept = default;
+    constexpr const_iterator(const enum_set* owner, size_t pos) noexcept
+        : owner_{owner}, pos_{pos} {}
+
+    [[nodiscard]] constexpr reference operator*() const noexcept {
+      return index::values[pos_];
+    }
+    [[nodiscard]] constexpr pointer operator->() const noexcept {
+      return &index::values[pos_];
+    }
+
+    constexpr const_iterator& operator++() noexcept {
+      pos_ = owner_->next(pos_ + 1);
+      return *this;
+    }
+    constexpr const_iterator operator++(int) noexcept {
+      auto old = *this;
+      ++*this;
+      return old;
+    }
+
+    [[nodiscard]] friend constexpr bool
+    operator==(const const_iterator& l, const const_iterator& r) noexcept {
+      return l.pos_ == r.pos_;
+    }
+
+    // Dense index of the current value.
+    [[nodiscard]] constexpr size_t pos() const noexcept { return pos_; }
+
+  private:
+    const enum_set* owner_{};
+    size_t pos_{index::size};
+  };
+  using iterator = const_iterator;
+
+  constexpr enum_set() noexcept = default;
+  constexpr enum_set(std::initializer_list<E> values) {
+    for (const auto e : values) insert(e);
+  }
+  template<typename U>
+  constexpr explicit enum_set(const interval<E, U>& values) {
+    insert(values);
+  }
+
+  // Set of every value in the range of `E`.
+  [[nodiscard]] static constexpr enum_set all() noexcept {
+    enum_set result;
+    for (auto& word : result.words_) word = ~uint64_t{};
+    result.trim();
+    return result;
+  }
+
+  // Number of values in the range of `E`.
+  [[nodiscard]] static constexpr size_t max_size() noexcept {
+    return index::size;
+  }
+
+  // Iterators.
+  [[nodiscard]] constexpr const_iterator begin() const noexcept {
+    return {this, next(0)};
+  }
+  [[nodiscard]] constexpr const_iterator end() const noexcept {
+    return {this, index::size};
+  }
+  [[nodiscard]] constexpr const_iterator cbegin() const noexcept {
+    return begin();
+  }
+  [[nodiscard]] constexpr const_iterator cend() const noexcept {
+    return end();
+  }
+
+  // Accessors.
+  [[nodiscard]] constexpr size_t size() const noexcept {
+    size_t n{};
+    for (const auto word : words_) n += std::popcount(word);
+    return n;
+  }
+  [[nodiscard]] constexpr bool empty() const noexcept {
+    return std::ranges::all_of(words_, [](auto word) { return !word; });
+  }
+
+  [[nodiscard]] constexpr bool contains(E e) const noexcept {
+    return test(index::of(e));
+  }
+  [[nodiscard]] constexpr size_t count(E e) const noexcept {
+    return contains(e);
+  }
+  [[nodiscard]] constexpr const_iterator find(E e) const noexcept {
+    const auto i = index::of(e);
+    return test(i) ? const_iterator{this, i} : end();
+  }
+
+  // Modifiers.
+  constexpr std::pair<const_iterator, bool> insert(E e) {
+    const auto i = checked(e);
+    auto& word = words_[i / 64];
+    const auto bit = uint64_t{1} << (i % 64);
+    const bool inserted = !(word & bit);
+    word |= bit;
+    return {const_iterator{this, i}, inserted};
+  }
+  template<typename U>
+  constexpr void insert(const interval<E, U>& values) {
+    for (const auto e : values) insert(e);
+  }
+
+  constexpr size_t erase(E e) noexcept {
+    const auto i = index::of(e);
+    if (!test(i)) return 0;
+    words_[i / 64] &= ~(uint64_t{1} << (i % 64));
+    return 1;
+  }
+
+  constexpr void clear() noexcept { words_ = {}; }
+
+  // Set operations.
+  constexpr enum_set& operator|=(const enum_set& r) noexcept {
+    for (size_t w = 0; w < word_count; ++w) words_[w] |= r.words_[w];
+    return *this;
+  }
+  constexpr enum_set& operator&=(const enum_set& r) noexcept {
+    for (size_t w = 0; w < word_count; ++w) words_[w] &= r.words_[w];
+    return *this;
+  }
+  constexpr enum_set& operator^=(const enum_set& r) noexcept {
+    for (size_t w = 0; w < word_count; ++w) words_[w] ^= r.words_[w];
+    return *this;
+  }
+  // Remove the values in `r`.
+  constexpr enum_set& operator-=(const enum_set& r) noexcept {
+    for (size_t w = 0; w < word_count; ++w) words_[w] &= ~r.words_[w];
+    return *this;
+  }
+
+  [[nodiscard]] friend constexpr enum_set
+  operator|(enum_set l, const enum_set& r) noexcept {
+    return l |= r;
+  }
+  [[nodiscard]] friend constexpr enum_set
+  operator&(enum_set l, const enum_set& r) noexcept {
+    return l &= r;
+  }
+  [[nodiscard]] friend constexpr enum_set
+  operator^(enum_set l, const enum_set& r) noexcept {
+    return l ^= r;
+  }
+  [[nodiscard]] friend constexpr enum_set
+  operator-(enum_set l, const enum_set& r) noexcept {
+    return l -= r;
+  }
+  // Complement within the range of `E`.
+  [[nodiscard]] constexpr enum_set operator~() const noexcept {
+    return all() - *this;
+  }
+
+  [[nodiscard]] friend constexpr bool
+  operator==(const enum_set&, const enum_set&) noexcept = default;
+
+private:
+  template<DenseEnum, typename>
+  friend class enum_map;
+
+  std::array<uint64_t, word_count> words_{};
+
+  [[nodiscard]] constexpr bool test(size_t i) const noexcept {
+    return i < index::size && (words_[i / 64] >> (i % 64)) & 1;
+  }
+
+  // Index of the first value at or after `i`, or `index::size`.
+  [[nodiscard]] constexpr size_t next(size_t i) const noexcept {
+    for (auto w = i / 64; w < word_count; ++w) {
+      auto word = words_[w];
+      if (w == i / 64) word &= ~uint64_t{} << (i % 64);
+      if (word) return w * 64 + std::countr_zero(word);
+    }
+    return index::size;
+  }
+
+  [[nodiscard]] static constexpr size_t checked(E e) {
+    const auto i = index::of(e);
+    if (i >= index::size) throw std::out_of_range("enum value out of range");
+    return i;
+  }
+
+  // Clear the bits past the end of the range.
+  constexpr void trim() noexcept {
+    if constexpr (index::size % 64)
+      words_.back() &= (uint64_t{1} << (index::size % 64)) - 1;
+  }
+};
+
+//
+// enum_map
+//
+
+// Map from the values of a sequence or bitmask enum to `V`, stored as an
+// array over the enum's range, along with an `enum_set` of the keys present.
+//
+// Fixed-size, allocation-free, and usable in constant expressions. Iterates
+// in enum order, as `std::pair<const E, V>`, so it joins like a `std::map`.
+//
+// Every slot holds a `V`, so `V` must be default-constructible; a slot whose
+// key isn't present holds `V{}`, to which it's reset on erase. Values outside
+// the range of the enum are never found, and adding one throws
+// `std::out_of_range`.
+template<DenseEnum E, typename V>
+class enum_map {
+  using index = details::enum_index<E>;
+
+public:
+  using key_type = E;
+  using mapped_type = V;
+  using value_type = std::pair<const E, V>;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  template<bool is_const>
+  class basic_iterator {
+    using owner_t = std::conditional_t<is_const, const enum_map, enum_map>;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = enum_map::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer =
+        std::conditional_t<is_const, const value_type*, value_type*>;
+    using reference =
+        std::conditional_t<is_const, const value_type&, value_type&>;
+
+    constexpr basic_iterator() noexcept = default;
+    constexpr basic_iterator(owner_t* owner, size_t pos) noexcept
+        : owner_{owner}, pos_{pos} {}
+    constexpr operator basic_iterator<true>() const noexcept
+    requires(!is_const)
+    {
+      return {owner_, pos_};
+    }
+
+    [[nodiscard]] constexpr reference operator*() const noexcept {
+      return owner_->slots_[pos_];
+    }
+    [[nodiscard]] constexpr pointer operator->() const noexcept {
+      return &owner_->slots_[pos_];
+    }
+
+    constexpr basic_iterator& operator++() noexcept {
+      pos_ = owner_->keys_.next(pos_ + 1);
+      return *this;
+    }
+    constexpr basic_iterator operator++(int) noexcept {
+      auto old = *this;
+      ++*this;
+      return old;
+    }
+
+    [[nodiscard]] friend constexpr bool
+    operator==(const basic_iterator& l, const basic_iterator& r) noexcept {
+      return l.pos_ == r.pos_;
+    }
+
+  private:
+    owner_t* owner_{};
+    size_t pos_{index::size};
+  };
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  constexpr enum_map() : slots_{make_slots()} {}
+  constexpr enum_map(std::initializer_list<value_type> values)
+      : enum_map{} {
+    for (const auto& [e, v] : values) insert_or_assign(e, v);
+  }
+  constexpr enum_map(const enum_map& other)
+      : slots_{make_slots()}, keys_{other.keys_} {
+    for (const auto& [e, v] : other) slots_[index::of(e)].second = v;
+  }
+  constexpr enum_map(enum_map&& other) noexcept(
+      std::is_nothrow_move_assignable_v<V> &&
+      std::is_nothrow_default_constructible_v<V>)
+      : slots_{make_slots()}, keys_{other.keys_} {
+    for (auto& [e, v] : other) slots_[index::of(e)].second = std::move(v);
+  }
+  constexpr enum_map& operator=(const enum_map& other) {
+    if (this == &other) return *this;
+    for (size_t i = 0; i < index::size; ++i)
+      slots_[i].second = other.keys_.test(i) ? other.slots_[i].second : V{};
+    keys_ = other.keys_;
+    return *this;
+  }
+  constexpr enum_map& operator=(enum_map&& other) noexcept(
+      std::is_nothrow_move_assignable_v<V> &&
+      std::is_nothrow_default_constructible_v<V>) {
+    if (this == &other) return *this;
+    for (size_t i = 0; i < index::size; ++i)
+      slots_[i].second =
+          other.keys_.test(i) ? std::move(other.slots_[i].second) : V{};
+    keys_ = other.keys_;
+    return *this;
+  }
+
+  // Iterators.
+  [[nodiscard]] constexpr iterator begin() noexcept {
+    return {this, keys_.next(0)};
+  }
+  [[nodiscard]] constexpr iterator end() noexcept {
+    return {this, index::size};
+  }
+  [[nodiscard]] constexpr const_iterator begin() const noexcept {
+    return {this, keys_.next(0)};
+  }
+  [[nodiscard]] constexpr const_iterator end() const noexcept {
+    return {this, index::size};
+  }
+  [[nodiscard]] constexpr const_iterator cbegin() const noexcept {
+    return begin();
+  }
+  [[nodiscard]] constexpr const_iterator cend() const noexcept {
+    return end();
+  }
+
+  // Accessors.
+  [[nodiscard]] constexpr size_t size() const noexcept { return keys_.size(); }
+  [[nodiscard]] constexpr bool empty() const noexcept { return keys_.empty(); }
+  [[nodiscard]] static constexpr size_t max_size() noexcept {
+    return index::size;
+  }
+
+  // Set of the keys present.
+  [[nodiscard]] constexpr const enum_set<E>& keys() const noexcept {
+    return keys_;
+  }
+
+  [[nodiscard]] constexpr bool contains(E e) const noexcept {
+    return keys_.contains(e);
+  }
+  [[nodiscard]] constexpr size_t count(E e) const noexcept {
+    return contains(e);
+  }
+
+  [[nodiscard]] constexpr iterator find(E e) noexcept {
+    return contains(e) ? iterator{this, index::of(e)} : end();
+  }
+  [[nodiscard]] constexpr const_iterator find(E e) const noexcept {
+    return contains(e) ? const_iterator{this, index::of(e)} : end();
+  }
+
+  [[nodiscard]] constexpr V& at(E e) {
+    if (!contains(e)) throw std::out_of_range("enum_map::at");
+    return slots_[index::of(e)].second;
+  }
+  [[nodiscard]] constexpr const V& at(E e) const {
+    if (!contains(e)) throw std::out_of_range("enum_map::at");
+    return slots_[index::of(e)].second;
+  }
+
+  // Value for `e`, adding `V{}` if it's not present.
+  [[nodiscard]] constexpr V& operator[](E e) {
+    keys_.insert(e);
+    return slots_[index::of(e)].second;
+  }
+
+  // Modifiers.
+
+  // Add `e` with a value constructed from `args`, unless it's present.
+  template<typename... Args>
+  constexpr std::pair<iterator, bool> try_emplace(E e, Args&&... args) {
+    const auto [it, inserted] = keys_.insert(e);
+    auto& slot = slots_[it.pos()];
+    if (inserted) slot.second = V(std::forward<Args>(args)...);
+    return {iterator{this, it.pos()}, inserted};
+  }
+
+  // Set the value for `e`, adding it if it's not present.
+  template<typename M>
+  constexpr std::pair<iterator, bool> insert_or_assign(E e, M&& value) {
+    const auto [it, inserted] = keys_.insert(e);
+    slots_[it.pos()].second = std::forward<M>(value);
+    return {iterator{this, it.pos()}, inserted};
+  }
+
+  constexpr size_t erase(E e) {
+    if (!keys_.erase(e)) return 0;
+    slots_[index::of(e)].second = V{};
+    return 1;
+  }
+
+  constexpr void clear() {
+    for (const auto e : keys_) slots_[index::of(e)].second = V{};
+    keys_.clear();
+  }
+
+  [[nodiscard]] friend constexpr bool
+  operator==(const enum_map& l, const enum_map& r) {
+    if (l.keys_ != r.keys_) return false;
+    for (const auto& [e, v] : l)
+      if (!(v == r.slots_[index::of(e)].second)) return false;
+    return true;
+  }
+
+private:
+  std::array<value_type, index::size> slots_;
+  enum_set<E> keys_;
+
+  [[nodiscard]] static constexpr auto make_slots() {
+    return []<size_t... is>(std::index_sequence<is...>) {
+      return std::array<value_type, index::size>{
+          value_type{index::values[is], V{}}...};
+    }(std::make_index_sequence<index::size>{});
+  }
+};
+
+}}} // namespace corvid::container::enum_indexed
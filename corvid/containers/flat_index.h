@@ -0,0 +1,420 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+
+namespace corvid { inline namespace container { inline namespace flat {
+
+namespace details {
+// Control-byte groups shared by the flat indexes.
+//
+// The control bytes are processed in groups of 8, where each byte is either
+// empty or holds 7 bits of the hash. A group is matched against those bits
+// all at once, by SWAR on a 64-bit word.
+struct flat_group {
+  static constexpr size_t width = 8;
+  static constexpr uint8_t empty_ctrl = 0x80;
+  static constexpr uint64_t empty_word = 0x8080808080808080ULL;
+  static constexpr uint64_t lsbs = 0x0101010101010101ULL;
+  static constexpr uint64_t msbs = 0x8080808080808080ULL;
+  static constexpr size_t min_capacity = 2 * width;
+  static constexpr size_t max_capacity = size_t{1} << 28;
+
+  // Mix the hash, since `std::hash` is the identity for integers, then keep
+  // the high half.
+  [[nodiscard]] static uint32_t fragment_of(size_t hash) noexcept {
+    return static_cast<uint32_t>(
+        (static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >> 32);
+  }
+
+  [[nodiscard]] static uint8_t h2_of(uint32_t fragment) noexcept {
+    return static_cast<uint8_t>(fragment & 0x7F);
+  }
+
+  [[nodiscard]] static size_t
+  first_group(uint32_t fragment, size_t group_mask) noexcept {
+    return (fragment >> 7) & group_mask;
+  }
+
+  // Returns a mask with the high bit of each byte of `word` that equals `h2`.
+  // May have false positives, but only in bytes above a true match, and
+  // these are filtered out by comparing the fragment.
+  [[nodiscard]] static uint64_t match(uint64_t word, uint8_t h2) noexcept {
+    const auto x = word ^ (lsbs * h2);
+    return (x - lsbs) & ~x & msbs;
+  }
+
+  // Returns a mask with the high bit of each empty byte of `word`.
+  [[nodiscard]] static uint64_t match_empty(uint64_t word) noexcept {
+    return word & msbs;
+  }
+
+  // Returns a mask with the high bit of each full byte of `word`.
+  [[nodiscard]] static uint64_t match_full(uint64_t word) noexcept {
+    return ~word & msbs;
+  }
+
+  // Convert the lowest set bit of a match mask into a byte index.
+  [[nodiscard]] static size_t byte_index(uint64_t m) noexcept {
+    const auto index = static_cast<size_t>(std::countr_zero(m)) / 8;
+    if constexpr (std::endian::native == std::endian::big)
+      return width - 1 - index;
+    else
+      return index;
+  }
+
+  // Returns `word` with the byte at `index` set to `ctrl`.
+  [[nodiscard]] static uint64_t
+  set_byte(uint64_t word, size_t index, uint8_t ctrl) noexcept {
+    if constexpr (std::endian::native == std::endian::big)
+      index = width - 1 - index;
+    const auto shift = index * 8;
+    return (word & ~(uint64_t{0xFF} << shift)) | (uint64_t{ctrl} << shift);
+  }
+
+  // Capacity needed to hold `count` entries under the 7/8 maximum load.
+  [[nodiscard]] static size_t capacity_for(size_t count) noexcept {
+    return std::bit_ceil(std::max((count * 8 + 6) / 7, min_capacity));
+  }
+
+  [[nodiscard]] static bool
+  needs_growth(size_t size, size_t capacity) noexcept {
+    return (size + 1) * 8 > capacity * 7;
+  }
+};
+} // namespace details
+
+// Open-addressing hash index from keys to IDs, where the keys are stored
+// elsewhere.
+//
+// Each slot holds just a 32-bit hash fragment and an ID. To find a key, the
+// caller supplies its hash and a predicate that resolves a candidate ID to its
+// key and compares. This lets the index sit alongside a table that already
+// stores the keys, such as the values of an `intern_table`, without
+// duplicating them.
+//
+// The layout follows SwissTable: a separate array of control bytes, processed
+// in groups of 8, where each byte is either empty or holds 7 bits of the hash.
+// A group is matched against those bits all at once, by SWAR on a 64-bit
+// word, so the predicate is usually only called for the right slot and a
+// lookup touches one group of control bytes and one slot. Groups are probed
+// quadratically. Erasure isn't supported, so there are no tombstones.
+//
+// IDs must be nonzero, since `ID{}` is returned to mean "not found". The
+// table is limited to 2^28 slots.
+template<typename ID, typename A = std::allocator<ID>>
+class flat_id_index {
+  using traits = std::allocator_traits<A>;
+  using group = details::flat_group;
+
+  struct slot {
+    uint32_t fragment;
+    ID id;
+  };
+
+  using byte_allocator = typename traits::template rebind_alloc<uint8_t>;
+  using slot_allocator = typename traits::template rebind_alloc<slot>;
+
+public:
+  using id_t = ID;
+  using allocator_type = A;
+
+  // Marks this as a flat index, for `intern_table`.
+  static constexpr bool is_flat_index = true;
+
+  flat_id_index() = default;
+  explicit flat_id_index(const A& alloc)
+      : ctrl_{byte_allocator{alloc}}, slots_{slot_allocator{alloc}} {}
+
+  [[nodiscard]] size_t size() const noexcept { return size_; }
+  [[nodiscard]] bool empty() const noexcept { return !size_; }
+  [[nodiscard]] size_t capacity() const noexcept { return slots_.size(); }
+
+  // Find the ID for the key whose hash is `hash` and for which `matches(id)`
+  // returns true. Returns `ID{}` if not found.
+  template<typename F>
+  [[nodiscard]] id_t find(size_t hash, F&& matches) const {
+    if (!size_) return id_t{};
+    const auto fragment = group::fragment_of(hash);
+    const auto group_mask = groups() - 1;
+    auto g = group::first_group(fragment, group_mask);
+    for (size_t step = 1;; ++step) {
+      const auto word = load_group(g);
+      for (auto m = group::match(word, group::h2_of(fragment)); m;
+           m &= m - 1)
+      {
+        const auto& s = slots_[g * group::width + group::byte_index(m)];
+        if (s.fragment == fragment && matches(s.id)) return s.id;
+      }
+      if (group::match_empty(word)) return id_t{};
+      g = (g + step) & group_mask;
+      // Since the table is never full, the loop must eventually reach a
+      // group with an empty slot.
+    }
+  }
+
+  // Insert `id` for a key whose hash is `hash`. The key must not already be
+  // in the index.
+  void insert(size_t hash, id_t id) {
+    if (group::needs_growth(size_, capacity()))
+      rehash(std::max(capacity() * 2, group::min_capacity));
+    place(group::fragment_of(hash), id);
+    ++size_;
+  }
+
+  // Ensure room for `count` entries without rehashing.
+  void reserve(size_t count) {
+    auto wanted = group::capacity_for(count);
+    if (wanted > capacity()) rehash(wanted);
+  }
+
+private:
+  std::vector<uint8_t, byte_allocator> ctrl_;
+  std::vector<slot, slot_allocator> slots_;
+  size_t size_{};
+
+  [[nodiscard]] size_t groups() const noexcept {
+    return slots_.size() / group::width;
+  }
+
+  [[nodiscard]] uint64_t load_group(size_t g) const noexcept {
+    uint64_t word;
+    std::memcpy(&word, ctrl_.data() + g * group::width, sizeof(word));
+    return word;
+  }
+
+  void place(uint32_t fragment, id_t id) noexcept {
+    const auto group_mask = groups() - 1;
+    auto g = group::first_group(fragment, group_mask);
+    for (size_t step = 1;; ++step) {
+      if (const auto empties = group::match_empty(load_group(g))) {
+        const auto index = g * group::width + group::byte_index(empties);
+        ctrl_[index] = group::h2_of(fragment);
+        slots_[index] = slot{fragment, id};
+        return;
+      }
+      g = (g + step) & group_mask;
+    }
+  }
+
+  void rehash(size_t new_capacity) {
+    assert(new_capacity <= group::max_capacity);
+    auto old_ctrl = std::move(ctrl_);
+    auto old_slots = std::move(slots_);
+    ctrl_ = decltype(ctrl_)(new_capacity, group::empty_ctrl,
+        old_ctrl.get_allocator());
+    slots_ = decltype(slots_)(new_capacity, old_slots.get_allocator());
+    for (size_t i = 0; i < old_ctrl.size(); ++i)
+      if (!(old_ctrl[i] & group::empty_ctrl))
+        place(old_slots[i].fragment, old_slots[i].id);
+  }
+};
+
+// Concurrent version of `flat_id_index`, where `find` is lock-free and may
+// run in any number of threads, while calls to `insert` and `reserve` are
+// serialized by the caller.
+//
+// Each control group is an atomic word, and an insertion writes the slot
+// before it publishes the control byte, so a reader that sees the byte also
+// sees the slot. Growth builds a whole new table and then publishes it with
+// a single pointer swap. Readers that already loaded the old table keep
+// probing it safely, since it's never written to again. The retired tables
+// are only freed when the index is destroyed, which costs at most as much
+// memory as the current one, because each is at most half the size of the
+// next. This avoids the need for epochs or hazard pointers, and suits an
+// index that only ever grows.
+//
+// As with `flat_id_index`, IDs must be nonzero.
+template<typename ID, typename A = std::allocator<ID>>
+class concurrent_flat_id_index {
+  using traits = std::allocator_traits<A>;
+  using group = details::flat_group;
+
+  struct slot {
+    uint32_t fragment;
+    ID id;
+  };
+
+  struct table {
+    size_t capacity;
+    std::atomic<uint64_t>* ctrl;
+    slot* slots;
+    table* retired;
+  };
+
+  using word_allocator =
+      typename traits::template rebind_alloc<std::atomic<uint64_t>>;
+  using slot_allocator = typename traits::template rebind_alloc<slot>;
+  using table_allocator = typename traits::template rebind_alloc<table>;
+
+public:
+  using id_t = ID;
+  using allocator_type = A;
+
+  // Marks this as a flat index, for `intern_table`.
+  static constexpr bool is_flat_index = true;
+
+  // Marks this as safe to `find` without a lock, for `intern_table`.
+  static constexpr bool is_concurrent = true;
+
+  concurrent_flat_id_index() = default;
+  explicit concurrent_flat_id_index(const A& alloc) : alloc_{alloc} {}
+
+  concurrent_flat_id_index(const concurrent_flat_id_index&) = delete;
+  concurrent_flat_id_index&
+  operator=(const concurrent_flat_id_index&) = delete;
+
+  ~concurrent_flat_id_index() {
+    for (auto t = table_.load(std::memory_order::relaxed); t;)
+      t = free_table(t);
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    return size_.load(std::memory_order::relaxed);
+  }
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+  [[nodiscard]] size_t capacity() const noexcept {
+    const auto t = table_.load(std::memory_order::acquire);
+    return t ? t->capacity : 0;
+  }
+
+  // Find the ID for the key whose hash is `hash` and for which `matches(id)`
+  // returns true. Returns `ID{}` if not found. Lock-free.
+  template<typename F>
+  [[nodiscard]] id_t find(size_t hash, F&& matches) const {
+    const auto t = table_.load(std::memory_order::acquire);
+    if (!t) return id_t{};
+    const auto fragment = group::fragment_of(hash);
+    const auto group_mask = t->capacity / group::width - 1;
+    auto g = group::first_group(fragment, group_mask);
+    for (size_t step = 1;; ++step) {
+      const auto word = t->ctrl[g].load(std::memory_order::acquire);
+      for (auto m = group::match(word, group::h2_of(fragment)); m;
+           m &= m - 1)
+      {
+        const auto& s = t->slots[g * group::width + group::byte_index(m)];
+        if (s.fragment == fragment && matches(s.id)) return s.id;
+      }
+      if (group::match_empty(word)) return id_t{};
+      g = (g + step) & group_mask;
+    }
+  }
+
+  // Insert `id` for a key whose hash is `hash`. The key must not already be
+  // in the index. Calls must be serialized.
+  void insert(size_t hash, id_t id) {
+    const auto n = size();
+    if (group::needs_growth(n, capacity()))
+      rehash(std::max(capacity() * 2, group::min_capacity));
+    place(*table_.load(std::memory_order::relaxed), group::fragment_of(hash),
+        id);
+    size_.store(n + 1, std::memory_order::relaxed);
+  }
+
+  // Ensure room for `count` entries without rehashing. Calls must be
+  // serialized with `insert`.
+  void reserve(size_t count) {
+    auto wanted = group::capacity_for(count);
+    if (wanted > capacity()) rehash(wanted);
+  }
+
+private:
+  [[no_unique_address]] A alloc_;
+  std::atomic<table*> table_{};
+  std::atomic<size_t> size_{};
+
+  // Only the writer calls this, so there's no race on the slot, and the
+  // release store publishes it along with the control byte.
+  static void place(table& t, uint32_t fragment, id_t id) noexcept {
+    const auto group_mask = t.capacity / group::width - 1;
+    auto g = group::first_group(fragment, group_mask);
+    for (size_t step = 1;; ++step) {
+      const auto word = t.ctrl[g].load(std::memory_order::relaxed);
+      if (const auto empties = group::match_empty(word)) {
+        const auto byte = group::byte_index(empties);
+        t.slots[g * group::width + byte] = slot{fragment, id};
+        t.ctrl[g].store(group::set_byte(word, byte, group::h2_of(fragment)),
+            std::memory_order::release);
+        return;
+      }
+      g = (g + step) & group_mask;
+    }
+  }
+
+  void rehash(size_t new_capacity) {
+    assert(new_capacity <= group::max_capacity);
+    const auto old_table = table_.load(std::memory_order::relaxed);
+    auto& t = *make_table(new_capacity, old_table);
+    if (old_table) {
+      for (size_t g = 0; g < old_table->capacity / group::width; ++g) {
+        const auto word = old_table->ctrl[g].load(std::memory_order::relaxed);
+        for (auto m = group::match_full(word); m; m &= m - 1) {
+          const auto& s =
+              old_table->slots[g * group::width + group::byte_index(m)];
+          place(t, s.fragment, s.id);
+        }
+      }
+    }
+    table_.store(&t, std::memory_order::release);
+  }
+
+  [[nodiscard]] table* make_table(size_t capacity, table* retired) {
+    word_allocator word_alloc{alloc_};
+    slot_allocator slot_alloc{alloc_};
+    table_allocator table_alloc{alloc_};
+    auto t = std::allocator_traits<table_allocator>::allocate(table_alloc, 1);
+    new (t) table{capacity, nullptr, nullptr, retired};
+    try {
+      const auto groups = capacity / group::width;
+      t->ctrl =
+          std::allocator_traits<word_allocator>::allocate(word_alloc, groups);
+      for (size_t g = 0; g < groups; ++g)
+        new (&t->ctrl[g]) std::atomic<uint64_t>{group::empty_word};
+      t->slots = std::allocator_traits<slot_allocator>::allocate(slot_alloc,
+          capacity);
+      for (size_t i = 0; i < capacity; ++i) new (&t->slots[i]) slot{};
+    }
+    catch (...) {
+      free_table(t);
+      throw;
+    }
+    return t;
+  }
+
+  // Free `t`, returning the table it retired.
+  table* free_table(table* t) noexcept {
+    word_allocator word_alloc{alloc_};
+    slot_allocator slot_alloc{alloc_};
+    table_allocator table_alloc{alloc_};
+    const auto retired = t->retired;
+    if (t->ctrl)
+      std::allocator_traits<word_allocator>::deallocate(word_alloc, t->ctrl,
+          t->capacity / group::width);
+    if (t->slots)
+      std::allocator_traits<slot_allocator>::deallocate(slot_alloc, t->slots,
+          t->capacity);
+    std::allocator_traits<table_allocator>::deallocate(table_alloc, t, 1);
+    return retired;
+  }
+};
+
+}}} // namespace corvid::container::flat
@@ -0,0 +1,670 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+#include "flat_index.h"
+#include "transparent.h"
+
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace corvid { inline namespace container { inline namespace flat {
+
+namespace details {
+// First eight bytes of `s`, big-endian and zero-padded, so that comparing
+// the prefixes of two strings agrees with comparing the strings, except when
+// the prefixes tie.
+[[nodiscard]] constexpr uint64_t key_prefix(std::string_view s) noexcept {
+  uint64_t prefix{};
+  const auto n = std::min<size_t>(s.size(), 8);
+  for (size_t i = 0; i < n; ++i)
+    prefix |= uint64_t{static_cast<uint8_t>(s[i])} << (56 - i * 8);
+  return prefix;
+}
+
+// Index of the first key not less than `key`, where the keys are sorted and
+// `prefixes` holds their `key_prefix`. The binary search runs over the
+// prefixes, which are contiguous, and only calls `key_at` to compare the full
+// string when the prefix ties.
+template<typename F>
+[[nodiscard]] size_t prefix_lower_bound(const std::vector<uint64_t>& prefixes,
+    uint64_t prefix, std::string_view key, F&& key_at) noexcept {
+  size_t first = 0;
+  for (size_t count = prefixes.size(); count;) {
+    const auto half = count / 2;
+    const auto mid = first + half;
+    const auto p = prefixes[mid];
+    if (p < prefix || (p == prefix && std::string_view{key_at(mid)} < key)) {
+      first = mid + 1;
+      count -= half + 1;
+    } else
+      count = half;
+  }
+  return first;
+}
+
+// Make room for one more prefix, so that inserting it after the entry can't
+// throw. Grows geometrically, rather than by one, to keep insertion
+// amortized.
+inline void reserve_one_more(std::vector<uint64_t>& prefixes) {
+  if (prefixes.size() == prefixes.capacity())
+    prefixes.reserve(std::max<size_t>(8, prefixes.size() * 2));
+}
+
+} // namespace details
+
+// Sorted, contiguous map keyed by `std::string`, with transparent search.
+//
+// Intended as a read-mostly alternative to `string_map`. The entries are
+// kept sorted in a single vector, next to a parallel vector of the first
+// eight bytes of each key, packed into a `uint64_t`. A lookup binary-searches
+// the packed prefixes, so it usually compares integers in one cache-dense
+// array and only touches a key when the prefixes tie. There's one allocation
+// per key that doesn't fit in the small-string buffer, instead of one per
+// node.
+//
+// Insertion and erasure move the entries after them, so they're linear, and
+// they invalidate iterators and references. For loading many entries, prefer
+// the range constructor or the range `insert`, which sort once.
+//
+// Iterators yield `std::pair<std::string, V>`. The key must not be modified
+// through them.
+template<typename V = std::string>
+class flat_string_map {
+public:
+  using key_type = std::string;
+  using mapped_type = V;
+  using value_type = std::pair<std::string, V>;
+  using container_type = std::vector<value_type>;
+  using size_type = size_t;
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+
+  flat_string_map() = default;
+
+  // Construct from entries in any order. When keys repeat, the first wins.
+  template<typename I>
+  flat_string_map(I first, I last) : entries_(first, last) {
+    normalize(0);
+  }
+  flat_string_map(std::initializer_list<value_type> init)
+      : flat_string_map(init.begin(), init.end()) {}
+
+  // Accessors.
+  [[nodiscard]] size_t size() const noexcept { return entries_.size(); }
+  [[nodiscard]] bool empty() const noexcept { return entries_.empty(); }
+  [[nodiscard]] size_t capacity() const noexcept {
+    return entries_.capacity();
+  }
+
+  // Iterators.
+  [[nodiscard]] iterator begin() noexcept { return entries_.begin(); }
+  [[nodiscard]] iterator end() noexcept { return entries_.end(); }
+  [[nodiscard]] const_iterator begin() const noexcept {
+    return entries_.begin();
+  }
+  [[nodiscard]] const_iterator end() const noexcept { return entries_.end(); }
+  [[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
+  [[nodiscard]] const_iterator cend() const noexcept { return end(); }
+
+  // Lookup.
+  [[nodiscard]] iterator find(std::string_view key) noexcept {
+    return begin() + find_index(key);
+  }
+  [[nodiscard]] const_iterator find(std::string_view key) const noexcept {
+    return begin() + find_index(key);
+  }
+  [[nodiscard]] bool contains(std::string_view key) const noexcept {
+    return find_index(key) != size();
+  }
+  [[nodiscard]] size_t count(std::string_view key) const noexcept {
+    return contains(key);
+  }
+
+  // First entry whose key isn't less than `key`.
+  [[nodiscard]] iterator lower_bound(std::string_view key) noexcept {
+    return begin() + lower_bound_index(details::key_prefix(key), key);
+  }
+  [[nodiscard]] const_iterator
+  lower_bound(std::string_view key) const noexcept {
+    return begin() + lower_bound_index(details::key_prefix(key), key);
+  }
+
+  // Value for `key`. Throws `std::out_of_range` if not found.
+  [[nodiscard]] V& at(std::string_view key) {
+    const auto index = find_index(key);
+    if (index == size()) throw std::out_of_range("flat_string_map::at");
+    return entries_[index].second;
+  }
+  [[nodiscard]] const V& at(std::string_view key) const {
+    const auto index = find_index(key);
+    if (index == size()) throw std::out_of_range("flat_string_map::at");
+    return entries_[index].second;
+  }
+
+  // Value for `key`, inserting a default one if not found. Unlike
+  // `string_map`, this is transparent: the key is only copied into a
+  // `std::string` when it's inserted.
+  template<StringViewConvertible K>
+  V& operator[](K&& key) {
+    return try_emplace(std::forward<K>(key)).first->second;
+  }
+
+  // Modifiers.
+
+  // Insert a value constructed from `args` unless `key` is already present.
+  // Returns the entry for `key` and whether it was inserted.
+  template<StringViewConvertible K, typename... Args>
+  std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+    const std::string_view sv{key};
+    const auto prefix = details::key_prefix(sv);
+    const auto index = lower_bound_index(prefix, sv);
+    if (index != size() && prefixes_[index] == prefix &&
+        entries_[index].first == sv)
+      return {begin() + index, false};
+    details::reserve_one_more(prefixes_);
+    const auto it = entries_.emplace(begin() + index,
+        std::piecewise_construct,
+        std::forward_as_tuple(std::string(std::forward<K>(key))),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    prefixes_.insert(prefixes_.begin() + index, prefix);
+    return {it, true};
+  }
+
+  // Insert `value` for `key`, or assign it if `key` is already present.
+  template<StringViewConvertible K, typename U>
+  std::pair<iterator, bool> insert_or_assign(K&& key, U&& value) {
+    auto result = try_emplace(std::forward<K>(key), std::forward<U>(value));
+    if (!result.second) result.first->second = std::forward<U>(value);
+    return result;
+  }
+
+  std::pair<iterator, bool> insert(value_type value) {
+    return try_emplace(std::move(value.first), std::move(value.second));
+  }
+
+  // Insert entries in any order, sorting once. Keys that are already present,
+  // or that repeat, keep their first value.
+  template<typename I>
+  void insert(I first, I last) {
+    const auto old_size = size();
+    entries_.insert(end(), first, last);
+    normalize(old_size);
+  }
+
+  // Erase the entry for `key`, returning the number erased.
+  size_t erase(std::string_view key) {
+    const auto index = find_index(key);
+    if (index == size()) return 0;
+    erase(begin() + index);
+    return 1;
+  }
+  iterator erase(const_iterator pos) {
+    const auto index = pos - cbegin();
+    prefixes_.erase(prefixes_.begin() + index);
+    return entries_.erase(pos);
+  }
+
+  void clear() noexcept {
+    entries_.clear();
+    prefixes_.clear();
+  }
+
+  void reserve(size_t count) {
+    entries_.reserve(count);
+    prefixes_.reserve(count);
+  }
+
+  [[nodiscard]] friend bool
+  operator==(const flat_string_map& l, const flat_string_map& r) {
+    return l.entries_ == r.entries_;
+  }
+
+private:
+  container_type entries_;
+  std::vector<uint64_t> prefixes_;
+
+  [[nodiscard]] size_t
+  lower_bound_index(uint64_t prefix, std::string_view key) const noexcept {
+    return details::prefix_lower_bound(prefixes_, prefix, key,
+        [this](size_t i) -> const std::string& { return entries_[i].first; });
+  }
+
+  // Index of the entry for `key`, or `size()`.
+  [[nodiscard]] size_t find_index(std::string_view key) const noexcept {
+    const auto prefix = details::key_prefix(key);
+    const auto index = lower_bound_index(prefix, key);
+    if (index != size() && prefixes_[index] == prefix &&
+        entries_[index].first == key)
+      return index;
+    return size();
+  }
+
+  // Sort the entries from `sorted` on and merge them into the ones before,
+  // which are already sorted, dropping repeated keys after the first. Then
+  // rebuild the prefixes.
+  void normalize(size_t sorted) {
+    const auto by_key = [](const value_type& l, const value_type& r) {
+      return l.first < r.first;
+    };
+    const auto middle = begin() + sorted;
+    std::stable_sort(middle, end(), by_key);
+    std::inplace_merge(begin(), middle, end(), by_key);
+    entries_.erase(std::unique(begin(), end(),
+                       [](const value_type& l, const value_type& r) {
+                         return l.first == r.first;
+                       }),
+        end());
+    prefixes_.clear();
+    prefixes_.reserve(entries_.capacity());
+    for (const auto& entry : entries_)
+      prefixes_.push_back(details::key_prefix(entry.first));
+  }
+};
+
+// Sorted, contiguous set of `std::string`, with transparent search.
+//
+// The set counterpart of `flat_string_map`, with the same prefix-accelerated
+// binary search and the same linear cost of insertion and erasure.
+class flat_string_set {
+public:
+  using key_type = std::string;
+  using value_type = std::string;
+  using container_type = std::vector<std::string>;
+  using size_type = size_t;
+  using iterator = container_type::const_iterator;
+  using const_iterator = container_type::const_iterator;
+
+  flat_string_set() = default;
+
+  // Construct from keys in any order, dropping repeats.
+  template<typename I>
+  flat_string_set(I first, I last) : keys_(first, last) {
+    normalize(0);
+  }
+  flat_string_set(std::initializer_list<std::string> init)
+      : flat_string_set(init.begin(), init.end()) {}
+
+  // Accessors.
+  [[nodiscard]] size_t size() const noexcept { return keys_.size(); }
+  [[nodiscard]] bool empty() const noexcept { return keys_.empty(); }
+
+  // Iterators.
+  [[nodiscard]] const_iterator begin() const noexcept {
+    return keys_.begin();
+  }
+  [[nodiscard]] const_iterator end() const noexcept { return keys_.end(); }
+  [[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
+  [[nodiscard]] const_iterator cend() const noexcept { return end(); }
+
+  // Lookup.
+  [[nodiscard]] const_iterator find(std::string_view key) const noexcept {
+    return begin() + find_index(key);
+  }
+  [[nodiscard]] bool contains(std::string_view key) const noexcept {
+    return find_index(key) != size();
+  }
+  [[nodiscard]] size_t count(std::string_view key) const noexcept {
+    return contains(key);
+  }
+  [[nodiscard]] const_iterator
+  lower_bound(std::string_view key) const noexcept {
+    return begin() + lower_bound_index(details::key_prefix(key), key);
+  }
+
+  // Modifiers.
+
+  // Insert `key` unless already present. Returns its position and whether it
+  // was inserted.
+  template<StringViewConvertible K>
+  std::pair<const_iterator, bool> insert(K&& key) {
+    const std::string_view sv{key};
+    const auto prefix = details::key_prefix(sv);
+    const auto index = lower_bound_index(prefix, sv);
+    if (index != size() && prefixes_[index] == prefix && keys_[index] == sv)
+      return {begin() + index, false};
+    details::reserve_one_more(prefixes_);
+    const auto it =
+        keys_.emplace(keys_.begin() + index, std::forward<K>(key));
+    prefixes_.insert(prefixes_.begin() + index, prefix);
+    return {it, true};
+  }
+
+  // Insert keys in any order, sorting once.
+  template<typename I>
+  void insert(I first, I last) {
+    const auto old_size = size();
+    keys_.insert(keys_.end(), first, last);
+    normalize(old_size);
+  }
+
+  // Erase `key`, returning the number erased.
+  size_t erase(std::string_view key) {
+    const auto index = find_index(key);
+    if (index == size()) return 0;
+    erase(begin() + index);
+    return 1;
+  }
+  const_iterator erase(const_iterator pos) {
+    prefixes_.erase(prefixes_.begin() + (pos - begin()));
+    return keys_.erase(pos);
+  }
+
+  void clear() noexcept {
+    keys_.clear();
+    prefixes_.clear();
+  }
+
+  void reserve(size_t count) {
+    keys_.reserve(count);
+    prefixes_.reserve(count);
+  }
+
+  [[nodiscard]] friend bool
+  operator==(const flat_string_set& l, const flat_string_set& r) {
+    return l.keys_ == r.keys_;
+  }
+
+private:
+  container_type keys_;
+  std::vector<uint64_t> prefixes_;
+
+  [[nodiscard]] size_t
+  lower_bound_index(uint64_t prefix, std::string_view key) const noexcept {
+    return details::prefix_lower_bound(prefixes_, prefix, key,
+        [this](size_t i) -> const std::string& { return keys_[i]; });
+  }
+
+  [[nodiscard]] size_t find_index(std::string_view key) const noexcept {
+    const auto prefix = details::key_prefix(key);
+    const auto index = lower_bound_index(prefix, key);
+    if (index != size() && prefixes_[index] == prefix && keys_[index] == key)
+      return index;
+    return size();
+  }
+
+  void normalize(size_t sorted) {
+    const auto middle = keys_.begin() + sorted;
+    std::sort(middle, keys_.end());
+    std::inplace_merge(keys_.begin(), middle, keys_.end());
+    keys_.erase(std::unique(keys_.begin(), keys_.end()), keys_.end());
+    prefixes_.clear();
+    prefixes_.reserve(keys_.capacity());
+    for (const auto& key : keys_)
+      prefixes_.push_back(details::key_prefix(key));
+  }
+};
+
+// Open-addressing hash map keyed by `std::string`, with transparent search.
+//
+// An alternative to `string_unordered_map` that avoids a node per entry. The
+// entries live in a dense vector, in insertion order, and a separate table
+// of slots maps a 32-bit hash fragment to the index of an entry. The slots
+// are probed linearly, so a lookup usually reads one or two adjacent slots
+// and then compares a single key. `H` is both the hash and the equality, as
+// with `transparent_hash_equal_stringlike`, which is the default, or
+// `transparent_ihash_equal_stringlike`.
+//
+// Erasure shifts later slots back instead of leaving tombstones, and moves
+// the last entry into the hole, so it's constant time but changes the
+// iteration order. Insertion may reallocate the entries, and erasure moves
+// one, so both invalidate iterators and references.
+//
+// Iterators yield `std::pair<std::string, V>`. The key must not be modified
+// through them. The table is limited to 2^31 entries.
+template<typename V = std::string,
+    typename H = transparent_hash_equal_stringlike>
+class string_hash_map {
+  struct slot {
+    uint32_t fragment{};
+    // One more than the index of the entry, so that zero means empty.
+    uint32_t id{};
+  };
+
+  static constexpr size_t min_capacity = 16;
+
+public:
+  using key_type = std::string;
+  using mapped_type = V;
+  using value_type = std::pair<std::string, V>;
+  using container_type = std::vector<value_type>;
+  using size_type = size_t;
+  using hasher = H;
+  using key_equal = H;
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+
+  string_hash_map() = default;
+
+  // Construct from entries. When keys repeat, the first wins.
+  template<typename I>
+  string_hash_map(I first, I last) {
+    for (; first != last; ++first) insert(*first);
+  }
+  string_hash_map(std::initializer_list<value_type> init)
+      : string_hash_map(init.begin(), init.end()) {}
+
+  // Accessors.
+  [[nodiscard]] size_t size() const noexcept { return entries_.size(); }
+  [[nodiscard]] bool empty() const noexcept { return entries_.empty(); }
+  [[nodiscard]] size_t capacity() const noexcept { return slots_.size(); }
+
+  // Iterators.
+  [[nodiscard]] iterator begin() noexcept { return entries_.begin(); }
+  [[nodiscard]] iterator end() noexcept { return entries_.end(); }
+  [[nodiscard]] const_iterator begin() const noexcept {
+    return entries_.begin();
+  }
+  [[nodiscard]] const_iterator end() const noexcept { return entries_.end(); }
+  [[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
+  [[nodiscard]] const_iterator cend() const noexcept { return end(); }
+
+  // Lookup.
+  [[nodiscard]] iterator find(std::string_view key) {
+    return begin() + find_index(key);
+  }
+  [[nodiscard]] const_iterator find(std::string_view key) const {
+    return begin() + find_index(key);
+  }
+  [[nodiscard]] bool contains(std::string_view key) const {
+    return find_index(key) != size();
+  }
+  [[nodiscard]] size_t count(std::string_view key) const {
+    return contains(key);
+  }
+
+  // Value for `key`. Throws `std::out_of_range` if not found.
+  [[nodiscard]] V& at(std::string_view key) {
+    const auto index = find_index(key);
+    if (index == size()) throw std::out_of_range("string_hash_map::at");
+    return entries_[index].second;
+  }
+  [[nodiscard]] const V& at(std::string_view key) const {
+    const auto index = find_index(key);
+    if (index == size()) throw std::out_of_range("string_hash_map::at");
+    return entries_[index].second;
+  }
+
+  // Value for `key`, inserting a default one if not found. The key is only
+  // copied into a `std::string` when it's inserted.
+  template<StringViewConvertible K>
+  V& operator[](K&& key) {
+    return try_emplace(std::forward<K>(key)).first->second;
+  }
+
+  // Modifiers.
+
+  // Insert a value constructed from `args` unless `key` is already present.
+  // Returns the entry for `key` and whether it was inserted.
+  template<StringViewConvertible K, typename... Args>
+  std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+    const std::string_view sv{key};
+    const auto fragment = fragment_of(sv);
+    if (const auto s = find_slot(sv, fragment); s != npos)
+      return {begin() + (slots_[s].id - 1), false};
+    if (needs_growth()) rehash(std::max(capacity() * 2, min_capacity));
+    entries_.emplace_back(std::piecewise_construct,
+        std::forward_as_tuple(std::string(std::forward<K>(key))),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    place(fragment, static_cast<uint32_t>(size()));
+    return {end() - 1, true};
+  }
+
+  // Insert `value` for `key`, or assign it if `key` is already present.
+  template<StringViewConvertible K, typename U>
+  std::pair<iterator, bool> insert_or_assign(K&& key, U&& value) {
+    auto result = try_emplace(std::forward<K>(key), std::forward<U>(value));
+    if (!result.second) result.first->second = std::forward<U>(value);
+    return result;
+  }
+
+  std::pair<iterator, bool> insert(value_type value) {
+    return try_emplace(std::move(value.first), std::move(value.second));
+  }
+
+  // Erase the entry for `key`, returning the number erased.
+  size_t erase(std::string_view key) {
+    const auto s = find_slot(key, fragment_of(key));
+    if (s == npos) return 0;
+    erase_slot(s);
+    return 1;
+  }
+
+  // Erase the entry at `pos`. Returns an iterator to the same position,
+  // which now holds the entry that was last, if any.
+  iterator erase(const_iterator pos) {
+    const auto index = pos - cbegin();
+    erase_slot(find_slot(pos->first, fragment_of(pos->first)));
+    return begin() + index;
+  }
+
+  void clear() noexcept {
+    entries_.clear();
+    std::fill(slots_.begin(), slots_.end(), slot{});
+  }
+
+  // Ensure room for `count` entries without rehashing.
+  void reserve(size_t count) {
+    entries_.reserve(count);
+    const auto wanted =
+        std::bit_ceil(std::max((count * 4 + 2) / 3, min_capacity));
+    if (wanted > capacity()) rehash(wanted);
+  }
+
+  // Equal when they hold the same entries, in any order.
+  [[nodiscard]] friend bool
+  operator==(const string_hash_map& l, const string_hash_map& r) {
+    if (l.size() != r.size()) return false;
+    for (const auto& [key, value] : l.entries_) {
+      const auto index = r.find_index(key);
+      if (index == r.size() || !(r.entries_[index].second == value))
+        return false;
+    }
+    return true;
+  }
+
+private:
+  static constexpr size_t npos = -1;
+
+  container_type entries_;
+  std::vector<slot> slots_;
+
+  [[nodiscard]] static uint32_t fragment_of(std::string_view key) {
+    return details::flat_group::fragment_of(H{}(key));
+  }
+
+  [[nodiscard]] size_t mask() const noexcept { return slots_.size() - 1; }
+
+  // Grow at 3/4 load, since linear probing degrades quickly past that.
+  [[nodiscard]] bool needs_growth() const noexcept {
+    return (size() + 1) * 4 > capacity() * 3;
+  }
+
+  // Index of the slot for `key`, or `npos`.
+  [[nodiscard]] size_t
+  find_slot(std::string_view key, uint32_t fragment) const {
+    if (slots_.empty()) return npos;
+    for (auto s = fragment & mask();; s = (s + 1) & mask()) {
+      const auto& candidate = slots_[s];
+      if (!candidate.id) return npos;
+      if (candidate.fragment == fragment &&
+          H{}(std::string_view{entries_[candidate.id - 1].first}, key))
+        return s;
+    }
+  }
+
+  // Index of the entry for `key`, or `size()`.
+  [[nodiscard]] size_t find_index(std::string_view key) const {
+    const auto s = find_slot(key, fragment_of(key));
+    return s == npos ? size() : slots_[s].id - 1;
+  }
+
+  void place(uint32_t fragment, uint32_t id) noexcept {
+    auto s = fragment & mask();
+    while (slots_[s].id) s = (s + 1) & mask();
+    slots_[s] = {fragment, id};
+  }
+
+  // Empty slot `s`, shifting back any later slots in the same run that may
+  // move, and then fill the hole its entry leaves with the last entry.
+  void erase_slot(size_t s) {
+    const auto index = slots_[s].id - 1;
+    auto hole = s;
+    for (auto next = (s + 1) & mask(); slots_[next].id;
+         next = (next + 1) & mask())
+    {
+      // A slot may move back into the hole unless its home lies after the
+      // hole, within the run.
+      const auto home = slots_[next].fragment & mask();
+      if (((next - home) & mask()) >= ((next - hole) & mask())) {
+        slots_[hole] = slots_[next];
+        hole = next;
+      }
+    }
+    slots_[hole] = {};
+
+    const auto last = size() - 1;
+    if (index != last) {
+      auto moved = fragment_of(entries_.back().first) & mask();
+      while (slots_[moved].id != last + 1) moved = (moved + 1) & mask();
+      slots_[moved].id = static_cast<uint32_t>(index + 1);
+      entries_[index] = std::move(entries_.back());
+    }
+    entries_.pop_back();
+  }
+
+  void rehash(size_t new_capacity) {
+    assert(new_capacity <= (size_t{1} << 31));
+    auto old_slots = std::move(slots_);
+    slots_.assign(new_capacity, slot{});
+    for (const auto& s : old_slots)
+      if (s.id) place(s.fragment, s.id);
+  }
+};
+
+// Open-addressing hash map keyed by `std::string`, ignoring ASCII case, with
+// transparent search.
+template<typename V = std::string>
+using istring_hash_map =
+    string_hash_map<V, transparent_ihash_equal_stringlike>;
+
+}}} // namespace corvid::container::flat
@@ -0,0 +1,148 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+
+namespace corvid { inline namespace container { namespace pool {
+
+// Free list of fixed-size blocks, for recycling the nodes of a node-based
+// container.
+//
+// The block size and alignment are set by the first allocation. After that,
+// allocations of exactly that size and alignment are served from the free
+// list, and their deallocations return to it, while any others pass through
+// to the heap. In a node-based container such as `std::map`, the nodes are
+// what match, so once the container reaches its peak size, inserting and
+// erasing no longer allocate. Blocks are only returned to the heap when the
+// free list is destroyed.
+//
+// Not thread-safe, and neither copyable nor movable, since allocators refer
+// to it by address.
+class free_list {
+  struct node {
+    node* next_;
+  };
+
+public:
+  free_list() noexcept = default;
+  free_list(const free_list&) = delete;
+  free_list& operator=(const free_list&) = delete;
+
+  ~free_list() {
+    while (head_) ::operator delete(pop(), block_size_, block_align_);
+  }
+
+  [[nodiscard]] void* allocate(size_t size, size_t align) {
+    if (!request_size_) {
+      request_size_ = size;
+      request_align_ = align;
+      block_size_ = std::max(size, sizeof(node));
+      block_align_ = std::align_val_t{std::max(align, alignof(node))};
+    }
+    if (!is_block(size, align))
+      return ::operator new(size, std::align_val_t{align});
+    if (head_) return pop();
+    return ::operator new(block_size_, block_align_);
+  }
+
+  void deallocate(void* p, size_t size, size_t align) noexcept {
+    if (!is_block(size, align)) {
+      ::operator delete(p, size, std::align_val_t{align});
+      return;
+    }
+    head_ = new (p) node{head_};
+    ++free_count_;
+  }
+
+  // Ensure that at least `count` blocks are on the free list. Requires the
+  // block size to have been set, either by an allocation or by an earlier
+  // call to `reserve` with `size` and `align`.
+  void reserve(size_t count, size_t size = 0, size_t align = 0) {
+    if (!request_size_) {
+      if (!size) return;
+      deallocate(allocate(size, align), size, align);
+    }
+    while (free_count_ < count) {
+      head_ = new (::operator new(block_size_, block_align_)) node{head_};
+      ++free_count_;
+    }
+  }
+
+  // Number of blocks currently on the free list.
+  [[nodiscard]] size_t free_count() const noexcept { return free_count_; }
+
+private:
+  node* head_{};
+  size_t free_count_{};
+  size_t request_size_{};
+  size_t request_align_{};
+  size_t block_size_{};
+  std::align_val_t block_align_{};
+
+  [[nodiscard]] bool is_block(size_t size, size_t align) const noexcept {
+    return size == request_size_ && align == request_align_;
+  }
+
+  [[nodiscard]] void* pop() noexcept {
+    auto p = std::exchange(head_, head_->next_);
+    --free_count_;
+    return p;
+  }
+};
+
+// Allocator that recycles blocks through a `free_list`. Copies, including
+// rebound ones, share the same `free_list`, which must outlive them.
+template<typename T>
+class free_list_allocator {
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  explicit free_list_allocator(free_list& pool) noexcept : pool_{&pool} {}
+  free_list_allocator(const free_list_allocator&) noexcept = default;
+  template<typename U>
+  free_list_allocator(const free_list_allocator<U>& other) noexcept
+      : pool_{other.pool_} {}
+
+  [[nodiscard]] T* allocate(std::size_t n) {
+    return static_cast<T*>(pool_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    pool_->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  [[nodiscard]] free_list& pool() const noexcept { return *pool_; }
+
+  template<typename U>
+  friend bool operator==(const free_list_allocator& l,
+      const free_list_allocator<U>& r) noexcept {
+    return l.pool_ == r.pool_;
+  }
+
+private:
+  template<typename U>
+  friend class free_list_allocator;
+
+  free_list* pool_;
+};
+
+}}} // namespace corvid::container::pool
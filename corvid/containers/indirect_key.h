@@ -1,6 +1,8 @@
 #pragma once
 #include <unordered_map>
 
+#include "transparent.h"
+
 namespace corvid { inline namespace container { inline namespace indirect_key {
 
 // Indirect keys are similar to std::reference_wrapper, but are designed to be
@@ -10,9 +12,27 @@ namespace corvid { inline namespace container { inline namespace indirect_key {
 // guarantees that the value will not be moved, but we want an associative
 // container to act as an additional index.
 
+namespace details {
+// Stringlike keys default to the transparent functors, which hash with
+// `strings::fast_hash` and use the cached hash of a
+// `strings::hashed_string_view`.
+template<typename T>
+inline constexpr bool is_stringlike_key_v =
+    std::is_convertible_v<const T&, std::string_view>;
+
+template<typename T>
+using default_key_hash_t = std::conditional_t<is_stringlike_key_v<T>,
+    transparent_hash_equal_stringlike, std::hash<T>>;
+
+template<typename T>
+using default_key_equal_t = std::conditional_t<is_stringlike_key_v<T>,
+    transparent_hash_equal_stringlike, std::equal_to<T>>;
+} // namespace details
+
 // Indirect key for use in hash containers. Contains a reference to the key and
 // acts more or less like the key, but is lightweight.
-template<typename T, typename H = std::hash<T>, typename E = std::equal_to<T>>
+template<typename T, typename H = details::default_key_hash_t<T>,
+    typename E = details::default_key_equal_t<T>>
 struct indirect_hash_key {
   const T& key;
   indirect_hash_key(const T& key) : key{key} {}
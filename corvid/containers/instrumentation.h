@@ -0,0 +1,251 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+// Whether the library records to `library_probes` on its hot paths: timer
+// lateness in `tick`, hits and misses in `intern_table::intern`, block
+// allocations in `extensible_arena`, and the duration of `dnf::convert` and
+// `program::eval`. Off by default, in which case the hooks compile to
+// nothing. Like `CORVID_ARENA_STATS`, it must be the same in every
+// translation unit.
+#ifndef CORVID_INSTRUMENTATION
+#define CORVID_INSTRUMENTATION 0
+#endif
+
+namespace corvid { inline namespace container { inline namespace instrument {
+
+// Counters and histograms are striped by thread, so that recording is a
+// relaxed atomic add to a cache line that's usually private to the thread,
+// and reading merges the stripes without taking a lock. Reads may therefore
+// be slightly stale, and the fields of a snapshot may not be mutually
+// consistent while others are recording.
+
+namespace details {
+inline constexpr size_t stripe_count = 16;
+
+// Stripe for the calling thread. Threads are dealt stripes round-robin, on
+// first use, so that threads don't share stripes until there are more of
+// them than stripes.
+[[nodiscard]] inline size_t stripe_index() noexcept {
+  static std::atomic<size_t> next_index;
+  thread_local const size_t index =
+      next_index.fetch_add(1, std::memory_order::relaxed) % stripe_count;
+  return index;
+}
+
+[[nodiscard]] inline uint64_t now_ns() noexcept {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+} // namespace details
+
+// Monotonic counter.
+class counter {
+public:
+  void add(uint64_t n = 1) noexcept {
+    stripes_[details::stripe_index()].value.fetch_add(n,
+        std::memory_order::relaxed);
+  }
+
+  [[nodiscard]] uint64_t value() const noexcept {
+    uint64_t total{};
+    for (const auto& stripe : stripes_)
+      total += stripe.value.load(std::memory_order::relaxed);
+    return total;
+  }
+
+  void reset() noexcept {
+    for (auto& stripe : stripes_)
+      stripe.value.store(0, std::memory_order::relaxed);
+  }
+
+private:
+  struct alignas(64) stripe {
+    std::atomic<uint64_t> value;
+  };
+  std::array<stripe, details::stripe_count> stripes_{};
+};
+
+// Merged contents of a `latency_histogram`.
+struct histogram_snapshot {
+  static constexpr size_t bucket_count = 252;
+
+  uint64_t count{};
+  uint64_t sum{};
+  uint64_t max{};
+  std::array<uint64_t, bucket_count> buckets{};
+
+  [[nodiscard]] double mean() const noexcept {
+    return count ? static_cast<double>(sum) / static_cast<double>(count) : 0;
+  }
+
+  // Upper bound of the bucket holding the value at `fraction` of the way
+  // through the recorded values, so that at least that fraction are no
+  // larger, capped at `max`. Returns 0 if empty.
+  [[nodiscard]] uint64_t percentile(double fraction) const noexcept;
+};
+
+// Log-linear histogram of durations, or any other unsigned values, in the
+// style of HdrHistogram.
+//
+// Values below 8 get a bucket each, and each power of two above that is
+// split into 4 buckets, so a value is placed to within 25% of its size. This
+// covers the full range of `uint64_t` in 252 buckets, which is cheap enough
+// to keep a copy per stripe.
+class latency_histogram {
+public:
+  static constexpr size_t bucket_count = histogram_snapshot::bucket_count;
+
+  // Bucket that `value` falls into.
+  [[nodiscard]] static constexpr size_t bucket_of(uint64_t value) noexcept {
+    const auto shift = std::max<size_t>(std::bit_width(value), 3) - 3;
+    return (shift << 2) + (value >> shift);
+  }
+
+  // Largest value that falls into `bucket`.
+  [[nodiscard]] static constexpr uint64_t
+  bucket_max(size_t bucket) noexcept {
+    if (bucket < 8) return bucket;
+    const auto shift = (bucket >> 2) - 1;
+    const auto top = bucket - (shift << 2);
+    return ((top + 1) << shift) - 1;
+  }
+
+  void record(uint64_t value) noexcept {
+    auto& stripe = stripes_[details::stripe_index()];
+    stripe.buckets[bucket_of(value)].fetch_add(1, std::memory_order::relaxed);
+    stripe.sum.fetch_add(value, std::memory_order::relaxed);
+    auto old = stripe.max.load(std::memory_order::relaxed);
+    while (old < value && !stripe.max.compare_exchange_weak(old, value,
+                              std::memory_order::relaxed))
+    {}
+  }
+
+  // Record a duration in nanoseconds. Negative durations count as 0.
+  template<typename Rep, typename Period>
+  void record(std::chrono::duration<Rep, Period> duration) noexcept {
+    const auto ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+    record(static_cast<uint64_t>(std::max<int64_t>(ns.count(), 0)));
+  }
+
+  [[nodiscard]] histogram_snapshot snapshot() const noexcept {
+    histogram_snapshot result;
+    for (const auto& stripe : stripes_) {
+      for (size_t i = 0; i < bucket_count; ++i) {
+        const auto n = stripe.buckets[i].load(std::memory_order::relaxed);
+        result.buckets[i] += n;
+        result.count += n;
+      }
+      result.sum += stripe.sum.load(std::memory_order::relaxed);
+      result.max =
+          std::max(result.max, stripe.max.load(std::memory_order::relaxed));
+    }
+    return result;
+  }
+
+  void reset() noexcept {
+    for (auto& stripe : stripes_) {
+      for (auto& bucket : stripe.buckets)
+        bucket.store(0, std::memory_order::relaxed);
+      stripe.sum.store(0, std::memory_order::relaxed);
+      stripe.max.store(0, std::memory_order::relaxed);
+    }
+  }
+
+private:
+  struct alignas(64) stripe {
+    std::array<std::atomic<uint64_t>, bucket_count> buckets;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+  };
+  std::array<stripe, details::stripe_count> stripes_{};
+};
+
+inline uint64_t
+histogram_snapshot::percentile(double fraction) const noexcept {
+  if (!count) return 0;
+  const auto rank = static_cast<uint64_t>(
+      std::clamp(fraction, 0.0, 1.0) * static_cast<double>(count - 1));
+  uint64_t seen{};
+  for (size_t i = 0; i < bucket_count; ++i) {
+    seen += buckets[i];
+    if (seen > rank)
+      return std::min(latency_histogram::bucket_max(i), max);
+  }
+  return max;
+}
+
+// Records the nanoseconds from construction to destruction into a histogram.
+class scoped_timer {
+public:
+  explicit scoped_timer(latency_histogram& histogram) noexcept
+      : histogram_{histogram}, start_ns_{details::now_ns()} {}
+
+  scoped_timer(const scoped_timer&) = delete;
+  scoped_timer& operator=(const scoped_timer&) = delete;
+
+  ~scoped_timer() { histogram_.record(details::now_ns() - start_ns_); }
+
+private:
+  latency_histogram& histogram_;
+  const uint64_t start_ns_;
+};
+
+// The probes that the library records to when `CORVID_INSTRUMENTATION` is
+// on. They're always available, so that a program can read them without
+// checking, but they stay zero when it's off.
+struct probes {
+  // How late `tick` and `tick_batch` invoked timers, relative to when they
+  // were scheduled.
+  latency_histogram timer_lateness;
+
+  // Calls to `intern_table::intern` that found the value, and that added it.
+  counter intern_hits;
+  counter intern_misses;
+
+  // Blocks allocated by `extensible_arena`, including oversize blocks.
+  counter arena_blocks;
+
+  // Duration of `dnf::convert` and of `program::eval`.
+  latency_histogram dnf_convert;
+  latency_histogram ast_pred_eval;
+
+  void reset() noexcept {
+    timer_lateness.reset();
+    intern_hits.reset();
+    intern_misses.reset();
+    arena_blocks.reset();
+    dnf_convert.reset();
+    ast_pred_eval.reset();
+  }
+};
+
+[[nodiscard]] inline probes& library_probes() noexcept {
+  static probes instance;
+  return instance;
+}
+
+}}} // namespace corvid::container::instrument
@@ -0,0 +1,289 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+#include "sync_lock.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace corvid { inline namespace container { inline namespace sync_lock {
+
+// Snapshot of the counters of an `instrumented_synchronizer`.
+//
+// An acquisition is contended when the lock couldn't be taken immediately,
+// and only those acquisitions contribute to the wait time. The hold time is
+// only measured for exclusive locks.
+struct sync_stats {
+  std::string name;
+  uint64_t acquisitions{};
+  uint64_t contended{};
+  std::chrono::nanoseconds wait_time{};
+  std::chrono::nanoseconds max_hold_time{};
+};
+
+// A synchronizer that can be tried, which `instrumented_synchronizer` needs
+// in order to tell whether an acquisition was contended.
+template<typename S>
+concept TrySynchronizer = Synchronizer<S> && requires(const S& s) {
+  { s.try_lock() } -> std::same_as<bool>;
+};
+
+// A shared synchronizer that can be tried, including in shared mode.
+template<typename S>
+concept TrySharedSynchronizer =
+    TrySynchronizer<S> && SharedSynchronizer<S> && requires(const S& s) {
+      { s.try_lock_shared() } -> std::same_as<bool>;
+    };
+
+namespace details {
+using sync_clock = std::chrono::steady_clock;
+
+[[nodiscard]] inline uint64_t sync_now_ns() noexcept {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          sync_clock::now().time_since_epoch())
+          .count());
+}
+
+// Counters for one stripe, on its own cache line.
+struct alignas(64) sync_stripe {
+  std::atomic<uint64_t> acquisitions;
+  std::atomic<uint64_t> contended;
+  std::atomic<uint64_t> wait_ns;
+  std::atomic<uint64_t> max_hold_ns;
+};
+
+inline constexpr size_t sync_stripe_count = 16;
+
+// Stripe for the calling thread. Threads are dealt stripes round-robin, on
+// first use, so that threads don't share counters until there are more of
+// them than stripes.
+[[nodiscard]] inline size_t sync_stripe_index() noexcept {
+  static std::atomic<size_t> next_index;
+  thread_local const size_t index =
+      next_index.fetch_add(1, std::memory_order::relaxed) % sync_stripe_count;
+  return index;
+}
+
+class sync_instrumentation;
+
+// Registry of live instances.
+struct sync_registry {
+  std::mutex mutex;
+  std::vector<const sync_instrumentation*> instances;
+
+  [[nodiscard]] static sync_registry& get() {
+    static sync_registry registry;
+    return registry;
+  }
+};
+
+// Untyped part of `instrumented_synchronizer`, which holds the name and the
+// counters, and registers itself for as long as it lives.
+class sync_instrumentation {
+public:
+  explicit sync_instrumentation(std::string name) : name_{std::move(name)} {
+    auto& registry = sync_registry::get();
+    std::scoped_lock guard{registry.mutex};
+    registry.instances.push_back(this);
+  }
+
+  sync_instrumentation(const sync_instrumentation&) = delete;
+  sync_instrumentation& operator=(const sync_instrumentation&) = delete;
+
+  ~sync_instrumentation() {
+    auto& registry = sync_registry::get();
+    std::scoped_lock guard{registry.mutex};
+    std::erase(registry.instances, this);
+  }
+
+  // Name, for finding this instance in `instrumented_sync_stats`.
+  [[nodiscard]] std::string name() const {
+    std::scoped_lock guard{sync_registry::get().mutex};
+    return name_;
+  }
+  void rename(std::string name) const {
+    std::scoped_lock guard{sync_registry::get().mutex};
+    name_ = std::move(name);
+  }
+
+  // Aggregate the stripes. The counters are read individually, so they may
+  // not be mutually consistent while the lock is in use.
+  [[nodiscard]] sync_stats stats() const {
+    auto result = stats_without_name();
+    result.name = name();
+    return result;
+  }
+
+  // Zero the counters.
+  void reset() const noexcept {
+    for (auto& stripe : stripes_) {
+      stripe.acquisitions.store(0, std::memory_order::relaxed);
+      stripe.contended.store(0, std::memory_order::relaxed);
+      stripe.wait_ns.store(0, std::memory_order::relaxed);
+      stripe.max_hold_ns.store(0, std::memory_order::relaxed);
+    }
+  }
+
+protected:
+  // Record an acquisition and, if it was contended, the time spent waiting.
+  void count_acquisition(bool contended, uint64_t wait_ns) const noexcept {
+    auto& stripe = stripes_[sync_stripe_index()];
+    stripe.acquisitions.fetch_add(1, std::memory_order::relaxed);
+    if (!contended) return;
+    stripe.contended.fetch_add(1, std::memory_order::relaxed);
+    stripe.wait_ns.fetch_add(wait_ns, std::memory_order::relaxed);
+  }
+
+  void count_hold(uint64_t hold_ns) const noexcept {
+    auto& max = stripes_[sync_stripe_index()].max_hold_ns;
+    auto old = max.load(std::memory_order::relaxed);
+    while (old < hold_ns && !max.compare_exchange_weak(old, hold_ns,
+                                std::memory_order::relaxed))
+    {}
+  }
+
+private:
+  friend std::vector<sync_stats> instrumented_sync_stats_impl();
+
+  mutable std::string name_;
+  mutable std::array<sync_stripe, sync_stripe_count> stripes_{};
+
+  [[nodiscard]] sync_stats stats_without_name() const noexcept {
+    sync_stats result;
+    uint64_t wait_ns{};
+    uint64_t max_hold_ns{};
+    for (const auto& stripe : stripes_) {
+      result.acquisitions +=
+          stripe.acquisitions.load(std::memory_order::relaxed);
+      result.contended += stripe.contended.load(std::memory_order::relaxed);
+      wait_ns += stripe.wait_ns.load(std::memory_order::relaxed);
+      max_hold_ns = std::max(max_hold_ns,
+          stripe.max_hold_ns.load(std::memory_order::relaxed));
+    }
+    result.wait_time = std::chrono::nanoseconds{wait_ns};
+    result.max_hold_time = std::chrono::nanoseconds{max_hold_ns};
+    return result;
+  }
+};
+
+[[nodiscard]] inline std::vector<sync_stats> instrumented_sync_stats_impl() {
+  auto& registry = sync_registry::get();
+  std::scoped_lock guard{registry.mutex};
+  std::vector<sync_stats> result;
+  result.reserve(registry.instances.size());
+  for (auto instance : registry.instances) {
+    result.push_back(instance->stats_without_name());
+    result.back().name = instance->name_;
+  }
+  return result;
+}
+} // namespace details
+
+// Synchronizer that wraps `S` and counts acquisitions, contended
+// acquisitions, total wait time, and max hold time, so that a hot lock can be
+// found without an external profiler.
+//
+// The counters are striped by thread, each stripe on its own cache line, and
+// only aggregated when read, by `stats`. An uncontended acquisition costs a
+// `try_lock`, a relaxed increment, and a clock read, which is needed to time
+// the hold. Only a contended one reads the clock again to time the wait.
+// Shared acquisitions are counted, but their hold isn't timed, since there may
+// be many at once.
+//
+// Each instance can be given a name, and all live instances are listed by
+// `instrumented_sync_stats`. To name one that's default-constructed, such as
+// the `sync` of an `intern_table`, call `rename` on it, through
+// `basic_breakable_synchronizer::actual` if need be.
+//
+// Not copyable or moveable.
+template<TrySynchronizer S = synchronizer>
+class instrumented_synchronizer: public details::sync_instrumentation {
+public:
+  using sync_t = S;
+
+  explicit instrumented_synchronizer(std::string name = {})
+      : sync_instrumentation{std::move(name)} {}
+
+  void lock() const {
+    if (sync_.try_lock())
+      count_acquisition(false, 0);
+    else {
+      const auto start = details::sync_now_ns();
+      sync_.lock();
+      count_acquisition(true, details::sync_now_ns() - start);
+    }
+    acquired_ns_ = details::sync_now_ns();
+  }
+
+  [[nodiscard]] bool try_lock() const {
+    if (!sync_.try_lock()) return false;
+    count_acquisition(false, 0);
+    acquired_ns_ = details::sync_now_ns();
+    return true;
+  }
+
+  void unlock() const {
+    count_hold(details::sync_now_ns() - acquired_ns_);
+    sync_.unlock();
+  }
+
+  void lock_shared() const
+  requires TrySharedSynchronizer<S>
+  {
+    if (sync_.try_lock_shared())
+      count_acquisition(false, 0);
+    else {
+      const auto start = details::sync_now_ns();
+      sync_.lock_shared();
+      count_acquisition(true, details::sync_now_ns() - start);
+    }
+  }
+
+  [[nodiscard]] bool try_lock_shared() const
+  requires TrySharedSynchronizer<S>
+  {
+    if (!sync_.try_lock_shared()) return false;
+    count_acquisition(false, 0);
+    return true;
+  }
+
+  void unlock_shared() const
+  requires TrySharedSynchronizer<S>
+  {
+    sync_.unlock_shared();
+  }
+
+private:
+  S sync_;
+  // Only written and read while held exclusively.
+  mutable uint64_t acquired_ns_{};
+};
+
+// Stats of each live `instrumented_synchronizer`, in order of construction.
+[[nodiscard]] inline std::vector<sync_stats> instrumented_sync_stats() {
+  return details::instrumented_sync_stats_impl();
+}
+
+}}} // namespace corvid::container::sync_lock
@@ -17,10 +17,23 @@
 #pragma once
 #include "containers_shared.h"
 #include "arena_allocator.h"
+#include "instrumentation.h"
+#include "flat_index.h"
+#include "indirect_key.h"
+#include "segmented_vector.h"
 #include "opt_find.h"
+#include "sync_lock.h"
 #include "../enums.h"
 #include "../strings/cstring_view.h"
 
+#include <array>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+
 namespace corvid { inline namespace container { inline namespace intern {
 
 using namespace sequence;
@@ -36,6 +49,9 @@ class restrict_intern_construction {
   template<typename T, SequentialEnum ID, typename TR>
   friend class intern_table;
 
+  template<typename T, SequentialEnum ID, typename TR>
+  friend class sharded_intern_table;
+
   template<typename T, SequentialEnum ID>
   friend struct intern_test;
 };
@@ -50,6 +66,64 @@ struct intern_traits {};
 template<typename T, SequentialEnum ID, typename TR>
 class intern_table;
 
+namespace details {
+// Synchronizer type for the traits `TR`, which is `TR::sync_t` if defined,
+// and plain `synchronizer` otherwise.
+template<typename TR>
+struct intern_sync {
+  using type = synchronizer;
+};
+
+template<typename TR>
+requires requires { typename TR::sync_t; }
+struct intern_sync<TR> {
+  using type = typename TR::sync_t;
+};
+
+// Blocked bloom filter over the hashes of the values in a frozen table. Each
+// value sets 3 bits in a single 64-bit word, at about 16 bits per value, so
+// ruling a table out costs one load, and false positives are well under 1%.
+class intern_bloom {
+public:
+  explicit intern_bloom(size_t count)
+      : shift_{64 - std::countr_zero(
+                        std::bit_ceil(std::max<size_t>(count / 4, 2)))},
+        words_(size_t{1} << (64 - shift_)) {}
+
+  void add(size_t hash) noexcept {
+    const auto m = mix(hash);
+    words_[m >> shift_] |= bits_of(m);
+  }
+
+  [[nodiscard]] bool may_contain(size_t hash) const noexcept {
+    const auto m = mix(hash);
+    const auto bits = bits_of(m);
+    return (words_[m >> shift_] & bits) == bits;
+  }
+
+private:
+  int shift_;
+  std::vector<uint64_t> words_;
+
+  // Mix the hash, since `std::hash` is the identity for integers. The top
+  // bits pick the word and the bottom ones pick the bits.
+  [[nodiscard]] static constexpr uint64_t mix(uint64_t h) noexcept {
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+  }
+
+  [[nodiscard]] static constexpr uint64_t bits_of(uint64_t m) noexcept {
+    return (uint64_t{1} << (m & 63)) | (uint64_t{1} << ((m >> 6) & 63)) |
+           (uint64_t{1} << ((m >> 12) & 63));
+  }
+};
+} // namespace details
+
+// Lock type for an `intern_table` with traits `TR`.
+template<typename TR>
+using intern_lock_t = basic_lock<typename details::intern_sync<TR>::type>;
+
 // Overview:
 // An intern table stores unique values of type `T` and allows them to be
 // looked up by ID or by value. The address of the value is its identity, so
@@ -102,19 +176,19 @@ public:
   // Look up by ID.
   template<typename TR>
   interned_value(const intern_table<T, ID, TR>& table, ID id,
-      const lock& attestation = {});
+      const intern_lock_t<TR>& attestation = {});
 
   // Look up by value (or view into it).
   template<typename U, typename TR>
   requires Viewable<T, U>
   interned_value(const intern_table<T, ID, TR>& table, U&& value,
-      const lock& attestation = {});
+      const intern_lock_t<TR>& attestation = {});
 
   // Create by interning.
   template<typename U, typename TR>
   requires Viewable<T, U>
   interned_value(intern_table<T, ID, TR>& table, U&& value,
-      const lock& attestation = {});
+      const intern_lock_t<TR>& attestation = {});
 
   // Accessors.
   [[nodiscard]] constexpr id_t id() const noexcept { return id_; }
@@ -201,10 +275,15 @@ private:
 // `lookup_by_value_`, the key type has to work with the latter container but
 // can reference the value in the former.
 // - `lookup_by_id_t` is the container that stores the interned values, indexed
-// by ID. Elements must never be moved, since address is identity.
+// by ID. Elements must never be moved, since address is identity. By default,
+// this is a `segmented_vector`, which only supports appending, so indexing is
+// just two dependent loads.
 // - `lookup_by_value_t` is the container that indexes the interned values. In
 // principle, the key could be a value_t, but we use a key_t to avoid
 // duplicating the value in the lookup_by_id_ container.
+// - `sync_t`, which is optional, is the type of the synchronizer, such as
+// `shared_synchronizer`, and defaults to `synchronizer`. See
+// `synchronized_intern_traits`.
 //
 // TODO: Add arena size as a parameter.
 template<typename T, SequentialEnum ID>
@@ -214,16 +293,10 @@ struct intern_traits<T, ID> {
   using id_t = ID;
   using interned_value_t = interned_value<T, ID>;
   using key_t = indirect_hash_key<value_t>;
-  using lookup_by_id_t = std::deque<value_t>;
+  using lookup_by_id_t = segmented_vector<value_t>;
   using lookup_by_value_t = std::unordered_map<key_t, id_t>;
 };
 
-// TODO: A deque is only being used because we want to be able to enlarge
-// without moving, so we need something that amounts to a linked list. As an
-// entirely optional optimization, write a class with a signature similar to
-// vector or deque that is streamlined to only support appending, and to use
-// one level of indirection for indexes.
-
 // TODO: An entirely different scheme would be to store the values in a stable
 // associative container, such as a map, and then use a deque to store pointers
 // into the map, thus reversing the pattern. It would add an extra level of
@@ -234,10 +307,16 @@ struct intern_traits<T, ID> {
 // TODO: See if specializations can inherit from the primary template and
 // just replace the types that changed.
 
+// Whether `L` is a flat index, such as `flat_id_index`, which stores only IDs
+// and resolves them to values through `lookup_by_id_`.
+template<typename L>
+concept FlatInternIndex = requires { requires L::is_flat_index; };
+
 // For strings, the default traits use an arena to hold the strings and the
 // containers that index them. Strings are stored as `arena_string` but are
 // returned as `std::string`, and are transparently looked up by
-// `std::string_view`.
+// `std::string_view`. For many short strings, see `string_pool`, which is
+// far more compact but returns views that move as it grows.
 template<SequentialEnum ID>
 struct intern_traits<std::string, ID> {
   using value_t = std::string;
@@ -245,15 +324,70 @@ struct intern_traits<std::string, ID> {
   using id_t = ID;
   using interned_value_t = interned_value<std::string, id_t>;
   using key_t = std::string_view;
-  using lookup_by_id_t = arena_deque<arena_value_t>;
+  using lookup_by_id_t =
+      segmented_vector<arena_value_t, 64, arena_allocator<arena_value_t>>;
   using lookup_by_value_t = arena_map<key_t, id_t>;
 };
 
+// Traits that replace the node-based `lookup_by_value_t` of `TR` with a
+// `flat_id_index`, which stores only hash fragments and IDs. Lookups usually
+// touch one group of control bytes and then the value itself. The `key_t`
+// must work with `std::hash` and `std::equal_to`.
+template<typename T, SequentialEnum ID, typename TR = intern_traits<T, ID>>
+struct flat_intern_traits: public TR {
+  using lookup_by_value_t =
+      flat_id_index<typename TR::id_t, arena_allocator<typename TR::id_t>>;
+};
+
+// Traits for read-mostly tables, where lookups by ID and by value are
+// lock-free and only interning a new value takes the lock. The values are
+// stored in a `concurrent_segmented_vector`, which publishes each one after
+// constructing it, and indexed by a `concurrent_flat_id_index`, which
+// publishes each insertion and each rehashed table. The `key_t` must work with
+// `std::hash` and `std::equal_to`.
+template<typename T, SequentialEnum ID, typename TR = intern_traits<T, ID>>
+struct concurrent_intern_traits: public TR {
+  using lookup_by_id_t =
+      concurrent_segmented_vector<typename TR::arena_value_t, 64,
+          typename TR::lookup_by_id_t::allocator_type>;
+  using lookup_by_value_t = concurrent_flat_id_index<typename TR::id_t,
+      arena_allocator<typename TR::id_t>>;
+};
+
+// Traits that replace the synchronizer of `TR` with `S`. With a
+// `shared_synchronizer`, lookups take the lock shared, so they only wait on
+// interning. With a `spin_synchronizer`, short waits don't park. With a
+// `null_synchronizer`, the table doesn't lock at all, so it must only be used
+// by one thread at a time.
+template<typename T, SequentialEnum ID, Synchronizer S,
+    typename TR = intern_traits<T, ID>>
+struct synchronized_intern_traits: public TR {
+  using sync_t = S;
+};
+
+// Whether the traits `TR` allow `intern_table` to read without locking.
+template<typename TR>
+concept LockFreeInternReads = requires {
+  requires TR::lookup_by_id_t::is_concurrent;
+  requires TR::lookup_by_value_t::is_concurrent;
+};
+
 // Intern table of `T` values, indexed by `ID`, using the traits `TR`.
 //
 // Instances can only be constructed through the `make` factory functions,
 // which return a `std::shared_ptr`. Tables can chain to previous tables for
 // lower ID ranges, allowing a subset to be shared.
+//
+// Once a table is full, it's frozen, and it gets a bloom filter that lets
+// lookups by value from the tables chained to it skip it, so a miss only
+// probes the tables that might hold the value. To avoid a long chain, use
+// `compact` to flatten it into one table. Either way, the `key_t` must work
+// with `std::hash`.
+//
+// With `concurrent_intern_traits`, the `get` methods ignore `sync`, and
+// `intern` only locks it when the value isn't already there. Otherwise, they
+// lock it through `attestation.shared`, so with a `shared_synchronizer`, they
+// only exclude `intern`, which likewise tries a shared lookup first.
 template<typename T, SequentialEnum ID, typename TR = intern_traits<T, ID>>
 class intern_table
     : public std::enable_shared_from_this<intern_table<T, ID, TR>> {
@@ -269,8 +403,13 @@ public:
   using key_t = typename TR::key_t;
   using lookup_by_id_t = typename TR::lookup_by_id_t;
   using lookup_by_value_t = typename TR::lookup_by_value_t;
+  using sync_t = typename details::intern_sync<TR>::type;
+  using lock_t = intern_lock_t<TR>;
   static_assert(sizeof(arena_value_t) == sizeof(value_t));
 
+  // Whether `get` is lock-free.
+  static constexpr bool lock_free_reads = LockFreeInternReads<TR>;
+
   // Effectively-private constructor.
   intern_table(allow, id_t min_id, id_t max_id, const const_pointer& next = {})
       : min_id_{min_id}, max_id_{max_id},
@@ -278,7 +417,7 @@ public:
         lookup_by_value_{arena_construct<lookup_by_value_t>(arena_)},
         next_{next} {
     assert(min_id);
-    assert(min_id_ < max_id_);
+    assert(min_id_ <= max_id_);
     // TODO: Consider whether we should disable `next` if it's specified.
   }
 
@@ -310,14 +449,30 @@ public:
     return make(max_id_ + 1, max_id, this->shared_from_this());
   }
 
+  // Range of IDs for this table, not including those it chains to.
+  [[nodiscard]] id_t min_id() const noexcept { return min_id_; }
+  [[nodiscard]] id_t max_id() const noexcept { return max_id_; }
+
+  // Invoke `f(id, value)` for each interned value, in ID order, including
+  // those in the tables that this one chains to.
+  template<typename F>
+  void for_each(F&& f, const lock_t& attestation = {}) const {
+    if (next_) next_->for_each(f);
+    if constexpr (!lock_free_reads) attestation.shared(sync);
+    const size_t count = lookup_by_id_.size();
+    for (size_t index = 0; index < count; ++index)
+      f(static_cast<id_t>(*min_id_ + index),
+          reinterpret_cast<const value_t&>(lookup_by_id_[index]));
+  }
+
   // When full, `intern` fails.
   bool is_full() const { return sync.is_disabled(); }
 
   // Get interned value by ID. If not found, returns empty. Chains to next
   // table if necessary. See also: `operator()`.
   [[nodiscard]] interned_value_t
-  get(id_t id, const lock& attestation = {}) const {
-    attestation(sync);
+  get(id_t id, const lock_t& attestation = {}) const {
+    if constexpr (!lock_free_reads) attestation.shared(sync);
     const value_t* found_value{};
     if (id >= min_id_ && id <= max_id_)
       found_value = find_by_id(id);
@@ -327,23 +482,52 @@ public:
   }
 
   // Get interned value by (transparent) value. If not found, returns empty.
-  // Chains to next table if necessary. See also: `operator()` and `operator[]
-  // const`.
+  // Chains to next table if necessary, skipping those whose bloom filter
+  // rules the value out, without locking them. See also: `operator()` and
+  // `operator[] const`.
   template<typename U>
   requires Viewable<T, U>
   [[nodiscard]] interned_value_t
-  get(const U& value, const lock& attestation = {}) const {
-    attestation(sync);
-    id_t id{};
-    const value_t* found_value{};
-    if (auto id_ptr = find_opt(lookup_by_value_, key_t{value})) {
-      id = *id_ptr;
-      const auto index = *id - *min_id_;
-      found_value = reinterpret_cast<const value_t*>(&lookup_by_id_[index]);
-    } else if (next_)
-      return next_->get(value, attestation);
+  get(const U& value, const lock_t& attestation = {}) const {
+    const key_t key{value};
+    size_t hash{};
+    if (FlatInternIndex<lookup_by_value_t> || next_)
+      hash = std::hash<key_t>{}(key);
+    if (auto iv = find_by_key(key, hash, attestation)) return iv;
+    for (auto table = next_.get(); table; table = table->next_.get())
+      if (table->may_contain(hash))
+        if (auto iv = table->find_by_key(key, hash)) return iv;
+    return {};
+  }
 
-    return {allow::ctor, found_value, id};
+  // Flatten this table and the ones it chains to into a single, frozen table
+  // with the same IDs and values, ranging from the lowest ID in the chain to
+  // the highest one in use. Lookups in the result probe one index instead of
+  // one per table, and tables made from it by `make_next` chain to it. The
+  // tables this one chains to must be full, since IDs can't have gaps, or
+  // it throws. Values interned into this table during the call may be left
+  // out.
+  [[nodiscard]] const_pointer compact() const {
+    id_t min_id = min_id_;
+    for (auto table = next_.get(); table; table = table->next_.get()) {
+      if (!table->is_full())
+        throw std::invalid_argument("intern chain has gaps");
+      min_id = table->min_id_;
+    }
+
+    const lock_t attestation;
+    if constexpr (!lock_free_reads) attestation.shared(sync);
+    const auto count =
+        static_cast<size_t>(*min_id_ - *min_id) + lookup_by_id_.size();
+    const auto max_id =
+        static_cast<id_t>(*min_id + std::max<size_t>(count, 1) - 1);
+    const auto flat = make(min_id, max_id);
+    // Nothing else can see it yet, so it doesn't need locking.
+    flat->reserve_more(count);
+    for_each([&](id_t, const value_t& value) { flat->append(value); },
+        attestation);
+    flat->freeze();
+    return flat;
   }
 
   // Interns a value. If the value is already interned, returns the existing
@@ -353,27 +537,92 @@ public:
   template<typename U>
   requires Viewable<T, U>
   [[nodiscard]] interned_value_t
-  intern(U&& value, const lock& attestation = {}) {
+  intern(U&& value, const lock_t& attestation = {}) {
+    // Most values are already interned, so try without the lock, or with it
+    // shared, first. Since this attestation may have to lock exclusively, the
+    // shared lock is only held for the lookup.
+    if constexpr (lock_free_reads || SharedSynchronizer<sync_t>)
+      if (!attestation.owns_lock())
+        if (auto iv = get(value)) {
+#if CORVID_INSTRUMENTATION
+          library_probes().intern_hits.add();
+#endif
+          return iv;
+        }
+
     attestation(sync);
 
     // If we found it, or if we have no more room, return what we have.
     auto iv = get(std::forward<U>(value), attestation);
+#if CORVID_INSTRUMENTATION
+    if (iv) library_probes().intern_hits.add();
+#endif
     if (iv || sync.is_disabled()) return iv;
+#if CORVID_INSTRUMENTATION
+    library_probes().intern_misses.add();
+#endif
 
-    extensible_arena::scope s{arena_};
-    const auto id = static_cast<id_t>(*min_id_ + lookup_by_id_.size());
-    auto& found_value = lookup_by_id_.emplace_back(std::forward<U>(value));
-    lookup_by_value_.emplace(key_t{found_value}, id);
+    auto [found_value, id] = append(std::forward<U>(value));
 
     // After the last entry, we don't need to sync anymore.
-    if (id == max_id_) sync.disable();
+    if (id == max_id_) freeze();
+
+    return {allow::ctor, found_value, id};
+  }
 
-    return {allow::ctor, reinterpret_cast<const value_t*>(&found_value), id};
+  // Interns a batch of values, returning their IDs in the same order. Values
+  // that repeat within the batch are only looked up once, and the lock is
+  // only taken once, after the hits have been found, if they can be without
+  // it. The indexes are reserved for the misses so that they don't rehash
+  // along the way. If the table fills up, the remaining IDs are empty.
+  template<std::ranges::random_access_range R>
+  requires Viewable<T, std::ranges::range_value_t<R>>
+  [[nodiscard]] std::vector<id_t>
+  intern_bulk(const R& values, const lock_t& attestation = {}) {
+    const auto count = static_cast<size_t>(std::ranges::size(values));
+    auto at = [&](size_t index) -> decltype(auto) {
+      return std::ranges::begin(values)[index];
+    };
+
+    // Assign each value the position of its first instance.
+    std::unordered_map<key_t, size_t> firsts;
+    std::vector<size_t> first_of(count);
+    std::vector<size_t> unique;
+    firsts.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      auto [it, inserted] = firsts.try_emplace(key_t{at(i)}, unique.size());
+      if (inserted) unique.push_back(i);
+      first_of[i] = it->second;
+    }
+
+    std::vector<id_t> unique_ids(unique.size());
+    std::vector<size_t> misses;
+    if constexpr (lock_free_reads) {
+      for (size_t j = 0; j < unique.size(); ++j)
+        if (auto iv = get(at(unique[j]), attestation))
+          unique_ids[j] = iv.id();
+        else
+          misses.push_back(j);
+    } else {
+      misses.resize(unique.size());
+      std::iota(misses.begin(), misses.end(), size_t{});
+    }
+
+    if (!misses.empty()) {
+      attestation(sync);
+      reserve_more(misses.size());
+      for (auto j : misses)
+        unique_ids[j] = intern(at(unique[j]), attestation).id();
+    }
+
+    std::vector<id_t> ids(count);
+    for (size_t i = 0; i < count; ++i) ids[i] = unique_ids[first_of[i]];
+    return ids;
   }
 
   // Get by ID. If not found, returns empty ID and value.
   [[nodiscard]] interned_value_t
-  operator()(id_t id, const lock& attestation = {}) const {
+  operator()(id_t id, const lock_t& attestation = {}) const {
     return get(id, attestation);
   }
 
@@ -381,7 +630,7 @@ public:
   template<typename U>
   requires Viewable<T, U>
   [[nodiscard]] interned_value_t
-  operator()(U&& value, const lock& attestation = {}) const {
+  operator()(U&& value, const lock_t& attestation = {}) const {
     return get(std::forward<U>(value), attestation);
   }
 
@@ -407,7 +656,12 @@ public:
     return iv.value();
   }
 
-  const breakable_synchronizer sync;
+  // Whether `pv` points into the table's arena. For testing.
+  [[nodiscard]] bool arena_contains(const void* pv) const noexcept {
+    return arena_.owns(pv);
+  }
+
+  const basic_breakable_synchronizer<sync_t> sync;
 
 private:
   extensible_arena arena_{4096};
@@ -416,10 +670,78 @@ private:
   lookup_by_id_t& lookup_by_id_;
   lookup_by_value_t& lookup_by_value_;
   const_pointer next_;
+  std::unique_ptr<const details::intern_bloom> bloom_owner_;
+  std::atomic<const details::intern_bloom*> bloom_{};
 
   // TODO: Add real or fake arena allocator, depending on traits. Then create
   // real or fake scopes in the methods that can allocate.
 
+  // Reserve room in the indexes for `count` more values, or as many as there
+  // are IDs left for. Requires the lock.
+  void reserve_more(size_t count) {
+    if (sync.is_disabled()) return;
+    const size_t used = lookup_by_id_.size();
+    const size_t room = static_cast<size_t>(*max_id_ - *min_id_) + 1 - used;
+    const auto wanted = used + std::min(count, room);
+    extensible_arena::scope s{arena_};
+    if constexpr (requires { lookup_by_id_.reserve(wanted); })
+      lookup_by_id_.reserve(wanted);
+    lookup_by_value_.reserve(wanted);
+  }
+
+  // Append a value that isn't already in the table, returning its address
+  // and ID. Requires the lock and room for it.
+  template<typename U>
+  std::pair<const value_t*, id_t> append(U&& value) {
+    extensible_arena::scope s{arena_};
+    const auto id = static_cast<id_t>(*min_id_ + lookup_by_id_.size());
+    auto& found_value = lookup_by_id_.emplace_back(std::forward<U>(value));
+    if constexpr (FlatInternIndex<lookup_by_value_t>)
+      lookup_by_value_.insert(std::hash<key_t>{}(key_t{found_value}), id);
+    else
+      lookup_by_value_.emplace(key_t{found_value}, id);
+    return {reinterpret_cast<const value_t*>(&found_value), id};
+  }
+
+  // Stop interning and publish a bloom filter of the values, so that lookups
+  // from tables that chain to this one can usually skip it. Requires the
+  // lock, if not already frozen.
+  void freeze() {
+    if (sync.is_disabled()) return;
+    const size_t count = lookup_by_id_.size();
+    auto bloom = std::make_unique<details::intern_bloom>(count);
+    for (size_t index = 0; index < count; ++index)
+      bloom->add(std::hash<key_t>{}(key_t{lookup_by_id_[index]}));
+    bloom_.store(bloom.get(), std::memory_order::release);
+    bloom_owner_ = std::move(bloom);
+    sync.disable();
+  }
+
+  // Whether a value with this hash may be in the table. Only frozen tables
+  // can rule any out.
+  [[nodiscard]] bool may_contain(size_t hash) const noexcept {
+    const auto bloom = bloom_.load(std::memory_order::acquire);
+    return !bloom || bloom->may_contain(hash);
+  }
+
+  // Find value by key in this table alone, returning empty if not found. The
+  // `hash` is required for flat indexes.
+  [[nodiscard]] interned_value_t find_by_key(const key_t& key, size_t hash,
+      const lock_t& attestation = {}) const {
+    if constexpr (!lock_free_reads) attestation.shared(sync);
+    if constexpr (FlatInternIndex<lookup_by_value_t>) {
+      const auto id = lookup_by_value_.find(hash, [&](id_t found) {
+        return std::equal_to<key_t>{}(key_t{*find_by_id(found)}, key);
+      });
+      if (id != id_t{}) return {allow::ctor, find_by_id(id), id};
+    } else if (auto id_ptr = find_opt(lookup_by_value_, key)) {
+      const auto index = *(*id_ptr) - *min_id_;
+      return {allow::ctor,
+          reinterpret_cast<const value_t*>(&lookup_by_id_[index]), *id_ptr};
+    }
+    return {};
+  }
+
   // Find value by ID, returning address or `nullptr`.
   [[nodiscard]] const value_t* find_by_id(id_t id) const {
     const size_t index = *id - *min_id_;
@@ -428,11 +750,243 @@ private:
   }
 };
 
+// Intern table split into shards, so that interning scales with threads.
+//
+// Each value goes to the shard picked by its hash, and each shard is an
+// independent `intern_table`, with its own lock, that owns a disjoint range
+// of `ids_per_shard` IDs. Shard `i` starts at `min_id + i * ids_per_shard`,
+// so a lookup by ID finds its shard with a division. IDs are unique across
+// shards and dense within each. Threads interning different values usually
+// lock different shards, so new values don't serialize on one lock.
+//
+// The cost is that the IDs, as a whole, have gaps, and that a shard can fill
+// up while others still have room, after which interning values that hash to
+// it fails, so `ids_per_shard` needs some slack.
+//
+// Lookups and interning work as for `intern_table`, except that they take no
+// attestation, since each call locks at most one shard. So it also works
+// with `intern_cache`.
+template<typename T, SequentialEnum ID, typename TR = intern_traits<T, ID>>
+class sharded_intern_table {
+  using allow = restrict_intern_construction::allow;
+
+public:
+  using table_t = intern_table<T, ID, TR>;
+  using pointer = std::shared_ptr<sharded_intern_table>;
+  using value_t = typename table_t::value_t;
+  using id_t = typename table_t::id_t;
+  using key_t = typename table_t::key_t;
+  using interned_value_t = typename table_t::interned_value_t;
+
+  // Construct with `shard_count` shards, rounded up to a power of two, each
+  // owning `ids_per_shard` IDs, starting from `min_id`, which defaults to 1.
+  // Throws if the IDs don't all fit in `ID`.
+  sharded_intern_table(size_t shard_count, size_t ids_per_shard,
+      id_t min_id = id_t{})
+      : min_id_{!min_id ? static_cast<id_t>(1) : min_id},
+        ids_per_shard_{ids_per_shard},
+        shard_bits_{std::countr_zero(
+            std::bit_ceil(std::max<size_t>(shard_count, 1)))} {
+    const size_t count = size_t{1} << shard_bits_;
+    // The top ID is left unused, as with `intern_table::make`.
+    const auto limit = static_cast<uint64_t>(
+                           std::numeric_limits<as_underlying_t<id_t>>::max()) -
+                       1;
+    const auto first = static_cast<uint64_t>(*min_id_);
+    if (!ids_per_shard || first > limit ||
+        ids_per_shard > (limit - first + 1) / count)
+      throw std::invalid_argument("sharded intern IDs out of range");
+    shards_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      const auto start = first + i * ids_per_shard;
+      shards_.push_back(table_t::make(static_cast<id_t>(start),
+          static_cast<id_t>(start + ids_per_shard - 1)));
+    }
+  }
+
+  [[nodiscard]] static pointer
+  make(size_t shard_count, size_t ids_per_shard, id_t min_id = id_t{}) {
+    return std::make_shared<sharded_intern_table>(shard_count, ids_per_shard,
+        min_id);
+  }
+
+  [[nodiscard]] size_t shard_count() const noexcept { return shards_.size(); }
+  [[nodiscard]] size_t ids_per_shard() const noexcept {
+    return ids_per_shard_;
+  }
+  [[nodiscard]] const table_t& shard(size_t index) const {
+    return *shards_.at(index);
+  }
+
+  // Range of IDs across all shards.
+  [[nodiscard]] id_t min_id() const noexcept { return min_id_; }
+  [[nodiscard]] id_t max_id() const noexcept {
+    return shards_.back()->max_id();
+  }
+
+  // Index of the shard that owns `id`, or `shard_count()` if none does.
+  [[nodiscard]] size_t shard_of(id_t id) const noexcept {
+    if (id < min_id_) return shards_.size();
+    return std::min(static_cast<size_t>(*id - *min_id_) / ids_per_shard_,
+        shards_.size());
+  }
+
+  // Index of the shard that `value` belongs to.
+  template<typename U>
+  requires Viewable<T, U>
+  [[nodiscard]] size_t shard_of(const U& value) const {
+    return shard_of_hash(std::hash<key_t>{}(key_t{value}));
+  }
+
+  // Invoke `f(id, value)` for each interned value, in ID order.
+  template<typename F>
+  void for_each(F&& f) const {
+    for (const auto& table : shards_) table->for_each(f);
+  }
+
+  // Get interned value by ID, from the shard that owns it. If not found,
+  // returns empty.
+  [[nodiscard]] interned_value_t get(id_t id) const {
+    const auto index = shard_of(id);
+    if (index == shards_.size()) return {allow::ctor, nullptr, id};
+    return shards_[index]->get(id);
+  }
+
+  // Get interned value by (transparent) value, from the shard it belongs
+  // to. If not found, returns empty.
+  template<typename U>
+  requires Viewable<T, U>
+  [[nodiscard]] interned_value_t get(const U& value) const {
+    return shards_[shard_of(value)]->get(value);
+  }
+
+  // Intern a value into the shard it belongs to, locking only that shard.
+  // Fails, returning empty, if the shard is full.
+  template<typename U>
+  requires Viewable<T, U>
+  [[nodiscard]] interned_value_t intern(U&& value) {
+    auto& table = *shards_[shard_of(value)];
+    return table.intern(std::forward<U>(value));
+  }
+
+  [[nodiscard]] interned_value_t operator()(id_t id) const { return get(id); }
+
+  template<typename U>
+  requires Viewable<T, U>
+  [[nodiscard]] interned_value_t operator()(const U& value) const {
+    return get(value);
+  }
+
+private:
+  id_t min_id_;
+  size_t ids_per_shard_;
+  int shard_bits_;
+  std::vector<typename table_t::pointer> shards_;
+
+  // Mix the hash and keep the top bits, so that the shard doesn't depend on
+  // the same bits that the index within the shard will.
+  [[nodiscard]] size_t shard_of_hash(size_t hash) const noexcept {
+    if (!shard_bits_) return 0;
+    return static_cast<size_t>(
+        (static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >>
+        (64 - shard_bits_));
+  }
+};
+
+// Direct-mapped cache in front of an `intern_table`, for values that repeat.
+//
+// Each of the `N` entries holds a hash and the interned value for it, so a
+// hit costs one hash and one comparison, without touching the table or its
+// lock. A miss goes to the table and replaces the entry. Since interned
+// values never move, the entries stay valid for as long as the table, which
+// the cache keeps alive.
+//
+// Not thread-safe, so the intent is to have one per thread, such as:
+//   thread_local intern_cache<string_intern_table> cache{table};
+template<typename TABLE, size_t N = 256>
+class intern_cache {
+  static_assert(std::has_single_bit(N), "Cache size must be a power of 2");
+
+public:
+  using table_t = TABLE;
+  using value_t = typename table_t::value_t;
+  using id_t = typename table_t::id_t;
+  using key_t = typename table_t::key_t;
+  using interned_value_t = typename table_t::interned_value_t;
+  static constexpr size_t cache_size = N;
+
+  explicit intern_cache(std::shared_ptr<table_t> table)
+      : table_{std::move(table)} {
+    assert(table_);
+  }
+
+  // Get interned value by value, through the cache. If not found, returns
+  // empty.
+  template<typename U>
+  requires Viewable<value_t, U>
+  [[nodiscard]] interned_value_t get(const U& value) {
+    return lookup(value, [&] { return std::as_const(*table_).get(value); });
+  }
+
+  // Interns a value, through the cache.
+  template<typename U>
+  requires Viewable<value_t, U>
+  [[nodiscard]] interned_value_t intern(const U& value) {
+    return lookup(value, [&] { return table_->intern(value); });
+  }
+
+  // Forget all entries.
+  void clear() noexcept { entries_.fill({}); }
+
+  [[nodiscard]] const table_t& table() const noexcept { return *table_; }
+  [[nodiscard]] size_t hits() const noexcept { return hits_; }
+  [[nodiscard]] size_t misses() const noexcept { return misses_; }
+
+private:
+  struct entry {
+    size_t hash{};
+    interned_value_t iv;
+  };
+
+  std::shared_ptr<table_t> table_;
+  std::array<entry, N> entries_{};
+  size_t hits_{};
+  size_t misses_{};
+
+  template<typename U, typename F>
+  [[nodiscard]] interned_value_t lookup(const U& value, F&& on_miss) {
+    const key_t key{value};
+    const auto hash = std::hash<key_t>{}(key);
+    auto& e = entries_[index_of(hash)];
+    if (e.iv && e.hash == hash &&
+        std::equal_to<key_t>{}(key_t{e.iv.value()}, key))
+    {
+      ++hits_;
+      return e.iv;
+    }
+    ++misses_;
+    auto iv = on_miss();
+    if (iv) e = entry{hash, iv};
+    return iv;
+  }
+
+  // Mix the hash, since `std::hash` is the identity for integers, and keep
+  // the top bits.
+  [[nodiscard]] static size_t index_of(size_t hash) noexcept {
+    if constexpr (N == 1)
+      return 0;
+    else
+      return static_cast<size_t>(
+          (static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >>
+          (64 - std::countr_zero(N)));
+  }
+};
+
 // Inline constructors.
 template<typename T, SequentialEnum ID>
 template<typename TR>
 interned_value<T, ID>::interned_value(const intern_table<T, ID, TR>& table,
-    ID id, const lock& attestation) {
+    ID id, const intern_lock_t<TR>& attestation) {
   *this = table.get(id, attestation);
 }
 
@@ -440,7 +994,7 @@ template<typename T, SequentialEnum ID>
 template<typename U, typename TR>
 requires Viewable<T, U>
 interned_value<T, ID>::interned_value(const intern_table<T, ID, TR>& table,
-    U&& value, const lock& attestation) {
+    U&& value, const intern_lock_t<TR>& attestation) {
   *this = table.get(std::forward<U>(value), attestation);
 }
 
@@ -448,7 +1002,7 @@ template<typename T, SequentialEnum ID>
 template<typename U, typename TR>
 requires Viewable<T, U>
 interned_value<T, ID>::interned_value(intern_table<T, ID, TR>& table,
-    U&& value, const lock& attestation) {
+    U&& value, const intern_lock_t<TR>& attestation) {
   *this = table.intern(std::forward<U>(value), attestation);
 }
 
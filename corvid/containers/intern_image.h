@@ -0,0 +1,359 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+#include "intern.h"
+#include "../strings/opt_string_view.h"
+
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace corvid { inline namespace container { inline namespace intern {
+
+template<SequentialEnum ID, typename TR = intern_traits<std::string, ID>>
+class imaged_intern_table;
+
+// Read-only string intern table over a serialized image, such as a file
+// mapped into memory.
+//
+// The image is produced by `serialize`, from an `intern_table` chain or
+// anything else with a compatible `for_each`. It holds a header, an array of
+// end offsets indexed by ID, a prebuilt hash index, and a blob of the string
+// contents. Constructing from an image just validates the header, so startup
+// is O(1) regardless of size, and nothing is copied: lookups read straight
+// from the image and return views into it.
+//
+// Layout, in native byte order:
+// - Header, as `image_header`.
+// - `uint64_t ends[id_count]`: end offset of each value in the blob, where
+// each value begins at the previous end. IDs the source didn't use have
+// `absent_bit` set.
+// - `uint32_t fragments[index_capacity]`: top half of each slot's hash.
+// - `uint32_t slots[index_capacity]`: 1 + ID offset for each slot, or 0 for
+// empty. The index is probed linearly from the low bits of the hash.
+// - `char blob[blob_size]`.
+//
+// The hash is 64-bit FNV-1a, so images are portable across builds, though
+// not across byte orders. Beyond the header, the image is trusted, so only
+// load images you wrote.
+//
+// Instances can only be constructed through `make`, which returns a
+// `std::shared_ptr`, so that `make_next` can chain a writable table to it.
+template<SequentialEnum ID>
+class string_intern_image
+    : public std::enable_shared_from_this<string_intern_image<ID>> {
+  struct allow {
+    explicit allow() = default;
+  };
+
+public:
+  using id_t = ID;
+  using pointer = std::shared_ptr<const string_intern_image>;
+
+  struct image_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t min_id;
+    uint64_t id_count;
+    uint64_t value_count;
+    uint64_t index_capacity;
+    uint64_t blob_size;
+  };
+
+  static constexpr char image_magic[8] = {'C', 'V', 'D', 'I', 'N', 'T', 'R',
+      'N'};
+  static constexpr uint32_t image_version = 1;
+  static constexpr uint32_t image_byte_order = 0x01020304;
+  static constexpr uint64_t absent_bit = uint64_t{1} << 63;
+
+  // Effectively-private constructor.
+  string_intern_image(allow, std::span<const std::byte> image,
+      std::shared_ptr<const void> owner)
+      : image_{image}, owner_{std::move(owner)} {
+    if (image_.size() < sizeof(image_header))
+      throw std::invalid_argument("intern image too small");
+    if (reinterpret_cast<uintptr_t>(image_.data()) % alignof(uint64_t))
+      throw std::invalid_argument("intern image misaligned");
+    std::memcpy(&header_, image_.data(), sizeof(header_));
+    if (std::memcmp(header_.magic, image_magic, sizeof(image_magic)) ||
+        header_.version != image_version ||
+        header_.byte_order != image_byte_order)
+      throw std::invalid_argument("intern image header mismatch");
+    if (!header_.min_id || header_.min_id > max_id_count() ||
+        header_.id_count >= absent_bit ||
+        header_.id_count > max_id_count() - header_.min_id + 1 ||
+        !std::has_single_bit(header_.index_capacity) ||
+        header_.index_capacity <= header_.value_count ||
+        header_.index_capacity > (uint64_t{1} << 32))
+      throw std::invalid_argument("intern image header corrupt");
+    ends_ = sizeof(image_header);
+    fragments_ = ends_ + header_.id_count * sizeof(uint64_t);
+    slots_ = fragments_ + header_.index_capacity * sizeof(uint32_t);
+    blob_ = slots_ + header_.index_capacity * sizeof(uint32_t);
+    if (image_.size() != blob_ + header_.blob_size)
+      throw std::invalid_argument("intern image size mismatch");
+  }
+
+  string_intern_image(const string_intern_image&) = delete;
+  string_intern_image& operator=(const string_intern_image&) = delete;
+
+  // Make from the bytes of an `image`, which must stay valid for the life of
+  // the instance. The `owner`, if any, is held until then, such as to unmap
+  // the file. Throws `std::invalid_argument` if the header is invalid.
+  [[nodiscard]] static pointer make(std::span<const std::byte> image,
+      std::shared_ptr<const void> owner = {}) {
+    return std::make_shared<const string_intern_image>(allow{}, image,
+        std::move(owner));
+  }
+
+  // Serialize the values from `source`, which may be an `intern_table`
+  // chain, an `imaged_intern_table`, or another `string_intern_image`.
+  // It just needs a `for_each` that invokes its callback with each ID and
+  // value, in ascending order of ID. Gaps in the IDs are preserved.
+  template<typename S>
+  [[nodiscard]] static std::string serialize(const S& source) {
+    std::vector<std::pair<uint64_t, std::string_view>> values;
+    source.for_each([&](id_t id, std::string_view value) {
+      assert(values.empty() ||
+             static_cast<uint64_t>(*id) > values.back().first);
+      values.emplace_back(static_cast<uint64_t>(*id), value);
+    });
+
+    image_header header{};
+    std::memcpy(header.magic, image_magic, sizeof(image_magic));
+    header.version = image_version;
+    header.byte_order = image_byte_order;
+    header.min_id = values.empty() ? 1 : values.front().first;
+    header.id_count =
+        values.empty() ? 0 : values.back().first - header.min_id + 1;
+    header.value_count = values.size();
+    if (header.id_count >= (uint64_t{1} << 32) - 1)
+      throw std::length_error("intern image too large");
+    header.index_capacity =
+        std::bit_ceil(std::max<uint64_t>(header.value_count * 2, 16));
+    for (const auto& [id, value] : values) header.blob_size += value.size();
+
+    std::vector<uint64_t> ends(header.id_count, absent_bit);
+    std::vector<uint32_t> fragments(header.index_capacity);
+    std::vector<uint32_t> slots(header.index_capacity);
+    std::string blob;
+    blob.reserve(header.blob_size);
+    const auto mask = header.index_capacity - 1;
+    for (const auto& [id, value] : values) {
+      const auto offset = id - header.min_id;
+      blob += value;
+      ends[offset] = blob.size();
+      const auto hash = hash_of(value);
+      auto slot = hash & mask;
+      while (slots[slot]) slot = (slot + 1) & mask;
+      fragments[slot] = fragment_of(hash);
+      slots[slot] = static_cast<uint32_t>(offset + 1);
+    }
+    // Absent IDs still need an end offset, so that the next value can find
+    // its beginning.
+    uint64_t end{};
+    for (auto& e : ends)
+      if (e & absent_bit)
+        e = end | absent_bit;
+      else
+        end = e;
+
+    std::string image;
+    image.reserve(sizeof(header) + ends.size() * sizeof(uint64_t) +
+                  slots.size() * 2 * sizeof(uint32_t) + blob.size());
+    append_bytes(image, &header, sizeof(header));
+    append_bytes(image, ends.data(), ends.size() * sizeof(uint64_t));
+    append_bytes(image, fragments.data(),
+        fragments.size() * sizeof(uint32_t));
+    append_bytes(image, slots.data(), slots.size() * sizeof(uint32_t));
+    image += blob;
+    return image;
+  }
+
+  // Accessors.
+
+  // Range of IDs in the image. When empty, `max_id` is below `min_id`.
+  [[nodiscard]] id_t min_id() const noexcept {
+    return static_cast<id_t>(header_.min_id);
+  }
+  [[nodiscard]] id_t max_id() const noexcept {
+    return static_cast<id_t>(header_.min_id + header_.id_count - 1);
+  }
+
+  // Number of values, not counting unused IDs.
+  [[nodiscard]] size_t size() const noexcept { return header_.value_count; }
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+
+  // Get value by ID. Returns null if not found.
+  [[nodiscard]] opt_string_view get(id_t id) const noexcept {
+    const auto raw = static_cast<uint64_t>(*id);
+    const auto offset = raw - header_.min_id;
+    if (raw < header_.min_id || offset >= header_.id_count) return {};
+    return value_at(offset);
+  }
+
+  // Get ID by value. Returns `id_t{}` if not found.
+  [[nodiscard]] id_t get(std::string_view value) const noexcept {
+    const auto hash = hash_of(value);
+    const auto fragment = fragment_of(hash);
+    const auto mask = header_.index_capacity - 1;
+    for (auto slot = hash & mask;; slot = (slot + 1) & mask) {
+      const auto entry = load<uint32_t>(slots_, slot);
+      if (!entry) return id_t{};
+      if (load<uint32_t>(fragments_, slot) == fragment &&
+          value_at(entry - 1) == value)
+        return static_cast<id_t>(header_.min_id + entry - 1);
+    }
+  }
+
+  [[nodiscard]] opt_string_view operator()(id_t id) const noexcept {
+    return get(id);
+  }
+  [[nodiscard]] id_t operator()(std::string_view value) const noexcept {
+    return get(value);
+  }
+
+  // Invoke `f(id, value)` for each value, in ID order.
+  template<typename F>
+  void for_each(F&& f) const {
+    for (uint64_t offset = 0; offset < header_.id_count; ++offset)
+      if (auto value = value_at(offset))
+        f(static_cast<id_t>(header_.min_id + offset), *value);
+  }
+
+  // Make a writable table for the IDs after this image, chained to it.
+  template<typename TR = intern_traits<std::string, ID>>
+  [[nodiscard]] auto make_next(id_t max_id = id_t{}) const {
+    return std::make_shared<imaged_intern_table<ID, TR>>(
+        this->shared_from_this(), max_id);
+  }
+
+private:
+  std::span<const std::byte> image_;
+  std::shared_ptr<const void> owner_;
+  image_header header_{};
+  size_t ends_{};
+  size_t fragments_{};
+  size_t slots_{};
+  size_t blob_{};
+
+  [[nodiscard]] static constexpr uint64_t max_id_count() noexcept {
+    return static_cast<uint64_t>(
+        std::numeric_limits<as_underlying_t<id_t>>::max());
+  }
+
+  [[nodiscard]] static uint64_t hash_of(std::string_view value) noexcept {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const auto c : value) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+
+  [[nodiscard]] static uint32_t fragment_of(uint64_t hash) noexcept {
+    return static_cast<uint32_t>(hash >> 32);
+  }
+
+  static void append_bytes(std::string& out, const void* p, size_t size) {
+    out.append(static_cast<const char*>(p), size);
+  }
+
+  template<typename U>
+  [[nodiscard]] U load(size_t base, uint64_t index) const noexcept {
+    U u;
+    std::memcpy(&u, image_.data() + base + index * sizeof(U), sizeof(U));
+    return u;
+  }
+
+  // Returns the value at `offset`, or null if absent.
+  [[nodiscard]] opt_string_view value_at(uint64_t offset) const noexcept {
+    const auto end = load<uint64_t>(ends_, offset);
+    if (end & absent_bit) return {};
+    const auto begin = offset ? load<uint64_t>(ends_, offset - 1) & ~absent_bit
+                              : uint64_t{};
+    const auto data = reinterpret_cast<const char*>(image_.data() + blob_);
+    return opt_string_view{data + begin, static_cast<size_t>(end - begin)};
+  }
+};
+
+// Writable string intern table chained to a `string_intern_image`.
+//
+// Values in the image are found there, without copying, while new values
+// are interned in an `intern_table` whose IDs start after the image's. Since
+// the image can't hold `std::string` objects, values are returned as views.
+// Made by `string_intern_image::make_next`.
+template<SequentialEnum ID, typename TR>
+class imaged_intern_table {
+public:
+  using id_t = ID;
+  using image_t = string_intern_image<ID>;
+  using table_t = intern_table<std::string, ID, TR>;
+
+  imaged_intern_table(typename image_t::pointer image, id_t max_id = id_t{})
+      : image_{std::move(image)},
+        table_{table_t::make(static_cast<id_t>(*image_->max_id() + 1),
+            max_id)} {}
+
+  // Get value by ID. Returns null if not found.
+  [[nodiscard]] opt_string_view get(id_t id) const {
+    if (id <= image_->max_id()) return image_->get(id);
+    const auto iv = std::as_const(*table_).get(id);
+    return iv ? opt_string_view{iv.value()} : opt_string_view{};
+  }
+
+  // Get ID by value. Returns `id_t{}` if not found.
+  [[nodiscard]] id_t get(std::string_view value) const {
+    if (const auto id = image_->get(value); id != id_t{}) return id;
+    return std::as_const(*table_).get(value).id();
+  }
+
+  [[nodiscard]] opt_string_view operator()(id_t id) const { return get(id); }
+  [[nodiscard]] id_t operator()(std::string_view value) const {
+    return get(value);
+  }
+
+  // Interns a value, unless it's in the image. Returns `id_t{}` if the table
+  // is full.
+  [[nodiscard]] id_t intern(std::string_view value) {
+    if (const auto id = image_->get(value); id != id_t{}) return id;
+    return table_->intern(value).id();
+  }
+
+  // Invoke `f(id, value)` for each value, in ID order.
+  template<typename F>
+  void for_each(F&& f) const {
+    image_->for_each(f);
+    table_->for_each(f);
+  }
+
+  [[nodiscard]] const image_t& image() const noexcept { return *image_; }
+  [[nodiscard]] table_t& table() noexcept { return *table_; }
+  [[nodiscard]] const table_t& table() const noexcept { return *table_; }
+
+private:
+  typename image_t::pointer image_;
+  typename table_t::pointer table_;
+};
+
+}}} // namespace corvid::container::intern
@@ -0,0 +1,269 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "interval.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+namespace corvid { inline namespace intervals {
+
+//
+// interval_set
+//
+
+// Set of values, stored as the disjoint, coalesced `interval`s that cover
+// them.
+//
+// The intervals are kept sorted in a flat vector, so lookups are a binary
+// search over contiguous memory, and iteration is in order, as `interval`
+// values. Adjacent and overlapping intervals are merged on insert, and
+// intervals are split on erase. Finding where to insert or erase is
+// O(log n), although, as with any flat container, making room moves the
+// intervals after it. Union, intersection, and difference are linear merges.
+//
+// As with `interval`, the maximum value of `U` can't be contained.
+template<typename V = int64_t, typename U = as_underlying_t<V>>
+requires Integer<V> || StdEnum<V>
+class interval_set {
+public:
+  using interval_type = interval<V, U>;
+  using value_type = interval_type;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = const interval_type&;
+  using const_reference = const interval_type&;
+  using iterator = typename std::vector<interval_type>::const_iterator;
+  using const_iterator = iterator;
+
+  interval_set() = default;
+  interval_set(std::initializer_list<interval_type> intervals) {
+    for (const auto& i : intervals) insert(i);
+  }
+
+  // Iterators.
+  [[nodiscard]] iterator begin() const noexcept { return intervals_.begin(); }
+  [[nodiscard]] iterator end() const noexcept { return intervals_.end(); }
+  [[nodiscard]] iterator cbegin() const noexcept { return begin(); }
+  [[nodiscard]] iterator cend() const noexcept { return end(); }
+
+  // Accessors.
+
+  // Number of intervals.
+  [[nodiscard]] size_t size() const noexcept { return intervals_.size(); }
+  [[nodiscard]] bool empty() const noexcept { return intervals_.empty(); }
+
+  // Number of values in all the intervals.
+  [[nodiscard]] size_t value_count() const noexcept {
+    size_t n{};
+    for (const auto& i : intervals_) n += i.size();
+    return n;
+  }
+
+  [[nodiscard]] const interval_type& front() const noexcept {
+    return intervals_.front();
+  }
+  [[nodiscard]] const interval_type& back() const noexcept {
+    return intervals_.back();
+  }
+
+  // Interval containing `v`, or `end`.
+  [[nodiscard]] iterator find(V v) const noexcept {
+    const auto u = static_cast<U>(v);
+    const auto it = first_ending_at_or_after(u);
+    return it != end() && it->min() <= u ? it : end();
+  }
+
+  [[nodiscard]] bool contains(V v) const noexcept { return find(v) != end(); }
+
+  // Whether every value in `i` is contained. An empty interval always is.
+  [[nodiscard]] bool contains(const interval_type& i) const noexcept {
+    if (i.empty()) return true;
+    const auto it = find(static_cast<V>(i.min()));
+    return it != end() && it->max() >= i.max();
+  }
+
+  // Whether any value in `i` is contained.
+  [[nodiscard]] bool intersects(const interval_type& i) const noexcept {
+    if (i.empty()) return false;
+    const auto it = first_ending_at_or_after(i.min());
+    return it != end() && it->min() <= i.max();
+  }
+
+  // Modifiers.
+
+  // Insert `i`, merging it with any intervals it overlaps or adjoins.
+  // Returns the interval that now contains it, or `end` if it was empty.
+  iterator insert(const interval_type& i) {
+    if (i.empty()) return end();
+    auto lo = i.min();
+    auto hi = i.max();
+    auto first = intervals_.begin() + index_of(first_touching(lo));
+    const auto last = std::partition_point(first, intervals_.end(),
+        [&](const interval_type& r) { return r.min() <= hi + 1; });
+    if (first == last) return intervals_.insert(first, make(lo, hi));
+    lo = std::min(lo, first->min());
+    hi = std::max(hi, std::prev(last)->max());
+    *first = make(lo, hi);
+    return intervals_.erase(first + 1, last) - 1;
+  }
+  iterator insert(V v) { return insert(interval_type{v}); }
+
+  // Erase the values in `i`, splitting any interval that straddles it.
+  // Returns the number of values erased.
+  size_t erase(const interval_type& i) {
+    if (i.empty()) return 0;
+    const auto lo = i.min();
+    const auto hi = i.max();
+    auto first = intervals_.begin() + index_of(first_ending_at_or_after(lo));
+    const auto last = std::partition_point(first, intervals_.end(),
+        [&](const interval_type& r) { return r.min() <= hi; });
+    if (first == last) return 0;
+
+    size_t erased{};
+    for (auto it = first; it != last; ++it)
+      erased += static_cast<size_t>(std::min(hi, it->max()) -
+                                    std::max(lo, it->min())) +
+                1;
+
+    // Keep whatever sticks out on either side.
+    const bool keep_left = first->min() < lo;
+    const bool keep_right = std::prev(last)->max() > hi;
+    if (keep_left && keep_right && first + 1 == last) {
+      const auto right = make(hi + 1, first->max());
+      first->max(lo - 1);
+      intervals_.insert(first + 1, right);
+      return erased;
+    }
+    auto out = first;
+    if (keep_left) (out++)->max(lo - 1);
+    if (keep_right) *out++ = make(hi + 1, std::prev(last)->max());
+    intervals_.erase(out, last);
+    return erased;
+  }
+  size_t erase(V v) { return erase(interval_type{v}); }
+
+  void clear() noexcept { intervals_.clear(); }
+  void reserve(size_t n) { intervals_.reserve(n); }
+
+  // Set operations, each a single merge pass.
+
+  [[nodiscard]] friend interval_set
+  operator|(const interval_set& l, const interval_set& r) {
+    interval_set out;
+    out.intervals_.reserve(l.size() + r.size());
+    auto a = l.begin();
+    auto b = r.begin();
+    while (a != l.end() || b != r.end()) {
+      const bool take_a =
+          b == r.end() || (a != l.end() && a->min() < b->min());
+      const auto& next = take_a ? *a++ : *b++;
+      if (!out.empty() && next.min() <= out.intervals_.back().max() + 1) {
+        auto& last = out.intervals_.back();
+        if (next.max() > last.max()) last.max(next.max());
+      } else {
+        out.intervals_.push_back(next);
+      }
+    }
+    return out;
+  }
+
+  [[nodiscard]] friend interval_set
+  operator&(const interval_set& l, const interval_set& r) {
+    interval_set out;
+    auto a = l.begin();
+    auto b = r.begin();
+    while (a != l.end() && b != r.end()) {
+      const auto lo = std::max(a->min(), b->min());
+      const auto hi = std::min(a->max(), b->max());
+      if (lo <= hi) out.intervals_.push_back(make(lo, hi));
+      if (a->max() < b->max())
+        ++a;
+      else
+        ++b;
+    }
+    return out;
+  }
+
+  [[nodiscard]] friend interval_set
+  operator-(const interval_set& l, const interval_set& r) {
+    interval_set out;
+    auto b = r.begin();
+    for (const auto& i : l) {
+      auto lo = i.min();
+      const auto hi = i.max();
+      while (b != r.end() && b->max() < lo) ++b;
+      // Carve out each interval of `r` that overlaps this one.
+      auto cut = b;
+      for (; cut != r.end() && cut->min() <= hi; ++cut) {
+        if (cut->min() > lo)
+          out.intervals_.push_back(make(lo, cut->min() - 1));
+        if (cut->max() >= hi) break;
+        lo = cut->max() + 1;
+      }
+      if (cut == r.end() || cut->min() > hi)
+        out.intervals_.push_back(make(lo, hi));
+    }
+    return out;
+  }
+
+  interval_set& operator|=(const interval_set& r) {
+    return *this = *this | r;
+  }
+  interval_set& operator&=(const interval_set& r) {
+    return *this = *this & r;
+  }
+  interval_set& operator-=(const interval_set& r) {
+    return *this = *this - r;
+  }
+
+  [[nodiscard]] friend bool
+  operator==(const interval_set& l, const interval_set& r) noexcept {
+    return std::ranges::equal(l.intervals_, r.intervals_,
+        [](const interval_type& a, const interval_type& b) {
+          return a.min() == b.min() && a.max() == b.max();
+        });
+  }
+
+private:
+  std::vector<interval_type> intervals_;
+
+  [[nodiscard]] static interval_type make(U lo, U hi) noexcept {
+    interval_type i;
+    i.min(lo).max(hi);
+    return i;
+  }
+
+  [[nodiscard]] size_t index_of(iterator it) const noexcept {
+    return static_cast<size_t>(it - begin());
+  }
+
+  // First interval whose max is at least `u`.
+  [[nodiscard]] iterator first_ending_at_or_after(U u) const noexcept {
+    return std::partition_point(begin(), end(),
+        [&](const interval_type& r) { return r.max() < u; });
+  }
+
+  // First interval that overlaps or adjoins a value of at least `u`.
+  [[nodiscard]] iterator first_touching(U u) const noexcept {
+    return std::partition_point(begin(), end(),
+        [&](const interval_type& r) { return r.max() + 1 < u; });
+  }
+};
+
+}} // namespace corvid::intervals
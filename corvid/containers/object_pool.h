@@ -0,0 +1,291 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "containers_shared.h"
+#include "own_ptr.h"
+
+namespace corvid { inline namespace container { namespace pool {
+
+template<typename T>
+class object_pool;
+
+// Deleter for `own_ptr` that returns the object to its `object_pool` instead
+// of deleting it. A default-constructed one has no pool, so it may only be
+// used on null pointers.
+template<typename T>
+class pool_deleter {
+public:
+  pool_deleter() noexcept = default;
+  explicit pool_deleter(object_pool<T>& pool) noexcept : pool_{&pool} {}
+
+  void operator()(T* p) const noexcept {
+    if (!p) return;
+    assert(pool_);
+    pool_->release(p);
+  }
+
+  [[nodiscard]] object_pool<T>* pool() const noexcept { return pool_; }
+
+private:
+  object_pool<T>* pool_{};
+};
+
+// Owning pointer to an object from an `object_pool`.
+template<typename T>
+using pooled_ptr = own_ptr<T, pool_deleter<T>>;
+
+// Pool of objects of type `T`, for recycling those that are made and
+// destroyed at a high rate.
+//
+// `make` returns a `pooled_ptr`, whose deleter returns the object to the
+// pool. Without a reset function, the pool recycles storage: the object is
+// destroyed on return, and `make` constructs a new one in its place. With
+// one, the pool recycles the objects themselves: it resets them instead of
+// destroying them, and `make` hands back a returned object as is, only
+// constructing a new one from its arguments when none are available. This
+// keeps whatever the reset leaves alone, such as the capacity of a buffer.
+//
+// Each thread has its own free list for each pool, so making and returning
+// objects usually takes no lock. When a thread's list reaches twice the
+// batch size, it moves a batch to the pool's shared list, under a mutex, and
+// when its list is empty, it takes a whole batch back. So the lock is taken
+// about once per batch, and objects returned on a different thread than the
+// one that made them still find their way back. When a thread exits, its
+// lists are returned to their pools.
+//
+// Thread-safe. Neither copyable nor movable, since deleters refer to it by
+// address, and it must outlive the objects it makes. When it's destroyed,
+// the objects in other threads' lists are freed when those threads exit or
+// first use another pool of the same type.
+template<typename T>
+class object_pool {
+  friend class pool_deleter<T>;
+
+  struct block {
+    block* next;
+    alignas(T) std::byte storage[sizeof(T)];
+  };
+
+  // Singly-linked list of blocks.
+  struct batch {
+    block* head{};
+    size_t count{};
+  };
+
+  // Batches returned by threads. Owned jointly by the pool and, while
+  // they're exiting, by threads returning their lists.
+  struct shared_list {
+    explicit shared_list(bool live) noexcept : live{live} {}
+    ~shared_list() {
+      for (const auto& b : batches) free_blocks(b.head, live);
+    }
+
+    std::mutex mutex;
+    std::vector<batch> batches;
+    size_t count{};
+    const bool live;
+  };
+
+  // A thread's list for one pool, identified by ID, since a new pool may
+  // have the address of one that was destroyed.
+  struct thread_list {
+    uint64_t pool_id{};
+    std::weak_ptr<shared_list> shared;
+    batch free;
+    bool live{};
+  };
+
+  struct thread_lists {
+    std::vector<thread_list> lists;
+
+    ~thread_lists() {
+      exited_ = true;
+      for (auto& list : lists)
+        if (auto shared = list.shared.lock())
+          give(*shared, list.free);
+        else
+          free_blocks(list.free.head, list.live);
+    }
+  };
+
+public:
+  using value_type = T;
+  using reset_fn = void (*)(T&);
+
+  static constexpr size_t default_batch_size = 64;
+
+  // Construct with an optional `reset` function, which must not throw, and
+  // the number of objects to move between threads at a time.
+  explicit object_pool(reset_fn reset = nullptr,
+      size_t batch_size = default_batch_size)
+      : reset_{reset}, batch_size_{std::max<size_t>(batch_size, 1)},
+        shared_{std::make_shared<shared_list>(reset != nullptr)} {}
+
+  object_pool(const object_pool&) = delete;
+  object_pool& operator=(const object_pool&) = delete;
+
+  // Make an object, constructing it from `args` unless a reset one is
+  // available for reuse.
+  template<typename... Args>
+  [[nodiscard]] pooled_ptr<T> make(Args&&... args) {
+    auto b = take();
+    if (b && reset_) return wrap(b);
+    if (!b) b = new block;
+    try {
+      ::new (b->storage) T(std::forward<Args>(args)...);
+    }
+    catch (...) {
+      delete b;
+      throw;
+    }
+    return wrap(b);
+  }
+
+  [[nodiscard]] size_t batch_size() const noexcept { return batch_size_; }
+
+  // Number of objects on the calling thread's list for this pool.
+  [[nodiscard]] size_t local_count() noexcept {
+    const auto list = local();
+    return list ? list->free.count : 0;
+  }
+
+  // Number of objects on the shared list.
+  [[nodiscard]] size_t shared_count() const {
+    std::scoped_lock lock{shared_->mutex};
+    return shared_->count;
+  }
+
+private:
+  static inline std::atomic<uint64_t> next_id_{1};
+  static inline thread_local bool exited_{};
+
+  const reset_fn reset_;
+  const size_t batch_size_;
+  const uint64_t id_{next_id_.fetch_add(1, std::memory_order::relaxed)};
+  const std::shared_ptr<shared_list> shared_;
+
+  [[nodiscard]] static T* object_of(block* b) noexcept {
+    return std::launder(reinterpret_cast<T*>(b->storage));
+  }
+
+  [[nodiscard]] static block* block_of(T* p) noexcept {
+    return reinterpret_cast<block*>(
+        reinterpret_cast<std::byte*>(p) - offsetof(block, storage));
+  }
+
+  [[nodiscard]] pooled_ptr<T> wrap(block* b) noexcept {
+    return pooled_ptr<T>{object_of(b), pool_deleter<T>{*this}};
+  }
+
+  static void free_blocks(block* head, bool live) noexcept {
+    while (head) {
+      auto b = std::exchange(head, head->next);
+      if (live) object_of(b)->~T();
+      delete b;
+    }
+  }
+
+  // Move `b` to `shared`, or free it if that fails.
+  static void give(shared_list& shared, batch b) noexcept {
+    if (!b.head) return;
+    std::scoped_lock lock{shared.mutex};
+    try {
+      shared.batches.push_back(b);
+      shared.count += b.count;
+    }
+    catch (...) {
+      free_blocks(b.head, shared.live);
+    }
+  }
+
+  // Detach the first `n` blocks from `from`, which must have more.
+  [[nodiscard]] static batch split(batch& from, size_t n) noexcept {
+    assert(n && n < from.count);
+    batch out{from.head, n};
+    auto last = from.head;
+    for (size_t i = 1; i < n; ++i) last = last->next;
+    from.head = std::exchange(last->next, nullptr);
+    from.count -= n;
+    return out;
+  }
+
+  // The calling thread's list for this pool, or null if it's exiting or the
+  // list can't be made.
+  [[nodiscard]] thread_list* local() noexcept {
+    if (exited_) return nullptr;
+    static thread_local thread_lists tls;
+    auto& lists = tls.lists;
+    for (auto& list : lists)
+      if (list.pool_id == id_) return &list;
+    // Free the lists of pools that are gone before adding one.
+    std::erase_if(lists, [](const thread_list& list) {
+      if (!list.shared.expired()) return false;
+      free_blocks(list.free.head, list.live);
+      return true;
+    });
+    try {
+      lists.push_back({id_, shared_, {}, reset_ != nullptr});
+    }
+    catch (...) {
+      return nullptr;
+    }
+    return &lists.back();
+  }
+
+  // Take a block from the calling thread's list, refilling it from the
+  // shared list if necessary. Returns null if neither has any.
+  [[nodiscard]] block* take() {
+    const auto list = local();
+    if (!list) return nullptr;
+    auto& free = list->free;
+    if (!free.head) {
+      std::scoped_lock lock{shared_->mutex};
+      if (shared_->batches.empty()) return nullptr;
+      free = shared_->batches.back();
+      shared_->batches.pop_back();
+      shared_->count -= free.count;
+    }
+    --free.count;
+    return std::exchange(free.head, free.head->next);
+  }
+
+  void release(T* p) noexcept {
+    if (reset_)
+      reset_(*p);
+    else
+      p->~T();
+    const auto b = block_of(p);
+    const auto list = local();
+    if (!list) {
+      b->next = nullptr;
+      give(*shared_, {b, 1});
+      return;
+    }
+    auto& free = list->free;
+    b->next = std::exchange(free.head, b);
+    if (++free.count >= 2 * batch_size_)
+      give(*shared_, split(free, batch_size_));
+  }
+};
+
+}}} // namespace corvid::container::pool
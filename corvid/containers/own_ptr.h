@@ -200,7 +200,7 @@ public:
   requires is_move_constructible_deleter_v
   {
     if (this != &other) {
-      do_delete(ptr_) = std::exchange(other.ptr_, pointer{});
+      do_delete() = std::exchange(other.ptr_, pointer{});
       del_ = std::move(other.del_);
     }
     return *this;
@@ -212,7 +212,7 @@ public:
            std::is_assignable_v<deleter_type&, E&&>
   {
     if (this != &other) {
-      do_delete(ptr_) = std::exchange(other.ptr_, pointer{});
+      do_delete() = std::exchange(other.ptr_, pointer{});
       del_ = std::move(other.del_);
     }
     return *this;
@@ -228,7 +228,7 @@ public:
   }
 
   constexpr void reset(pointer&& ptr = pointer{}) {
-    do_delete(ptr_) = std::exchange(ptr, pointer{});
+    do_delete() = std::exchange(ptr, pointer{});
   }
 
   [[nodiscard]] constexpr pointer release() noexcept {
@@ -0,0 +1,202 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+#include "arena_allocator.h"
+
+#include <climits>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <streambuf>
+#include <string>
+
+namespace corvid { inline namespace container { namespace arena {
+
+// Stream buffer that appends into fixed-size chunks allocated from an
+// `extensible_arena`, keeping them all, so the contents are a rope of
+// chunks. Unlike a string, it never reallocates, so bytes are copied in
+// once and never again, and the peak footprint is the output plus at most
+// one partly-filled chunk.
+//
+// The contents are available as a list of spans, for gathering into
+// `iovec`s for `writev`, or can be flattened into a string on demand. The
+// arena must outlive the buffer and the spans; since arenas don't free, the
+// chunks are only reclaimed when the arena is reset or destroyed.
+//
+// If the arena can't allocate a chunk, the write fails, so the stream goes
+// bad.
+class rope_streambuf: public std::streambuf {
+public:
+  static constexpr size_t default_chunk_size = 64 * 1024;
+
+  // The chunk size is limited to `INT_MAX`, since `pbump` takes an int.
+  explicit rope_streambuf(extensible_arena& arena,
+      size_t chunk_size = default_chunk_size)
+      : arena_{&arena},
+        chunk_size_{std::clamp<size_t>(chunk_size, 1, INT_MAX)} {}
+
+  rope_streambuf(const rope_streambuf&) = delete;
+  rope_streambuf& operator=(const rope_streambuf&) = delete;
+
+  [[nodiscard]] size_t chunk_size() const noexcept { return chunk_size_; }
+
+  // Total size written.
+  [[nodiscard]] size_t size() const noexcept {
+    return filled_ + static_cast<size_t>(pptr() - pbase());
+  }
+
+  // The contents, in order. Every span but the last is a full chunk. The
+  // spans stay valid until `forget`, but the last one doesn't grow with
+  // later writes.
+  [[nodiscard]] std::vector<std::span<const char>> segments() const {
+    std::vector<std::span<const char>> out;
+    out.reserve(chunks_.size() + 1);
+    out.assign(chunks_.begin(), chunks_.end());
+    if (pptr() != pbase()) out.push_back(current());
+    return out;
+  }
+
+  // Append the contents to `target`, with a single allocation.
+  std::string& append_to(std::string& target) const {
+    target.reserve(target.size() + size());
+    for (auto chunk : chunks_) target.append(chunk.data(), chunk.size());
+    const auto last = current();
+    return target.append(last.data(), last.size());
+  }
+
+  // Return the contents as a single string.
+  [[nodiscard]] std::string flatten() const {
+    std::string out;
+    append_to(out);
+    return out;
+  }
+
+  // Forget the contents, so that the next write starts a new chunk. Doesn't
+  // free the chunks, which belong to the arena.
+  void forget() noexcept {
+    chunks_.clear();
+    filled_ = 0;
+    setp(nullptr, nullptr);
+  }
+
+protected:
+  int_type overflow(int_type ch) override {
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+      return traits_type::not_eof(ch);
+    if (!next_chunk()) return traits_type::eof();
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    std::streamsize done = 0;
+    while (done < n) {
+      if (pptr() == epptr() && !next_chunk()) break;
+      const auto len = std::min(n - done, std::streamsize{epptr() - pptr()});
+      traits_type::copy(pptr(), s + done, static_cast<size_t>(len));
+      pbump(static_cast<int>(len));
+      done += len;
+    }
+    return done;
+  }
+
+private:
+  extensible_arena* arena_;
+  size_t chunk_size_;
+  std::vector<std::span<const char>> chunks_;
+  size_t filled_{};
+
+  [[nodiscard]] std::span<const char> current() const noexcept {
+    return {pbase(), static_cast<size_t>(pptr() - pbase())};
+  }
+
+  // Keep the current chunk, if any, and start a new one. Returns false if
+  // the arena is exhausted.
+  bool next_chunk() {
+    if (const auto last = current(); !last.empty()) {
+      chunks_.push_back(last);
+      filled_ += last.size();
+    }
+    setp(nullptr, nullptr);
+    extensible_arena::scope scope{*arena_};
+    const auto p =
+        static_cast<char*>(extensible_arena::allocate(chunk_size_, 1));
+    if (!p) return false;
+    setp(p, p + chunk_size_);
+    return true;
+  }
+};
+
+// Output stream that appends to a rope of arena chunks, through a
+// `rope_streambuf`, for building very large outputs without reallocating.
+//
+// Since it's a `std::ostream`, it's an AppendTarget, so the `append` and
+// `append_join` functions work with it. It either owns its arena, with a
+// block for each chunk, or uses one that's passed in.
+//
+// Usage:
+//   rope_ostream os;
+//   strings::append_json(os, huge_map);
+//   for (auto segment : os.segments()) ... // Gather into iovecs for writev.
+class rope_ostream: public std::ostream {
+public:
+  static constexpr size_t default_chunk_size =
+      rope_streambuf::default_chunk_size;
+
+  explicit rope_ostream(size_t chunk_size = default_chunk_size)
+      : std::ostream{nullptr},
+        owned_{std::make_unique<extensible_arena>(
+            arena_options{.block_size = std::max<size_t>(chunk_size, 1)})},
+        buf_{*owned_, chunk_size} {
+    rdbuf(&buf_);
+  }
+
+  // Allocate chunks from `arena`, which must outlive this.
+  explicit rope_ostream(extensible_arena& arena,
+      size_t chunk_size = default_chunk_size)
+      : std::ostream{nullptr}, buf_{arena, chunk_size} {
+    rdbuf(&buf_);
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return buf_.size(); }
+
+  [[nodiscard]] std::vector<std::span<const char>> segments() const {
+    return buf_.segments();
+  }
+
+  std::string& append_to(std::string& target) const {
+    return buf_.append_to(target);
+  }
+
+  [[nodiscard]] std::string flatten() const { return buf_.flatten(); }
+
+  // Discard the contents and clear the stream state. If the arena is owned,
+  // it's reset, so its blocks are reused.
+  void reset() noexcept {
+    buf_.forget();
+    if (owned_) owned_->reset();
+    clear();
+  }
+
+private:
+  std::unique_ptr<extensible_arena> owned_;
+  rope_streambuf buf_;
+};
+
+}}} // namespace corvid::container::arena
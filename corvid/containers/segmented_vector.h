@@ -0,0 +1,358 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <memory>
+
+namespace corvid { inline namespace container { inline namespace segmented {
+
+// Append-only sequence with stable addresses.
+//
+// Elements are stored in fixed-size segments of `N` elements, where `N` is a
+// power of two, and the segments are indexed by a vector of pointers. So
+// indexing is a shift, a mask, and two dependent loads, while appending never
+// moves an element. Only the vector of pointers is ever reallocated.
+//
+// Intended as a lighter-weight alternative to `std::deque` for tables that
+// are only appended to and need addresses to remain valid, such as the values
+// of an `intern_table`. Elements can't be erased except all at once, by
+// `clear`.
+//
+// Uses `A` for both the segments and the vector of pointers, so it works with
+// `arena_allocator`.
+template<typename T, size_t N = 64, typename A = std::allocator<T>>
+class segmented_vector {
+  static_assert(std::has_single_bit(N), "Segment size must be a power of 2");
+
+  using traits = std::allocator_traits<A>;
+  using pointer_allocator = typename traits::template rebind_alloc<T*>;
+
+  static constexpr size_t shift = std::countr_zero(N);
+  static constexpr size_t mask = N - 1;
+
+public:
+  using value_type = T;
+  using allocator_type = A;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  static constexpr size_t segment_size = N;
+
+  template<bool is_const>
+  class basic_iterator {
+    using owner_t =
+        std::conditional_t<is_const, const segmented_vector, segmented_vector>;
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<is_const, const T*, T*>;
+    using reference = std::conditional_t<is_const, const T&, T&>;
+
+    basic_iterator() noexcept = default;
+    basic_iterator(owner_t* owner, size_t index) noexcept
+        : owner_{owner}, index_{index} {}
+    operator basic_iterator<true>() const noexcept
+    requires(!is_const)
+    {
+      return {owner_, index_};
+    }
+
+    reference operator*() const noexcept { return (*owner_)[index_]; }
+    pointer operator->() const noexcept { return &(*owner_)[index_]; }
+    reference operator[](difference_type n) const noexcept {
+      return (*owner_)[index_ + n];
+    }
+
+    basic_iterator& operator++() noexcept {
+      ++index_;
+      return *this;
+    }
+    basic_iterator operator++(int) noexcept {
+      auto old = *this;
+      ++index_;
+      return old;
+    }
+    basic_iterator& operator--() noexcept {
+      --index_;
+      return *this;
+    }
+    basic_iterator operator--(int) noexcept {
+      auto old = *this;
+      --index_;
+      return old;
+    }
+    basic_iterator& operator+=(difference_type n) noexcept {
+      index_ += n;
+      return *this;
+    }
+    basic_iterator& operator-=(difference_type n) noexcept {
+      index_ -= n;
+      return *this;
+    }
+    friend basic_iterator
+    operator+(basic_iterator it, difference_type n) noexcept {
+      return it += n;
+    }
+    friend basic_iterator
+    operator+(difference_type n, basic_iterator it) noexcept {
+      return it += n;
+    }
+    friend basic_iterator
+    operator-(basic_iterator it, difference_type n) noexcept {
+      return it -= n;
+    }
+    friend difference_type
+    operator-(const basic_iterator& l, const basic_iterator& r) noexcept {
+      return static_cast<difference_type>(l.index_) -
+             static_cast<difference_type>(r.index_);
+    }
+    friend bool
+    operator==(const basic_iterator& l, const basic_iterator& r) noexcept {
+      return l.index_ == r.index_;
+    }
+    friend auto
+    operator<=>(const basic_iterator& l, const basic_iterator& r) noexcept {
+      return l.index_ <=> r.index_;
+    }
+
+  private:
+    owner_t* owner_{};
+    size_t index_{};
+  };
+
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  segmented_vector() = default;
+  explicit segmented_vector(const A& alloc)
+      : alloc_{alloc}, segments_{pointer_allocator{alloc}} {}
+
+  segmented_vector(const segmented_vector&) = delete;
+  segmented_vector& operator=(const segmented_vector&) = delete;
+
+  ~segmented_vector() { clear(); }
+
+  // Accessors.
+  [[nodiscard]] size_t size() const noexcept { return size_; }
+  [[nodiscard]] bool empty() const noexcept { return !size_; }
+  [[nodiscard]] size_t capacity() const noexcept {
+    return segments_.size() * N;
+  }
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return alloc_;
+  }
+
+  [[nodiscard]] T& operator[](size_t index) noexcept {
+    return segments_[index >> shift][index & mask];
+  }
+  [[nodiscard]] const T& operator[](size_t index) const noexcept {
+    return segments_[index >> shift][index & mask];
+  }
+
+  [[nodiscard]] T& at(size_t index) {
+    if (index >= size_) throw std::out_of_range("segmented_vector::at");
+    return (*this)[index];
+  }
+  [[nodiscard]] const T& at(size_t index) const {
+    if (index >= size_) throw std::out_of_range("segmented_vector::at");
+    return (*this)[index];
+  }
+
+  [[nodiscard]] T& front() noexcept { return (*this)[0]; }
+  [[nodiscard]] const T& front() const noexcept { return (*this)[0]; }
+  [[nodiscard]] T& back() noexcept { return (*this)[size_ - 1]; }
+  [[nodiscard]] const T& back() const noexcept { return (*this)[size_ - 1]; }
+
+  // Iterators.
+  [[nodiscard]] iterator begin() noexcept { return {this, 0}; }
+  [[nodiscard]] iterator end() noexcept { return {this, size_}; }
+  [[nodiscard]] const_iterator begin() const noexcept { return {this, 0}; }
+  [[nodiscard]] const_iterator end() const noexcept { return {this, size_}; }
+  [[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
+  [[nodiscard]] const_iterator cend() const noexcept { return end(); }
+
+  // Modifiers.
+
+  // Construct a new element at the end. Never moves existing elements.
+  template<typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (size_ == capacity()) add_segment();
+    auto& slot = (*this)[size_];
+    traits::construct(alloc_, &slot, std::forward<Args>(args)...);
+    ++size_;
+    return slot;
+  }
+
+  T& push_back(const T& value) { return emplace_back(value); }
+  T& push_back(T&& value) { return emplace_back(std::move(value)); }
+
+  // Ensure capacity for at least `count` elements.
+  void reserve(size_t count) {
+    segments_.reserve((count + mask) >> shift);
+    while (capacity() < count) add_segment();
+  }
+
+  // Destroy all elements and free all segments.
+  void clear() noexcept {
+    for (size_t i = size_; i > 0; --i)
+      traits::destroy(alloc_, &(*this)[i - 1]);
+    for (auto segment : segments_) traits::deallocate(alloc_, segment, N);
+    segments_.clear();
+    size_ = 0;
+  }
+
+private:
+  [[no_unique_address]] A alloc_;
+  std::vector<T*, pointer_allocator> segments_;
+  size_t size_{};
+
+  void add_segment() {
+    auto segment = traits::allocate(alloc_, N);
+    try {
+      segments_.push_back(segment);
+    } catch (...) {
+      traits::deallocate(alloc_, segment, N);
+      throw;
+    }
+  }
+};
+
+// Append-only sequence with stable addresses, where reads are lock-free and
+// may run in any number of threads, while appends are serialized by the
+// caller.
+//
+// Unlike `segmented_vector`, the segments double in size, so there are never
+// more than 64 of them, and their pointers fit in a fixed array that is never
+// reallocated. The first segment holds `N` elements, and each one after
+// holds as many as all before it. An append constructs the element, then
+// publishes the new size with a release store, so a reader that gets an
+// index below `size()` sees the constructed element.
+//
+// Elements can't be erased except all at once, when destroyed.
+template<typename T, size_t N = 64, typename A = std::allocator<T>>
+class concurrent_segmented_vector {
+  static_assert(std::has_single_bit(N), "Segment size must be a power of 2");
+
+  using traits = std::allocator_traits<A>;
+
+  static constexpr size_t shift = std::countr_zero(N);
+  static constexpr size_t max_segments = 64 - shift + 1;
+
+public:
+  using value_type = T;
+  using allocator_type = A;
+  using size_type = std::size_t;
+  using reference = T&;
+  using const_reference = const T&;
+
+  // Marks this as safe to read without a lock, for `intern_table`.
+  static constexpr bool is_concurrent = true;
+
+  concurrent_segmented_vector() = default;
+  explicit concurrent_segmented_vector(const A& alloc) : alloc_{alloc} {}
+
+  concurrent_segmented_vector(const concurrent_segmented_vector&) = delete;
+  concurrent_segmented_vector&
+  operator=(const concurrent_segmented_vector&) = delete;
+
+  ~concurrent_segmented_vector() {
+    const auto n = size();
+    for (size_t i = n; i > 0; --i) traits::destroy(alloc_, &(*this)[i - 1]);
+    for (size_t k = 0; k < max_segments; ++k)
+      if (auto segment = segments_[k].load(std::memory_order::relaxed))
+        traits::deallocate(alloc_, segment, segment_capacity(k));
+  }
+
+  // Accessors.
+
+  // Number of published elements.
+  [[nodiscard]] size_t size() const noexcept {
+    return size_.load(std::memory_order::acquire);
+  }
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return alloc_;
+  }
+
+  // Index must be below a value returned by `size`.
+  [[nodiscard]] T& operator[](size_t index) noexcept {
+    const auto [k, offset] = locate(index);
+    return segments_[k].load(std::memory_order::acquire)[offset];
+  }
+  [[nodiscard]] const T& operator[](size_t index) const noexcept {
+    const auto [k, offset] = locate(index);
+    return segments_[k].load(std::memory_order::acquire)[offset];
+  }
+
+  [[nodiscard]] T& at(size_t index) {
+    if (index >= size())
+      throw std::out_of_range("concurrent_segmented_vector::at");
+    return (*this)[index];
+  }
+  [[nodiscard]] const T& at(size_t index) const {
+    if (index >= size())
+      throw std::out_of_range("concurrent_segmented_vector::at");
+    return (*this)[index];
+  }
+
+  // Modifiers.
+
+  // Construct a new element at the end and publish it. Never moves existing
+  // elements. Calls must be serialized.
+  template<typename... Args>
+  T& emplace_back(Args&&... args) {
+    const auto n = size_.load(std::memory_order::relaxed);
+    const auto [k, offset] = locate(n);
+    auto segment = segments_[k].load(std::memory_order::relaxed);
+    if (!segment) {
+      segment = traits::allocate(alloc_, segment_capacity(k));
+      segments_[k].store(segment, std::memory_order::release);
+    }
+    auto& slot = segment[offset];
+    traits::construct(alloc_, &slot, std::forward<Args>(args)...);
+    size_.store(n + 1, std::memory_order::release);
+    return slot;
+  }
+
+  T& push_back(const T& value) { return emplace_back(value); }
+  T& push_back(T&& value) { return emplace_back(std::move(value)); }
+
+private:
+  [[no_unique_address]] A alloc_;
+  std::array<std::atomic<T*>, max_segments> segments_{};
+  std::atomic<size_t> size_{};
+
+  [[nodiscard]] static constexpr size_t segment_capacity(size_t k) noexcept {
+    return k ? N << (k - 1) : N;
+  }
+
+  // Returns the segment and the offset within it.
+  [[nodiscard]] static constexpr std::pair<size_t, size_t>
+  locate(size_t index) noexcept {
+    const size_t k = std::bit_width(index >> shift);
+    return {k, k ? index - (N << (k - 1)) : index};
+  }
+};
+
+}}} // namespace corvid::container::segmented
@@ -0,0 +1,302 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "timers.h"
+
+namespace corvid { inline namespace container { namespace timers_ns {
+
+// Timers sharded across threads, with callbacks run by a work-stealing
+// executor.
+//
+// Each shard is a `basic_timers<Q>` serviced by its own thread, by default
+// one per hardware thread. A timer is set on the shard of the calling thread,
+// when that's one of ours, so that timers set from callbacks stay local, and
+// otherwise on the shards in turn. Each shard tags the low bits of the IDs it
+// assigns with its index, so `cancel` goes straight to the owning shard's
+// lock-free submission queue, from any thread.
+//
+// When a shard's timers expire, it collects them with `tick_batch` and
+// pushes all but the first onto its work queue, where idle shards steal them,
+// while it runs the first and then the rest that weren't stolen. So a slow
+// callback delays only the batch it's in, rather than every other timer. The
+// shard waits for the whole batch before rescheduling, so the callback
+// contract is the same as for `tick`: a callback may modify `next_at`,
+// `callbacks`, and `user_data`, and its event remains valid until it returns.
+// Callbacks in a batch may run concurrently, though, so any state they share
+// must be synchronized.
+//
+// Timers can only be set and canceled through this class, never on a shard
+// directly, and since requests are applied by the shard's thread, they're
+// asynchronous, as with `submit_set` and `submit_cancel`.
+template<typename Q = scheduled_queue_t>
+class basic_sharded_timers {
+public:
+  // Start `shard_count` shards, or one per hardware thread if 0. The clock
+  // callback, if any, must be safe to call from any thread.
+  explicit basic_sharded_timers(size_t shard_count = 0,
+      clock_callback_t clock_callback = {}) {
+    if (!shard_count) shard_count = std::thread::hardware_concurrency();
+    shard_count = std::max<size_t>(shard_count, 1);
+    tag_bits_ = std::bit_width(shard_count - 1);
+    shards_.reserve(shard_count);
+    for (size_t index = 0; index < shard_count; ++index) {
+      auto& s = *shards_.emplace_back(std::make_unique<shard>());
+      s.timers.set_id_tag(tag_bits_, index);
+      if (clock_callback) s.timers.set_clock_callback(clock_callback);
+    }
+    for (size_t index = 0; index < shard_count; ++index)
+      shards_[index]->thread = std::jthread{[this, index] { run(index); }};
+  }
+
+  basic_sharded_timers(const basic_sharded_timers&) = delete;
+  basic_sharded_timers& operator=(const basic_sharded_timers&) = delete;
+
+  // Stop and join the shards. Timers that haven't fired are discarded.
+  ~basic_sharded_timers() {
+    stopping_.store(true, std::memory_order::release);
+    for (auto& s : shards_) wake(*s);
+    for (auto& s : shards_) s->thread.join();
+  }
+
+  // Get current time according to the registered clock callback.
+  [[nodiscard]] auto get_now() const { return shards_[0]->timers.get_now(); }
+
+  [[nodiscard]] size_t shard_count() const noexcept { return shards_.size(); }
+
+  // Shard that a timer was set on, or `shard_count()` if the ID's tag names
+  // no shard, which can happen when the count isn't a power of two.
+  [[nodiscard]] size_t shard_of(timer_id_t timer_id) const noexcept {
+    return std::min(
+        static_cast<size_t>(timer_id) & ((uint64_t{1} << tag_bits_) - 1),
+        shards_.size());
+  }
+
+  // Set timer for a new event, on the calling thread's shard, if it's one of
+  // ours, or else on the next shard in turn. Returns its ID. May be called
+  // from any thread. See `basic_timers::set` for the parameters.
+  timer_id_t set(time_point_t start_at, timer_callback_t callback,
+      duration_t repeat_in = {}, time_point_t stop_at = {},
+      duration_t slack = {}) {
+    return set_on(pick_shard(), start_at, std::move(callback), repeat_in,
+        stop_at, slack);
+  }
+
+  timer_id_t set(duration_t start_in, timer_callback_t callback,
+      duration_t repeat_in = {}, duration_t stop_in = {},
+      duration_t slack = {}) {
+    const auto now = get_now();
+    const auto stop_at =
+        (stop_in == duration_t{}) ? time_point_t{} : now + stop_in;
+    return set(now + start_in, std::move(callback), repeat_in, stop_at,
+        slack);
+  }
+
+  // Same as `set`, but on a specific shard, modulo the shard count.
+  timer_id_t set_on(size_t shard_index, time_point_t start_at,
+      timer_callback_t callback, duration_t repeat_in = {},
+      time_point_t stop_at = {}, duration_t slack = {}) {
+    auto& s = *shards_[shard_index % shards_.size()];
+    const auto timer_id = s.timers.submit_set(start_at, std::move(callback),
+        repeat_in, stop_at, slack);
+    wake(s);
+    return timer_id;
+  }
+
+  // Cancel a timer. May be called from any thread, and never blocks. It takes
+  // effect when its shard next wakes, so the timer may still fire until then.
+  // An ID that no shard could have issued is ignored.
+  void cancel(timer_id_t timer_id) {
+    const auto index = shard_of(timer_id);
+    if (index == shards_.size()) return;
+    auto& s = *shards_[index];
+    s.timers.submit_cancel(timer_id);
+    wake(s);
+  }
+
+  // Totals across shards of callbacks invoked and of those stolen from
+  // another shard.
+  [[nodiscard]] size_t callbacks() const noexcept {
+    return total(&shard::callbacks);
+  }
+  [[nodiscard]] size_t stolen() const noexcept {
+    return total(&shard::stolen);
+  }
+
+private:
+  struct shard;
+
+  // Expired event to run, from the batch of shard `owner`.
+  struct task {
+    timer_event* event{};
+    shard* owner{};
+  };
+
+  struct shard {
+    basic_timers<Q> timers;
+
+    // Wakes the thread, at most once per time `signaled` is cleared.
+    std::counting_semaphore<> wakeup{0};
+    std::atomic<bool> signaled{};
+
+    // Work queue of the current batch. The owner takes from the back, while
+    // thieves take from the front.
+    std::mutex work_mutex;
+    std::deque<task> work;
+    // Number of tasks in the current batch that haven't finished. Owned by
+    // the shard, rather than the batch, so that a thief can safely notify it
+    // after the owner has moved on.
+    std::atomic<size_t> pending{};
+
+    std::atomic<size_t> callbacks{};
+    std::atomic<size_t> stolen{};
+    std::jthread thread;
+  };
+
+  // Shard whose thread is the current one, if any.
+  static inline thread_local const basic_sharded_timers* current_owner{};
+  static inline thread_local size_t current_shard{};
+
+  std::vector<std::unique_ptr<shard>> shards_;
+  size_t tag_bits_{};
+  std::atomic<size_t> next_shard_{};
+  std::atomic<bool> stopping_{};
+
+  [[nodiscard]] size_t pick_shard() noexcept {
+    if (current_owner == this) return current_shard;
+    return next_shard_.fetch_add(1, std::memory_order::relaxed);
+  }
+
+  static void wake(shard& s) {
+    if (!s.signaled.exchange(true, std::memory_order::acq_rel))
+      s.wakeup.release();
+  }
+
+  [[nodiscard]] size_t
+  total(std::atomic<size_t> shard::* counter) const noexcept {
+    size_t sum{};
+    for (const auto& s : shards_)
+      sum += ((*s).*counter).load(std::memory_order::relaxed);
+    return sum;
+  }
+
+  // Service loop for shard `index`.
+  void run(size_t index) {
+    current_owner = this;
+    current_shard = index;
+    auto& s = *shards_[index];
+    while (!stopping_.load(std::memory_order::acquire)) {
+      s.signaled.store(false, std::memory_order::release);
+      s.timers.tick_batch(
+          [&](std::span<timer_event* const> batch) { run_batch(s, batch); });
+      while (steal(index)) {}
+
+      // Sleep until the next timer is due or we're woken. Waking early is
+      // harmless, and quantized schedulers may claim to be due up to a tick
+      // before they are, so we never sleep for less than that.
+      const auto wait = s.timers.next_in(duration_t::max());
+      if (wait == duration_t::max())
+        s.wakeup.acquire();
+      else
+        (void)s.wakeup.try_acquire_for(std::max(wait, duration_t{1}));
+    }
+  }
+
+  // Run the batch, sharing all but the first event with idle shards, and
+  // return only when every event has been run.
+  void run_batch(shard& s, std::span<timer_event* const> batch) {
+    if (batch.size() > 1) {
+      s.pending.store(batch.size() - 1, std::memory_order::relaxed);
+      {
+        std::lock_guard lock{s.work_mutex};
+        for (auto event : batch.subspan(1)) s.work.push_back({event, &s});
+      }
+      for (auto& other : shards_)
+        if (other.get() != &s) wake(*other);
+    }
+    fire(s, *batch[0]);
+    if (batch.size() == 1) return;
+
+    for (;;) {
+      task t;
+      {
+        std::lock_guard lock{s.work_mutex};
+        if (s.work.empty()) break;
+        t = s.work.back();
+        s.work.pop_back();
+      }
+      finish(s, t);
+    }
+    for (auto n = s.pending.load(std::memory_order::acquire); n;
+         n = s.pending.load(std::memory_order::acquire))
+      s.pending.wait(n, std::memory_order::acquire);
+  }
+
+  // Steal and run one task from another shard. Returns whether there was one.
+  bool steal(size_t index) {
+    for (size_t offset = 1; offset < shards_.size(); ++offset) {
+      auto& victim = *shards_[(index + offset) % shards_.size()];
+      task t;
+      {
+        std::lock_guard lock{victim.work_mutex};
+        if (victim.work.empty()) continue;
+        t = victim.work.front();
+        victim.work.pop_front();
+      }
+      auto& thief = *shards_[index];
+      thief.stolen.fetch_add(1, std::memory_order::relaxed);
+      finish(thief, t);
+      return true;
+    }
+    return false;
+  }
+
+  // Run the task on shard `s` and count it as done for its owner.
+  static void finish(shard& s, const task& t) {
+    fire(s, *t.event);
+    if (t.owner->pending.fetch_sub(1, std::memory_order::acq_rel) == 1)
+      t.owner->pending.notify_all();
+  }
+
+  static void fire(shard& s, timer_event& event) {
+    event.callback(event);
+    s.callbacks.fetch_add(1, std::memory_order::relaxed);
+  }
+};
+
+// Sharded timers, each scheduled by binary heap.
+using sharded_timers = basic_sharded_timers<scheduled_heap>;
+
+// Sharded timers, each scheduled by hierarchical timing wheel.
+using sharded_wheel_timers = basic_sharded_timers<scheduled_wheel>;
+} // namespace timers_ns
+
+// Exported types.
+using sharded_timers = timers_ns::sharded_timers;
+using sharded_wheel_timers = timers_ns::sharded_wheel_timers;
+
+}} // namespace corvid::container
@@ -0,0 +1,173 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+
+#include <cstddef>
+#include <functional>
+
+namespace corvid { inline namespace container { inline namespace smallfunc {
+
+// Default inline capacity of `small_function`, in bytes. Large enough for a
+// lambda that captures a handful of references or for a `std::function`.
+inline constexpr size_t small_function_size = 6 * sizeof(void*);
+
+template<typename Sig, size_t N = small_function_size>
+class small_function;
+
+// Move-only, type-erased callable with inline storage.
+//
+// Mostly a drop-in replacement for `std::function`, except that it can't be
+// copied, so it can hold move-only callables. Any callable that fits in `N`
+// bytes and is nothrow-movable is stored inline, with no allocation. Larger
+// callables fall back to the heap, just as they would with `std::function`,
+// so choose `N` to fit the callables you use on hot paths.
+//
+// As with `std::function`, `operator()` is `const` even though it may invoke
+// a mutable target, and calling an empty instance throws
+// `std::bad_function_call`.
+template<typename R, typename... Args, size_t N>
+class small_function<R(Args...), N> {
+  static_assert(N >= sizeof(void*));
+
+  // Whether `F` can be stored inline, as opposed to on the heap.
+  template<typename F>
+  static constexpr bool is_inline_v =
+      sizeof(F) <= N && alignof(F) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible_v<F>;
+
+public:
+  using result_type = R;
+  static constexpr size_t inline_size = N;
+
+  small_function() noexcept = default;
+  small_function(std::nullptr_t) noexcept {}
+
+  template<typename F>
+  requires(!std::is_same_v<std::remove_cvref_t<F>, small_function> &&
+           std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+  small_function(F&& f) {
+    emplace<std::decay_t<F>>(std::forward<F>(f));
+  }
+
+  small_function(small_function&& other) noexcept { steal(other); }
+  small_function& operator=(small_function&& other) noexcept {
+    if (this != &other) {
+      reset();
+      steal(other);
+    }
+    return *this;
+  }
+
+  small_function& operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  template<typename F>
+  requires(!std::is_same_v<std::remove_cvref_t<F>, small_function> &&
+           std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+  small_function& operator=(F&& f) {
+    reset();
+    emplace<std::decay_t<F>>(std::forward<F>(f));
+    return *this;
+  }
+
+  small_function(const small_function&) = delete;
+  small_function& operator=(const small_function&) = delete;
+
+  ~small_function() { reset(); }
+
+  R operator()(Args... args) const {
+    if (!ops_) throw std::bad_function_call{};
+    return ops_->invoke(storage_, std::forward<Args>(args)...);
+  }
+
+  [[nodiscard]] explicit operator bool() const noexcept { return ops_; }
+
+  // Whether the target, if any, is stored inline.
+  [[nodiscard]] bool is_inline() const noexcept {
+    return !ops_ || ops_->is_inline;
+  }
+
+  void reset() noexcept {
+    if (ops_) std::exchange(ops_, nullptr)->destroy(storage_);
+  }
+
+  friend bool operator==(const small_function& f, std::nullptr_t) noexcept {
+    return !f;
+  }
+
+private:
+  // Operations on the stored target, one static instance per target type.
+  struct ops_t {
+    R (*invoke)(void* storage, Args&&... args);
+    void (*move)(void* to, void* from) noexcept;
+    void (*destroy)(void* storage) noexcept;
+    bool is_inline;
+  };
+
+  template<typename F>
+  static constexpr ops_t inline_ops{
+      [](void* storage, Args&&... args) -> R {
+        return std::invoke(*static_cast<F*>(storage),
+            std::forward<Args>(args)...);
+      },
+      [](void* to, void* from) noexcept {
+        auto& f = *static_cast<F*>(from);
+        new (to) F(std::move(f));
+        f.~F();
+      },
+      [](void* storage) noexcept { static_cast<F*>(storage)->~F(); },
+      true};
+
+  template<typename F>
+  static constexpr ops_t heap_ops{
+      [](void* storage, Args&&... args) -> R {
+        return std::invoke(**static_cast<F**>(storage),
+            std::forward<Args>(args)...);
+      },
+      [](void* to, void* from) noexcept {
+        *static_cast<F**>(to) = std::exchange(*static_cast<F**>(from), {});
+      },
+      [](void* storage) noexcept { delete *static_cast<F**>(storage); },
+      false};
+
+  template<typename F, typename U>
+  void emplace(U&& u) {
+    if constexpr (std::is_pointer_v<F> || std::is_member_pointer_v<F>)
+      if (!u) return;
+    if constexpr (is_inline_v<F>) {
+      new (storage_) F(std::forward<U>(u));
+      ops_ = &inline_ops<F>;
+    } else {
+      *reinterpret_cast<F**>(storage_) = new F(std::forward<U>(u));
+      ops_ = &heap_ops<F>;
+    }
+  }
+
+  void steal(small_function& other) noexcept {
+    if (!other.ops_) return;
+    other.ops_->move(storage_, other.storage_);
+    ops_ = std::exchange(other.ops_, nullptr);
+  }
+
+  alignas(std::max_align_t) mutable std::byte storage_[N];
+  const ops_t* ops_{};
+};
+
+}}} // namespace corvid::container::smallfunc
@@ -0,0 +1,189 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "containers_shared.h"
+#include "flat_index.h"
+#include "intern.h"
+#include "../strings/cstring_view.h"
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace corvid { inline namespace container { inline namespace intern {
+
+// Compact, append-only pool of unique strings, indexed by `ID`.
+//
+// Where `intern_table<std::string, ID>` stores each value as an
+// `arena_string`, which costs a 32-byte header even for a short token, this
+// stores all of the characters in a single contiguous blob and, for each ID,
+// just a packed `(offset, size)` pair of 32-bit integers. The values are
+// looked up by a `flat_id_index`, so a million short tokens cost close to
+// their byte length, plus the 8-byte pair and, for a 32-bit ID, 10 to 20
+// bytes of index each.
+//
+// Each value is followed by a terminator in the blob, so `get` returns a
+// `cstring_view`. Since the blob is contiguous, it moves when it grows, so,
+// unlike with `intern_table`, the views are only valid until the next call
+// to `intern` that adds a value, much like iterators into a `std::vector`.
+// The ID is the stable handle. Calling `reserve` up front avoids the moves.
+//
+// The layout matches that of `string_intern_image`, and `for_each` has the
+// same signature, so a pool can be serialized into an image directly.
+//
+// Not synchronized. The blob is limited to 4 GiB.
+template<SequentialEnum ID, typename A = std::allocator<char>>
+class string_pool {
+  struct extent {
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  using traits = std::allocator_traits<A>;
+  using extent_allocator = typename traits::template rebind_alloc<extent>;
+  using id_allocator = typename traits::template rebind_alloc<ID>;
+
+public:
+  using id_t = ID;
+  using allocator_type = A;
+
+  // Make a pool for a range of IDs. If unspecified, `min_id` defaults to 1
+  // and `max_id` to one less than the max of the underlying type, as with
+  // `intern_table::make`.
+  explicit string_pool(id_t min_id = id_t{}, id_t max_id = id_t{},
+      const A& alloc = A{})
+      : min_id_{!min_id ? id_t{1} : min_id},
+        max_id_{!max_id ? default_max_id() : max_id},
+        blob_{alloc}, extents_{extent_allocator{alloc}},
+        index_{id_allocator{alloc}} {
+    assert(min_id_ < max_id_);
+  }
+
+  // Accessors.
+
+  // Range of IDs for this pool.
+  [[nodiscard]] id_t min_id() const noexcept { return min_id_; }
+  [[nodiscard]] id_t max_id() const noexcept { return max_id_; }
+
+  // Number of values.
+  [[nodiscard]] size_t size() const noexcept { return extents_.size(); }
+  [[nodiscard]] bool empty() const noexcept { return extents_.empty(); }
+
+  // Bytes in the blob, including the terminators.
+  [[nodiscard]] size_t blob_size() const noexcept { return blob_.size(); }
+
+  // Whether `intern` would fail for a new value.
+  [[nodiscard]] bool is_full() const noexcept {
+    return static_cast<size_t>(*max_id_ - *min_id_) < size();
+  }
+
+  // Get value by ID. Returns null if not found.
+  [[nodiscard]] cstring_view get(id_t id) const noexcept {
+    const auto index = static_cast<size_t>(*id - *min_id_);
+    if (id < min_id_ || index >= size()) return {};
+    return value_at(index);
+  }
+
+  // Get ID by value. Returns `id_t{}` if not found.
+  [[nodiscard]] id_t get(std::string_view value) const {
+    return index_.find(std::hash<std::string_view>{}(value),
+        [&](id_t found) { return value_at(*found - *min_id_) == value; });
+  }
+
+  [[nodiscard]] cstring_view operator()(id_t id) const noexcept {
+    return get(id);
+  }
+  [[nodiscard]] id_t operator()(std::string_view value) const {
+    return get(value);
+  }
+
+  // Invoke `f(id, value)` for each value, in ID order.
+  template<typename F>
+  void for_each(F&& f) const {
+    for (size_t index = 0; index < size(); ++index)
+      f(static_cast<id_t>(*min_id_ + index), value_at(index));
+  }
+
+  // Modifiers.
+
+  // Interns a value. If the value is already interned, returns its ID.
+  // Returns `id_t{}` if the pool is full. Throws `std::length_error` if the
+  // blob would pass 4 GiB.
+  [[nodiscard]] id_t intern(std::string_view value) {
+    const auto hash = std::hash<std::string_view>{}(value);
+    if (const auto found = index_.find(hash, [&](id_t id) {
+          return value_at(*id - *min_id_) == value;
+        });
+        found != id_t{})
+      return found;
+    if (is_full()) return id_t{};
+    const auto offset = blob_.size();
+    if (value.size() + 1 > max_blob_size - offset)
+      throw std::length_error("string_pool blob too large");
+
+    // Make room first, so that nothing changes if allocation fails.
+    const auto id = static_cast<id_t>(*min_id_ + size());
+    make_room(blob_, offset + value.size() + 1);
+    make_room(extents_, size() + 1);
+    index_.reserve(size() + 1);
+    blob_.insert(blob_.end(), value.begin(), value.end());
+    blob_.push_back('\0');
+    extents_.push_back(extent{static_cast<uint32_t>(offset),
+        static_cast<uint32_t>(value.size())});
+    index_.insert(hash, id);
+    return id;
+  }
+
+  // Reserve room for `count` more values, totaling `bytes` characters, so
+  // that interning them moves nothing.
+  void reserve(size_t count, size_t bytes) {
+    blob_.reserve(blob_.size() + bytes + count);
+    extents_.reserve(size() + count);
+    index_.reserve(size() + count);
+  }
+
+private:
+  static constexpr size_t max_blob_size = size_t{1} << 32;
+
+  const id_t min_id_;
+  const id_t max_id_;
+  std::vector<char, A> blob_;
+  std::vector<extent, extent_allocator> extents_;
+  flat_id_index<id_t, id_allocator> index_;
+
+  [[nodiscard]] static constexpr id_t default_max_id() noexcept {
+    return static_cast<id_t>(
+        std::numeric_limits<as_underlying_t<id_t>>::max() - 1);
+  }
+
+  // Ensure capacity for `count` elements, growing geometrically.
+  template<typename V>
+  static void make_room(V& v, size_t count) {
+    if (count > v.capacity()) v.reserve(std::max(count, v.capacity() * 2));
+  }
+
+  [[nodiscard]] cstring_view value_at(size_t index) const noexcept {
+    const auto& e = extents_[index];
+    return cstring_view{blob_.data() + e.offset, e.size + size_t{1}};
+  }
+};
+
+}}} // namespace corvid::container::intern
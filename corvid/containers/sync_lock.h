@@ -17,41 +17,175 @@
 #pragma once
 #include "containers_shared.h"
 #include <atomic>
+#include <cassert>
+#include <concepts>
 #include <mutex>
+#include <shared_mutex>
 
 namespace corvid { inline namespace container { inline namespace sync_lock {
 
+// A synchronizer is a `const`-lockable object, for use with `basic_lock`.
+template<typename S>
+concept Synchronizer = requires(const S& s) {
+  s.lock();
+  s.unlock();
+};
+
+// A synchronizer that also allows shared (reader) locking, which
+// `basic_lock::shared` takes advantage of.
+template<typename S>
+concept SharedSynchronizer = Synchronizer<S> && requires(const S& s) {
+  s.lock_shared();
+  s.unlock_shared();
+};
+
 // Synchronization object for use with containers.
 //
 // Not copyable or moveable.
 //
+// Containers that take a synchronizer type as a template parameter can
+// instead use `shared_synchronizer`, `spin_synchronizer`, or
+// `null_synchronizer`.
+//
 // TODO: Consider adding debug-only lock counts so that deadlocks throw.
 class synchronizer {
 public:
   void lock() const { mutex_.lock(); }
   void unlock() const { mutex_.unlock(); }
+  [[nodiscard]] bool try_lock() const { return mutex_.try_lock(); }
 
 private:
   mutable std::mutex mutex_;
 };
 
+// Reader/writer synchronization object. Methods that only read take it
+// shared, through `basic_lock::shared`, so they don't serialize each other.
+//
+// Not copyable or moveable.
+class shared_synchronizer {
+public:
+  void lock() const { mutex_.lock(); }
+  void unlock() const { mutex_.unlock(); }
+  void lock_shared() const { mutex_.lock_shared(); }
+  void unlock_shared() const { mutex_.unlock_shared(); }
+  [[nodiscard]] bool try_lock() const { return mutex_.try_lock(); }
+  [[nodiscard]] bool try_lock_shared() const {
+    return mutex_.try_lock_shared();
+  }
+
+private:
+  mutable std::shared_mutex mutex_;
+};
+
+// Synchronization object for very short critical sections, where parking the
+// thread costs more than the wait. It spins briefly, checking without writing
+// so as not to bounce the cache line, and only then parks on the atomic.
+// Unlocking only wakes a waiter if one has parked, so the uncontended path
+// never leaves user space.
+//
+// Not copyable or moveable.
+class spin_synchronizer {
+public:
+  // Number of times to check before parking.
+  static constexpr int max_spins = 128;
+
+  void lock() const noexcept {
+    for (int spins = 0; spins < max_spins; ++spins) {
+      if (state_.load(std::memory_order::relaxed) == unlocked) {
+        auto expected = unlocked;
+        if (state_.compare_exchange_weak(expected, locked,
+                std::memory_order::acquire, std::memory_order::relaxed))
+          return;
+      }
+      cpu_relax();
+    }
+
+    // Mark as contended before parking, so that the unlock wakes us. Once
+    // we've done that, we can't know whether anyone else is parked, so we
+    // keep it marked when we get it.
+    while (state_.exchange(parked, std::memory_order::acquire) != unlocked)
+      state_.wait(parked, std::memory_order::relaxed);
+  }
+
+  void unlock() const noexcept {
+    if (state_.exchange(unlocked, std::memory_order::release) == parked)
+      state_.notify_one();
+  }
+
+  [[nodiscard]] bool try_lock() const noexcept {
+    auto expected = unlocked;
+    return state_.compare_exchange_strong(expected, locked,
+        std::memory_order::acquire, std::memory_order::relaxed);
+  }
+
+private:
+  static constexpr int unlocked = 0;
+  static constexpr int locked = 1;
+  static constexpr int parked = 2;
+
+  mutable std::atomic<int> state_{unlocked};
+
+  static void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+};
+
+// Synchronization object that does nothing, for containers that are only
+// ever used by one thread, or are externally synchronized. Selecting it as
+// the synchronizer type specializes the locking away entirely.
+class null_synchronizer {
+public:
+  constexpr void lock() const noexcept {}
+  constexpr void unlock() const noexcept {}
+  constexpr void lock_shared() const noexcept {}
+  constexpr void unlock_shared() const noexcept {}
+  [[nodiscard]] constexpr bool try_lock() const noexcept { return true; }
+  [[nodiscard]] constexpr bool try_lock_shared() const noexcept {
+    return true;
+  }
+};
+
 // Breakable synchronization object. Once the guarded resource is frozen, you
-// call `disable` and the conversion to `synchronizer` returns `nullptr`, so
-// that no actual locking is done anymore.
+// call `disable` and the conversion to `S` returns `nullptr`, so that no
+// actual locking is done anymore.
 //
 // If you don't want to allow someone outside the class to call `disable`, make
 // this object private and expose it through a function that returns a `const
-// synchronizer*`.
-class breakable_synchronizer {
+// S*`.
+template<Synchronizer S>
+class basic_breakable_synchronizer {
 public:
-  operator const synchronizer*() const { return sync_; };
+  using sync_t = S;
+
+  basic_breakable_synchronizer() = default;
+  template<typename... Args>
+  requires std::constructible_from<S, Args...>
+  explicit basic_breakable_synchronizer(Args&&... args)
+      : actual_sync_{std::forward<Args>(args)...} {}
+
+  operator const S*() const { return sync_; };
   void disable() const { sync_ = nullptr; };
   bool is_disabled() const { return !sync_; }
 
+  // The actual synchronizer, even once disabled, such as to read its stats.
+  [[nodiscard]] const S& actual() const noexcept { return actual_sync_; }
+
 private:
-  synchronizer actual_sync_;
-  mutable std::atomic<const synchronizer*> sync_ = &actual_sync_;
+  S actual_sync_;
+  mutable std::atomic<const S*> sync_ = &actual_sync_;
+};
+
+using breakable_synchronizer = basic_breakable_synchronizer<synchronizer>;
+
+// Tag for constructing a `basic_lock` that holds its synchronizer shared.
+struct shared_mode_t {
+  explicit shared_mode_t() = default;
 };
+inline constexpr shared_mode_t shared_mode{};
 
 // Attestation of a lock on a sync object.
 //
@@ -74,6 +208,13 @@ private:
 // method doesn't access any data, it can skip the attestation sync call at
 // top, just passing along the `attestation` without calling it.
 //
+// Methods that only read can call `attestation.shared(sync)` instead. With a
+// `SharedSynchronizer`, this takes it shared, so readers don't serialize each
+// other; otherwise, it's the same as `attestation(sync)`. If the attestation
+// already holds the lock, in either mode, it's kept as is. So a method that
+// writes must not be called with an attestation that was first used to read,
+// which the debug build asserts.
+//
 // You can use a `breakable_synchronizer` if you want the ability to disable
 // locking once the object is frozen.
 //
@@ -92,50 +233,91 @@ private:
 // Note again how, in the above case, the caller could make their own `lock`
 // object and reuse it across multiple calls, maintaining a lock. They could
 // even construct it on the instance's `sync` member.
-class lock {
+//
+// A container that lets its user choose the synchronizer type takes `S` as a
+// template parameter and uses `basic_lock<S>` in place of `lock`.
+template<Synchronizer S>
+class basic_lock {
 public:
-  lock() = default;
+  using sync_t = S;
 
-  explicit lock(const synchronizer& sync) : sync_{&sync} { sync_->lock(); }
-  explicit lock(const synchronizer* sync) : sync_{sync} {
+  basic_lock() = default;
+
+  explicit basic_lock(const S& sync) : sync_{&sync} { sync_->lock(); }
+  explicit basic_lock(const S* sync) : sync_{sync} {
     if (sync_) sync_->lock();
   }
+  basic_lock(shared_mode_t, const S& sync) { shared(sync); }
+  basic_lock(shared_mode_t, const S* sync) { shared(sync); }
 
-  lock(const lock&) = delete;
-  lock& operator=(const lock&) = delete;
+  basic_lock(const basic_lock&) = delete;
+  basic_lock& operator=(const basic_lock&) = delete;
 
-  lock(lock&& r) : sync_(r.release()) {}
-  lock& operator=(lock&& r) {
+  basic_lock(basic_lock&& r) : shared_{r.shared_}, sync_(r.release()) {}
+  basic_lock& operator=(basic_lock&& r) {
+    unlock();
+    shared_ = r.shared_;
     sync_ = r.release();
     return *this;
   }
 
-  ~lock() {
-    if (sync_) sync_->unlock();
-  }
+  ~basic_lock() { unlock(); }
 
   // Call this at top of method.
-  void operator()(const synchronizer& sync) const {
-    assert(!sync_ || sync_ == &sync);
+  void operator()(const S& sync) const {
+    assert(!sync_ || (sync_ == &sync && !shared_));
     if (sync_) return;
     sync_ = &sync;
     sync_->lock();
   }
-  void operator()(const synchronizer* sync) const {
+  void operator()(const S* sync) const {
     if (sync) (*this)(*sync);
   }
 
-  const synchronizer* release() const {
+  // Call this at top of method that only reads.
+  void shared(const S& sync) const {
+    assert(!sync_ || sync_ == &sync);
+    if (sync_) return;
+    if constexpr (SharedSynchronizer<S>) {
+      sync.lock_shared();
+      shared_ = true;
+    } else
+      sync.lock();
+    sync_ = &sync;
+  }
+  void shared(const S* sync) const {
+    if (sync) shared(*sync);
+  }
+
+  // Whether a lock is held, and whether it's held shared.
+  [[nodiscard]] bool owns_lock() const noexcept { return sync_; }
+  [[nodiscard]] bool owns_shared() const noexcept { return sync_ && shared_; }
+
+  // Release without unlocking, leaving it to the caller.
+  const S* release() const {
     const auto old = sync_;
     sync_ = nullptr;
+    shared_ = false;
     return old;
   }
 
 private:
-  mutable const synchronizer* sync_{};
+  mutable bool shared_{};
+  mutable const S* sync_{};
+
+  void unlock() const {
+    if (!sync_) return;
+    const bool was_shared = shared_;
+    const auto sync = release();
+    if constexpr (SharedSynchronizer<S>)
+      if (was_shared) {
+        sync->unlock_shared();
+        return;
+      }
+    sync->unlock();
+  }
 };
 
-// TODO: Consider whether we need an `empty_t` trick to make it easier to
-// specialize the synchronizer away.
+using lock = basic_lock<synchronizer>;
 
 }}} // namespace corvid::container::sync_lock
@@ -16,11 +16,31 @@
 // limitations under the License.
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
 #include <chrono>
+#include <concepts>
+#include <coroutine>
 #include <functional>
 #include <map>
-#include <queue>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string_view>
+#include <vector>
+
+#include "free_list.h"
+#include "instrumentation.h"
+#include "small_function.h"
+
+// Inline capacity, in bytes, of timer callbacks and deleters. Callbacks that
+// fit are stored without allocating.
+#ifndef CORVID_TIMER_CALLBACK_SIZE
+#define CORVID_TIMER_CALLBACK_SIZE (6 * sizeof(void*))
+#endif
 
 namespace corvid { inline namespace container {
 // This namespace is not inline, so we export just the types that the user is
@@ -36,32 +56,35 @@ using duration_t = std::chrono::milliseconds;
 struct timer_event;
 struct scheduled_event;
 
-// Callback invoked when a timer fires.
-using timer_callback_t = std::function<void(timer_event&)>;
+// Callback invoked when a timer fires. Move-only, with inline storage.
+using timer_callback_t =
+    small_function<void(timer_event&), CORVID_TIMER_CALLBACK_SIZE>;
 
-// Callback invoked to delete a timer entry.
-using timer_entry_deleter_t = std::function<void(timer_event&)>;
+// Callback invoked to delete a timer entry. Move-only, with inline storage.
+using timer_entry_deleter_t =
+    small_function<void(timer_event&), CORVID_TIMER_CALLBACK_SIZE>;
 
 // Callback to get the current time.
 using clock_callback_t = std::function<time_point_t()>;
 
-// Map of timers by ID.
-using timer_map_t = std::map<timer_id_t, timer_event>;
-
-// Priority queue of scheduled events.
-using scheduled_queue_t = std::priority_queue<scheduled_event>;
+// Map of timers by ID. Its nodes are recycled through a free list.
+using timer_map_t = std::map<timer_id_t, timer_event, std::less<timer_id_t>,
+    pool::free_list_allocator<std::pair<const timer_id_t, timer_event>>>;
 
 // Timer event.
 //
 // Contains full state of the event. Available to the callback handler, which
 // can modify certain fields.
+//
+// Constructed in place and never moved, since its callback is both `const`
+// and move-only.
 struct timer_event {
   timer_event(timer_id_t timer_id, time_point_t start_at, duration_t repeat_in,
-      time_point_t stop_at, timer_callback_t callback)
+      time_point_t stop_at, duration_t slack, timer_callback_t callback)
       : timer_id{timer_id}, start_at{start_at}, repeat_in{repeat_in},
-        stop_at{stop_at}, callback{std::move(callback)} {}
+        stop_at{stop_at}, slack{slack}, callback{std::move(callback)} {}
 
-  timer_event(timer_event&&) = default;
+  timer_event(timer_event&&) = delete;
 
   timer_event(const timer_event&) = delete;
   timer_event& operator=(const timer_event&) = delete;
@@ -82,6 +105,10 @@ struct timer_event {
   // When timer should stop firing, or empty for n/a.
   const time_point_t stop_at;
 
+  // How late the timer may fire, so that it can be coalesced with others, or
+  // 0 for exact. See `set` for details.
+  const duration_t slack;
+
   // Callback to invoke when the timer fires.
   const timer_callback_t callback;
 
@@ -112,52 +139,445 @@ struct scheduled_event {
   }
 };
 
+// Binary heap of scheduled events, ordered by `next_at`. Insertion and
+// removal of the next event are both O(log n).
+//
+// Cancellation is lazy: entries for canceled events remain in the heap until
+// they rise to the top, at which point `tick` discards them, or until they
+// are removed in bulk by `erase_if`.
+class scheduled_heap {
+public:
+  void push(const scheduled_event& se) {
+    heap_.push_back(se);
+    std::push_heap(heap_.begin(), heap_.end());
+  }
+
+  // Pop the next event if it's due by `now`. Returns whether it did.
+  bool pop_ready(time_point_t now, scheduled_event& se) {
+    if (heap_.empty() || heap_.front().next_at > now) return false;
+    std::pop_heap(heap_.begin(), heap_.end());
+    se = heap_.back();
+    heap_.pop_back();
+    return true;
+  }
+
+  // Returns the time of the next event, or `default_time` if none.
+  [[nodiscard]] time_point_t next_at(time_point_t default_time) const {
+    return heap_.empty() ? default_time : heap_.front().next_at;
+  }
+
+  // Remove all entries matching `pred`, then restore the heap in O(n).
+  // Returns the number of entries removed.
+  template<typename P>
+  size_t erase_if(P pred) {
+    const auto removed = std::erase_if(heap_, pred);
+    if (removed) std::make_heap(heap_.begin(), heap_.end());
+    return removed;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return heap_.size(); }
+  [[nodiscard]] bool empty() const noexcept { return heap_.empty(); }
+
+private:
+  std::vector<scheduled_event> heap_;
+};
+
+// Hierarchical timing wheel of scheduled events. Insertion is O(1), finding
+// the next slot is O(levels), and each event cascades down at most once per
+// level on its way to firing.
+//
+// Time is quantized into `duration_t` ticks. An event's due tick is rounded
+// up and the current time is rounded down, so events never fire early,
+// although they may fire up to one tick late. Events due in the same tick
+// fire in no particular order, rather than in strict `next_at` order.
+//
+// Each tick is treated as a number with `slot_bits`-wide digits, and an event
+// is stored at the level of the highest digit in which its due tick differs
+// from the wheel's current tick, in the slot for that digit. So all events at
+// a level share the higher digits of the current tick and have a larger digit
+// at that level. This means that every event at a lower level is due before
+// any event at a higher one, and that the lowest occupied slot of the lowest
+// occupied level holds the next events. When time reaches the start of a
+// slot above level 0, its events are redistributed to lower levels.
+//
+// Cancellation is lazy, as with `scheduled_heap`, but the dead entries are
+// only ever touched again when their slot is reached or by `erase_if`.
+class scheduled_wheel {
+  using tick_t = uint64_t;
+
+  // Each slot is a singly-linked list of entries, threaded through
+  // `entries_` by index. Unused entries are kept on a free list, so once the
+  // wheel reaches its peak size, it no longer allocates.
+  struct entry {
+    scheduled_event se;
+    size_t next;
+  };
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  static constexpr size_t slot_bits = 6;
+  static constexpr size_t slot_count = size_t{1} << slot_bits;
+  static constexpr tick_t slot_mask = slot_count - 1;
+  static constexpr size_t level_count =
+      (std::numeric_limits<tick_t>::digits + slot_bits - 1) / slot_bits;
+  static_assert(slot_count <= std::numeric_limits<uint64_t>::digits);
+
+public:
+  scheduled_wheel() {
+    for (auto& heads : heads_) heads.fill(npos);
+  }
+
+  void push(const scheduled_event& se) {
+    place(se);
+    ++size_;
+  }
+
+  // Pop the next event if it's due by `now`. Returns whether it did.
+  //
+  // Advances the wheel to `now`, so `now` must not go backwards between
+  // calls.
+  bool pop_ready(time_point_t now, scheduled_event& se) {
+    if (ready_pos_ == ready_.size()) {
+      ready_.clear();
+      ready_pos_ = 0;
+      advance(floor_tick(now));
+      if (ready_.empty()) return false;
+    }
+    se = ready_[ready_pos_++];
+    --size_;
+    return true;
+  }
+
+  // Returns the time of the next slot, or `default_time` if none. For slots
+  // above level 0, this is the start of the slot, which may be earlier than
+  // any event in it. Waking up at that time is harmless, since it just
+  // leads to those events being redistributed.
+  [[nodiscard]] time_point_t next_at(time_point_t default_time) const {
+    if (ready_pos_ != ready_.size()) return ready_[ready_pos_].next_at;
+    for (size_t level = 0; level < level_count; ++level)
+      if (occupied_[level]) return from_tick(slot_start(level));
+    return default_time;
+  }
+
+  // Remove all entries matching `pred`. Returns the number of entries
+  // removed.
+  template<typename P>
+  size_t erase_if(P pred) {
+    ready_.erase(ready_.begin(), ready_.begin() + ready_pos_);
+    ready_pos_ = 0;
+    auto removed = std::erase_if(ready_, pred);
+    for (size_t level = 0; level < level_count; ++level) {
+      for (auto bits = occupied_[level]; bits; bits &= bits - 1) {
+        const auto slot = std::countr_zero(bits);
+        for (auto* link = &heads_[level][slot]; *link != npos;) {
+          const auto index = *link;
+          if (!pred(entries_[index].se)) {
+            link = &entries_[index].next;
+            continue;
+          }
+          *link = entries_[index].next;
+          release(index);
+          ++removed;
+        }
+        if (heads_[level][slot] == npos)
+          occupied_[level] &= ~(uint64_t{1} << slot);
+      }
+    }
+    size_ -= removed;
+    return removed;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return size_; }
+  [[nodiscard]] bool empty() const noexcept { return !size_; }
+
+private:
+  std::vector<entry> entries_;
+  size_t free_ = npos;
+  std::array<std::array<size_t, slot_count>, level_count> heads_;
+  std::array<uint64_t, level_count> occupied_{};
+  std::vector<scheduled_event> ready_;
+  size_t ready_pos_{};
+  tick_t now_{};
+  size_t size_{};
+
+  static constexpr tick_t max_tick = tick_t(
+      std::chrono::floor<duration_t>(time_point_t::max().time_since_epoch())
+          .count());
+
+  static tick_t floor_tick(time_point_t tp) {
+    const auto ticks =
+        std::chrono::floor<duration_t>(tp.time_since_epoch()).count();
+    return ticks < 0 ? tick_t{} : tick_t(ticks);
+  }
+  static tick_t ceil_tick(time_point_t tp) {
+    const auto ticks =
+        std::chrono::ceil<duration_t>(tp.time_since_epoch()).count();
+    return ticks < 0 ? tick_t{} : tick_t(ticks);
+  }
+  static time_point_t from_tick(tick_t tick) {
+    if (tick > max_tick) return time_point_t::max();
+    return time_point_t{duration_t{tick}};
+  }
+
+  static constexpr tick_t low_mask(size_t bits) {
+    return bits >= std::numeric_limits<tick_t>::digits
+               ? ~tick_t{}
+               : (tick_t{1} << bits) - 1;
+  }
+
+  // First tick of the lowest occupied slot at `level`.
+  tick_t slot_start(size_t level) const {
+    const auto shift = level * slot_bits;
+    const auto slot = tick_t(std::countr_zero(occupied_[level]));
+    return (now_ & ~low_mask(shift + slot_bits)) | (slot << shift);
+  }
+
+  size_t acquire(const scheduled_event& se, size_t next) {
+    if (free_ == npos) {
+      entries_.push_back({se, next});
+      return entries_.size() - 1;
+    }
+    const auto index = std::exchange(free_, entries_[free_].next);
+    entries_[index] = {se, next};
+    return index;
+  }
+
+  void release(size_t index) noexcept {
+    entries_[index].next = std::exchange(free_, index);
+  }
+
+  void place(const scheduled_event& se) {
+    const auto tick = ceil_tick(se.next_at);
+    if (tick <= now_) {
+      ready_.push_back(se);
+      return;
+    }
+    const auto level = (std::bit_width(tick ^ now_) - 1) / slot_bits;
+    const auto slot = (tick >> (level * slot_bits)) & slot_mask;
+    auto& head = heads_[level][slot];
+    head = acquire(se, head);
+    occupied_[level] |= uint64_t{1} << slot;
+  }
+
+  // Advance current tick to `target`, moving everything that comes due into
+  // `ready_`, in order.
+  void advance(tick_t target) {
+    while (now_ < target) {
+      size_t level = 0;
+      while (level < level_count && !occupied_[level]) ++level;
+      if (level == level_count) break;
+
+      const auto start = slot_start(level);
+      if (start > target) break;
+
+      // Every event in the slot now lies in a lower level, or is ready.
+      const auto slot = (start >> (level * slot_bits)) & slot_mask;
+      now_ = start;
+      occupied_[level] &= ~(uint64_t{1} << slot);
+      for (auto index = std::exchange(heads_[level][slot], npos);
+           index != npos;)
+      {
+        const auto [se, next] = entries_[index];
+        release(index);
+        place(se);
+        index = next;
+      }
+    }
+    if (now_ < target) now_ = target;
+  }
+};
+
+// Priority queue of scheduled events.
+using scheduled_queue_t = scheduled_heap;
+
+// Lock-free queue of requests, from any thread, to set or cancel timers.
+//
+// Producers push onto an intrusive stack with a single compare-and-swap, and
+// the consumer takes the whole stack with a single exchange, reversing it to
+// restore submission order. So producers never block each other or the
+// consumer, and the consumer never blocks them.
+//
+// Also holds the ID counter, so that producers can reserve IDs atomically.
+class submission_queue {
+public:
+  // A request to set a timer or, if `is_cancel`, to cancel one.
+  struct submission {
+    timer_id_t timer_id{};
+    bool is_cancel{};
+    time_point_t start_at{};
+    duration_t repeat_in{};
+    time_point_t stop_at{};
+    duration_t slack{};
+    timer_callback_t callback{};
+    submission* next{};
+  };
+
+  submission_queue() noexcept = default;
+  submission_queue(const submission_queue&) = delete;
+  submission_queue& operator=(const submission_queue&) = delete;
+
+  ~submission_queue() { release(take_all()); }
+
+  // Push submission, taking ownership. May be called from any thread.
+  void push(submission* node) noexcept {
+    node->next = head_.load(std::memory_order::relaxed);
+    while (!head_.compare_exchange_weak(node->next, node,
+        std::memory_order::release, std::memory_order::relaxed))
+    {}
+  }
+
+  // Take all submissions, in the order they were pushed, preceded by any
+  // that were put back. The caller owns them, so it should `release` them
+  // when done. Must only be called by the consumer.
+  [[nodiscard]] submission* take_all() noexcept {
+    auto taken = std::exchange(put_back_, nullptr);
+    if (!head_.load(std::memory_order::relaxed)) return taken;
+    auto node = head_.exchange(nullptr, std::memory_order::acquire);
+    submission* reversed{};
+    while (node) {
+      auto next = std::exchange(node->next, reversed);
+      reversed = std::exchange(node, next);
+    }
+    if (!taken) return reversed;
+    auto tail = taken;
+    while (tail->next) tail = tail->next;
+    tail->next = reversed;
+    return taken;
+  }
+
+  // Return submissions that were taken but not applied, so that the next
+  // `take_all` returns them first. Must only be called by the consumer.
+  void put_back(submission* node) noexcept {
+    assert(!put_back_);
+    put_back_ = node;
+  }
+
+  static void release(submission* node) noexcept {
+    while (node) delete std::exchange(node, node->next);
+  }
+
+  // Reserve the next ID. It may be invalid, after wrapping around.
+  [[nodiscard]] timer_id_t reserve_id() noexcept {
+    const auto serial =
+        next_timer_id_.fetch_add(1, std::memory_order::relaxed) + 1;
+    return timer_id_t{serial << tag_bits_ | tag_};
+  }
+
+  // Reserve IDs with `tag` in their low `tag_bits`. Must be called before
+  // any are reserved.
+  void set_id_tag(size_t tag_bits, uint64_t tag) noexcept {
+    tag_bits_ = tag_bits;
+    tag_ = tag;
+  }
+
+  void set_next_timer_id(uint64_t next_timer_id) noexcept {
+    next_timer_id_.store(next_timer_id, std::memory_order::relaxed);
+  }
+
+private:
+  std::atomic<submission*> head_{};
+  submission* put_back_{};
+  std::atomic<uint64_t> next_timer_id_{};
+  size_t tag_bits_{};
+  uint64_t tag_{};
+};
+
+// Counts of entries in the scheduled queue. Live entries reference events
+// that will fire, while dead entries reference canceled events and are just
+// waiting to be discarded.
+struct timer_stats {
+  size_t live_entries{};
+  size_t dead_entries{};
+  size_t compactions{};
+};
+
+// Awaiter that can be canceled while suspended, for `with_timeout`. If
+// `await_cancel` returns true, then the awaiter promises never to resume the
+// coroutine; if false, it's too late to cancel, and it will resume it.
+template<typename A>
+concept cancellable_awaiter = requires(A& a, std::coroutine_handle<> h) {
+  { a.await_ready() } -> std::convertible_to<bool>;
+  a.await_suspend(h);
+  a.await_resume();
+  { a.await_cancel() } -> std::same_as<bool>;
+};
+
 // Priority queue of timers.
 //
 // Events may be one-shot or recurring. Callbacks are executed only when `tick`
 // is called. During the execution of the callback, the `event` object is
 // available and certain fields may be modified.
-class timers {
+//
+// The `Q` parameter selects how upcoming events are scheduled. The default,
+// `scheduled_heap`, is exact and compact. The alternative, `scheduled_wheel`,
+// has O(1) insertion, so it scales better for large numbers of timers,
+// especially when most are canceled before they fire, but it quantizes time
+// to `duration_t` ticks.
+template<typename Q = scheduled_queue_t>
+class basic_timers {
 public:
+  basic_timers() = default;
+  basic_timers(basic_timers&&) = default;
+
+  // The nodes of `events_by_id_` belong to `event_pool_`, which is declared
+  // first so that it's destroyed last. Memberwise assignment would free the
+  // old pool before releasing the old nodes into it, so instead this clears
+  // the events before taking over the other instance's pool.
+  basic_timers& operator=(basic_timers&& other) {
+    if (this == &other) return *this;
+    events_by_id_.clear();
+    clock_callback_ = std::move(other.clock_callback_);
+    submissions_ = std::move(other.submissions_);
+    dead_entries_ = other.dead_entries_;
+    compactions_ = other.compactions_;
+    firing_id_ = other.firing_id_;
+    events_by_id_ = std::move(other.events_by_id_);
+    event_pool_ = std::move(other.event_pool_);
+    scheduled_events_ = std::move(other.scheduled_events_);
+    batch_ = std::move(other.batch_);
+    batch_its_ = std::move(other.batch_its_);
+    return *this;
+  }
+
   // Get current time according to the registered clock callback.
   auto get_now() const { return clock_callback_(); }
 
   // Set timer for a new event. Returns the event, so that mutable fields may
   // be set.
+  //
+  // If `slack` is specified, the timer may fire up to that much later than
+  // requested, each time it's scheduled, so that timers with similar
+  // deadlines fire together. This is done by rounding the deadline up to a
+  // multiple of the largest power of two, in `duration_t` ticks, that doesn't
+  // exceed `slack`, so timers whose slack is at least as large share those
+  // boundaries. The rounding is skipped when it would reach `stop_at`.
   timer_event& set(time_point_t start_at, timer_callback_t callback,
-      duration_t repeat_in = {}, time_point_t stop_at = {}) {
+      duration_t repeat_in = {}, time_point_t stop_at = {},
+      duration_t slack = {}) {
     // If all slots were filled, we'd loop forever, so just fail.
     if (events_by_id_.size() == std::numeric_limits<uint64_t>::max() - 1)
       throw std::overflow_error("Timer ID overflow");
 
     // After overflowing the ID, we wrap around, so we need to skip over any
     // that are still in use.
-    timer_id_t timer_id{};
     timer_event* new_event{};
-    for (;;) {
-      timer_id = timer_id_t{++next_timer_id_};
+    while (!new_event) {
+      const auto timer_id = submissions_->reserve_id();
       if (timer_id == timer_id_t::invalid) continue;
-      auto [inserted_at, was_inserted] = events_by_id_.emplace(timer_id,
-          timer_event{timer_id, start_at, repeat_in, stop_at,
-              std::move(callback)});
-      if (was_inserted) {
-        new_event = &inserted_at->second;
-        break;
-      }
+      new_event =
+          arm(timer_id, start_at, callback, repeat_in, stop_at, slack);
       // TODO: Consider skipping to next open slot using binary search.
     }
-    new_event->next_at = start_at;
-    scheduled_events_.emplace(new_event->next_at, new_event->timer_id);
     return *new_event;
   }
 
   auto& set(duration_t start_in, timer_callback_t callback,
-      duration_t repeat_in = {}, duration_t stop_in = {}) {
+      duration_t repeat_in = {}, duration_t stop_in = {},
+      duration_t slack = {}) {
     const auto now = clock_callback_();
     const auto start_at = clock_callback_() + start_in;
     const auto stop_at =
         (stop_in == duration_t{}) ? time_point_t{} : now + stop_in;
-    return set(start_at, std::move(callback), repeat_in, stop_at);
+    return set(start_at, std::move(callback), repeat_in, stop_at, slack);
   }
 
   // TODO: Consider offering overloads that take when/expire_in and
@@ -166,16 +586,79 @@ public:
   // TODO: Consider adding overloads to populate the user data atomically,
   // avoiding any possible race between setting and ticking.
 
-  // TODO: Consider making this entire class thread-safe.
+  // Submit a request to set a timer for a new event. Unlike `set`, this may
+  // be called from any thread, and it never blocks. The ID is reserved and
+  // returned immediately, but the event only becomes visible to the owning
+  // thread (to `events`, `cancel`, `next_at`, and so on) at the start of its
+  // next `tick`, which applies all pending submissions in order.
+  //
+  // If the ID counter has wrapped around and the ID is still in use when the
+  // submission is applied, then the submission is discarded.
+  timer_id_t submit_set(time_point_t start_at, timer_callback_t callback,
+      duration_t repeat_in = {}, time_point_t stop_at = {},
+      duration_t slack = {}) {
+    auto timer_id = submissions_->reserve_id();
+    if (timer_id == timer_id_t::invalid) timer_id = submissions_->reserve_id();
+    submissions_->push(new submission_queue::submission{timer_id, false,
+        start_at, repeat_in, stop_at, slack, std::move(callback)});
+    return timer_id;
+  }
+
+  // As above, but relative to the current time, which requires that the
+  // clock callback be safe to call from any thread.
+  timer_id_t submit_set(duration_t start_in, timer_callback_t callback,
+      duration_t repeat_in = {}, duration_t stop_in = {},
+      duration_t slack = {}) {
+    const auto now = clock_callback_();
+    const auto stop_at =
+        (stop_in == duration_t{}) ? time_point_t{} : now + stop_in;
+    return submit_set(now + start_in, std::move(callback), repeat_in,
+        stop_at, slack);
+  }
 
-  // Cancel a timer,
+  // Submit a request to cancel a timer. May be called from any thread,
+  // and never blocks. It takes effect at the start of the next `tick`.
+  void submit_cancel(timer_id_t timer_id) {
+    submissions_->push(new submission_queue::submission{timer_id, true});
+  }
+
+  // Cancel a timer. Its entry in the scheduled queue becomes dead, and once
+  // there are enough of these, they are all removed at once by `compact`.
+  //
+  // A callback may cancel its own event. Its entry was already popped, so
+  // nothing becomes dead; instead, the event is removed once it returns.
   bool cancel(timer_id_t timer_id) {
     auto it = events_by_id_.find(timer_id);
     if (it == events_by_id_.end()) return false;
+    if (timer_id == firing_id_) {
+      it->second.next_at = time_point_t{};
+      return true;
+    }
     events_by_id_.erase(it);
+    ++dead_entries_;
+    if (dead_entries_ >= min_compact_entries &&
+        dead_entries_ > scheduled_events_.size() - dead_entries_)
+      compact();
     return true;
   }
 
+  // Remove all dead entries from the scheduled queue. This is done
+  // automatically when more than half of the entries are dead, so the
+  // amortized cost per cancellation is O(log n).
+  void compact() {
+    scheduled_events_.erase_if(
+        [this](const scheduled_event& se) { return !is_live(se); });
+    dead_entries_ = 0;
+    ++compactions_;
+  }
+
+  // Returns counts of live and dead entries in the scheduled queue.
+  [[nodiscard]] timer_stats stats() const {
+    const auto entries = scheduled_events_.size();
+    const auto dead = std::min(dead_entries_, entries);
+    return {entries - dead, dead, compactions_};
+  }
+
   // Service timers, firing any that are ready. Returns the number of callbacks
   // invoked. If `max_callbacks` is specified, it will stop after that many.
   //
@@ -195,67 +678,87 @@ public:
   // otherwise a one-shot. In either case, it doesn't allow scheduling
   // past the `stop`. On the other hand, if it was recurring, then
   // clearing `next_at` will prevent it from firing again.
+  //
+  // Before anything else, it applies any pending submissions from
+  // `submit_set` and `submit_cancel`.
   size_t tick(size_t max_callbacks = -1) {
+    apply_submissions();
     const auto tick_now = clock_callback_();
     size_t callbacks{};
 
-    // Loop until we've caught up to the current time.
-    while (!scheduled_events_.empty()) {
-      // Stop when we hit the now or triggered enough callbacks.
-      const auto [next_at, timer_id] = scheduled_events_.top();
-      if (next_at > tick_now || callbacks >= max_callbacks) break;
-
-      // Look for the matching `timer_event`. If not found, it was canceled, so
-      // this is a false alarm. Note how we check the `next_at` to avoid the
-      // unlikely possibility of the event ID being reused while pending.
-      scheduled_events_.pop();
-      auto it = events_by_id_.find(timer_id);
-      if (it == events_by_id_.end() || it->second.next_at != next_at) continue;
-
-      // If it expired, cancel it. This means that an event whose `stop_at` is
-      // specified might never get triggered.
-      auto& event = it->second;
-      if (event.stop_at != time_point_t{} && event.stop_at <= tick_now) {
-        events_by_id_.erase(it);
-        continue;
-      }
+    // Loop until we've caught up to the current time or triggered enough
+    // callbacks.
+    while (callbacks < max_callbacks) {
+      auto it = pop_due(tick_now);
+      if (it == events_by_id_.end()) break;
 
       // Call back with the event. Note how we set the `next_at` to
       // `callback_now`, the actual start, not the nominal start, which is
       // `tick_now`, in a recognition that some time may have passed since we
       // entered this loop.
+      auto& event = it->second;
       const auto callback_now = get_now();
+#if CORVID_INSTRUMENTATION
+      library_probes().timer_lateness.record(callback_now - event.next_at);
+#endif
       event.next_at = callback_now;
       ++event.callbacks;
       ++callbacks;
+      firing_id_ = event.timer_id;
       event.callback(event);
+      firing_id_ = timer_id_t::invalid;
+      reschedule(it, callback_now);
+    }
 
-      // If the callback didn't reschedule, try to schedule the next time.
-      // Note how we add `repeat_in` to `get_now()`, not `callback_now`, so
-      // that it's the interval between calls, not returns. If this isn't the
-      // desired behavior, then the callback handler should reschedule itself.
-      if (event.next_at == callback_now) {
-        if (event.repeat_in != duration_t{})
-          event.next_at = get_now() + event.repeat_in;
-        else
-          event.next_at = time_point_t{};
-      }
+    return callbacks;
+  }
 
-      // Don't bother scheduling if it'll expire before it can trigger. We
-      // don't have to do this, but we might as well because it's cheap and
-      // avoids possibly waking up prematurely.
-      if (event.stop_at != time_point_t{} && event.stop_at <= event.next_at)
-        event.next_at = time_point_t{};
+  // Service timers like `tick`, but collect every event that's ready into a
+  // single batch and pass it to `batch_callback` as a
+  // `std::span<timer_event* const>`, instead of invoking the events' own
+  // callbacks. Returns the number of events in the batch, which is at most
+  // `max_callbacks`. The batch callback is not invoked if no events are ready.
+  //
+  // This amortizes the overhead of firing over the whole batch, which helps
+  // when many events share a deadline, as they do when set with `slack`. The
+  // batch callback may invoke each event's `callback`, or it may handle them
+  // all itself.
+  //
+  // Each event in the batch has its `callbacks` incremented and its `next_at`
+  // set to the time the batch started, and it's rescheduled afterwards
+  // exactly as it would be by `tick`. The batch callback must not cancel or
+  // set timers, since that would invalidate the batch, but it may modify the
+  // mutable fields of the events it was passed.
+  template<typename F>
+  requires std::invocable<F&, std::span<timer_event* const>>
+  size_t tick_batch(F&& batch_callback, size_t max_callbacks = -1) {
+    apply_submissions();
+    const auto tick_now = clock_callback_();
 
-      // If it's not scheduled, then there's no reason to keep it.
-      if (event.next_at <= callback_now) {
-        events_by_id_.erase(it);
-        continue;
-      }
+    batch_.clear();
+    batch_its_.clear();
+    while (batch_.size() < max_callbacks) {
+      auto it = pop_due(tick_now);
+      if (it == events_by_id_.end()) break;
+      batch_its_.push_back(it);
+      batch_.push_back(&it->second);
+    }
+    if (batch_.empty()) return 0;
 
-      scheduled_events_.emplace(event.next_at, event.timer_id);
+    const auto callback_now = get_now();
+    for (auto event : batch_) {
+#if CORVID_INSTRUMENTATION
+      library_probes().timer_lateness.record(callback_now - event->next_at);
+#endif
+      event->next_at = callback_now;
+      ++event->callbacks;
     }
+    batch_callback(std::span<timer_event* const>{batch_});
+    for (auto it : batch_its_) reschedule(it, callback_now);
 
+    const auto callbacks = batch_.size();
+    batch_.clear();
+    batch_its_.clear();
     return callbacks;
   }
 
@@ -268,7 +771,7 @@ public:
     auto next_delay = default_duration;
     if (!scheduled_events_.empty()) {
       next_delay = duration_cast<duration_t>(
-          scheduled_events_.top().next_at - clock_callback_());
+          scheduled_events_.next_at({}) - clock_callback_());
     }
     // If we're overdue, instead claim we're ready now.
     if (next_delay < duration_t{}) next_delay = duration_t{};
@@ -278,10 +781,7 @@ public:
   // Returns the time of the next event (which could be in the past if we're
   // overdue). If no events, returns `default_time`.
   time_point_t next_at(time_point_t default_time = time_point_t{}) const {
-    auto next_time = default_time;
-    if (!scheduled_events_.empty())
-      next_time = scheduled_events_.top().next_at;
-    return next_time;
+    return scheduled_events_.next_at(default_time);
   }
 
   const auto& events() const { return events_by_id_; }
@@ -289,6 +789,177 @@ public:
     return events_by_id_.at(timer_id);
   }
 
+  // Coroutine support.
+  //
+  // These awaitables are meant to be `co_await`ed by coroutines that run on
+  // the thread calling `tick`, which is where they're resumed. Their state
+  // lives in the coroutine frame; the timer's callback holds just a pointer
+  // to it, so it's stored inline and resuming doesn't allocate. The
+  // `basic_timers` instance must outlive them.
+
+  // Awaiter that resumes the coroutine at `deadline`. The timer is set on
+  // construction, so `timer_id` can be passed elsewhere before awaiting, and
+  // canceled when destroyed, so a coroutine may be destroyed while suspended.
+  //
+  // The result of `co_await` is true if the timer fired, or false if it was
+  // canceled, whether by `cancel`, in which case the coroutine is resumed
+  // during the next `tick`, or by `await_cancel`, which doesn't resume it.
+  class sleep_awaiter {
+  public:
+    sleep_awaiter(basic_timers& owner, time_point_t deadline)
+        : owner_{owner} {
+      auto& event = owner_.set(deadline, [this](timer_event& event) {
+        event.deleter = nullptr;
+        timer_id_ = timer_id_t::invalid;
+        if (handle_) handle_.resume();
+      });
+      event.deleter = [this](timer_event&) { on_canceled(); };
+      timer_id_ = event.timer_id;
+    }
+
+    sleep_awaiter(const sleep_awaiter&) = delete;
+    sleep_awaiter& operator=(const sleep_awaiter&) = delete;
+
+    ~sleep_awaiter() {
+      disarm();
+      if (resume_id_ != timer_id_t::invalid) owner_.submit_cancel(resume_id_);
+    }
+
+    // ID of the timer, or `invalid` once it has fired or been canceled.
+    [[nodiscard]] timer_id_t timer_id() const noexcept { return timer_id_; }
+
+    [[nodiscard]] bool await_ready() const noexcept {
+      return timer_id_ == timer_id_t::invalid;
+    }
+    void await_suspend(std::coroutine_handle<> handle) noexcept {
+      handle_ = handle;
+    }
+    [[nodiscard]] bool await_resume() const noexcept { return !canceled_; }
+
+    // Cancel without resuming. Returns false if it already fired or was
+    // canceled.
+    bool await_cancel() {
+      if (timer_id_ == timer_id_t::invalid) return false;
+      disarm();
+      canceled_ = true;
+      return true;
+    }
+
+  private:
+    basic_timers& owner_;
+    timer_id_t timer_id_{};
+    timer_id_t resume_id_{};
+    std::coroutine_handle<> handle_;
+    bool canceled_{};
+
+    // Cancel the timer, if pending, without invoking the deleter.
+    void disarm() {
+      if (timer_id_ == timer_id_t::invalid) return;
+      auto it = owner_.events_by_id_.find(timer_id_);
+      if (it != owner_.events_by_id_.end()) it->second.deleter = nullptr;
+      owner_.cancel(std::exchange(timer_id_, timer_id_t::invalid));
+    }
+
+    // Called while the event is being removed from the map, so rather than
+    // resume here, where the caller isn't expecting it, defer until the next
+    // `tick`. Submitting doesn't touch the map.
+    void on_canceled() {
+      timer_id_ = timer_id_t::invalid;
+      canceled_ = true;
+      if (!handle_) return;
+      resume_id_ = owner_.submit_set(duration_t{}, [this](timer_event&) {
+        resume_id_ = timer_id_t::invalid;
+        handle_.resume();
+      });
+    }
+  };
+
+  // Awaiter that resumes the coroutine when `inner` does, or at `deadline`,
+  // whichever is first. If the deadline comes first and `inner` can still be
+  // canceled, then the result of `co_await` is empty. Otherwise, it's the
+  // result of `inner`, or true if that's void.
+  //
+  // It holds `inner` by reference, so it must be awaited in the same
+  // full-expression that `inner` was created in, or else `inner` must
+  // outlive it.
+  template<cancellable_awaiter A>
+  class timeout_awaiter {
+    using inner_result_t = decltype(std::declval<A&>().await_resume());
+
+  public:
+    using result_t = std::optional<std::conditional_t<
+        std::is_void_v<inner_result_t>, bool, inner_result_t>>;
+
+    timeout_awaiter(basic_timers& owner, A& inner, time_point_t deadline)
+        : owner_{owner}, inner_{inner}, deadline_{deadline} {}
+
+    timeout_awaiter(const timeout_awaiter&) = delete;
+    timeout_awaiter& operator=(const timeout_awaiter&) = delete;
+
+    ~timeout_awaiter() { disarm(); }
+
+    [[nodiscard]] bool await_ready() { return inner_.await_ready(); }
+
+    // The timer is set before `inner` suspends, since `inner` may resume the
+    // coroutine, and so destroy this awaiter, before `await_suspend` returns.
+    bool await_suspend(std::coroutine_handle<> handle) {
+      timer_id_ = owner_.set(deadline_, [this, handle](timer_event&) {
+        timer_id_ = timer_id_t::invalid;
+        if (!inner_.await_cancel()) return;
+        timed_out_ = true;
+        handle.resume();
+      }).timer_id;
+      using suspend_t = decltype(inner_.await_suspend(handle));
+      if constexpr (std::is_same_v<suspend_t, bool>) {
+        if (inner_.await_suspend(handle)) return true;
+        disarm();
+        return false;
+      } else {
+        inner_.await_suspend(handle);
+        return true;
+      }
+    }
+
+    result_t await_resume() {
+      if (timed_out_) return std::nullopt;
+      disarm();
+      if constexpr (std::is_void_v<inner_result_t>) {
+        inner_.await_resume();
+        return true;
+      } else {
+        return inner_.await_resume();
+      }
+    }
+
+  private:
+    basic_timers& owner_;
+    A& inner_;
+    const time_point_t deadline_;
+    timer_id_t timer_id_{};
+    bool timed_out_{};
+
+    void disarm() {
+      if (timer_id_ != timer_id_t::invalid)
+        owner_.cancel(std::exchange(timer_id_, timer_id_t::invalid));
+    }
+  };
+
+  [[nodiscard]] sleep_awaiter sleep_until(time_point_t deadline) {
+    return {*this, deadline};
+  }
+  [[nodiscard]] sleep_awaiter sleep_for(duration_t delay) {
+    return {*this, get_now() + delay};
+  }
+
+  template<cancellable_awaiter A>
+  [[nodiscard]] timeout_awaiter<A> with_timeout(A& inner, duration_t delay) {
+    return {*this, inner, get_now() + delay};
+  }
+  template<cancellable_awaiter A>
+  [[nodiscard]] timeout_awaiter<A> with_timeout(A&& inner, duration_t delay) {
+    return {*this, inner, get_now() + delay};
+  }
+
   // For testing only.
 
   void set_clock_callback(clock_callback_t callback) {
@@ -296,7 +967,16 @@ public:
   }
 
   void set_next_timer_id(uint64_t next_timer_id) {
-    next_timer_id_ = next_timer_id;
+    submissions_->set_next_timer_id(next_timer_id);
+  }
+
+  // For sharding.
+
+  // Assign IDs with `tag` in their low `tag_bits`, so that the owner of a
+  // timer can be found from its ID alone. Must be called before any timers
+  // are set.
+  void set_id_tag(size_t tag_bits, uint64_t tag) {
+    submissions_->set_id_tag(tag_bits, tag);
   }
 
 private:
@@ -305,24 +985,185 @@ private:
     return std::chrono::steady_clock::now();
   };
 
-  // Next timer ID to assign. May wrap around.
-  uint64_t next_timer_id_{};
+  // Minimum number of dead entries before `cancel` considers compacting.
+  static constexpr size_t min_compact_entries = 64;
+
+  // Pending submissions from other threads, along with the next timer ID to
+  // assign, which may wrap around. Held by pointer so that the instance can
+  // be moved.
+  std::unique_ptr<submission_queue> submissions_ =
+      std::make_unique<submission_queue>();
+
+  // Number of entries in `scheduled_events_` for canceled events.
+  size_t dead_entries_{};
+
+  // Number of times `compact` was called.
+  size_t compactions_{};
+
+  // ID of the event whose callback `tick` is running, if any. Its entry is
+  // not in `scheduled_events_`, so canceling it leaves nothing dead.
+  timer_id_t firing_id_{timer_id_t::invalid};
+
+  // Recycles the nodes of `events_by_id_`, so that, once it reaches its peak
+  // size, setting timers doesn't allocate. Held by pointer so that moving
+  // the instance doesn't invalidate the map's allocator. For assignment,
+  // see `operator=`.
+  std::unique_ptr<pool::free_list> event_pool_ =
+      std::make_unique<pool::free_list>();
 
   // We store each `timer_event` in `events_by_id_`, removing it as soon as
   // we've determined that it won't be scheduled again.
-  timer_map_t events_by_id_;
+  timer_map_t events_by_id_{timer_map_t::allocator_type{*event_pool_}};
 
   // For each event, there should be exactly one entry in `scheduled_events_`
   // at any time. It's possible for an entry to reference an event that has
   // been removed, in which case the ID lookup will harmlessly fail.
-  scheduled_queue_t scheduled_events_;
+  Q scheduled_events_;
+
+  // Reusable storage for `tick_batch`, so that it doesn't allocate at steady
+  // state.
+  std::vector<timer_event*> batch_;
+  std::vector<timer_map_t::iterator> batch_its_;
+
+  // Create the event and schedule it, unless the ID is already in use, in
+  // which case, returns `nullptr`. Note that `try_emplace` leaves `callback`
+  // alone when it doesn't insert. If scheduling throws, the event is removed.
+  timer_event* arm(timer_id_t timer_id, time_point_t start_at,
+      timer_callback_t& callback, duration_t repeat_in, time_point_t stop_at,
+      duration_t slack) {
+    auto [inserted_at, was_inserted] = events_by_id_.try_emplace(timer_id,
+        timer_id, start_at, repeat_in, stop_at, slack, std::move(callback));
+    if (!was_inserted) return nullptr;
+    auto& new_event = inserted_at->second;
+    new_event.next_at = coalesce(new_event, start_at);
+    try {
+      scheduled_events_.push({new_event.next_at, new_event.timer_id});
+    }
+    catch (...) {
+      events_by_id_.erase(inserted_at);
+      throw;
+    }
+    return &new_event;
+  }
+
+  // Round `next_at` up to the event's slack granularity, unless that would
+  // reach its `stop_at`.
+  [[nodiscard]] static time_point_t
+  coalesce(const timer_event& event, time_point_t next_at) {
+    if (event.slack <= duration_t{}) return next_at;
+    const auto granularity = duration_t{
+        std::bit_floor(static_cast<uint64_t>(event.slack.count()))};
+    auto remainder = next_at.time_since_epoch() % granularity;
+    if (remainder == duration_t{}) return next_at;
+    if (remainder < duration_t{}) remainder += granularity;
+    const auto rounded = next_at + (granularity - remainder);
+    if (event.stop_at != time_point_t{} && event.stop_at <= rounded)
+      return next_at;
+    return rounded;
+  }
+
+  // Pop scheduled entries until one references a live event that's ready at
+  // `tick_now`, returning it, or `end()` if there are none.
+  timer_map_t::iterator pop_due(time_point_t tick_now) {
+    scheduled_event ready;
+    while (scheduled_events_.pop_ready(tick_now, ready)) {
+      const auto [next_at, timer_id] = ready;
+
+      // Look for the matching `timer_event`. If not found, it was canceled, so
+      // this is a false alarm. Note how we check the `next_at` to avoid the
+      // unlikely possibility of the event ID being reused while pending.
+      auto it = events_by_id_.find(timer_id);
+      if (it == events_by_id_.end() || it->second.next_at != next_at) {
+        if (dead_entries_) --dead_entries_;
+        continue;
+      }
+
+      // If it expired, cancel it. This means that an event whose `stop_at` is
+      // specified might never get triggered.
+      auto& event = it->second;
+      if (event.stop_at != time_point_t{} && event.stop_at <= tick_now) {
+        events_by_id_.erase(it);
+        continue;
+      }
+
+      return it;
+    }
+    return events_by_id_.end();
+  }
+
+  // After the event was fired at `callback_now`, schedule it again or remove
+  // it.
+  void reschedule(timer_map_t::iterator it, time_point_t callback_now) {
+    auto& event = it->second;
+
+    // If the callback didn't reschedule, try to schedule the next time.
+    // Note how we add `repeat_in` to `get_now()`, not `callback_now`, so
+    // that it's the interval between calls, not returns. If this isn't the
+    // desired behavior, then the callback handler should reschedule itself.
+    if (event.next_at == callback_now) {
+      if (event.repeat_in != duration_t{})
+        event.next_at = coalesce(event, get_now() + event.repeat_in);
+      else
+        event.next_at = time_point_t{};
+    }
+
+    // Don't bother scheduling if it'll expire before it can trigger. We
+    // don't have to do this, but we might as well because it's cheap and
+    // avoids possibly waking up prematurely.
+    if (event.stop_at != time_point_t{} && event.stop_at <= event.next_at)
+      event.next_at = time_point_t{};
+
+    // If it's not scheduled, then there's no reason to keep it.
+    if (event.next_at <= callback_now) {
+      events_by_id_.erase(it);
+      return;
+    }
+
+    scheduled_events_.push({event.next_at, event.timer_id});
+  }
+
+  // Apply pending submissions, in order. If applying one throws, then it's
+  // discarded, but the rest are put back, to be applied by the next call.
+  void apply_submissions() {
+    auto head = submissions_->take_all();
+    while (head) {
+      std::unique_ptr<submission_queue::submission> node{
+          std::exchange(head, head->next)};
+      try {
+        if (node->is_cancel)
+          cancel(node->timer_id);
+        else
+          arm(node->timer_id, node->start_at, node->callback, node->repeat_in,
+              node->stop_at, node->slack);
+      }
+      catch (...) {
+        submissions_->put_back(head);
+        throw;
+      }
+    }
+  }
+
+  // Whether the scheduled entry references a live event.
+  [[nodiscard]] bool is_live(const scheduled_event& se) const {
+    auto it = events_by_id_.find(se.timer_id);
+    return it != events_by_id_.end() && it->second.next_at == se.next_at;
+  }
 };
+
+// Timers scheduled by binary heap.
+using timers = basic_timers<scheduled_heap>;
+
+// Timers scheduled by hierarchical timing wheel.
+using wheel_timers = basic_timers<scheduled_wheel>;
 } // namespace timers_ns
 
 // Exported types.
 using timer_id_t = timers_ns::timer_id_t;
 using timers = timers_ns::timers;
+using wheel_timers = timers_ns::wheel_timers;
 using timer_event = timers_ns::timer_event;
+using timer_stats = timers_ns::timer_stats;
+using timers_ns::cancellable_awaiter;
 
 }} // namespace corvid::container
 
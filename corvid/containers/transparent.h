@@ -17,6 +17,8 @@
 
 #pragma once
 #include "containers_shared.h"
+#include "../strings/cases.h"
+#include "../strings/hashing.h"
 
 namespace corvid { inline namespace containers {
 
@@ -37,18 +39,55 @@ struct transparent_less_stringlike {
   }
 };
 
+// Hashes with `strings::fast_hash`, so a `strings::hashed_string_view`
+// supplies its cached hash instead of being rehashed. Two of those compare
+// their hashes before their bytes.
 struct transparent_hash_equal_stringlike {
   using is_transparent = void;
 
   template<typename T>
   constexpr size_t operator()(const T& t) const {
-    return std::hash<std::string_view>{}(std::string_view{t});
+    if constexpr (std::is_same_v<T, strings::hashed_string_view>)
+      return t.hash();
+    else
+      return strings::fast_hash(std::string_view{t});
   }
 
   template<typename T, typename V>
   constexpr bool operator()(const T& l, const V& r) const {
-    return static_cast<std::string_view>(l) ==
-           static_cast<std::string_view>(r);
+    if constexpr (std::is_same_v<T, strings::hashed_string_view> &&
+                  std::is_same_v<V, strings::hashed_string_view>)
+      return l == r;
+    else
+      return static_cast<std::string_view>(l) ==
+             static_cast<std::string_view>(r);
+  }
+};
+
+// Case-insensitive versions of the above, for ASCII, such as for HTTP header
+// names. They rely on `strings::icompare`, `strings::ihash`, and
+// `strings::iequal`, which work eight bytes at a time.
+struct transparent_iless_stringlike {
+  using is_transparent = void;
+
+  template<typename T, typename V>
+  bool operator()(const T& l, const V& r) const {
+    return strings::icompare(std::string_view{l}, std::string_view{r}) < 0;
+  }
+};
+
+struct transparent_ihash_equal_stringlike {
+  using is_transparent = void;
+
+  template<typename T>
+  size_t operator()(const T& t) const {
+    return strings::ihash(std::string_view{t});
+  }
+
+  template<typename T, typename V>
+  bool operator()(const T& l, const V& r) const {
+    return strings::iequal(static_cast<std::string_view>(l),
+        static_cast<std::string_view>(r));
   }
 };
 
@@ -79,4 +118,24 @@ using string_unordered_set = string_unordered_set_alloc<>;
 using string_unordered_set = std::unordered_set<std::string,
     transparent_hash_equal_stringlike, transparent_hash_equal_stringlike>;
 
+// Map keyed by `std::string`, ignoring ASCII case, with transparent search.
+template<typename V = std::string,
+    typename A = std::allocator<std::pair<const std::string, V>>>
+using istring_map = std::map<std::string, V, transparent_iless_stringlike, A>;
+
+// Unordered map keyed by `std::string`, ignoring ASCII case, with transparent
+// search.
+template<typename V = std::string,
+    typename A = std::allocator<std::pair<const std::string, V>>>
+using istring_unordered_map = std::unordered_map<std::string, V,
+    transparent_ihash_equal_stringlike, transparent_ihash_equal_stringlike, A>;
+
+// Unordered set of `std::string`, ignoring ASCII case, with transparent
+// search.
+template<typename A = std::allocator<std::string>>
+using istring_unordered_set_alloc = std::unordered_set<std::string,
+    transparent_ihash_equal_stringlike, transparent_ihash_equal_stringlike, A>;
+
+using istring_unordered_set = istring_unordered_set_alloc<>;
+
 }} // namespace corvid::containers
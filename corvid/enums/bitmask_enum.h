@@ -21,6 +21,9 @@
 #include "enum_registry.h"
 #include "scoped_enum.h"
 
+#include <iterator>
+#include <span>
+
 namespace corvid { inline namespace enums { namespace bitmask {
 
 //
@@ -371,75 +374,217 @@ template<BitmaskEnum E>
   return !has(v, m);
 }
 
-namespace details {
-// Helper function to append bitmask to target, using bit names.
-template<ScopedEnum E, size_t N>
-auto& do_bit_append(AppendTarget auto& target, E v,
-    const std::array<std::string_view, N>& names) {
-  static constexpr strings::delim plus(" + ");
-  bool first{true};
+// Bulk
+
+// The bulk functions apply the same mask to every value of a contiguous range
+// of bitmask enums, such as a `std::span`, `std::vector`, or `std::array`.
+// They have the same results as calling the single-value functions in a loop,
+// but they hoist the mask out and work on the underlying integers. Apart from
+// the filters, the loop bodies are branch-free, so the compiler can vectorize
+// them.
+//
+// Invalid bits in the mask are not clipped, even when `wrapclip::limit`, just
+// as they aren't by `set` or `has_all`.
+
+// Concept for a contiguous range of bitmask enums.
+template<typename R>
+concept BitmaskRange = std::ranges::contiguous_range<R> &&
+                       std::ranges::sized_range<R> &&
+                       BitmaskEnum<std::ranges::range_value_t<R>>;
+
+// Return how many of the values in `vs` have any of the bits in `m` set.
+template<BitmaskRange R>
+[[nodiscard]] constexpr size_t
+count_has(const R& vs, std::ranges::range_value_t<R> m) noexcept {
+  const auto mu = *m;
+  size_t cnt{};
+  for (const auto v : vs) cnt += (*v & mu) != 0;
+  return cnt;
+}
+
+// Return how many of the values in `vs` have all of the bits in `m` set.
+template<BitmaskRange R>
+[[nodiscard]] constexpr size_t
+count_has_all(const R& vs, std::ranges::range_value_t<R> m) noexcept {
+  const auto mu = *m;
+  size_t cnt{};
+  for (const auto v : vs) cnt += (*v & mu) == mu;
+  return cnt;
+}
+
+// Copy the values in `vs` that have any of the bits in `m` set to `out`,
+// returning the end of the output.
+template<BitmaskRange R, typename O>
+requires std::output_iterator<O, std::ranges::range_value_t<R>>
+constexpr O filter_has(const R& vs, std::ranges::range_value_t<R> m, O out) {
+  const auto mu = *m;
+  for (const auto v : vs)
+    if (*v & mu) *out++ = v;
+  return out;
+}
+
+// Copy the values in `vs` that have all of the bits in `m` set to `out`,
+// returning the end of the output.
+template<BitmaskRange R, typename O>
+requires std::output_iterator<O, std::ranges::range_value_t<R>>
+constexpr O
+filter_has_all(const R& vs, std::ranges::range_value_t<R> m, O out) {
+  const auto mu = *m;
+  for (const auto v : vs)
+    if ((*v & mu) == mu) *out++ = v;
+  return out;
+}
+
+// Set the bits in `m` in each of the values in `vs`.
+template<BitmaskRange R>
+constexpr void set_all(R&& vs, std::ranges::range_value_t<R> m) noexcept {
+  using E = std::ranges::range_value_t<R>;
+  const auto mu = *m;
+  for (auto& v : vs) v = E(*v | mu);
+}
+
+// Clear the bits in `m` in each of the values in `vs`. As with `clear`, when
+// `wrapclip::limit`, this also clears any invalid bits.
+template<BitmaskRange R>
+constexpr void clear_all(R&& vs, std::ranges::range_value_t<R> m) noexcept {
+  using E = std::ranges::range_value_t<R>;
+  const auto keep = *~m;
+  for (auto& v : vs) v = E(*v & keep);
+}
+
+// Flip only the valid bits of each of the values in `vs`.
+template<BitmaskRange R>
+constexpr void flip_all(R&& vs) noexcept {
+  using E = std::ranges::range_value_t<R>;
+  const auto mu = *max_value<E>();
+  for (auto& v : vs) v = E(*v ^ mu);
+}
 
-  for (size_t ndx = N; ndx != 0; --ndx) {
-    auto mask = make_at<E>(ndx);
-    auto ofs = N - ndx;
+namespace details {
+// How the names of a bitmask enum are interpreted.
+enum class composite_kind { bits, values };
+
+// Every combination of names of a bitmask enum, rendered at compile time, so
+// that formatting a value takes a lookup instead of a search.
+//
+// For bit names, there's a table of 256 entries for each byte, where each
+// entry is the names of the bits set in it, joined in msb order. For value
+// names, there's an entry for each valid value, holding the names that would
+// be shown for it. Each entry also holds the bits its names account for, so
+// that the rest can be shown as a residual.
+template<size_t Count, size_t Size>
+struct composite_names {
+  std::array<char, Size> text{};
+  std::array<uint32_t, Count + 1> offsets{};
+  std::array<uint64_t, Count> covered{};
+
+  [[nodiscard]] constexpr std::string_view
+  operator[](size_t i) const noexcept {
+    return {text.data() + offsets[i], offsets[i + 1] - offsets[i]};
+  }
+};
 
-    // If bit matched, print and remove.
-    if (has(v, mask) && names[ofs].size()) {
-      plus.append_skip_first(target, first);
-      strings::appender{target}.append(names[ofs]);
-      v = E(*v & ~*mask);
+// Render entry `i`, passing each piece to `f`, and return the bits covered.
+template<composite_kind kind, size_t N, typename F>
+constexpr uint64_t render_composite(
+    const std::array<std::string_view, N>& names, uint64_t i, F&& f) {
+  using namespace std::literals;
+  uint64_t covered{};
+  bool first{true};
+  const auto add = [&](std::string_view name) {
+    if (!first) f(" + "sv);
+    first = false;
+    f(name);
+  };
+
+  if constexpr (kind == composite_kind::bits) {
+    // Names start with the msb.
+    const auto byte = i / 256;
+    for (size_t k = 8; k-- > 0;) {
+      const auto bit = byte * 8 + k;
+      if (!((i >> k) & 1) || bit >= N || names[N - 1 - bit].empty()) continue;
+      add(names[N - 1 - bit]);
+      covered |= uint64_t{1} << bit;
+    }
+  } else {
+    const auto name = [&](uint64_t ndx) {
+      return ndx < N ? names[ndx] : std::string_view{};
+    };
+
+    // First try a direct hit, then search for the named values it contains,
+    // largest first.
+    if (!name(i).empty()) {
+      add(name(i));
+      return i;
+    }
+    auto left = i;
+    for (auto ndx = i; ndx > 0 && left; --ndx) {
+      if ((left & ndx) != ndx || name(ndx).empty()) continue;
+      add(name(ndx));
+      left &= ~ndx;
+      covered |= ndx;
     }
-  }
 
-  // Print residual in hex.
-  if (*v || first)
-    strings::append_num<16>(plus.append_skip_first(target, first), *v);
-  return target;
+    // If nothing else was shown, show the zeroth value, if named.
+    if (first && !name(0).empty()) add(name(0));
+  }
+  return covered;
+}
+
+template<composite_kind kind, size_t Count, size_t N>
+consteval size_t
+composite_size(const std::array<std::string_view, N>& names) {
+  size_t size{};
+  for (size_t i = 0; i < Count; ++i)
+    render_composite<kind>(names, i,
+        [&](std::string_view piece) { size += piece.size(); });
+  return size;
+}
+
+template<composite_kind kind, size_t Count, size_t Size, size_t N>
+consteval auto
+make_composite_names(const std::array<std::string_view, N>& names) {
+  composite_names<Count, Size> out;
+  size_t at{};
+  for (size_t i = 0; i < Count; ++i) {
+    out.offsets[i] = static_cast<uint32_t>(at);
+    out.covered[i] = render_composite<kind>(names, i,
+        [&](std::string_view piece) {
+          for (const char c : piece) out.text[at++] = c;
+        });
+  }
+  out.offsets[Count] = static_cast<uint32_t>(at);
+  return out;
 }
 
-// Helper function to append bitmask to target, using value names.
-template<ScopedEnum E, size_t N>
-auto& do_value_append(AppendTarget auto& target, E v,
-    const std::array<std::string_view, N>& names) {
+// Append the rendered names for `v`, followed by any residual in hex.
+template<composite_kind kind, ScopedEnum E, size_t Count, size_t Size>
+auto& do_composite_append(AppendTarget auto& target, E v,
+    const composite_names<Count, Size>& composites) {
   static constexpr strings::delim plus(" + ");
-  constexpr size_t all_valid_bits = valid_bits_v<E>;
+  const auto u = static_cast<uint64_t>(*v);
   bool first{true};
-
-  // First try to do a direct lookup.
-  const auto valid_part = *v & all_valid_bits;
-  if (names[valid_part].size()) {
+  uint64_t covered{};
+  const auto append_entry = [&](size_t i) {
+    const auto piece = composites[i];
+    if (piece.empty()) return;
     plus.append_skip_first(target, first);
-    strings::appender{target}.append(names[valid_part]);
-    v = E(*v & ~all_valid_bits);
+    strings::appender{target}.append(piece);
+    covered |= composites.covered[i];
+  };
+
+  if constexpr (kind == composite_kind::bits) {
+    for (size_t byte = Count / 256; byte-- > 0;)
+      append_entry(byte * 256 + ((u >> (byte * 8)) & 0xff));
+  } else {
+    append_entry(u & valid_bits_v<E>);
   }
 
-  // Otherwise, do a linear search for the remaining named values.
-  if (first) {
-    for (int64_t ndx = valid_part; ndx > 0; --ndx) {
-      auto mask = E(ndx);
-
-      // If bits matched, print and remove.
-      if (has_all(v, mask) && names[ndx].size()) {
-        plus.append_skip_first(target, first);
-        strings::appender{target}.append(names[ndx]);
-        v = E(*v & ~*mask);
-
-        // If no valid bits left, drop to number.
-        if (((*v & all_valid_bits) == 0)) break;
-      }
-    }
-  }
-
-  // As a special case, if we haven't printed anything, then try to print the
-  // zeroth value before we deal with residuals.
-  if (first && names[0].size()) {
-    first = false;
-    strings::appender{target}.append(names[0]);
-  }
-
-  // Print residual.
-  if (*v || first)
-    strings::append_num<16>(plus.append_skip_first(target, first), *v);
+  // Print residual in hex.
+  const auto residual = E(*v & ~static_cast<as_underlying_t<E>>(covered));
+  if (*residual || first)
+    strings::append_num<16>(plus.append_skip_first(target, first),
+        *residual);
   return target;
 }
 
@@ -447,18 +592,22 @@ auto& do_value_append(AppendTarget auto& target, E v,
 // the bits or the values. Use `make_bitmask_enum_spec` or
 // `make_bitmask_enum_names_spec`, respectively, to construct.
 template<ScopedEnum E, wrapclip bitclip = wrapclip{}, E validbits = E{},
-    std::size_t N = 0>
+    std::size_t N = 0, typename C = composite_names<0, 0>>
 struct bitmask_enum_names_spec
     : public bitmask_enum_spec<E, meta::as_underlying(validbits), bitclip> {
   constexpr bitmask_enum_names_spec(
-      const std::array<std::string_view, N>& name_list)
-      : names(name_list) {}
+      const std::array<std::string_view, N>& name_list,
+      const registry::details::name_index<N>& name_index,
+      const C& composite_list = {})
+      : names(name_list), index(name_index), composites(composite_list) {}
 
   auto& append(AppendTarget auto& target, E v) const {
     if constexpr (N == bits_length<E>())
-      return details::do_bit_append(target, v, names);
+      return details::do_composite_append<composite_kind::bits>(target, v,
+          composites);
     else if constexpr (N)
-      return details::do_value_append(target, v, names);
+      return details::do_composite_append<composite_kind::values>(target, v,
+          composites);
     else
       return strings::append_num<16>(target, *v);
   }
@@ -470,9 +619,8 @@ struct bitmask_enum_names_spec
         if (v != make<E>(*v)) return false;
       return true;
     }
-    auto found = std::find(names.begin(), names.end(), sv);
-    if (found == names.end()) return false;
-    auto ofs = std::distance(names.begin(), found);
+    auto ofs = index.find(names, sv);
+    if (ofs == index.npos) return false;
     constexpr auto bits = bits_length<E>();
     if constexpr (N == bits) ofs = 1 << (bits - ofs - 1);
     v = static_cast<E>(ofs);
@@ -480,6 +628,8 @@ struct bitmask_enum_names_spec
   }
 
   const std::array<std::string_view, N> names;
+  const registry::details::name_index<N> index;
+  const C composites;
 };
 
 // Compile-time conversion of bit name array to valid bits. The names start
@@ -534,7 +684,8 @@ template<ScopedEnum E, IntegerOrEnum auto validbits = 0,
     wrapclip bitclip = wrapclip{}>
 consteval auto make_bitmask_enum_spec() {
   return details::bitmask_enum_names_spec<E, bitclip, validbits, 0>{
-      std::array<std::string_view, 0>{}};
+      std::array<std::string_view, 0>{},
+      registry::details::name_index<0>{std::array<std::string_view, 0>{}}};
 }
 
 // Make an `enum_spec_v` from a list of bit names, starting with msb, marking
@@ -563,8 +714,18 @@ consteval auto make_bitmask_enum_spec() {
   constexpr auto name_count = name_array.size();
   constexpr auto valid_bits =
       details::calc_valid_bits_from_bit_names<bit_names>();
+  constexpr registry::details::name_index<name_count> index{filtered_names};
+  using details::composite_kind;
+  constexpr auto composite_count = (name_count + 7) / 8 * 256;
+  constexpr auto composite_size =
+      details::composite_size<composite_kind::bits, composite_count>(
+          filtered_names);
+  constexpr auto composites =
+      details::make_composite_names<composite_kind::bits, composite_count,
+          composite_size>(filtered_names);
   return details::bitmask_enum_names_spec<E, bitclip, E{valid_bits},
-      name_count>{filtered_names};
+      name_count, std::remove_const_t<decltype(composites)>>{filtered_names,
+      index, composites};
 }
 
 // Make a `enum_spec_v` from a list of value names, marking `E` as a bitmask
@@ -597,8 +758,18 @@ template<ScopedEnum E, strings::fixed_string bit_names,
   constexpr auto name_count = name_array.size();
   constexpr auto valid_bits =
       details::calc_valid_bits_from_value_names<bit_names>();
+  constexpr registry::details::name_index<name_count> index{trimmed_names};
+  using details::composite_kind;
+  constexpr auto composite_count = valid_bits + 1;
+  constexpr auto composite_size =
+      details::composite_size<composite_kind::values, composite_count>(
+          trimmed_names);
+  constexpr auto composites =
+      details::make_composite_names<composite_kind::values, composite_count,
+          composite_size>(trimmed_names);
   return details::bitmask_enum_names_spec<E, bitclip, E{valid_bits},
-      name_count>{trimmed_names};
+      name_count, std::remove_const_t<decltype(composites)>>{trimmed_names,
+      index, composites};
 }
 
 }}} // namespace corvid::enums::bitmask
@@ -627,13 +798,8 @@ template<ScopedEnum E, strings::fixed_string bit_names,
 
 // Consider offering a parser to convert string to enum, using the same
 // definition. In principle, it could split on "+", trim spaces, and then add
-// up the bit values. A working system would simply do a linear search through
-// the list of names, but maybe something like
-// https://blog.quarkslab.com/frozen-an-header-only-constexpr-alternative-to-gperf-for-c14-users.html
-// would work better. The idea would be to construct a map of names to values
-// at compile time and then query it at runtime. We really just need the part
-// where it sorts it at compile time, allowing us to do binary searches at
-// runtime.
+// up the bit values. Each part can be found through the spec's `name_index`,
+// the same as a whole name is now.
 
 // TODO: Consider providing `operator[]` that returns bool for a given
 // index. Essentially, the op version of `get_at`. At that point, we could
@@ -15,6 +15,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
 #include "enums_shared.h"
 #include "../strings/targeting.h"
 
@@ -74,6 +80,127 @@ bool lookup_helper(E& v, std::string_view sv) {
   return true;
 }
 
+// Perfect hash of a list of names, built at compile time, for finding the
+// position of a name without searching.
+//
+// Uses hash-and-displace: each name hashes to a bucket, and each bucket gets
+// a displacement that sends all of its names to free slots. A lookup hashes
+// the string once, mixes in the displacement for its bucket, and compares it
+// to the one name in that slot. Empty names aren't indexed, and neither are
+// repeats of an earlier name.
+template<size_t N>
+class name_index {
+public:
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  constexpr explicit name_index(const std::array<std::string_view, N>& names) {
+    build(names);
+  }
+
+  // Position of `sv` in `names`, which must be the list this was built from,
+  // or `npos`.
+  [[nodiscard]] constexpr size_t find(
+      const std::array<std::string_view, N>& names,
+      std::string_view sv) const noexcept {
+    if constexpr (N == 0) {
+      return npos;
+    } else {
+      const auto h = hash(sv);
+      const auto pos = slots_[slot_of(h, displacements_[bucket_of(h)])];
+      if (!pos || names[pos - 1] != sv) return npos;
+      return pos - 1;
+    }
+  }
+
+private:
+  static constexpr size_t bucket_count = std::bit_ceil((N + 3) / 4);
+  static constexpr size_t slot_count =
+      std::bit_ceil(std::max<size_t>(N * 2, 1));
+
+  std::array<uint32_t, bucket_count> displacements_{};
+  // Position plus one, or zero for free.
+  std::array<uint32_t, slot_count> slots_{};
+
+  [[nodiscard]] static constexpr uint64_t hash(std::string_view sv) noexcept {
+    uint64_t h = 0xcbf29ce484222325;
+    for (const char c : sv)
+      h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    return h;
+  }
+
+  [[nodiscard]] static constexpr uint64_t mix(uint64_t x) noexcept {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+  }
+
+  [[nodiscard]] static constexpr size_t bucket_of(uint64_t h) noexcept {
+    return (mix(h) >> 32) & (bucket_count - 1);
+  }
+
+  [[nodiscard]] static constexpr size_t
+  slot_of(uint64_t h, uint32_t displacement) noexcept {
+    return mix(h + (displacement + uint64_t{1}) * 0x9e3779b97f4a7c15) &
+           (slot_count - 1);
+  }
+
+  constexpr void build(const std::array<std::string_view, N>& names) {
+    // Sort the positions of the names by bucket, skipping empty ones and
+    // repeats.
+    std::array<uint64_t, N> hashes{};
+    std::array<bool, N> skip{};
+    std::array<size_t, bucket_count + 1> starts{};
+    for (size_t i = 0; i < N; ++i) {
+      skip[i] = names[i].empty();
+      if (skip[i]) continue;
+      hashes[i] = hash(names[i]);
+      ++starts[bucket_of(hashes[i]) + 1];
+    }
+    for (size_t b = 0; b < bucket_count; ++b) starts[b + 1] += starts[b];
+    std::array<size_t, N> order{};
+    auto next = starts;
+    for (size_t i = 0; i < N; ++i)
+      if (!skip[i]) order[next[bucket_of(hashes[i])]++] = i;
+
+    size_t largest{};
+    for (size_t b = 0; b < bucket_count; ++b) {
+      for (size_t k = starts[b]; k < starts[b + 1]; ++k)
+        for (size_t j = starts[b]; j < k && !skip[order[k]]; ++j)
+          skip[order[k]] = names[order[j]] == names[order[k]];
+      largest = std::max(largest, starts[b + 1] - starts[b]);
+    }
+
+    // Place the largest buckets first, while most slots are free.
+    for (size_t size = largest; size; --size)
+      for (size_t b = 0; b < bucket_count; ++b)
+        if (starts[b + 1] - starts[b] == size)
+          place(b, starts[b], starts[b + 1], order, hashes, skip);
+  }
+
+  // Find a displacement that sends every name in bucket `b` to a free slot,
+  // and fill those slots.
+  constexpr void place(size_t b, size_t first, size_t last,
+      const std::array<size_t, N>& order,
+      const std::array<uint64_t, N>& hashes, const std::array<bool, N>& skip) {
+    for (uint32_t d = 0;; ++d) {
+      auto k = first;
+      for (; k < last; ++k) {
+        const auto i = order[k];
+        if (skip[i]) continue;
+        auto& slot = slots_[slot_of(hashes[i], d)];
+        if (slot) break;
+        slot = static_cast<uint32_t>(i + 1);
+      }
+      if (k == last) {
+        displacements_[b] = d;
+        return;
+      }
+      for (auto u = first; u < k; ++u)
+        if (!skip[order[u]]) slots_[slot_of(hashes[order[u]], d)] = 0;
+    }
+  }
+};
+
 } // namespace details
 
 } // namespace registry
@@ -316,8 +316,9 @@ template<ScopedEnum E, E maxseq = E{}, E minseq = E{},
     wrapclip wrapseq = wrapclip{}, size_t N = 0>
 struct sequence_enum_names_spec
     : public sequence_enum_spec<E, maxseq, minseq, wrapseq> {
-  constexpr sequence_enum_names_spec(std::array<std::string_view, N> name_list)
-      : names(name_list) {}
+  constexpr sequence_enum_names_spec(std::array<std::string_view, N> name_list,
+      const registry::details::name_index<N>& name_index)
+      : names(name_list), index(name_index) {}
 
   auto& append(AppendTarget auto& target, E v) const {
     return do_seq_append(target, v, names);
@@ -330,13 +331,14 @@ struct sequence_enum_names_spec
         if (v != make<E>(*v)) return false;
       return true;
     }
-    auto found = std::find(names.begin(), names.end(), sv);
-    if (found == names.end()) return false;
-    v = make<E>(std::distance(names.begin(), found) + *min_value<E>());
+    const auto found = index.find(names, sv);
+    if (found == index.npos) return false;
+    v = make<E>(found + *min_value<E>());
     return true;
   }
 
   const std::array<std::string_view, N> names;
+  const registry::details::name_index<N> index;
 };
 } // namespace details
 
@@ -354,14 +356,17 @@ struct sequence_enum_names_spec
 // Prints the matching name for the value. If it is not in the range of the
 // names, or if the name for that value is empty, the numerical value is
 // printed.
+//
+// Parses names through a perfect hash built at compile time.
 template<ScopedEnum E, strings::fixed_string names,
     wrapclip wrapseq = wrapclip{}, E minseq = E{}>
 [[nodiscard]] constexpr auto make_sequence_enum_spec() {
   constexpr auto name_array = strings::fixed_split_trim<names, " -?*">();
   constexpr auto name_count = name_array.size();
   constexpr auto maxseq = E{as_underlying(minseq) + name_count - 1};
+  constexpr registry::details::name_index<name_count> index{name_array};
   return details::sequence_enum_names_spec<E, maxseq, minseq, wrapseq,
-      name_count>{name_array};
+      name_count>{name_array, index};
 }
 
 // Make an `enum_spec_v` from a range of values, marking `E` as a sequence
@@ -0,0 +1,115 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "unique_fd.h"
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace corvid { inline namespace io {
+
+namespace details {
+// Deleter that unmaps a mapping of `size` bytes.
+struct unmap_deleter {
+  size_t size{};
+
+  void operator()(char* p) const noexcept {
+    if (p) ::munmap(p, size);
+  }
+};
+} // namespace details
+
+// Read-only memory mapping of a whole file.
+//
+// Exposes the contents as a `std::string_view`, a `std::span<const char>`,
+// or a `std::span<const std::byte>`, so that splitters and parsers, or a
+// `string_intern_image`, can run straight over the file without copying it.
+// The mapping outlives the descriptor it was made from, and is unmapped when
+// the instance is destroyed. Move-only.
+//
+// An empty file has no mapping, so its views are empty.
+class mapped_file {
+public:
+  // Access pattern hints for `advise`, which map to `madvise`.
+  enum class advice {
+    normal = MADV_NORMAL,
+    sequential = MADV_SEQUENTIAL,
+    random = MADV_RANDOM,
+    willneed = MADV_WILLNEED,
+    dontneed = MADV_DONTNEED
+  };
+
+  mapped_file() noexcept = default;
+
+  // Map the file open as `fd`, which must be readable. Throws
+  // `std::system_error` on failure.
+  explicit mapped_file(const unique_fd& fd, advice hint = advice::normal) {
+    struct stat st;
+    if (::fstat(*fd, &st) == -1) throw_errno("fstat");
+    const auto size = static_cast<size_t>(st.st_size);
+    if (!size) return;
+    auto p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, *fd, 0);
+    if (p == MAP_FAILED) throw_errno("mmap");
+    map_ = own_ptr<char, details::unmap_deleter>{static_cast<char*>(p),
+        details::unmap_deleter{size}};
+    if (hint != advice::normal) advise(hint);
+  }
+
+  // Open and map the file at `path`.
+  explicit mapped_file(cstring_view path, advice hint = advice::normal)
+      : mapped_file{open_fd(path, O_RDONLY), hint} {}
+
+  // Accessors.
+  [[nodiscard]] const char* data() const noexcept { return map_.get(); }
+  [[nodiscard]] size_t size() const noexcept {
+    return map_ ? map_.get_deleter().size : 0;
+  }
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+
+  [[nodiscard]] std::string_view view() const noexcept {
+    return {data(), size()};
+  }
+  [[nodiscard]] std::span<const char> span() const noexcept {
+    return {data(), size()};
+  }
+  [[nodiscard]] std::span<const std::byte> bytes() const noexcept {
+    return std::as_bytes(span());
+  }
+
+  // Hint how the range from `offset`, for `length` bytes, will be accessed.
+  // The offset is rounded down to a page boundary, and the length is
+  // clipped to the end. Throws `std::system_error` on failure.
+  void advise(advice hint, size_t offset = 0,
+      size_t length = std::string_view::npos) const {
+    if (offset >= size()) return;
+    length = std::min(length, size() - offset);
+    const auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const auto start = offset / page * page;
+    if (::madvise(map_.get() + start, length + (offset - start),
+            static_cast<int>(hint)) == -1)
+      throw_errno("madvise");
+  }
+
+private:
+  own_ptr<char, details::unmap_deleter> map_;
+};
+
+}} // namespace corvid::io
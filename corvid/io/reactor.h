@@ -0,0 +1,565 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "../containers/small_function.h"
+#include "../containers/timers.h"
+#include "unique_fd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace corvid { inline namespace io {
+
+// Kernel interface that a reactor waits with.
+enum class reactor_backend { io_uring, epoll };
+
+namespace details {
+
+// Minimal io_uring, driven by raw system calls, for polling descriptors.
+//
+// Each poll is one-shot, so, like `epoll` without `EPOLLET`, a descriptor
+// that's still ready when it's polled again completes again. The submission
+// and completion rings are shared with the kernel, entries are queued
+// without system calls, and `wait` submits them all at once while waiting.
+class uring {
+public:
+  uring() noexcept = default;
+  uring(const uring&) = delete;
+  uring& operator=(const uring&) = delete;
+  ~uring() { unmap(); }
+
+  // Set up a ring with at least `entries` submission slots. Returns false,
+  // leaving it closed, if io_uring is unavailable, perhaps by policy, or
+  // lacks the features used here, which need Linux 5.11.
+  bool open(unsigned entries) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CLAMP;
+    auto fd = adopt_fd(
+        static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params)));
+    if (!fd) return false;
+    constexpr auto needed =
+        IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & needed) != needed) return false;
+
+    // With `IORING_FEAT_SINGLE_MMAP`, one mapping holds both rings.
+    const auto& sq = params.sq_off;
+    const auto& cq = params.cq_off;
+    ring_size_ = std::max<size_t>(sq.array + params.sq_entries * sizeof(int),
+        cq.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    ring_ = map(*fd, ring_size_, IORING_OFF_SQ_RING);
+    sqes_ = static_cast<io_uring_sqe*>(map(*fd, sqes_size_, IORING_OFF_SQES));
+    if (!ring_ || !sqes_) {
+      unmap();
+      return false;
+    }
+
+    sq_head_ = at<unsigned>(sq.head);
+    sq_tail_ = at<unsigned>(sq.tail);
+    sq_mask_ = *at<unsigned>(sq.ring_mask);
+    sq_array_ = at<unsigned>(sq.array);
+    sq_entries_ = params.sq_entries;
+    cq_head_ = at<unsigned>(cq.head);
+    cq_tail_ = at<unsigned>(cq.tail);
+    cq_mask_ = *at<unsigned>(cq.ring_mask);
+    cqes_ = at<io_uring_cqe>(cq.cqes);
+    tail_ = *sq_tail_;
+    fd_ = std::move(fd);
+    return true;
+  }
+
+  [[nodiscard]] explicit operator bool() const noexcept {
+    return static_cast<bool>(fd_);
+  }
+
+  // Queue a one-shot poll of `fd` for the `EPOLL*` bits in `events`, which
+  // completes with `data` and the ready events as its result.
+  void poll(int fd, uint32_t events, uint64_t data) {
+    if constexpr (std::endian::native == std::endian::big)
+      events = std::rotl(events, 16);
+    auto& sqe = next_sqe();
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = fd;
+    sqe.poll32_events = events;
+    sqe.user_data = data;
+  }
+
+  // Queue removal of the poll that completes with `target`, which then
+  // completes with `-ECANCELED`. The removal itself completes with `data`.
+  void cancel_poll(uint64_t target, uint64_t data) {
+    auto& sqe = next_sqe();
+    sqe.opcode = IORING_OP_POLL_REMOVE;
+    sqe.fd = -1;
+    sqe.addr = target;
+    sqe.user_data = data;
+  }
+
+  // Submit queued entries, then wait up to `timeout_ms`, or indefinitely if
+  // -1, for a completion. Returns immediately if one is already available.
+  // Interruption by a signal counts as a timeout.
+  void wait(int timeout_ms) {
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    if (timeout_ms >= 0) {
+      ts.tv_sec = timeout_ms / 1000;
+      ts.tv_nsec = (timeout_ms % 1000) * 1'000'000L;
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    if (enter(IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+            sizeof(arg)) == -1 &&
+        errno != EINTR && errno != ETIME && errno != EBUSY)
+      throw_errno("io_uring_enter");
+  }
+
+  // Submit queued entries without waiting, ignoring errors, which leave
+  // them queued for the next `wait`.
+  void submit() noexcept { (void)enter(0, nullptr, 0); }
+
+  // Invoke `f` with the `data` and result of each available completion, up
+  // to `max`, returning how many there were. `f` may queue entries.
+  template<typename F>
+  size_t reap(size_t max, F&& f) {
+    std::atomic_ref<unsigned> head_ref{*cq_head_};
+    auto head = head_ref.load(std::memory_order::relaxed);
+    const auto tail =
+        std::atomic_ref<unsigned>{*cq_tail_}.load(std::memory_order::acquire);
+    size_t count{};
+    for (; head != tail && count < max; ++count) {
+      const auto cqe = cqes_[head++ & cq_mask_];
+      head_ref.store(head, std::memory_order::release);
+      f(cqe.user_data, cqe.res);
+    }
+    return count;
+  }
+
+private:
+  unique_fd fd_;
+  void* ring_{};
+  size_t ring_size_{};
+  io_uring_sqe* sqes_{};
+  size_t sqes_size_{};
+  unsigned* sq_head_{};
+  unsigned* sq_tail_{};
+  unsigned* sq_array_{};
+  unsigned sq_mask_{};
+  unsigned sq_entries_{};
+  unsigned* cq_head_{};
+  unsigned* cq_tail_{};
+  unsigned cq_mask_{};
+  io_uring_cqe* cqes_{};
+
+  // Our copy of the submission tail.
+  unsigned tail_{};
+
+  [[nodiscard]] static void* map(int fd, size_t size, off_t offset) noexcept {
+    const auto p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, offset);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  void unmap() noexcept {
+    if (sqes_) ::munmap(sqes_, sqes_size_);
+    if (ring_) ::munmap(ring_, ring_size_);
+    sqes_ = nullptr;
+    ring_ = nullptr;
+  }
+
+  template<typename U>
+  [[nodiscard]] U* at(unsigned offset) const noexcept {
+    return reinterpret_cast<U*>(static_cast<char*>(ring_) + offset);
+  }
+
+  [[nodiscard]] unsigned queued() const noexcept {
+    return tail_ -
+           std::atomic_ref<unsigned>{*sq_head_}.load(
+               std::memory_order::acquire);
+  }
+
+  // Claim the next submission entry, zeroed, submitting the queued ones
+  // first if the ring is full.
+  io_uring_sqe& next_sqe() {
+    if (queued() == sq_entries_) {
+      if (enter(0, nullptr, 0) == -1 && errno != EINTR && errno != EBUSY)
+        throw_errno("io_uring_enter");
+      if (queued() == sq_entries_)
+        throw std::system_error(
+            std::make_error_code(std::errc::no_buffer_space),
+            "io_uring_enter");
+    }
+    const auto index = tail_ & sq_mask_;
+    auto& sqe = sqes_[index];
+    sqe = io_uring_sqe{};
+    sq_array_[index] = index;
+    std::atomic_ref<unsigned>{*sq_tail_}.store(++tail_,
+        std::memory_order::release);
+    return sqe;
+  }
+
+  int enter(unsigned flags, const void* arg, size_t arg_size) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, *fd_, queued(),
+        flags & IORING_ENTER_GETEVENTS ? 1 : 0, flags, arg, arg_size));
+  }
+};
+
+} // namespace details
+
+// Single-threaded event loop that waits on file descriptors and services a
+// `timers` instance that it owns.
+//
+// It waits with io_uring when the kernel allows it, and otherwise falls back
+// to `epoll`. Either way, each iteration of `run_once` waits once, for up to
+// `max_events` descriptors to become ready or for the next timer to come due,
+// whichever is first, then dispatches the whole batch of ready descriptors
+// before calling `tick`. The wait timeout comes from `next_at`, rounded up to
+// the millisecond, so the loop doesn't wake early just to find nothing due.
+//
+// With io_uring, each watched descriptor has a one-shot poll in flight. The
+// polls for a batch are rearmed after it's dispatched, and they're
+// submitted by the same `io_uring_enter` that waits for the next batch, so
+// an iteration costs a single system call. Watches are level-triggered, as
+// they are with `epoll`, and `EPOLLONESHOT` disables one until `modify`, but
+// `EPOLLET` is only honored by `epoll`. If polling a descriptor fails, its
+// callback gets `EPOLLERR`, and it's no longer polled until `modify`.
+//
+// Descriptors are watched, modified, and unwatched only from the thread that
+// runs the loop, typically from inside callbacks. Other threads may call
+// `post`, `submit_set`, `submit_cancel`, and `stop`, which go through the
+// lock-free submission queue of the `timers` and then wake the loop through
+// an `eventfd`.
+//
+// Throws `std::system_error` if the kernel objects can't be created or a
+// descriptor can't be watched.
+template<typename T = timers>
+class basic_reactor {
+public:
+  using timers_t = T;
+  using time_point_t = timers_ns::time_point_t;
+  using duration_t = timers_ns::duration_t;
+
+  // Invoked with the descriptor and the `EPOLL*` events that are ready.
+  using fd_callback_t = small_function<void(int, uint32_t)>;
+
+  // Invoked on the loop thread by `post`.
+  using task_t = timers_ns::timer_callback_t;
+
+  // Uses io_uring if `preferred` and available, else `epoll`.
+  explicit basic_reactor(size_t max_events = 64,
+      reactor_backend preferred = reactor_backend::io_uring)
+      : wake_fd_{adopt_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))},
+        max_events_{std::max<size_t>(max_events, 1)} {
+    if (!wake_fd_) throw_errno("eventfd");
+    if (preferred == reactor_backend::io_uring &&
+        ring_.open(static_cast<unsigned>(
+            std::min<size_t>(max_events_, max_ring_entries))))
+    {
+      ring_.poll(*wake_fd_, EPOLLIN, wake_data);
+      return;
+    }
+    epoll_fd_ = adopt_fd(::epoll_create1(EPOLL_CLOEXEC));
+    if (!epoll_fd_) throw_errno("epoll_create1");
+    ready_.resize(max_events_);
+    control(EPOLL_CTL_ADD, *wake_fd_, EPOLLIN);
+  }
+
+  basic_reactor(const basic_reactor&) = delete;
+  basic_reactor& operator=(const basic_reactor&) = delete;
+
+  // The kernel interface in use.
+  [[nodiscard]] reactor_backend backend() const noexcept {
+    return ring_ ? reactor_backend::io_uring : reactor_backend::epoll;
+  }
+
+  // The owned timers. Use `set` and `cancel` directly from the loop thread.
+  [[nodiscard]] timers_t& timers() noexcept { return timers_; }
+  [[nodiscard]] const timers_t& timers() const noexcept { return timers_; }
+
+  // Loop thread.
+
+  // Watch `fd` for `events`, such as `EPOLLIN`, invoking `callback` whenever
+  // any are ready. Does not take ownership. Throws if `fd` is already
+  // watched.
+  void watch(int fd, uint32_t events, fd_callback_t callback) {
+    auto [it, inserted] =
+        watches_.try_emplace(fd, watch_entry{std::move(callback), events});
+    if (!inserted) throw std::invalid_argument("reactor::watch: duplicate");
+    try {
+      if (ring_)
+        arm(fd, it->second);
+      else
+        control(EPOLL_CTL_ADD, fd, events);
+    } catch (...) {
+      watches_.erase(it);
+      throw;
+    }
+  }
+  void
+  watch(const unique_fd& fd, uint32_t events, fd_callback_t callback) {
+    watch(*fd, events, std::move(callback));
+  }
+
+  // Change the events that a watched `fd` is waiting for.
+  void modify(int fd, uint32_t events) {
+    auto it = watches_.find(fd);
+    if (it == watches_.end())
+      throw std::out_of_range("reactor::modify: not watched");
+    if (!ring_) {
+      control(EPOLL_CTL_MOD, fd, events);
+      it->second.events = events;
+      return;
+    }
+    ring_.cancel_poll(data_for(fd, it->second), ignored_data);
+    it->second.events = events;
+    arm(fd, it->second);
+  }
+  void modify(const unique_fd& fd, uint32_t events) { modify(*fd, events); }
+
+  // Stop watching `fd`. Returns whether it was watched. This must be called
+  // before closing the descriptor. Safe to call from a callback, even for
+  // the descriptor being dispatched, and any events for it that remain in
+  // the current batch are dropped.
+  bool unwatch(int fd) noexcept {
+    auto it = watches_.find(fd);
+    if (it == watches_.end()) return false;
+    if (ring_) {
+      // Submit the removal now, so that the kernel lets go of the file.
+      try {
+        ring_.cancel_poll(data_for(fd, it->second), ignored_data);
+        ring_.submit();
+      } catch (...) {
+        // The poll outlives the watch, but its completion will be ignored.
+      }
+    } else {
+      ::epoll_ctl(*epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    watches_.erase(it);
+    return true;
+  }
+  bool unwatch(const unique_fd& fd) noexcept { return unwatch(*fd); }
+
+  [[nodiscard]] size_t watched() const noexcept { return watches_.size(); }
+
+  // Wait for and dispatch one batch of ready descriptors, then service the
+  // timers. Waits no longer than `max_wait`, where `duration_t::max()` means
+  // to wait indefinitely when no timers are set. Returns the number of
+  // descriptor and timer callbacks invoked, not counting wakeups.
+  //
+  // A wait interrupted by a signal counts as an empty batch.
+  size_t run_once(duration_t max_wait = duration_t::max()) {
+    size_t callbacks{};
+    if (ring_) {
+      ring_.wait(wait_timeout(max_wait));
+      ring_.reap(max_events_, [&](uint64_t data, int32_t result) {
+        callbacks += complete(data, result);
+      });
+      return callbacks + timers_.tick();
+    }
+
+    const int ready = ::epoll_wait(*epoll_fd_, ready_.data(),
+        static_cast<int>(ready_.size()), wait_timeout(max_wait));
+    if (ready == -1 && errno != EINTR) throw_errno("epoll_wait");
+
+    for (int i = 0; i < ready; ++i) {
+      const auto& e = ready_[i];
+      if (e.data.fd == *wake_fd_)
+        drain_wakeups();
+      else
+        callbacks += dispatch(e.data.fd, e.events);
+    }
+    return callbacks + timers_.tick();
+  }
+
+  // Run until `stop` is called, returning the number of callbacks invoked.
+  size_t run() {
+    size_t callbacks{};
+    while (!stopping_.exchange(false, std::memory_order::acquire))
+      callbacks += run_once();
+    return callbacks;
+  }
+
+  // Any thread.
+
+  // Run `task` on the loop thread, during the next `tick`. The `timer_event`
+  // it's passed is a one-shot.
+  void post(task_t task) {
+    timers_.submit_set(duration_t{}, std::move(task));
+    wake();
+  }
+
+  // Forward to the owned timers, then wake the loop so that it recomputes
+  // its timeout.
+  timer_id_t submit_set(time_point_t start_at, timers_ns::timer_callback_t
+      callback, duration_t repeat_in = {}, time_point_t stop_at = {},
+      duration_t slack = {}) {
+    const auto timer_id = timers_.submit_set(start_at, std::move(callback),
+        repeat_in, stop_at, slack);
+    wake();
+    return timer_id;
+  }
+  timer_id_t submit_set(duration_t start_in, timers_ns::timer_callback_t
+      callback, duration_t repeat_in = {}, duration_t stop_in = {},
+      duration_t slack = {}) {
+    const auto timer_id = timers_.submit_set(start_in, std::move(callback),
+        repeat_in, stop_in, slack);
+    wake();
+    return timer_id;
+  }
+  void submit_cancel(timer_id_t timer_id) {
+    timers_.submit_cancel(timer_id);
+    wake();
+  }
+
+  // Make `run` return after its current iteration.
+  void stop() noexcept {
+    stopping_.store(true, std::memory_order::release);
+    wake();
+  }
+
+  // Interrupt the current or next wait.
+  void wake() noexcept {
+    const uint64_t one = 1;
+    [[maybe_unused]] auto _ = ::write(*wake_fd_, &one, sizeof(one));
+  }
+
+private:
+  struct watch_entry {
+    fd_callback_t callback;
+    uint32_t events{};
+
+    // Distinguishes this watch's io_uring polls from those of an earlier
+    // watch of the same descriptor, whose completions are ignored.
+    uint32_t generation{};
+  };
+
+  // Completion data for the wakeup poll and for removals, neither of which
+  // can collide with `data_for`, since descriptors are non-negative.
+  static constexpr uint64_t wake_data = ~uint64_t{};
+  static constexpr uint64_t ignored_data = ~uint64_t{} - 1;
+
+  // More than the kernel allows, so that it clamps.
+  static constexpr size_t max_ring_entries = 1 << 16;
+
+  timers_t timers_;
+  details::uring ring_;
+  unique_fd epoll_fd_;
+  unique_fd wake_fd_;
+  std::unordered_map<int, watch_entry> watches_;
+  std::vector<epoll_event> ready_;
+  size_t max_events_;
+  uint32_t next_generation_{};
+  std::atomic_bool stopping_{};
+
+  void control(int op, int fd, uint32_t events) {
+    epoll_event e{};
+    e.events = events;
+    e.data.fd = fd;
+    if (::epoll_ctl(*epoll_fd_, op, fd, &e) == -1) throw_errno("epoll_ctl");
+  }
+
+  // Milliseconds until the next timer, rounded up, but no more than
+  // `max_wait`, or -1 to wait indefinitely.
+  [[nodiscard]] int wait_timeout(duration_t max_wait) const {
+    constexpr auto forever = time_point_t::max();
+    const auto next_at = timers_.next_at(forever);
+    if (next_at == forever && max_wait == duration_t::max()) return -1;
+    auto timeout = max_wait;
+    if (next_at != forever) {
+      const auto next_in = std::chrono::ceil<duration_t>(
+          next_at - timers_.get_now());
+      timeout = std::clamp(next_in, duration_t{}, max_wait);
+    }
+    return static_cast<int>(std::min<duration_t::rep>(timeout.count(),
+        std::numeric_limits<int>::max()));
+  }
+
+  [[nodiscard]] static uint64_t
+  data_for(int fd, const watch_entry& entry) noexcept {
+    return uint64_t{entry.generation} << 32 | static_cast<uint32_t>(fd);
+  }
+
+  // Start a new generation of polls for `fd`. A bad descriptor would only
+  // fail once the poll is submitted, so it's checked now, to throw as
+  // `epoll_ctl` would.
+  void arm(int fd, watch_entry& entry) {
+    if (::fcntl(fd, F_GETFD) == -1) throw_errno("reactor::watch");
+    entry.generation = ++next_generation_;
+    ring_.poll(fd, entry.events & ~(EPOLLONESHOT | EPOLLET), data_for(fd,
+        entry));
+  }
+
+  // Handle an io_uring completion, returning the number of callbacks
+  // invoked. Rearms the poll unless the watch is one-shot or the callback
+  // already replaced it.
+  size_t complete(uint64_t data, int32_t result) {
+    if (data == ignored_data) return 0;
+    if (data == wake_data) {
+      drain_wakeups();
+      ring_.poll(*wake_fd_, EPOLLIN, wake_data);
+      return 0;
+    }
+    const auto fd = static_cast<int>(static_cast<uint32_t>(data));
+    auto it = watches_.find(fd);
+    if (it == watches_.end() || data_for(fd, it->second) != data) return 0;
+    if (result < 0) it->second.events |= EPOLLONESHOT;
+    const auto callbacks = dispatch(fd,
+        result < 0 ? uint32_t{EPOLLERR} : static_cast<uint32_t>(result));
+    it = watches_.find(fd);
+    if (it != watches_.end() && data_for(fd, it->second) == data &&
+        !(it->second.events & EPOLLONESHOT))
+      ring_.poll(fd, it->second.events & ~EPOLLET, data);
+    return callbacks;
+  }
+
+  // Invoke the callback for `fd`, if still watched. The callback is moved
+  // out while it runs, so that it can safely unwatch its own descriptor, and
+  // then moved back unless it was replaced.
+  size_t dispatch(int fd, uint32_t events) {
+    auto it = watches_.find(fd);
+    if (it == watches_.end()) return 0;
+    auto callback = std::move(it->second.callback);
+    callback(fd, events);
+    it = watches_.find(fd);
+    if (it != watches_.end() && !it->second.callback)
+      it->second.callback = std::move(callback);
+    return 1;
+  }
+
+  void drain_wakeups() noexcept {
+    uint64_t count;
+    [[maybe_unused]] auto _ = ::read(*wake_fd_, &count, sizeof(count));
+  }
+};
+
+// Reactor whose timers are scheduled by binary heap.
+using reactor = basic_reactor<timers>;
+
+// Reactor whose timers are scheduled by hierarchical timing wheel.
+using wheel_reactor = basic_reactor<wheel_timers>;
+
+}} // namespace corvid::io
@@ -0,0 +1,79 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "../containers/custom_handle.h"
+#include "../containers/own_ptr.h"
+#include "../strings/cstring_view.h"
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace corvid { inline namespace io {
+
+// POSIX file descriptors, owned through `own_ptr`.
+//
+// This is the `fd_deleter` example from `custom_handle.h`, made real. The
+// `unique_fd` holds just the `int`, with -1 for empty, and closes it when
+// destroyed or reset. Dereferencing gives the descriptor.
+//
+// Functions that make one throw `std::system_error` on failure.
+
+// Deleter that closes a file descriptor.
+struct fd_deleter {
+  using pointer = custom_handle<fd_deleter, int, int, -1>;
+
+  void operator()(pointer p) const noexcept {
+    if (p) ::close(*p);
+  }
+};
+
+using unique_fd = own_ptr<int, fd_deleter>;
+
+// Take ownership of `fd`, which may be -1.
+[[nodiscard]] inline unique_fd adopt_fd(int fd) noexcept {
+  return unique_fd{fd_deleter::pointer{fd}};
+}
+
+// Throw a `std::system_error` for `errno`, describing `what`.
+[[noreturn]] inline void throw_errno(const char* what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Open `path`, retrying on `EINTR`. Always adds `O_CLOEXEC`.
+[[nodiscard]] inline unique_fd
+open_fd(cstring_view path, int flags, mode_t mode = 0666) {
+  int fd;
+  do {
+    fd = ::open(path.c_str(), flags | O_CLOEXEC, mode);
+  } while (fd == -1 && errno == EINTR);
+  if (fd == -1) throw_errno("open");
+  return adopt_fd(fd);
+}
+
+// Make a pipe, returning the read end and then the write end. Always adds
+// `O_CLOEXEC` to `flags`, which may also hold `O_NONBLOCK`.
+[[nodiscard]] inline std::pair<unique_fd, unique_fd> make_pipe(int flags = 0) {
+  int fds[2];
+  if (::pipe2(fds, flags | O_CLOEXEC) == -1) throw_errno("pipe2");
+  return {adopt_fd(fds[0]), adopt_fd(fds[1])};
+}
+
+}} // namespace corvid::io
@@ -0,0 +1,128 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "unique_fd.h"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#include <sys/uio.h>
+
+namespace corvid { inline namespace io {
+
+// Scatter/gather I/O over spans, and over the two segments of a
+// `circular_buffer` or `pow2_circular_buffer`.
+//
+// These are thin wrappers over `readv` and `writev`: they retry on `EINTR`
+// and otherwise return what the call did, which is the number of bytes
+// transferred, or -1 with `errno` set, such as to `EAGAIN` for a
+// non-blocking descriptor. Like the calls, they may transfer less than was
+// asked for.
+
+// Element types that can be read and written as raw bytes.
+template<typename T>
+concept ByteLike = sizeof(T) == 1 && std::is_trivially_copyable_v<T>;
+
+// Buffer with the `segments`, `spare_segments`, `commit_back_n`, and
+// `drop_front_n` of the circular buffers.
+template<typename CB>
+concept SegmentedByteBuffer =
+    ByteLike<typename CB::value_type> && requires(CB& cb, size_t n) {
+      cb.segments();
+      cb.spare_segments();
+      cb.commit_back_n(n);
+      cb.drop_front_n(n);
+    };
+
+namespace details {
+template<typename T, size_t N>
+[[nodiscard]] std::array<::iovec, N>
+to_iovecs(const std::array<std::span<T>, N>& segments) noexcept {
+  std::array<::iovec, N> iov;
+  for (size_t i = 0; i < N; ++i)
+    iov[i] = {const_cast<std::remove_const_t<T>*>(segments[i].data()),
+        segments[i].size()};
+  return iov;
+}
+} // namespace details
+
+// Read into `segments`, in order.
+template<ByteLike T, size_t N>
+[[nodiscard]] ssize_t
+read_segments(int fd, const std::array<std::span<T>, N>& segments) noexcept {
+  static_assert(!std::is_const_v<T>);
+  const auto iov = details::to_iovecs(segments);
+  ssize_t n;
+  do {
+    n = ::readv(fd, iov.data(), static_cast<int>(N));
+  } while (n == -1 && errno == EINTR);
+  return n;
+}
+
+// Write from `segments`, in order.
+template<ByteLike T, size_t N>
+[[nodiscard]] ssize_t
+write_segments(int fd, const std::array<std::span<T>, N>& segments) noexcept {
+  const auto iov = details::to_iovecs(segments);
+  ssize_t n;
+  do {
+    n = ::writev(fd, iov.data(), static_cast<int>(N));
+  } while (n == -1 && errno == EINTR);
+  return n;
+}
+
+// Read into the free space at the back of `cb`, with a single `readv`, and
+// add what was read.
+template<SegmentedByteBuffer CB>
+[[nodiscard]] ssize_t read_into(int fd, CB& cb) noexcept {
+  const auto n = read_segments(fd, cb.spare_segments());
+  if (n > 0) cb.commit_back_n(static_cast<typename CB::size_type>(n));
+  return n;
+}
+
+// Write from the front of `cb`, with a single `writev`, and drop what was
+// written.
+template<SegmentedByteBuffer CB>
+[[nodiscard]] ssize_t write_from(int fd, CB& cb) noexcept {
+  const auto n = write_segments(fd, cb.segments());
+  if (n > 0) cb.drop_front_n(static_cast<typename CB::size_type>(n));
+  return n;
+}
+
+// Overloads for `unique_fd`.
+template<ByteLike T, size_t N>
+[[nodiscard]] ssize_t read_segments(const unique_fd& fd,
+    const std::array<std::span<T>, N>& segments) noexcept {
+  return read_segments(*fd, segments);
+}
+template<ByteLike T, size_t N>
+[[nodiscard]] ssize_t write_segments(const unique_fd& fd,
+    const std::array<std::span<T>, N>& segments) noexcept {
+  return write_segments(*fd, segments);
+}
+template<SegmentedByteBuffer CB>
+[[nodiscard]] ssize_t read_into(const unique_fd& fd, CB& cb) noexcept {
+  return read_into(*fd, cb);
+}
+template<SegmentedByteBuffer CB>
+[[nodiscard]] ssize_t write_from(const unique_fd& fd, CB& cb) noexcept {
+  return write_from(*fd, cb);
+}
+
+}} // namespace corvid::io
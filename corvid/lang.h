@@ -16,3 +16,8 @@
 // limitations under the License.
 #pragma once
 #include "lang/ast_pred.h"
+#include "lang/ast_pred_batch.h"
+#include "lang/ast_pred_fields.h"
+#include "lang/ast_pred_image.h"
+#include "lang/ast_pred_index.h"
+#include "lang/ast_pred_program.h"
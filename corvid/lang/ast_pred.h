@@ -15,10 +15,18 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #pragma once
+#include <algorithm>
+#include <compare>
+#include <memory>
+#include <optional>
+#include <regex>
 #include <string_view>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
+#include "../containers/arena_allocator.h"
+#include "../containers/instrumentation.h"
 #include "../containers/transparent.h"
 #include "../enums/sequence_enum.h"
 #include "../strings.h"
@@ -76,7 +84,10 @@ namespace corvid { inline namespace lang { namespace ast_pred {
 // Returns `std::monostate` for missing keys.
 struct lookup {
   virtual ~lookup() = default;
-  virtual const any_value& operator[](const std::string& key) const;
+  virtual const any_value& operator[](const std::string& key) const {
+    (void)key;
+    return missing;
+  }
   static inline const any_value missing;
 };
 
@@ -90,6 +101,233 @@ struct map_lookup: public lookup {
   string_map<any_value> m;
 };
 
+// Leaf semantics, over views of values.
+//
+// These are defined once, here, for the nodes and for evaluators that keep
+// values in some other form, such as `program_image`, so that they agree. A
+// value view has a `shape`, and a `size` for the number of singles, which
+// `operator[]` returns as `single_view`.
+namespace leaf_rules {
+
+// View of a single value, which is null, text, or a number.
+struct single_view {
+  enum class kind : uint8_t { null, text, number };
+
+  kind type{};
+  int64_t number{};
+  std::string_view text;
+
+  constexpr single_view() noexcept = default;
+  constexpr single_view(const any_single_value& value) noexcept {
+    if (const auto s = std::get_if<std::string>(&value)) {
+      type = kind::text;
+      text = *s;
+    } else if (const auto n = std::get_if<int64_t>(&value)) {
+      type = kind::number;
+      number = *n;
+    }
+  }
+
+  [[nodiscard]] static constexpr single_view
+  of_text(std::string_view text) noexcept {
+    single_view v;
+    v.type = kind::text;
+    v.text = text;
+    return v;
+  }
+  [[nodiscard]] static constexpr single_view of_number(int64_t n) noexcept {
+    single_view v;
+    v.type = kind::number;
+    v.number = n;
+    return v;
+  }
+
+  friend constexpr bool
+  operator==(const single_view& l, const single_view& r) noexcept {
+    if (l.type != r.type) return false;
+    if (l.type == kind::number) return l.number == r.number;
+    return l.text == r.text;
+  }
+};
+
+// Whether a value is missing, a single, which may be null, or repeated.
+enum class value_shape : uint8_t { missing, single, repeated };
+
+template<typename V>
+concept value_view = requires(const V& v, size_t i) {
+  { v.shape() } -> std::same_as<value_shape>;
+  { v.size() } -> std::convertible_to<size_t>;
+  { v[i] } -> std::convertible_to<single_view>;
+};
+
+// View of an `any_value`.
+class any_value_view {
+public:
+  constexpr any_value_view(const any_value& value) noexcept {
+    if (const auto repeated =
+            std::get_if<std::vector<any_single_value>>(&value))
+    {
+      shape_ = value_shape::repeated;
+      singles_ = repeated->data();
+      size_ = repeated->size();
+    } else if (const auto single = std::get_if<any_single_value>(&value)) {
+      shape_ = value_shape::single;
+      singles_ = single;
+      size_ = 1;
+    }
+  }
+
+  [[nodiscard]] constexpr value_shape shape() const noexcept {
+    return shape_;
+  }
+  [[nodiscard]] constexpr size_t size() const noexcept { return size_; }
+  [[nodiscard]] constexpr single_view operator[](size_t i) const noexcept {
+    return singles_[i];
+  }
+
+private:
+  const any_single_value* singles_{};
+  size_t size_{};
+  value_shape shape_{};
+};
+
+// Whether `v` is present, meaning not null.
+template<value_view V>
+[[nodiscard]] constexpr bool is_present(const V& v) {
+  if (v.shape() == value_shape::single)
+    return v[0].type != single_view::kind::null;
+  return v.shape() == value_shape::repeated;
+}
+
+// Whether `l` equals `r`. A null single value is the same as a missing
+// one, and a repeated value equals a single value if any of its elements
+// does, so that `eq` can test for membership.
+template<value_view L, value_view R>
+[[nodiscard]] constexpr bool equal(const L& l, const R& r) {
+  const bool l_present = is_present(l);
+  const bool r_present = is_present(r);
+  if (!l_present || !r_present) return l_present == r_present;
+  if (l.shape() == value_shape::repeated) {
+    if (r.shape() == value_shape::repeated) {
+      if (l.size() != r.size()) return false;
+      for (size_t i = 0; i < l.size(); ++i)
+        if (!(single_view{l[i]} == single_view{r[i]})) return false;
+      return true;
+    }
+    const single_view single = r[0];
+    for (size_t i = 0; i < l.size(); ++i)
+      if (single_view{l[i]} == single) return true;
+    return false;
+  }
+  if (r.shape() == value_shape::repeated) return equal(r, l);
+  return single_view{l[0]} == single_view{r[0]};
+}
+
+// Whether `f` is true for `v` or, if it's repeated, for any of its
+// elements. False if missing.
+template<value_view V, typename F>
+[[nodiscard]] constexpr bool any_single(const V& v, F&& f) {
+  for (size_t i = 0; i < v.size(); ++i)
+    if (f(single_view{v[i]})) return true;
+  return false;
+}
+
+// Compare `l` to `r`, if they're both present and of the same type.
+[[nodiscard]] constexpr std::optional<std::strong_ordering>
+compare(const single_view& l, const single_view& r) noexcept {
+  if (l.type != r.type || l.type == single_view::kind::null)
+    return std::nullopt;
+  if (l.type == single_view::kind::number) return l.number <=> r.number;
+  return l.text.compare(r.text) <=> 0;
+}
+
+// Whether `order` satisfies the ordering `op`, which is `lt`, `le`, `gt`,
+// or `ge`.
+[[nodiscard]] constexpr bool
+ordered(operation op, std::strong_ordering order) noexcept {
+  switch (op) {
+  case operation::lt: return order < 0;
+  case operation::le: return order <= 0;
+  case operation::gt: return order > 0;
+  default: return order >= 0;
+  }
+}
+
+// Whether `l` and `r` are ordered as `op` requires.
+[[nodiscard]] constexpr bool
+ordered(operation op, const single_view& l, const single_view& r) noexcept {
+  const auto order = compare(l, r);
+  return order && ordered(op, *order);
+}
+
+// Whether `l op r` holds for some elements of `l` and `r`.
+template<value_view L, value_view R>
+[[nodiscard]] constexpr bool ordered(operation op, const L& l, const R& r) {
+  return any_single(l, [&](const single_view& ls) {
+    return any_single(r,
+        [&](const single_view& rs) { return ordered(op, ls, rs); });
+  });
+}
+
+// Whether `s` contains, starts with, or ends with `needle`, as `op` is
+// `contains`, `starts_with`, or `ends_with`.
+[[nodiscard]] constexpr bool
+found(operation op, std::string_view s, std::string_view needle) noexcept {
+  if (op == operation::contains) return s.find(needle) != s.npos;
+  if (op == operation::starts_with) return s.starts_with(needle);
+  return s.ends_with(needle);
+}
+
+// Whether `f` is true for some text element of `v`.
+template<value_view V, typename F>
+[[nodiscard]] constexpr bool any_text(const V& v, F&& f) {
+  return any_single(v, [&](const single_view& s) {
+    return s.type == single_view::kind::text && f(s.text);
+  });
+}
+
+// Whether some text element of `l` is `found` for some text element of `r`.
+template<value_view L, value_view R>
+[[nodiscard]] constexpr bool found(operation op, const L& l, const R& r) {
+  return any_text(l, [&](std::string_view s) {
+    return any_text(r,
+        [&](std::string_view needle) { return found(op, s, needle); });
+  });
+}
+
+// The regular expression of a `matches` whose pattern is `v`, which is only
+// text when it's a single.
+template<value_view V>
+[[nodiscard]] constexpr std::optional<std::string_view>
+pattern_of(const V& v) {
+  if (v.shape() != value_shape::single) return std::nullopt;
+  const single_view pattern = v[0];
+  if (pattern.type != single_view::kind::text) return std::nullopt;
+  return pattern.text;
+}
+
+// Whether `re` finds a match in some text element of `v`.
+template<value_view V>
+[[nodiscard]] bool search(const V& v, const std::regex& re) {
+  return any_text(v, [&](std::string_view s) {
+    return std::regex_search(s.begin(), s.end(), re);
+  });
+}
+
+// Whether the pattern in `r` finds a match in some text element of `l`.
+// Compiled each time, so an invalid one just doesn't match.
+template<value_view L, value_view R>
+[[nodiscard]] bool search(const L& l, const R& r) {
+  const auto pattern = pattern_of(r);
+  if (!pattern) return false;
+  try {
+    return search(l, std::regex{std::string{*pattern}});
+  } catch (const std::regex_error&) {
+    return false;
+  }
+}
+} // namespace leaf_rules
+
 // Forward declaration of node.
 struct node;
 
@@ -138,6 +376,52 @@ public:
   template<operation op, typename... Args>
   [[nodiscard]] static std::shared_ptr<node> make(Args&&... args);
 
+protected:
+  // Construct a `T` in the current `node_arena`, if any, or else on the heap.
+  template<node_type T, typename... Args>
+  [[nodiscard]] static node_ptr construct(Args&&... args);
+
+public:
+  // Evaluation helpers.
+
+  // Resolve `kv` to its value, looking up keys in `lk`. A null resolves as a
+  // missing value.
+  static const any_value& resolve(const key_or_value& kv, const lookup& lk) {
+    if (std::holds_alternative<std::string>(kv))
+      return lk[std::get<std::string>(kv)];
+    if (std::holds_alternative<any_value>(kv)) return std::get<any_value>(kv);
+    return lookup::missing;
+  }
+
+  // Whether `value` is present, as `leaf_rules::is_present`.
+  static bool is_present(const any_value& value) {
+    return leaf_rules::is_present(leaf_rules::any_value_view{value});
+  }
+
+  // Whether `l` equals `r`, as `leaf_rules::equal`.
+  static bool equal(const any_value& l, const any_value& r) {
+    return leaf_rules::equal(leaf_rules::any_value_view{l},
+        leaf_rules::any_value_view{r});
+  }
+
+  // Whether `f` is true for `value` or, if it's repeated, for any of its
+  // elements. False if missing.
+  template<typename F>
+  static bool any_single(const any_value& value, F&& f) {
+    if (const auto single = std::get_if<any_single_value>(&value))
+      return f(*single);
+    if (const auto repeated =
+            std::get_if<std::vector<any_single_value>>(&value))
+      return std::ranges::any_of(*repeated, f);
+    return false;
+  }
+
+  // Compare `l` to `r`, if they're both present and of the same type.
+  static std::optional<std::strong_ordering>
+  compare(const any_single_value& l, const any_single_value& r) {
+    return leaf_rules::compare(l, r);
+  }
+
   static bool dump(std::string& out, const any_single_value& value) {
     if (std::holds_alternative<std::string>(value))
       strings::append(out, '"', std::get<std::string>(value), '"');
@@ -223,6 +507,12 @@ struct and_node final: public junction {
   template<node_ptr_type... Args>
   explicit and_node(allow, Args&&... args)
       : and_node{allow::ctor, node_list{std::forward<Args>(args)...}} {}
+
+  bool eval(const lookup& lk) const override {
+    for (const auto& n : nodes)
+      if (!n->eval(lk)) return false;
+    return true;
+  }
 };
 
 struct or_node final: public junction {
@@ -232,6 +522,12 @@ struct or_node final: public junction {
   template<node_ptr_type... Args>
   explicit or_node(allow, Args&&... args)
       : or_node{allow::ctor, node_list{std::forward<Args>(args)...}} {}
+
+  bool eval(const lookup& lk) const override {
+    for (const auto& n : nodes)
+      if (n->eval(lk)) return true;
+    return false;
+  }
 };
 
 struct not_node final: public junction {
@@ -241,6 +537,8 @@ struct not_node final: public junction {
   template<node_ptr_type... Args>
   explicit not_node(allow, Args&&... args)
       : not_node{allow::ctor, node_list{std::forward<Args>(args)...}} {}
+
+  bool eval(const lookup& lk) const override { return !nodes[0]->eval(lk); }
 };
 
 struct true_node final: public node {
@@ -254,8 +552,21 @@ struct false_node final: public node {
 };
 
 struct unary_leaf: public node {
-  unary_leaf(allow, operation op, key_or_value&& value)
-      : node{allow::ctor, op}, value{std::move(value)} {}
+  // Like `binary_leaf`, initializes the operand in place.
+  template<typename V>
+  requires std::constructible_from<key_or_value, V>
+  unary_leaf(allow, operation op, V&& value)
+      : node{allow::ctor, op}, value(std::forward<V>(value)) {}
+
+  bool eval(const lookup& lk) const override {
+    return test(resolve(value, lk));
+  }
+
+  // Test the resolved operand.
+  virtual bool test(const any_value& v) const {
+    (void)v;
+    return false;
+  }
 
   bool append(std::string& out) const override {
     node::append(out);
@@ -269,8 +580,25 @@ struct unary_leaf: public node {
 };
 
 struct binary_leaf: public node {
-  binary_leaf(allow, operation op, key_or_value&& lhs, key_or_value&& rhs)
-      : node{allow::ctor, op}, lhs{std::move(lhs)}, rhs{std::move(rhs)} {}
+  // Initializes operands in place, rather than moving them from temporaries,
+  // which GCC warns about.
+  template<typename L, typename R>
+  requires std::constructible_from<key_or_value, L> &&
+           std::constructible_from<key_or_value, R>
+  binary_leaf(allow, operation op, L&& lhs, R&& rhs)
+      : node{allow::ctor, op}, lhs(std::forward<L>(lhs)),
+        rhs(std::forward<R>(rhs)) {}
+
+  bool eval(const lookup& lk) const override {
+    return test(resolve(lhs, lk), resolve(rhs, lk));
+  }
+
+  // Test the resolved operands.
+  virtual bool test(const any_value& l, const any_value& r) const {
+    (void)l;
+    (void)r;
+    return false;
+  }
 
   bool append(std::string& out) const override {
     node::append(out);
@@ -287,51 +615,312 @@ struct binary_leaf: public node {
 };
 
 struct eq_node final: public binary_leaf {
-  eq_node(allow, key_or_value&& lhs, key_or_value&& rhs)
-      : binary_leaf{allow::ctor, operation::eq, std::move(lhs),
-            std::move(rhs)} {}
+  template<typename L, typename R>
+  requires std::constructible_from<key_or_value, L> &&
+           std::constructible_from<key_or_value, R>
+  eq_node(allow, L&& lhs, R&& rhs)
+      : binary_leaf{allow::ctor, operation::eq, std::forward<L>(lhs),
+            std::forward<R>(rhs)} {}
+
+  bool test(const any_value& l, const any_value& r) const override {
+    return equal(l, r);
+  }
 };
 
 struct ne_node final: public binary_leaf {
-  ne_node(allow, key_or_value&& lhs, key_or_value&& rhs)
-      : binary_leaf{allow::ctor, operation::ne, std::move(lhs),
-            std::move(rhs)} {}
+  template<typename L, typename R>
+  requires std::constructible_from<key_or_value, L> &&
+           std::constructible_from<key_or_value, R>
+  ne_node(allow, L&& lhs, R&& rhs)
+      : binary_leaf{allow::ctor, operation::ne, std::forward<L>(lhs),
+            std::forward<R>(rhs)} {}
+
+  bool test(const any_value& l, const any_value& r) const override {
+    return !equal(l, r);
+  }
 };
 
 struct exists_node final: public unary_leaf {
-  exists_node(allow, key_or_value&& value)
-      : unary_leaf{allow::ctor, operation::exists, std::move(value)} {}
+  template<typename V>
+  requires std::constructible_from<key_or_value, V>
+  exists_node(allow, V&& value)
+      : unary_leaf{allow::ctor, operation::exists, std::forward<V>(value)} {}
+
+  bool test(const any_value& v) const override { return is_present(v); }
 };
 
 struct absent_node final: public unary_leaf {
-  absent_node(allow, key_or_value&& value)
-      : unary_leaf{allow::ctor, operation::absent, std::move(value)} {}
+  template<typename V>
+  requires std::constructible_from<key_or_value, V>
+  absent_node(allow, V&& value)
+      : unary_leaf{allow::ctor, operation::absent, std::forward<V>(value)} {}
+
+  bool test(const any_value& v) const override { return !is_present(v); }
+};
+
+// Ordering comparison: `lt`, `le`, `gt`, or `ge`.
+//
+// True if both operands are present and of the same type, and compare as
+// `op` requires. A repeated operand compares if any of its elements does.
+template<operation which>
+struct ordering_node final: public binary_leaf {
+  template<typename L, typename R>
+  requires std::constructible_from<key_or_value, L> &&
+           std::constructible_from<key_or_value, R>
+  ordering_node(allow, L&& lhs, R&& rhs)
+      : binary_leaf{allow::ctor, which, std::forward<L>(lhs),
+            std::forward<R>(rhs)} {}
+
+  bool test(const any_value& l, const any_value& r) const override {
+    return leaf_rules::ordered(which, leaf_rules::any_value_view{l},
+        leaf_rules::any_value_view{r});
+  }
+
+  // Whether `l` and `r` are ordered as `which` requires.
+  static bool ordered(const any_single_value& l, const any_single_value& r) {
+    return leaf_rules::ordered(which, l, r);
+  }
+  static bool ordered(std::strong_ordering order) noexcept {
+    return leaf_rules::ordered(which, order);
+  }
 };
 
+using lt_node = ordering_node<operation::lt>;
+using le_node = ordering_node<operation::le>;
+using gt_node = ordering_node<operation::gt>;
+using ge_node = ordering_node<operation::ge>;
+
+// Flip an ordering, so that `l op r` is `r flipped(op) l`. Other operations
+// are returned unchanged.
+[[nodiscard]] constexpr operation flipped(operation op) noexcept {
+  switch (op) {
+  case operation::lt: return operation::gt;
+  case operation::le: return operation::ge;
+  case operation::gt: return operation::lt;
+  case operation::ge: return operation::le;
+  default: return op;
+  }
+}
+
+// Text search: `contains`, `starts_with`, or `ends_with`.
+//
+// True if `lhs` is a string that contains, starts with, or ends with `rhs`. A
+// repeated `lhs` matches if any of its elements does, and a repeated `rhs`
+// if any of its elements is found.
+//
+// When `rhs` is a literal, its strings are prepared on construction, so
+// evaluation never allocates. For `contains`, they go into a
+// `multi_locator`, which searches for all of them in one pass. It's large, so
+// it's on the heap, and only `contains` nodes with literal strings have one.
+template<operation which>
+struct text_node final: public binary_leaf {
+  template<typename L, typename R>
+  requires std::constructible_from<key_or_value, L> &&
+           std::constructible_from<key_or_value, R>
+  text_node(allow, L&& lhs, R&& rhs)
+      : binary_leaf{allow::ctor, which, std::forward<L>(lhs),
+            std::forward<R>(rhs)} {
+    const auto literal = std::get_if<any_value>(&this->rhs);
+    if (!literal) return;
+    any_single(*literal, [&](const any_single_value& v) {
+      if (const auto s = std::get_if<std::string>(&v)) needles_.push_back(*s);
+      return false;
+    });
+    if constexpr (which == operation::contains)
+      if (!needles_.empty())
+        locator_ = std::make_unique<const strings::multi_locator>(needles_);
+    compiled_ = true;
+  }
+
+  bool test(const any_value& l, const any_value& r) const override {
+    const leaf_rules::any_value_view lv{l};
+    if (compiled_)
+      return leaf_rules::any_text(lv,
+          [&](std::string_view s) { return test_text(s); });
+    return leaf_rules::found(which, lv, leaf_rules::any_value_view{r});
+  }
+
+  // Whether `rhs` is a literal, prepared on construction.
+  [[nodiscard]] bool compiled() const noexcept { return compiled_; }
+
+  // Test `s` against the prepared literal. Requires `compiled`.
+  [[nodiscard]] bool test_text(std::string_view s) const noexcept {
+    if constexpr (which == operation::contains)
+      return locator_ && locator_->locate(s).pos != std::string_view::npos;
+    else
+      return std::ranges::any_of(needles_, [&](const std::string& needle) {
+        return leaf_rules::found(which, s, needle);
+      });
+  }
+
+private:
+  std::vector<std::string> needles_;
+  [[no_unique_address]] std::conditional_t<which == operation::contains,
+      std::unique_ptr<const strings::multi_locator>, std::monostate>
+      locator_;
+  bool compiled_{};
+};
+
+using contains_node = text_node<operation::contains>;
+using starts_with_node = text_node<operation::starts_with>;
+using ends_with_node = text_node<operation::ends_with>;
+
+// Regular expression search: `matches`.
+//
+// True if `lhs` is a string in which the ECMAScript regular expression `rhs`
+// finds a match. A repeated `lhs` matches if any of its elements does.
+//
+// When `rhs` is a literal string, the expression is compiled once, on
+// construction, which throws `std::regex_error` if it's invalid. Otherwise,
+// it's compiled on each evaluation, and an invalid one doesn't match.
+struct matches_node final: public binary_leaf {
+  template<typename L, typename R>
+  requires std::constructible_from<key_or_value, L> &&
+           std::constructible_from<key_or_value, R>
+  matches_node(allow, L&& lhs, R&& rhs)
+      : binary_leaf{allow::ctor, operation::matches, std::forward<L>(lhs),
+            std::forward<R>(rhs)} {
+    const auto literal = std::get_if<any_value>(&this->rhs);
+    if (!literal) return;
+    // A literal that isn't a string never matches.
+    if (const auto pattern =
+            leaf_rules::pattern_of(leaf_rules::any_value_view{*literal}))
+      regex_.emplace(std::string{*pattern}, std::regex::optimize);
+    else
+      regex_.emplace();
+  }
+
+  bool test(const any_value& l, const any_value& r) const override {
+    const leaf_rules::any_value_view lv{l};
+    if (regex_) return leaf_rules::search(lv, *regex_);
+    return leaf_rules::search(lv, leaf_rules::any_value_view{r});
+  }
+
+  // Whether `rhs` is a literal, compiled on construction.
+  [[nodiscard]] bool compiled() const noexcept { return regex_.has_value(); }
+
+  // Test `s` against the compiled expression. Requires `compiled`.
+  [[nodiscard]] bool test_text(std::string_view s) const {
+    return std::regex_search(s.begin(), s.end(), *regex_);
+  }
+
+private:
+  std::optional<std::regex> regex_;
+};
+
+// Arena for AST predicate nodes.
+//
+// While a `node_arena::scope` is active, `make` constructs nodes in the
+// arena instead of with `std::make_shared`. The `node_ptr` it returns doesn't
+// own the node, so copying it touches no reference count, and there's no
+// control block to allocate. Instead, the nodes are destroyed together, along
+// with the arena, which must outlive every pointer to them, including those
+// held by heap-allocated nodes. Pointers from arena nodes to heap nodes keep
+// the latter alive as usual, until the arena is destroyed.
+//
+// Only the nodes themselves are in the arena. Their child lists and operands
+// use the heap.
+//
+// Usage:
+//   node_arena arena;
+//   node_arena::scope s{arena};
+//   auto root = dnf::convert(parse(text));
+class node_arena {
+public:
+  explicit node_arena(size_t block_size = 64 * 1024) : arena_{block_size} {}
+  node_arena(const node_arena&) = delete;
+  node_arena& operator=(const node_arena&) = delete;
+
+  ~node_arena() {
+    for (auto it = nodes_.rbegin(); it != nodes_.rend(); ++it) (*it)->~node();
+  }
+
+  // Installs `arena` for `make` on this thread, restoring the previous one,
+  // if any, on destruction.
+  class scope {
+  public:
+    explicit scope(node_arena& arena) noexcept : old_arena_{tls_arena_} {
+      tls_arena_ = &arena;
+    }
+    ~scope() noexcept { tls_arena_ = old_arena_; }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+  private:
+    node_arena* old_arena_;
+  };
+
+  // Arena in scope on this thread, or null.
+  [[nodiscard]] static node_arena* current() noexcept { return tls_arena_; }
+
+  // Number of nodes in the arena.
+  [[nodiscard]] size_t size() const noexcept { return nodes_.size(); }
+
+  // Construct a `T` in the arena, returning a pointer that doesn't own it.
+  template<node_type T, typename... Args>
+  [[nodiscard]] node_ptr emplace(Args&&... args) {
+    // Reserve up front, growing geometrically, so that the `push_back` below
+    // can't throw and leak the node.
+    if (nodes_.size() == nodes_.capacity())
+      nodes_.reserve(std::max<size_t>(16, nodes_.size() * 2));
+    T* p;
+    {
+      arena::extensible_arena::scope s{arena_};
+      p = arena::arena_new<T>(std::forward<Args>(args)...);
+    }
+    nodes_.push_back(p);
+    return node_ptr{node_ptr{}, p};
+  }
+
+  // Whether `n` is in this arena.
+  [[nodiscard]] bool owns(const node_ptr& n) const noexcept {
+    return arena_.owns(n.get());
+  }
+
+private:
+  thread_local static inline node_arena* tls_arena_;
+
+  arena::extensible_arena arena_;
+  std::vector<node*> nodes_;
+};
+
+template<node_type T, typename... Args>
+node_ptr node::construct(Args&&... args) {
+  if (const auto arena = node_arena::current())
+    return arena->emplace<T>(allow::ctor, std::forward<Args>(args)...);
+  return std::make_shared<T>(allow::ctor, std::forward<Args>(args)...);
+}
+
 template<operation op, typename... Args>
 std::shared_ptr<node> node::make(Args&&... args) {
   if constexpr (op == operation::and_junction)
-    return std::make_shared<and_node>(allow::ctor,
-        std::forward<Args>(args)...);
+    return construct<and_node>(std::forward<Args>(args)...);
   else if constexpr (op == operation::or_junction)
-    return std::make_shared<or_node>(allow::ctor, std::forward<Args>(args)...);
+    return construct<or_node>(std::forward<Args>(args)...);
   else if constexpr (op == operation::not_junction)
-    return std::make_shared<not_node>(allow::ctor,
-        std::forward<Args>(args)...);
+    return construct<not_node>(std::forward<Args>(args)...);
   else if constexpr (op == operation::always_false)
-    return std::make_shared<false_node>(allow::ctor);
+    return construct<false_node>();
   else if constexpr (op == operation::always_true)
-    return std::make_shared<true_node>(allow::ctor);
+    return construct<true_node>();
   else if constexpr (op == operation::eq)
-    return std::make_shared<eq_node>(allow::ctor, std::forward<Args>(args)...);
+    return construct<eq_node>(std::forward<Args>(args)...);
   else if constexpr (op == operation::ne)
-    return std::make_shared<ne_node>(allow::ctor, std::forward<Args>(args)...);
+    return construct<ne_node>(std::forward<Args>(args)...);
   else if constexpr (op == operation::exists)
-    return std::make_shared<exists_node>(allow::ctor,
-        std::forward<Args>(args)...);
+    return construct<exists_node>(std::forward<Args>(args)...);
   else if constexpr (op == operation::absent)
-    return std::make_shared<absent_node>(allow::ctor,
-        std::forward<Args>(args)...);
+    return construct<absent_node>(std::forward<Args>(args)...);
+  else if constexpr (op == operation::lt || op == operation::le ||
+                     op == operation::gt || op == operation::ge)
+    return construct<ordering_node<op>>(std::forward<Args>(args)...);
+  else if constexpr (op == operation::contains ||
+                     op == operation::starts_with ||
+                     op == operation::ends_with)
+    return construct<text_node<op>>(std::forward<Args>(args)...);
+  else if constexpr (op == operation::matches)
+    return construct<matches_node>(std::forward<Args>(args)...);
 }
 
 // Non-member wrapper; still type-safe because it takes `operation`.
@@ -342,14 +931,152 @@ template<operation op, typename... Args>
 
 // Disjunctive Normal Form (DNF) conversion.
 //
-// Performs some optimizations and simplifications.
+// Performs some optimizations and simplifications. Structurally identical
+// nodes are hash-consed, so each distinct subexpression is built once and
+// shared, and nodes can be compared by address. Terms drop repeated
+// literals, and a term that repeats another or is absorbed by it, as in
+// `A OR (A AND B)`, is dropped.
+//
+// Distributing OR over AND can grow exponentially, so it's limited to
+// `max_terms`. An AND that would distribute into more terms than that is
+// left as an AND of its converted children, so the result is equivalent but
+// not entirely in DNF. Use `is_dnf` to check.
 class dnf {
 public:
-  static node_ptr convert(const node_ptr& root) { return handle(root); }
+  static constexpr size_t default_max_terms = 4096;
+
+  static node_ptr
+  convert(const node_ptr& root, size_t max_terms = default_max_terms) {
+#if CORVID_INSTRUMENTATION
+    scoped_timer timed{library_probes().dnf_convert};
+#endif
+    return dnf{max_terms}.handle(root);
+  }
+
+  // Whether `root` is an OR of terms, or a single term, where each term is
+  // an AND of literals, or a single literal. A literal is a leaf or the NOT
+  // of one.
+  static bool is_dnf(const node_ptr& root) {
+    if (root->op != operation::or_junction) return is_term(*root);
+    return std::ranges::all_of(junction::list(root),
+        [](const auto& n) { return is_term(*n); });
+  }
 
 private:
+  using term_list = std::vector<node_list>;
+
+  explicit dnf(size_t max_terms) : max_terms_{max_terms} {}
+
+  size_t max_terms_;
+  std::unordered_multimap<size_t, node_ptr> nodes_;
+
+  static bool is_junction(operation op) {
+    return op == operation::and_junction || op == operation::or_junction ||
+           op == operation::not_junction;
+  }
+
+  static bool is_literal(const node& n) {
+    if (n.op == operation::not_junction)
+      return !is_junction(static_cast<const junction&>(n).nodes[0]->op);
+    return !is_junction(n.op);
+  }
+
+  static bool is_term(const node& n) {
+    if (n.op != operation::and_junction) return is_literal(n);
+    return std::ranges::all_of(static_cast<const junction&>(n).nodes,
+        [](const auto& c) { return is_literal(*c); });
+  }
+
+  // Structural hash. Children are hash-consed first, so junctions hash
+  // their addresses.
+  static size_t hash_of(const node& n) {
+    size_t h = std::hash<int>{}(static_cast<int>(n.op));
+    if (is_junction(n.op)) {
+      for (const auto& c : static_cast<const junction&>(n).nodes)
+        h = h * 31 + std::hash<const node*>{}(c.get());
+      return h;
+    }
+    return h ^ std::hash<std::string>{}(n.print());
+  }
+
+  // Structural equality, given hash-consed children.
+  static bool same(const node& l, const node& r) {
+    if (l.op != r.op) return false;
+    if (is_junction(l.op))
+      return static_cast<const junction&>(l).nodes ==
+             static_cast<const junction&>(r).nodes;
+    if (const auto lu = dynamic_cast<const unary_leaf*>(&l))
+      return lu->value == static_cast<const unary_leaf&>(r).value;
+    if (const auto lb = dynamic_cast<const binary_leaf*>(&l)) {
+      const auto& rb = static_cast<const binary_leaf&>(r);
+      return lb->lhs == rb.lhs && lb->rhs == rb.rhs;
+    }
+    return l.op == operation::always_false ||
+           l.op == operation::always_true || &l == &r;
+  }
+
+  // Return the shared node structurally identical to `n`, adding `n` if
+  // there isn't one.
+  node_ptr cons(node_ptr n) {
+    const auto h = hash_of(*n);
+    for (auto [it, end] = nodes_.equal_range(h); it != end; ++it)
+      if (same(*it->second, *n)) return it->second;
+    nodes_.emplace(h, n);
+    return n;
+  }
+
+  // Literals of a term.
+  static node_list literals(const node_ptr& term) {
+    if (term->op == operation::and_junction) return junction::list(term);
+    return {term};
+  }
+
+  // Remove repeated literals from each term, then remove each term that
+  // repeats an earlier one or is a superset of another, keeping the order.
+  static void absorb(term_list& terms) {
+    std::vector<std::vector<const node*>> keys;
+    keys.reserve(terms.size());
+    for (auto& term : terms) {
+      node_list unique;
+      for (auto& n : term)
+        if (std::ranges::find(unique, n) == unique.end())
+          unique.push_back(std::move(n));
+      term = std::move(unique);
+      auto& key = keys.emplace_back();
+      for (const auto& n : term) key.push_back(n.get());
+      std::ranges::sort(key);
+    }
+    const auto absorbed = [&](size_t i) {
+      for (size_t j = 0; j < terms.size(); ++j) {
+        if (j == i || keys[j].size() > keys[i].size()) continue;
+        if (keys[j].size() == keys[i].size() && j > i) continue;
+        if (std::ranges::includes(keys[i], keys[j])) return true;
+      }
+      return false;
+    };
+    term_list kept;
+    for (size_t i = 0; i < terms.size(); ++i)
+      if (!absorbed(i)) kept.push_back(std::move(terms[i]));
+    terms = std::move(kept);
+  }
+
+  node_ptr make_term(node_list&& literals) {
+    if (literals.empty()) return make<operation::always_true>();
+    if (literals.size() == 1) return std::move(literals.front());
+    return cons(make<operation::and_junction>(std::move(literals)));
+  }
+
+  node_ptr make_disjunction(term_list&& terms) {
+    absorb(terms);
+    if (terms.empty()) return make<operation::always_false>();
+    node_list nodes;
+    for (auto& term : terms) nodes.push_back(make_term(std::move(term)));
+    if (nodes.size() == 1) return std::move(nodes.front());
+    return cons(make<operation::or_junction>(std::move(nodes)));
+  }
+
   // Recursively rebuild subtree from this root down.
-  static node_ptr handle(const node_ptr& root) {
+  node_ptr handle(const node_ptr& root) {
     switch (root->op) {
     case operation::and_junction:
       return handle_conjunction(junction::list(root));
@@ -357,11 +1084,11 @@ private:
       return handle_disjunction(junction::list(root));
     case operation::not_junction:
       return handle_negation(junction::list(root)[0]);
-    default: return root;
+    default: return cons(root);
     }
   }
 
-  static node_ptr handle_negation(const node_ptr& root) {
+  node_ptr handle_negation(const node_ptr& root) {
     switch (root->op) {
     case operation::always_false: return make<operation::always_true>();
     case operation::always_true: return make<operation::always_false>();
@@ -372,78 +1099,48 @@ private:
     case operation::and_junction: {
       node_list new_nodes;
       for (const auto& n : junction::list(root))
-        new_nodes.push_back(handle_negation(n));
-      return make<operation::or_junction>(std::move(new_nodes));
+        new_nodes.push_back(make<operation::not_junction>(node_ptr{n}));
+      return handle_disjunction(new_nodes);
     }
       // De Morgan's Law: NOT(A OR B) = NOT(A) AND NOT(B)
     case operation::or_junction: {
       node_list new_nodes;
-      for (const auto& n : junction::list(root)) {
-        new_nodes.push_back(handle_negation(n));
-      }
-      return make<operation::and_junction>(std::move(new_nodes));
+      for (const auto& n : junction::list(root))
+        new_nodes.push_back(make<operation::not_junction>(node_ptr{n}));
+      return handle_conjunction(new_nodes);
     }
       // NOT(A = B) = A != B
     case operation::eq: {
       auto r = static_cast<const eq_node*>(root.get());
-      return make<operation::ne>(key_or_value{r->lhs}, key_or_value{r->rhs});
+      return cons(make<operation::ne>(r->lhs, r->rhs));
     }
       // NOT(A != B) = A = B
     case operation::ne: {
       auto r = static_cast<const ne_node*>(root.get());
-      return make<operation::eq>(key_or_value{r->lhs}, key_or_value{r->rhs});
+      return cons(make<operation::eq>(r->lhs, r->rhs));
     }
     // NOT(EXISTS A) = ABSENT A
     case operation::exists: {
       auto r = static_cast<const exists_node*>(root.get());
-      return make<operation::absent>(key_or_value{r->value});
+      return cons(make<operation::absent>(key_or_value{r->value}));
     }
     // NOT(ABSENT A) = EXISTS A
     case operation::absent: {
       auto r = static_cast<const absent_node*>(root.get());
-      return make<operation::exists>(key_or_value{r->value});
+      return cons(make<operation::exists>(key_or_value{r->value}));
     }
     default: {
-      return make<operation::not_junction>(handle(root));
+      return cons(make<operation::not_junction>(handle(root)));
     }
     };
   }
 
-  // Accumulate distributions.
-  //
-  // On input, `distribution` is a list of AND nodes (that will ultimately be
-  // ORed together). Distributes `source_nodes` against these, returning a new
-  // list of AND nodes, multiplied by the size of `source`.
-  static node_list distribute_or_values(const node_list& distribution,
-      const node_list& source_nodes) {
-    node_list accumulated;
-
-    // Distribute each `or_child` across the `distribution`.
-    for (const auto& or_child : source_nodes) {
-      for (const auto& dist_child : distribution) {
-        node_list new_nodes;
-        for (const auto& node : junction::list(dist_child)) {
-          // Flatten nested ANDs.
-          if (node->op == operation::and_junction) {
-            for (const auto& inner_and_node : junction::list(node))
-              new_nodes.push_back(inner_and_node);
-          } else
-            new_nodes.push_back(node);
-        }
-        new_nodes.push_back(or_child);
-        accumulated.push_back(
-            make<operation::and_junction>(std::move(new_nodes)));
-      }
-    }
-    return accumulated;
-  }
-
   // Handle the children of an AND.
-  static node_ptr handle_conjunction(const node_list& nodes) {
+  node_ptr handle_conjunction(const node_list& nodes) {
     // Convert each node, splitting into a list of OR's and the rest.
     node_list converted_nodes, converted_or_nodes;
     for (const auto& n : nodes) {
-      auto converted = convert(n);
+      auto converted = handle(n);
       // An always-true node cannot contribute to the result.
       if (converted->op == operation::always_true) continue;
       // An always-false node will make the whole thing false.
@@ -463,43 +1160,50 @@ private:
       converted_nodes.push_back(std::move(converted));
     }
 
-    // If no nodes, then the result is always true.
-    if (converted_nodes.empty() && converted_or_nodes.empty())
-      return make<operation::always_true>();
-
-    // If just one, then use that.
-    if (converted_nodes.size() == 1 && converted_or_nodes.size() == 0)
-      return converted_nodes.front();
-    if (converted_nodes.size() == 0 && converted_or_nodes.size() == 1)
-      return converted_or_nodes.front();
-
     // If no OR nodes to distribute, just recreate the AND node with the
     // converted children.
-    if (converted_or_nodes.empty())
-      return make<operation::and_junction>(std::move(converted_nodes));
-
-    // Distribute OR over AND
-    // Start with a single AND node with all of the non-OR nodes. This will be
-    // multiplied by the children of the OR nodes.
-    node_list accumulated;
-    accumulated.push_back(
-        make<operation::and_junction>(std::move(converted_nodes)));
+    if (converted_or_nodes.empty()) {
+      term_list terms{std::move(converted_nodes)};
+      absorb(terms);
+      return make_term(std::move(terms.front()));
+    }
+    if (converted_nodes.empty() && converted_or_nodes.size() == 1)
+      return converted_or_nodes.front();
 
-    // Distribute the OR nodes over the other nodes, iteratively.
+    // Distribute OR over AND, starting with a single term with all of the
+    // non-OR nodes, and multiplying it by the children of each OR node. If
+    // that would exceed the budget, give up and leave it as an AND.
+    term_list accumulated{converted_nodes};
     for (const auto& converted_or_node : converted_or_nodes) {
-      accumulated =
-          distribute_or_values(accumulated, junction::list(converted_or_node));
+      const auto& or_children = junction::list(converted_or_node);
+      if (accumulated.size() * or_children.size() > max_terms_) {
+        node_list all{std::move(converted_nodes)};
+        all.insert(all.end(), converted_or_nodes.begin(),
+            converted_or_nodes.end());
+        return cons(make<operation::and_junction>(std::move(all)));
+      }
+      term_list distributed;
+      for (const auto& or_child : or_children) {
+        const auto child_literals = literals(or_child);
+        for (const auto& term : accumulated) {
+          auto& new_term = distributed.emplace_back(term);
+          new_term.insert(new_term.end(), child_literals.begin(),
+              child_literals.end());
+        }
+      }
+      absorb(distributed);
+      accumulated = std::move(distributed);
     }
 
-    return make<operation::or_junction>(std::move(accumulated));
+    return make_disjunction(std::move(accumulated));
   }
 
   // Handle the children of an OR.
-  static node_ptr handle_disjunction(const node_list& nodes) {
+  node_ptr handle_disjunction(const node_list& nodes) {
     // Build converted list, scanning for the types created.
-    node_list converted_nodes;
+    term_list terms;
     for (const auto& n : nodes) {
-      auto converted = convert(n);
+      auto converted = handle(n);
       // An always-false node cannot contribute to the result.
       if (converted->op == operation::always_false) continue;
       // An always-true node will make the whole thing true.
@@ -508,19 +1212,14 @@ private:
       // Flatten nested ORs.
       if (converted->op == operation::or_junction) {
         for (const auto& child : junction::list(converted))
-          converted_nodes.push_back(child);
+          terms.push_back(literals(child));
       } else
-        converted_nodes.push_back(std::move(converted));
+        terms.push_back(literals(converted));
     }
 
-    // If no nodes, then the result is always false.
-    if (converted_nodes.empty()) return make<operation::always_false>();
-    // If just one, then use that.
-    if (converted_nodes.size() == 1) return converted_nodes.front();
-
     // Don't distribute these terms because that would move us towards CNF, not
     // DNF.
-    return make<operation::or_junction>(std::move(converted_nodes));
+    return make_disjunction(std::move(terms));
   }
 };
 }}} // namespace corvid::lang::ast_pred
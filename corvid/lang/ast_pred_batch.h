@@ -0,0 +1,412 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../containers/flat_string_map.h"
+#include "ast_pred.h"
+
+namespace corvid { inline namespace lang { namespace ast_pred {
+
+// Columnar evaluation of predicates over a batch of records.
+//
+// Instead of evaluating a predicate once per record, through a `lookup`,
+// `eval_batch` evaluates each node once per batch. Leaves become scans over
+// a column, producing one bit per record 64 at a time, and junctions become
+// bitwise operations on the resulting `selection`.
+
+// Values for one key, one per record.
+//
+// The typed columns hold values that are all present and single, so they
+// can be scanned without touching a variant. A column of `any_value` can
+// hold anything, including nulls and repeated values.
+using column = std::variant<std::vector<int64_t>, std::vector<std::string>,
+    std::vector<any_value>>;
+
+// Bitmap of selected records, one bit per record.
+class selection {
+public:
+  selection() = default;
+  explicit selection(size_t size, bool value = false)
+      : size_{size}, words_((size + 63) / 64, value ? ~uint64_t{} : 0) {
+    trim();
+  }
+
+  // Construct with the records for which `pred(index)` is true.
+  template<typename F>
+  [[nodiscard]] static selection scan(size_t size, F&& pred) {
+    selection s{size};
+    for (size_t w = 0; w < s.words_.size(); ++w) {
+      const size_t base = w * 64;
+      const size_t count = std::min<size_t>(64, size - base);
+      uint64_t bits{};
+      for (size_t b = 0; b < count; ++b)
+        bits |= uint64_t{static_cast<bool>(pred(base + b))} << b;
+      s.words_[w] = bits;
+    }
+    return s;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return size_; }
+  [[nodiscard]] bool test(size_t index) const noexcept {
+    return (words_[index / 64] >> (index % 64)) & 1;
+  }
+  void set(size_t index, bool value = true) noexcept {
+    const auto bit = uint64_t{1} << (index % 64);
+    if (value)
+      words_[index / 64] |= bit;
+    else
+      words_[index / 64] &= ~bit;
+  }
+
+  // Number of selected records.
+  [[nodiscard]] size_t count() const noexcept {
+    size_t n{};
+    for (const auto w : words_) n += std::popcount(w);
+    return n;
+  }
+  [[nodiscard]] bool none() const noexcept {
+    return std::ranges::all_of(words_, [](uint64_t w) { return !w; });
+  }
+  [[nodiscard]] bool all() const noexcept { return count() == size_; }
+
+  // Underlying words, with unused high bits of the last one clear.
+  [[nodiscard]] std::span<const uint64_t> words() const noexcept {
+    return words_;
+  }
+
+  selection& operator&=(const selection& other) noexcept {
+    for (size_t w = 0; w < words_.size(); ++w) words_[w] &= other.words_[w];
+    return *this;
+  }
+  selection& operator|=(const selection& other) noexcept {
+    for (size_t w = 0; w < words_.size(); ++w) words_[w] |= other.words_[w];
+    return *this;
+  }
+  selection& flip() noexcept {
+    for (auto& w : words_) w = ~w;
+    trim();
+    return *this;
+  }
+
+  friend bool operator==(const selection&, const selection&) = default;
+
+private:
+  size_t size_{};
+  std::vector<uint64_t> words_;
+
+  void trim() noexcept {
+    if (const auto tail = size_ % 64)
+      words_.back() &= (uint64_t{1} << tail) - 1;
+  }
+};
+
+// Batch of records, stored as one column per key.
+//
+// Every column must have one value per record. A key with no column is
+// missing from every record.
+class record_batch {
+public:
+  explicit record_batch(size_t size) : size_{size} {}
+
+  [[nodiscard]] size_t size() const noexcept { return size_; }
+
+  // Add or replace the column for `key`. Throws `std::invalid_argument` if
+  // it doesn't have one value per record.
+  void add(std::string key, column values) {
+    const auto rows = std::visit([](const auto& v) { return v.size(); },
+        values);
+    if (rows != size_) throw std::invalid_argument("column size mismatch");
+    columns_.insert_or_assign(std::move(key), std::move(values));
+  }
+
+  // Column for `key`, or null. Invalidated by `add`.
+  [[nodiscard]] const column* find(std::string_view key) const {
+    const auto it = columns_.find(key);
+    return it == columns_.end() ? nullptr : &it->second;
+  }
+
+private:
+  size_t size_;
+  flat_string_map<column> columns_;
+};
+
+namespace details {
+
+using int_column = std::vector<int64_t>;
+using string_column = std::vector<std::string>;
+using any_column = std::vector<any_value>;
+using repeated_value = std::vector<any_single_value>;
+
+// Leaf operand: either a column or a literal, which is just as good as a
+// column of copies.
+struct batch_operand {
+  const column* values{};
+  const any_value* literal{};
+
+  batch_operand(const key_or_value& kv, const record_batch& batch) {
+    if (std::holds_alternative<std::string>(kv))
+      values = batch.find(std::get<std::string>(kv));
+    else if (std::holds_alternative<any_value>(kv))
+      literal = &std::get<any_value>(kv);
+    if (!values && !literal) literal = &lookup::missing;
+  }
+};
+
+// Value of a typed column cell, as an `any_value`, for the slow path.
+[[nodiscard]] inline any_value
+cell_value(const column& values, size_t index) {
+  if (const auto ints = std::get_if<int_column>(&values))
+    return any_single_value{(*ints)[index]};
+  if (const auto strings = std::get_if<string_column>(&values))
+    return any_single_value{(*strings)[index]};
+  return std::get<any_column>(values)[index];
+}
+
+// Select the records of a typed column equal to a single value, if of the
+// same type.
+template<typename T>
+[[nodiscard]] selection
+scan_single_eq(const std::vector<T>& values, const any_single_value& single) {
+  const auto target = std::get_if<T>(&single);
+  if (!target) return selection{values.size()};
+  return selection::scan(values.size(),
+      [&](size_t i) { return values[i] == *target; });
+}
+
+// Select the records in `values` equal to `literal`.
+[[nodiscard]] inline selection
+scan_eq(const column& values, const any_value& literal, size_t size) {
+  if (const auto generic = std::get_if<any_column>(&values))
+    return selection::scan(size,
+        [&](size_t i) { return node::equal((*generic)[i], literal); });
+
+  // Typed cells are present, so a missing literal matches nothing. A
+  // repeated literal matches a cell equal to any of its elements.
+  if (!node::is_present(literal)) return selection{size};
+  return std::visit(
+      [&]<typename C>(const C& typed) -> selection {
+        if constexpr (std::is_same_v<C, any_column>)
+          return selection{size};
+        else {
+          if (const auto single = std::get_if<any_single_value>(&literal))
+            return scan_single_eq(typed, *single);
+          selection result{size};
+          for (const auto& element : std::get<repeated_value>(literal))
+            result |= scan_single_eq(typed, element);
+          return result;
+        }
+      },
+      values);
+}
+
+// Select the records where the two columns are equal.
+[[nodiscard]] inline selection
+scan_eq(const column& l, const column& r, size_t size) {
+  if (const auto li = std::get_if<int_column>(&l))
+    if (const auto ri = std::get_if<int_column>(&r))
+      return selection::scan(size,
+          [&](size_t i) { return (*li)[i] == (*ri)[i]; });
+  if (const auto ls = std::get_if<string_column>(&l))
+    if (const auto rs = std::get_if<string_column>(&r))
+      return selection::scan(size,
+          [&](size_t i) { return (*ls)[i] == (*rs)[i]; });
+  if (!std::holds_alternative<any_column>(l) &&
+      !std::holds_alternative<any_column>(r))
+    return selection{size};
+  return selection::scan(size, [&](size_t i) {
+    return node::equal(cell_value(l, i), cell_value(r, i));
+  });
+}
+
+[[nodiscard]] inline selection
+scan_eq(const batch_operand& l, const batch_operand& r, size_t size) {
+  if (l.values && r.values) return scan_eq(*l.values, *r.values, size);
+  if (l.values) return scan_eq(*l.values, *r.literal, size);
+  if (r.values) return scan_eq(*r.values, *l.literal, size);
+  return selection{size, node::equal(*l.literal, *r.literal)};
+}
+
+[[nodiscard]] inline selection
+scan_exists(const batch_operand& op, size_t size) {
+  if (op.literal) return selection{size, node::is_present(*op.literal)};
+  if (const auto generic = std::get_if<any_column>(op.values))
+    return selection::scan(size,
+        [&](size_t i) { return node::is_present((*generic)[i]); });
+  return selection{size, true};
+}
+
+// Invoke `f` on the value of `op` for record `index`, copying it only if
+// it's in a typed column.
+template<typename F>
+[[nodiscard]] bool
+with_cell(const batch_operand& op, size_t index, const F& f) {
+  if (op.literal) return f(*op.literal);
+  if (const auto generic = std::get_if<any_column>(op.values))
+    return f((*generic)[index]);
+  return f(cell_value(*op.values, index));
+}
+
+// Select the records of a typed column that are ordered as `which` requires
+// against a single literal. Returns empty if the operands aren't of that
+// shape.
+template<operation which>
+[[nodiscard]] std::optional<selection>
+scan_ordered(const batch_operand& l, const batch_operand& r, size_t size) {
+  if (!l.values || !r.literal) return std::nullopt;
+  const auto single = std::get_if<any_single_value>(r.literal);
+  if (!single || std::holds_alternative<any_column>(*l.values))
+    return std::nullopt;
+  if (const auto ints = std::get_if<int_column>(l.values)) {
+    const auto n = std::get_if<int64_t>(single);
+    if (!n) return selection{size};
+    return selection::scan(size, [&](size_t i) {
+      return ordering_node<which>::ordered((*ints)[i] <=> *n);
+    });
+  }
+  const auto& strings = std::get<string_column>(*l.values);
+  const auto text = std::get_if<std::string>(single);
+  if (!text) return selection{size};
+  return selection::scan(size, [&](size_t i) {
+    return ordering_node<which>::ordered(strings[i].compare(*text) <=> 0);
+  });
+}
+
+template<operation which>
+[[nodiscard]] std::optional<selection> scan_either_ordered(
+    const batch_operand& l, const batch_operand& r, size_t size) {
+  if (auto result = scan_ordered<which>(l, r, size)) return result;
+  return scan_ordered<flipped(which)>(r, l, size);
+}
+
+// Select the records of a string column that a leaf's prepared literal
+// matches. Returns empty if the leaf or the operand isn't of that shape.
+template<typename Leaf>
+[[nodiscard]] std::optional<selection>
+scan_text(const Leaf& leaf, const batch_operand& l, size_t size) {
+  if (!leaf.compiled() || !l.values) return std::nullopt;
+  const auto strings = std::get_if<string_column>(l.values);
+  if (!strings) return std::nullopt;
+  return selection::scan(size,
+      [&](size_t i) { return leaf.test_text((*strings)[i]); });
+}
+
+// Select the records for which `leaf` is true, scanning typed columns
+// directly where it can, and otherwise calling `test` on each record.
+[[nodiscard]] inline selection scan_leaf(const binary_leaf& leaf,
+    const batch_operand& l, const batch_operand& r, size_t size) {
+  std::optional<selection> result;
+  switch (leaf.op) {
+  case operation::lt: result = scan_either_ordered<operation::lt>(l, r, size);
+    break;
+  case operation::le: result = scan_either_ordered<operation::le>(l, r, size);
+    break;
+  case operation::gt: result = scan_either_ordered<operation::gt>(l, r, size);
+    break;
+  case operation::ge: result = scan_either_ordered<operation::ge>(l, r, size);
+    break;
+  case operation::contains:
+    result = scan_text(static_cast<const contains_node&>(leaf), l, size);
+    break;
+  case operation::starts_with:
+    result = scan_text(static_cast<const starts_with_node&>(leaf), l, size);
+    break;
+  case operation::ends_with:
+    result = scan_text(static_cast<const ends_with_node&>(leaf), l, size);
+    break;
+  case operation::matches:
+    result = scan_text(static_cast<const matches_node&>(leaf), l, size);
+    break;
+  default: break;
+  }
+  if (result) return std::move(*result);
+  return selection::scan(size, [&](size_t i) {
+    return with_cell(l, i, [&](const any_value& lv) {
+      return with_cell(r, i,
+          [&](const any_value& rv) { return leaf.test(lv, rv); });
+    });
+  });
+}
+
+} // namespace details
+
+// Evaluate `root` against every record in `batch`, selecting the records for
+// which it's true. Agrees with `node::eval` on each record.
+//
+// An `and` stops evaluating its children once nothing is selected, and an
+// `or` once everything is.
+[[nodiscard]] inline selection
+eval_batch(const node& root, const record_batch& batch) {
+  const auto size = batch.size();
+  switch (root.op) {
+  case operation::always_true: return selection{size, true};
+  case operation::and_junction: {
+    selection result{size, true};
+    for (const auto& n : static_cast<const junction&>(root).nodes) {
+      if (result.none()) break;
+      result &= eval_batch(*n, batch);
+    }
+    return result;
+  }
+  case operation::or_junction: {
+    selection result{size};
+    for (const auto& n : static_cast<const junction&>(root).nodes) {
+      if (result.all()) break;
+      result |= eval_batch(*n, batch);
+    }
+    return result;
+  }
+  case operation::not_junction:
+    return eval_batch(*static_cast<const junction&>(root).nodes[0], batch)
+        .flip();
+  case operation::exists:
+  case operation::absent: {
+    const auto& leaf = static_cast<const unary_leaf&>(root);
+    auto result =
+        details::scan_exists(details::batch_operand{leaf.value, batch}, size);
+    return root.op == operation::exists ? result : result.flip();
+  }
+  case operation::eq:
+  case operation::ne: {
+    const auto& leaf = static_cast<const binary_leaf&>(root);
+    auto result = details::scan_eq(details::batch_operand{leaf.lhs, batch},
+        details::batch_operand{leaf.rhs, batch}, size);
+    return root.op == operation::eq ? result : result.flip();
+  }
+  default: {
+    const auto leaf = dynamic_cast<const binary_leaf*>(&root);
+    if (!leaf) return selection{size};
+    return details::scan_leaf(*leaf, details::batch_operand{leaf->lhs, batch},
+        details::batch_operand{leaf->rhs, batch}, size);
+  }
+  }
+}
+
+[[nodiscard]] inline selection
+eval_batch(const node_ptr& root, const record_batch& batch) {
+  return eval_batch(*root, batch);
+}
+
+}}} // namespace corvid::lang::ast_pred
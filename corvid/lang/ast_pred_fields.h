@@ -0,0 +1,100 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "../containers/intern.h"
+#include "ast_pred.h"
+
+namespace corvid { inline namespace lang { namespace ast_pred {
+
+// Dense ID for an interned field key.
+enum class field_id : uint32_t {};
+
+}}} // namespace corvid::lang::ast_pred
+
+template<>
+constexpr inline auto corvid::enums::registry::enum_spec_v<
+    corvid::lang::ast_pred::field_id> =
+    corvid::enums::sequence::make_sequence_enum_spec<
+        corvid::lang::ast_pred::field_id,
+        corvid::lang::ast_pred::field_id{
+            std::numeric_limits<uint32_t>::max()}>();
+
+namespace corvid { inline namespace lang { namespace ast_pred {
+
+// Table of field keys, interned as dense IDs.
+using key_table = intern_table<std::string, field_id>;
+
+// Lookup of fields by interned ID.
+//
+// Fields are stored in a vector indexed by ID, so that `program`, once bound
+// to the same `key_table`, finds each one with an array index instead of a
+// string-keyed probe. Looking up by key still works, through the table, so
+// this can also be used for tree evaluation.
+//
+// Only keys in the table can be set, since no predicate bound to it can refer
+// to any other. To reuse for another record without reallocating, call
+// `clear`.
+class field_lookup: public lookup {
+public:
+  explicit field_lookup(key_table::const_pointer keys)
+      : keys_{std::move(keys)} {}
+
+  // Set the field for `id`.
+  void set(field_id id, any_value value) {
+    const auto index = static_cast<size_t>(*id);
+    if (index >= values_.size()) values_.resize(index + 1);
+    values_[index] = std::move(value);
+  }
+
+  // Set the field for `key`. Returns false, ignoring the value, if the key
+  // isn't in the table.
+  bool set(std::string_view key, any_value value) {
+    const auto iv = keys_->get(key);
+    if (!iv) return false;
+    set(iv.id(), std::move(value));
+    return true;
+  }
+
+  // Make all fields missing.
+  void clear() { std::ranges::fill(values_, any_value{}); }
+
+  [[nodiscard]] const any_value& operator[](field_id id) const noexcept {
+    const auto index = static_cast<size_t>(*id);
+    return index < values_.size() ? values_[index] : missing;
+  }
+
+  const any_value& operator[](const std::string& key) const override {
+    const auto iv = keys_->get(key);
+    return iv ? (*this)[iv.id()] : missing;
+  }
+
+  [[nodiscard]] const key_table::const_pointer& keys() const noexcept {
+    return keys_;
+  }
+
+private:
+  key_table::const_pointer keys_;
+  std::vector<any_value> values_;
+};
+
+}}} // namespace corvid::lang::ast_pred
@@ -0,0 +1,534 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <regex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast_pred.h"
+#include "ast_pred_fields.h"
+#include "ast_pred_program.h"
+
+namespace corvid { inline namespace lang { namespace ast_pred {
+
+// Compiled predicate over a serialized image, such as a file mapped into
+// memory.
+//
+// The image is produced by `serialize`, from a `program`, so it's meant for
+// building predicates in one place and evaluating them in many. Constructing
+// from an image checks that every offset and index in it is in range, but
+// nothing is parsed, converted, or copied: evaluation reads the instructions
+// and literals straight from the image, using the same opcodes as `program`,
+// and the same `leaf_rules`, so with the same results. The only exception is
+// that a `matches` leaf whose pattern is a literal compiles it on
+// construction.
+//
+// Layout, in native byte order, with every part 8-byte aligned:
+// - Header, as `image_header`.
+// - `image_instruction code[code_count]`.
+// - `image_single keys[key_count]`: the key for each field slot.
+// - `image_literal literals[literal_count]`: each refers to a run of
+// `singles`, unless missing.
+// - `image_single singles[single_count]`: strings are offsets into the blob,
+// and integers are stored directly.
+// - `char blob[blob_size]`, padded to a multiple of 8.
+//
+// Since the size is in the header, images can be concatenated into a single
+// file, and `bytes` tells where the next one starts.
+//
+// To look up fields by ID, `bind` to a `key_table` and evaluate against a
+// `field_lookup` that uses the same table. Evaluating against a plain
+// `lookup` has to make a `std::string` for each key it looks up.
+//
+// Usage:
+//   const auto bytes = program_image::serialize(program{dnf::convert(root)});
+//   ...
+//   program_image image{std::as_bytes(std::span{bytes})};
+//   image.bind(*keys);
+//   if (image.eval(event)) ...
+class program_image {
+public:
+  using opcode = program::opcode;
+
+  struct image_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t code_count;
+    uint64_t key_count;
+    uint64_t literal_count;
+    uint64_t single_count;
+    uint64_t regex_count;
+    uint64_t blob_size;
+  };
+
+  // For `test`, `leaf_op` is the `operation` of the leaf. For a `matches`
+  // whose pattern is a literal, `regex` is its index among those.
+  struct image_instruction {
+    opcode op;
+    uint8_t lhs_is_field;
+    uint8_t rhs_is_field;
+    uint8_t leaf_op;
+    uint32_t lhs;
+    uint32_t rhs;
+    uint32_t regex;
+  };
+
+  enum class single_type : uint32_t { null, text, number };
+
+  struct image_single {
+    single_type type;
+    uint32_t size;
+    uint64_t value;
+  };
+
+  enum class literal_shape : uint32_t { missing, single, repeated };
+
+  struct image_literal {
+    literal_shape shape;
+    uint32_t count;
+    uint64_t first;
+  };
+
+  static_assert(sizeof(image_instruction) == 16);
+  static_assert(sizeof(image_single) == 16);
+  static_assert(sizeof(image_literal) == 16);
+
+  static constexpr char image_magic[8] = {'C', 'V', 'D', 'P', 'R', 'O', 'G',
+      'M'};
+  static constexpr uint32_t image_version = 1;
+  static constexpr uint32_t image_byte_order = 0x01020304;
+
+  // Construct from the bytes of an `image`, which must stay valid for the
+  // life of the instance, and may be followed by others. The `owner`, if
+  // any, is held until then, such as to unmap the file. Throws
+  // `std::invalid_argument` if the image is invalid, or `std::regex_error`
+  // if a literal pattern is.
+  explicit program_image(std::span<const std::byte> image,
+      std::shared_ptr<const void> owner = {})
+      : owner_{std::move(owner)} {
+    if (image.size() < sizeof(image_header))
+      throw std::invalid_argument("program image too small");
+    if (reinterpret_cast<uintptr_t>(image.data()) % alignof(uint64_t))
+      throw std::invalid_argument("program image misaligned");
+    std::memcpy(&header_, image.data(), sizeof(header_));
+    if (std::memcmp(header_.magic, image_magic, sizeof(image_magic)) ||
+        header_.version != image_version ||
+        header_.byte_order != image_byte_order)
+      throw std::invalid_argument("program image header mismatch");
+    constexpr uint64_t limit = uint64_t{1} << 32;
+    if (header_.code_count > limit || header_.key_count > limit ||
+        header_.literal_count > limit || header_.single_count > limit ||
+        header_.regex_count > header_.code_count ||
+        header_.blob_size > (limit << 16))
+      throw std::invalid_argument("program image header corrupt");
+    code_ = sizeof(image_header);
+    keys_ = code_ + header_.code_count * sizeof(image_instruction);
+    literals_ = keys_ + header_.key_count * sizeof(image_single);
+    singles_ = literals_ + header_.literal_count * sizeof(image_literal);
+    blob_ = singles_ + header_.single_count * sizeof(image_single);
+    const auto size = blob_ + padded(header_.blob_size);
+    if (image.size() < size)
+      throw std::invalid_argument("program image size mismatch");
+    image_ = image.first(size);
+    check_tables();
+    compile_patterns();
+  }
+
+  // Serialize `prog` into an image.
+  [[nodiscard]] static std::string serialize(const program& prog) {
+    std::vector<image_instruction> code;
+    std::vector<image_single> keys;
+    std::vector<image_literal> literals;
+    std::vector<image_single> singles;
+    std::string blob;
+    uint32_t regexes{};
+
+    const auto add_text = [&](std::string_view text) {
+      if (text.size() >= uint64_t{1} << 32)
+        throw std::length_error("program image string too large");
+      const image_single single{single_type::text,
+          static_cast<uint32_t>(text.size()), blob.size()};
+      blob += text;
+      return single;
+    };
+    const auto add_single = [&](const any_single_value& value) {
+      if (const auto text = std::get_if<std::string>(&value))
+        return add_text(*text);
+      if (const auto number = std::get_if<int64_t>(&value))
+        return image_single{single_type::number, 0,
+            std::bit_cast<uint64_t>(*number)};
+      return image_single{};
+    };
+
+    for (const auto& key : prog.keys()) keys.push_back(add_text(key));
+    for (const auto& literal : prog.literals()) {
+      image_literal out{literal_shape::missing, 0, singles.size()};
+      if (const auto single = std::get_if<any_single_value>(&literal)) {
+        out.shape = literal_shape::single;
+        singles.push_back(add_single(*single));
+      } else if (const auto repeated =
+                     std::get_if<std::vector<any_single_value>>(&literal))
+      {
+        out.shape = literal_shape::repeated;
+        for (const auto& value : *repeated)
+          singles.push_back(add_single(value));
+      }
+      out.count = static_cast<uint32_t>(singles.size() - out.first);
+      literals.push_back(out);
+    }
+    for (const auto& in : prog.code()) {
+      image_instruction out{in.op, in.lhs_is_field, in.rhs_is_field, 0,
+          in.lhs, in.rhs, 0};
+      if (in.op == opcode::test) {
+        const auto op = prog.leaves()[in.leaf]->op;
+        out.leaf_op = static_cast<uint8_t>(op);
+        if (op == operation::matches && !in.rhs_is_field)
+          out.regex = regexes++;
+      }
+      code.push_back(out);
+    }
+
+    image_header header{};
+    std::memcpy(header.magic, image_magic, sizeof(image_magic));
+    header.version = image_version;
+    header.byte_order = image_byte_order;
+    header.code_count = code.size();
+    header.key_count = keys.size();
+    header.literal_count = literals.size();
+    header.single_count = singles.size();
+    header.regex_count = regexes;
+    header.blob_size = blob.size();
+    blob.resize(padded(blob.size()));
+
+    std::string image;
+    image.reserve(sizeof(header) + code.size() * sizeof(image_instruction) +
+                  (keys.size() + singles.size()) * sizeof(image_single) +
+                  literals.size() * sizeof(image_literal) + blob.size());
+    append_bytes(image, &header, sizeof(header));
+    append_bytes(image, code.data(), code.size() * sizeof(image_instruction));
+    append_bytes(image, keys.data(), keys.size() * sizeof(image_single));
+    append_bytes(image, literals.data(),
+        literals.size() * sizeof(image_literal));
+    append_bytes(image, singles.data(), singles.size() * sizeof(image_single));
+    image += blob;
+    return image;
+  }
+
+  // Accessors.
+
+  // The bytes of the image, not including any that follow it.
+  [[nodiscard]] std::span<const std::byte> bytes() const noexcept {
+    return image_;
+  }
+
+  // Number of instructions.
+  [[nodiscard]] size_t code_size() const noexcept {
+    return header_.code_count;
+  }
+
+  // Number of field slots, and the key for each.
+  [[nodiscard]] size_t key_count() const noexcept {
+    return header_.key_count;
+  }
+  [[nodiscard]] std::string_view key(size_t slot) const noexcept {
+    return text_of(load<image_single>(keys_, slot));
+  }
+
+  // Evaluation.
+
+  // Evaluate against `lk`, looking up each field at most once.
+  [[nodiscard]] bool eval(const lookup& lk) const {
+    std::array<const any_value*, program::cached_fields> cache{};
+    return run([&](uint32_t slot) -> const any_value& {
+      if (slot >= program::cached_fields) return lk[std::string{key(slot)}];
+      auto& cached = cache[slot];
+      if (!cached) cached = &lk[std::string{key(slot)}];
+      return *cached;
+    });
+  }
+
+  // Evaluate against fields already resolved, in the order of the keys. A
+  // null pointer is treated as missing.
+  [[nodiscard]] bool eval(std::span<const any_value* const> fields) const {
+    return run([&](uint32_t slot) -> const any_value& {
+      const auto p = fields[slot];
+      return p ? *p : lookup::missing;
+    });
+  }
+
+  // Intern the keys into `table`, so that `eval(const field_lookup&)` can
+  // index fields by ID. Returns false if the table is full.
+  bool bind(key_table& table) {
+    field_ids_.clear();
+    for (size_t slot = 0; slot < key_count(); ++slot) {
+      const auto iv = table.intern(key(slot));
+      if (!iv) {
+        field_ids_.clear();
+        return false;
+      }
+      field_ids_.push_back(iv.id());
+    }
+    return true;
+  }
+
+  // Evaluate against `lk`, indexing fields by the IDs from `bind`, which
+  // must have used the same table. If not bound, looks up fields by key.
+  [[nodiscard]] bool eval(const field_lookup& lk) const {
+    if (field_ids_.size() != key_count())
+      return eval(static_cast<const lookup&>(lk));
+    return run([&](uint32_t slot) -> const any_value& {
+      return lk[field_ids_[slot]];
+    });
+  }
+
+private:
+  std::span<const std::byte> image_;
+  std::shared_ptr<const void> owner_;
+  image_header header_{};
+  size_t code_{};
+  size_t keys_{};
+  size_t literals_{};
+  size_t singles_{};
+  size_t blob_{};
+  std::vector<std::regex> regexes_;
+  std::vector<field_id> field_ids_;
+
+  using single_view = leaf_rules::single_view;
+  using value_shape = leaf_rules::value_shape;
+
+  // An operand, which is a field or a literal from the image, viewed as
+  // `leaf_rules` expects.
+  class value_view {
+  public:
+    value_view(const any_value& field) noexcept : field_{field} {}
+    value_view(const program_image& image, const image_literal& literal)
+        : field_{lookup::missing}, image_{&image}, first_{literal.first},
+          count_{literal.count} {
+      switch (literal.shape) {
+      case literal_shape::single: shape_ = value_shape::single; break;
+      case literal_shape::repeated: shape_ = value_shape::repeated; break;
+      default: count_ = 0; break;
+      }
+    }
+
+    [[nodiscard]] value_shape shape() const noexcept {
+      return image_ ? shape_ : field_.shape();
+    }
+    [[nodiscard]] size_t size() const noexcept {
+      return image_ ? count_ : field_.size();
+    }
+    [[nodiscard]] single_view operator[](size_t index) const {
+      if (!image_) return field_[index];
+      return image_->single_of(
+          image_->load<image_single>(image_->singles_, first_ + index));
+    }
+
+  private:
+    leaf_rules::any_value_view field_;
+    const program_image* image_{};
+    value_shape shape_{};
+    uint64_t first_{};
+    size_t count_{};
+  };
+
+  [[nodiscard]] static constexpr uint64_t padded(uint64_t size) noexcept {
+    return (size + 7) & ~uint64_t{7};
+  }
+
+  static void append_bytes(std::string& out, const void* p, size_t size) {
+    out.append(static_cast<const char*>(p), size);
+  }
+
+  template<typename U>
+  [[nodiscard]] U load(size_t base, uint64_t index) const noexcept {
+    U u;
+    std::memcpy(&u, image_.data() + base + index * sizeof(U), sizeof(U));
+    return u;
+  }
+
+  [[nodiscard]] std::string_view text_of(const image_single& s) const {
+    return {reinterpret_cast<const char*>(image_.data() + blob_ + s.value),
+        s.size};
+  }
+
+  [[nodiscard]] single_view single_of(const image_single& s) const {
+    if (s.type == single_type::text) return single_view::of_text(text_of(s));
+    if (s.type == single_type::number)
+      return single_view::of_number(std::bit_cast<int64_t>(s.value));
+    return {};
+  }
+
+  [[noreturn]] static void corrupt() {
+    throw std::invalid_argument("program image corrupt");
+  }
+
+  // Check that the keys and literals refer to singles, and the singles to
+  // text, that are within the image.
+  void check_tables() const {
+    const auto check_single = [&](const image_single& single) {
+      switch (single.type) {
+      case single_type::null:
+      case single_type::number: return;
+      case single_type::text:
+        if (single.value > header_.blob_size ||
+            single.size > header_.blob_size - single.value)
+          corrupt();
+        return;
+      default: corrupt();
+      }
+    };
+    for (size_t slot = 0; slot < header_.key_count; ++slot) {
+      const auto key = load<image_single>(keys_, slot);
+      if (key.type != single_type::text) corrupt();
+      check_single(key);
+    }
+    for (size_t i = 0; i < header_.literal_count; ++i) {
+      const auto literal = load<image_literal>(literals_, i);
+      if (literal.shape == literal_shape::single && literal.count != 1)
+        corrupt();
+      if (literal.shape != literal_shape::missing &&
+          (literal.shape > literal_shape::repeated ||
+              literal.first > header_.single_count ||
+              literal.count > header_.single_count - literal.first))
+        corrupt();
+    }
+    for (size_t i = 0; i < header_.single_count; ++i)
+      check_single(load<image_single>(singles_, i));
+  }
+
+  // Check that each instruction's operands, jump target, and pattern index
+  // are in range, while compiling the literal patterns of the `matches`
+  // leaves, in order. One that isn't a single string never matches, just as
+  // in `matches_node`.
+  void compile_patterns() {
+    const auto check_operand = [&](bool is_field, uint32_t index) {
+      if (index >= (is_field ? header_.key_count : header_.literal_count))
+        corrupt();
+    };
+    regexes_.reserve(header_.regex_count);
+    for (size_t pc = 0; pc < header_.code_count; ++pc) {
+      const auto in = load<image_instruction>(code_, pc);
+      switch (in.op) {
+      case opcode::load_false:
+      case opcode::load_true:
+      case opcode::negate: continue;
+      case opcode::jump_if_false:
+      case opcode::jump_if_true:
+        if (in.lhs > header_.code_count) corrupt();
+        continue;
+      case opcode::exists:
+      case opcode::absent: check_operand(in.lhs_is_field, in.lhs); continue;
+      case opcode::eq:
+      case opcode::ne:
+      case opcode::test:
+        check_operand(in.lhs_is_field, in.lhs);
+        check_operand(in.rhs_is_field, in.rhs);
+        break;
+      default: corrupt();
+      }
+      if (in.op != opcode::test ||
+          in.leaf_op != static_cast<uint8_t>(operation::matches) ||
+          in.rhs_is_field)
+        continue;
+      if (in.regex != regexes_.size() || in.regex >= header_.regex_count)
+        corrupt();
+      const value_view pattern{*this,
+          load<image_literal>(literals_, in.rhs)};
+      if (const auto text = leaf_rules::pattern_of(pattern))
+        regexes_.emplace_back(std::string{*text}, std::regex::optimize);
+      else
+        regexes_.emplace_back();
+    }
+    if (regexes_.size() != header_.regex_count) corrupt();
+  }
+
+  // Evaluate a `test` leaf, as the node for `op` would.
+  [[nodiscard]] bool test(const image_instruction& in, const value_view& l,
+      const value_view& r) const {
+    const auto op = static_cast<operation>(in.leaf_op);
+    switch (op) {
+    case operation::lt:
+    case operation::le:
+    case operation::gt:
+    case operation::ge: return leaf_rules::ordered(op, l, r);
+    case operation::contains:
+    case operation::starts_with:
+    case operation::ends_with: return leaf_rules::found(op, l, r);
+    case operation::matches:
+      if (!in.rhs_is_field) return leaf_rules::search(l, regexes_[in.regex]);
+      return leaf_rules::search(l, r);
+    default: return false;
+    }
+  }
+
+  template<typename F>
+  [[nodiscard]] bool run(const F& field) const {
+#if CORVID_INSTRUMENTATION
+    scoped_timer timed{library_probes().ast_pred_eval};
+#endif
+    const auto operand = [&](bool is_field, uint32_t index) -> value_view {
+      if (is_field) return field(index);
+      return {*this, load<image_literal>(literals_, index)};
+    };
+    bool result{};
+    const auto size = header_.code_count;
+    for (size_t pc = 0; pc < size;) {
+      const auto in = load<image_instruction>(code_, pc++);
+      switch (in.op) {
+      case opcode::load_false: result = false; break;
+      case opcode::load_true: result = true; break;
+      case opcode::exists:
+        result = leaf_rules::is_present(operand(in.lhs_is_field, in.lhs));
+        break;
+      case opcode::absent:
+        result = !leaf_rules::is_present(operand(in.lhs_is_field, in.lhs));
+        break;
+      case opcode::eq:
+        result = leaf_rules::equal(operand(in.lhs_is_field, in.lhs),
+            operand(in.rhs_is_field, in.rhs));
+        break;
+      case opcode::ne:
+        result = !leaf_rules::equal(operand(in.lhs_is_field, in.lhs),
+            operand(in.rhs_is_field, in.rhs));
+        break;
+      case opcode::test:
+        result = test(in, operand(in.lhs_is_field, in.lhs),
+            operand(in.rhs_is_field, in.rhs));
+        break;
+      case opcode::negate: result = !result; break;
+      case opcode::jump_if_false:
+        if (!result) pc = in.lhs;
+        break;
+      case opcode::jump_if_true:
+        if (result) pc = in.lhs;
+        break;
+      }
+    }
+    return result;
+  }
+};
+
+}}} // namespace corvid::lang::ast_pred
@@ -0,0 +1,298 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast_pred.h"
+
+namespace corvid { inline namespace lang { namespace ast_pred {
+
+// Index of many predicates, for finding the ones that match an event.
+//
+// Each predicate is converted to DNF, and each of its conjunctions is indexed
+// by its `eq` leaves that compare a key to a single value, its `exists`
+// leaves, and its ordering leaves that compare a key to a single integer or
+// string. Equality is looked up in a hash map and orderings in sorted maps of
+// the bounds, so an event walks only the postings it satisfies. Matching
+// counts, for each conjunction, how many of those leaves the
+// event satisfies, by looking up each indexed key once and walking its
+// postings. Only a conjunction whose count reaches the number of its indexed
+// leaves becomes a candidate, and only then are its other leaves evaluated.
+// A conjunction with no indexed leaves is a candidate for every event.
+//
+// If DNF conversion exceeds its budget, the predicate is indexed by the
+// leaves of its top-level AND, with the rest evaluated as candidates.
+class predicate_index {
+public:
+  // Working memory for `match`, reusable across events. Each thread that
+  // matches concurrently needs its own.
+  class scratch {
+    friend class predicate_index;
+    std::vector<uint32_t> counts_;
+    std::vector<uint32_t> touched_;
+  };
+
+  // Add `root`, to be reported as `id` when it matches.
+  void add(size_t id, const node_ptr& root,
+      size_t max_terms = dnf::default_max_terms) {
+    ++predicates_;
+    const auto converted = dnf::convert(root, max_terms);
+    if (converted->op == operation::always_false) return;
+    if (converted->op != operation::or_junction) {
+      add_conjunction(id, converted);
+      return;
+    }
+    for (const auto& term : junction::list(converted))
+      add_conjunction(id, term);
+  }
+
+  // Number of predicates added.
+  [[nodiscard]] size_t size() const noexcept { return predicates_; }
+  [[nodiscard]] bool empty() const noexcept { return !predicates_; }
+
+  // Number of conjunctions indexed.
+  [[nodiscard]] size_t conjunctions() const noexcept {
+    return conjunctions_.size();
+  }
+
+  // Set `out` to the sorted, unique IDs of the predicates that match `lk`.
+  void match(const lookup& lk, std::vector<size_t>& out, scratch& s) const {
+    out.clear();
+    s.counts_.resize(conjunctions_.size());
+    const auto hit_one = [&](uint32_t index) {
+      auto& count = s.counts_[index];
+      if (!count++) s.touched_.push_back(index);
+      const auto& c = conjunctions_[index];
+      if (count == c.required && satisfies(c, lk)) out.push_back(c.id);
+    };
+    const auto hit = [&](const std::vector<uint32_t>& postings) {
+      for (const auto index : postings) hit_one(index);
+    };
+
+    for (const auto& [key, postings] : keys_) {
+      const auto& value = lk[key];
+      if (!node::is_present(value)) continue;
+      hit(postings.present);
+      if (postings.equal.empty()) continue;
+      if (const auto single = std::get_if<any_single_value>(&value)) {
+        if (const auto it = postings.equal.find(*single);
+            it != postings.equal.end())
+          hit(it->second);
+        continue;
+      }
+      // A repeated value equals each of its elements, but each only once.
+      const auto& elements = std::get<repeated_value>(value);
+      for (auto e = elements.begin(); e != elements.end(); ++e) {
+        if (std::find(elements.begin(), e, *e) != e) continue;
+        if (const auto it = postings.equal.find(*e);
+            it != postings.equal.end())
+          hit(it->second);
+      }
+    }
+
+    for (const auto& [key, postings] : ranges_) {
+      const auto& value = lk[key];
+      if (!node::is_present(value)) continue;
+      walk_ranges(postings.ints, value, hit_one);
+      walk_ranges(postings.strings, value, hit_one);
+    }
+
+    for (const auto index : unconditional_) {
+      const auto& c = conjunctions_[index];
+      if (satisfies(c, lk)) out.push_back(c.id);
+    }
+
+    for (const auto index : s.touched_) s.counts_[index] = 0;
+    s.touched_.clear();
+    std::ranges::sort(out);
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+  }
+
+  [[nodiscard]] std::vector<size_t> match(const lookup& lk) const {
+    std::vector<size_t> out;
+    scratch s;
+    match(lk, out, s);
+    return out;
+  }
+
+private:
+  using repeated_value = std::vector<any_single_value>;
+
+  struct conjunction {
+    size_t id;
+    uint32_t required{};
+    node_list residual;
+  };
+
+  struct key_postings {
+    std::unordered_map<any_single_value, std::vector<uint32_t>> equal;
+    std::vector<uint32_t> present;
+  };
+
+  // Conjunctions by the bound of an ordering leaf, one map for each of `lt`,
+  // `le`, `gt`, and `ge`, with the key on the left.
+  template<typename T>
+  using bounds = std::array<std::multimap<T, uint32_t>, 4>;
+
+  struct range_postings {
+    bounds<int64_t> ints;
+    bounds<std::string> strings;
+  };
+
+  std::vector<conjunction> conjunctions_;
+  std::vector<uint32_t> unconditional_;
+  string_unordered_map<key_postings> keys_;
+  string_unordered_map<range_postings> ranges_;
+  size_t predicates_{};
+
+  [[nodiscard]] static bool
+  satisfies(const conjunction& c, const lookup& lk) {
+    return std::ranges::all_of(c.residual,
+        [&](const auto& n) { return n->eval(lk); });
+  }
+
+  // If `n` is an `eq` of a key and a present single value, return them.
+  [[nodiscard]] static std::pair<const std::string*, const any_single_value*>
+  indexable_eq(const node& n) {
+    if (n.op != operation::eq) return {};
+    const auto& leaf = static_cast<const binary_leaf&>(n);
+    auto key = std::get_if<std::string>(&leaf.lhs);
+    auto literal = std::get_if<any_value>(&leaf.rhs);
+    if (!key || !literal) {
+      key = std::get_if<std::string>(&leaf.rhs);
+      literal = std::get_if<any_value>(&leaf.lhs);
+    }
+    if (!key || !literal || !node::is_present(*literal)) return {};
+    const auto single = std::get_if<any_single_value>(literal);
+    if (!single) return {};
+    return {key, single};
+  }
+
+  // If `n` is an ordering of a key and a single integer or string, return
+  // them, along with the ordering as if the key were on the left.
+  struct indexable_range {
+    const std::string* key{};
+    const any_single_value* bound{};
+    operation op{};
+  };
+
+  [[nodiscard]] static indexable_range indexable_ordering(const node& n) {
+    switch (n.op) {
+    case operation::lt:
+    case operation::le:
+    case operation::gt:
+    case operation::ge: break;
+    default: return {};
+    }
+    const auto& leaf = static_cast<const binary_leaf&>(n);
+    auto op = n.op;
+    auto key = std::get_if<std::string>(&leaf.lhs);
+    auto literal = std::get_if<any_value>(&leaf.rhs);
+    if (!key || !literal) {
+      key = std::get_if<std::string>(&leaf.rhs);
+      literal = std::get_if<any_value>(&leaf.lhs);
+      op = flipped(op);
+    }
+    if (!key || !literal) return {};
+    const auto single = std::get_if<any_single_value>(literal);
+    if (!single || std::holds_alternative<std::monostate>(*single)) return {};
+    return {key, single, op};
+  }
+
+  [[nodiscard]] static constexpr size_t slot(operation op) noexcept {
+    return static_cast<size_t>(op) - static_cast<size_t>(operation::lt);
+  }
+
+  // Walk the postings of the bounds that `value` satisfies. For a repeated
+  // value, an ordering holds if it holds for any element, so only the least
+  // element of type `T` is compared to upper bounds, and the greatest to
+  // lower bounds.
+  template<typename T, typename F>
+  static void walk_ranges(const bounds<T>& b, const any_value& value,
+      const F& hit) {
+    const T* low{};
+    const T* high{};
+    if (const auto single = std::get_if<any_single_value>(&value)) {
+      low = high = std::get_if<T>(single);
+    } else {
+      for (const auto& e : std::get<repeated_value>(value)) {
+        const auto x = std::get_if<T>(&e);
+        if (!x) continue;
+        if (!low || *x < *low) low = x;
+        if (!high || *high < *x) high = x;
+      }
+    }
+    if (!low) return;
+    const auto walk = [&](auto first, auto last) {
+      for (; first != last; ++first) hit(first->second);
+    };
+    const auto& lt = b[slot(operation::lt)];
+    const auto& le = b[slot(operation::le)];
+    const auto& gt = b[slot(operation::gt)];
+    const auto& ge = b[slot(operation::ge)];
+    walk(lt.upper_bound(*low), lt.end());
+    walk(le.lower_bound(*low), le.end());
+    walk(gt.begin(), gt.lower_bound(*high));
+    walk(ge.begin(), ge.upper_bound(*high));
+  }
+
+  void add_conjunction(size_t id, const node_ptr& term) {
+    const auto index = static_cast<uint32_t>(conjunctions_.size());
+    auto& c = conjunctions_.emplace_back(id);
+    const auto add_literal = [&](const node_ptr& n) {
+      if (n->op == operation::always_true) return;
+      if (n->op == operation::exists) {
+        const auto& leaf = static_cast<const unary_leaf&>(*n);
+        if (const auto key = std::get_if<std::string>(&leaf.value)) {
+          keys_[*key].present.push_back(index);
+          ++c.required;
+          return;
+        }
+      }
+      if (const auto [key, single] = indexable_eq(*n); key) {
+        keys_[*key].equal[*single].push_back(index);
+        ++c.required;
+        return;
+      }
+      if (const auto range = indexable_ordering(*n); range.key) {
+        auto& postings = ranges_[*range.key];
+        const auto at = slot(range.op);
+        if (const auto i = std::get_if<int64_t>(range.bound))
+          postings.ints[at].emplace(*i, index);
+        else
+          postings.strings[at].emplace(std::get<std::string>(*range.bound),
+              index);
+        ++c.required;
+        return;
+      }
+      c.residual.push_back(n);
+    };
+    if (term->op == operation::and_junction)
+      for (const auto& n : junction::list(term)) add_literal(n);
+    else
+      add_literal(term);
+    if (!c.required) unconditional_.push_back(index);
+  }
+};
+
+}}} // namespace corvid::lang::ast_pred
@@ -0,0 +1,306 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "ast_pred.h"
+#include "ast_pred_fields.h"
+
+namespace corvid { inline namespace lang { namespace ast_pred {
+
+// Predicate compiled to a flat array of instructions.
+//
+// The tree is lowered into instructions for a single boolean register, with
+// AND and OR turned into forward jumps that short-circuit, so evaluation is
+// one loop over a contiguous array, with no virtual calls and no allocation.
+// Each distinct key becomes a field slot, and each literal is stored once,
+// so leaves refer to their operands by index.
+//
+// The ordering and text leaves are evaluated by calling their `test`, so the
+// program holds on to them. For arena nodes, the arena must outlive it.
+//
+// The result agrees with `node::eval` on the same tree. Compiling the output
+// of `dnf::convert` works, but isn't required.
+//
+// To avoid string-keyed lookups, `bind` the program to a `key_table`, and
+// evaluate against a `field_lookup` that uses the same table.
+//
+// Usage:
+//   auto keys = key_table::make();
+//   program prog{dnf::convert(root)};
+//   prog.bind(*keys);
+//   field_lookup event{keys};
+//   event.set("user", any_single_value{"alice"s});
+//   if (prog.eval(event)) ...
+class program {
+public:
+  enum class opcode : uint8_t {
+    load_false,
+    load_true,
+    exists,
+    absent,
+    eq,
+    ne,
+    test,
+    negate,
+    jump_if_false,
+    jump_if_true,
+  };
+
+  // One instruction. Leaves use `lhs` and `rhs` as operands, each either a
+  // field slot or a literal index. Jumps use `lhs` as the target. For
+  // `test`, `leaf` indexes the leaf whose `test` is called, for the leaves
+  // that keep precompiled state, such as `matches`.
+  struct instruction {
+    opcode op{};
+    bool lhs_is_field{};
+    bool rhs_is_field{};
+    uint32_t lhs{};
+    uint32_t rhs{};
+    uint32_t leaf{};
+  };
+
+  // Number of field slots that `eval(const lookup&)` caches on the stack.
+  // Beyond these, a slot is looked up each time it's used.
+  static constexpr size_t cached_fields = 16;
+
+  program() = default;
+  explicit program(const node_ptr& root) { compile(root); }
+
+  // Evaluate against `lk`, looking up each field at most once.
+  [[nodiscard]] bool eval(const lookup& lk) const {
+    std::array<const any_value*, cached_fields> cache{};
+    return run([&](uint32_t slot) -> const any_value& {
+      if (slot >= cached_fields) return lk[keys_[slot]];
+      auto& cached = cache[slot];
+      if (!cached) cached = &lk[keys_[slot]];
+      return *cached;
+    });
+  }
+
+  // Evaluate against fields already resolved, in the order of `keys`. A
+  // null pointer is treated as missing.
+  [[nodiscard]] bool eval(std::span<const any_value* const> fields) const {
+    return run([&](uint32_t slot) -> const any_value& {
+      const auto p = fields[slot];
+      return p ? *p : lookup::missing;
+    });
+  }
+
+  // Intern the keys into `table`, so that `eval(const field_lookup&)` can
+  // index fields by ID. Returns false if the table is full.
+  bool bind(key_table& table) {
+    field_ids_.clear();
+    for (const auto& key : keys_) {
+      const auto iv = table.intern(key);
+      if (!iv) {
+        field_ids_.clear();
+        return false;
+      }
+      field_ids_.push_back(iv.id());
+    }
+    return true;
+  }
+
+  // Evaluate against `lk`, indexing fields by the IDs from `bind`, which
+  // must have used the same table. If not bound, looks up fields by key.
+  [[nodiscard]] bool eval(const field_lookup& lk) const {
+    if (field_ids_.size() != keys_.size())
+      return eval(static_cast<const lookup&>(lk));
+    return run([&](uint32_t slot) -> const any_value& {
+      return lk[field_ids_[slot]];
+    });
+  }
+
+  // Keys, indexed by field slot.
+  [[nodiscard]] const std::vector<std::string>& keys() const noexcept {
+    return keys_;
+  }
+
+  // Literals, indexed by literal index.
+  [[nodiscard]] const std::vector<any_value>& literals() const noexcept {
+    return literals_;
+  }
+
+  // Field IDs from `bind`, indexed by field slot.
+  [[nodiscard]] const std::vector<field_id>& field_ids() const noexcept {
+    return field_ids_;
+  }
+
+  [[nodiscard]] std::span<const instruction> code() const noexcept {
+    return code_;
+  }
+
+  // Leaves called by `test`, indexed by `instruction::leaf`.
+  [[nodiscard]] std::span<const std::shared_ptr<const binary_leaf>>
+  leaves() const noexcept {
+    return leaves_;
+  }
+
+private:
+  std::vector<instruction> code_;
+  std::vector<std::string> keys_;
+  std::vector<field_id> field_ids_;
+  std::vector<any_value> literals_;
+  std::vector<std::shared_ptr<const binary_leaf>> leaves_;
+
+  template<typename F>
+  [[nodiscard]] bool run(const F& field) const {
+#if CORVID_INSTRUMENTATION
+    scoped_timer timed{library_probes().ast_pred_eval};
+#endif
+    const auto operand = [&](bool is_field,
+                             uint32_t index) -> const any_value& {
+      return is_field ? field(index) : literals_[index];
+    };
+    bool result{};
+    const auto size = code_.size();
+    for (size_t pc = 0; pc < size;) {
+      const auto& in = code_[pc++];
+      switch (in.op) {
+      case opcode::load_false: result = false; break;
+      case opcode::load_true: result = true; break;
+      case opcode::exists:
+        result = node::is_present(operand(in.lhs_is_field, in.lhs));
+        break;
+      case opcode::absent:
+        result = !node::is_present(operand(in.lhs_is_field, in.lhs));
+        break;
+      case opcode::eq:
+        result = node::equal(operand(in.lhs_is_field, in.lhs),
+            operand(in.rhs_is_field, in.rhs));
+        break;
+      case opcode::ne:
+        result = !node::equal(operand(in.lhs_is_field, in.lhs),
+            operand(in.rhs_is_field, in.rhs));
+        break;
+      case opcode::test:
+        result = leaves_[in.leaf]->test(operand(in.lhs_is_field, in.lhs),
+            operand(in.rhs_is_field, in.rhs));
+        break;
+      case opcode::negate: result = !result; break;
+      case opcode::jump_if_false:
+        if (!result) pc = in.lhs;
+        break;
+      case opcode::jump_if_true:
+        if (result) pc = in.lhs;
+        break;
+      }
+    }
+    return result;
+  }
+
+  void emit(opcode op, uint32_t lhs = 0) {
+    code_.push_back({op, {}, {}, lhs});
+  }
+
+  // Bind an operand to `kv`, as a field slot or a literal.
+  void bind(const key_or_value& kv, bool& is_field, uint32_t& index) {
+    if (std::holds_alternative<std::string>(kv)) {
+      const auto& key = std::get<std::string>(kv);
+      auto it = std::ranges::find(keys_, key);
+      if (it == keys_.end()) it = keys_.insert(it, key);
+      is_field = true;
+      index = static_cast<uint32_t>(it - keys_.begin());
+      return;
+    }
+    const auto& value = std::holds_alternative<any_value>(kv)
+                            ? std::get<any_value>(kv)
+                            : lookup::missing;
+    auto it = std::ranges::find(literals_, value);
+    if (it == literals_.end()) it = literals_.insert(it, value);
+    is_field = false;
+    index = static_cast<uint32_t>(it - literals_.begin());
+  }
+
+  // A null node is compiled as false.
+  void compile(const node_ptr& np) {
+    if (!np) {
+      emit(opcode::load_false);
+      return;
+    }
+    const auto& n = *np;
+    switch (n.op) {
+    case operation::always_false: emit(opcode::load_false); return;
+    case operation::always_true: emit(opcode::load_true); return;
+    case operation::and_junction:
+    case operation::or_junction: {
+      const bool is_and = n.op == operation::and_junction;
+      const auto& nodes = static_cast<const junction&>(n).nodes;
+      if (nodes.empty()) {
+        emit(is_and ? opcode::load_true : opcode::load_false);
+        return;
+      }
+      // Each child but the last jumps past the rest once it decides.
+      std::vector<size_t> jumps;
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        compile(nodes[i]);
+        if (i + 1 == nodes.size()) break;
+        jumps.push_back(code_.size());
+        emit(is_and ? opcode::jump_if_false : opcode::jump_if_true);
+      }
+      for (const auto jump : jumps)
+        code_[jump].lhs = static_cast<uint32_t>(code_.size());
+      return;
+    }
+    case operation::not_junction:
+      compile(static_cast<const junction&>(n).nodes[0]);
+      emit(opcode::negate);
+      return;
+    case operation::exists:
+    case operation::absent: {
+      const auto& leaf = static_cast<const unary_leaf&>(n);
+      instruction in{n.op == operation::exists ? opcode::exists
+                                               : opcode::absent};
+      bind(leaf.value, in.lhs_is_field, in.lhs);
+      code_.push_back(in);
+      return;
+    }
+    case operation::eq:
+    case operation::ne: {
+      const auto& leaf = static_cast<const binary_leaf&>(n);
+      instruction in{n.op == operation::eq ? opcode::eq : opcode::ne};
+      bind(leaf.lhs, in.lhs_is_field, in.lhs);
+      bind(leaf.rhs, in.rhs_is_field, in.rhs);
+      code_.push_back(in);
+      return;
+    }
+    // Anything else evaluates as false, just as `node::eval` does.
+    default: {
+      const auto leaf = dynamic_cast<const binary_leaf*>(&n);
+      if (!leaf) {
+        emit(opcode::load_false);
+        return;
+      }
+      instruction in{opcode::test};
+      bind(leaf->lhs, in.lhs_is_field, in.lhs);
+      bind(leaf->rhs, in.rhs_is_field, in.rhs);
+      in.leaf = static_cast<uint32_t>(leaves_.size());
+      leaves_.emplace_back(np, leaf);
+      code_.push_back(in);
+      return;
+    }
+    }
+  }
+};
+
+}}} // namespace corvid::lang::ast_pred
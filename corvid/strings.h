@@ -20,6 +20,7 @@
 #include "strings/fixed_string.h"
 #include "strings/fixed_string_utils.h"
 #include "strings/cases.h"
+#include "strings/hashing.h"
 #include "strings/locating.h"
 #include "strings/targeting.h"
 #include "strings/delimiting.h"
@@ -27,8 +28,10 @@
 #include "strings/delimiting.h"
 #include "strings/trimming.h"
 #include "strings/splitting.h"
+#include "strings/parallel.h"
 #include "strings/conversion.h"
 #include "strings/concat_join.h"
+#include "strings/formatting.h"
 #include "strings/enum_conversion.h"
 
 // Recommendation: While you can import the entire `corvid::strings` namespace,
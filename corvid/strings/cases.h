@@ -17,52 +17,202 @@
 #pragma once
 #include "strings_shared.h"
 
+#include <bit>
+#include <compare>
+#include <cstring>
+
 namespace corvid::strings { inline namespace cases {
 
 //
 // Case change.
 //
 
+// These are all ASCII-only, so bytes outside of ASCII, such as those in
+// UTF-8 sequences, are left alone.
+
 // Convert to uppercase.
 // Avoids `std::toupper` because it's locale-dependent and slow.
-[[nodiscard]] inline char to_upper(char c) {
+[[nodiscard]] constexpr char to_upper(char c) {
   return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
 }
 
+// Convert to lowercase.
+// Avoids `std::tolower` because it's locale-dependent and slow.
+[[nodiscard]] constexpr char to_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+namespace details {
+// Change the case of the ASCII letters in all eight bytes of `word` at once.
+//
+// Adding to each byte, with its high bit masked off so the carry can't
+// spread, sets the high bit when it's at or past a bound. So the high bits
+// mark the bytes from `first` to `last` that were ASCII to begin with, and
+// shifted down, they're the case bit.
+template<bool upper>
+[[nodiscard]] constexpr uint64_t change_case(uint64_t word) noexcept {
+  constexpr uint64_t ones = 0x0101010101010101;
+  constexpr uint64_t highs = ones * 0x80;
+  constexpr uint64_t low7 = ones * 0x7F;
+  constexpr unsigned char first = upper ? 'a' : 'A';
+  constexpr unsigned char last = upper ? 'z' : 'Z';
+  const auto heptets = word & low7;
+  const auto at_or_past_first = heptets + ones * (0x80 - first);
+  const auto past_last = heptets + ones * (0x80 - last - 1);
+  const auto letters = at_or_past_first & ~past_last & ~word & highs;
+  return word ^ (letters >> 2);
+}
+
+// Change the case of `len` characters from `from` into `to`, which may be
+// the same.
+template<bool upper>
+inline void change_case(const char* from, size_t len, char* to) noexcept {
+  size_t pos{};
+  for (; pos + 8 <= len; pos += 8) {
+    uint64_t word;
+    std::memcpy(&word, from + pos, sizeof(word));
+    word = change_case<upper>(word);
+    std::memcpy(to + pos, &word, sizeof(word));
+  }
+  for (; pos < len; ++pos)
+    to[pos] = upper ? to_upper(from[pos]) : to_lower(from[pos]);
+}
+
+// Copy `sv` with its case changed.
+template<bool upper>
+[[nodiscard]] inline std::string as_case(std::string_view sv) {
+  std::string s;
+#ifdef __cpp_lib_string_resize_and_overwrite
+  s.resize_and_overwrite(sv.size(), [sv](char* p, size_t) {
+    change_case<upper>(sv.data(), sv.size(), p);
+    return sv.size();
+  });
+#else
+  s.resize(sv.size());
+  change_case<upper>(sv.data(), sv.size(), s.data());
+#endif
+  return s;
+}
+} // namespace details
+
 // Convert to uppercase.
 inline void to_upper(Range auto& r) {
   std::span s{r};
-  std::ranges::transform(s, s.begin(), [](unsigned char c) {
-    return toupper(c);
-  });
+  details::change_case<true>(s.data(), s.size(), s.data());
 }
 
 // Return as uppercase.
 [[nodiscard]] inline std::string as_upper(std::string_view sv) {
-  std::string s{sv};
-  to_upper(s);
-  return s;
-}
-
-// Convert to lowercase.
-// Avoids `std::tolower` because it's locale-dependent and slow.
-[[nodiscard]] inline char to_lower(char c) {
-  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+  return details::as_case<true>(sv);
 }
 
 // Convert to lowercase.
 inline void to_lower(Range auto& r) {
   std::span s{r};
-  std::ranges::transform(s, s.begin(), [](unsigned char c) {
-    return tolower(c);
-  });
+  details::change_case<false>(s.data(), s.size(), s.data());
 }
 
 // Return as lowercase.
 [[nodiscard]] inline std::string as_lower(std::string_view sv) {
-  std::string s{sv};
-  to_lower(s);
-  return s;
+  return details::as_case<false>(sv);
+}
+
+//
+// Case-insensitive comparison.
+//
+
+// These compare as if both sides were lowercased, eight bytes at a time.
+
+namespace details {
+// Load up to eight bytes, lowercased, zero-filling the rest.
+[[nodiscard]] inline uint64_t
+load_lower(const char* p, size_t len = 8) noexcept {
+  uint64_t word{};
+  std::memcpy(&word, p, std::min<size_t>(len, 8));
+  return change_case<false>(word);
+}
+} // namespace details
+
+// Whether `l` and `r` are equal, ignoring ASCII case.
+[[nodiscard]] inline bool iequal(std::string_view l, std::string_view r) {
+  if (l.size() != r.size()) return false;
+  for (size_t pos = 0; pos < l.size(); pos += 8) {
+    const auto len = l.size() - pos;
+    if (details::load_lower(l.data() + pos, len) !=
+        details::load_lower(r.data() + pos, len))
+      return false;
+  }
+  return true;
+}
+
+// Compare `l` and `r`, ignoring ASCII case, by the lowercased bytes. Since
+// strings that differ only in case are equivalent but not equal, this is a
+// weak ordering.
+[[nodiscard]] inline std::weak_ordering
+icompare(std::string_view l, std::string_view r) {
+  const auto common = std::min(l.size(), r.size());
+  for (size_t pos = 0; pos < common; pos += 8) {
+    const auto len = common - pos;
+    const auto lw = details::load_lower(l.data() + pos, len);
+    const auto rw = details::load_lower(r.data() + pos, len);
+    if (lw == rw) continue;
+    // The first differing byte in memory order decides.
+    const auto diff = lw ^ rw;
+    const auto shift = std::endian::native == std::endian::little
+                           ? std::countr_zero(diff) & ~7
+                           : 56 - (std::countl_zero(diff) & ~7);
+    return static_cast<uint8_t>(lw >> shift) <=>
+           static_cast<uint8_t>(rw >> shift);
+  }
+  return l.size() <=> r.size();
+}
+
+// Hash of `sv` that ignores ASCII case, so `iequal` strings hash alike.
+//
+// Mixes in a lowercased word at a time. This is not the same value as
+// `std::hash`.
+[[nodiscard]] inline size_t ihash(std::string_view sv) noexcept {
+  constexpr uint64_t k = 0x9E3779B97F4A7C15;
+  uint64_t h = sv.size() * k;
+  for (size_t pos = 0; pos < sv.size(); pos += 8) {
+    const auto word = details::load_lower(sv.data() + pos, sv.size() - pos);
+    h = (std::rotl(h, 23) ^ word) * k;
+  }
+  return static_cast<size_t>(h ^ (h >> 32));
+}
+
+// Whether `whole` starts with `part`, ignoring ASCII case.
+[[nodiscard]] inline bool
+istarts_with(std::string_view whole, std::string_view part) {
+  return whole.size() >= part.size() &&
+         iequal(whole.substr(0, part.size()), part);
+}
+
+// Locate `part` in `whole`, starting at `pos`, ignoring ASCII case. Returns
+// the position, or `npos` if not found.
+[[nodiscard]] inline size_t
+ilocate(std::string_view whole, std::string_view part, size_t pos = 0) {
+  if (part.size() > whole.size()) return std::string_view::npos;
+  if (part.empty()) return pos <= whole.size() ? pos : std::string_view::npos;
+  const char lower = to_lower(part.front());
+  const char upper = to_upper(part.front());
+  const auto rest = part.substr(1);
+  const auto last = whole.size() - part.size();
+  for (; pos <= last; ++pos) {
+    // Skip ahead to the next candidate for the first character.
+    const auto p = whole.data() + pos;
+    const auto len = last - pos + 1;
+    auto lp = static_cast<const char*>(std::memchr(p, lower, len));
+    if (lower != upper) {
+      auto up = static_cast<const char*>(std::memchr(p, upper,
+          lp ? static_cast<size_t>(lp - p) : len));
+      if (up) lp = up;
+    }
+    if (!lp) break;
+    pos = lp - whole.data();
+    if (iequal(whole.substr(pos + 1, rest.size()), rest)) return pos;
+  }
+  return std::string_view::npos;
 }
 
 }} // namespace corvid::strings::cases
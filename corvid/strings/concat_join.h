@@ -18,6 +18,9 @@
 #include "lite.h"
 #include "../enums.h"
 
+#include <cstring>
+#include <span>
+
 // Recommendation: While you can import the entire `corvid::strings` namespace,
 // you may not want to bring in all of these symbols, or you may wish to do so
 // more selectively.
@@ -279,52 +282,196 @@ constexpr auto& append(A& target, const T& part) {
   return target;
 }
 
+namespace details {
+// Size of one part, as appended, adding to `pieces` once for it and once for
+// each element or member inside it. See `appended_size`.
+template<typename T>
+[[nodiscard]] constexpr size_t measured_size(const T& part, size_t& pieces) {
+  constexpr size_t null_size = 4;
+  ++pieces;
+  if constexpr (AppendableOverridden<T> || StreamAppendable<T>)
+    return 0;
+  else if constexpr (StringViewConvertible<T>)
+    return is_present(part) ? std::string_view{part}.size() : null_size;
+  else if constexpr (NullPtr<T> || MonoState<T>)
+    return null_size;
+  else if constexpr (Char<T>)
+    return 1;
+  else if constexpr (Bool<T>)
+    return 5;
+  else if constexpr (std::integral<T>)
+    return std::numeric_limits<T>::digits10 + 2;
+  else if constexpr (std::floating_point<T>)
+    return std::numeric_limits<T>::max_digits10 + 8;
+  else if constexpr (VoidPointer<T>)
+    return sizeof(uintptr_t) * 2;
+  else if constexpr (OptionalLike<T>)
+    return part ? measured_size(*part, pieces) : null_size;
+  else if constexpr (ScopedEnum<T>) {
+    std::string name;
+    return append_enum(name, part).size();
+  } else if constexpr (StdEnum<T>)
+    return measured_size(as_underlying(part), pieces);
+  else if constexpr (Variant<T>) {
+    if (part.valueless_by_exception()) return null_size;
+    return std::visit(
+        [&pieces](const auto& inside) {
+          return measured_size(inside, pieces);
+        },
+        part);
+  } else if constexpr (Container<T>) {
+    size_t size{};
+    for (const auto& element : part)
+      size += measured_size(element_value<extract_field::key_value>(element),
+          pieces);
+    return size;
+  } else if constexpr (TupleLike<T>)
+    return std::apply(
+        [&pieces](const auto&... parts) {
+          return (size_t{} + ... + measured_size(parts, pieces));
+        },
+        part);
+  else
+    return 0;
+}
+} // namespace details
+
+// Estimate the size of appending the pieces, so that the target can be
+// reserved once, up front.
+//
+// For strings, characters, and enums, this is exact. For numbers and
+// pointers, it's the largest size for their type, so it's an upper bound.
+// For containers, including keyed ones, it covers all of the keys and values,
+// and so on, recursively. Registered and streamed types count as nothing,
+// since the only way to find out would be to append them.
+[[nodiscard]] constexpr size_t appended_size(const auto&... parts) {
+  size_t pieces{};
+  return (size_t{} + ... + details::measured_size(parts, pieces));
+}
+
+// Estimate the size of appending the pieces with `append_join_with`, using
+// delimiter `d`.
+//
+// In addition to `appended_size`, this allows for a delimiter, a pair of
+// braces, and a pair of quotes for each piece, including each element or
+// member of a container. This is usually an overestimate, but escaping
+// quoted strings may add more.
+[[nodiscard]] constexpr size_t joined_size(delim d, const auto&... parts) {
+  size_t pieces{};
+  const size_t size =
+      (size_t{} + ... + details::measured_size(parts, pieces));
+  return size + pieces * (d.size() + 4);
+}
+
+namespace details {
+// Stream buffer over a fixed span, which fails on overflow.
+class span_streambuf: public std::streambuf {
+public:
+  explicit span_streambuf(std::span<char> buffer) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+  }
+
+  [[nodiscard]] size_t written() const noexcept { return pptr() - pbase(); }
+};
+
+// Output stream over a fixed span, which goes bad on overflow.
+class span_ostream: private span_streambuf, public std::ostream {
+public:
+  explicit span_ostream(std::span<char> buffer)
+      : span_streambuf{buffer}, std::ostream{this} {}
+
+  using span_streambuf::written;
+};
+} // namespace details
+
 // Concatenate pieces together into `std::string` without delimiters. See
 // `join` and `join_with` for delimiter support.
+//
+// Reserves `appended_size` up front, so that building it doesn't reallocate.
 [[nodiscard]] constexpr auto concat(const auto& head, const auto&... tail) {
   std::string target;
-  return append(target, head, tail...);
+  target.reserve(appended_size(head, tail...));
+  append(target, head, tail...);
+  return target;
+}
+
+// Concatenate pieces together into `buffer`, without allocating. Returns a
+// view of the result, or null if it didn't fit.
+[[nodiscard]] inline opt_string_view
+concat_into(std::span<char> buffer, const auto& head, const auto&... tail) {
+  details::span_ostream os{buffer};
+  append(os, head, tail...);
+  if (!os) return {};
+  return std::string_view{buffer.data(), os.written()};
 }
 
 // Determine if `c` needs to be escaped for JSON.
-[[nodiscard]] inline bool needs_escaping(char c) noexcept {
-  return (c == '"' || c == '\\' || c == '/' || c < 32);
+//
+// Bytes outside of ASCII are passed through, so UTF-8 remains intact.
+[[nodiscard]] constexpr bool needs_escaping(char c) noexcept {
+  return (c == '"' || c == '\\' || c == '/' ||
+          static_cast<unsigned char>(c) < 32);
 }
 
+namespace details {
+// Length of the run at the start of `s` that doesn't need escaping for JSON.
+//
+// Checks eight bytes at a time, using the usual bit tricks to test for a
+// zero byte in a word. A hit just ends the fast loop, so the last few bytes
+// are checked one at a time, which also makes it exact.
+[[nodiscard]] inline size_t unescaped_run(std::string_view s) noexcept {
+  constexpr uint64_t ones = 0x0101010101010101;
+  constexpr uint64_t highs = ones * 0x80;
+  constexpr auto has_byte = [](uint64_t word, char ch) {
+    const auto x = word ^ (ones * static_cast<unsigned char>(ch));
+    return (x - ones) & ~x & highs;
+  };
+  size_t pos{};
+  for (; pos + 8 <= s.size(); pos += 8) {
+    uint64_t word;
+    std::memcpy(&word, s.data() + pos, sizeof(word));
+    const auto controls = (word - ones * 32) & ~word & highs;
+    if (controls | has_byte(word, '"') | has_byte(word, '\\') |
+        has_byte(word, '/'))
+      break;
+  }
+  while (pos < s.size() && !needs_escaping(s[pos])) ++pos;
+  return pos;
+}
+} // namespace details
+
 // Determine if `s` needs to be escaped for JSON.
 [[nodiscard]] inline bool needs_escaping(std::string_view s) noexcept {
-  for (auto c : s)
-    if (needs_escaping(c)) return true;
-  return false;
+  return details::unescaped_run(s) != s.size();
 }
 
 // Append one string to `target`, escaping as needed for JSON.
+//
+// Runs of characters that don't need escaping are appended in bulk.
 inline auto& append_escaped(AppendTarget auto& target, std::string_view part) {
-  if (!needs_escaping(part)) return append(target, part);
-
   auto a = appender{target};
-  for (auto c : part) {
-    if (!needs_escaping(c))
-      a.append(c);
-    else {
-      a.append('\\');
-      switch (c) {
-      case '"': [[fallthrough]];
-      case '\\': [[fallthrough]];
-      case '/': a.append(c); break;
-      case '\b': a.append('b'); break;
-      case '\f': a.append('f'); break;
-      case '\n': a.append('n'); break;
-      case '\r': a.append('r'); break;
-      case '\t': a.append('t'); break;
-      default:
-        a.append('u');
-        append<16, 4, '0'>(target, static_cast<uint16_t>(c));
-        break;
-      }
+  for (;;) {
+    const auto run = details::unescaped_run(part);
+    if (run) a.append(part.substr(0, run));
+    if (run == part.size()) break;
+    const char c = part[run];
+    part.remove_prefix(run + 1);
+    a.append('\\');
+    switch (c) {
+    case '"': [[fallthrough]];
+    case '\\': [[fallthrough]];
+    case '/': a.append(c); break;
+    case '\b': a.append('b'); break;
+    case '\f': a.append('f'); break;
+    case '\n': a.append('n'); break;
+    case '\r': a.append('r'); break;
+    case '\t': a.append('t'); break;
+    default:
+      a.append('u');
+      append<16, 4, '0'>(target, static_cast<uint16_t>(c));
+      break;
     }
   }
-
   return target;
 }
 
@@ -553,8 +700,10 @@ append_join_with(AppendTarget auto& target, delim d, const T& part) {
   constexpr auto next_opt = is_json ? head_opt : decode::next_opt_v<opt>;
   constexpr char next_open = open ? open : (is_json ? 0 : '{');
   constexpr char next_close = close ? close : (is_json ? 0 : '}');
+  // Enums are already quoted as JSON strings.
+  using key_t = std::remove_cvref_t<decltype(part.first)>;
   constexpr bool add_quotes =
-      is_json && !StringViewConvertible<decltype(part.first)>;
+      is_json && !StringViewConvertible<key_t> && !StdEnum<key_t>;
   // TODO: Should we add !Container and so on?
   // TODO: What if the key is null?
 
@@ -617,7 +766,7 @@ append_join_with(AppendTarget auto& target, delim d, const T& parts) {
   constexpr auto head_opt = decode::head_opt_v<opt>;
   constexpr auto next_opt = decode::next_opt_v<opt>;
   constexpr bool is_keyed =
-      decode::keyed_v<opt> && StdPair<decltype(*cbegin(parts))>;
+      decode::keyed_v<opt> && StdPair<decltype(*std::cbegin(parts))>;
   constexpr auto field =
       is_keyed ? extract_field::key_value : extract_field::value;
   constexpr bool is_obj = is_keyed && decode::json_v<opt>;
@@ -685,23 +834,28 @@ append_join(AppendTarget auto& target, const auto& head, const auto&... tail) {
 }
 
 // Join pieces together, with `delim`, into `std::string`.
+//
+// Reserves `joined_size` up front, as do `join` and `join_json`.
 template<auto opt = join_opt::braced, char open = 0, char close = 0>
 [[nodiscard]] constexpr auto
 join_with(delim d, const auto& head, const auto&... tail) {
   std::string target;
-  return append_join_with<opt, open, close>(target, d, head, tail...);
+  target.reserve(joined_size(d, head, tail...));
+  append_join_with<opt, open, close>(target, d, head, tail...);
+  return target;
 }
 
 // Join pieces together, comma-delimited, into `std::string`.
 template<auto opt = join_opt::braced, char open = 0, char close = 0>
 [[nodiscard]] constexpr auto join(const auto& head, const auto&... tail) {
   std::string target;
-  return append_join_with<opt, open, close>(target, delim{", "sv}, head,
-      tail...);
+  target.reserve(joined_size(delim{", "sv}, head, tail...));
+  append_join_with<opt, open, close>(target, delim{", "sv}, head, tail...);
+  return target;
 }
 
 // Append pieces to target as JSON.
-constexpr auto
+constexpr auto&
 append_json(AppendTarget auto& target, const auto& head, const auto&... tail) {
   return append_join_with<join_opt::json>(target, delim{", "sv}, head,
       tail...);
@@ -710,8 +864,9 @@ append_json(AppendTarget auto& target, const auto& head, const auto&... tail) {
 // Join pieces together into `std::string` as JSON.
 [[nodiscard]] constexpr auto join_json(const auto& head, const auto&... tail) {
   std::string target;
-  return append_join_with<join_opt::json>(target, delim{", "sv}, head,
-      tail...);
+  target.reserve(joined_size(delim{", "sv}, head, tail...));
+  append_join_with<join_opt::json>(target, delim{", "sv}, head, tail...);
+  return target;
 }
 
 } // namespace joining
@@ -721,10 +876,6 @@ append_json(AppendTarget auto& target, const auto& head, const auto&... tail) {
 // TODO
 //
 
-// TODO: Add method that takes pieces and counts up their total (estimated)
-// size, for the purpose of reserving target capacity. Possibly add this an a
-// `join_opt` for use in `concat` and `join`.
-
 // TODO: Benchmark delim `find` single-char optimizations, to make sure they're
 // faster.
 
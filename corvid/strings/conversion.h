@@ -17,6 +17,11 @@
 #pragma once
 #include "strings_shared.h"
 #include "trimming.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <span>
 #include "../enums/enum_registry.h"
 
 namespace corvid::strings { inline namespace conversion {
@@ -145,10 +150,129 @@ constexpr T parse_num(std::string_view sv, std::integral auto default_value) {
   return (extract_num<base>(t, sv) && sv.empty()) ? t : default_value;
 }
 
+namespace details {
+// Two-digit strings for 00 through 99, so that formatting emits two digits
+// per division.
+inline constexpr auto digit_pairs = [] {
+  std::array<char, 200> pairs{};
+  for (size_t i = 0; i < 100; ++i) {
+    pairs[i * 2] = static_cast<char>('0' + i / 10);
+    pairs[i * 2 + 1] = static_cast<char>('0' + i % 10);
+  }
+  return pairs;
+}();
+
+// Number of decimal digits in `v`, without a loop.
+//
+// The bit width, times log10(2), is either the digit count or one short of
+// it, so one comparison against a power of ten settles it. Since `v | 1` has
+// the same number of digits as `v`, zero needs no special case.
+[[nodiscard]] constexpr size_t count_digits(uint64_t v) noexcept {
+  constexpr auto powers = [] {
+    std::array<uint64_t, 20> p{1};
+    for (size_t i = 1; i < p.size(); ++i) p[i] = p[i - 1] * 10;
+    return p;
+  }();
+  v |= 1;
+  const size_t t = (std::bit_width(v) * 1233) >> 12;
+  return t + (v >= powers[t]);
+}
+
+// Write the digits of `v` so that they end at `end`. There must be room for
+// `count_digits(v)` before it.
+constexpr void write_digits(char* end, uint64_t v) noexcept {
+  while (v >= 100) {
+    const auto pair = (v % 100) * 2;
+    v /= 100;
+    *--end = digit_pairs[pair + 1];
+    *--end = digit_pairs[pair];
+  }
+  if (v >= 10) {
+    *--end = digit_pairs[v * 2 + 1];
+    *--end = digit_pairs[v * 2];
+  } else {
+    *--end = static_cast<char>('0' + v);
+  }
+}
+
+// Whether `T` can be formatted by `append_decimal`.
+template<typename T>
+concept FastDecimal = Integer<T> && (sizeof(T) <= sizeof(uint64_t));
+
+// Number to format in base 10, split into sign and magnitude, along with its
+// unpadded length.
+struct decimal_parts {
+  uint64_t mag;
+  size_t len;
+  bool neg;
+};
+
+template<FastDecimal T>
+[[nodiscard]] constexpr decimal_parts to_decimal_parts(T num) noexcept {
+  const bool neg = num < 0;
+  const auto mag =
+      neg ? 0 - static_cast<uint64_t>(num) : static_cast<uint64_t>(num);
+  return {mag, count_digits(mag) + neg, neg};
+}
+
+// Write `parts` into `out`, left-padding with `pad` to `size`, which can't be
+// less than `parts.len`.
+constexpr void
+write_decimal(char* out, const decimal_parts& parts, size_t size, char pad) {
+  for (size_t i = parts.len; i < size; ++i) *out++ = pad;
+  if (parts.neg) *out = '-';
+  write_digits(out + parts.len, parts.mag);
+}
+
+// Grow `target` by `size` and call `write` on the new space.
+//
+// Uses `resize_and_overwrite`, when available, to avoid filling the space
+// first.
+constexpr void overwrite_tail(std::string& target, size_t size,
+    const auto& write) {
+  const auto old_size = target.size();
+#ifdef __cpp_lib_string_resize_and_overwrite
+  target.resize_and_overwrite(old_size + size, [&](char* p, size_t) {
+    write(p + old_size);
+    return old_size + size;
+  });
+#else
+  target.resize(old_size + size);
+  write(target.data() + old_size);
+#endif
+}
+
+// Append `num` in base 10 to `target`.
+//
+// Digits are produced two at a time from a lookup table and, for strings,
+// are written directly into the target's new space.
+template<size_t width, char pad, FastDecimal T>
+constexpr auto& append_decimal(AppendTarget auto& target, T num) {
+  const auto parts = to_decimal_parts(num);
+  size_t size = parts.len;
+  if constexpr (width && pad) size = std::max(size, width);
+  if constexpr (StdString<decltype(target)>) {
+    overwrite_tail(target, size,
+        [&](char* out) { write_decimal(out, parts, size, pad); });
+  } else {
+    auto a = appender{target};
+    std::array<char, 24> b;
+    if (parts.len < size) a.append(size - parts.len, pad);
+    write_decimal(b.data(), parts, parts.len, pad);
+    a.append(b.data(), parts.len);
+  }
+  return target;
+}
+} // namespace details
+
 // Append integral number to `target`. Hex is prefixed with "0x" and
 // zero-padded to an appropriate size. Returns `target`.
+//
+// Base 10 uses a faster formatter than `std::to_chars`.
 template<int base = 10, size_t width = 0, char pad = ' '>
 constexpr auto& append_num(AppendTarget auto& target, Integer auto num) {
+  if constexpr (base == 10 && details::FastDecimal<decltype(num)>)
+    return details::append_decimal<width, pad>(target, num);
   auto a = appender{target};
   std::array<char, 64> b;
   auto [ptr, ec] = std::to_chars(b.data(), b.data() + b.size(), num, base);
@@ -169,6 +293,40 @@ constexpr auto& append_num(AppendTarget auto& target, Integer auto num) {
   return *a.append(b.data(), len);
 }
 
+// Append the integers in `nums` to `target` in base 10, separated by `d`.
+// Returns `target`.
+//
+// For strings, sizes them all first, so the target grows only once.
+template<std::ranges::forward_range R>
+requires details::FastDecimal<std::ranges::range_value_t<R>>
+constexpr auto&
+append_nums(AppendTarget auto& target, const R& nums, delim d) {
+  if constexpr (StdString<decltype(target)>) {
+    size_t size{};
+    size_t count{};
+    for (const auto num : nums) {
+      size += details::to_decimal_parts(num).len;
+      ++count;
+    }
+    if (count) size += (count - 1) * d.size();
+    details::overwrite_tail(target, size, [&](char* out) {
+      bool first = true;
+      for (const auto num : nums) {
+        if (!first) out = std::ranges::copy(d, out).out;
+        first = false;
+        const auto parts = details::to_decimal_parts(num);
+        details::write_decimal(out, parts, parts.len, ' ');
+        out += parts.len;
+      }
+    });
+  } else {
+    bool first = true;
+    for (const auto num : nums)
+      append_num(d.append_skip_first(target, first), num);
+  }
+  return target;
+}
+
 // Append bool, as number, to `target`.  Returns `target`.
 template<int base = 10, size_t width = 0, char pad = ' '>
 constexpr auto& append_num(AppendTarget auto& target, Bool auto num) {
@@ -283,6 +441,225 @@ constexpr std::string num_as_string(std::floating_point auto num) {
 
 } // namespace cvt_float
 
+inline namespace cvt_bulk {
+
+// Bulk parsing.
+
+namespace details {
+// Whether the eight bytes in `word` are all ASCII digits.
+[[nodiscard]] constexpr bool all_digits(uint64_t word) noexcept {
+  constexpr uint64_t ones = 0x0101010101010101;
+  return ((word & (ones * 0xF0)) |
+             (((word + ones * 0x06) & (ones * 0xF0)) >> 4)) ==
+         ones * 0x33;
+}
+
+// Value of the eight ASCII digits in `word`, loaded little-endian, so the
+// first digit is in the low byte. Combines pairs, then quads, then both
+// halves, in three multiplies.
+[[nodiscard]] constexpr uint64_t eight_digits(uint64_t word) noexcept {
+  constexpr uint64_t mask = 0x000000FF000000FF;
+  constexpr uint64_t mul1 = 100 + (1000000ull << 32);
+  constexpr uint64_t mul2 = 1 + (10000ull << 32);
+  word -= 0x3030303030303030;
+  word = (word * 10) + (word >> 8);
+  return (((word & mask) * mul1) + (((word >> 16) & mask) * mul2)) >> 32;
+}
+
+// Parse the run of digits at `pos` in `s`, of which there must be at most
+// 19, so that the value fits. Digits are taken eight at a time, when
+// possible.
+[[nodiscard]] constexpr uint64_t
+parse_digits(std::string_view s, size_t pos, size_t end) noexcept {
+  uint64_t value{};
+  if (!std::is_constant_evaluated() &&
+      std::endian::native == std::endian::little)
+  {
+    for (; end - pos >= 8; pos += 8) {
+      uint64_t word;
+      std::memcpy(&word, s.data() + pos, sizeof(word));
+      value = value * 100000000 + eight_digits(word);
+    }
+  }
+  for (; pos < end; ++pos) value = value * 10 + (s[pos] - '0');
+  return value;
+}
+
+// End of the run of spaces starting at `pos`.
+[[nodiscard]] constexpr size_t
+skip_spaces(std::string_view s, size_t pos) noexcept {
+  while (pos < s.size() && s[pos] == ' ') ++pos;
+  return pos;
+}
+
+// End of the run of digits starting at `pos`.
+[[nodiscard]] constexpr size_t
+skip_digits(std::string_view s, size_t pos) noexcept {
+  if (!std::is_constant_evaluated() &&
+      std::endian::native == std::endian::little)
+  {
+    for (; s.size() - pos >= 8; pos += 8) {
+      uint64_t word;
+      std::memcpy(&word, s.data() + pos, sizeof(word));
+      if (!all_digits(word)) break;
+    }
+  }
+  while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') ++pos;
+  return pos;
+}
+
+// Parse an integer at `pos`, setting `t` and returning the position after
+// it, or `npos` on failure. Accepts the same input as `std::from_chars`.
+template<Integer T>
+[[nodiscard]] constexpr size_t
+parse_one(T& t, std::string_view s, size_t pos) noexcept {
+  const bool neg = pos < s.size() && s[pos] == '-';
+  const auto start = pos + neg;
+  const auto end = skip_digits(s, start);
+  if (end == start || end - start > 19 || (neg && !std::is_signed_v<T>)) {
+    auto [ptr, ec] = std::from_chars(s.data() + pos, s.data() + s.size(), t);
+    return ec == std::errc{} ? ptr - s.data() : std::string_view::npos;
+  }
+  const auto mag = parse_digits(s, start, end);
+  using U = std::make_unsigned_t<T>;
+  const auto limit = static_cast<uint64_t>(std::numeric_limits<T>::max()) +
+                     (neg ? 1 : 0);
+  if (mag > limit) return std::string_view::npos;
+  t = static_cast<T>(neg ? static_cast<U>(0 - mag) : static_cast<U>(mag));
+  return end;
+}
+
+// Parse a floating-point number at `pos`, setting `t` and returning the
+// position after it, or `npos` on failure.
+//
+// When the decimal mantissa fits in the significand of `T` and the power of
+// ten is one that `T` holds exactly, the result is a single correctly-rounded
+// multiply or divide. Anything else, such as long mantissas, big exponents,
+// and "inf", goes to `std_from_chars`.
+template<std::floating_point T>
+[[nodiscard]] constexpr size_t
+parse_one(T& t, std::string_view s, size_t pos) noexcept {
+  constexpr int max_exact_pow10 = std::is_same_v<T, float>    ? 10
+                                  : std::is_same_v<T, double> ? 22
+                                                              : -1;
+  constexpr auto powers = [] {
+    std::array<T, 23> p{1};
+    for (size_t i = 1; i < p.size(); ++i) p[i] = p[i - 1] * 10;
+    return p;
+  }();
+  const auto fallback = [&] {
+    auto [ptr, ec] = std_from_chars(s.data() + pos, s.data() + s.size(), t);
+    return ec == std::errc{} ? static_cast<size_t>(ptr - s.data())
+                             : std::string_view::npos;
+  };
+  if constexpr (max_exact_pow10 < 0) return fallback();
+  const bool neg = pos < s.size() && s[pos] == '-';
+  const auto int_start = pos + neg;
+  const auto int_end = skip_digits(s, int_start);
+  const bool has_point = int_end < s.size() && s[int_end] == '.';
+  const auto frac_start = int_end + has_point;
+  const auto frac_end = has_point ? skip_digits(s, frac_start) : frac_start;
+  const auto digits = (int_end - int_start) + (frac_end - frac_start);
+  if (!digits || digits > 19) return fallback();
+  auto end = frac_end;
+  int exp10 = 0;
+  if (end < s.size() && (s[end] == 'e' || s[end] == 'E')) {
+    auto exp_start = end + 1;
+    if (exp_start < s.size() && s[exp_start] == '+') ++exp_start;
+    if (exp_start < s.size() && s[exp_start] == '-' && exp_start != end + 1)
+      return fallback();
+    auto [ptr, ec] = std::from_chars(s.data() + exp_start,
+        s.data() + s.size(), exp10);
+    if (ec != std::errc{}) return fallback();
+    end = ptr - s.data();
+  }
+  auto mantissa = parse_digits(s, int_start, int_end);
+  for (auto i = frac_start; i < frac_end; ++i)
+    mantissa = mantissa * 10 + (s[i] - '0');
+  exp10 -= static_cast<int>(frac_end - frac_start);
+  if (mantissa > (uint64_t{1} << std::numeric_limits<T>::digits) ||
+      exp10 < -max_exact_pow10 || exp10 > max_exact_pow10)
+    return fallback();
+  auto value = static_cast<T>(mantissa);
+  value = exp10 < 0 ? value / powers[-exp10] : value * powers[exp10];
+  t = neg ? -value : value;
+  return end;
+}
+} // namespace details
+
+// Outcome of `parse_nums`.
+struct parsed_nums {
+  // Number of values parsed.
+  size_t count{};
+  // Offset of the first value that failed to parse or didn't fit, or `npos`
+  // if the whole input was parsed.
+  size_t error_pos{std::string_view::npos};
+
+  [[nodiscard]] constexpr explicit operator bool() const noexcept {
+    return error_pos == std::string_view::npos;
+  }
+};
+
+// Parse the numbers in `sv`, separated by any of the characters in `d`, into
+// `out`. Spaces around each number are skipped, and an empty input has no
+// numbers.
+//
+// This is much faster than calling `extract_num` in a loop. Integers are
+// converted eight digits at a time, and most decimal floats take a fast path
+// instead of `std::from_chars`.
+//
+// Stops when `out` is full. Returns the count parsed and, on failure or if
+// `out` is full, the offset in `sv` where it stopped.
+template<typename T, size_t E>
+requires Integer<T> || std::floating_point<T>
+constexpr parsed_nums
+parse_nums(std::span<T, E> out, std::string_view sv, delim d = {","}) {
+  parsed_nums result;
+  auto pos = details::skip_spaces(sv, 0);
+  if (pos == sv.size()) return result;
+  for (;;) {
+    pos = details::skip_spaces(sv, pos);
+    if (result.count == out.size()) {
+      result.error_pos = pos;
+      return result;
+    }
+    const auto end = details::parse_one(out[result.count], sv, pos);
+    if (end == sv.npos) {
+      result.error_pos = pos;
+      return result;
+    }
+    ++result.count;
+    const auto next = details::skip_spaces(sv, end);
+    if (next == sv.size()) return result;
+    if (end < sv.size() && d.is_delim(sv[end]))
+      pos = end + 1;
+    else if (d.is_delim(sv[next]))
+      pos = next + 1;
+    else {
+      result.error_pos = next;
+      return result;
+    }
+  }
+}
+
+// Parse the numbers in `sv`, separated by any of the characters in `d`,
+// appending them to `out`. See above for details.
+template<typename T>
+requires Integer<T> || std::floating_point<T>
+constexpr parsed_nums
+parse_nums(std::vector<T>& out, std::string_view sv, delim d = {","}) {
+  const auto old_size = out.size();
+  // Every number but the last is followed by a delimiter.
+  out.resize(old_size + std::ranges::count_if(sv,
+                            [&d](char c) { return d.is_delim(c); }) +
+             1);
+  const auto result = parse_nums(std::span{out}.subspan(old_size), sv, d);
+  out.resize(old_size + result.count);
+  return result;
+}
+
+} // namespace cvt_bulk
+
 inline namespace cvt_enum {
 
 // From enum.
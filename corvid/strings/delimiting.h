@@ -18,8 +18,32 @@
 #include "strings_shared.h"
 #include "targeting.h"
 
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
 namespace corvid::strings { inline namespace delimiting {
 
+namespace details {
+inline constexpr uint64_t delim_ones = 0x0101010101010101;
+inline constexpr uint64_t delim_highs = delim_ones * 0x80;
+
+// High bit of each byte of `x` that's zero. Unlike the usual quick test, this
+// one is exact for every byte, not just the first zero, because the carry
+// can't spread when the high bits are masked off before adding.
+[[nodiscard]] constexpr uint64_t zero_bytes(uint64_t x) noexcept {
+  constexpr uint64_t low7 = delim_ones * 0x7F;
+  return ~(((x & low7) + low7) | x) & delim_highs;
+}
+
+[[nodiscard]] inline uint64_t load_word(const char* p) noexcept {
+  uint64_t word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+} // namespace details
+
 //
 // Delimiter
 //
@@ -34,27 +58,98 @@ namespace corvid::strings { inline namespace delimiting {
 // - When splitting, checks for any of the characters.
 // - When joining, appends the entire string.
 // - When manipulating braces, treated as an open/close pair.
+//
+// On construction, the characters are also set in a 256-bit map, so that
+// finding any of several of them costs a table lookup per character, instead
+// of a loop over them. When the delimiter is a literal, the map is built at
+// compile time.
+//
+// Delimiters of up to `max_swar_size` characters, which covers whitespace,
+// are instead matched eight bytes at a time, by SWAR on a 64-bit word, except
+// when evaluated at compile time.
 struct delim: public std::string_view {
+  static constexpr size_t max_swar_size = 4;
+
   constexpr delim() : delim(" "sv) {}
 
   // TODO: Construct from initializer list of char.
 
   template<typename T>
-  constexpr delim(T&& list) : std::string_view(std::forward<T>(list)) {}
+  constexpr delim(T&& list) : std::string_view(std::forward<T>(list)) {
+    for (const auto ch : *this) set(ch);
+  }
+
+  // Whether `ch` is one of the delimiter characters.
+  [[nodiscard]] constexpr bool is_delim(char ch) const noexcept {
+    const auto uch = static_cast<unsigned char>(ch);
+    return (map_[uch / 64] >> (uch % 64)) & 1;
+  }
+
+  // High bit of each byte of `word` that's one of the delimiter characters,
+  // for SWAR. The bytes are in memory order, so the first is the lowest.
+  [[nodiscard]] constexpr uint64_t match_word(uint64_t word) const noexcept {
+    uint64_t matches{};
+    if (size() <= max_swar_size) {
+      for (const auto ch : *this)
+        matches |= details::zero_bytes(
+            word ^ (details::delim_ones * static_cast<unsigned char>(ch)));
+    } else {
+      for (size_t i = 0; i < 8; ++i)
+        if (is_delim(static_cast<char>(word >> (i * 8))))
+          matches |= uint64_t{0x80} << (i * 8);
+    }
+    return matches;
+  }
+
+  // Whether to use `match_word`.
+  [[nodiscard]] constexpr bool use_swar() const noexcept {
+    return std::endian::native == std::endian::little &&
+           size() <= max_swar_size;
+  }
 
   [[nodiscard]] constexpr auto find_in(std::string_view whole) const {
     if (size() == 1) return whole.find(front());
-    return whole.find_first_of(*this);
+    size_t pos = 0;
+    if !consteval {
+      if (use_swar())
+        for (; pos + 8 <= whole.size(); pos += 8)
+          if (const auto m =
+                  match_word(details::load_word(whole.data() + pos)))
+            return pos + std::countr_zero(m) / 8;
+    }
+    for (; pos < whole.size(); ++pos)
+      if (is_delim(whole[pos])) return pos;
+    return npos;
   }
 
   [[nodiscard]] constexpr auto find_not_in(std::string_view whole) const {
-    if (size() == 1) return whole.find_first_not_of(front());
-    return whole.find_first_not_of(*this);
+    size_t pos = 0;
+    if !consteval {
+      if (use_swar())
+        for (; pos + 8 <= whole.size(); pos += 8)
+          if (const auto m =
+                  ~match_word(details::load_word(whole.data() + pos)) &
+                  details::delim_highs)
+            return pos + std::countr_zero(m) / 8;
+    }
+    for (; pos < whole.size(); ++pos)
+      if (!is_delim(whole[pos])) return pos;
+    return npos;
   }
 
   [[nodiscard]] constexpr auto find_last_not_in(std::string_view whole) const {
-    if (size() == 1) return whole.find_last_not_of(front());
-    return whole.find_last_not_of(*this);
+    size_t end = whole.size();
+    if !consteval {
+      if (use_swar())
+        for (; end >= 8; end -= 8)
+          if (const auto m =
+                  ~match_word(details::load_word(whole.data() + end - 8)) &
+                  details::delim_highs)
+            return end - 8 + (63 - std::countl_zero(m)) / 8;
+    }
+    while (end-- > 0)
+      if (!is_delim(whole[end])) return end;
+    return npos;
   }
 
   // Append.
@@ -83,6 +178,14 @@ struct delim: public std::string_view {
     if constexpr (emit) append(target);
     return target;
   }
+
+private:
+  std::array<uint64_t, 4> map_{};
+
+  constexpr void set(char ch) noexcept {
+    const auto uch = static_cast<unsigned char>(ch);
+    map_[uch / 64] |= uint64_t{1} << (uch % 64);
+  }
 };
 
 }} // namespace corvid::strings::delimiting
@@ -0,0 +1,271 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "strings_shared.h"
+#include "fixed_string.h"
+#include "concat_join.h"
+
+#include <array>
+#include <charconv>
+#include <tuple>
+#include <utility>
+
+namespace corvid::strings { inline namespace formatting {
+
+//
+// Format
+//
+
+// The `format` and `append_format` functions take a format string as a
+// `fixed_string` template parameter, much like `std::format`, but parse it
+// entirely at compile time. What's left at runtime is a fixed sequence of
+// literal copies and calls to `append` or `append_num`, along with a single
+// reservation.
+//
+// The format string is literal text, with "{{" and "}}" for braces, and
+// replacement fields of the form "{[index][:spec]}". Without an index, fields
+// take the arguments in order. An empty spec appends the argument just as
+// `append` would, so any appendable type works, including enums, containers,
+// and registered types.
+//
+// For numbers, the spec is "[0][width][.precision][type]", where a leading
+// '0' pads to `width` with zeroes instead of spaces, and `type` is one of:
+// - 'd', 'x', 'o', 'b': Integer, in base 10, 16, 8, or 2.
+// - 'f', 'e', 'g', 'a': Floating-point, as fixed, scientific, general, or
+//   hex.
+//
+// Unlike `append_num`, hex is never prefixed with "0x". Errors in the format
+// string, or a mismatch with the number of arguments, fail to compile.
+//
+// For example:
+//
+//   auto s = strings::format<"user={} id={:08x}">(name, id);
+
+namespace details {
+// Field spec, as parsed from the format string.
+struct format_spec {
+  int base{10};
+  size_t width{};
+  char pad{' '};
+  int precision{-1};
+  std::chars_format fmt{std::chars_format::general};
+  bool is_float{};
+
+  [[nodiscard]] constexpr bool is_plain() const noexcept {
+    return base == 10 && !width && precision == -1 && !is_float;
+  }
+};
+
+// Segment of a parsed format string, which is either a literal or a field.
+struct format_segment {
+  // For a literal, its location in the format string.
+  size_t begin{};
+  size_t size{};
+  // For a field, which argument it takes, or `npos` for a literal.
+  size_t arg{npos};
+  format_spec spec{};
+};
+
+// Reject a malformed format string. Since this isn't a constant expression,
+// calling it at compile time fails to compile.
+inline void format_error(const char*) {}
+
+// Parse the format string, calling `on_literal(begin, size)` and
+// `on_field(arg, spec)` for each segment.
+template<typename L, typename F>
+constexpr void
+parse_format(std::string_view fmt, const L& on_literal, const F& on_field) {
+  size_t next_arg{};
+  size_t begin{};
+  for (size_t pos = 0; pos < fmt.size(); ++pos) {
+    const auto ch = fmt[pos];
+    if (ch == '}') {
+      if (pos + 1 >= fmt.size() || fmt[pos + 1] != '}')
+        format_error("unmatched '}'");
+      on_literal(begin, pos + 1 - begin);
+      begin = ++pos + 1;
+      continue;
+    }
+    if (ch != '{') continue;
+    if (pos + 1 < fmt.size() && fmt[pos + 1] == '{') {
+      on_literal(begin, pos + 1 - begin);
+      begin = ++pos + 1;
+      continue;
+    }
+    if (pos > begin) on_literal(begin, pos - begin);
+
+    size_t at = pos + 1;
+    const auto peek = [&] { return at < fmt.size() ? fmt[at] : '\0'; };
+    const auto number = [&](size_t& value) {
+      const auto start = at;
+      for (value = 0; peek() >= '0' && peek() <= '9'; ++at)
+        value = value * 10 + static_cast<size_t>(peek() - '0');
+      return at != start;
+    };
+
+    size_t arg{};
+    if (!number(arg)) arg = next_arg;
+    next_arg = arg + 1;
+    format_spec spec;
+    if (peek() == ':') {
+      ++at;
+      if (peek() == '0') spec.pad = '0', ++at;
+      number(spec.width);
+      if (peek() == '.') {
+        ++at;
+        size_t precision{};
+        if (!number(precision)) format_error("missing precision");
+        spec.precision = static_cast<int>(precision);
+        spec.is_float = true;
+      }
+      switch (peek()) {
+      case 'd': break;
+      case 'x': spec.base = 16; break;
+      case 'o': spec.base = 8; break;
+      case 'b': spec.base = 2; break;
+      case 'f': spec.fmt = std::chars_format::fixed; break;
+      case 'e': spec.fmt = std::chars_format::scientific; break;
+      case 'g': break;
+      case 'a': spec.fmt = std::chars_format::hex; break;
+      default: --at; break;
+      }
+      ++at;
+      if (spec.fmt != std::chars_format::general) spec.is_float = true;
+      if (spec.is_float && spec.base != 10) format_error("conflicting type");
+    }
+    if (peek() != '}') format_error("malformed field");
+    on_field(arg, spec);
+    pos = at;
+    begin = pos + 1;
+  }
+  if (begin < fmt.size()) on_literal(begin, fmt.size() - begin);
+}
+
+// Counts for a parsed format string.
+struct format_counts {
+  size_t segments{};
+  // One more than the highest argument index.
+  size_t args{};
+  // Total size of the literals.
+  size_t literal_size{};
+};
+
+[[nodiscard]] constexpr format_counts count_format(std::string_view fmt) {
+  format_counts counts;
+  parse_format(
+      fmt,
+      [&](size_t, size_t size) {
+        ++counts.segments;
+        counts.literal_size += size;
+      },
+      [&](size_t arg, const format_spec&) {
+        ++counts.segments;
+        counts.args = std::max(counts.args, arg + 1);
+      });
+  return counts;
+}
+
+template<size_t N>
+[[nodiscard]] constexpr auto parse_segments(std::string_view fmt) {
+  std::array<format_segment, N> segments{};
+  size_t n{};
+  parse_format(
+      fmt, [&](size_t begin, size_t size) { segments[n++] = {begin, size}; },
+      [&](size_t arg, const format_spec& spec) {
+        segments[n++] = {0, 0, arg, spec};
+      });
+  return segments;
+}
+
+// Format string `F`, parsed.
+template<fixed_string F>
+struct parsed_format {
+  static constexpr auto counts = count_format(F.view());
+  static constexpr auto segments = parse_segments<counts.segments>(F.view());
+};
+
+// Append one field's argument, according to `spec`.
+template<format_spec spec, typename T>
+constexpr void append_field(AppendTarget auto& target, const T& arg) {
+  if constexpr (spec.is_plain())
+    append(target, arg);
+  else if constexpr (std::floating_point<T>) {
+    static_assert(spec.base == 10, "Integer type for floating-point field");
+    append_num<spec.fmt, spec.precision, spec.width, spec.pad>(target, arg);
+  } else {
+    static_assert(Integer<T>, "Numeric spec for non-numeric field");
+    static_assert(!spec.is_float, "Floating-point type for integer field");
+    // A width keeps `append_num` from prefixing hex with "0x".
+    append_num<spec.base, std::max<size_t>(spec.width, 1), spec.pad>(target,
+        arg);
+  }
+}
+
+// Size of one field, as for `appended_size`, but allowing for its spec.
+template<format_spec spec, typename T>
+[[nodiscard]] constexpr size_t field_size(const T& arg) {
+  size_t pieces{};
+  size_t size = appending::details::measured_size(arg, pieces);
+  if constexpr (Integer<T> && spec.base != 10)
+    size = std::numeric_limits<T>::digits + 1;
+  return std::max(size, spec.width);
+}
+} // namespace details
+
+// Append the arguments to `target`, as laid out by the format string `F`.
+//
+// Reserves up front for the literals and the fields. As with `appended_size`,
+// the literals and any strings are exact, while numbers are an upper bound.
+template<fixed_string F>
+constexpr auto& append_format(AppendTarget auto& target, const auto&... args) {
+  using parsed = details::parsed_format<F>;
+  static_assert(sizeof...(args) == parsed::counts.args,
+      "Argument count doesn't match format string");
+  const auto refs = std::forward_as_tuple(args...);
+  [&]<size_t... I>(std::index_sequence<I...>) {
+    constexpr auto& segments = parsed::segments;
+    const size_t size = (parsed::counts.literal_size + ... +
+                         [&]<details::format_segment seg>() -> size_t {
+                           if constexpr (seg.arg == npos)
+                             return 0;
+                           else
+                             return details::field_size<seg.spec>(
+                                 std::get<seg.arg>(refs));
+                         }.template operator()<segments[I]>());
+    appender{target}.reserve(size);
+    (
+        [&]<details::format_segment seg>() {
+          if constexpr (seg.arg == npos)
+            appender{target}.append(F.view().substr(seg.begin, seg.size));
+          else
+            details::append_field<seg.spec>(target, std::get<seg.arg>(refs));
+        }.template operator()<segments[I]>(),
+        ...);
+  }(std::make_index_sequence<parsed::segments.size()>{});
+  return target;
+}
+
+// Format the arguments into a new `std::string`, as laid out by the format
+// string `F`. See `append_format`.
+template<fixed_string F>
+[[nodiscard]] constexpr std::string format(const auto&... args) {
+  std::string target;
+  append_format<F>(target, args...);
+  return target;
+}
+
+}} // namespace corvid::strings::formatting
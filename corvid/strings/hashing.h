@@ -0,0 +1,184 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "strings_shared.h"
+#include "fixed_string.h"
+
+#include <array>
+#include <bit>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+
+namespace corvid::strings { inline namespace hashing {
+
+//
+// Hashing.
+//
+
+namespace details {
+// Default secret of wyhash.
+inline constexpr std::array<uint64_t, 4> wy_secret{0x2d358dccaa6c78a5,
+    0x8bb84b93962eacc9, 0x4b33a62ed433d4a3, 0x4d5a2da51de1aa47};
+
+// Multiply into 128 bits, returning the low half xor the high half.
+[[nodiscard]] constexpr uint64_t wy_mix(uint64_t a, uint64_t b) noexcept {
+  const auto r = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+// Multiply into 128 bits, replacing `a` with the low half and `b` with the
+// high half.
+constexpr void wy_mum(uint64_t& a, uint64_t& b) noexcept {
+  const auto r = static_cast<unsigned __int128>(a) * b;
+  a = static_cast<uint64_t>(r);
+  b = static_cast<uint64_t>(r >> 64);
+}
+
+// Load `N` bytes as little-endian, so that the result doesn't depend on the
+// platform or on whether it's evaluated at compile time.
+template<size_t N>
+[[nodiscard]] constexpr uint64_t wy_read(const char* p) noexcept {
+  if !consteval {
+    if constexpr (std::endian::native == std::endian::little) {
+      std::conditional_t<N == 8, uint64_t, uint32_t> word;
+      std::memcpy(&word, p, N);
+      return word;
+    }
+  }
+  uint64_t word{};
+  for (size_t i = 0; i < N; ++i)
+    word |= uint64_t{static_cast<unsigned char>(p[i])} << (i * 8);
+  return word;
+}
+} // namespace details
+
+// Fast, high-quality, non-cryptographic hash of `sv`. It follows wyhash
+// (final version 4), taking one 128-bit multiply per 16 bytes, and it can be
+// evaluated at compile time, with the same result as at runtime.
+[[nodiscard]] constexpr uint64_t
+fast_hash(std::string_view sv, uint64_t seed = 0) noexcept {
+  using namespace details;
+  constexpr auto& s = wy_secret;
+  auto p = sv.data();
+  const auto len = sv.size();
+  seed ^= wy_mix(seed ^ s[0], s[1]);
+  uint64_t a{}, b{};
+  if (len <= 16) {
+    if (len >= 4) {
+      const auto step = (len >> 3) << 2;
+      a = (wy_read<4>(p) << 32) | wy_read<4>(p + step);
+      b = (wy_read<4>(p + len - 4) << 32) | wy_read<4>(p + len - 4 - step);
+    } else if (len) {
+      a = (uint64_t{static_cast<unsigned char>(p[0])} << 16) |
+          (uint64_t{static_cast<unsigned char>(p[len >> 1])} << 8) |
+          static_cast<unsigned char>(p[len - 1]);
+    }
+  } else {
+    auto i = len;
+    if (i > 48) {
+      auto see1 = seed, see2 = seed;
+      do {
+        seed = wy_mix(wy_read<8>(p) ^ s[1], wy_read<8>(p + 8) ^ seed);
+        see1 = wy_mix(wy_read<8>(p + 16) ^ s[2], wy_read<8>(p + 24) ^ see1);
+        see2 = wy_mix(wy_read<8>(p + 32) ^ s[3], wy_read<8>(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = wy_mix(wy_read<8>(p) ^ s[1], wy_read<8>(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = wy_read<8>(p + i - 16);
+    b = wy_read<8>(p + i - 8);
+  }
+  a ^= s[1];
+  b ^= seed;
+  wy_mum(a, b);
+  return wy_mix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+// String view that carries its `fast_hash`.
+//
+// Computing the hash once, when the view is made, pays off for keys that are
+// looked up over and over, such as names known at compile time. The
+// transparent hashers use the cached hash instead of rehashing, and equality
+// compares hashes before bytes, so two of these that differ usually compare
+// unequal without touching the strings.
+//
+// Like `std::string_view`, it doesn't own the string.
+class hashed_string_view {
+public:
+  constexpr hashed_string_view() noexcept : hash_{fast_hash({})} {}
+  constexpr hashed_string_view(std::string_view sv) noexcept
+      : sv_{sv}, hash_{fast_hash(sv)} {}
+  constexpr hashed_string_view(const char* s) noexcept
+      : hashed_string_view{std::string_view{s}} {}
+  template<typename T>
+  requires std::is_convertible_v<const T&, std::string_view> &&
+           (!std::is_convertible_v<const T&, const char*>)
+  constexpr hashed_string_view(const T& t) noexcept
+      : hashed_string_view{std::string_view{t}} {}
+
+  // We don't want to bind to a temporary string.
+  hashed_string_view(std::string&&) = delete;
+
+  [[nodiscard]] constexpr std::string_view view() const noexcept {
+    return sv_;
+  }
+  constexpr operator std::string_view() const noexcept { return sv_; }
+  [[nodiscard]] constexpr uint64_t hash() const noexcept { return hash_; }
+
+  [[nodiscard]] constexpr const char* data() const noexcept {
+    return sv_.data();
+  }
+  [[nodiscard]] constexpr size_t size() const noexcept { return sv_.size(); }
+  [[nodiscard]] constexpr bool empty() const noexcept { return sv_.empty(); }
+
+  [[nodiscard]] friend constexpr bool operator==(const hashed_string_view& l,
+      const hashed_string_view& r) noexcept {
+    return l.hash_ == r.hash_ && l.sv_ == r.sv_;
+  }
+  [[nodiscard]] friend constexpr auto operator<=>(const hashed_string_view& l,
+      const hashed_string_view& r) noexcept {
+    return l.sv_ <=> r.sv_;
+  }
+
+private:
+  std::string_view sv_;
+  uint64_t hash_;
+};
+
+// The hashed view of a string literal, computed at compile time.
+//
+// Usage:
+//   auto it = headers.find(hashed_v<"content-type">);
+template<fixed_string S>
+inline constexpr hashed_string_view hashed_v{S.view()};
+
+}} // namespace corvid::strings::hashing
+
+template<>
+struct std::hash<corvid::strings::hashed_string_view> {
+  constexpr size_t
+  operator()(const corvid::strings::hashed_string_view& h) const noexcept {
+    return h.hash();
+  }
+};
@@ -16,6 +16,10 @@
 // limitations under the License.
 #pragma once
 #include "strings_shared.h"
+#include "targeting.h"
+
+#include <array>
+#include <cstdint>
 
 // Search and replace, except `search`, `find`, `replace`, and `erase` are all
 // symbols in the `std` namespace. We had to substitute `locate`, `substitute`,
@@ -56,6 +60,10 @@
 // - excise: Excise all occurrences of the values.
 // - substituted, excised: Same, but returning modified string.
 //
+// For values that are searched for repeatedly, a `multi_locator` can be
+// built once and passed in place of the list to `locate`, `rlocate`,
+// `located`, `rlocated`, and `count_located`.
+//
 // There's also `point_past`, which works with `located`, and some other
 // largely internal functions, such as `value_size`,  `min_value_size`,
 // `as_npos`, and `as_nloc`.
@@ -570,13 +578,307 @@ constexpr bool rlocated(location& loc, std::string_view s,
   return count_located(s, std::span{values.begin(), values.end()}, pos);
 }
 
+//
+// Multi-locator
+//
+
+// Precompiled set of `std::string_view` values to locate, for when the same
+// values are searched for repeatedly, such as scanning each line of a log for
+// dozens of markers.
+//
+// Passing a `multi_locator` to `locate`, `rlocate`, `located`, `rlocated`,
+// `count_located`, and `point_past` gives the same results as passing its
+// values as a span, including which value is reported when several match at
+// the same position. The difference is that, instead of comparing every value
+// at every position, it looks up each character in a table of the values'
+// first characters, and then each pair in a bitmap of their first two
+// characters, so most positions are rejected by a load or two. Only the
+// values that start with that character are then compared, in order.
+//
+// Owns a copy of the values, so the source can go away.
+class multi_locator {
+public:
+  multi_locator() = default;
+  multi_locator(std::initializer_list<std::string_view> values)
+      : multi_locator{std::span<const std::string_view>{values}} {}
+  template<std::ranges::forward_range R>
+  requires StringViewConvertible<std::ranges::range_value_t<R>>
+  explicit multi_locator(const R& values) {
+    for (const auto& value : values) {
+      const auto sv = std::string_view{value};
+      slices_.push_back({chars_.size(), sv.size()});
+      chars_.append(sv);
+    }
+    prepare();
+  }
+
+  // Accessors.
+  [[nodiscard]] size_t size() const noexcept { return slices_.size(); }
+  [[nodiscard]] bool empty() const noexcept { return slices_.empty(); }
+  [[nodiscard]] std::string_view operator[](size_t index) const noexcept {
+    const auto& slice = slices_[index];
+    return std::string_view{chars_}.substr(slice.offset, slice.size);
+  }
+
+  // Locate the first instance of any value in `s`, starting at `pos`. See
+  // the free functions for details.
+  template<npos_choice npv = npos_choice::npos>
+  [[nodiscard]] location
+  locate(std::string_view s, position pos = 0) const noexcept {
+    if (first_empty_ != npos) {
+      if (pos <= s.size()) return {pos, match_at(s, pos)};
+      return as_nloc<npv>(s, *this);
+    }
+    for (; pos < s.size(); ++pos) {
+      if (!first_[uchar(s[pos])]) continue;
+      if (const auto pos_value = match_at(s, pos); pos_value != npos)
+        return {pos, pos_value};
+    }
+    return as_nloc<npv>(s, *this);
+  }
+
+  // Same as above, but locate the last instance.
+  template<npos_choice npv = npos_choice::npos>
+  [[nodiscard]] location
+  rlocate(std::string_view s, position pos = npos) const noexcept {
+    if (s.empty()) return as_nloc<npv>(s, *this);
+    if (pos >= s.size()) pos = s.size() - 1;
+    for (++pos; pos-- > 0;) {
+      if (first_empty_ == npos && !first_[uchar(s[pos])]) continue;
+      if (const auto pos_value = match_at(s, pos); pos_value != npos)
+        return {pos, pos_value};
+    }
+    return as_nloc<npv>(s, *this);
+  }
+
+private:
+  struct slice {
+    size_t offset;
+    size_t size;
+  };
+
+  std::string chars_;
+  std::vector<slice> slices_;
+  // Index of the first empty value, which matches everywhere, or `npos`.
+  size_t first_empty_{npos};
+  // Whether any value starts with the character.
+  std::array<bool, 256> first_{};
+  // Whether any value starting with the character is only that character.
+  std::array<bool, 256> single_{};
+  // Bitmap of the first two characters of the longer values.
+  std::array<uint64_t, 65536 / 64> pairs_{};
+  // Value indexes, ordered by first character and then by index, with the
+  // start of each character's run.
+  std::vector<size_t> by_first_;
+  std::array<size_t, 257> run_start_{};
+
+  [[nodiscard]] static constexpr size_t uchar(char ch) noexcept {
+    return static_cast<unsigned char>(ch);
+  }
+  [[nodiscard]] static constexpr size_t
+  pair_of(char first, char second) noexcept {
+    return uchar(first) << 8 | uchar(second);
+  }
+
+  void prepare() {
+    for (size_t i = 0; i < size(); ++i) {
+      const auto value = (*this)[i];
+      if (value.empty()) {
+        first_empty_ = i;
+        break;
+      }
+    }
+
+    // Only values before the first empty one can ever be reported.
+    const auto count = std::min(size(), first_empty_);
+    for (size_t i = 0; i < count; ++i) {
+      const auto value = (*this)[i];
+      const auto ch = uchar(value[0]);
+      first_[ch] = true;
+      ++run_start_[ch + 1];
+      if (value.size() == 1)
+        single_[ch] = true;
+      else {
+        const auto pair = pair_of(value[0], value[1]);
+        pairs_[pair / 64] |= uint64_t{1} << (pair % 64);
+      }
+    }
+    for (size_t ch = 0; ch < 256; ++ch) run_start_[ch + 1] += run_start_[ch];
+    by_first_.resize(count);
+    auto next = run_start_;
+    for (size_t i = 0; i < count; ++i)
+      by_first_[next[uchar((*this)[i][0])]++] = i;
+  }
+
+  // Index of the first value that matches at `pos`, or `npos`.
+  [[nodiscard]] size_t
+  match_at(std::string_view s, position pos) const noexcept {
+    if (pos < s.size()) {
+      const auto ch = uchar(s[pos]);
+      if (first_[ch] &&
+          (single_[ch] ||
+              (pos + 1 < s.size() && has_pair(s[pos], s[pos + 1]))))
+      {
+        const auto rest = s.substr(pos);
+        for (auto i = run_start_[ch]; i < run_start_[ch + 1]; ++i) {
+          const auto pos_value = by_first_[i];
+          if (rest.starts_with((*this)[pos_value])) return pos_value;
+        }
+      }
+    }
+    return first_empty_;
+  }
+
+  [[nodiscard]] bool has_pair(char first, char second) const noexcept {
+    const auto pair = pair_of(first, second);
+    return pairs_[pair / 64] >> (pair % 64) & 1;
+  }
+};
+
+// Locate the first instance of any of the values of `ml` in `s`, starting at
+// `pos`. Same as passing the values as a span.
+template<npos_choice npv = npos_choice::npos>
+[[nodiscard]] inline location locate(std::string_view s,
+    const multi_locator& ml, position pos = 0) noexcept {
+  return ml.locate<npv>(s, pos);
+}
+// Same as above, but locate the last instance.
+template<npos_choice npv = npos_choice::npos>
+[[nodiscard]] inline location rlocate(std::string_view s,
+    const multi_locator& ml, position pos = npos) noexcept {
+  return ml.rlocate<npv>(s, pos);
+}
+
+template<npos_choice npv = npos_choice::npos>
+inline bool
+located(location& loc, std::string_view s, const multi_locator& ml) noexcept {
+  return (loc = ml.locate<npv>(s, loc.pos)).pos != as_npos<npv>(s);
+}
+template<npos_choice npv = npos_choice::npos>
+inline bool
+rlocated(location& loc, std::string_view s, const multi_locator& ml) noexcept {
+  if (loc.pos > s.size()) {
+    loc.pos = as_npos<npv>(s);
+    return false;
+  }
+  return (loc = ml.rlocate<npv>(s, loc.pos)).pos != as_npos<npv>(s);
+}
+
+inline position point_past(location& loc, const multi_locator& ml) noexcept {
+  assert(loc.pos_value < ml.size());
+  loc.pos += std::max(ml[loc.pos_value].size(), size_t{1});
+  return loc.pos;
+}
+
+[[nodiscard]] inline size_t count_located(std::string_view s,
+    const multi_locator& ml, position pos = 0) noexcept {
+  size_t cnt{};
+  for (location loc{pos, 0}; located(loc, s, ml); ++cnt, point_past(loc, ml));
+  return cnt;
+}
+
 //
 // Substitute
 //
 
+namespace details {
+// A located `from` value, of `from_size`, to be replaced with `to`. When
+// nothing was located, `pos` is `npos`.
+struct substitution {
+  position pos{npos};
+  size_t from_size{};
+  std::string_view to{};
+};
+
+// Rewrite `s` from `pos` on in a single forward pass, replacing each
+// substitution that `next(s, pos)` locates, and returning their count. As
+// with Python `string.replace`, an empty `from` inserts `to` before the
+// character at its position, and the search resumes after that character.
+//
+// When `in_place`, which requires that no `to` be larger than its `from`, the
+// output is written over the input it has already consumed, so nothing is
+// allocated or shifted more than once. Otherwise, it's built in a new buffer,
+// pre-sized to the input, then swapped in.
+template<bool in_place, typename F>
+size_t substitute_pass(std::string& s, position pos, F&& next) {
+  if (pos > s.size()) return 0;
+  const std::string_view in{s};
+  std::string built;
+  size_t out = pos;
+  if constexpr (!in_place) {
+    built.reserve(s.size());
+    built.append(in.substr(0, pos));
+  }
+
+  // Write `len` chars from `from`, which may be within `s`.
+  auto write = [&](const char* from, size_t len) {
+    if constexpr (in_place)
+      std::char_traits<char>::move(s.data() + out, from, len);
+    else
+      built.append(from, len);
+    out += len;
+  };
+
+  size_t cnt{};
+  for (details::substitution m; (m = next(in, pos)).pos != npos;) {
+    ++cnt;
+    write(in.data() + pos, m.pos - pos);
+    write(m.to.data(), m.to.size());
+    pos = m.pos + m.from_size;
+    if (!m.from_size) {
+      if (pos < in.size()) write(in.data() + pos, 1);
+      if (++pos > in.size()) break;
+    }
+  }
+
+  if (pos < in.size()) write(in.data() + pos, in.size() - pos);
+  if constexpr (in_place)
+    s.resize(out);
+  else
+    s = std::move(built);
+  return cnt;
+}
+
+// Whether substituting `to` for `from` could make the string longer.
+[[nodiscard]] inline constexpr bool
+can_grow(std::string_view from, std::string_view to) noexcept {
+  return to.size() > from.size();
+}
+template<typename F>
+size_t substitute_pass(std::string& s, position pos, bool grow, F&& next) {
+  if (grow) return substitute_pass<false>(s, pos, std::forward<F>(next));
+  return substitute_pass<true>(s, pos, std::forward<F>(next));
+}
+
+// Size at which it pays to precompile a list of values into a
+// `multi_locator` for a single call.
+inline constexpr size_t multi_locator_threshold = 4096;
+
+// Substitute the values of `from`, which is a list or a `multi_locator`,
+// with the matching ones of `to`.
+template<typename L>
+size_t substitute_values(std::string& s, const L& from,
+    std::span<const std::string_view> to, position pos) {
+  assert(to.size() >= from.size());
+  bool grow{};
+  for (size_t i = 0; i < from.size(); ++i)
+    grow = grow || can_grow(from[i], to[i]);
+  return substitute_pass(s, pos, grow,
+      [&](std::string_view in, position at) -> substitution {
+        const auto loc = locate(in, from, at);
+        if (loc.pos == npos) return {};
+        return {loc.pos, from[loc.pos_value].size(), to[loc.pos_value]};
+      });
+}
+} // namespace details
+
 // Substitute all instances of `from` in `s` with `to`, returning count of
 // substitutions. Note that an empty `from` follows the same behavior as Python
 // `string.replace`, in that it will insert `to` around each character in `s`.
+//
+// The whole string is rewritten in a single pass, never shifting the tail
+// more than once. When no `to` is larger than its `from`, this is done in
+// place; otherwise, into a buffer pre-sized to the input.
 size_t substitute(std::string& s, SingleLocateValue auto from,
     SingleLocateValue auto to, position pos = 0) noexcept {
   size_t cnt{};
@@ -585,21 +887,37 @@ size_t substitute(std::string& s, SingleLocateValue auto from,
     for (; located(pos, s, from); ++cnt, ++pos) s[pos] = to;
   } else {
     static_assert(!Char<decltype(to)>, "from/to must match");
-    auto from_sv = std::string_view{from};
-    auto to_sv = std::string_view{to};
-    size_t from_size = from_sv.size();
-    size_t to_size = to_sv.size() + (from_size ? 0 : 1);
-    for (; located(pos, s, from_sv); ++cnt, pos += to_size)
-      s.replace(pos, from_size, to_sv);
+    const auto from_sv = std::string_view{from};
+    const auto to_sv = std::string_view{to};
+    cnt = details::substitute_pass(s, pos, details::can_grow(from_sv, to_sv),
+        [&](std::string_view in, position at) -> details::substitution {
+          const auto found = in.find(from_sv, at);
+          if (found == npos) return {};
+          return {found, from_sv.size(), to_sv};
+        });
   }
   return cnt;
 }
+// Substitutes each char in `from` with the one at the same position in `to`,
+// in a single pass that looks each char up in a table.
 inline size_t substitute(std::string& s, std::span<const char> from,
     std::span<const char> to, position pos = 0) {
+  assert(to.size() >= from.size());
+  std::array<bool, 256> found{};
+  std::array<char, 256> replacement{};
+  for (size_t i = 0; i < from.size(); ++i) {
+    const auto ch = static_cast<unsigned char>(from[i]);
+    if (found[ch]) continue;
+    found[ch] = true;
+    replacement[ch] = to[i];
+  }
   size_t cnt{};
-  for (location loc{pos, 0}; located(loc, std::string_view{s}, from);
-       ++cnt, ++loc.pos)
-    s[loc.pos] = to[loc.pos_value];
+  for (; pos < s.size(); ++pos) {
+    const auto ch = static_cast<unsigned char>(s[pos]);
+    if (!found[ch]) continue;
+    s[pos] = replacement[ch];
+    ++cnt;
+  }
   return cnt;
 }
 inline size_t substitute(std::string& s, std::initializer_list<char> from,
@@ -607,17 +925,13 @@ inline size_t substitute(std::string& s, std::initializer_list<char> from,
   return substitute(s, std::span<const char>{from}, std::span<const char>{to},
       pos);
 }
+// For long strings, precompiles `from` into a `multi_locator`.
 inline size_t substitute(std::string& s,
     std::span<const std::string_view> from,
     std::span<const std::string_view> to, position pos = 0) {
-  size_t cnt{};
-  for (location loc{pos, 0}; located(loc, std::string_view{s}, from); ++cnt) {
-    size_t from_size = from[loc.pos_value].size();
-    s.replace(loc.pos, from_size, to[loc.pos_value]);
-    size_t to_size = to[loc.pos_value].size() + (from_size ? 0 : 1);
-    loc.pos += std::max(to_size, size_t{1});
-  }
-  return cnt;
+  if (from.size() > 1 && s.size() >= details::multi_locator_threshold)
+    return details::substitute_values(s, multi_locator{from}, to, pos);
+  return details::substitute_values(s, from, to, pos);
 }
 inline size_t substitute(std::string& s,
     std::initializer_list<std::string_view> from,
@@ -625,6 +939,14 @@ inline size_t substitute(std::string& s,
   return substitute(s, std::span<const std::string_view>{from},
       std::span<const std::string_view>{to}, pos);
 }
+inline size_t substitute(std::string& s, const multi_locator& from,
+    std::span<const std::string_view> to, position pos = 0) {
+  return details::substitute_values(s, from, to, pos);
+}
+inline size_t substitute(std::string& s, const multi_locator& from,
+    std::initializer_list<std::string_view> to, position pos = 0) {
+  return substitute(s, from, std::span<const std::string_view>{to}, pos);
+}
 
 //
 // Substituted
@@ -638,17 +960,105 @@ substituted(std::string s, const auto& from, const auto& to) noexcept {
   return ss;
 }
 
+//
+// Stream substituter
+//
+
+// Substitutes for a set of values over input that arrives in chunks, such as
+// from a file too large to hold in memory, with the same results as calling
+// `substitute` on the whole of it. The `from` values may not be empty.
+//
+// Each chunk is passed to `substitute`, which appends the output that's
+// settled to the target. Since a value may straddle chunks, up to one less
+// than the size of the longest `from` value is held back until the next
+// chunk, or until `finish`, which must be called at the end.
+//
+// Usage:
+//   stream_substituter sub{{"\r\n", "\t"}, {"\n", " "}};
+//   while (read_chunk(chunk)) sub.substitute(out, chunk);
+//   sub.finish(out);
+class stream_substituter {
+public:
+  stream_substituter(std::initializer_list<std::string_view> from,
+      std::initializer_list<std::string_view> to)
+      : stream_substituter{multi_locator{from},
+            std::span<const std::string_view>{to}} {}
+  stream_substituter(multi_locator from, std::span<const std::string_view> to)
+      : from_{std::move(from)} {
+    assert(to.size() >= from_.size());
+    for (size_t i = 0; i < from_.size(); ++i) {
+      assert(!from_[i].empty());
+      max_from_size_ = std::max(max_from_size_, from_[i].size());
+      to_.emplace_back(to[i]);
+    }
+  }
+
+  // Substitute within `chunk`, appending the settled output to `target`.
+  // Returns the count of substitutions made so far.
+  size_t substitute(AppendTarget auto& target, std::string_view chunk) {
+    if (held_.empty()) return process(target, chunk, false);
+    held_.append(chunk);
+    const auto buffer = std::move(held_);
+    held_.clear();
+    return process(target, buffer, false);
+  }
+
+  // Flush what's held back, appending it to `target`. Returns the total count
+  // of substitutions. Afterwards, the substituter can be reused.
+  size_t finish(AppendTarget auto& target) {
+    const auto buffer = std::move(held_);
+    held_.clear();
+    process(target, buffer, true);
+    return std::exchange(count_, 0);
+  }
+
+  [[nodiscard]] size_t count() const noexcept { return count_; }
+
+private:
+  multi_locator from_;
+  std::vector<std::string> to_;
+  size_t max_from_size_{};
+  std::string held_;
+  size_t count_{};
+
+  size_t process(AppendTarget auto& target, std::string_view buffer,
+      bool final) {
+    // A match can only be settled if it starts where every value fits.
+    const size_t reach = max_from_size_ ? max_from_size_ - 1 : 0;
+    const size_t limit =
+        final ? buffer.size()
+              : (buffer.size() > reach ? buffer.size() - reach : 0);
+    appender out{target};
+    position pos{};
+    for (location loc; (loc = from_.locate(buffer, pos)).pos < limit;) {
+      out.append(buffer.substr(pos, loc.pos - pos));
+      out.append(to_[loc.pos_value]);
+      pos = loc.pos + from_[loc.pos_value].size();
+      ++count_;
+    }
+    const auto settled = std::max(pos, limit);
+    out.append(buffer.substr(pos, settled - pos));
+    held_.assign(buffer.substr(settled));
+    return count_;
+  }
+};
+
 //
 // Excise
 //
 
 // Excise all instances of `from` in `s`, returning count of
 // excisions. An empty `from` clears the string.
+//
+// As with `substitute`, the string is compacted in place in a single pass.
 size_t excise(std::string& s, SingleLocateValue auto from,
     position pos = 0) noexcept {
+  if (pos > s.size()) return 0;
   size_t cnt{};
   if constexpr (Char<decltype(from)>) {
-    for (; located(pos, s, from); ++cnt) s.erase(pos, 1);
+    const auto first = s.begin() + static_cast<std::ptrdiff_t>(pos);
+    cnt = static_cast<size_t>(s.end() - std::remove(first, s.end(), from));
+    s.resize(s.size() - cnt);
   } else {
     auto from_sv = std::string_view{from};
     if (from_sv.empty()) {
@@ -656,38 +1066,81 @@ size_t excise(std::string& s, SingleLocateValue auto from,
       s.clear();
       return cnt;
     }
-    for (; located(pos, s, from_sv); ++cnt) s.erase(pos, from_sv.size());
+    cnt = details::substitute_pass<true>(s, pos,
+        [&](std::string_view in, position at) -> details::substitution {
+          const auto found = in.find(from_sv, at);
+          if (found == npos) return {};
+          return {found, from_sv.size()};
+        });
   }
   return cnt;
 }
+// Excises each char in `from`, in a single pass that looks each char up in a
+// table.
 inline size_t
 excise(std::string& s, std::span<const char> from, position pos = 0) {
-  size_t cnt{};
-  for (location loc{pos, 0}; located(loc, s, from); ++cnt) s.erase(loc.pos, 1);
+  if (pos > s.size()) return 0;
+  std::array<bool, 256> found{};
+  for (auto ch : from) found[static_cast<unsigned char>(ch)] = true;
+  const auto first = s.begin() + static_cast<std::ptrdiff_t>(pos);
+  const auto cnt = static_cast<size_t>(
+      s.end() - std::remove_if(first, s.end(), [&](char ch) {
+        return found[static_cast<unsigned char>(ch)];
+      }));
+  s.resize(s.size() - cnt);
   return cnt;
 }
 inline size_t
 excise(std::string& s, std::initializer_list<char> from, position pos = 0) {
   return excise(s, std::span<const char>{from}, pos);
 }
-inline size_t excise(std::string& s, std::span<const std::string_view> from,
-    position pos = 0) {
-  size_t cnt{};
-  for (location loc{pos, 0}; located(loc, s, from) && !s.empty(); ++cnt) {
-    size_t from_size = from[loc.pos_value].size();
-    if (!from_size) {
-      cnt = s.size();
-      s.clear();
-      return cnt;
+
+namespace details {
+// Excise the values of `from`, which is a list or a `multi_locator`.
+template<typename L>
+size_t excise_values(std::string& s, const L& from, position pos) {
+  // Once an empty value is located, the whole string is excised, counting
+  // each remaining char.
+  bool has_empty{};
+  for (size_t i = 0; i < from.size(); ++i)
+    has_empty = has_empty || from[i].empty();
+  if (has_empty) {
+    size_t cnt{};
+    for (location loc{pos, 0}; located(loc, s, from) && !s.empty(); ++cnt) {
+      size_t from_size = from[loc.pos_value].size();
+      if (!from_size) {
+        cnt = s.size();
+        s.clear();
+        return cnt;
+      }
+      s.erase(loc.pos, from_size);
     }
-    s.erase(loc.pos, from_size);
+    return cnt;
   }
-  return cnt;
+  return substitute_pass<true>(s, pos,
+      [&](std::string_view in, position at) -> substitution {
+        const auto loc = locate(in, from, at);
+        if (loc.pos == npos) return {};
+        return {loc.pos, from[loc.pos_value].size()};
+      });
+}
+} // namespace details
+
+// For long strings, precompiles `from` into a `multi_locator`.
+inline size_t excise(std::string& s, std::span<const std::string_view> from,
+    position pos = 0) {
+  if (from.size() > 1 && s.size() >= details::multi_locator_threshold)
+    return details::excise_values(s, multi_locator{from}, pos);
+  return details::excise_values(s, from, pos);
 }
 inline size_t excise(std::string& s,
     std::initializer_list<std::string_view> from, position pos = 0) {
   return excise(s, std::span<const std::string_view>{from}, pos);
 }
+inline size_t
+excise(std::string& s, const multi_locator& from, position pos = 0) {
+  return details::excise_values(s, from, pos);
+}
 
 //
 // Excised.
@@ -701,17 +1154,12 @@ inline size_t excise(std::string& s,
 }
 
 // TODO: Substituted and excised don't work for initializer lists. Wrap them.
-// TODO: Excise can always be optimized to do a single pass over the string,
-// never copying the tail more than once.
 // TODO: Consider replacing free functions with something more object-oriented.
 // For example, a `locator` constructed over `s` and `loc` (and maybe
 // `as_npos`), which then has a `located` and `substituted` method. We could
 // also go the other way, making `from` and `to` into objects that have a
 // `locate` taking `s`, or even taking a `locator`. Point is, we're not stuck
 // repeating the C RTL endlessly.
-// TODO: Benchmark whether it's faster to do replacements in-place or to
-// build a new string. There's also the middle ground of in-place but in a
-// single pass, so long as we're not growing.
 // TODO: If span size is 1, forward to regular, with pos_value hardcoded to
 // 0? If string size is 1, forward to regular?
 //
@@ -0,0 +1,273 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include "strings_shared.h"
+#include "locating.h"
+#include "delimiting.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Parallel versions of `count_located`, `located`, and `split`, for buffers
+// large enough, such as a mapped log file, that scanning them on a single core
+// is the bottleneck.
+//
+// The input is partitioned into contiguous chunks, the existing sequential
+// kernels are run on each chunk in its own thread, and the results are
+// stitched back together in order, so they're the same as for the sequential
+// versions. Inputs too small to be worth the threads are just
+// handled sequentially.
+namespace corvid::strings { inline namespace parallel {
+
+// How to partition the input.
+struct parallelism {
+  // Most threads to use, including the calling one. When 0, uses
+  // `std::thread::hardware_concurrency`.
+  size_t threads{};
+  // Fewest bytes in a chunk, so that each thread has enough work to pay for
+  // starting it.
+  size_t min_chunk{size_t{1} << 16};
+};
+
+namespace details {
+// Number of chunks to partition `size` bytes into, according to `par`.
+[[nodiscard]] inline size_t chunk_count(size_t size, parallelism par) {
+  const size_t threads =
+      par.threads ? par.threads : std::thread::hardware_concurrency();
+  return std::clamp<size_t>(size / std::max<size_t>(par.min_chunk, 1), 1,
+      std::max<size_t>(threads, 1));
+}
+
+// Split `[begin, end)` into `chunks` and call `fn(chunk, chunk_begin,
+// chunk_end)` for each, concurrently, with the first on the calling thread.
+//
+// If any call throws, the first exception, by chunk, is rethrown after all
+// have finished.
+template<typename F>
+void for_each_chunk(size_t begin, size_t end, size_t chunks, const F& fn) {
+  const size_t size = end - begin;
+  const auto bound = [&](size_t chunk) {
+    return begin + size / chunks * chunk + std::min(chunk, size % chunks);
+  };
+  if (chunks == 1) {
+    fn(size_t{0}, begin, end);
+    return;
+  }
+
+  std::vector<std::exception_ptr> errors(chunks);
+  const auto run = [&](size_t chunk) {
+    try {
+      fn(chunk, bound(chunk), bound(chunk + 1));
+    } catch (...) {
+      errors[chunk] = std::current_exception();
+    }
+  };
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(chunks - 1);
+    for (size_t chunk = 1; chunk < chunks; ++chunk)
+      workers.emplace_back(run, chunk);
+    run(0);
+  }
+  for (auto& error : errors)
+    if (error) std::rethrow_exception(error);
+}
+
+[[nodiscard]] constexpr position& pos_of(position& pos) noexcept {
+  return pos;
+}
+[[nodiscard]] constexpr position& pos_of(location& loc) noexcept {
+  return loc.pos;
+}
+
+// Matches located within a chunk.
+struct chunk_hits {
+  size_t count{};
+  // Position of the first match, or `npos`.
+  position first{npos};
+  // Position past the last match.
+  position past{};
+};
+
+// Count the matches starting in `[begin, end)` of `w`, continuing from each
+// one past it, as `count_located` does. The state, `S`, is a `position` or a
+// `location`, as `next` and `past` expect.
+template<typename S, typename N, typename P>
+[[nodiscard]] chunk_hits count_chunk(std::string_view w, position begin,
+    position end, const N& next, const P& past) {
+  chunk_hits hits{.past = begin};
+  for (S at{begin}; pos_of(at) < end && next(at, w) && pos_of(at) < end;) {
+    if (!hits.count++) hits.first = pos_of(at);
+    hits.past = past(at);
+  }
+  return hits;
+}
+
+// Count matches from `begin` on in parallel, where a match that starts before
+// `end` fits in the first `end + longest - 1` bytes of `s`, and `next` and
+// `past` are as for `count_chunk`.
+//
+// Because each match is skipped past, where a chunk's matches are depends on
+// where the previous chunk's last match left off. Each chunk is counted as
+// though it were the start, and then, while stitching, a chunk whose first
+// match turns out to overlap the previous chunk's last is recounted from the
+// right place. Once the two starting points agree on a match, they agree on
+// all later ones, so this only happens for values that can overlap
+// themselves, such as "aa", and only costs that one chunk.
+template<typename S, typename N, typename P>
+[[nodiscard]] size_t par_count(std::string_view s, position begin,
+    size_t longest, parallelism par, const N& next, const P& past) {
+  struct chunk_result {
+    position begin{};
+    position end{};
+    chunk_hits hits;
+  };
+  const auto window = [&](position end) {
+    return s.substr(0, end + longest - 1);
+  };
+  const auto chunks = chunk_count(s.size() - begin, par);
+  std::vector<chunk_result> results(chunks);
+  for_each_chunk(begin, s.size(), chunks,
+      [&](size_t chunk, position chunk_begin, position chunk_end) {
+        results[chunk] = {chunk_begin, chunk_end,
+            count_chunk<S>(window(chunk_end), chunk_begin, chunk_end, next,
+                past)};
+      });
+
+  size_t cnt{};
+  position resume = begin;
+  for (auto& [chunk_begin, chunk_end, hits] : results) {
+    if (hits.count && hits.first < resume)
+      hits = count_chunk<S>(window(chunk_end), resume, chunk_end, next, past);
+    cnt += hits.count;
+    if (hits.count) resume = hits.past;
+  }
+  return cnt;
+}
+} // namespace details
+
+//
+// par_count_located
+//
+
+// Return count of instances of a single `value` in `s`, starting at `pos`,
+// counting chunks of `s` in parallel. Same result as `count_located`.
+[[nodiscard]] inline size_t par_count_located(std::string_view s,
+    const SingleLocateValue auto& value, position pos = 0,
+    parallelism par = {}) {
+  const auto longest = value_size(value);
+  if (!longest || pos >= s.size()) return count_located(s, value, pos);
+  return details::par_count<position>(
+      s, pos, longest, par,
+      [&](position& at, std::string_view w) { return located(at, w, value); },
+      [&](position& at) { return point_past(at, value); });
+}
+
+// Same, but for any of the values of a `multi_locator`.
+[[nodiscard]] inline size_t par_count_located(std::string_view s,
+    const multi_locator& ml, position pos = 0, parallelism par = {}) {
+  size_t longest{};
+  for (size_t i = 0; i < ml.size(); ++i) {
+    if (ml[i].empty()) return count_located(s, ml, pos);
+    longest = std::max(longest, ml[i].size());
+  }
+  if (!longest || pos >= s.size()) return count_located(s, ml, pos);
+  return details::par_count<location>(
+      s, pos, longest, par,
+      [&](location& at, std::string_view w) { return located(at, w, ml); },
+      [&](location& at) { return point_past(at, ml); });
+}
+
+//
+// par_located
+//
+
+// Whether a single `value` was located in `s`, starting at `pos`, searching
+// chunks of `s` in parallel. As with `located`, updates `pos` to the first
+// instance, or `npos` if none.
+[[nodiscard]] inline bool par_located(position& pos, std::string_view s,
+    const SingleLocateValue auto& value, parallelism par = {}) {
+  const auto longest = value_size(value);
+  if (!longest || pos >= s.size()) return located(pos, s, value);
+  const auto chunks = details::chunk_count(s.size() - pos, par);
+  std::vector<position> firsts(chunks, npos);
+  details::for_each_chunk(pos, s.size(), chunks,
+      [&](size_t chunk, position chunk_begin, position chunk_end) {
+        auto at = chunk_begin;
+        if (located(at, s.substr(0, chunk_end + longest - 1), value) &&
+            at < chunk_end)
+          firsts[chunk] = at;
+      });
+  const auto found = std::ranges::find_if(firsts,
+      [](position at) { return at != npos; });
+  pos = found != firsts.end() ? *found : npos;
+  return pos != npos;
+}
+
+//
+// par_split
+//
+
+// Positions of the delimiters in `whole`, in order, found in parallel. This
+// is an index of the pieces that `split` returns: each starts after a
+// delimiter, or at the beginning, and ends before the next, or at the end.
+[[nodiscard]] inline std::vector<position>
+par_delim_offsets(std::string_view whole, delim d = {}, parallelism par = {}) {
+  const auto chunks = details::chunk_count(whole.size(), par);
+  std::vector<std::vector<position>> found(chunks);
+  details::for_each_chunk(0, whole.size(), chunks,
+      [&](size_t chunk, position chunk_begin, position chunk_end) {
+        const auto part = whole.substr(chunk_begin, chunk_end - chunk_begin);
+        for (position from{};;) {
+          const auto at = d.find_in(part.substr(from));
+          if (at == npos) break;
+          found[chunk].push_back(chunk_begin + from + at);
+          from += at + 1;
+        }
+      });
+  size_t total{};
+  for (const auto& offsets : found) total += offsets.size();
+  std::vector<position> offsets;
+  offsets.reserve(total);
+  for (const auto& chunk_offsets : found)
+    offsets.insert(offsets.end(), chunk_offsets.begin(), chunk_offsets.end());
+  return offsets;
+}
+
+// Split all pieces by delimiters and return parts in vector, finding the
+// delimiters in parallel. Same result as `split`.
+//
+// Specify R as `std::string` to make a deep copy.
+template<typename R = std::string_view>
+[[nodiscard]] auto
+par_split(std::string_view whole, delim d = {}, parallelism par = {}) {
+  std::vector<R> parts;
+  if (whole.empty()) return parts;
+  const auto offsets = par_delim_offsets(whole, d, par);
+  parts.reserve(offsets.size() + 1);
+  position begin{};
+  for (const auto offset : offsets) {
+    parts.emplace_back(whole.substr(begin, offset - begin));
+    begin = offset + 1;
+  }
+  parts.emplace_back(whole.substr(begin));
+  return parts;
+}
+
+}} // namespace corvid::strings::parallel
@@ -19,6 +19,11 @@
 #include "delimiting.h"
 #include "opt_string_view.h"
 
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+
 namespace corvid::strings { inline namespace splitting {
 
 //
@@ -74,6 +79,83 @@ template<typename R = std::string_view>
   return split<std::string>(std::string_view(whole), d);
 }
 
+namespace details {
+// Accumulates the pieces for `split_and_trim`, tracking the first and last
+// character of the current piece that isn't whitespace.
+template<typename R>
+struct trimmed_pieces {
+  std::string_view whole;
+  std::vector<R> parts{};
+  size_t begin{};
+  size_t first{npos};
+  size_t last{};
+
+  constexpr void keep(size_t pos) noexcept {
+    if (first == npos) first = pos;
+    last = pos;
+  }
+
+  constexpr void close(size_t pos) {
+    if (first == npos)
+      parts.emplace_back(whole.substr(begin, 0));
+    else
+      parts.emplace_back(whole.substr(first, last + 1 - first));
+    begin = pos + 1;
+    first = npos;
+  }
+};
+} // namespace details
+
+// Split all pieces by delimiters and trim whitespace from each, returning the
+// parts in a vector.
+//
+// Equivalent to trimming each part returned by `split`, but in a single pass
+// that doesn't make an intermediate vector. When `d` and `ws` are both short
+// enough for SWAR, each 8-byte word is matched against both at once.
+//
+// Does not omit empty parts. Delimiters take precedence over whitespace, so
+// `ws` may overlap `d`.
+// Specify R as `std::string` to make a deep copy.
+template<typename R = std::string_view>
+[[nodiscard]] constexpr auto
+split_and_trim(std::string_view whole, delim d, delim ws = {}) {
+  details::trimmed_pieces<R> acc{whole};
+  if (whole.empty()) return std::move(acc.parts);
+  size_t pos = 0;
+  if !consteval {
+    if (d.use_swar() && ws.use_swar()) {
+      for (; pos + 8 <= whole.size(); pos += 8) {
+        const auto word = delimiting::details::load_word(whole.data() + pos);
+        auto delims = d.match_word(word);
+        auto kept = ~(delims | ws.match_word(word)) &
+                    delimiting::details::delim_highs;
+        while (delims) {
+          const auto below = (delims & -delims) - 1;
+          if (const auto seg = kept & below) {
+            acc.keep(pos + std::countr_zero(seg) / 8);
+            acc.last = pos + (63 - std::countl_zero(seg)) / 8;
+          }
+          acc.close(pos + std::countr_zero(delims) / 8);
+          kept &= ~below;
+          delims &= delims - 1;
+        }
+        if (kept) {
+          acc.keep(pos + std::countr_zero(kept) / 8);
+          acc.last = pos + (63 - std::countl_zero(kept)) / 8;
+        }
+      }
+    }
+  }
+  for (; pos < whole.size(); ++pos) {
+    if (d.is_delim(whole[pos]))
+      acc.close(pos);
+    else if (!ws.is_delim(whole[pos]))
+      acc.keep(pos);
+  }
+  acc.close(pos);
+  return std::move(acc.parts);
+}
+
 // Concept to detect whether a type is a piece_generator.
 //
 // This requires it to be moveable, be constructable from `std::string_view`,
@@ -101,6 +183,29 @@ concept PieceGenerator = requires(T t, std::string_view s) {
   };
 };
 
+namespace details {
+// Fills `part` with the next piece from `whole`, as found by `finder` and
+// filtered by `filter`, and returns `true`. On failure, such as when there's
+// nothing left to parse, returns `false`. See `piece_generator` for the
+// signatures of the callbacks.
+template<typename F, typename P>
+[[nodiscard]] constexpr bool next_piece(std::string_view& part,
+    opt_string_view& whole, const F& finder, const P& filter) {
+  for (;;) {
+    if (whole.null()) return false;
+    auto [pos, next] = finder(std::string_view{whole});
+    auto opt_part = filter(whole.substr(0, pos));
+    if (pos == npos)
+      whole = std::nullopt;
+    else
+      whole.remove_prefix(next);
+    if (!opt_part) continue;
+    part = *opt_part;
+    return true;
+  }
+}
+} // namespace details
+
 // Implements the PieceGenerator concept to provide a working example that is
 // composable enough to handle many common cases.
 //
@@ -137,18 +242,7 @@ struct piece_generator {
   // failure, such as when there's nothing left to parse, returns `false`.
   [[nodiscard]] static bool more_pieces(std::string_view& part,
       opt_string_view& whole, find_delim_cb finder, filter_piece_cb filter) {
-    for (;;) {
-      if (whole.null()) return false;
-      auto [pos, next] = finder(whole);
-      auto opt_part = filter(whole.substr(0, pos));
-      if (pos == npos)
-        whole = std::nullopt;
-      else
-        whole.remove_prefix(next);
-      if (!opt_part) continue;
-      part = *opt_part;
-      return true;
-    }
+    return details::next_piece(part, whole, finder, filter);
   }
 
   // Fills `part` with the next piece and returns `true`. On failure, such as
@@ -181,6 +275,346 @@ template<typename R = std::string_view>
   return parts;
 }
 
+//
+// Split view
+//
+
+// Finder for `split_view` that splits on any of the characters of a `delim`.
+struct delim_finder {
+  delim d;
+
+  [[nodiscard]] constexpr std::pair<size_t, size_t>
+  operator()(std::string_view s) const {
+    const auto pos = d.find_in(s);
+    return {pos, pos + 1};
+  }
+};
+
+// Filter for `split_view` that keeps every piece as is.
+struct keep_piece {
+  [[nodiscard]] constexpr opt_string_view
+  operator()(std::string_view s) const noexcept {
+    return s;
+  }
+};
+
+// Lazy view of the pieces of `whole`, which are found on demand, one
+// increment at a time, without allocating. Models `std::ranges::forward_range`
+// of `std::string_view`.
+//
+// The `finder` and `filter` work just as the callbacks of `piece_generator`,
+// and the pieces are the same, but since they're template parameters instead
+// of `std::function`, they can be inlined. By default, `finder` splits on a
+// `delim`, so that:
+//
+//   for (auto line : split_view{text, "\n"}) process(line);
+//
+// visits each line. When constructed from a `delim`, an empty `whole` has no
+// pieces, as with `split`. Otherwise, as with `piece_generator`, only a null
+// `whole` has none, while an empty one is a single, empty piece.
+//
+// Iterators refer to the view, so it must outlive them. If the `filter`
+// returns views into a buffer of its own, then each piece is only valid until
+// the next increment.
+template<typename F = delim_finder, typename P = keep_piece>
+requires std::invocable<const F&, std::string_view> &&
+         std::invocable<const P&, std::string_view>
+class split_view: public std::ranges::view_interface<split_view<F, P>> {
+public:
+  class iterator {
+  public:
+    // Pieces are returned by value, so this is only a forward iterator as far
+    // as ranges are concerned.
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view*;
+    using reference = std::string_view;
+
+    constexpr iterator() = default;
+    constexpr iterator(const split_view* owner, opt_string_view whole)
+        : owner_{owner}, rest_{whole} {
+      ++*this;
+    }
+
+    [[nodiscard]] constexpr reference operator*() const noexcept {
+      return piece_;
+    }
+    [[nodiscard]] constexpr pointer operator->() const noexcept {
+      return &piece_;
+    }
+
+    constexpr iterator& operator++() {
+      done_ = !details::next_piece(piece_, rest_, owner_->finder_,
+          owner_->filter_);
+      return *this;
+    }
+    constexpr iterator operator++(int) {
+      auto old = *this;
+      ++*this;
+      return old;
+    }
+
+    // Iterators are at the same piece when what remains is the same.
+    [[nodiscard]] friend constexpr bool
+    operator==(const iterator& l, const iterator& r) noexcept {
+      if (l.done_ || r.done_) return l.done_ == r.done_;
+      return l.rest_.null() == r.rest_.null() &&
+             l.rest_.data() == r.rest_.data() &&
+             l.rest_.size() == r.rest_.size();
+    }
+    [[nodiscard]] friend constexpr bool
+    operator==(const iterator& it, std::default_sentinel_t) noexcept {
+      return it.done_;
+    }
+
+  private:
+    const split_view* owner_{};
+    opt_string_view rest_{};
+    std::string_view piece_{};
+    bool done_{true};
+  };
+
+  constexpr split_view() = default;
+  constexpr explicit split_view(opt_string_view whole, F finder = {},
+      P filter = {})
+      : whole_{whole}, finder_{std::move(finder)}, filter_{std::move(filter)} {
+  }
+  constexpr split_view(std::string_view whole, delim d)
+  requires std::same_as<F, delim_finder>
+      : whole_{whole.empty() ? opt_string_view{} : opt_string_view{whole}},
+        finder_{d} {}
+
+  [[nodiscard]] constexpr iterator begin() const { return {this, whole_}; }
+  [[nodiscard]] constexpr std::default_sentinel_t end() const noexcept {
+    return {};
+  }
+
+private:
+  opt_string_view whole_{};
+  [[no_unique_address]] F finder_{};
+  [[no_unique_address]] P filter_{};
+};
+
+// Deduction guides.
+split_view(std::string_view, delim) -> split_view<>;
+
+template<typename F, typename P = keep_piece>
+requires std::invocable<const F&, std::string_view>
+split_view(opt_string_view, F, P = {}) -> split_view<F, P>;
+
+//
+// Field splitter
+//
+
+// Format of delimited fields, such as CSV or TSV.
+//
+// - `delimiter` separates fields.
+// - `quote`, if not '\0', encloses a field that may contain delimiters,
+// newlines, and quotes, which are doubled.
+// - `escape`, if not '\0', makes the next character literal, inside or
+// outside of quotes.
+// - `records`, when set, makes a newline, optionally preceded by a '\r', end
+// the record, as well as the field.
+struct field_format {
+  char delimiter{','};
+  char quote{'"'};
+  char escape{'\0'};
+  bool records{true};
+};
+
+// RFC 4180 CSV, with doubled quotes but no backslash escapes.
+inline constexpr field_format csv_format{};
+// TSV, with backslash escapes instead of quotes.
+inline constexpr field_format tsv_format{'\t', '\0', '\\'};
+
+// PieceGenerator that splits delimited fields, understanding quotes and
+// escapes, so that a field can contain delimiters, newlines, and quotes.
+//
+// Fields that need no unescaping are returned as views into `whole`, without
+// their enclosing quotes. Only those that contain a doubled quote or an escape
+// are unescaped, into a buffer that is sized to `whole` the first time it's
+// needed, so that it never reallocates and the views into it stay valid for
+// the life of the splitter. To keep them valid after that, such as when
+// passing the splitter by value to `split`, pass in a `scratch` string, whose
+// contents are replaced.
+//
+// Each character is classified with a table lookup, so a field is scanned to
+// its end without looking at the format more than once.
+//
+// With `records`, `at_record_end` says whether the last field ended its
+// record. A final newline doesn't start another record.
+//
+// Malformed input is handled leniently: anything after a closing quote,
+// up to the delimiter, is appended to the field, and an unclosed quote runs
+// to the end.
+//
+// Usage:
+//   field_splitter fields{line};
+//   for (std::string_view field; fields.more_pieces(field);) use(field);
+class field_splitter {
+public:
+  explicit field_splitter(std::string_view whole,
+      const field_format& format = csv_format, std::string* scratch = nullptr)
+      : whole_{whole}, format_{format}, scratch_{scratch},
+        done_{whole.empty()} {
+    classes_[as_index(format.delimiter)] |= delimiter_class;
+    if (format.quote) classes_[as_index(format.quote)] |= quote_class;
+    if (format.escape) classes_[as_index(format.escape)] |= escape_class;
+    if (format.records) classes_[as_index('\n')] |= newline_class;
+  }
+
+  // Fills `part` with the next field and returns `true`. On failure, such as
+  // when there's nothing left to parse, returns `false`.
+  [[nodiscard]] bool more_pieces(std::string_view& part) {
+    if (done_) return false;
+    part = whole_.substr(pos_, 0);
+    unescaping_ = false;
+    const bool quoted =
+        pos_ < whole_.size() && (class_of(whole_[pos_]) & quote_class);
+    if (quoted) {
+      ++pos_;
+      part = whole_.substr(pos_, 0);
+      scan_quoted(part);
+    }
+    scan_unquoted(part);
+    return true;
+  }
+
+  // Whether the last field returned ended its record.
+  [[nodiscard]] bool at_record_end() const noexcept { return record_end_; }
+
+  // Whether all fields have been returned.
+  [[nodiscard]] bool done() const noexcept { return done_; }
+
+private:
+  static constexpr uint8_t delimiter_class = 1;
+  static constexpr uint8_t quote_class = 2;
+  static constexpr uint8_t escape_class = 4;
+  static constexpr uint8_t newline_class = 8;
+
+  std::string_view whole_;
+  field_format format_;
+  std::string* scratch_;
+  std::unique_ptr<char[]> owned_scratch_;
+  char* scratch_data_{};
+  size_t scratch_used_{};
+  size_t pos_{};
+  bool done_;
+  bool record_end_{};
+  bool unescaping_{};
+  std::array<uint8_t, 256> classes_{};
+
+  [[nodiscard]] static constexpr size_t as_index(char ch) noexcept {
+    return static_cast<unsigned char>(ch);
+  }
+  [[nodiscard]] uint8_t class_of(char ch) const noexcept {
+    return classes_[as_index(ch)];
+  }
+
+  // Append `len` characters at `from` to `part`. While `part` is a view into
+  // `whole`, and is just being extended, this is free.
+  void extend(std::string_view& part, size_t from, size_t len) {
+    if (!len) return;
+    if (!unescaping_) {
+      if (part.data() + part.size() == whole_.data() + from) {
+        part = {part.data(), part.size() + len};
+        return;
+      }
+      start_unescaping(part);
+    }
+    std::char_traits<char>::copy(scratch_data_ + scratch_used_,
+        whole_.data() + from, len);
+    scratch_used_ += len;
+    part = {part.data(), part.size() + len};
+  }
+
+  // Move `part` into the scratch buffer, so that it can be added to.
+  void start_unescaping(std::string_view& part) {
+    if (!scratch_data_) {
+      if (scratch_) {
+        scratch_->assign(whole_.size(), '\0');
+        scratch_data_ = scratch_->data();
+      } else {
+        owned_scratch_ = std::make_unique<char[]>(whole_.size());
+        scratch_data_ = owned_scratch_.get();
+      }
+    }
+    auto start = scratch_data_ + scratch_used_;
+    std::char_traits<char>::copy(start, part.data(), part.size());
+    scratch_used_ += part.size();
+    part = {start, part.size()};
+    unescaping_ = true;
+  }
+
+  // Scan the inside of a quoted field, leaving `pos_` past the closing
+  // quote.
+  void scan_quoted(std::string_view& part) {
+    for (;;) {
+      auto next = pos_;
+      while (next < whole_.size() &&
+             !(class_of(whole_[next]) & (quote_class | escape_class)))
+        ++next;
+      extend(part, pos_, next - pos_);
+      pos_ = next;
+      if (pos_ >= whole_.size()) return;
+      if (class_of(whole_[pos_]) & escape_class) {
+        if (++pos_ < whole_.size()) {
+          start_unescaping_if(part);
+          extend(part, pos_++, 1);
+        }
+        continue;
+      }
+      // A quote, which is doubled or closing.
+      if (++pos_ < whole_.size() && whole_[pos_] == format_.quote) {
+        start_unescaping_if(part);
+        extend(part, pos_++, 1);
+        continue;
+      }
+      return;
+    }
+  }
+
+  // Scan to the end of the field, then past its delimiter or newline.
+  void scan_unquoted(std::string_view& part) {
+    for (;;) {
+      auto next = pos_;
+      while (next < whole_.size() &&
+             !(class_of(whole_[next]) &
+                 (delimiter_class | escape_class | newline_class)))
+        ++next;
+      auto len = next - pos_;
+      if (len && next < whole_.size() &&
+          (class_of(whole_[next]) & newline_class) && whole_[next - 1] == '\r')
+        --len;
+      extend(part, pos_, len);
+      pos_ = next;
+      if (pos_ >= whole_.size()) {
+        done_ = true;
+        record_end_ = true;
+        return;
+      }
+      const auto cls = class_of(whole_[pos_]);
+      if (cls & escape_class) {
+        if (++pos_ < whole_.size()) {
+          start_unescaping_if(part);
+          extend(part, pos_++, 1);
+        }
+        continue;
+      }
+      ++pos_;
+      record_end_ = cls & newline_class;
+      if (record_end_) done_ = pos_ == whole_.size();
+      return;
+    }
+  }
+
+  void start_unescaping_if(std::string_view& part) {
+    if (!unescaping_) start_unescaping(part);
+  }
+};
+
 // TODO: Write helper in "locating.h" to take a `location` and return a
 // begin/end pair for the thing found. This is needed for adapting multi-value
 // `locate`. Maybe promote it to a type, like position_range?
@@ -18,6 +18,8 @@
 #include "strings_shared.h"
 #include "delimiting.h"
 
+#include <memory>
+
 namespace corvid::strings { inline namespace streaming {
 
 //
@@ -84,4 +86,109 @@ private:
   std::streambuf* rdbuf_;
 };
 
+// Stream buffer that fills a fixed-size chunk and hands it to `flush` when
+// it's full, when synced, and when destroyed. Writes too big to fit in a
+// chunk are handed over directly, without copying.
+//
+// If `flush` returns false, the write fails, so the stream goes bad.
+class chunked_streambuf: public std::streambuf {
+public:
+  using flush_fn = std::function<bool(std::string_view)>;
+  static constexpr size_t default_chunk_size = 64 * 1024;
+
+  explicit chunked_streambuf(flush_fn flush,
+      size_t chunk_size = default_chunk_size)
+      : flush_{std::move(flush)},
+        buffer_{std::make_unique<char[]>(std::max<size_t>(chunk_size, 1))} {
+    setp(buffer_.get(), buffer_.get() + std::max<size_t>(chunk_size, 1));
+  }
+
+  chunked_streambuf(const chunked_streambuf&) = delete;
+  chunked_streambuf& operator=(const chunked_streambuf&) = delete;
+
+  ~chunked_streambuf() override { sync(); }
+
+  // Total size handed to `flush` so far.
+  [[nodiscard]] size_t flushed() const noexcept { return flushed_; }
+
+protected:
+  int_type overflow(int_type ch) override {
+    if (!flush_pending()) return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    if (n > epptr() - pptr()) {
+      if (!flush_pending()) return 0;
+      if (n >= epptr() - pbase())
+        return hand_over({s, static_cast<size_t>(n)}) ? n : 0;
+    }
+    traits_type::copy(pptr(), s, static_cast<size_t>(n));
+    pbump(static_cast<int>(n));
+    return n;
+  }
+
+  int sync() override { return flush_pending() ? 0 : -1; }
+
+private:
+  flush_fn flush_;
+  std::unique_ptr<char[]> buffer_;
+  size_t flushed_{};
+
+  bool flush_pending() {
+    const auto len = static_cast<size_t>(pptr() - pbase());
+    if (!len) return true;
+    setp(pbase(), epptr());
+    return hand_over({pbase(), len});
+  }
+
+  bool hand_over(std::string_view chunk) {
+    flushed_ += chunk.size();
+    return flush_(chunk);
+  }
+};
+
+// Output stream that writes in fixed-size chunks, through a
+// `chunked_streambuf`, to a callback or another stream.
+//
+// Since it's a `std::ostream`, it's an AppendTarget, so it lets the `append`
+// and `append_join` functions, such as `append_json`, emit output of any size
+// in bounded memory.
+//
+// Usage:
+//   chunked_ostream os{[&](std::string_view chunk) { return send(chunk); }};
+//   strings::append_json(os, huge_map);
+class chunked_ostream: public std::ostream {
+public:
+  using flush_fn = chunked_streambuf::flush_fn;
+  static constexpr size_t default_chunk_size =
+      chunked_streambuf::default_chunk_size;
+
+  explicit chunked_ostream(flush_fn flush,
+      size_t chunk_size = default_chunk_size)
+      : std::ostream{nullptr}, buf_{std::move(flush), chunk_size} {
+    rdbuf(&buf_);
+  }
+
+  // Write chunks to `os`, which must outlive this.
+  explicit chunked_ostream(std::ostream& os,
+      size_t chunk_size = default_chunk_size)
+      : chunked_ostream{[&os](std::string_view chunk) {
+                          return !!os.write(chunk.data(), chunk.size());
+                        },
+            chunk_size} {}
+
+  ~chunked_ostream() override { flush(); }
+
+  // Total size handed off so far.
+  [[nodiscard]] size_t flushed() const noexcept { return buf_.flushed(); }
+
+private:
+  chunked_streambuf buf_;
+};
+
 }} // namespace corvid::strings::streaming
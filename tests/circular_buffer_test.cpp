@@ -16,7 +16,12 @@
 // limitations under the License.
 
 #include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 #include "../corvid/containers.h"
 #include "AccutestShim.h"
@@ -528,6 +533,516 @@ void CircularBufferTest_Smoke() {
   }
 }
 
+void CircularBufferTest_Bulk() {
+  if (true) {
+    std::array<int, 5> a{};
+    circular_buffer cb{a};
+    const std::array<int, 3> in{1, 2, 3};
+    EXPECT_EQ(cb.try_push_back_range(in), 3u);
+    EXPECT_EQ(cb.try_push_back_range(in), 2u);
+    EXPECT_TRUE(cb.full());
+    EXPECT_EQ(cb.try_push_back_range(in), 0u);
+    auto [first, second] = cb.segments();
+    EXPECT_EQ(first.size(), 5u);
+    EXPECT_TRUE(second.empty());
+
+    std::array<int, 2> out{};
+    EXPECT_EQ(cb.pop_front_into(out), 2u);
+    EXPECT_EQ(out, (std::array{1, 2}));
+    EXPECT_EQ(cb.size(), 3u);
+
+    // Now it wraps.
+    EXPECT_EQ(cb.try_push_back_range(std::array{7, 8}), 2u);
+    const auto& ccb = cb;
+    auto [cfirst, csecond] = ccb.segments();
+    EXPECT_EQ(std::vector(cfirst.begin(), cfirst.end()),
+        (std::vector{3, 1, 2}));
+    EXPECT_EQ(std::vector(csecond.begin(), csecond.end()),
+        (std::vector{7, 8}));
+    EXPECT_TRUE(cfirst.data() == a.data() + 2);
+    EXPECT_TRUE(csecond.data() == a.data());
+
+    std::array<int, 8> all{};
+    EXPECT_EQ(cb.pop_front_into(all), 5u);
+    EXPECT_EQ(all, (std::array{3, 1, 2, 7, 8, 0, 0, 0}));
+    EXPECT_TRUE(cb.empty());
+    EXPECT_EQ(cb.pop_front_into(all), 0u);
+    EXPECT_TRUE(cb.segments()[0].empty());
+    cb.push_back(9);
+    EXPECT_EQ(cb.front(), 9);
+    EXPECT_EQ(cb.back(), 9);
+  }
+  if (true) {
+    // Overwriting.
+    std::array<int, 4> a{};
+    circular_buffer cb{a};
+    cb.push_back(1);
+    cb.push_back(2);
+    EXPECT_EQ(cb.push_back_range(std::array{3, 4, 5}), 3u);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()), (std::vector{2, 3, 4, 5}));
+    EXPECT_EQ(cb.push_back_range(std::array{6, 7, 8, 9, 10, 11}), 4u);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()),
+        (std::vector{8, 9, 10, 11}));
+    cb.drop_front_n(3);
+    EXPECT_EQ(cb.front(), 11);
+    cb.push_back(12);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()), (std::vector{11, 12}));
+  }
+  if (true) {
+    // Empty capacity.
+    circular_buffer<int> cb;
+    EXPECT_EQ(cb.push_back_range(std::array{1}), 0u);
+    EXPECT_EQ(cb.try_push_back_range(std::array{1}), 0u);
+    EXPECT_TRUE(cb.segments()[0].empty());
+  }
+}
+
+void Pow2CircularBufferTest_Ops() {
+  if (true) {
+    std::array<int, 4> a{};
+    pow2_circular_buffer cb{a};
+    EXPECT_EQ(cb.capacity(), 4u);
+    EXPECT_TRUE(cb.empty());
+    cb.push_back(1);
+    cb.push_back(2);
+    cb.push_front(0);
+    EXPECT_EQ(cb.size(), 3u);
+    EXPECT_EQ(cb.front(), 0);
+    EXPECT_EQ(cb.back(), 2);
+    EXPECT_EQ(cb[1], 1);
+    EXPECT_EQ(cb.at(2), 2);
+    EXPECT_THROW((void)cb.at(3), std::out_of_range);
+    EXPECT_TRUE(cb.try_push_back(3) != nullptr);
+    EXPECT_TRUE(cb.full());
+    EXPECT_TRUE(cb.try_push_back(4) == nullptr);
+    EXPECT_TRUE(cb.try_emplace_front(4) == nullptr);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()), (std::vector{0, 1, 2, 3}));
+
+    // Overwrite from either end.
+    cb.push_back(4);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()), (std::vector{1, 2, 3, 4}));
+    cb.emplace_front(0);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()), (std::vector{0, 1, 2, 3}));
+    EXPECT_EQ(cb.pop_back(), 3);
+    EXPECT_EQ(cb.pop_front(), 0);
+    EXPECT_EQ(std::vector(cb.cbegin(), cb.cend()), (std::vector{1, 2}));
+    cb.clear();
+    EXPECT_TRUE(cb.empty());
+  }
+  if (true) {
+    // Counters overflow harmlessly.
+    std::array<int, 8> a{};
+    pow2_circular_buffer<int, uint8_t> cb{a};
+    bool ok = true;
+    for (int i = 0; i < 1000; ++i) {
+      cb.push_back(i);
+      if (i >= 8) ok = ok && cb.front() == i - 7 && cb.size() == 8;
+    }
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(cb.end() - cb.begin(), 8);
+    EXPECT_TRUE(cb.begin() < cb.end());
+    EXPECT_EQ(*(cb.begin() + 3), 995);
+    EXPECT_EQ(cb.begin()[7], 999);
+    EXPECT_EQ(std::ranges::count_if(cb, [](int i) { return i % 2; }), 4);
+    for (auto& i : cb) i = -i;
+    EXPECT_EQ(cb.back(), -999);
+  }
+  if (true) {
+    // Bulk operations.
+    std::vector<int> v(4);
+    pow2_circular_buffer cb{v};
+    EXPECT_EQ(cb.try_push_back_range(std::array{1, 2, 3}), 3u);
+    std::array<int, 2> out{};
+    EXPECT_EQ(cb.pop_front_into(out), 2u);
+    EXPECT_EQ(out, (std::array{1, 2}));
+    EXPECT_EQ(cb.try_push_back_range(std::array{4, 5, 6, 7}), 3u);
+    auto [first, second] = cb.segments();
+    EXPECT_EQ(std::vector(first.begin(), first.end()), (std::vector{3, 4}));
+    EXPECT_EQ(std::vector(second.begin(), second.end()), (std::vector{5, 6}));
+    EXPECT_EQ(cb.push_back_range(std::array{8, 9, 10, 11, 12}), 4u);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()),
+        (std::vector{9, 10, 11, 12}));
+    cb.drop_front_n(2);
+    EXPECT_EQ(cb.front(), 11);
+  }
+}
+
+void SpscRingTest_Basic() {
+  if (true) {
+    std::array<int, 4> a{};
+    spsc_ring ring{a};
+    EXPECT_EQ(ring.capacity(), 4u);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(ring.try_push(1));
+    EXPECT_TRUE(ring.try_emplace(2));
+    EXPECT_EQ(ring.try_push_range(std::array{3, 4, 5}), 2u);
+    EXPECT_TRUE(ring.full());
+    EXPECT_FALSE(ring.try_push(6));
+    int i{};
+    EXPECT_TRUE(ring.try_pop(i));
+    EXPECT_EQ(i, 1);
+    EXPECT_TRUE(ring.try_push(5));
+    std::array<int, 8> out{};
+    EXPECT_EQ(ring.try_pop_into(out), 4u);
+    EXPECT_EQ(out, (std::array{2, 3, 4, 5, 0, 0, 0, 0}));
+    EXPECT_FALSE(ring.try_pop(i));
+    EXPECT_EQ(ring.try_pop_into(out), 0u);
+  }
+  if (true) {
+    // Narrow counters, driven well past their wraparound with the ring
+    // nearly full, so every push is partial and must see the wrapped gap.
+    std::array<int, 8> a{};
+    spsc_ring<int, uint8_t> ring{a};
+    EXPECT_EQ(ring.try_push_range(std::array{0, 1, 2, 3, 4, 5}), 6u);
+    std::array<int, 2> out{};
+    int next = 6;
+    int expected = 0;
+    bool in_order = true;
+    for (int round = 0; round < 300; ++round) {
+      const std::array in{next, next + 1, next + 2, next + 3, next + 4};
+      const auto pushed = ring.try_push_range(in);
+      in_order = in_order && pushed == 2u;
+      next += pushed;
+      const auto popped = ring.try_pop_into(out);
+      for (size_t k = 0; k < popped; ++k)
+        in_order = in_order && out[k] == expected++;
+      in_order = in_order && ring.size() == 6u;
+    }
+    EXPECT_TRUE(in_order);
+    EXPECT_EQ(next, 606);
+  }
+  if (true) {
+    // Producer and consumer threads, mixing single and bulk operations.
+    constexpr int count = 200000;
+    std::vector<int> v(64);
+    spsc_ring<int, uint32_t> ring{v};
+    bool in_order = true;
+    std::thread consumer{[&] {
+      int expected = 0;
+      std::array<int, 7> out{};
+      while (expected < count) {
+        int i{};
+        if (expected % 2 && ring.try_pop(i)) {
+          in_order = in_order && i == expected++;
+          continue;
+        }
+        const auto n = ring.try_pop_into(out);
+        for (size_t k = 0; k < n; ++k)
+          in_order = in_order && out[k] == expected++;
+      }
+    }};
+    std::array<int, 5> batch{};
+    for (int next = 0; next < count;) {
+      if (next % 3) {
+        if (ring.try_push(next)) ++next;
+        continue;
+      }
+      const auto size = std::min<int>(batch.size(), count - next);
+      for (int k = 0; k < size; ++k) batch[k] = next + k;
+      next += ring.try_push_range(std::span{batch}.first(size));
+    }
+    consumer.join();
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(ring.empty());
+  }
+}
+
+void MpmcRingTest_Basic() {
+  if (true) {
+    mpmc_ring<std::string> ring{3};
+    EXPECT_EQ(ring.capacity(), 4u);
+    EXPECT_TRUE(ring.try_push("a"s));
+    const auto b = "b"s;
+    EXPECT_TRUE(ring.try_push(b));
+    EXPECT_TRUE(ring.try_emplace(2, 'c'));
+    EXPECT_EQ(ring.size(), 3u);
+    std::array<std::string, 3> in{"d", "e", "f"};
+    EXPECT_EQ(ring.try_push_range(in), 1u);
+    std::string s;
+    EXPECT_TRUE(ring.try_pop(s));
+    EXPECT_EQ(s, "a");
+    std::array<std::string, 4> out;
+    EXPECT_EQ(ring.try_pop_into(out), 3u);
+    EXPECT_EQ(out, (std::array<std::string, 4>{"b", "cc", "d", ""}));
+    EXPECT_FALSE(ring.try_pop(s));
+    EXPECT_TRUE(ring.empty());
+  }
+  if (true) {
+    // Multiple producers and consumers. Every value arrives exactly once.
+    constexpr size_t producers = 3;
+    constexpr size_t consumers = 3;
+    constexpr size_t per_producer = 50000;
+    mpmc_ring<size_t> ring{128};
+    std::atomic<size_t> consumed{};
+    std::vector<std::vector<size_t>> received(consumers);
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+      threads.emplace_back([&, p] {
+        for (size_t i = 0; i < per_producer;)
+          if (ring.try_push(p * per_producer + i)) ++i;
+      });
+    for (size_t c = 0; c < consumers; ++c)
+      threads.emplace_back([&, c] {
+        std::array<size_t, 4> out{};
+        while (consumed.load() < producers * per_producer) {
+          const auto n = ring.try_pop_into(out);
+          received[c].insert(received[c].end(), out.begin(), out.begin() + n);
+          consumed += n;
+        }
+      });
+    for (auto& thread : threads) thread.join();
+    std::vector<size_t> all;
+    for (auto& r : received) all.insert(all.end(), r.begin(), r.end());
+    std::ranges::sort(all);
+    bool exactly_once = all.size() == producers * per_producer;
+    for (size_t i = 0; exactly_once && i < all.size(); ++i)
+      exactly_once = all[i] == i;
+    EXPECT_TRUE(exactly_once);
+  }
+}
+
+void CircularBufferTest_Window() {
+  if (true) {
+    // Keep the last 5 samples.
+    std::array<int, 5> a{};
+    circular_buffer cb{a};
+    for (int i = 1; i <= 7; ++i) cb.push_back(i);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()),
+        (std::vector{3, 4, 5, 6, 7}));
+
+    auto [first, second] = cb.back_segments(3);
+    EXPECT_EQ(std::vector(first.begin(), first.end()), (std::vector{5}));
+    EXPECT_EQ(std::vector(second.begin(), second.end()), (std::vector{6, 7}));
+    auto [nfirst, nsecond] = cb.back_segments(1);
+    EXPECT_EQ(std::vector(nfirst.begin(), nfirst.end()), (std::vector{7}));
+    EXPECT_TRUE(nsecond.empty());
+    const auto& ccb = cb;
+    EXPECT_EQ(ccb.back_segments(10)[0].size(), 3u);
+    EXPECT_EQ(ccb.back_segments(4)[0].size(), 2u);
+
+    auto window = cb.linearize();
+    EXPECT_EQ(std::vector(window.begin(), window.end()),
+        (std::vector{3, 4, 5, 6, 7}));
+    EXPECT_TRUE(window.data() == a.data());
+    EXPECT_EQ(a, (std::array{3, 4, 5, 6, 7}));
+    EXPECT_EQ(cb.front(), 3);
+    EXPECT_EQ(cb.back(), 7);
+    cb.push_back(8);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()),
+        (std::vector{4, 5, 6, 7, 8}));
+
+    // Already contiguous, so nothing moves.
+    cb.pop_front();
+    cb.pop_back();
+    cb.pop_front();
+    window = cb.linearize();
+    EXPECT_EQ(std::vector(window.begin(), window.end()),
+        (std::vector{6, 7}));
+    EXPECT_TRUE(window.data() == a.data() + 3);
+  }
+  if (true) {
+    std::array<int, 4> a{};
+    pow2_circular_buffer cb{a};
+    for (int i = 1; i <= 6; ++i) cb.push_back(i);
+    auto [first, second] = cb.back_segments(3);
+    EXPECT_EQ(std::vector(first.begin(), first.end()), (std::vector{4}));
+    EXPECT_EQ(std::vector(second.begin(), second.end()), (std::vector{5, 6}));
+    auto window = cb.linearize();
+    EXPECT_EQ(std::vector(window.begin(), window.end()),
+        (std::vector{3, 4, 5, 6}));
+    EXPECT_TRUE(window.data() == a.data());
+    cb.push_back(7);
+    EXPECT_EQ(std::vector(cb.begin(), cb.end()), (std::vector{4, 5, 6, 7}));
+    EXPECT_EQ(cb.linearize().size(), 4u);
+    EXPECT_EQ(cb.front(), 4);
+  }
+}
+
+void CircularBufferTest_Spare() {
+  if (true) {
+    std::array<char, 8> a{};
+    circular_buffer cb{a};
+    auto [first, second] = cb.spare_segments();
+    EXPECT_EQ(first.size(), 8u);
+    EXPECT_TRUE(second.empty());
+    std::memcpy(first.data(), "abcdef", 6);
+    cb.commit_back_n(6);
+    EXPECT_EQ(std::string(cb.begin(), cb.end()), "abcdef");
+    cb.drop_front_n(4);
+
+    // The free space wraps around.
+    auto [f2, s2] = cb.spare_segments();
+    EXPECT_EQ(f2.size(), 2u);
+    EXPECT_EQ(s2.size(), 4u);
+    EXPECT_TRUE(s2.data() == a.data());
+    std::memcpy(f2.data(), "gh", 2);
+    std::memcpy(s2.data(), "ij", 2);
+    cb.commit_back_n(4);
+    EXPECT_EQ(std::string(cb.begin(), cb.end()), "efghij");
+    EXPECT_EQ(cb.back(), 'j');
+    cb.push_back('k');
+    EXPECT_EQ(std::string(cb.begin(), cb.end()), "efghijk");
+    cb.commit_back_n(0);
+    EXPECT_EQ(cb.spare_segments()[0].size(), 1u);
+    cb.push_back('l');
+    EXPECT_EQ(cb.spare_segments()[0].size() + cb.spare_segments()[1].size(),
+        0u);
+  }
+  if (true) {
+    std::array<char, 8> a{};
+    pow2_circular_buffer cb{a};
+    std::memcpy(cb.spare_segments()[0].data(), "abcdef", 6);
+    cb.commit_back_n(6);
+    cb.drop_front_n(5);
+    auto [first, second] = cb.spare_segments();
+    EXPECT_EQ(first.size(), 2u);
+    EXPECT_EQ(second.size(), 5u);
+    std::memcpy(first.data(), "gh", 2);
+    std::memcpy(second.data(), "ijk", 3);
+    cb.commit_back_n(5);
+    EXPECT_EQ(std::string(cb.begin(), cb.end()), "fghijk");
+    EXPECT_EQ(cb.back(), 'k');
+  }
+}
+
+void RingDequeTest_Basic() {
+  if (true) {
+    ring_deque<int> d;
+    EXPECT_TRUE(d.empty());
+    EXPECT_EQ(d.capacity(), 0u);
+    d.push_back(1);
+    d.push_front(0);
+    EXPECT_EQ(d.capacity(), ring_deque<int>::min_capacity);
+    EXPECT_EQ(d.front(), 0);
+    EXPECT_EQ(d.back(), 1);
+    EXPECT_EQ(d.at(1), 1);
+    EXPECT_THROW((void)d.at(2), std::out_of_range);
+
+    // Grow while wrapped, which relinearizes before pushing, so the new
+    // front is the only element at the end of the storage.
+    for (int i = 1; i <= 7; ++i) d.push_front(-i);
+    EXPECT_EQ(d.size(), 9u);
+    EXPECT_EQ(d.capacity(), 16u);
+    EXPECT_EQ(d.front(), -7);
+    EXPECT_EQ(d.back(), 1);
+    EXPECT_EQ(std::vector(d.begin(), d.end()),
+        (std::vector{-7, -6, -5, -4, -3, -2, -1, 0, 1}));
+    auto [first, second] = d.segments();
+    EXPECT_EQ(first.size(), 1u);
+    EXPECT_EQ(second.size(), 8u);
+    EXPECT_EQ(first[0] + second[0], -13);
+    d.push_front(-8);
+    EXPECT_EQ(d.segments()[0].size(), 2u);
+    d.pop_front();
+    d.pop_back();
+    EXPECT_EQ(d.size(), 8u);
+    EXPECT_EQ(d[7], 0);
+    EXPECT_EQ(d.end() - d.begin(), 8);
+    EXPECT_EQ(*(d.begin() + 2), -5);
+    EXPECT_EQ(std::ranges::count_if(d, [](int i) { return i % 2; }), 4);
+    d.shrink_to_fit();
+    EXPECT_EQ(d.capacity(), 8u);
+    EXPECT_EQ(d.front(), -7);
+    d.clear();
+    EXPECT_TRUE(d.empty());
+    d.shrink_to_fit();
+    EXPECT_EQ(d.capacity(), 0u);
+  }
+  if (true) {
+    // Iterators made before and after changes at the front agree, as long
+    // as nothing grows.
+    ring_deque<int> d{1, 2, 3, 4, 5};
+    EXPECT_EQ(d.capacity(), 8u);
+    const auto it = d.begin() + 1;
+    d.pop_front();
+    auto b = d.begin();
+    EXPECT_TRUE(b == it);
+    EXPECT_EQ(b - it, 0);
+    EXPECT_EQ(d.end() - it, 4);
+    EXPECT_TRUE(it < d.end());
+    EXPECT_FALSE(b < it);
+    d.push_front(0);
+    d.push_front(-1);
+    b = d.begin();
+    EXPECT_EQ(it - b, 2);
+    EXPECT_TRUE(b < it);
+    EXPECT_TRUE(it > b);
+    EXPECT_EQ(*it, 2);
+    EXPECT_EQ(b[2], 2);
+    EXPECT_EQ(d.end() - it, 4);
+    EXPECT_EQ(d.end() - b, 6);
+
+    // Mutable iterators convert to const ones, and compare with them.
+    ring_deque<int>::const_iterator c = b;
+    EXPECT_TRUE(c == d.begin());
+    EXPECT_TRUE(d.cbegin() == d.begin());
+    EXPECT_TRUE(d.cend() == d.end());
+    EXPECT_EQ(d.cend() - d.begin(), 6);
+    EXPECT_TRUE(d.begin() < d.cend());
+    static_assert(!std::is_convertible_v<ring_deque<int>::const_iterator,
+                  ring_deque<int>::iterator>);
+  }
+  if (true) {
+    // Reserving more than `max_size` throws, rather than overflowing.
+    ring_deque<int> d{1, 2};
+    EXPECT_THROW(d.reserve(d.max_size() + 1), std::length_error);
+    EXPECT_THROW(d.reserve(std::numeric_limits<size_t>::max()),
+        std::length_error);
+    EXPECT_EQ(d.capacity(), 8u);
+    EXPECT_EQ(d.back(), 2);
+  }
+  if (true) {
+    // Elements are constructed and destroyed, not assigned.
+    ring_deque<std::string> d{"b"s, "c"s};
+    d.emplace_front(3, 'a');
+    EXPECT_EQ(d.front(), "aaa");
+    for (int i = 0; i < 20; ++i) d.push_back(std::to_string(i));
+    // Pushing a copy of an element survives the growth it causes.
+    while (d.size() < d.capacity()) d.push_back("x"s);
+    d.push_back(d.front());
+    EXPECT_EQ(d.back(), "aaa");
+    auto copy = d;
+    EXPECT_TRUE(copy == d);
+    copy.pop_front();
+    EXPECT_FALSE(copy == d);
+    auto moved = std::move(copy);
+    EXPECT_EQ(moved.front(), "b");
+    swap(moved, d);
+    EXPECT_EQ(d.front(), "b");
+    EXPECT_EQ(moved.front(), "aaa");
+  }
+  if (true) {
+    // Same results as `std::deque`.
+    ring_deque<int> d;
+    std::deque<int> expected;
+    bool ok = true;
+    uint32_t seed = 1;
+    for (int i = 0; i < 5000; ++i) {
+      seed = seed * 1664525 + 1013904223;
+      switch (seed >> 30) {
+      case 0: d.push_back(i), expected.push_back(i); break;
+      case 1: d.push_front(i), expected.push_front(i); break;
+      case 2:
+        if (!expected.empty()) d.pop_front(), expected.pop_front();
+        break;
+      case 3:
+        if (!expected.empty()) d.pop_back(), expected.pop_back();
+        break;
+      }
+      ok = ok && d.size() == expected.size() &&
+           (expected.empty() ||
+               (d.front() == expected.front() && d.back() == expected.back()));
+    }
+    EXPECT_TRUE(ok);
+    EXPECT_TRUE(std::ranges::equal(d, expected));
+    d.append_range(std::vector{1, 2, 3});
+    EXPECT_EQ(d.back(), 3);
+  }
+}
+
 MAKE_TEST_LIST(CircularBufferTest_Construction, CircularBufferTest_WrapIndex,
     CircularBufferTest_Ops, CircularBufferTest_PushPop,
-    CircularBufferTest_Iterate, CircularBufferTest_Smoke);
+    CircularBufferTest_Iterate, CircularBufferTest_Smoke,
+    CircularBufferTest_Bulk, Pow2CircularBufferTest_Ops, SpscRingTest_Basic,
+    MpmcRingTest_Basic, CircularBufferTest_Window, CircularBufferTest_Spare,
+    RingDequeTest_Basic);
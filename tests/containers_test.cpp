@@ -16,10 +16,16 @@
 // limitations under the License.
 
 #include <cstdint>
+#include <cstring>
+#include <latch>
 #include <map>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <vector>
 
+#define CORVID_ARENA_STATS 1
+#define CORVID_INSTRUMENTATION 1
 #include "../corvid/containers.h"
 #include "AccutestShim.h"
 
@@ -580,6 +586,236 @@ void IntervalTest_Append() {
   }
 }
 
+enum class weekday { mon = 1, tue, wed, thu, fri, sat, sun };
+
+template<>
+constexpr inline auto registry::enum_spec_v<weekday> =
+    make_sequence_enum_spec<weekday, "mon, tue, wed, thu, fri, sat, sun",
+        wrapclip{}, weekday::mon>();
+
+enum class perm { none, x = 1, w = 2, r = 4 };
+
+template<>
+constexpr inline auto registry::enum_spec_v<perm> =
+    bitmask::make_bitmask_enum_spec<perm, "r, w, x">();
+
+enum class wide_seq : uint8_t {};
+
+template<>
+constexpr inline auto registry::enum_spec_v<wide_seq> =
+    make_sequence_enum_spec<wide_seq, wide_seq{129}>();
+
+constexpr bool enum_containers_in_constexpr() {
+  enum_set<weekday> days{weekday::tue, weekday::sun};
+  enum_map<weekday, int> hours;
+  hours[weekday::mon] = 8;
+  hours.try_emplace(weekday::fri, 6);
+  hours.erase(weekday::mon);
+  return days.size() == 2 && hours.size() == 1 &&
+         hours.at(weekday::fri) == 6;
+}
+
+void EnumContainerTest_Basic() {
+  static_assert(enum_containers_in_constexpr());
+  if (true) {
+    enum_set<weekday> days;
+    EXPECT_TRUE(days.empty());
+    EXPECT_EQ(days.max_size(), 7u);
+    EXPECT_TRUE(days.insert(weekday::fri).second);
+    EXPECT_FALSE(days.insert(weekday::fri).second);
+    days.insert(weekday::mon);
+    EXPECT_EQ(days.size(), 2u);
+    EXPECT_TRUE(days.contains(weekday::mon));
+    EXPECT_FALSE(days.contains(weekday::tue));
+    EXPECT_FALSE(days.contains(weekday{0}));
+    EXPECT_FALSE(days.contains(weekday{8}));
+    EXPECT_EQ(strings::join(days), "[mon, fri]");
+    EXPECT_THROW(days.insert(weekday{8}), std::out_of_range);
+
+    // Interoperates with intervals.
+    const enum_set<weekday> all{make_interval<weekday>()};
+    EXPECT_TRUE(all == enum_set<weekday>::all());
+    EXPECT_EQ(all.size(), 7u);
+    const auto weekend = ~enum_set<weekday>{interval{weekday::mon,
+        weekday::fri}};
+    EXPECT_EQ(strings::join(weekend), "[sat, sun]");
+    EXPECT_EQ(strings::join(weekend | days), "[mon, fri, sat, sun]");
+    EXPECT_TRUE((weekend & days).empty());
+    EXPECT_EQ(strings::join(all - weekend - days), "[tue, wed, thu]");
+    EXPECT_EQ(days.erase(weekday::mon), 1u);
+    EXPECT_EQ(days.erase(weekday::mon), 0u);
+    EXPECT_TRUE(days.find(weekday::fri) != days.end());
+    EXPECT_TRUE(days.find(weekday::mon) == days.end());
+  }
+  if (true) {
+    // Bitmask enums are indexed by value, and sets may span words.
+    enum_set<perm> perms{perm::r, perm{6}, perm::none};
+    EXPECT_EQ(perms.max_size(), 8u);
+    EXPECT_EQ(strings::join(perms), "[0x00000000, r, r + w]");
+    enum_set<wide_seq> wide{wide_seq{0}, wide_seq{63}, wide_seq{64},
+        wide_seq{129}};
+    EXPECT_EQ(wide.size(), 4u);
+    EXPECT_EQ((~wide).size(), 126u);
+    std::vector<int> seen;
+    for (const auto e : wide) seen.push_back(*e);
+    EXPECT_EQ(strings::join(seen), "[0, 63, 64, 129]");
+  }
+  if (true) {
+    enum_map<weekday, std::string> notes;
+    EXPECT_TRUE(notes.empty());
+    notes[weekday::wed] = "gym";
+    EXPECT_TRUE(notes.try_emplace(weekday::mon, "work").second);
+    EXPECT_FALSE(notes.try_emplace(weekday::mon, "rest").second);
+    EXPECT_FALSE(notes.insert_or_assign(weekday::wed, "swim").second);
+    EXPECT_EQ(notes.size(), 2u);
+    EXPECT_EQ(notes.at(weekday::mon), "work");
+    EXPECT_THROW((void)notes.at(weekday::tue), std::out_of_range);
+    EXPECT_THROW(notes[weekday{9}], std::out_of_range);
+    EXPECT_TRUE(notes.find(weekday{9}) == notes.end());
+    EXPECT_EQ(strings::join(notes.keys()), "[mon, wed]");
+    EXPECT_EQ(strings::join<strings::join_opt::json>(notes),
+        R"({"mon": "work", "wed": "swim"})");
+
+    std::vector<std::string> values;
+    for (auto& [day, note] : notes) {
+      note += "!";
+      values.push_back(strings::concat(day, "=", note));
+    }
+    EXPECT_EQ(strings::join(values), "[mon=work!, wed=swim!]");
+
+    auto copy = notes;
+    EXPECT_TRUE(copy == notes);
+    copy.erase(weekday::mon);
+    EXPECT_FALSE(copy == notes);
+    copy = notes;
+    EXPECT_TRUE(copy == notes);
+    auto moved = std::move(copy);
+    EXPECT_TRUE(moved == notes);
+    notes.clear();
+    EXPECT_TRUE(notes.empty());
+    EXPECT_TRUE(notes.begin() == notes.end());
+    EXPECT_EQ(notes[weekday::mon], "");
+  }
+}
+
+void IntervalSetTest_Basic() {
+  using I = interval<int64_t>;
+  if (true) {
+    interval_set<int64_t> s;
+    EXPECT_TRUE(s.empty());
+    s.insert(I{10, 20});
+    s.insert(I{30, 40});
+    EXPECT_EQ(s.size(), 2u);
+    EXPECT_EQ(strings::join(s), "[[10, 20], [30, 40]]");
+
+    // Adjacent intervals coalesce, and overlapping ones merge.
+    s.insert(I{21, 22});
+    EXPECT_EQ(strings::join(s), "[[10, 22], [30, 40]]");
+    const auto it = s.insert(I{15, 35});
+    EXPECT_EQ(s.size(), 1u);
+    EXPECT_EQ(it->min(), 10);
+    EXPECT_EQ(it->max(), 40);
+    s.insert(0);
+    s.insert(I{50, 60});
+    EXPECT_EQ(strings::join(s), "[[0, 0], [10, 40], [50, 60]]");
+    EXPECT_EQ(s.value_count(), 43u);
+    EXPECT_TRUE(s.insert(I{}) == s.end());
+
+    EXPECT_TRUE(s.contains(0));
+    EXPECT_FALSE(s.contains(5));
+    EXPECT_TRUE(s.contains(40));
+    EXPECT_FALSE(s.contains(41));
+    EXPECT_TRUE(s.contains(I{12, 38}));
+    EXPECT_FALSE(s.contains(I{35, 50}));
+    EXPECT_TRUE(s.intersects(I{35, 50}));
+    EXPECT_FALSE(s.intersects(I{41, 49}));
+    EXPECT_EQ(s.find(55)->min(), 50);
+
+    // Erasing splits.
+    EXPECT_EQ(s.erase(I{20, 29}), 10u);
+    EXPECT_EQ(strings::join(s), "[[0, 0], [10, 19], [30, 40], [50, 60]]");
+    EXPECT_EQ(s.erase(I{5, 35}), 16u);
+    EXPECT_EQ(strings::join(s), "[[0, 0], [36, 40], [50, 60]]");
+    EXPECT_EQ(s.erase(I{41, 49}), 0u);
+    EXPECT_EQ(s.erase(0), 1u);
+    EXPECT_EQ(s.erase(I{0, 100}), 16u);
+    EXPECT_TRUE(s.empty());
+  }
+  if (true) {
+    const interval_set<int64_t> a{I{0, 9}, I{20, 29}, I{40, 49}};
+    const interval_set<int64_t> b{I{5, 24}, I{30, 39}, I{45, 45}};
+    EXPECT_EQ(strings::join(a | b), "[[0, 49]]");
+    EXPECT_EQ(strings::join(a & b), "[[5, 9], [20, 24], [45, 45]]");
+    EXPECT_EQ(strings::join(a - b), "[[0, 4], [25, 29], [40, 44], [46, 49]]");
+    EXPECT_EQ(strings::join(b - a), "[[10, 19], [30, 39]]");
+    auto c = a;
+    c -= a;
+    EXPECT_TRUE(c.empty());
+    c |= b;
+    EXPECT_TRUE(c == b);
+    c &= a;
+    EXPECT_TRUE(c == (a & b));
+  }
+  if (true) {
+    // Unsigned values at the bottom of the range.
+    interval_set<uint8_t, int> s{interval<uint8_t, int>{0, 254}};
+    EXPECT_EQ(s.erase(0), 1u);
+    EXPECT_EQ(s.erase(254), 1u);
+    EXPECT_EQ(s.front().min(), 1);
+    EXPECT_EQ(s.back().max(), 253);
+  }
+  if (true) {
+    // Agrees with a set of values.
+    uint32_t seed = 7;
+    const auto next = [&](uint32_t n) {
+      seed = seed * 1103515245 + 12345;
+      return static_cast<int64_t>((seed >> 16) % n);
+    };
+    interval_set<int64_t> s, other;
+    std::set<int64_t> values, other_values;
+    size_t mismatches{};
+    const auto same = [](const interval_set<int64_t>& is,
+                          const std::set<int64_t>& vs) {
+      std::set<int64_t> expanded;
+      int64_t last = std::numeric_limits<int64_t>::min();
+      bool ok = true;
+      for (const auto& i : is) {
+        // Disjoint and coalesced.
+        if (i.empty() || (!expanded.empty() && i.min() <= last + 1))
+          ok = false;
+        for (auto v : i) expanded.insert(v);
+        last = i.max();
+      }
+      return ok && expanded == vs;
+    };
+    for (int step = 0; step < 2000; ++step) {
+      const auto lo = next(200);
+      const auto hi = lo + next(12);
+      auto& target = next(4) ? s : other;
+      auto& target_values = &target == &s ? values : other_values;
+      if (next(3)) {
+        target.insert(I{lo, hi});
+        for (auto v = lo; v <= hi; ++v) target_values.insert(v);
+      } else {
+        size_t erased{};
+        for (auto v = lo; v <= hi; ++v) erased += target_values.erase(v);
+        if (target.erase(I{lo, hi}) != erased) ++mismatches;
+      }
+      if (!same(s, values)) ++mismatches;
+      if (step % 100) continue;
+      std::set<int64_t> u, n, d;
+      std::ranges::set_union(values, other_values, std::inserter(u, u.end()));
+      std::ranges::set_intersection(values, other_values,
+          std::inserter(n, n.end()));
+      std::ranges::set_difference(values, other_values,
+          std::inserter(d, d.end()));
+      if (!same(s | other, u) || !same(s & other, n) || !same(s - other, d))
+        ++mismatches;
+    }
+    EXPECT_EQ(mismatches, 0u);
+  }
+}
+
 void TransparentTest_General() {
   const auto ks = "key"s;
   const auto ksv = "key"sv;
@@ -624,6 +860,181 @@ void TransparentTest_General() {
     EXPECT_TRUE(tss.contains(ks));
     EXPECT_TRUE(tss.contains(ksv));
   }
+  if (true) {
+    // Cached hashes.
+    constexpr auto& ct = strings::hashed_v<"content-type">;
+    static_assert(ct.hash() == strings::fast_hash("content-type"));
+    constexpr transparent_hash_equal_stringlike he;
+    EXPECT_EQ(he(ct), he("content-type"s));
+    EXPECT_TRUE(he(ct, "content-type"s));
+    EXPECT_FALSE(he(ct, strings::hashed_string_view{"content-types"}));
+    string_unordered_map<int> tm;
+    tm["content-type"] = 42;
+    int* p = find_opt(tm, ct);
+    EXPECT_TRUE(p);
+    EXPECT_EQ(*p, 42);
+    EXPECT_FALSE(find_opt(tm, strings::hashed_v<"content-length">));
+    string_hash_map<int> hm;
+    hm["content-type"] = 7;
+    EXPECT_TRUE(hm.contains(ct));
+    EXPECT_EQ(hm.at(ct), 7);
+  }
+  if (true) {
+    // Case-insensitive.
+    istring_map<int> tm;
+    tm["Content-Length"] = 42;
+    tm["accept"] = 1;
+    int* p = find_opt(tm, "content-length"sv);
+    EXPECT_TRUE(p);
+    EXPECT_EQ(*p, 42);
+    EXPECT_TRUE(tm.contains("ACCEPT"));
+    EXPECT_FALSE(tm.contains("accepts"));
+    EXPECT_EQ(tm.begin()->first, "accept");
+  }
+  if (true) {
+    istring_unordered_map<int> tm;
+    tm["Content-Type-Options"] = 42;
+    int* p = find_opt(tm, "CONTENT-TYPE-OPTIONS"sv);
+    EXPECT_TRUE(p);
+    EXPECT_EQ(*p, 42);
+    EXPECT_FALSE(find_opt(tm, "content-type-option"sv));
+    istring_unordered_set tss;
+    tss.insert("Host"s);
+    EXPECT_TRUE(tss.contains("hOST"sv));
+    EXPECT_EQ(tss.size(), 1u);
+    tss.insert("HOST"s);
+    EXPECT_EQ(tss.size(), 1u);
+  }
+}
+
+void FlatStringMapTest_Basic() {
+  const auto ks = "key"s;
+  const auto ksv = "key"sv;
+  if (true) {
+    flat_string_map<int> m{{"pear", 3}, {"apple", 1}, {"fig", 2},
+        {"apple", 9}};
+    EXPECT_EQ(m.size(), 3u);
+    EXPECT_EQ(strings::join<strings::join_opt::json>(m),
+        R"({"apple": 1, "fig": 2, "pear": 3})");
+    EXPECT_EQ(m.at("fig"sv), 2);
+    EXPECT_THROW((void)m.at("kiwi"), std::out_of_range);
+    EXPECT_TRUE(m.contains("pear"));
+    EXPECT_FALSE(m.contains("pea"));
+    EXPECT_EQ(m.count("apple"), 1u);
+
+    // Unlike `string_map`, `operator[]` is transparent.
+    m[ksv] = 42;
+    EXPECT_EQ(m[ks], 42);
+    int* p = find_opt(m, ksv);
+    EXPECT_TRUE(p);
+    EXPECT_EQ(*p, 42);
+    EXPECT_FALSE(m.try_emplace("key", 7).second);
+    EXPECT_EQ(m.insert_or_assign("key"sv, 7).first->second, 7);
+    EXPECT_EQ(m.lower_bound("b")->first, "fig");
+
+    EXPECT_EQ(m.erase("fig"), 1u);
+    EXPECT_EQ(m.erase("fig"), 0u);
+    std::vector<std::pair<std::string, int>> more{{"banana", 4},
+        {"apple", 5}, {"cherry", 6}};
+    m.insert(more.begin(), more.end());
+    EXPECT_EQ(strings::join<strings::join_opt::json>(m),
+        R"({"apple": 1, "banana": 4, "cherry": 6, "key": 7, "pear": 3})");
+  }
+  if (true) {
+    flat_string_set s{"b", "a", "b"};
+    EXPECT_EQ(strings::join(s), "[a, b]");
+    EXPECT_TRUE(s.insert("c"sv).second);
+    EXPECT_FALSE(s.insert("a"s).second);
+    EXPECT_TRUE(s.contains("c"));
+    EXPECT_EQ(s.erase("a"), 1u);
+    EXPECT_EQ(strings::join(s), "[b, c]");
+    EXPECT_TRUE((s == flat_string_set{"c", "b"}));
+  }
+  if (true) {
+    string_hash_map<int> m{{"one", 1}, {"two", 2}, {"one", 3}};
+    EXPECT_EQ(m.size(), 2u);
+    EXPECT_EQ(m.at("one"), 1);
+    m[ksv] = 42;
+    int* p = find_opt(m, ksv);
+    EXPECT_TRUE(p);
+    EXPECT_EQ(*p, 42);
+    EXPECT_THROW((void)m.at("three"), std::out_of_range);
+
+    // Erasure moves the last entry into the hole.
+    EXPECT_EQ(strings::join<strings::join_opt::json>(m),
+        R"({"one": 1, "two": 2, "key": 42})");
+    EXPECT_EQ(m.erase("one"), 1u);
+    EXPECT_EQ(strings::join<strings::join_opt::json>(m),
+        R"({"key": 42, "two": 2})");
+    EXPECT_TRUE((m == string_hash_map<int>{{"two", 2}, {"key", 42}}));
+    const auto it = m.erase(m.begin());
+    EXPECT_EQ(it->first, "two");
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_FALSE(m.contains("two"));
+  }
+  if (true) {
+    istring_hash_map<int> m;
+    m["Content-Length"] = 42;
+    EXPECT_TRUE(m.contains("CONTENT-LENGTH"));
+    EXPECT_EQ(m.begin()->first, "Content-Length");
+  }
+  if (true) {
+    // Agrees with `std::map`, including for keys whose prefixes tie.
+    uint32_t seed = 11;
+    const auto next = [&](uint32_t n) {
+      seed = seed * 1103515245 + 12345;
+      return (seed >> 16) % n;
+    };
+    const auto random_key = [&] {
+      static constexpr auto alphabet = "ab\0\xff"sv;
+      std::string key = next(2) ? "abcdefgh" : "";
+      for (auto n = next(4); n; --n) key += alphabet[next(4)];
+      return key;
+    };
+    flat_string_map<int> flat;
+    flat_string_set set;
+    string_hash_map<int> hash;
+    std::map<std::string, int> expected;
+    size_t mismatches{};
+    for (int step = 0; step < 3000; ++step) {
+      const auto key = random_key();
+      if (next(3)) {
+        const auto value = static_cast<int>(next(100));
+        expected[key] = value;
+        flat.insert_or_assign(key, value);
+        hash.insert_or_assign(key, value);
+        set.insert(key);
+      } else {
+        const auto erased = expected.erase(key);
+        if (flat.erase(key) != erased) ++mismatches;
+        if (hash.erase(key) != erased) ++mismatches;
+        if (set.erase(key) != erased) ++mismatches;
+      }
+      const auto probe = random_key();
+      const auto found = expected.find(probe);
+      const bool has = found != expected.end();
+      if (flat.contains(probe) != has || hash.contains(probe) != has ||
+          set.contains(probe) != has)
+        ++mismatches;
+      else if (has &&
+               (flat.at(probe) != found->second ||
+                   hash.at(probe) != found->second))
+        ++mismatches;
+    }
+    EXPECT_EQ(mismatches, 0u);
+    EXPECT_TRUE(std::equal(flat.begin(), flat.end(), expected.begin(),
+        expected.end(), [](const auto& l, const auto& r) {
+          return l.first == r.first && l.second == r.second;
+        }));
+    EXPECT_EQ(hash.size(), expected.size());
+    EXPECT_TRUE(std::equal(set.begin(), set.end(), expected.begin(),
+        expected.end(), [](const auto& l, const auto& r) {
+          return l == r.first;
+        }));
+    EXPECT_TRUE((flat_string_map<int>{expected.begin(), expected.end()} ==
+                 flat));
+  }
 }
 
 void IndirectKey_Basic() {
@@ -668,6 +1079,343 @@ using string_intern_table_value = string_intern_table::interned_value_t;
 
 template class std::deque<std::string>;
 
+void ArenaTest_Blocks() {
+  auto alloc = [](size_t n, size_t align = 1) {
+    return static_cast<std::byte*>(extensible_arena::allocate(n, align));
+  };
+  if (true) {
+    // Alignment is of the address, not the offset.
+    extensible_arena arena{128};
+    extensible_arena::scope s{arena};
+    alloc(1);
+    auto p = alloc(8, 16);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 16, 0u);
+    EXPECT_EQ(arena.total_capacity(), 128u);
+  }
+  if (true) {
+    // An allocation that doesn't fit goes behind the head when the head still
+    // has room, so later allocations keep filling the head.
+    extensible_arena arena{128};
+    extensible_arena::scope s{arena};
+    auto p1 = alloc(60);
+    alloc(100);
+    auto p3 = alloc(20);
+    EXPECT_EQ(arena.total_capacity(), 256u);
+    EXPECT_EQ(p3, p1 + 60);
+    // When neither the head nor the block behind it have room, there's a new
+    // block behind the head, and the next allocation overflows into it.
+    auto p4 = alloc(50);
+    auto p5 = alloc(60);
+    EXPECT_EQ(arena.total_capacity(), 384u);
+    EXPECT_EQ(p5, p4 + 50);
+    EXPECT_TRUE(extensible_arena::contains(p5));
+  }
+  if (true) {
+    // Oversize allocations get their own block and don't change the block
+    // size.
+    extensible_arena arena{128};
+    extensible_arena::scope s{arena};
+    alloc(100);
+    auto big = alloc(1000);
+    EXPECT_TRUE(extensible_arena::contains(big));
+    EXPECT_EQ(arena.total_capacity(), 128u + 1000u);
+    alloc(100);
+    EXPECT_EQ(arena.total_capacity(), 128u + 1000u + 128u);
+  }
+  if (true) {
+    // Doubling, capped.
+    extensible_arena arena{arena_options{.block_size = 64,
+        .growth = arena_growth::doubling,
+        .max_block_size = 256}};
+    extensible_arena::scope s{arena};
+    alloc(60);
+    alloc(60);
+    EXPECT_EQ(arena.total_capacity(), 64u + 128u);
+    alloc(120);
+    EXPECT_EQ(arena.total_capacity(), 64u + 128u + 256u);
+    alloc(250);
+    EXPECT_EQ(arena.total_capacity(), 64u + 128u + 256u + 256u);
+  }
+  if (true) {
+    // Total cap.
+    extensible_arena arena{arena_options{.block_size = 64,
+        .max_total = 128,
+        .on_exhausted = arena_exhausted::return_null}};
+    extensible_arena::scope s{arena};
+    EXPECT_TRUE(alloc(60));
+    EXPECT_TRUE(alloc(60));
+    EXPECT_FALSE(alloc(60));
+    EXPECT_FALSE(alloc(1000));
+    EXPECT_EQ(arena.total_capacity(), 128u);
+    EXPECT_THROW(arena_string(100, 'x'), std::bad_alloc);
+  }
+  if (true) {
+    extensible_arena arena{arena_options{.block_size = 64, .max_total = 64}};
+    extensible_arena::scope s{arena};
+    EXPECT_TRUE(alloc(60));
+    EXPECT_THROW(alloc(60), std::bad_alloc);
+  }
+  if (true) {
+    // Reset keeps the blocks, except for oversize ones.
+    extensible_arena arena{128};
+    extensible_arena::scope s{arena};
+    auto p1 = alloc(100);
+    auto p2 = alloc(100);
+    alloc(1000);
+    EXPECT_EQ(arena.total_capacity(), 128u + 128u + 1000u);
+    arena.reset();
+    EXPECT_EQ(arena.total_capacity(), 256u);
+    EXPECT_FALSE(extensible_arena::contains(p1));
+    // The second block became the head because the first was filled.
+    EXPECT_EQ(alloc(100), p2);
+    EXPECT_EQ(alloc(100), p1);
+    EXPECT_EQ(arena.total_capacity(), 256u);
+    alloc(100);
+    EXPECT_EQ(arena.total_capacity(), 384u);
+  }
+}
+
+void ArenaTest_Threads() {
+  if (true) {
+    // Nested scopes restore the outer one.
+    extensible_arena outer{128};
+    extensible_arena inner{128};
+    extensible_arena::scope s{outer};
+    void* p{};
+    if (true) {
+      extensible_arena::scope s2{inner};
+      p = extensible_arena::allocate(8, 8);
+    }
+    EXPECT_FALSE(extensible_arena::contains(p));
+    EXPECT_TRUE(inner.owns(p));
+    EXPECT_TRUE(extensible_arena::contains(extensible_arena::allocate(8, 8)));
+  }
+  if (true) {
+    // Each thread gets its own arena, and scopes don't interfere.
+    constexpr size_t thread_count = 4;
+    thread_arena_pool pool{256};
+    std::array<extensible_arena*, thread_count> arenas{};
+    std::array<bool, thread_count> all_owned{};
+    std::latch all_started{thread_count};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t) {
+      threads.emplace_back([&, t] {
+        thread_arena_pool::scope s{pool};
+        arenas[t] = &pool.local();
+        all_started.arrive_and_wait();
+        arena_deque<arena_string> strings;
+        for (size_t i = 0; i < 1000; ++i)
+          strings.emplace_back(40, static_cast<char>('a' + t));
+        bool owned = &pool.local() == arenas[t];
+        for (auto& str : strings)
+          owned = owned && extensible_arena::contains(str.data()) &&
+                  arenas[t]->owns(str.data());
+        all_owned[t] = owned;
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    for (size_t t = 0; t < thread_count; ++t) {
+      EXPECT_TRUE(all_owned[t]);
+      for (size_t u = 0; u < t; ++u) EXPECT_TRUE(arenas[t] != arenas[u]);
+    }
+    EXPECT_EQ(pool.size(), thread_count);
+
+    // Arenas of exited threads are reset and reused.
+    extensible_arena* reused{};
+    std::thread{[&] { reused = &pool.local(); }}.join();
+    EXPECT_EQ(pool.size(), thread_count);
+    EXPECT_TRUE(std::ranges::find(arenas, reused) != arenas.end());
+
+    // This thread gets one, too.
+    EXPECT_TRUE(std::ranges::find(arenas, &pool.local()) != arenas.end());
+  }
+}
+
+void ArenaTest_Rewind() {
+  auto alloc = [](size_t n, size_t align = 1) {
+    return static_cast<std::byte*>(extensible_arena::allocate(n, align));
+  };
+  if (true) {
+    // Rewinding within the head block.
+    extensible_arena arena{128};
+    extensible_arena::scope s{arena};
+    alloc(10);
+    const auto m = arena.mark();
+    auto p = alloc(10);
+    alloc(10);
+    arena.rewind(m);
+    EXPECT_FALSE(arena.owns(p));
+    EXPECT_EQ(alloc(10), p);
+  }
+  if (true) {
+    // Rewinding across new, overflow, and oversize blocks.
+    extensible_arena arena{128};
+    extensible_arena::scope s{arena};
+    auto p1 = alloc(60);
+    auto p2 = alloc(100);
+    const auto m = arena.mark();
+    auto p3 = alloc(20);
+    auto p4 = alloc(20);
+    auto p5 = alloc(60);
+    auto big = alloc(1000);
+    auto p6 = alloc(100);
+    EXPECT_EQ(arena.total_capacity(), 4 * 128u + 1000u);
+    arena.rewind(m);
+    EXPECT_TRUE(arena.owns(p1));
+    EXPECT_TRUE(arena.owns(p2));
+    for (auto p : {p3, p4, p5, big, p6}) EXPECT_FALSE(arena.owns(p));
+    // The new blocks are kept as spares, but the oversize one is freed.
+    EXPECT_EQ(arena.total_capacity(), 4 * 128u);
+    EXPECT_EQ(alloc(20), p3);
+    EXPECT_EQ(alloc(20), p4);
+  }
+  if (true) {
+    // Nested checkpoints.
+    extensible_arena arena{64};
+    extensible_arena::scope s{arena};
+    auto p1 = alloc(10);
+    std::byte* p2{};
+    std::byte* p3{};
+    if (true) {
+      extensible_arena::checkpoint outer{arena};
+      p2 = alloc(10);
+      if (true) {
+        extensible_arena::checkpoint inner{arena};
+        p3 = alloc(10);
+        for (size_t i = 0; i < 10; ++i) alloc(50);
+      }
+      EXPECT_TRUE(arena.owns(p2));
+      EXPECT_FALSE(arena.owns(p3));
+      EXPECT_EQ(alloc(10), p3);
+    }
+    EXPECT_TRUE(arena.owns(p1));
+    EXPECT_FALSE(arena.owns(p2));
+    EXPECT_EQ(alloc(10), p2);
+  }
+  if (true) {
+    // Scratch strings.
+    extensible_arena arena{256};
+    extensible_arena::scope s{arena};
+    arena_string kept(100, 'k');
+    const auto capacity = arena.total_capacity();
+    for (size_t i = 0; i < 10; ++i) {
+      extensible_arena::checkpoint c{arena};
+      arena_string scratch(200, 's');
+      scratch += scratch;
+      EXPECT_TRUE(extensible_arena::contains(scratch.data()));
+    }
+    EXPECT_EQ(std::string_view{kept}, std::string(100, 'k'));
+    EXPECT_LE(arena.total_capacity(), capacity + 1024u);
+  }
+}
+
+void ArenaTest_Stats() {
+  auto alloc = [](size_t n, size_t align = 1) {
+    return extensible_arena::allocate(n, align);
+  };
+  if (true) {
+    extensible_arena arena{128};
+    extensible_arena::scope s{arena};
+    auto st = arena.stats();
+    EXPECT_EQ(st.bytes_requested, 0u);
+    EXPECT_EQ(st.bytes_reserved, 128u);
+    EXPECT_EQ(st.block_count, 1u);
+
+    alloc(1);
+    alloc(8, 8);
+    st = arena.stats();
+    EXPECT_EQ(st.bytes_requested, 9u);
+    EXPECT_LE(st.alignment_padding, 7u);
+    EXPECT_EQ(st.high_water, st.bytes_requested + st.alignment_padding);
+
+    // This strands the rest of the head, which is mostly full.
+    alloc(100);
+    alloc(100);
+    st = arena.stats();
+    EXPECT_EQ(st.block_count, 2u);
+    EXPECT_EQ(st.bytes_reserved, 256u);
+    EXPECT_EQ(st.unused_tail_bytes, 128u - 109u - st.alignment_padding);
+
+    alloc(1000);
+    st = arena.stats();
+    EXPECT_EQ(st.block_count, 3u);
+    EXPECT_EQ(st.oversize_allocations, 1u);
+    EXPECT_EQ(st.bytes_requested, 1209u);
+    const auto high_water = st.high_water;
+    EXPECT_EQ(high_water, st.bytes_requested + st.alignment_padding);
+
+    // Rewinding and resetting lower the usage, but not the high-water mark.
+    const auto m = arena.mark();
+    alloc(10);
+    arena.rewind(m);
+    EXPECT_EQ(arena.stats().high_water, high_water + 10);
+    arena.reset();
+    alloc(10);
+    st = arena.stats();
+    EXPECT_EQ(st.block_count, 2u);
+    EXPECT_EQ(st.high_water, high_water + 10);
+  }
+  if (true) {
+    arena_stats st{1, 2, 3, 4, 5, 6, 7};
+    EXPECT_EQ(strings::join(st), "[1, 2, 3, 4, 5, 6, 7]");
+    EXPECT_EQ(strings::join_json(st),
+        R"({"bytes_requested": 1, "bytes_reserved": 2, "block_count": 3, )"
+        R"("oversize_allocations": 4, "alignment_padding": 5, )"
+        R"("unused_tail_bytes": 6, "high_water": 7})");
+    std::string s;
+    strings::append(s, st);
+    EXPECT_EQ(s, strings::join_json(st));
+  }
+}
+
+void RopeTest_Basic() {
+  if (true) {
+    rope_ostream os{16};
+    std::string expected;
+    for (int i = 0; i < 20; ++i) {
+      strings::append(os, "item ", i, ';');
+      strings::append(expected, "item ", i, ';');
+    }
+    EXPECT_TRUE(os.good());
+    EXPECT_EQ(os.size(), expected.size());
+    EXPECT_EQ(os.flatten(), expected);
+    const auto segments = os.segments();
+    EXPECT_EQ(segments.size(), (expected.size() + 15) / 16);
+    bool full = true;
+    for (size_t i = 0; i + 1 < segments.size(); ++i)
+      full = full && segments[i].size() == 16;
+    EXPECT_TRUE(full);
+
+    // Already-written chunks never move.
+    const auto first = segments.front().data();
+    os << std::string(100, 'x');
+    EXPECT_TRUE(os.segments().front().data() == first);
+    expected.append(100, 'x');
+    std::string out = "> ";
+    EXPECT_EQ(os.append_to(out), "> " + expected);
+
+    os.reset();
+    EXPECT_EQ(os.size(), 0u);
+    EXPECT_TRUE(os.segments().empty());
+    strings::append_join(os, std::vector{1, 2, 3});
+    EXPECT_EQ(os.flatten(), "[1, 2, 3]");
+  }
+  if (true) {
+    // Chunks come from an arena that's passed in, and the stream goes bad
+    // when it's exhausted.
+    extensible_arena arena{arena_options{.block_size = 64,
+        .max_total = 128,
+        .on_exhausted = arena_exhausted::return_null}};
+    rope_ostream os{arena, 32};
+    os << std::string(128, 'y');
+    EXPECT_TRUE(os.good());
+    EXPECT_EQ(os.segments().size(), 4u);
+    os << 'z';
+    EXPECT_FALSE(os.good());
+    EXPECT_EQ(os.flatten(), std::string(128, 'y'));
+  }
+}
+
 void InternTableTest_Basic() {
   if (true) {
     // Test arena in isolation to reproduce corrected bugs.
@@ -762,8 +1510,8 @@ void InternTableTest_Basic() {
     EXPECT_EQ(iv.id(), string_id{1});
     EXPECT_EQ(iv.value(), "abc");
     // Both the string and its contents are in the arena.
-    EXPECT_TRUE(extensible_arena::contains(&iv.value()));
-    EXPECT_TRUE(extensible_arena::contains(iv.value().data()));
+    EXPECT_TRUE(sit.arena_contains(&iv.value()));
+    EXPECT_TRUE(sit.arena_contains(iv.value().data()));
     iv = SIT::interned_value_t{};
     EXPECT_FALSE(iv);
     using C = SIT::lookup_by_value_t;
@@ -773,8 +1521,8 @@ void InternTableTest_Basic() {
     EXPECT_TRUE(iv);
     EXPECT_EQ(iv.id(), string_id{1});
     EXPECT_EQ(iv.value(), "abc");
-    EXPECT_TRUE(extensible_arena::contains(&iv.value()));
-    EXPECT_TRUE(extensible_arena::contains(iv.value().data()));
+    EXPECT_TRUE(sit.arena_contains(&iv.value()));
+    EXPECT_TRUE(sit.arena_contains(iv.value().data()));
 
     iv = sit("defghijklmnopqrstuvwxyz"sv);
     EXPECT_FALSE(iv);
@@ -783,8 +1531,8 @@ void InternTableTest_Basic() {
     EXPECT_EQ(iv.id(), string_id{2});
     EXPECT_EQ(iv.value(), "defghijklmnopqrstuvwxyz"sv);
     // Non-short strings are in the arena.
-    EXPECT_TRUE(extensible_arena::contains(&iv.value()));
-    EXPECT_TRUE(extensible_arena::contains(iv.value().data()));
+    EXPECT_TRUE(sit.arena_contains(&iv.value()));
+    EXPECT_TRUE(sit.arena_contains(iv.value().data()));
 
     iv = string_intern_table_value{csit, "ghi"s};
     EXPECT_FALSE(iv);
@@ -1190,6 +1938,1154 @@ void CustomHandleTest_Basic() {
 #endif
 }
 
+void SmallFunctionTest_Basic() {
+  using F = small_function<int(int)>;
+  if (true) {
+    F f;
+    EXPECT_FALSE(f);
+    EXPECT_TRUE(f == nullptr);
+    EXPECT_THROW(f(1), std::bad_function_call);
+    f = [](int x) { return x + 1; };
+    EXPECT_TRUE(f);
+    EXPECT_TRUE(f.is_inline());
+    EXPECT_EQ(f(1), 2);
+    f = nullptr;
+    EXPECT_FALSE(f);
+  }
+  if (true) {
+    // Move-only targets, and moving the function moves the target.
+    auto p = std::make_unique<int>(40);
+    F f = [p = std::move(p)](int x) { return *p + x; };
+    EXPECT_EQ(f(2), 42);
+    F g = std::move(f);
+    EXPECT_FALSE(f);
+    EXPECT_EQ(g(2), 42);
+    f = std::move(g);
+    EXPECT_EQ(f(3), 43);
+  }
+  if (true) {
+    // Mutable targets keep their state across calls.
+    F f = [n = 0](int x) mutable { return n += x; };
+    EXPECT_EQ(f(1), 1);
+    EXPECT_EQ(f(2), 3);
+  }
+  if (true) {
+    // Large targets fall back to the heap.
+    std::array<int, 32> big{};
+    big[31] = 7;
+    F f = [big](int x) { return big[31] * x; };
+    EXPECT_FALSE(f.is_inline());
+    EXPECT_EQ(f(6), 42);
+    F g = std::move(f);
+    EXPECT_EQ(g(2), 14);
+    using G = small_function<int(int), sizeof(big) + sizeof(void*)>;
+    G h = [big](int x) { return big[31] * x; };
+    EXPECT_TRUE(h.is_inline());
+    EXPECT_EQ(h(1), 7);
+  }
+  if (true) {
+    // Destroys the target exactly once.
+    auto counter = std::make_shared<int>();
+    if (true) {
+      F f = [counter](int x) { return x; };
+      EXPECT_EQ(counter.use_count(), 2);
+      F g = std::move(f);
+      EXPECT_EQ(counter.use_count(), 2);
+    }
+    EXPECT_EQ(counter.use_count(), 1);
+  }
+}
+
+void FreeListTest_Basic() {
+  using namespace corvid::container::pool;
+  if (true) {
+    free_list pool;
+    free_list_allocator<int64_t> a{pool};
+    auto p = a.allocate(1);
+    EXPECT_EQ(pool.free_count(), 0u);
+    a.deallocate(p, 1);
+    EXPECT_EQ(pool.free_count(), 1u);
+    auto q = a.allocate(1);
+    EXPECT_EQ(p, q);
+    EXPECT_EQ(pool.free_count(), 0u);
+
+    // Other sizes pass through to the heap.
+    auto r = a.allocate(10);
+    a.deallocate(r, 10);
+    EXPECT_EQ(pool.free_count(), 0u);
+    a.deallocate(q, 1);
+
+    pool.reserve(8);
+    EXPECT_EQ(pool.free_count(), 8u);
+  }
+  if (true) {
+    // Nodes are recycled by node-based containers.
+    free_list pool;
+    using A = free_list_allocator<std::pair<const int, int>>;
+    std::map<int, int, std::less<int>, A> m{A{pool}};
+    for (int i = 0; i < 10; ++i) m[i] = i;
+    EXPECT_EQ(pool.free_count(), 0u);
+    m.clear();
+    EXPECT_EQ(pool.free_count(), 10u);
+    for (int i = 0; i < 5; ++i) m[i] = i;
+    EXPECT_EQ(pool.free_count(), 5u);
+    EXPECT_TRUE(m.get_allocator() == A{pool});
+  }
+}
+
+namespace {
+struct pooled_counter {
+  static inline int live{};
+  int value;
+  explicit pooled_counter(int v) : value{v} { ++live; }
+  ~pooled_counter() { --live; }
+};
+} // namespace
+
+void ObjectPoolTest_Basic() {
+  using namespace corvid::container::pool;
+  if (true) {
+    // Storage is recycled, with objects constructed and destroyed.
+    object_pool<pooled_counter> pool;
+    auto p = pool.make(1);
+    EXPECT_EQ(p->value, 1);
+    EXPECT_EQ(pooled_counter::live, 1);
+    const auto address = p.get();
+    p.reset();
+    EXPECT_EQ(pooled_counter::live, 0);
+    EXPECT_EQ(pool.local_count(), 1u);
+    pooled_ptr<pooled_counter> q = pool.make(2);
+    EXPECT_TRUE(q.get() == address);
+    EXPECT_EQ(q->value, 2);
+    EXPECT_EQ(pool.local_count(), 0u);
+    pooled_ptr<pooled_counter> empty;
+    EXPECT_FALSE(empty);
+  }
+  EXPECT_EQ(pooled_counter::live, 0);
+  if (true) {
+    // Objects are reset and reused, keeping their capacity.
+    object_pool<std::string> pool{[](std::string& s) { s.clear(); }};
+    auto s = pool.make(100, 'x');
+    const auto capacity = s->capacity();
+    const auto address = s.get();
+    s = nullptr;
+    auto t = pool.make("ignored");
+    EXPECT_TRUE(t.get() == address);
+    EXPECT_TRUE(t->empty());
+    EXPECT_EQ(t->capacity(), capacity);
+    auto u = pool.make("new");
+    EXPECT_EQ(*u, "new");
+  }
+  if (true) {
+    // Batches move between the calling thread's list and the shared one.
+    object_pool<int64_t> pool{nullptr, 4};
+    std::vector<pooled_ptr<int64_t>> v;
+    for (int i = 0; i < 10; ++i) v.push_back(pool.make(i));
+    v.clear();
+    EXPECT_EQ(pool.local_count(), 6u);
+    EXPECT_EQ(pool.shared_count(), 4u);
+    for (int i = 0; i < 7; ++i) v.push_back(pool.make(i));
+    EXPECT_EQ(pool.local_count(), 3u);
+    EXPECT_EQ(pool.shared_count(), 0u);
+
+    // Objects returned by an exiting thread go to the shared list.
+    std::thread{[&] {
+      for (int i = 0; i < 3; ++i) v.push_back(pool.make(i));
+      v.clear();
+    }}.join();
+    EXPECT_EQ(pool.shared_count(), 10u);
+    EXPECT_EQ(pool.local_count(), 3u);
+  }
+  if (true) {
+    // Objects made and returned on several threads.
+    object_pool<pooled_counter> pool{nullptr, 8};
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::vector<pooled_ptr<pooled_counter>> handoff;
+    for (int t = 0; t < 4; ++t)
+      threads.emplace_back([&] {
+        for (int i = 0; i < 1000; ++i) {
+          auto p = pool.make(i);
+          if (i % 3) continue;
+          std::scoped_lock lock{mutex};
+          handoff.push_back(std::move(p));
+          if (handoff.size() > 16) handoff.erase(handoff.begin());
+        }
+      });
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(pooled_counter::live, static_cast<int>(handoff.size()));
+    handoff.clear();
+  }
+  EXPECT_EQ(pooled_counter::live, 0);
+}
+
+void SegmentedVectorTest_Basic() {
+  if (true) {
+    segmented_vector<int, 4> v;
+    EXPECT_TRUE(v.empty());
+    EXPECT_EQ(v.capacity(), 0u);
+    std::vector<int*> addresses;
+    for (int i = 0; i < 10; ++i) addresses.push_back(&v.emplace_back(i));
+    EXPECT_EQ(v.size(), 10u);
+    EXPECT_EQ(v.capacity(), 12u);
+    bool stable = true;
+    for (int i = 0; i < 10; ++i)
+      stable = stable && addresses[i] == &v[i] && v[i] == i;
+    EXPECT_TRUE(stable);
+    EXPECT_EQ(v.front(), 0);
+    EXPECT_EQ(v.back(), 9);
+    EXPECT_EQ(v.at(5), 5);
+    EXPECT_THROW(v.at(10), std::out_of_range);
+
+    std::vector<int> copy(v.begin(), v.end());
+    EXPECT_EQ(copy, (std::vector{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    EXPECT_EQ(v.end() - v.begin(), 10);
+    const auto& cv = v;
+    EXPECT_EQ(*(cv.begin() + 7), 7);
+    EXPECT_EQ(std::ranges::count_if(cv, [](int i) { return i % 2; }), 5);
+
+    v.reserve(20);
+    EXPECT_EQ(v.capacity(), 20u);
+    v.clear();
+    EXPECT_TRUE(v.empty());
+    EXPECT_EQ(v.capacity(), 0u);
+  }
+  if (true) {
+    // Elements need not be movable.
+    segmented_vector<std::mutex, 2> v;
+    auto& m = v.emplace_back();
+    for (size_t i = 0; i < 10; ++i) v.emplace_back();
+    EXPECT_TRUE(&m == &v[0]);
+  }
+  if (true) {
+    // Arena-allocated, nested.
+    extensible_arena arena{4096};
+    extensible_arena::scope s{arena};
+    using V = segmented_vector<arena_string, 8, arena_allocator<arena_string>>;
+    auto& v = arena_construct<V>(arena);
+    for (size_t i = 0; i < 20; ++i)
+      v.emplace_back(40, static_cast<char>('a' + i));
+    EXPECT_TRUE(extensible_arena::contains(&v));
+    EXPECT_TRUE(extensible_arena::contains(&v[19]));
+    EXPECT_TRUE(extensible_arena::contains(v[19].data()));
+    EXPECT_EQ(v[19], arena_string(40, 't'));
+  }
+  if (true) {
+    // Concurrent version, with doubling segments.
+    concurrent_segmented_vector<std::string, 4> v;
+    EXPECT_TRUE(v.empty());
+    std::vector<std::string*> addresses;
+    for (size_t i = 0; i < 100; ++i)
+      addresses.push_back(&v.emplace_back(std::to_string(i)));
+    EXPECT_EQ(v.size(), 100u);
+    bool stable = true;
+    for (size_t i = 0; i < 100; ++i)
+      stable = stable && addresses[i] == &v[i] && v[i] == std::to_string(i);
+    EXPECT_TRUE(stable);
+    EXPECT_EQ(v.at(99), "99");
+    EXPECT_THROW((void)v.at(100), std::out_of_range);
+  }
+}
+
+void FlatIndexTest_Basic() {
+  if (true) {
+    // Keys live elsewhere; IDs are 1-based indexes into them.
+    std::vector<std::string> keys;
+    flat_id_index<uint32_t> index;
+    auto find = [&](const std::string& key) {
+      return index.find(std::hash<std::string>{}(key),
+          [&](uint32_t id) { return keys[id - 1] == key; });
+    };
+    EXPECT_TRUE(index.empty());
+    EXPECT_EQ(find("abc"), 0u);
+
+    for (size_t i = 0; i < 1000; ++i) {
+      keys.push_back(std::to_string(i * 7));
+      index.insert(std::hash<std::string>{}(keys.back()),
+          static_cast<uint32_t>(keys.size()));
+    }
+    EXPECT_EQ(index.size(), 1000u);
+    EXPECT_TRUE(index.capacity() * 7 >= index.size() * 8);
+    bool all_found = true;
+    for (size_t i = 0; i < keys.size(); ++i)
+      all_found = all_found && find(keys[i]) == i + 1;
+    EXPECT_TRUE(all_found);
+    EXPECT_EQ(find("1"), 0u);
+    EXPECT_EQ(find("abc"), 0u);
+  }
+  if (true) {
+    // Colliding hashes are told apart by the predicate.
+    flat_id_index<uint32_t> index;
+    index.reserve(100);
+    const auto capacity = index.capacity();
+    for (uint32_t id = 1; id <= 100; ++id) index.insert(42, id);
+    EXPECT_EQ(index.capacity(), capacity);
+    EXPECT_EQ(index.find(42, [](uint32_t id) { return id == 77; }), 77u);
+    EXPECT_EQ(index.find(42, [](uint32_t) { return false; }), 0u);
+    EXPECT_EQ(index.find(43, [](uint32_t) { return true; }), 0u);
+  }
+  if (true) {
+    // Concurrent version, read while growing.
+    constexpr uint32_t count = 20000;
+    concurrent_flat_id_index<uint32_t> index;
+    std::atomic<uint32_t> inserted{};
+    std::atomic<bool> done{};
+    bool reads_ok = true;
+    std::thread reader{[&] {
+      while (!done.load()) {
+        const auto n = inserted.load();
+        for (uint32_t id = n; id > 0 && id + 64 > n; --id)
+          reads_ok = reads_ok &&
+                     index.find(id, [&](uint32_t i) { return i == id; }) == id;
+        reads_ok = reads_ok &&
+                   index.find(n + count, [](uint32_t) { return true; }) == 0;
+      }
+    }};
+    for (uint32_t id = 1; id <= count; ++id) {
+      index.insert(id, id);
+      inserted.store(id);
+    }
+    done.store(true);
+    reader.join();
+    EXPECT_TRUE(reads_ok);
+    EXPECT_EQ(index.size(), count);
+    bool all_found = true;
+    for (uint32_t id = 1; id <= count; ++id) {
+      const auto found = index.find(id, [&](uint32_t i) { return i == id; });
+      all_found = all_found && found == id;
+    }
+    EXPECT_TRUE(all_found);
+  }
+}
+
+void InternTableTest_Flat() {
+  using FIT = intern_table<std::string, string_id,
+      flat_intern_traits<std::string, string_id>>;
+  if (true) {
+    auto sit_ptr = FIT::make(string_id{0}, string_id{3});
+    auto& sit = *sit_ptr;
+    EXPECT_TRUE(FlatInternIndex<FIT::lookup_by_value_t>);
+
+    auto iv = sit("abc");
+    EXPECT_FALSE(iv);
+    iv = sit.intern("abc");
+    EXPECT_TRUE(iv);
+    EXPECT_EQ(iv.id(), string_id{1});
+    EXPECT_TRUE(sit.arena_contains(&iv.value()));
+    iv = sit.intern("defghijklmnopqrstuvwxyz"sv);
+    EXPECT_EQ(iv.id(), string_id{2});
+    EXPECT_TRUE(sit.arena_contains(iv.value().data()));
+
+    iv = sit("abc"s);
+    EXPECT_EQ(iv.id(), string_id{1});
+    EXPECT_EQ(iv.value(), "abc");
+    iv = sit("defghijklmnopqrstuvwxyz");
+    EXPECT_EQ(iv.id(), string_id{2});
+    iv = sit.intern("abc");
+    EXPECT_EQ(iv.id(), string_id{1});
+
+    iv = sit.intern("ghi");
+    EXPECT_EQ(iv.id(), string_id{3});
+    EXPECT_TRUE(sit.is_full());
+    iv = sit.intern("jkl");
+    EXPECT_FALSE(iv);
+
+    // Chained tables find values in earlier ones.
+    auto next_ptr = sit.make_next();
+    auto& next = *next_ptr;
+    iv = next("ghi");
+    EXPECT_EQ(iv.id(), string_id{3});
+    iv = next.intern("jkl");
+    EXPECT_EQ(iv.id(), string_id{4});
+    iv = next("jkl");
+    EXPECT_EQ(iv.id(), string_id{4});
+    EXPECT_FALSE(sit("jkl"));
+  }
+  if (true) {
+    // Enough values to rehash several times.
+    auto sit_ptr = FIT::make();
+    auto& sit = *sit_ptr;
+    for (size_t i = 0; i < 500; ++i) (void)sit.intern(std::to_string(i));
+    bool all_found = true;
+    for (size_t i = 0; i < 500; ++i) {
+      auto iv = sit(std::to_string(i));
+      all_found = all_found && iv &&
+                  static_cast<size_t>(*iv.id()) == i + 1 &&
+                  iv.value() == std::to_string(i);
+    }
+    EXPECT_TRUE(all_found);
+    EXPECT_FALSE(sit("500"));
+  }
+  if (true) {
+    // The general traits, with indirect keys.
+    using BFIT = intern_table<bad_key, string_id,
+        flat_intern_traits<bad_key, string_id>>;
+    auto sit_ptr = BFIT::make(string_id{0}, string_id{3});
+    auto& sit = *sit_ptr;
+    const auto bk_abc = bad_key{"abc"};
+    const auto bk_def = bad_key{"def"};
+    EXPECT_FALSE(sit(bk_abc));
+    EXPECT_EQ(sit.intern(bk_abc).id(), string_id{1});
+    EXPECT_EQ(sit.intern(bk_def).id(), string_id{2});
+    EXPECT_EQ(sit(bk_abc).id(), string_id{1});
+    EXPECT_EQ(sit(bk_def).value(), bk_def);
+  }
+}
+
+void InternTableTest_Concurrent() {
+  using CIT = intern_table<std::string, string_id,
+      concurrent_intern_traits<std::string, string_id>>;
+  if (true) {
+    auto sit_ptr = CIT::make(string_id{0}, string_id{3});
+    auto& sit = *sit_ptr;
+    EXPECT_TRUE(CIT::lock_free_reads);
+    EXPECT_FALSE(string_intern_table::lock_free_reads);
+
+    EXPECT_FALSE(sit("abc"));
+    auto iv = sit.intern("abc");
+    EXPECT_EQ(iv.id(), string_id{1});
+    EXPECT_TRUE(sit.arena_contains(&iv.value()));
+    EXPECT_EQ(sit.intern("defghijklmnopqrstuvwxyz").id(), string_id{2});
+    EXPECT_EQ(sit.intern("abc").id(), string_id{1});
+    EXPECT_EQ(sit(string_id{2}).value(), "defghijklmnopqrstuvwxyz");
+    EXPECT_EQ(sit.intern("ghi").id(), string_id{3});
+    EXPECT_FALSE(sit.intern("jkl"));
+
+    // Reads don't take the lock, even when someone else holds it.
+    lock held{sit.sync};
+    bool found{};
+    std::thread{[&] {
+      found = sit("abc").id() == string_id{1} &&
+              sit(string_id{3}).value() == "ghi";
+    }}.join();
+    EXPECT_TRUE(found);
+  }
+  if (true) {
+    // Readers run alongside multiple writers.
+    constexpr size_t reader_count = 3;
+    constexpr size_t writer_count = 2;
+    constexpr size_t value_count = 2000;
+    auto sit_ptr = CIT::make();
+    auto& sit = *sit_ptr;
+    std::atomic<size_t> writers_done{};
+    std::array<bool, reader_count> reads_ok{};
+    std::array<bool, writer_count> writes_ok{};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < writer_count; ++t) {
+      threads.emplace_back([&, t] {
+        bool ok = true;
+        for (size_t i = 0; i < value_count; ++i) {
+          const auto value = std::to_string(i);
+          auto iv = sit.intern(value);
+          ok = ok && iv && iv.value() == value;
+        }
+        writes_ok[t] = ok;
+        ++writers_done;
+      });
+    }
+    for (size_t t = 0; t < reader_count; ++t) {
+      threads.emplace_back([&, t] {
+        bool ok = true;
+        do {
+          for (size_t i = 0; i < value_count; i += 7) {
+            const auto value = std::to_string(i);
+            if (auto iv = sit(value))
+              ok = ok && iv.value() == value &&
+                   sit(iv.id()).value() == value;
+          }
+        } while (writers_done.load() < writer_count);
+        reads_ok[t] = ok;
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    for (auto ok : reads_ok) EXPECT_TRUE(ok);
+    for (auto ok : writes_ok) EXPECT_TRUE(ok);
+
+    // Each value was interned once.
+    bool unique = true;
+    for (size_t i = 0; i < value_count; ++i)
+      unique = unique &&
+               static_cast<size_t>(*sit(std::to_string(i)).id()) <= value_count;
+    EXPECT_TRUE(unique);
+    EXPECT_FALSE(sit(string_id{value_count + 1}));
+  }
+}
+
+void InternTableTest_Bulk() {
+  if (true) {
+    auto sit_ptr = string_intern_table::make(string_id{0}, string_id{4});
+    auto& sit = *sit_ptr;
+    (void)sit.intern("b");
+    const std::vector<std::string_view> batch{"a", "b", "a", "c", "b", "a"};
+    auto ids = sit.intern_bulk(batch);
+    const std::vector<string_id> expected{string_id{2}, string_id{1},
+        string_id{2}, string_id{3}, string_id{1}, string_id{2}};
+    EXPECT_EQ(ids, expected);
+    EXPECT_EQ(sit(string_id{3}).value(), "c");
+
+    // Once full, the rest come back empty.
+    const std::array<std::string, 4> more{"d", "e", "a", "e"};
+    ids = sit.intern_bulk(more);
+    EXPECT_EQ(ids,
+        (std::vector{string_id{4}, string_id{}, string_id{2}, string_id{}}));
+    EXPECT_TRUE(sit.is_full());
+    EXPECT_TRUE(sit.intern_bulk(std::span<std::string_view>{}).empty());
+  }
+  if (true) {
+    // Lock-free reads find the hits before locking once for the misses.
+    using CIT = intern_table<std::string, string_id,
+        concurrent_intern_traits<std::string, string_id>>;
+    auto sit_ptr = CIT::make();
+    auto& sit = *sit_ptr;
+    std::vector<std::string> batch;
+    for (size_t i = 0; i < 300; ++i) batch.push_back(std::to_string(i % 100));
+    auto ids = sit.intern_bulk(batch);
+    bool ok = true;
+    for (size_t i = 0; i < batch.size(); ++i)
+      ok = ok && static_cast<size_t>(*ids[i]) == i % 100 + 1 &&
+           sit(ids[i]).value() == batch[i];
+    EXPECT_TRUE(ok);
+    ids = sit.intern_bulk(std::vector<std::string_view>{"5", "new"});
+    EXPECT_EQ(ids, (std::vector{string_id{6}, string_id{101}}));
+  }
+}
+
+void InternTableTest_Chain() {
+  if (true) {
+    // A chain of full tables, which are frozen, under one that isn't.
+    auto base = string_intern_table::make(string_id{0}, string_id{100});
+    string_intern_table::const_pointer chain = base;
+    for (size_t i = 0; i < 100; ++i) (void)base->intern(std::to_string(i));
+    EXPECT_TRUE(base->is_full());
+    for (size_t level = 1; level < 5; ++level) {
+      auto next =
+          chain->make_next(static_cast<string_id>(*chain->max_id() + 100));
+      for (size_t i = 0; i < 100; ++i)
+        (void)next->intern(std::to_string(level * 100 + i));
+      EXPECT_TRUE(next->is_full());
+      chain = next;
+    }
+    auto top = chain->make_next();
+    EXPECT_EQ(top->intern("top").id(), string_id{501});
+
+    bool found_all = true;
+    for (size_t i = 0; i < 500; ++i) {
+      auto iv = (*top)(std::to_string(i));
+      found_all = found_all && static_cast<size_t>(*iv.id()) == i + 1 &&
+                  iv.value() == std::to_string(i);
+    }
+    EXPECT_TRUE(found_all);
+    bool missed_all = true;
+    for (size_t i = 500; i < 1500; ++i)
+      missed_all = missed_all && !(*top)(std::to_string(i));
+    EXPECT_TRUE(missed_all);
+    EXPECT_EQ(top->intern("250").id(), string_id{251});
+    EXPECT_EQ(top->intern("500").id(), string_id{502});
+
+    // Compacting keeps the IDs and values in one frozen table.
+    auto flat = top->compact();
+    EXPECT_TRUE(flat->is_full());
+    EXPECT_EQ(flat->min_id(), string_id{1});
+    EXPECT_EQ(flat->max_id(), string_id{502});
+    bool same = true;
+    top->for_each([&](string_id id, const std::string& value) {
+      same = same && (*flat)(value).id() == id && (*flat)(id).value() == value;
+    });
+    EXPECT_TRUE(same);
+    EXPECT_FALSE((*flat)("501"));
+    EXPECT_FALSE((*flat)(string_id{503}));
+    EXPECT_EQ(flat->make_next()->intern("501").id(), string_id{503});
+    EXPECT_EQ(flat->make_next()->intern("42").id(), string_id{43});
+
+    // Compacting a single table is fine, but gaps aren't.
+    EXPECT_EQ((*base->compact())("99").id(), string_id{100});
+    EXPECT_EQ(string_intern_table::make()->compact()->max_id(), string_id{1});
+    auto gappy = string_intern_table::make(string_id{0}, string_id{10});
+    (void)gappy->intern("a");
+    EXPECT_THROW((void)gappy->make_next()->compact(), std::invalid_argument);
+  }
+  if (true) {
+    // Flat and concurrent indexes work the same way.
+    auto check = []<typename TABLE>(std::type_identity<TABLE>) {
+      auto base = TABLE::make(string_id{0}, string_id{50});
+      for (size_t i = 0; i < 50; ++i) (void)base->intern(std::to_string(i));
+      auto top = base->make_next();
+      (void)top->intern("top");
+      // Each lookup holds the lock until the end of the statement.
+      bool ok = (*top)("7").id() == string_id{8};
+      ok = ok && !(*top)("50");
+      ok = ok && (*top)("top").id() == string_id{51};
+      auto flat = top->compact();
+      ok = ok && (*flat)("7").id() == string_id{8} &&
+           (*flat)("top").id() == string_id{51} && flat->is_full();
+      return ok;
+    };
+    EXPECT_TRUE(check(std::type_identity<intern_table<std::string, string_id,
+            flat_intern_traits<std::string, string_id>>>{}));
+    EXPECT_TRUE(check(std::type_identity<intern_table<std::string, string_id,
+            concurrent_intern_traits<std::string, string_id>>>{}));
+  }
+}
+
+void InternTableTest_Sharded() {
+  using sharded_table = sharded_intern_table<std::string, string_id>;
+  if (true) {
+    auto table = sharded_table::make(3, 100);
+    EXPECT_EQ(table->shard_count(), 4u);
+    EXPECT_EQ(table->min_id(), string_id{1});
+    EXPECT_EQ(table->max_id(), string_id{400});
+    EXPECT_EQ(table->shard(2).min_id(), string_id{201});
+
+    // Each value's ID is in the range of the shard it hashes to.
+    bool in_range = true;
+    for (size_t i = 0; i < 200; ++i) {
+      const auto value = std::to_string(i);
+      const auto iv = table->intern(value);
+      const auto shard = table->shard_of(value);
+      in_range = in_range && iv && iv.value() == value &&
+                 table->shard_of(iv.id()) == shard &&
+                 iv.id() >= table->shard(shard).min_id() &&
+                 iv.id() <= table->shard(shard).max_id();
+    }
+    EXPECT_TRUE(in_range);
+
+    // IDs are dense within each shard, and all shards are used. Since
+    // `for_each` holds each shard's lock, the lookups wait until after.
+    std::vector<std::pair<string_id, std::string>> entries;
+    table->for_each([&](string_id id, const std::string& value) {
+      entries.emplace_back(id, value);
+    });
+    std::vector<size_t> counts(table->shard_count());
+    bool dense = true;
+    for (const auto& [id, value] : entries) {
+      const auto shard = table->shard_of(id);
+      dense = dense && *id == *table->shard(shard).min_id() +
+                                  static_cast<int>(counts[shard]++);
+      dense = dense && table->get(id).value() == value;
+    }
+    EXPECT_TRUE(dense);
+    EXPECT_EQ(std::accumulate(counts.begin(), counts.end(), size_t{}), 200u);
+    EXPECT_EQ(std::ranges::count(counts, 0u), 0);
+
+    EXPECT_EQ(table->intern("7").id(), (*table)("7").id());
+    EXPECT_FALSE((*table)("missing"));
+    EXPECT_FALSE(table->get(string_id{0}));
+    EXPECT_FALSE(table->get(string_id{399}));
+    EXPECT_FALSE(table->get(string_id{401}));
+    EXPECT_EQ(table->shard_of(string_id{401}), table->shard_count());
+
+    // It can sit behind a cache.
+    intern_cache<sharded_table> cache{table};
+    EXPECT_EQ(cache.intern("7").id(), (*table)("7").id());
+    EXPECT_EQ(cache.get("7").id(), (*table)("7").id());
+    EXPECT_EQ(cache.hits(), 1u);
+  }
+  if (true) {
+    // A full shard fails while the others still have room.
+    sharded_table table{2, 3};
+    std::array<size_t, 2> interned{};
+    for (size_t i = 0; i < 20; ++i) {
+      const auto value = std::to_string(i);
+      if (table.intern(value)) ++interned[table.shard_of(value)];
+    }
+    EXPECT_EQ(interned, (std::array<size_t, 2>{3, 3}));
+    EXPECT_TRUE(table.shard(0).is_full());
+    EXPECT_TRUE(table.shard(1).is_full());
+
+    EXPECT_THROW(sharded_table(2, 0), std::invalid_argument);
+    EXPECT_THROW(sharded_table(4, size_t{1} << 30), std::invalid_argument);
+    EXPECT_EQ(sharded_table(1, (size_t{1} << 31) - 2).max_id(),
+        static_cast<string_id>((size_t{1} << 31) - 2));
+  }
+  if (true) {
+    // Threads interning the same values agree on their IDs.
+    constexpr size_t thread_count = 4;
+    constexpr size_t value_count = 2000;
+    auto table = sharded_table::make(8, value_count);
+    std::array<std::vector<string_id>, thread_count> ids;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t)
+      threads.emplace_back([&, t] {
+        for (size_t i = 0; i < value_count; ++i)
+          ids[t].push_back(
+              table->intern(std::to_string((i * 7 + t) % value_count)).id());
+      });
+    for (auto& thread : threads) thread.join();
+    bool agree = true;
+    for (size_t t = 0; t < thread_count; ++t)
+      for (size_t i = 0; i < value_count; ++i)
+        agree = agree && ids[t][i] != string_id{} &&
+                ids[t][i] ==
+                    (*table)(std::to_string((i * 7 + t) % value_count)).id();
+    EXPECT_TRUE(agree);
+  }
+}
+
+void InternTableTest_Cache() {
+  if (true) {
+    auto sit_ptr = string_intern_table::make();
+    intern_cache<string_intern_table, 16> cache{sit_ptr};
+    EXPECT_FALSE(cache.get("abc"));
+    EXPECT_EQ(cache.misses(), 1u);
+    auto iv = cache.intern("abc");
+    EXPECT_EQ(iv.id(), string_id{1});
+    EXPECT_EQ(cache.misses(), 2u);
+    EXPECT_TRUE(cache.intern("abc"s) == iv);
+    EXPECT_TRUE(cache.get("abc"sv) == iv);
+    EXPECT_EQ(cache.hits(), 2u);
+
+    // Collisions just evict, and the answers stay right.
+    bool ok = true;
+    for (size_t i = 0; i < 200; ++i) {
+      const auto value = std::to_string(i % 50);
+      auto civ = cache.intern(value);
+      ok = ok && civ == sit_ptr->get(value) && civ.value() == value;
+    }
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(cache.hits() + cache.misses(), 204u);
+    EXPECT_TRUE(cache.hits() > 2u);
+    cache.clear();
+    EXPECT_TRUE(cache.get("abc") == iv);
+    EXPECT_TRUE(&cache.table() == sit_ptr.get());
+  }
+  if (true) {
+    // One per thread.
+    auto sit_ptr = string_intern_table::make();
+    std::array<bool, 3> ok{};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < ok.size(); ++t) {
+      threads.emplace_back([&, t] {
+        thread_local intern_cache<string_intern_table, 64> cache{sit_ptr};
+        bool good = true;
+        for (size_t i = 0; i < 500; ++i) {
+          const auto value = std::to_string(i % 20);
+          good = good && cache.intern(value).value() == value;
+        }
+        ok[t] = good && cache.hits() > 0;
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    for (auto good : ok) EXPECT_TRUE(good);
+  }
+}
+
+// Copy `bytes` into 8-byte-aligned storage, as a mapping would be, and
+// return a span over it.
+std::span<const std::byte> aligned_image(const std::string& bytes,
+    std::shared_ptr<const void>& owner) {
+  auto storage =
+      std::make_shared<std::vector<uint64_t>>((bytes.size() + 7) / 8);
+  std::memcpy(storage->data(), bytes.data(), bytes.size());
+  owner = storage;
+  return {reinterpret_cast<const std::byte*>(storage->data()), bytes.size()};
+}
+
+// Load an image from `bytes`, keeping a copy alive.
+auto load_image(const std::string& bytes) {
+  std::shared_ptr<const void> owner;
+  const auto span = aligned_image(bytes, owner);
+  return string_intern_image<string_id>::make(span, std::move(owner));
+}
+
+void InternImageTest_Basic() {
+  using image_t = string_intern_image<string_id>;
+  auto sit_ptr = string_intern_table::make(string_id{0}, string_id{3});
+  (void)sit_ptr->intern("abc");
+  (void)sit_ptr->intern("");
+  auto next_ptr = sit_ptr->make_next(string_id{10});
+  (void)next_ptr->intern("defghijklmnopqrstuvwxyz");
+  (void)next_ptr->intern("abc");
+  (void)next_ptr->intern("ghi");
+  // IDs: 1="abc", 2="", 3 unused, 4="defgh...", 5="ghi".
+  const auto bytes = image_t::serialize(*next_ptr);
+
+  if (true) {
+    std::shared_ptr<const void> owner;
+    const auto span = aligned_image(bytes, owner);
+    auto image = image_t::make(span, owner);
+    EXPECT_EQ(image->size(), 4u);
+    EXPECT_EQ(image->min_id(), string_id{1});
+    EXPECT_EQ(image->max_id(), string_id{5});
+    EXPECT_EQ(image->get(string_id{1}), "abc");
+    EXPECT_TRUE(image->get(string_id{2}).same(""));
+    EXPECT_TRUE(image->get(string_id{3}).null());
+    EXPECT_EQ((*image)(string_id{4}), "defghijklmnopqrstuvwxyz");
+    EXPECT_EQ(image->get(string_id{5}), "ghi");
+    EXPECT_TRUE(image->get(string_id{6}).null());
+    EXPECT_TRUE(image->get(string_id{}).null());
+
+    // Views point straight into the image.
+    const auto abc = image->get(string_id{1});
+    const auto begin = reinterpret_cast<const char*>(span.data());
+    EXPECT_TRUE(abc.data() >= begin && abc.data() < begin + span.size());
+
+    EXPECT_EQ(image->get("abc"), string_id{1});
+    EXPECT_EQ(image->get(""), string_id{2});
+    EXPECT_EQ((*image)("ghi"sv), string_id{5});
+    EXPECT_EQ(image->get("jkl"), string_id{});
+
+    // Invalid images.
+    EXPECT_THROW((void)image_t::make(span.first(16)), std::invalid_argument);
+    EXPECT_THROW((void)image_t::make(span.first(span.size() - 1)),
+        std::invalid_argument);
+    EXPECT_THROW((void)image_t::make(span.subspan(4)), std::invalid_argument);
+    auto corrupt = bytes;
+    corrupt[0] = 'X';
+    EXPECT_THROW((void)load_image(corrupt), std::invalid_argument);
+  }
+  if (true) {
+    // Chain a writable table for new IDs.
+    auto image = load_image(bytes);
+    auto imt = image->make_next();
+    EXPECT_EQ(imt->table().min_id(), string_id{6});
+    EXPECT_EQ(imt->intern("abc"), string_id{1});
+    EXPECT_EQ(imt->intern("jkl"), string_id{6});
+    EXPECT_EQ(imt->intern("jkl"), string_id{6});
+    EXPECT_EQ(imt->get("jkl"), string_id{6});
+    EXPECT_EQ(imt->get(string_id{6}), "jkl");
+    EXPECT_EQ(imt->get(string_id{4}), "defghijklmnopqrstuvwxyz");
+    EXPECT_TRUE(imt->get(string_id{7}).null());
+
+    // Roll forward into a new image.
+    const auto bytes2 = image_t::serialize(*imt);
+    auto image2 = load_image(bytes2);
+    EXPECT_EQ(image2->size(), 5u);
+    EXPECT_EQ(image2->get("jkl"), string_id{6});
+    EXPECT_TRUE(image2->get(string_id{3}).null());
+    EXPECT_EQ(image_t::serialize(*image2), bytes2);
+  }
+  if (true) {
+    // Many values.
+    auto big_ptr = string_intern_table::make();
+    for (size_t i = 0; i < 1000; ++i) (void)big_ptr->intern(std::to_string(i));
+    auto image = load_image(image_t::serialize(*big_ptr));
+    bool ok = true;
+    for (size_t i = 0; i < 1000; ++i) {
+      const auto value = std::to_string(i);
+      ok = ok && static_cast<size_t>(*image->get(value)) == i + 1 &&
+           image->get(static_cast<string_id>(i + 1)) == value;
+    }
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(image->get("1000"), string_id{});
+  }
+  if (true) {
+    // Empty.
+    auto image = load_image(image_t::serialize(*string_intern_table::make()));
+    EXPECT_TRUE(image->empty());
+    EXPECT_EQ(image->get("abc"), string_id{});
+    EXPECT_EQ(image->make_next()->intern("abc"), string_id{1});
+  }
+}
+
+void StringPoolTest_Basic() {
+  using pool_t = string_pool<string_id>;
+  if (true) {
+    pool_t pool;
+    EXPECT_TRUE(pool.empty());
+    EXPECT_EQ(pool.min_id(), string_id{1});
+    EXPECT_EQ(pool.get("abc"), string_id{});
+    EXPECT_TRUE(pool.get(string_id{1}).null());
+
+    EXPECT_EQ(pool.intern("abc"), string_id{1});
+    EXPECT_EQ(pool.intern(""), string_id{2});
+    EXPECT_EQ(pool.intern("defghijklmnopqrstuvwxyz"), string_id{3});
+    EXPECT_EQ(pool.intern("abc"sv), string_id{1});
+    EXPECT_EQ(pool.size(), 3u);
+    EXPECT_EQ(pool.blob_size(), 3u + 1 + 0 + 1 + 23 + 1);
+
+    EXPECT_EQ(pool.get(string_id{1}), "abc");
+    EXPECT_TRUE(pool.get(string_id{2}).same(""));
+    EXPECT_EQ(pool(string_id{3}), "defghijklmnopqrstuvwxyz");
+    EXPECT_TRUE(pool.get(string_id{4}).null());
+    EXPECT_TRUE(pool.get(string_id{}).null());
+    EXPECT_EQ(std::strlen(pool.get(string_id{1}).c_str()), 3u);
+    EXPECT_EQ(pool("defghijklmnopqrstuvwxyz"sv), string_id{3});
+
+    // Compatible with `string_intern_image`.
+    const auto image = load_image(string_intern_image<string_id>::serialize(
+        pool));
+    EXPECT_EQ(image->size(), 3u);
+    EXPECT_EQ(image->get(string_id{3}), "defghijklmnopqrstuvwxyz");
+    EXPECT_EQ(image->get(""), string_id{2});
+  }
+  if (true) {
+    // Limited range.
+    pool_t pool{string_id{10}, string_id{11}};
+    EXPECT_EQ(pool.intern("a"), string_id{10});
+    EXPECT_EQ(pool.intern("b"), string_id{11});
+    EXPECT_TRUE(pool.is_full());
+    EXPECT_EQ(pool.intern("c"), string_id{});
+    EXPECT_EQ(pool.intern("a"), string_id{10});
+    EXPECT_TRUE(pool.get(string_id{9}).null());
+  }
+  if (true) {
+    // Many short tokens cost little more than their bytes.
+    pool_t pool;
+    constexpr size_t count = 100'000;
+    size_t bytes{};
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < count; ++i) {
+      tokens.push_back("t" + std::to_string(i));
+      bytes += tokens.back().size();
+    }
+    pool.reserve(count, bytes);
+    const auto first = pool.intern(tokens[0]);
+    const auto* data = pool.get(first).data();
+    size_t mismatches{};
+    for (size_t i = 0; i < count; ++i)
+      if (pool.intern(tokens[i]) != static_cast<string_id>(i + 1))
+        ++mismatches;
+    for (size_t i = 0; i < count; ++i)
+      if (pool.get(static_cast<string_id>(i + 1)) != tokens[i] ||
+          pool.get(tokens[i]) != static_cast<string_id>(i + 1))
+        ++mismatches;
+    EXPECT_EQ(mismatches, 0u);
+    EXPECT_EQ(pool.blob_size(), bytes + count);
+    // Reserved, so nothing moved.
+    EXPECT_EQ(pool.get(first).data(), data);
+  }
+  if (true) {
+    // Works with an arena.
+    extensible_arena arena{4096};
+    extensible_arena::scope s{arena};
+    string_pool<string_id, arena_allocator<char>> pool;
+    const auto id = pool.intern("arena");
+    EXPECT_EQ(pool.get(id), "arena");
+    EXPECT_TRUE(arena.owns(pool.get(id).data()));
+  }
+}
+
+void SyncLockTest_Variants() {
+  EXPECT_TRUE(Synchronizer<synchronizer>);
+  EXPECT_FALSE(SharedSynchronizer<synchronizer>);
+  EXPECT_TRUE(SharedSynchronizer<shared_synchronizer>);
+  EXPECT_FALSE(SharedSynchronizer<spin_synchronizer>);
+  EXPECT_TRUE(SharedSynchronizer<null_synchronizer>);
+  if (true) {
+    // Readers share, and nested calls keep the mode.
+    using shared_lock_t = basic_lock<shared_synchronizer>;
+    shared_synchronizer sync;
+    shared_lock_t reader;
+    reader.shared(sync);
+    reader.shared(&sync);
+    EXPECT_TRUE(reader.owns_shared());
+    bool other_read{};
+    std::thread{[&] {
+      shared_lock_t other{shared_mode, sync};
+      other_read = other.owns_shared();
+    }}.join();
+    EXPECT_TRUE(other_read);
+
+    // Moving carries the mode along.
+    shared_lock_t moved{std::move(reader)};
+    EXPECT_FALSE(reader.owns_lock());
+    EXPECT_TRUE(moved.owns_shared());
+    moved = shared_lock_t{};
+    EXPECT_FALSE(moved.owns_lock());
+
+    // With the readers gone, a writer gets in.
+    shared_lock_t writer{sync};
+    EXPECT_TRUE(writer.owns_lock());
+    EXPECT_FALSE(writer.owns_shared());
+    writer.shared(sync);
+    EXPECT_FALSE(writer.owns_shared());
+  }
+  if (true) {
+    // Without shared support, `shared` locks exclusively.
+    synchronizer sync;
+    lock reader{shared_mode, sync};
+    EXPECT_TRUE(reader.owns_lock());
+    EXPECT_FALSE(reader.owns_shared());
+    const synchronizer* none{};
+    lock nothing{shared_mode, none};
+    EXPECT_FALSE(nothing.owns_lock());
+  }
+  if (true) {
+    // Spinning still excludes.
+    constexpr size_t thread_count = 4;
+    constexpr size_t increment_count = 20000;
+    spin_synchronizer sync;
+    size_t total{};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t)
+      threads.emplace_back([&] {
+        for (size_t i = 0; i < increment_count; ++i) {
+          basic_lock<spin_synchronizer> held{sync};
+          ++total;
+        }
+      });
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(total, thread_count * increment_count);
+  }
+  if (true) {
+    null_synchronizer sync;
+    basic_lock<null_synchronizer> held{sync};
+    EXPECT_TRUE(held.owns_lock());
+    held.shared(sync);
+    basic_breakable_synchronizer<null_synchronizer> breakable;
+    EXPECT_FALSE(breakable.is_disabled());
+    breakable.disable();
+    EXPECT_TRUE(breakable.is_disabled());
+  }
+}
+
+void InternTableTest_Synchronized() {
+  using shared_traits =
+      synchronized_intern_traits<std::string, string_id, shared_synchronizer>;
+  using spin_traits =
+      synchronized_intern_traits<std::string, string_id, spin_synchronizer>;
+  using null_traits =
+      synchronized_intern_traits<std::string, string_id, null_synchronizer>;
+  using SIT = intern_table<std::string, string_id, shared_traits>;
+  using PIT = intern_table<std::string, string_id, spin_traits>;
+  using NIT = intern_table<std::string, string_id, null_traits>;
+  if (true) {
+    auto sit_ptr = SIT::make(string_id{0}, string_id{3});
+    auto& sit = *sit_ptr;
+    EXPECT_EQ(sit.intern("abc").id(), string_id{1});
+    EXPECT_EQ(sit.intern("def").id(), string_id{2});
+    EXPECT_EQ(sit.intern("abc").id(), string_id{1});
+    EXPECT_EQ(sit("def").id(), string_id{2});
+    SIT::interned_value_t iv{sit, string_id{1}};
+    EXPECT_EQ(iv.value(), "abc");
+
+    // Readers share the lock with each other.
+    SIT::lock_t held{shared_mode, sit.sync};
+    EXPECT_TRUE(held.owns_shared());
+    EXPECT_EQ(sit("abc", held).id(), string_id{1});
+    bool found{};
+    std::thread{[&] {
+      found = sit("def").id() == string_id{2} &&
+              sit(string_id{1}).value() == "abc" &&
+              sit.intern("abc").id() == string_id{1};
+    }}.join();
+    EXPECT_TRUE(found);
+  }
+  if (true) {
+    // Interning in parallel.
+    constexpr size_t thread_count = 4;
+    constexpr size_t value_count = 500;
+    auto pit_ptr = PIT::make();
+    auto& pit = *pit_ptr;
+    std::array<bool, thread_count> interned_ok{};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t)
+      threads.emplace_back([&, t] {
+        bool ok = true;
+        for (size_t i = 0; i < value_count; ++i) {
+          const auto value = std::to_string(i);
+          const auto iv = pit.intern(value);
+          ok = ok && iv && iv.value() == value;
+        }
+        interned_ok[t] = ok;
+      });
+    for (auto& thread : threads) thread.join();
+    for (auto ok : interned_ok) EXPECT_TRUE(ok);
+    bool ids_ok = true;
+    for (size_t i = 0; i < value_count; ++i) {
+      const auto iv = pit(std::to_string(i));
+      ids_ok = ids_ok && iv && pit(iv.id()).value() == std::to_string(i);
+    }
+    EXPECT_TRUE(ids_ok);
+    EXPECT_FALSE(pit(static_cast<string_id>(value_count + 1)));
+  }
+  if (true) {
+    auto nit_ptr = NIT::make(string_id{0}, string_id{2});
+    auto& nit = *nit_ptr;
+    EXPECT_EQ(nit.intern("abc").id(), string_id{1});
+    EXPECT_EQ(nit.intern("def").id(), string_id{2});
+    EXPECT_TRUE(nit.is_full());
+    EXPECT_FALSE(nit.intern("ghi"));
+    EXPECT_EQ(nit(string_id{2}).value(), "def");
+  }
+}
+
+void InstrumentedSyncTest_Basic() {
+  using instrumented_shared = instrumented_synchronizer<shared_synchronizer>;
+  EXPECT_TRUE(TrySynchronizer<instrumented_synchronizer<>>);
+  EXPECT_FALSE(SharedSynchronizer<instrumented_synchronizer<>>);
+  EXPECT_TRUE(SharedSynchronizer<instrumented_shared>);
+  auto find_stats = [](std::string_view name) {
+    std::optional<sync_stats> found;
+    for (auto& stats : instrumented_sync_stats())
+      if (stats.name == name) found = stats;
+    return found;
+  };
+  if (true) {
+    instrumented_synchronizer<> sync{"alpha"};
+    using instrumented_lock = basic_lock<instrumented_synchronizer<>>;
+    for (int i = 0; i < 3; ++i) instrumented_lock held{sync};
+    auto stats = sync.stats();
+    EXPECT_EQ(stats.name, "alpha");
+    EXPECT_EQ(stats.acquisitions, 3u);
+    EXPECT_EQ(stats.contended, 0u);
+    EXPECT_EQ(stats.wait_time.count(), 0);
+    EXPECT_TRUE(sync.try_lock());
+    EXPECT_FALSE(sync.try_lock());
+    sync.unlock();
+    EXPECT_EQ(sync.stats().acquisitions, 4u);
+
+    // Contended while held.
+    sync.lock();
+    std::latch started{1};
+    std::thread waiter{[&] {
+      started.count_down();
+      instrumented_lock held{sync};
+    }};
+    started.wait();
+    std::this_thread::sleep_for(20ms);
+    sync.unlock();
+    waiter.join();
+    stats = sync.stats();
+    EXPECT_EQ(stats.acquisitions, 6u);
+    EXPECT_EQ(stats.contended, 1u);
+    EXPECT_TRUE(stats.wait_time > 0ns);
+    EXPECT_TRUE(stats.max_hold_time >= 20ms);
+
+    // Listed while live, by its current name.
+    EXPECT_TRUE(find_stats("alpha"));
+    sync.rename("beta");
+    EXPECT_FALSE(find_stats("alpha"));
+    auto listed = find_stats("beta");
+    EXPECT_TRUE(listed);
+    if (listed) EXPECT_EQ(listed->contended, 1u);
+
+    sync.reset();
+    stats = sync.stats();
+    EXPECT_EQ(stats.acquisitions, 0u);
+    EXPECT_EQ(stats.max_hold_time.count(), 0);
+  }
+  EXPECT_FALSE(find_stats("beta"));
+  if (true) {
+    // Shared acquisitions are counted.
+    instrumented_shared sync{"shared"};
+    basic_lock<instrumented_shared> reader{shared_mode, sync};
+    bool other_read{};
+    std::thread{[&] {
+      basic_lock<instrumented_shared> other{shared_mode, sync};
+      other_read = other.owns_shared();
+    }}.join();
+    EXPECT_TRUE(other_read);
+    EXPECT_EQ(sync.stats().acquisitions, 2u);
+    EXPECT_EQ(sync.stats().contended, 0u);
+  }
+  if (true) {
+    // Instrumenting a container.
+    using traits = synchronized_intern_traits<std::string, string_id,
+        instrumented_shared>;
+    auto sit_ptr = intern_table<std::string, string_id, traits>::make();
+    auto& sit = *sit_ptr;
+    sit.sync.actual().rename("strings");
+    EXPECT_EQ(sit.intern("abc").id(), string_id{1});
+    EXPECT_EQ(sit.intern("abc").id(), string_id{1});
+    EXPECT_EQ(sit("abc").id(), string_id{1});
+    auto stats = find_stats("strings");
+    EXPECT_TRUE(stats);
+    // Two shared lookups that hit, and one that missed and then locked.
+    if (stats) EXPECT_EQ(stats->acquisitions, 4u);
+  }
+}
+
 void NoInitResize_Basic() {
   std::vector<int> v;
   v.resize(2);
@@ -1197,15 +3093,97 @@ void NoInitResize_Basic() {
   // s.resize_and_overwrite(2);
 }
 
+void InstrumentationTest_Basic() {
+  if (true) {
+    counter c;
+    c.add();
+    c.add(4);
+    std::thread t{[&c] { c.add(10); }};
+    t.join();
+    EXPECT_EQ(c.value(), 15u);
+    c.reset();
+    EXPECT_EQ(c.value(), 0u);
+  }
+  if (true) {
+    using H = latency_histogram;
+    // Exact below 8, then 4 buckets per power of two.
+    for (uint64_t v = 0; v < 8; ++v) EXPECT_EQ(H::bucket_of(v), v);
+    EXPECT_EQ(H::bucket_of(8), 8u);
+    EXPECT_EQ(H::bucket_of(9), 8u);
+    EXPECT_EQ(H::bucket_of(10), 9u);
+    EXPECT_EQ(H::bucket_of(16), 12u);
+    EXPECT_EQ(H::bucket_max(8), 9u);
+    EXPECT_EQ(H::bucket_max(12), 19u);
+    EXPECT_EQ(H::bucket_of(uint64_t(-1)), H::bucket_count - 1);
+    EXPECT_EQ(H::bucket_max(H::bucket_count - 1), uint64_t(-1));
+    for (size_t b = 1; b < H::bucket_count; ++b) {
+      EXPECT_EQ(H::bucket_of(H::bucket_max(b - 1) + 1), b);
+      EXPECT_EQ(H::bucket_of(H::bucket_max(b)), b);
+    }
+
+    H h;
+    for (uint64_t v = 1; v <= 100; ++v) h.record(v);
+    std::thread t{[&h] { h.record(1000ms); }};
+    t.join();
+    h.record(-5ns);
+    auto s = h.snapshot();
+    EXPECT_EQ(s.count, 102u);
+    EXPECT_EQ(s.sum, 5050u + 1'000'000'000u);
+    EXPECT_EQ(s.max, 1'000'000'000u);
+    EXPECT_EQ(s.buckets[0], 1u);
+    EXPECT_EQ(s.percentile(0), 0u);
+    // The median is 50, which is in the bucket for 48 to 55.
+    EXPECT_EQ(s.percentile(0.5), 55u);
+    EXPECT_EQ(s.percentile(1), 1'000'000'000u);
+    h.reset();
+    EXPECT_EQ(h.snapshot().count, 0u);
+    EXPECT_EQ(h.snapshot().percentile(0.5), 0u);
+  }
+  if (true) {
+    latency_histogram h;
+    {
+      scoped_timer timed{h};
+      std::this_thread::sleep_for(1ms);
+    }
+    const auto s = h.snapshot();
+    EXPECT_EQ(s.count, 1u);
+    EXPECT_GE(s.max, 1'000'000u);
+  }
+  if (true) {
+    // Probes wired into the library.
+    auto& p = library_probes();
+    p.reset();
+    extensible_arena arena{64};
+    extensible_arena::scope s{arena};
+    EXPECT_EQ(p.arena_blocks.value(), 1u);
+    auto sit_ptr = string_intern_table::make();
+    auto& sit = *sit_ptr;
+    EXPECT_TRUE(sit.intern("abc"s));
+    EXPECT_TRUE(sit.intern("abc"s));
+    EXPECT_TRUE(sit.intern("def"s));
+    EXPECT_EQ(p.intern_hits.value(), 1u);
+    EXPECT_EQ(p.intern_misses.value(), 2u);
+    EXPECT_GT(p.arena_blocks.value(), 1u);
+  }
+}
+
 MAKE_TEST_LIST(OptionalPtrTest_Construction, OptionalPtrTest_Access,
     OptionalPtrTest_OrElse, OptionalPtrTest_ConstOrPtr, OptionalPtrTest_Dumb,
     FindOptTest_Maps, FindOptTest_Sets, FindOptTest_Vectors,
     FindOptTest_Arrays, FindOptTest_Strings, FindOptTest_Reversed,
     Intervals_Ctors, IntervalTest_Insert, IntervalTest_ForEach,
     IntervalTest_Reverse, IntervalTest_MinMax, IntervalTest_CompareAndSwap,
-    IntervalTest_Append, TransparentTest_General, IndirectKey_Basic,
-    InternTableTest_Basic, InternTableTest_Badkey, OwnPtrTest_Ctor,
-    DeductionTest_Experimental, CustomHandleTest_Basic, NoInitResize_Basic);
+    IntervalTest_Append, EnumContainerTest_Basic, IntervalSetTest_Basic,
+    TransparentTest_General, FlatStringMapTest_Basic, IndirectKey_Basic,
+    ArenaTest_Blocks, ArenaTest_Threads, ArenaTest_Rewind, ArenaTest_Stats,
+    RopeTest_Basic, InternTableTest_Basic, InternTableTest_Badkey,
+    OwnPtrTest_Ctor, DeductionTest_Experimental, CustomHandleTest_Basic,
+    SmallFunctionTest_Basic, FreeListTest_Basic, ObjectPoolTest_Basic,
+    SegmentedVectorTest_Basic, FlatIndexTest_Basic, InternTableTest_Flat,
+    InternTableTest_Concurrent, InternTableTest_Bulk, InternTableTest_Chain,
+    InternTableTest_Sharded, InternTableTest_Cache, InternImageTest_Basic,
+    StringPoolTest_Basic, SyncLockTest_Variants, InternTableTest_Synchronized,
+    InstrumentedSyncTest_Basic, InstrumentationTest_Basic, NoInitResize_Basic);
 
 // Ok, so the plan is to make all of the Ptr/Del ctors take the same three
 // templated arguments. The third is just a named thing that's defaulted to
@@ -0,0 +1,300 @@
+// Corvid20: A general-purpose C++20 library extending std.
+// https://github.com/stevensudit/Corvid20
+//
+// Copyright 2022-2024 Steven Sudit
+//
+// Licensed under the Apache License, Version 2.0(the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../corvid/containers.h"
+#include "../corvid/io.h"
+#include "../corvid/strings.h"
+#include "AccutestShim.h"
+
+using namespace std::literals;
+using namespace corvid;
+
+// Temporary file, deleted when destroyed.
+struct temp_file {
+  explicit temp_file(std::string_view contents) {
+    auto fd = adopt_fd(::mkstemp(path.data()));
+    if (!fd) throw_errno("mkstemp");
+    if (::write(*fd, contents.data(), contents.size()) !=
+        static_cast<ssize_t>(contents.size()))
+      throw_errno("write");
+  }
+  ~temp_file() { ::unlink(path.c_str()); }
+
+  std::string path = "/tmp/corvid_io_test_XXXXXX";
+};
+
+void UniqueFdTest_Basic() {
+  if (true) {
+    unique_fd fd;
+    EXPECT_FALSE(fd);
+    EXPECT_EQ(sizeof(fd), sizeof(int));
+    EXPECT_EQ(*fd, -1);
+  }
+  if (true) {
+    auto [r, w] = make_pipe();
+    EXPECT_TRUE(r);
+    EXPECT_TRUE(w);
+    const int raw = *r;
+    EXPECT_TRUE(::fcntl(raw, F_GETFD) & FD_CLOEXEC);
+
+    // Moving transfers ownership, and resetting closes.
+    unique_fd moved{std::move(r)};
+    EXPECT_FALSE(r);
+    EXPECT_EQ(*moved, raw);
+    moved.reset();
+    EXPECT_FALSE(moved);
+    EXPECT_EQ(::fcntl(raw, F_GETFD), -1);
+
+    // Releasing doesn't close.
+    auto released = w.release();
+    EXPECT_FALSE(w);
+    EXPECT_NE(::fcntl(*released, F_GETFD), -1);
+    ::close(*released);
+  }
+  if (true) {
+    EXPECT_THROW((void)open_fd("/nonexistent/corvid", O_RDONLY),
+        std::system_error);
+    temp_file tf{"hello"};
+    auto fd = open_fd(tf.path, O_RDONLY);
+    char buf[8]{};
+    EXPECT_EQ(::read(*fd, buf, sizeof(buf)), 5);
+    EXPECT_EQ(std::string_view{buf}, "hello");
+  }
+}
+
+void MappedFileTest_Basic() {
+  if (true) {
+    temp_file tf{"alpha,beta\ngamma,delta\n"};
+    mapped_file mf{tf.path, mapped_file::advice::sequential};
+    EXPECT_EQ(mf.size(), 23u);
+    EXPECT_EQ(mf.view(), "alpha,beta\ngamma,delta\n");
+    EXPECT_EQ(mf.span().size(), 23u);
+    EXPECT_EQ(mf.bytes().size(), 23u);
+
+    // Split straight over the mapping.
+    const auto lines = strings::split(mf.view(), "\n");
+    EXPECT_EQ(lines.size(), 3u);
+    EXPECT_EQ(lines[1], "gamma,delta");
+    EXPECT_TRUE(lines[1].data() == mf.data() + 11);
+    mf.advise(mapped_file::advice::willneed, 11);
+    mf.advise(mapped_file::advice::random, 100);
+
+    // Moving transfers the mapping.
+    mapped_file other{std::move(mf)};
+    EXPECT_TRUE(mf.empty());
+    EXPECT_TRUE(mf.view().empty());
+    EXPECT_EQ(other.view().substr(0, 5), "alpha");
+  }
+  if (true) {
+    temp_file tf{""};
+    mapped_file mf{tf.path};
+    EXPECT_TRUE(mf.empty());
+    EXPECT_EQ(mf.view(), "");
+  }
+  if (true) {
+    EXPECT_THROW(mapped_file{"/nonexistent/corvid"}, std::system_error);
+  }
+}
+
+void VectoredIoTest_Basic() {
+  if (true) {
+    auto [r, w] = make_pipe();
+    std::string a = "abc", b = "defg";
+    const std::array<std::span<const char>, 2> out{std::span{a},
+        std::span{b}};
+    EXPECT_EQ(write_segments(w, out), 7);
+    std::array<char, 3> x{};
+    std::array<char, 8> y{};
+    const std::array<std::span<char>, 2> in{std::span{x}, std::span{y}};
+    EXPECT_EQ(read_segments(r, in), 7);
+    EXPECT_EQ(std::string_view(x.data(), 3), "abc");
+    EXPECT_EQ(std::string_view(y.data(), 4), "defg");
+  }
+  if (true) {
+    // Through circular buffers, across the wrap.
+    auto [r, w] = make_pipe(O_NONBLOCK);
+    std::array<char, 8> ra{}, wa{};
+    circular_buffer in{ra};
+    pow2_circular_buffer out{wa};
+    out.push_back_range(std::span{"012345"sv});
+    out.drop_front_n(5);
+    out.push_back_range(std::span{"6789ab"sv});
+    EXPECT_EQ(out.segments()[1].size(), 4u);
+    EXPECT_EQ(write_from(w, out), 7);
+    EXPECT_TRUE(out.empty());
+
+    in.push_back_range(std::span{"xxxxx"sv});
+    in.drop_front_n(5);
+    EXPECT_EQ(read_into(r, in), 7);
+    EXPECT_EQ(std::string(in.begin(), in.end()), "56789ab");
+    EXPECT_EQ(in.segments()[1].size(), 4u);
+
+    // Nothing left, so a non-blocking read fails with EAGAIN.
+    in.clear();
+    EXPECT_EQ(read_into(r, in), -1);
+    EXPECT_EQ(errno, EAGAIN);
+
+    // End of file.
+    w.reset();
+    EXPECT_EQ(read_into(r, in), 0);
+    EXPECT_TRUE(in.empty());
+  }
+}
+
+void ReactorTest(reactor_backend preferred) {
+  if (true) {
+    // Reads from a pipe, batched with a timer.
+    reactor r{64, preferred};
+    if (preferred == reactor_backend::epoll)
+      EXPECT_TRUE(r.backend() == reactor_backend::epoll);
+    auto [rd, wr] = make_pipe(O_NONBLOCK);
+    std::array<char, 16> a{};
+    circular_buffer in{a};
+    size_t reads{};
+    r.watch(rd, EPOLLIN, [&](int fd, uint32_t events) {
+      EXPECT_TRUE(events & EPOLLIN);
+      EXPECT_EQ(read_into(fd, in), 5);
+      ++reads;
+    });
+    EXPECT_EQ(r.watched(), 1u);
+    EXPECT_THROW(r.watch(rd, EPOLLIN, [](int, uint32_t) {}),
+        std::invalid_argument);
+    EXPECT_EQ(r.watched(), 1u);
+
+    size_t fired{};
+    r.timers().set(5ms, [&](timer_event&) { ++fired; });
+    EXPECT_EQ(::write(*wr, "hello", 5), 5);
+    EXPECT_EQ(r.run_once(), 1u);
+    EXPECT_EQ(reads, 1u);
+    EXPECT_EQ(std::string(in.begin(), in.end()), "hello");
+    EXPECT_EQ(fired, 0u);
+
+    // With nothing to read, the wait ends when the timer is due.
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(r.run_once(), 1u);
+    EXPECT_TRUE(std::chrono::steady_clock::now() - start >= 4ms);
+    EXPECT_EQ(fired, 1u);
+
+    // Nothing ready, so this just times out.
+    EXPECT_EQ(r.run_once(1ms), 0u);
+
+    EXPECT_TRUE(r.unwatch(rd));
+    EXPECT_FALSE(r.unwatch(rd));
+    EXPECT_EQ(::write(*wr, "again", 5), 5);
+    EXPECT_EQ(r.run_once(1ms), 0u);
+    EXPECT_EQ(reads, 1u);
+  }
+  if (true) {
+    // A callback that unwatches itself.
+    wheel_reactor r{64, preferred};
+    auto [rd, wr] = make_pipe(O_NONBLOCK);
+    size_t calls{};
+    r.watch(rd, EPOLLIN, [&](int fd, uint32_t) {
+      ++calls;
+      r.unwatch(fd);
+    });
+    EXPECT_EQ(::write(*wr, "x", 1), 1);
+    EXPECT_EQ(r.run_once(), 1u);
+    EXPECT_EQ(r.run_once(1ms), 0u);
+    EXPECT_EQ(calls, 1u);
+    EXPECT_EQ(r.watched(), 0u);
+  }
+  if (true) {
+    // Posting from another thread, then stopping.
+    reactor r{64, preferred};
+    std::vector<int> seen;
+    std::thread t{[&] {
+      for (int i = 0; i < 3; ++i)
+        r.post([&seen, i](timer_event&) { seen.push_back(i); });
+      r.post([&r](timer_event&) { r.stop(); });
+    }};
+    EXPECT_EQ(r.run(), 4u);
+    t.join();
+    EXPECT_EQ(seen.size(), 3u);
+    EXPECT_EQ(seen[0], 0);
+    EXPECT_EQ(seen[2], 2);
+    EXPECT_TRUE(r.timers().events().empty());
+  }
+  if (true) {
+    // Level-triggered, so unread data is reported again.
+    reactor r{64, preferred};
+    auto [rd, wr] = make_pipe(O_NONBLOCK);
+    size_t calls{};
+    r.watch(rd, EPOLLIN, [&](int fd, uint32_t) {
+      char c;
+      EXPECT_EQ(::read(fd, &c, 1), 1);
+      ++calls;
+    });
+    EXPECT_EQ(::write(*wr, "abc", 3), 3);
+    for (size_t i = 0; i < 3; ++i) EXPECT_EQ(r.run_once(1s), 1u);
+    EXPECT_EQ(calls, 3u);
+    EXPECT_EQ(r.run_once(1ms), 0u);
+
+    // One-shot until modified, and modified to wait for something else.
+    r.modify(rd, EPOLLIN | EPOLLONESHOT);
+    EXPECT_EQ(::write(*wr, "de", 2), 2);
+    EXPECT_EQ(r.run_once(1s), 1u);
+    EXPECT_EQ(r.run_once(1ms), 0u);
+    EXPECT_EQ(calls, 4u);
+    r.modify(rd, EPOLLIN);
+    EXPECT_EQ(r.run_once(1s), 1u);
+    EXPECT_EQ(calls, 5u);
+    r.modify(rd, EPOLLOUT);
+    EXPECT_EQ(::write(*wr, "f", 1), 1);
+    EXPECT_EQ(r.run_once(1ms), 0u);
+    EXPECT_EQ(calls, 5u);
+
+    // A new watch of a reused descriptor number ignores the old one.
+    auto [rd1, wr1] = make_pipe(O_NONBLOCK);
+    size_t writes{};
+    const int wr1_fd = *wr1;
+    r.watch(wr1, EPOLLOUT, [&](int, uint32_t events) {
+      EXPECT_TRUE(events & EPOLLOUT);
+      ++writes;
+    });
+    EXPECT_EQ(r.run_once(1s), 1u);
+    EXPECT_TRUE(r.unwatch(wr1));
+    wr1.reset();
+    auto [rd2, wr2] = make_pipe(O_NONBLOCK);
+    EXPECT_EQ(*rd2, wr1_fd);
+    size_t reads2{};
+    r.watch(rd2, EPOLLIN, [&](int, uint32_t) { ++reads2; });
+    EXPECT_EQ(r.run_once(1ms), 0u);
+    EXPECT_EQ(writes, 1u);
+    EXPECT_EQ(reads2, 0u);
+
+    // Only fails to watch a closed descriptor.
+    EXPECT_THROW(r.watch(-1, EPOLLIN, [](int, uint32_t) {}),
+        std::system_error);
+    EXPECT_EQ(r.watched(), 2u);
+  }
+}
+
+void ReactorTest_Basic() {
+  ReactorTest(reactor_backend::io_uring);
+  ReactorTest(reactor_backend::epoll);
+}
+
+MAKE_TEST_LIST(UniqueFdTest_Basic, MappedFileTest_Basic,
+    VectoredIoTest_Basic, ReactorTest_Basic);
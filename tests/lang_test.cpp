@@ -15,11 +15,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <map>
+#include <regex>
 #include <set>
 #include <vector>
 
+#define CORVID_INSTRUMENTATION 1
 #include "../corvid/lang.h"
 #include "AccutestShim.h"
 
@@ -418,4 +422,729 @@ void LangTest_AstPred() {
   }
 }
 
-MAKE_TEST_LIST(LangTest_AstPred);
+void LangTest_Eval() {
+  using enum operation;
+  map_lookup lk;
+  lk.m["A"] = any_single_value{"a"s};
+  lk.m["N"] = any_single_value{int64_t{5}};
+  lk.m["R"] = std::vector<any_single_value>{"x"s, int64_t{7}};
+  lk.m["Z"] = any_single_value{};
+  if (true) {
+    EXPECT_TRUE(M<exists>("A"s)->eval(lk));
+    EXPECT_FALSE(M<exists>("B"s)->eval(lk));
+    EXPECT_FALSE(M<exists>("Z"s)->eval(lk));
+    EXPECT_TRUE(M<absent>("Z"s)->eval(lk));
+    EXPECT_TRUE(M<eq>("A"s, any_value{any_single_value{"a"s}})->eval(lk));
+    EXPECT_FALSE(M<eq>("A"s, "N"s)->eval(lk));
+    EXPECT_TRUE(M<ne>("A"s, "N"s)->eval(lk));
+    EXPECT_TRUE(M<eq>("B"s, "Z"s)->eval(lk));
+    EXPECT_TRUE(
+        M<eq>("R"s, any_value{any_single_value{int64_t{7}}})->eval(lk));
+    EXPECT_FALSE(
+        M<eq>("R"s, any_value{any_single_value{int64_t{5}}})->eval(lk));
+    EXPECT_TRUE(M<and_junction>()->eval(lk));
+    EXPECT_FALSE(M<or_junction>()->eval(lk));
+    EXPECT_TRUE(M<not_junction>(M<exists>("B"s))->eval(lk));
+  }
+}
+
+void LangTest_Program() {
+  using enum operation;
+  std::vector<map_lookup> lookups(6);
+  lookups[1].m["A"] = any_single_value{"a"s};
+  lookups[2].m["A"] = any_single_value{"b"s};
+  lookups[2].m["B"] = any_single_value{int64_t{1}};
+  lookups[3].m["B"] = any_single_value{int64_t{1}};
+  lookups[3].m["C"] = std::vector<any_single_value>{"a"s, "c"s};
+  lookups[4].m["A"] = any_single_value{"c"s};
+  lookups[4].m["C"] = any_single_value{"c"s};
+  lookups[4].m["D"] = any_single_value{};
+  for (auto key : {"A"s, "B"s, "C"s, "D"s})
+    lookups[5].m[key] = any_single_value{"a"s};
+
+  const auto a = any_value{any_single_value{"a"s}};
+  const auto one = any_value{any_single_value{int64_t{1}}};
+  const node_list roots{M<always_true>(), M<always_false>(),
+      M<and_junction>(), M<or_junction>(), M<exists>("A"s),
+      M<absent>("D"s), M<eq>("A"s, a), M<ne>("B"s, one), M<eq>("A"s, "C"s),
+      M<eq>("C"s, a),
+      M<and_junction>(M<exists>("A"s),
+          M<or_junction>(M<eq>("B"s, one), M<not_junction>(M<eq>("A"s, a)))),
+      M<or_junction>(M<and_junction>(M<exists>("A"s), M<absent>("B"s)),
+          M<and_junction>(M<exists>("C"s), M<eq>("A"s, "C"s))),
+      M<not_junction>(M<or_junction>(M<eq>("A"s, a),
+          M<and_junction>(M<exists>("B"s),
+              M<not_junction>(M<eq>("C"s, a))))),
+      M<and_junction>(M<exists>("A"s), M<exists>("B"s), M<exists>("C"s),
+          M<exists>("D"s))};
+
+  for (const auto& root : roots) {
+    const program prog{root};
+    const program dnf_prog{dnf::convert(root)};
+    for (const auto& lk : lookups) {
+      const auto expected = root->eval(lk);
+      EXPECT_EQ(prog.eval(lk), expected);
+      EXPECT_EQ(dnf_prog.eval(lk), expected);
+
+      std::vector<const any_value*> fields;
+      for (const auto& key : prog.keys()) {
+        const auto it = lk.m.find(key);
+        fields.push_back(it == lk.m.end() ? nullptr : &it->second);
+      }
+      EXPECT_EQ(prog.eval(fields), expected);
+    }
+  }
+
+  if (true) {
+    // Keys are shared, and junctions become jumps.
+    const program prog{
+        M<or_junction>(M<and_junction>(M<exists>("A"s), M<eq>("A"s, "B"s)),
+            M<absent>("B"s))};
+    EXPECT_EQ(prog.keys().size(), 2u);
+    EXPECT_EQ(prog.literals().size(), 0u);
+    const auto code = prog.code();
+    EXPECT_EQ(code.size(), 5u);
+    EXPECT_TRUE(code[1].op == program::opcode::jump_if_false);
+    EXPECT_EQ(code[1].lhs, 3u);
+    EXPECT_TRUE(code[3].op == program::opcode::jump_if_true);
+    EXPECT_EQ(code[3].lhs, 5u);
+  }
+  if (true) {
+    // Identical literals are stored once.
+    const program prog{M<or_junction>(M<eq>("A"s, one), M<eq>("B"s, one),
+        M<eq>("C"s, a), M<eq>("D"s, one))};
+    EXPECT_EQ(prog.literals().size(), 2u);
+    EXPECT_TRUE(prog.eval(lookups[3]));
+    EXPECT_FALSE(prog.eval(lookups[0]));
+  }
+  if (true) {
+    // A null root is false.
+    const program prog{node_ptr{}};
+    EXPECT_EQ(prog.code().size(), 1u);
+    EXPECT_FALSE(prog.eval(lookups[0]));
+  }
+}
+
+void LangTest_Batch() {
+  using enum operation;
+  if (true) {
+    selection s{70};
+    EXPECT_TRUE(s.none());
+    s.flip();
+    EXPECT_TRUE(s.all());
+    EXPECT_EQ(s.count(), 70u);
+    EXPECT_EQ(s.words()[1], 0x3Fu);
+    s.set(3, false);
+    EXPECT_FALSE(s.test(3));
+    EXPECT_TRUE(s.test(69));
+    EXPECT_EQ(s.count(), 69u);
+    s &= selection::scan(70, [](size_t i) { return i % 2; });
+    EXPECT_EQ(s.count(), 34u);
+  }
+  if (true) {
+    record_batch batch{3};
+    EXPECT_THROW(batch.add("A", std::vector<int64_t>{1, 2}),
+        std::invalid_argument);
+  }
+
+  // Build a batch and the same records as lookups.
+  constexpr size_t rows = 150;
+  record_batch batch{rows};
+  std::vector<map_lookup> lookups(rows);
+  std::vector<int64_t> ints;
+  std::vector<std::string> strings;
+  std::vector<any_value> anys;
+  for (size_t i = 0; i < rows; ++i) {
+    ints.push_back(static_cast<int64_t>(i % 5));
+    strings.push_back(i % 3 ? "a"s : "b"s);
+    if (i % 4 == 0)
+      anys.emplace_back();
+    else if (i % 4 == 1)
+      anys.emplace_back(any_single_value{"a"s});
+    else if (i % 4 == 2)
+      anys.emplace_back(any_single_value{static_cast<int64_t>(i % 5)});
+    else
+      anys.emplace_back(std::vector<any_single_value>{"b"s, int64_t{2}});
+    lookups[i].m["N"] = any_single_value{ints.back()};
+    lookups[i].m["S"] = any_single_value{strings.back()};
+    if (i % 4) lookups[i].m["V"] = anys.back();
+  }
+  batch.add("N", ints);
+  batch.add("S", strings);
+  batch.add("V", anys);
+
+  const auto a = any_value{any_single_value{"a"s}};
+  const auto two = any_value{any_single_value{int64_t{2}}};
+  const auto both = any_value{std::vector<any_single_value>{"b"s, int64_t{3}}};
+  const node_list roots{M<always_true>(), M<always_false>(),
+      M<exists>("N"s), M<exists>("V"s), M<absent>("V"s), M<absent>("X"s),
+      M<eq>("N"s, two), M<ne>("N"s, two), M<eq>("S"s, a), M<eq>("N"s, a),
+      M<eq>("N"s, both), M<eq>("S"s, both), M<eq>(two, "V"s),
+      M<eq>("V"s, both), M<eq>("V"s, "N"s), M<eq>("V"s, "S"s),
+      M<eq>("N"s, "S"s), M<eq>("S"s, "S"s), M<eq>("X"s, "V"s),
+      M<eq>(a, a), M<ne>("X"s, two),
+      M<and_junction>(M<eq>("S"s, a),
+          M<or_junction>(M<eq>("N"s, two), M<not_junction>(M<exists>("V"s)))),
+      M<or_junction>(M<and_junction>(M<eq>("V"s, "N"s), M<absent>("X"s)),
+          M<not_junction>(M<eq>("S"s, "V"s))),
+      M<and_junction>(M<always_false>(), M<exists>("N"s)),
+      M<or_junction>(M<always_true>(), M<exists>("N"s))};
+
+  for (const auto& root : roots) {
+    const auto selected = eval_batch(root, batch);
+    EXPECT_EQ(selected.size(), rows);
+    size_t mismatches{};
+    for (size_t i = 0; i < rows; ++i)
+      if (selected.test(i) != root->eval(lookups[i])) ++mismatches;
+    EXPECT_EQ(mismatches, 0u);
+  }
+}
+
+void LangTest_Fields() {
+  using enum operation;
+  auto keys = key_table::make();
+  const auto one = any_value{any_single_value{int64_t{1}}};
+  program prog{M<and_junction>(M<exists>("A"s),
+      M<or_junction>(M<eq>("B"s, one), M<eq>("A"s, "C"s)))};
+  EXPECT_TRUE(prog.field_ids().empty());
+  EXPECT_TRUE(prog.bind(*keys));
+  EXPECT_EQ(prog.field_ids().size(), 3u);
+  EXPECT_EQ(static_cast<uint32_t>(prog.field_ids()[0]), 1u);
+  EXPECT_EQ(static_cast<uint32_t>(prog.field_ids()[2]), 3u);
+
+  // A second program shares the IDs of keys already interned.
+  program other{M<exists>("C"s)};
+  EXPECT_TRUE(other.bind(*keys));
+  EXPECT_TRUE(other.field_ids()[0] == prog.field_ids()[2]);
+
+  field_lookup lk{keys};
+  EXPECT_FALSE(prog.eval(lk));
+  EXPECT_TRUE(lk.set("A", any_single_value{"x"s}));
+  EXPECT_FALSE(lk.set("Z", any_single_value{"x"s}));
+  EXPECT_TRUE(lk["Z"] == lookup::missing);
+  EXPECT_FALSE(prog.eval(lk));
+  lk.set(prog.field_ids()[1], one);
+  EXPECT_TRUE(prog.eval(lk));
+  EXPECT_TRUE(prog.eval(static_cast<const lookup&>(lk)));
+  lk.clear();
+  EXPECT_FALSE(prog.eval(lk));
+  lk.set("A", any_single_value{"x"s});
+  lk.set("C", any_single_value{"x"s});
+  EXPECT_TRUE(prog.eval(lk));
+  EXPECT_TRUE(other.eval(lk));
+
+  // Unbound programs still work, by key.
+  const program unbound{M<eq>("A"s, "C"s)};
+  EXPECT_TRUE(unbound.eval(lk));
+}
+
+void LangTest_DnfBounds() {
+  using enum operation;
+  node_ptr root;
+  if (true) {
+    // Repeated literals and terms are dropped.
+    root = dnf::convert(M<and_junction>(M<exists>("A"s), M<exists>("A"s)));
+    EXPECT_EQ(root->print(), "exists:(A)");
+    root = dnf::convert(M<or_junction>(M<exists>("A"s), M<exists>("B"s),
+        M<exists>("A"s)));
+    EXPECT_EQ(root->print(), "or:(exists:(A), exists:(B))");
+    root = dnf::convert(
+        M<or_junction>(M<and_junction>(M<exists>("A"s), M<exists>("B"s)),
+            M<and_junction>(M<exists>("B"s), M<exists>("A"s))));
+    EXPECT_EQ(root->print(), "and:(exists:(A), exists:(B))");
+  }
+  if (true) {
+    // Absorption.
+    root = dnf::convert(M<or_junction>(M<exists>("A"s),
+        M<and_junction>(M<exists>("A"s), M<exists>("B"s))));
+    EXPECT_EQ(root->print(), "exists:(A)");
+    root = dnf::convert(M<and_junction>(M<exists>("A"s),
+        M<or_junction>(M<exists>("A"s), M<exists>("B"s))));
+    EXPECT_EQ(root->print(), "exists:(A)");
+    root = dnf::convert(
+        M<and_junction>(M<or_junction>(M<exists>("A"s), M<exists>("B"s)),
+            M<or_junction>(M<exists>("A"s), M<exists>("C"s))));
+    EXPECT_EQ(root->print(), "or:(exists:(A), and:(exists:(B), exists:(C)))");
+  }
+  if (true) {
+    // Identical leaves are shared.
+    root = dnf::convert(
+        M<or_junction>(M<and_junction>(M<exists>("A"s), M<exists>("B"s)),
+            M<and_junction>(M<exists>("A"s), M<exists>("C"s))));
+    const auto& terms = junction::list(root);
+    ASSERT_EQ(terms.size(), 2u);
+    EXPECT_TRUE(
+        junction::list(terms[0])[0] == junction::list(terms[1])[0]);
+  }
+  if (true) {
+    // Negations are normalized, too.
+    root = dnf::convert(M<not_junction>(M<or_junction>(M<exists>("A"s),
+        M<and_junction>(M<exists>("B"s),
+            M<or_junction>(M<exists>("C"s), M<exists>("D"s))))));
+    EXPECT_EQ(root->print(), "or:(and:(absent:(A), absent:(B)), "
+                             "and:(absent:(A), absent:(C), absent:(D)))");
+    EXPECT_TRUE(dnf::is_dnf(root));
+  }
+  if (true) {
+    // Distribution gives up past the budget, leaving an equivalent AND.
+    node_list ors;
+    for (int i = 0; i < 20; ++i)
+      ors.push_back(M<or_junction>(M<exists>("A"s + std::to_string(i)),
+          M<exists>("B"s + std::to_string(i))));
+    const auto big = M<and_junction>(std::move(ors));
+    root = dnf::convert(big);
+    EXPECT_FALSE(dnf::is_dnf(root));
+    EXPECT_EQ(junction::list(root).size(), 20u);
+
+    map_lookup lk;
+    EXPECT_EQ(root->eval(lk), big->eval(lk));
+    for (int i = 0; i < 20; ++i)
+      lk.m[(i % 2 ? "A"s : "B"s) + std::to_string(i)] =
+          any_single_value{int64_t{i}};
+    EXPECT_TRUE(root->eval(lk));
+    EXPECT_EQ(root->eval(lk), big->eval(lk));
+    lk.m.erase("B4");
+    EXPECT_FALSE(root->eval(lk));
+
+    // Within the budget, it's converted.
+    root = dnf::convert(
+        M<and_junction>(M<or_junction>(M<exists>("A"s), M<exists>("B"s)),
+            M<or_junction>(M<exists>("C"s), M<exists>("D"s)),
+            M<or_junction>(M<exists>("E"s), M<exists>("F"s))),
+        8);
+    EXPECT_TRUE(dnf::is_dnf(root));
+    EXPECT_EQ(junction::list(root).size(), 8u);
+    root = dnf::convert(
+        M<and_junction>(M<or_junction>(M<exists>("A"s), M<exists>("B"s)),
+            M<or_junction>(M<exists>("C"s), M<exists>("D"s)),
+            M<or_junction>(M<exists>("E"s), M<exists>("F"s))),
+        7);
+    EXPECT_FALSE(dnf::is_dnf(root));
+  }
+}
+
+void LangTest_Index() {
+  using enum operation;
+  const auto v = [](int64_t n) { return any_value{any_single_value{n}}; };
+  if (true) {
+    predicate_index index;
+    EXPECT_TRUE(index.empty());
+    index.add(1, M<eq>("A"s, v(1)));
+    index.add(2, M<and_junction>(M<eq>("A"s, v(1)), M<exists>("B"s)));
+    index.add(3, M<or_junction>(M<eq>(v(2), "A"s), M<absent>("B"s)));
+    index.add(4, M<always_true>());
+    index.add(5, M<always_false>());
+    index.add(6, M<and_junction>(M<exists>("B"s), M<ne>("A"s, "B"s)));
+    EXPECT_EQ(index.size(), 6u);
+    EXPECT_EQ(index.conjunctions(), 6u);
+
+    map_lookup lk;
+    EXPECT_EQ(corvid::strings::join(index.match(lk)), "[3, 4]");
+    lk.m["A"] = any_single_value{int64_t{1}};
+    EXPECT_EQ(corvid::strings::join(index.match(lk)), "[1, 3, 4]");
+    lk.m["B"] = any_single_value{"x"s};
+    EXPECT_EQ(corvid::strings::join(index.match(lk)), "[1, 2, 4, 6]");
+    lk.m["A"] = std::vector<any_single_value>{int64_t{2}, int64_t{1},
+        int64_t{2}};
+    EXPECT_EQ(corvid::strings::join(index.match(lk)), "[1, 2, 3, 4, 6]");
+    lk.m["B"] = lk.m["A"];
+    EXPECT_EQ(corvid::strings::join(index.match(lk)), "[1, 2, 3, 4]");
+  }
+  if (true) {
+    // Agrees with evaluating each predicate.
+    std::vector<node_ptr> preds;
+    uint32_t seed = 1;
+    const auto next = [&](uint32_t n) {
+      seed = seed * 1103515245 + 12345;
+      return (seed >> 16) % n;
+    };
+    const auto key = [&] { return "K"s + std::to_string(next(4)); };
+    const auto leaf = [&]() -> node_ptr {
+      switch (next(8)) {
+      case 0: return M<exists>(key());
+      case 1: return M<absent>(key());
+      case 2: return M<ne>(key(), v(next(3)));
+      case 3: return M<lt>(key(), v(next(3)));
+      case 4: return M<ge>(v(next(3)), key());
+      default: return M<eq>(key(), v(next(3)));
+      }
+    };
+    predicate_index index;
+    for (size_t id = 0; id < 300; ++id) {
+      node_list terms;
+      for (auto t = next(3) + 1; t; --t)
+        terms.push_back(M<and_junction>(leaf(), leaf(),
+            M<or_junction>(leaf(), M<not_junction>(leaf()))));
+      preds.push_back(M<or_junction>(std::move(terms)));
+      index.add(id, preds.back());
+    }
+    predicate_index::scratch s;
+    std::vector<size_t> matched;
+    size_t mismatches{};
+    size_t total{};
+    for (int event = 0; event < 200; ++event) {
+      map_lookup lk;
+      for (int k = 0; k < 4; ++k) {
+        const auto kind = next(4);
+        if (kind == 0) continue;
+        if (kind == 3)
+          lk.m["K"s + std::to_string(k)] = std::vector<any_single_value>{
+              int64_t{next(3)}, int64_t{next(3)}};
+        else
+          lk.m["K"s + std::to_string(k)] =
+              any_single_value{int64_t{next(3)}};
+      }
+      index.match(lk, matched, s);
+      std::vector<size_t> expected;
+      for (size_t id = 0; id < preds.size(); ++id)
+        if (preds[id]->eval(lk)) expected.push_back(id);
+      if (matched != expected) ++mismatches;
+      total += matched.size();
+    }
+    EXPECT_EQ(mismatches, 0u);
+    EXPECT_TRUE(total > 0);
+  }
+}
+
+void LangTest_Arena() {
+  using enum operation;
+  const auto heap_leaf = M<exists>("H"s);
+  EXPECT_EQ(heap_leaf.use_count(), 1);
+  if (true) {
+    node_arena arena;
+    EXPECT_TRUE(node_arena::current() == nullptr);
+    node_ptr root, converted;
+    if (true) {
+      node_arena::scope s{arena};
+      EXPECT_TRUE(node_arena::current() == &arena);
+      root = M<and_junction>(M<exists>("A"s),
+          M<or_junction>(M<exists>("B"s),
+              M<not_junction>(node_ptr{heap_leaf})));
+      converted = dnf::convert(root);
+    }
+    EXPECT_TRUE(node_arena::current() == nullptr);
+    EXPECT_TRUE(arena.owns(root));
+    EXPECT_TRUE(arena.owns(converted));
+    EXPECT_FALSE(arena.owns(heap_leaf));
+    EXPECT_TRUE(arena.size() >= 4u);
+
+    // Arena nodes aren't counted, but heap nodes they point to are.
+    EXPECT_EQ(root.use_count(), 0);
+    auto copy = root;
+    EXPECT_EQ(copy.use_count(), 0);
+    EXPECT_TRUE(heap_leaf.use_count() > 1);
+
+    EXPECT_EQ(root->print(),
+        "and:(exists:(A), or:(exists:(B), not:(exists:(H))))");
+    EXPECT_EQ(converted->print(), "or:(and:(exists:(A), exists:(B)), "
+                                  "and:(exists:(A), absent:(H)))");
+    map_lookup lk;
+    lk.m["A"] = any_single_value{"a"s};
+    EXPECT_TRUE(root->eval(lk));
+    EXPECT_TRUE(converted->eval(lk));
+
+    // Outside the scope, nodes come from the heap again.
+    const auto outside = M<exists>("A"s);
+    EXPECT_FALSE(arena.owns(outside));
+    EXPECT_EQ(outside.use_count(), 1);
+  }
+  EXPECT_EQ(heap_leaf.use_count(), 1);
+  if (true) {
+    // Scopes nest.
+    node_arena outer, inner;
+    node_arena::scope s1{outer};
+    if (true) {
+      node_arena::scope s2{inner};
+      EXPECT_TRUE(inner.owns(M<always_true>()));
+    }
+    EXPECT_TRUE(outer.owns(M<always_true>()));
+    EXPECT_EQ(inner.size(), 1u);
+    EXPECT_EQ(outer.size(), 1u);
+  }
+}
+
+void LangTest_Leaves() {
+  using enum operation;
+  const auto v = [](int64_t n) { return any_value{any_single_value{n}}; };
+  const auto t = [](std::string s) {
+    return any_value{any_single_value{std::move(s)}};
+  };
+  const auto list = [](std::vector<any_single_value> l) {
+    return any_value{std::move(l)};
+  };
+  map_lookup lk;
+  lk.m["N"] = any_single_value{int64_t{5}};
+  lk.m["S"] = any_single_value{"hello world"s};
+  lk.m["R"] = std::vector<any_single_value>{int64_t{9}, "abc"s, int64_t{1}};
+  lk.m["P"] = any_single_value{"w.r"s};
+  lk.m["Q"] = any_single_value{"(("s};
+  if (true) {
+    // Orderings need both sides present and of the same type.
+    EXPECT_TRUE(M<lt>("N"s, v(6))->eval(lk));
+    EXPECT_FALSE(M<lt>("N"s, v(5))->eval(lk));
+    EXPECT_TRUE(M<le>("N"s, v(5))->eval(lk));
+    EXPECT_TRUE(M<gt>(v(6), "N"s)->eval(lk));
+    EXPECT_TRUE(M<ge>("N"s, "N"s)->eval(lk));
+    EXPECT_FALSE(M<lt>("N"s, t("z"))->eval(lk));
+    EXPECT_FALSE(M<ge>("N"s, t("z"))->eval(lk));
+    EXPECT_FALSE(M<lt>("X"s, v(6))->eval(lk));
+    EXPECT_TRUE(M<lt>("S"s, t("help"))->eval(lk));
+    EXPECT_TRUE(M<gt>("S"s, t("hello"))->eval(lk));
+    // Repeated values compare if any of their elements do.
+    EXPECT_TRUE(M<lt>("R"s, v(2))->eval(lk));
+    EXPECT_TRUE(M<gt>("R"s, v(8))->eval(lk));
+    EXPECT_FALSE(M<gt>("R"s, v(9))->eval(lk));
+    EXPECT_TRUE(M<ge>("R"s, t("abc"))->eval(lk));
+    EXPECT_TRUE(M<lt>("N"s, list({int64_t{1}, int64_t{6}}))->eval(lk));
+  }
+  if (true) {
+    // Text search.
+    EXPECT_TRUE(M<contains>("S"s, t("o w"))->eval(lk));
+    EXPECT_FALSE(M<contains>("S"s, t("ow"))->eval(lk));
+    EXPECT_TRUE(M<contains>("S"s, list({"xyz"s, "orl"s}))->eval(lk));
+    EXPECT_FALSE(M<contains>("S"s, list({"xyz"s, int64_t{1}}))->eval(lk));
+    EXPECT_FALSE(M<contains>("N"s, t("5"))->eval(lk));
+    EXPECT_TRUE(M<contains>("R"s, t("b"))->eval(lk));
+    EXPECT_TRUE(M<starts_with>("S"s, t("hell"))->eval(lk));
+    EXPECT_FALSE(M<starts_with>("S"s, t("world"))->eval(lk));
+    EXPECT_TRUE(M<ends_with>("S"s, list({"x"s, "world"s}))->eval(lk));
+    EXPECT_FALSE(M<ends_with>("S"s, t("hello"))->eval(lk));
+    EXPECT_TRUE(M<contains>("S"s, "S"s)->eval(lk));
+    EXPECT_FALSE(M<contains>("S"s, "X"s)->eval(lk));
+    const auto literal = M<contains>("S"s, t("o"));
+    const auto dynamic = M<contains>("S"s, "P"s);
+    EXPECT_TRUE(static_cast<const contains_node&>(*literal).compiled());
+    EXPECT_FALSE(static_cast<const contains_node&>(*dynamic).compiled());
+    EXPECT_FALSE(M<contains>("S"s, v(5))->eval(lk));
+    // The locator is on the heap, so it doesn't bloat the node.
+    EXPECT_LT(sizeof(contains_node), 2 * sizeof(eq_node));
+    EXPECT_LE(sizeof(starts_with_node), sizeof(contains_node));
+  }
+  if (true) {
+    // Patterns.
+    EXPECT_TRUE(M<matches>("S"s, t("^h.*d$"))->eval(lk));
+    EXPECT_TRUE(M<matches>("S"s, t("o\\sw"))->eval(lk));
+    EXPECT_FALSE(M<matches>("S"s, t("^world"))->eval(lk));
+    EXPECT_TRUE(M<matches>("R"s, t("^a"))->eval(lk));
+    EXPECT_FALSE(M<matches>("N"s, t("5"))->eval(lk));
+    EXPECT_FALSE(M<matches>("S"s, v(5))->eval(lk));
+    EXPECT_TRUE(M<matches>("S"s, "P"s)->eval(lk));
+    EXPECT_FALSE(M<matches>("S"s, "Q"s)->eval(lk));
+    EXPECT_THROW(M<matches>("S"s, t("((")), std::regex_error);
+  }
+
+  const node_list roots{M<lt>("N"s, v(3)), M<le>(v(3), "N"s),
+      M<gt>("N"s, "M"s), M<ge>("S"s, t("b")), M<lt>("S"s, v(3)),
+      M<gt>("V"s, v(1)), M<le>("V"s, t("a")), M<lt>("N"s, list({int64_t{1}})),
+      M<contains>("S"s, t("b")), M<contains>("S"s, list({"ab"s, "ca"s})),
+      M<starts_with>("S"s, t("a")), M<ends_with>("V"s, t("b")),
+      M<contains>("S"s, "T"s), M<matches>("S"s, t("^a+b")),
+      M<matches>("V"s, t("b")), M<matches>("S"s, "T"s),
+      M<and_junction>(M<gt>("N"s, v(1)),
+          M<or_junction>(M<contains>("S"s, t("c")), M<le>("M"s, v(2))))};
+
+  // The program and batch evaluators agree with the tree.
+  constexpr size_t rows = 120;
+  record_batch batch{rows};
+  std::vector<map_lookup> lookups(rows);
+  std::vector<int64_t> ns, ms;
+  std::vector<std::string> ss, ts;
+  std::vector<any_value> vs;
+  const std::string words[] = {"ab", "abc", "ca", "aab", "b", "", "cab"};
+  for (size_t i = 0; i < rows; ++i) {
+    ns.push_back(static_cast<int64_t>(i % 7));
+    ms.push_back(static_cast<int64_t>(i % 4));
+    ss.push_back(words[i % 7]);
+    ts.push_back(i % 5 ? words[i % 3] : "(("s);
+    if (i % 3 == 0)
+      vs.emplace_back();
+    else if (i % 3 == 1)
+      vs.emplace_back(any_single_value{words[i % 4]});
+    else
+      vs.emplace_back(std::vector<any_single_value>{int64_t{2}, words[i % 5]});
+    lookups[i].m["N"] = any_single_value{ns.back()};
+    lookups[i].m["M"] = any_single_value{ms.back()};
+    lookups[i].m["S"] = any_single_value{ss.back()};
+    lookups[i].m["T"] = any_single_value{ts.back()};
+    if (i % 3) lookups[i].m["V"] = vs.back();
+  }
+  batch.add("N", ns);
+  batch.add("M", ms);
+  batch.add("S", ss);
+  batch.add("T", ts);
+  batch.add("V", vs);
+
+  if (true) {
+    predicate_index index;
+    for (size_t id = 0; id < roots.size(); ++id) index.add(id, roots[id]);
+    size_t mismatches{};
+    for (const auto& root : roots) {
+      const program prog{root};
+      const auto selected = eval_batch(root, batch);
+      for (size_t i = 0; i < rows; ++i) {
+        const auto expected = root->eval(lookups[i]);
+        if (prog.eval(lookups[i]) != expected) ++mismatches;
+        if (selected.test(i) != expected) ++mismatches;
+      }
+    }
+    for (size_t i = 0; i < rows; ++i) {
+      std::vector<size_t> expected;
+      for (size_t id = 0; id < roots.size(); ++id)
+        if (roots[id]->eval(lookups[i])) expected.push_back(id);
+      if (index.match(lookups[i]) != expected) ++mismatches;
+    }
+    EXPECT_EQ(mismatches, 0u);
+  }
+}
+
+void LangTest_Image() {
+  using enum operation;
+  const auto v = [](int64_t n) { return any_value{any_single_value{n}}; };
+  const auto t = [](std::string s) {
+    return any_value{any_single_value{std::move(s)}};
+  };
+  const auto list = [](std::vector<any_single_value> l) {
+    return any_value{std::move(l)};
+  };
+  const auto image_of = [](const std::string& bytes) {
+    return program_image{std::as_bytes(std::span{bytes})};
+  };
+  std::vector<map_lookup> lookups(5);
+  lookups[1].m["A"] = any_single_value{"abc"s};
+  lookups[1].m["N"] = any_single_value{int64_t{5}};
+  lookups[2].m["A"] = std::vector<any_single_value>{"b"s, int64_t{7}};
+  lookups[2].m["B"] = any_single_value{"^b"s};
+  lookups[3].m["A"] = any_single_value{};
+  lookups[3].m["B"] = any_single_value{"(("s};
+  lookups[3].m["N"] = any_single_value{int64_t{-3}};
+  lookups[4].m["A"] = any_single_value{"xbcx"s};
+  lookups[4].m["B"] = any_single_value{"xbcx"s};
+  lookups[4].m["N"] = std::vector<any_single_value>{int64_t{1}, "x"s};
+
+  const node_list roots{M<always_true>(), M<always_false>(),
+      M<exists>("A"s), M<absent>("A"s), M<eq>("A"s, t("abc")),
+      M<eq>("A"s, "B"s), M<ne>("N"s, v(5)), M<eq>("A"s, list({"b"s, 7})),
+      M<eq>("A"s, t("b")), M<eq>("A"s, any_value{}),
+      M<eq>("A"s, any_value{any_single_value{}}), M<lt>("N"s, v(0)),
+      M<ge>("A"s, t("abc")), M<le>("N"s, list({int64_t{1}, "x"s})),
+      M<contains>("A"s, t("bc")), M<contains>("A"s, list({"q"s, "x"s})),
+      M<starts_with>("A"s, "B"s), M<ends_with>("A"s, t("cx")),
+      M<matches>("A"s, t("^a.c$")), M<matches>("A"s, "B"s),
+      M<matches>("A"s, v(1)),
+      M<and_junction>(M<exists>("N"s),
+          M<or_junction>(M<contains>("A"s, t("b")),
+              M<not_junction>(M<gt>("N"s, v(2))))),
+      M<not_junction>(M<or_junction>(M<absent>("B"s), M<eq>("A"s, "B"s)))};
+
+  if (true) {
+    // Images agree with the tree, with or without DNF.
+    size_t mismatches{};
+    for (const auto& root : roots) {
+      const auto bytes = program_image::serialize(program{root});
+      const auto dnf_bytes =
+          program_image::serialize(program{dnf::convert(root)});
+      const auto image = image_of(bytes);
+      const auto dnf_image = image_of(dnf_bytes);
+      for (const auto& lk : lookups) {
+        const auto expected = root->eval(lk);
+        if (image.eval(lk) != expected) ++mismatches;
+        if (dnf_image.eval(lk) != expected) ++mismatches;
+        std::vector<const any_value*> fields;
+        for (size_t slot = 0; slot < image.key_count(); ++slot) {
+          const auto it = lk.m.find(std::string{image.key(slot)});
+          fields.push_back(it == lk.m.end() ? nullptr : &it->second);
+        }
+        if (image.eval(fields) != expected) ++mismatches;
+      }
+    }
+    EXPECT_EQ(mismatches, 0u);
+  }
+  if (true) {
+    // Images can be concatenated, and bound to a key table.
+    std::string bundle;
+    for (const auto& root : roots)
+      bundle += program_image::serialize(program{dnf::convert(root)});
+    auto keys = key_table::make();
+    std::vector<program_image> images;
+    for (auto rest = std::as_bytes(std::span{bundle}); !rest.empty();) {
+      auto& image = images.emplace_back(rest);
+      EXPECT_TRUE(image.bind(*keys));
+      rest = rest.subspan(image.bytes().size());
+    }
+    EXPECT_EQ(images.size(), roots.size());
+    field_lookup event{keys};
+    EXPECT_TRUE(event.set("A", any_single_value{"abc"s}));
+    EXPECT_TRUE(event.set("N", any_single_value{int64_t{5}}));
+    size_t mismatches{};
+    for (size_t i = 0; i < roots.size(); ++i)
+      if (images[i].eval(event) != roots[i]->eval(lookups[1])) ++mismatches;
+    EXPECT_EQ(mismatches, 0u);
+  }
+  if (true) {
+    // The header, and every offset and index, is checked.
+    const auto bytes = program_image::serialize(program{roots[4]});
+    const auto image = image_of(bytes);
+    EXPECT_EQ(image.bytes().size(), bytes.size());
+    EXPECT_EQ(image.bytes().size() % 8, 0u);
+    EXPECT_EQ(image.code_size(), 1u);
+    EXPECT_EQ(image.key_count(), 1u);
+    EXPECT_EQ(image.key(0), "A");
+    EXPECT_THROW((void)image_of(bytes.substr(0, 16)), std::invalid_argument);
+    EXPECT_THROW((void)image_of(bytes.substr(0, bytes.size() - 8)),
+        std::invalid_argument);
+    auto bad = bytes;
+    bad[0] = 'X';
+    EXPECT_THROW((void)image_of(bad), std::invalid_argument);
+
+    using image_t = program_image;
+    const auto poke = [](std::string image, size_t offset, uint32_t value) {
+      std::memcpy(image.data() + offset, &value, sizeof(value));
+      return image;
+    };
+    constexpr auto code = sizeof(image_t::image_header);
+    constexpr auto lhs = code + offsetof(image_t::image_instruction, lhs);
+    constexpr auto rhs = code + offsetof(image_t::image_instruction, rhs);
+    constexpr auto key = code + sizeof(image_t::image_instruction);
+    EXPECT_THROW((void)image_of(poke(bytes, lhs, 1)), std::invalid_argument);
+    EXPECT_THROW((void)image_of(poke(bytes, rhs, 1)), std::invalid_argument);
+    EXPECT_THROW((void)image_of(poke(bytes, code, 99)),
+        std::invalid_argument);
+    EXPECT_THROW(
+        (void)image_of(poke(bytes,
+            key + offsetof(image_t::image_single, size), 99)),
+        std::invalid_argument);
+
+    // A jump past the end, and a pattern out of order.
+    const auto jumps = program_image::serialize(program{roots[21]});
+    EXPECT_THROW((void)image_of(poke(jumps,
+                     code + sizeof(image_t::image_instruction) +
+                         offsetof(image_t::image_instruction, lhs),
+                     99)),
+        std::invalid_argument);
+    const auto pattern = program_image::serialize(program{roots[18]});
+    EXPECT_EQ(image_of(pattern).eval(lookups[1]), true);
+    EXPECT_THROW((void)image_of(poke(pattern,
+                     code + offsetof(image_t::image_instruction, regex), 1)),
+        std::invalid_argument);
+  }
+}
+
+void LangTest_Probes() {
+  using enum operation;
+  auto& p = corvid::library_probes();
+  p.reset();
+  map_lookup lk;
+  lk.m["A"] = any_single_value{"a"s};
+  const auto root = dnf::convert(M<and_junction>(M<exists>("A"s),
+      M<or_junction>(M<exists>("B"s), M<absent>("C"s))));
+  EXPECT_EQ(p.dnf_convert.snapshot().count, 1u);
+  const program prog{root};
+  EXPECT_TRUE(prog.eval(lk));
+  const std::vector<const any_value*> fields(prog.keys().size());
+  EXPECT_FALSE(prog.eval(fields));
+  EXPECT_EQ(p.ast_pred_eval.snapshot().count, 2u);
+}
+
+MAKE_TEST_LIST(LangTest_AstPred, LangTest_Eval, LangTest_Program,
+    LangTest_Batch, LangTest_Fields, LangTest_DnfBounds, LangTest_Index,
+    LangTest_Arena, LangTest_Leaves, LangTest_Image, LangTest_Probes);
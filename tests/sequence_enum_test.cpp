@@ -624,11 +624,83 @@ void SequentialEnumTest_ExtractEnum() {
   }
 }
 
+enum class greek {
+  alpha,
+  beta,
+  gamma,
+  delta,
+  epsilon,
+  zeta,
+  eta,
+  theta,
+  iota,
+  kappa,
+  lambda,
+  mu,
+  nu,
+  xi,
+  omicron,
+  pi,
+  rho,
+  sigma,
+  tau,
+  upsilon,
+  phi,
+  chi,
+  psi,
+  omega,
+  unnamed,
+  repeat
+};
+
+template<>
+constexpr auto registry::enum_spec_v<greek> =
+    make_sequence_enum_spec<greek,
+        "alpha, beta, gamma, delta, epsilon, zeta, eta, theta, iota, kappa, "
+        "lambda, mu, nu, xi, omicron, pi, rho, sigma, tau, upsilon, phi, chi, "
+        "psi, omega, ?, alpha">();
+
+void SequentialEnumTest_NameIndex() {
+  using namespace corvid::strings;
+  if (true) {
+    // Every name round-trips.
+    for (auto e = greek::alpha; e != greek::unnamed; ++e) {
+      const auto name = strings::enum_as_string(e);
+      std::string_view sv = name;
+      greek parsed{};
+      EXPECT_TRUE(extract_enum(parsed, sv));
+      EXPECT_EQ(parsed, e);
+    }
+  }
+  if (true) {
+    // A repeated name finds the first, and an unnamed value is only numeric.
+    EXPECT_TRUE(parse_enum<greek>("alpha") == greek::alpha);
+    EXPECT_EQ(strings::enum_as_string(greek::unnamed), "24");
+    EXPECT_TRUE(parse_enum<greek>("24") == greek::unnamed);
+    EXPECT_FALSE(parse_enum<greek>("?").has_value());
+    EXPECT_FALSE(parse_enum<greek>("alph").has_value());
+    EXPECT_FALSE(parse_enum<greek>("alphaa").has_value());
+    EXPECT_FALSE(parse_enum<greek>("Omega").has_value());
+  }
+  if (true) {
+    // The index is built at compile time.
+    constexpr std::array<std::string_view, 4> names{"a", "", "b", "a"};
+    constexpr registry::details::name_index<4> index{names};
+    static_assert(index.find(names, "a") == 0);
+    static_assert(index.find(names, "b") == 2);
+    static_assert(index.find(names, "") == index.npos);
+    static_assert(index.find(names, "c") == index.npos);
+    constexpr std::array<std::string_view, 0> none{};
+    constexpr registry::details::name_index<0> empty{none};
+    EXPECT_EQ(empty.find(none, "a"), empty.npos);
+  }
+}
+
 MAKE_TEST_LIST(SequentialEnumTest_Registry, SequentialEnumTest_Ops,
     SequentialEnumTest_MakeSafely, SequentialEnumTest_SafeOps,
     SequentialEnumTest_SubtleBugRepro, SequentialEnumTest_StreamingOut,
     SequentialEnumTest_Missing, SequentialEnumTest_Intervals,
-    SequentialEnumTest_ExtractEnum);
+    SequentialEnumTest_ExtractEnum, SequentialEnumTest_NameIndex);
 
 // TODO: Check if enum_as_string works with unscoped enums. Should it? Or
 // should it just count as an int?
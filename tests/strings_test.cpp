@@ -182,6 +182,182 @@ void StringUtilsTest_SplitPg() {
   }
 }
 
+void StringUtilsTest_SplitView() {
+  using V = std::vector<std::string_view>;
+  auto collect = [](const auto& view) {
+    V parts;
+    for (auto part : view) parts.push_back(part);
+    return parts;
+  };
+  if (true) {
+    // Same pieces as `split`.
+    static_assert(std::ranges::forward_range<strings::split_view<>>);
+    static_assert(std::ranges::view<strings::split_view<>>);
+    bool same = true;
+    for (auto s : {""sv, "1"sv, "1,"sv, ",1"sv, ",,"sv, "1,2;3"sv,
+             "11,22,33"sv})
+      same = same && collect(strings::split_view{s, ",;"}) ==
+                         strings::split(s, ",;");
+    EXPECT_TRUE(same);
+    EXPECT_EQ(collect(strings::split_view{"a b"sv, strings::delim{}}),
+        (V{"a", "b"}));
+  }
+  if (true) {
+    // Iterators are multi-pass.
+    const strings::split_view view{"ab\ncd\nef"sv, "\n"};
+    auto it = view.begin();
+    auto copy = it;
+    EXPECT_EQ(*it++, "ab");
+    EXPECT_EQ(it->size(), 2u);
+    EXPECT_EQ(*copy, "ab");
+    EXPECT_TRUE(++copy == it);
+    EXPECT_EQ(std::ranges::distance(view), 3);
+    EXPECT_FALSE(view.empty());
+    EXPECT_TRUE(strings::split_view(""sv, "\n").empty());
+  }
+  if (true) {
+    // Custom finder and filter, as with `piece_generator`.
+    auto finder = [](std::string_view s) {
+      auto pos = s.find(", ");
+      return std::pair{pos, pos + 2};
+    };
+    auto skip_empty = [](std::string_view s) {
+      return s.empty() ? opt_string_view{} : opt_string_view{s};
+    };
+    const strings::split_view view{"a, , b, c"_osv, finder, skip_empty};
+    EXPECT_EQ(collect(view), (V{"a", "b", "c"}));
+    EXPECT_EQ(collect(strings::split_view{""_osv, finder}), (V{""}));
+    EXPECT_EQ(collect(strings::split_view{0_osv, finder}), (V{}));
+    size_t total{};
+    for (auto size : view | std::views::transform(&std::string_view::size))
+      total += size;
+    EXPECT_EQ(total, 3u);
+  }
+}
+
+void StringUtilsTest_SplitFields() {
+  using V = std::vector<std::string_view>;
+  auto fields = [](std::string_view s, const strings::field_format& format) {
+    V parts;
+    strings::field_splitter splitter{s, format};
+    for (std::string_view part; splitter.more_pieces(part);)
+      parts.push_back(part);
+    return parts;
+  };
+  if (true) {
+    // Plain fields are views into the whole.
+    static_assert(strings::PieceGenerator<strings::field_splitter>);
+    constexpr auto s = "a,bc,,d"sv;
+    strings::field_splitter splitter{s};
+    std::string_view part;
+    size_t views{};
+    std::vector<std::string> parts;
+    while (splitter.more_pieces(part)) {
+      views += part.data() >= s.data() && part.data() <= s.data() + s.size();
+      parts.emplace_back(part);
+    }
+    EXPECT_EQ(parts, (std::vector<std::string>{"a", "bc", "", "d"}));
+    EXPECT_EQ(views, 4u);
+    EXPECT_TRUE(splitter.done());
+  }
+  if (true) {
+    // Empty fields at the edges.
+    EXPECT_EQ(strings::split(strings::field_splitter{""}), (V{}));
+    EXPECT_EQ(strings::split(strings::field_splitter{","}), (V{"", ""}));
+    EXPECT_EQ(strings::split(strings::field_splitter{"a,"}), (V{"a", ""}));
+    EXPECT_EQ(strings::split(strings::field_splitter{"\"\""}), (V{""}));
+  }
+  if (true) {
+    // Quotes, which may hold delimiters, newlines, and doubled quotes.
+    std::string scratch;
+    auto s = R"(x,"a,b","say ""hi""","line
+two",y)"sv;
+    auto parts = strings::split(
+        strings::field_splitter{s, strings::csv_format, &scratch});
+    EXPECT_EQ(parts, (V{"x", "a,b", "say \"hi\"", "line\ntwo", "y"}));
+    // Only the field with doubled quotes was unescaped.
+    EXPECT_TRUE(parts[1].data() == s.data() + 3);
+    EXPECT_TRUE(parts[2].data() == scratch.data());
+    EXPECT_FALSE(parts[3].data() == scratch.data());
+    // Lenient about trailing text and unclosed quotes.
+    EXPECT_EQ(strings::split(strings::field_splitter{R"("ab"c,d)", {},
+                  &scratch}),
+        (V{"abc", "d"}));
+    EXPECT_EQ(strings::split(strings::field_splitter{R"(a,"b,c)", {},
+                  &scratch}),
+        (V{"a", "b,c"}));
+    // Quotes only count at the start of a field.
+    EXPECT_EQ(strings::split(strings::field_splitter{R"(a"b,c)"}),
+        (V{"a\"b", "c"}));
+  }
+  if (true) {
+    // Records.
+    strings::field_splitter splitter{"a,b\r\nc,\"d\r\"\nlast\n"};
+    // Mark each field with whether it ended a record.
+    std::string marked;
+    for (std::string_view part; splitter.more_pieces(part);)
+      marked.append(part).append(splitter.at_record_end() ? "|" : ",");
+    EXPECT_EQ(marked, "a,b|c,d\r|last|");
+    // Without records, a newline is ordinary.
+    EXPECT_EQ(fields("a\nb,c", {',', '"', '\0', false}),
+        (V{"a\nb", "c"}));
+  }
+  if (true) {
+    // Backslash escapes, as in TSV.
+    std::string scratch;
+    auto s = "a\\tb\tc\\\\\td\\\te"sv;
+    EXPECT_EQ(strings::split(
+                  strings::field_splitter{s, strings::tsv_format, &scratch}),
+        (V{"atb", "c\\", "d\te"}));
+    strings::field_format quoted_escapes{',', '"', '\\'};
+    EXPECT_EQ(strings::split(strings::field_splitter{R"("a\"b",c\,d)",
+                  quoted_escapes, &scratch}),
+        (V{"a\"b", "c,d"}));
+  }
+}
+
+void StringUtilsTest_Hash() {
+  using strings::fast_hash;
+  using strings::hashed_string_view;
+  if (true) {
+    // The same at compile time and runtime, across every code path.
+    constexpr std::string_view digits =
+        "0123456789012345678901234567890123456789012345678901234567890123456"
+        "7890123456789012345678901234567890";
+    constexpr auto at_compile_time = [&] {
+      std::array<uint64_t, 101> hashes{};
+      for (size_t n = 0; n <= 100; ++n)
+        hashes[n] = fast_hash(digits.substr(0, n));
+      return hashes;
+    }();
+    std::set<uint64_t> seen;
+    for (size_t n = 0; n <= 100; ++n) {
+      EXPECT_EQ(fast_hash(digits.substr(0, n)), at_compile_time[n]);
+      seen.insert(at_compile_time[n]);
+    }
+    EXPECT_EQ(seen.size(), 101u);
+    EXPECT_NE(fast_hash("abc"), fast_hash("abc", 1));
+    EXPECT_NE(fast_hash("abc"), fast_hash("abd"));
+    // Unaligned, so it can't depend on alignment.
+    const std::string s = "x" + std::string{digits.substr(0, 100)};
+    EXPECT_EQ(fast_hash(std::string_view{s}.substr(1)), at_compile_time[100]);
+  }
+  if (true) {
+    constexpr hashed_string_view a{"alpha"}, b{"beta"};
+    static_assert(a.hash() == fast_hash("alpha"));
+    static_assert(a != b && a < b);
+    static_assert(hashed_string_view{} == hashed_string_view{""});
+    const std::string alpha = "alpha";
+    const hashed_string_view c{alpha};
+    EXPECT_TRUE(c == a);
+    EXPECT_EQ(c.view(), "alpha");
+    EXPECT_EQ(c.size(), 5u);
+    EXPECT_EQ(std::hash<hashed_string_view>{}(c), a.hash());
+    EXPECT_EQ(strings::hashed_v<"alpha">.hash(), a.hash());
+    EXPECT_EQ(hashed_string_view{"alpha"_csv}.hash(), a.hash());
+  }
+}
+
 void StringUtilsTest_Case() {
   auto s = "abcdefghij"s;
   strings::to_upper(s);
@@ -193,6 +369,56 @@ void StringUtilsTest_Case() {
   char a[] = "abcdefghij";
   strings::to_upper(a);
   EXPECT_EQ(a, "ABCDEFGHIJ"sv);
+  if (true) {
+    // Every byte, in every position of a word, matches the scalar version.
+    std::string all(256, '\0');
+    for (size_t i = 0; i < all.size(); ++i) all[i] = static_cast<char>(i);
+    bool same = true;
+    for (size_t ofs = 0; ofs < 8; ++ofs) {
+      const auto sv = std::string_view{all}.substr(ofs);
+      const auto upper = strings::as_upper(sv);
+      const auto lower = strings::as_lower(sv);
+      for (size_t i = 0; i < sv.size(); ++i)
+        same = same && upper[i] == strings::to_upper(sv[i]) &&
+               lower[i] == strings::to_lower(sv[i]);
+    }
+    EXPECT_TRUE(same);
+    EXPECT_EQ(strings::as_lower("Caf\xc3\x89 AU LAIT"), "caf\xc3\x89 au lait");
+  }
+  if (true) {
+    // Case-insensitive comparison.
+    EXPECT_TRUE(strings::iequal("Content-Length", "content-LENGTH"));
+    EXPECT_FALSE(strings::iequal("Content-Length", "Content-Lengths"));
+    EXPECT_FALSE(strings::iequal("a[", "A{"));
+    EXPECT_TRUE(strings::iequal("", ""));
+    EXPECT_TRUE(strings::icompare("abc", "ABD") < 0);
+    EXPECT_TRUE(strings::icompare("ABCDEFGHIZ", "abcdefghia") > 0);
+    EXPECT_TRUE(strings::icompare("abc", "ABC") == 0);
+    EXPECT_TRUE(
+        strings::icompare("abc", "ABC") == std::weak_ordering::equivalent);
+    EXPECT_TRUE(strings::icompare("ab", "ABC") < 0);
+    EXPECT_TRUE(strings::icompare("b", "A") > 0);
+    EXPECT_TRUE(strings::icompare("_", "a") < 0);
+    EXPECT_EQ(strings::ihash("X-Forwarded-For"),
+        strings::ihash("x-forwarded-for"));
+    EXPECT_NE(strings::ihash("x-forwarded-for"),
+        strings::ihash("x-forwarded-fox"));
+    EXPECT_TRUE(strings::istarts_with("Accept-Encoding", "ACCEPT"));
+    EXPECT_FALSE(strings::istarts_with("Accept", "ACCEPT-"));
+  }
+  if (true) {
+    // Case-insensitive locate.
+    constexpr auto npos = std::string_view::npos;
+    EXPECT_EQ(strings::ilocate("Hello World", "WORLD"), 6u);
+    EXPECT_EQ(strings::ilocate("Hello World", "o"), 4u);
+    EXPECT_EQ(strings::ilocate("Hello World", "O", 5), 7u);
+    EXPECT_EQ(strings::ilocate("aAaAb", "AAB"), 2u);
+    EXPECT_EQ(strings::ilocate("Hello", "hellO!"), npos);
+    EXPECT_EQ(strings::ilocate("Hello", "x"), npos);
+    EXPECT_EQ(strings::ilocate("Hello", "", 2), 2u);
+    EXPECT_EQ(strings::ilocate("Hello", "lo", 4), npos);
+    EXPECT_EQ(strings::ilocate("a-b", "-B"), 1u);
+  }
 }
 
 template<typename T>
@@ -654,6 +880,75 @@ void StringUtilsTest_LocateEdges() {
   }
 }
 
+void StringUtilsTest_MultiLocator() {
+  using location = corvid::strings::location;
+  if (true) {
+    constexpr auto s = "abcdefghijabcdefghij"sv;
+    const strings::multi_locator ml{"a0c", "def", "g0i", "j", "jab"};
+    EXPECT_EQ(ml.size(), 5u);
+    EXPECT_EQ(ml[1], "def");
+    EXPECT_EQ(strings::locate(s, ml), (location{3u, 1u}));
+    EXPECT_EQ(strings::locate(s, ml, 4), (location{9u, 3u}));
+    EXPECT_EQ(strings::rlocate(s, ml), (location{19u, 3u}));
+    EXPECT_EQ(strings::rlocate(s, ml, 18), (location{13u, 1u}));
+    EXPECT_EQ(strings::count_located(s, ml), 4u);
+    EXPECT_EQ(strings::locate(s, ml, npos), nloc);
+
+    location loc{};
+    EXPECT_TRUE(strings::located(loc, s, ml));
+    EXPECT_EQ(strings::point_past(loc, ml), 6u);
+    EXPECT_TRUE(strings::located(loc, s, ml));
+    EXPECT_EQ(loc, (location{9u, 3u}));
+    loc.pos = s.size();
+    EXPECT_TRUE(strings::rlocated(loc, s, ml));
+    EXPECT_EQ(loc, (location{19u, 3u}));
+
+    const strings::multi_locator none{"uvw", "xyz"};
+    EXPECT_EQ(strings::locate(s, none), nloc);
+    EXPECT_EQ(strings::locate<npos_choice::size>(s, none),
+        (location{s.size(), 2}));
+    EXPECT_EQ(strings::rlocate<npos_choice::size>(s, none),
+        (location{s.size(), 2}));
+    EXPECT_EQ(strings::count_located(s, strings::multi_locator{}), 0u);
+  }
+  if (true) {
+    // Empty values match everywhere, but earlier values win.
+    constexpr auto s = "abcabc"sv;
+    const strings::multi_locator ml{"bc", "", "a"};
+    EXPECT_EQ(strings::locate(s, ml), (location{0u, 1u}));
+    EXPECT_EQ(strings::locate(s, ml, 1), (location{1u, 0u}));
+    EXPECT_EQ(strings::locate(s, ml, 6), (location{6u, 1u}));
+    EXPECT_EQ(strings::count_located(s, ml), 5u);
+    EXPECT_EQ(strings::rlocate(s, ml), (location{5u, 1u}));
+  }
+  if (true) {
+    // Same results as the span overloads.
+    const std::vector<std::string> values{"ab", "b", "abc", "ca", "cab",
+        "\xff\x01", "a", "bca"};
+    const auto views = strings::as_views(values);
+    const strings::multi_locator ml{values};
+    std::string s;
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < 500; ++i) {
+      seed = seed * 1103515245 + 12345;
+      const auto r = (seed >> 16) % 5;
+      s += r == 4 ? '\xff' : static_cast<char>('a' + r);
+      if (r == 4) s += '\x01';
+    }
+    const auto spans = std::span<const std::string_view>{views};
+    bool same = true;
+    for (size_t pos = 0; pos <= s.size() + 1; ++pos) {
+      same = same && strings::locate(s, ml, pos) ==
+                         strings::locate(s, spans, pos);
+      same = same && strings::rlocate(s, ml, pos) ==
+                         strings::rlocate(s, spans, pos);
+    }
+    EXPECT_TRUE(same);
+    EXPECT_EQ(strings::count_located(s, ml),
+        strings::count_located(s, spans));
+  }
+}
+
 void StringUtilsTest_Substitute() {
   if (true) {
     // substitute: ch, psz, s, sv.
@@ -813,6 +1108,96 @@ void StringUtilsTest_Substitute() {
   }
 }
 
+void StringUtilsTest_SubstituteLarge() {
+  // Reference implementation, substituting value by value.
+  auto reference = [](std::string_view s,
+                       std::span<const std::string_view> from,
+                       std::span<const std::string_view> to) {
+    std::string result;
+    for (size_t pos = 0; pos < s.size();) {
+      size_t i = 0;
+      while (i < from.size() && !s.substr(pos).starts_with(from[i])) ++i;
+      if (i < from.size()) {
+        result += to[i];
+        pos += from[i].size();
+      } else
+        result += s[pos++];
+    }
+    return result;
+  };
+  std::string big;
+  uint32_t seed = 54321;
+  using strings::locating::details::multi_locator_threshold;
+  while (big.size() < 3 * multi_locator_threshold) {
+    seed = seed * 1103515245 + 12345;
+    big += "abcd\r\n\t "[(seed >> 16) % 9];
+  }
+  const std::array<std::string_view, 4> from{"\r\n", "ab", "\t", "dd"};
+  const std::array<std::string_view, 4> grow{"\n", "<ab>", "    ", ""};
+  const std::array<std::string_view, 4> shrink{"\n", "a", "", "d"};
+  const std::array<std::string_view, 4> none{"", "", "", ""};
+  if (true) {
+    // Growing, shrinking, and precompiled.
+    auto s = big;
+    const auto expected = reference(big, from, grow);
+    EXPECT_EQ(strings::substitute(s, from, grow),
+        strings::count_located(big, from));
+    EXPECT_EQ(s, expected);
+    s = big;
+    (void)strings::substitute(s, from, shrink);
+    EXPECT_EQ(s, reference(big, from, shrink));
+    const strings::multi_locator ml{from};
+    s = big;
+    (void)strings::substitute(s, ml, grow);
+    EXPECT_EQ(s, expected);
+    s = big;
+    EXPECT_EQ(strings::excise(s, ml), strings::count_located(big, ml));
+    EXPECT_EQ(s, reference(big, from, none));
+    s = big;
+    (void)strings::excise(s, from);
+    EXPECT_EQ(s, reference(big, from, none));
+    s = big;
+    (void)strings::excise(s, {'\r', '\n'});
+    EXPECT_EQ(s.find_first_of("\r\n"), npos);
+    EXPECT_EQ(s.size(),
+        big.size() - strings::count_located(big, {'\r', '\n'}));
+  }
+  if (true) {
+    // Empty replacements don't skip the next char.
+    std::string s = "abcdef";
+    EXPECT_EQ(strings::substitute(s, {"c"sv, "d"sv}, {""sv, ""sv}), 2u);
+    EXPECT_EQ(s, "abef");
+    s = "abcdef";
+    EXPECT_EQ(strings::substitute(s, {"ab"sv}, {"x"sv}, 1), 0u);
+    EXPECT_EQ(strings::substitute(s, {"cd"sv}, {"xyz"sv}, 1), 1u);
+    EXPECT_EQ(s, "abxyzef");
+  }
+  if (true) {
+    // Streaming, in chunks of every size, matches the whole.
+    const auto expected = reference(big, from, grow);
+    const auto count = strings::count_located(big, from);
+    bool same = true;
+    for (size_t chunk : {1u, 2u, 3u, 7u, 64u, 5000u}) {
+      strings::stream_substituter sub{strings::multi_locator{from}, grow};
+      std::string out;
+      for (size_t pos = 0; pos < big.size(); pos += chunk)
+        (void)sub.substitute(out, std::string_view{big}.substr(pos, chunk));
+      same = same && sub.finish(out) == count && out == expected;
+    }
+    EXPECT_TRUE(same);
+
+    strings::stream_substituter sub{{"ab", "abc"}, {"1", "2"}};
+    std::ostringstream os;
+    // Holds back as many as could start the longest value.
+    EXPECT_EQ(sub.substitute(os, "xxa"), 0u);
+    EXPECT_EQ(os.str(), "x");
+    EXPECT_EQ(sub.substitute(os, "bcab"), 1u);
+    EXPECT_EQ(sub.finish(os), 2u);
+    EXPECT_EQ(os.str(), "xx1c1");
+    EXPECT_EQ(sub.count(), 0u);
+  }
+}
+
 void StringUtilsTest_Excise() {
   if (true) {
     // excise: ch, psz, s, sv.
@@ -938,6 +1323,45 @@ auto& test_append(T& target, std::string_view sv) {
               .append(4, sv[0]);
 }
 
+void StringUtilsTest_Delim() {
+  if (true) {
+    constexpr strings::delim ws{" \t\r\n"};
+    static_assert(ws.is_delim('\t'));
+    static_assert(!ws.is_delim('a'));
+    static_assert(ws.find_in("abc\tdef"sv) == 3);
+    static_assert(ws.find_not_in(" \tdef"sv) == 2);
+    static_assert(ws.find_last_not_in("abc \n"sv) == 2);
+    EXPECT_EQ(ws.find_in("abcdef"sv), npos);
+    EXPECT_EQ(ws.find_not_in(" \t\r\n"sv), npos);
+    EXPECT_EQ(ws.find_last_not_in(" \t\r\n"sv), npos);
+    EXPECT_EQ(ws.find_last_not_in(""sv), npos);
+
+    constexpr strings::delim high{"\xff\x80"};
+    EXPECT_TRUE(high.is_delim('\xff'));
+    EXPECT_FALSE(high.is_delim('\x7f'));
+    EXPECT_EQ(high.find_in("ab\x80"sv), 2u);
+  }
+  if (true) {
+    // Same results as the std functions.
+    const std::string_view chars{"ab ,;\t\xff"};
+    bool same = true;
+    for (auto d : {""sv, ","sv, ", "sv, ",;\t"sv, "\xff "sv}) {
+      const strings::delim dl{d};
+      std::string s;
+      uint32_t seed = 7;
+      for (size_t i = 0; i < 200; ++i) {
+        seed = seed * 1103515245 + 12345;
+        s += chars[(seed >> 16) % chars.size()];
+        const std::string_view sv{s};
+        same = same && dl.find_in(sv) == sv.find_first_of(d) &&
+               dl.find_not_in(sv) == sv.find_first_not_of(d) &&
+               dl.find_last_not_in(sv) == sv.find_last_not_of(d);
+      }
+    }
+    EXPECT_TRUE(same);
+  }
+}
+
 void StringUtilsTest_Target() {
   if (true) {
     std::ostringstream oss;
@@ -1073,6 +1497,128 @@ void StringUtilsTest_Trim() {
   }
 }
 
+void StringUtilsTest_SplitTrim() {
+  using vsv = std::vector<std::string_view>;
+  if (true) {
+    EXPECT_EQ(strings::split_and_trim("", ","), vsv{});
+    EXPECT_EQ(strings::split_and_trim(" ", ","), vsv{""});
+    EXPECT_EQ(strings::split_and_trim(",", ","), (vsv{"", ""}));
+    EXPECT_EQ(strings::split_and_trim(" 1, 2, 3  , 4 ", ","),
+        (vsv{"1", "2", "3", "4"}));
+    EXPECT_EQ(strings::split_and_trim("a b ,, c d\t", ",", " \t"),
+        (vsv{"a b", "", "c d"}));
+    EXPECT_EQ(strings::split_and_trim<std::string>(" x ;y ", ";"),
+        (std::vector<std::string>{"x", "y"}));
+
+    // Delimiters win when they're also whitespace.
+    EXPECT_EQ(strings::split_and_trim(" a  b ", " "),
+        (vsv{"", "a", "", "b", ""}));
+  }
+  if (true) {
+    // Compile-time evaluation uses the scalar path.
+    constexpr auto n = strings::split_and_trim(" 1, 2 ,3 ,  ", ",").size();
+    static_assert(n == 4);
+  }
+  if (true) {
+    // Matches trimming the result of `split`, across word boundaries.
+    const std::string_view alphabet = " ,x\tyz";
+    std::string s;
+    uint64_t seed = 12345;
+    for (size_t len = 0; len < 40; ++len) {
+      for (size_t trial = 0; trial < 20; ++trial) {
+        s.clear();
+        for (size_t i = 0; i < len; ++i) {
+          seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+          s += alphabet[(seed >> 33) % alphabet.size()];
+        }
+        auto expected = strings::split(s, ",");
+        strings::trim(expected, " \t");
+        EXPECT_EQ(strings::split_and_trim(s, ",", " \t"), expected);
+        auto expected_semi = strings::split(s, ",\t");
+        strings::trim(expected_semi);
+        EXPECT_EQ(strings::split_and_trim(s, ",\t"), expected_semi);
+      }
+    }
+  }
+  if (true) {
+    // Kernels agree with the scalar definition at every length and offset.
+    strings::delim ws{" \t"};
+    for (size_t len = 0; len < 24; ++len) {
+      for (size_t at = 0; at < len; ++at) {
+        std::string s(len, ' ');
+        s[at] = 'x';
+        EXPECT_EQ(ws.find_not_in(s), at);
+        EXPECT_EQ(ws.find_last_not_in(s), at);
+        EXPECT_EQ(strings::trim(s), "x");
+        std::string t(len, 'x');
+        t[at] = '\t';
+        EXPECT_EQ(ws.find_in(t), at);
+      }
+      const std::string blank(len, '\t');
+      EXPECT_EQ(ws.find_not_in(blank), npos);
+      EXPECT_EQ(ws.find_last_not_in(blank), npos);
+      EXPECT_EQ(ws.find_in(std::string(len, 'x')), npos);
+    }
+    // High-bit bytes don't match by borrowing from their neighbors.
+    strings::delim hi{"\x80\x01"};
+    EXPECT_EQ(hi.find_in("\x81\x00\x7f\xff\x02\x81\x00\x7f\x80"sv), 8U);
+    EXPECT_EQ(hi.find_not_in("\x80\x01\x80\x01\x80\x01\x80\x01\xff"), 8U);
+  }
+}
+
+void StringUtilsTest_Parallel() {
+  const strings::parallelism par{4, 16};
+  if (true) {
+    // Too small to partition, so handled sequentially.
+    EXPECT_EQ(strings::par_count_located("a,b,c", ','), 2U);
+    EXPECT_EQ(strings::par_count_located("", ','), 0U);
+    EXPECT_EQ(strings::par_split("a,b,,c", ","),
+        (std::vector<std::string_view>{"a", "b", "", "c"}));
+    EXPECT_EQ(strings::par_split("", ","), std::vector<std::string_view>{});
+  }
+  if (true) {
+    // Same results as the sequential versions, across chunk boundaries.
+    std::string s;
+    uint64_t seed = 54321;
+    const std::string_view alphabet = "aab,\n";
+    for (size_t len : {0U, 1U, 15U, 16U, 17U, 63U, 64U, 65U, 200U, 1000U}) {
+      s.clear();
+      for (size_t i = 0; i < len; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        s += alphabet[(seed >> 33) % alphabet.size()];
+      }
+      for (size_t pos : {0U, 1U, 20U}) {
+        EXPECT_EQ(strings::par_count_located(s, ',', pos, par),
+            strings::count_located(s, ',', pos));
+        EXPECT_EQ(strings::par_count_located(s, "aa"sv, pos, par),
+            strings::count_located(s, "aa"sv, pos));
+        EXPECT_EQ(strings::par_count_located(s, "a,b"sv, pos, par),
+            strings::count_located(s, "a,b"sv, pos));
+        const strings::multi_locator ml{"aaa", "b,", "\n"};
+        EXPECT_EQ(strings::par_count_located(s, ml, pos, par),
+            strings::count_located(s, ml, pos));
+
+        auto expected = pos;
+        auto actual = pos;
+        EXPECT_EQ(strings::par_located(actual, s, "b\n"sv, par),
+            strings::located(expected, s, "b\n"sv));
+        EXPECT_EQ(actual, expected);
+      }
+      EXPECT_EQ(strings::par_split(s, ",\n", par), strings::split(s, ",\n"));
+    }
+  }
+  if (true) {
+    // A value that overlaps itself across every boundary.
+    const std::string s(101, 'a');
+    EXPECT_EQ(strings::par_count_located(s, "aaa"sv, 0, par), 33U);
+    EXPECT_EQ(strings::par_count_located(s, "aaa"sv, 2, par), 33U);
+    size_t pos = 0;
+    EXPECT_FALSE(strings::par_located(pos, s, 'b', par));
+    EXPECT_EQ(pos, npos);
+    EXPECT_EQ(strings::par_delim_offsets(s, "a", par).size(), 101U);
+  }
+}
+
 void StringUtilsTest_ParseNum() {
   if (true) {
     std::string_view sv;
@@ -1199,6 +1745,95 @@ void StringUtilsTest_ParseNum() {
   }
 }
 
+void StringUtilsTest_ParseNums() {
+  if (true) {
+    // Integers, with surrounding spaces.
+    std::array<int64_t, 8> out{};
+    auto r = strings::parse_nums(std::span{out},
+        " 1, -22 ,333,  -9223372036854775808");
+    EXPECT_TRUE(!!r);
+    EXPECT_EQ(r.count, 4u);
+    EXPECT_EQ(out[0], 1);
+    EXPECT_EQ(out[1], -22);
+    EXPECT_EQ(out[2], 333);
+    EXPECT_EQ(out[3], std::numeric_limits<int64_t>::min());
+    EXPECT_EQ(strings::parse_nums(std::span{out}, "").count, 0u);
+    EXPECT_TRUE(!!strings::parse_nums(std::span{out}, "  "));
+  }
+  if (true) {
+    // Matches `parse_num`, including long runs of digits and overflow.
+    bool same = true;
+    auto check = [&same]<typename T>(T, std::string_view s) {
+      std::array<T, 1> out{};
+      const auto r = strings::parse_nums(std::span{out}, s);
+      const auto expected = strings::parse_num<T>(s);
+      same = same && (expected ? r && out[0] == *expected : !r);
+    };
+    for (auto s : {"0", "7", "12345678", "123456789", "1234567890123456",
+             "9223372036854775807", "9223372036854775808",
+             "-9223372036854775809", "18446744073709551615",
+             "18446744073709551616", "00000000000000000000042", "-", "x",
+             "1x", "-0"})
+    {
+      check(int64_t{}, s);
+      check(uint64_t{}, s);
+      check(int32_t{}, s);
+      check(uint8_t{}, s);
+    }
+    EXPECT_TRUE(same);
+  }
+  if (true) {
+    // Floats, fast and slow.
+    std::vector<double> out;
+    auto r = strings::parse_nums(out,
+        "0.25, -1.5e3, 1e+2, .5, 5., 123456789012345678901, 1e300, inf");
+    EXPECT_TRUE(!!r);
+    EXPECT_EQ(out, (std::vector<double>{0.25, -1500, 100, 0.5, 5,
+                       123456789012345678901.0, 1e300,
+                       std::numeric_limits<double>::infinity()}));
+    bool same = true;
+    for (auto s : {"0.1", "3.14159", "2.718281828459045", "1e22", "1e23",
+             "9007199254740993", "-0.000001", "4.9e-324",
+             "1.7976931348623157e308"})
+    {
+      std::array<double, 1> d{};
+      same = same && strings::parse_nums(std::span{d}, s) &&
+             d[0] == strings::parse_num<double>(s, 0.0);
+      std::array<float, 1> f{};
+      float expected{};
+      const auto res = std::from_chars(s, s + std::strlen(s), expected);
+      same = same && !!strings::parse_nums(std::span{f}, s) ==
+                         (res.ec == std::errc{});
+      same = same && (res.ec != std::errc{} || f[0] == expected);
+    }
+    EXPECT_TRUE(same);
+  }
+  if (true) {
+    // Errors and limits.
+    std::array<int, 2> out{};
+    auto r = strings::parse_nums(std::span{out}, "1,,2");
+    EXPECT_FALSE(!!r);
+    EXPECT_EQ(r.count, 1u);
+    EXPECT_EQ(r.error_pos, 2u);
+    r = strings::parse_nums(std::span{out}, "1, 2 3");
+    EXPECT_EQ(r.count, 2u);
+    EXPECT_EQ(r.error_pos, 5u);
+    r = strings::parse_nums(std::span{out}, "1,2,3");
+    EXPECT_EQ(r.count, 2u);
+    EXPECT_EQ(r.error_pos, 4u);
+    r = strings::parse_nums(std::span{out}, "1,");
+    EXPECT_EQ(r.count, 1u);
+    EXPECT_EQ(r.error_pos, 2u);
+    // Whitespace delimiter, with trailing space.
+    std::vector<int> v{9};
+    EXPECT_TRUE(!!strings::parse_nums(v, "1 2  3 ", " "));
+    EXPECT_EQ(v, (std::vector<int>{9, 1, 2, 3}));
+    v.clear();
+    EXPECT_TRUE(!!strings::parse_nums(v, "4\n5;6", "\n;"));
+    EXPECT_EQ(v, (std::vector<int>{4, 5, 6}));
+  }
+}
+
 void StringUtilsTest_AppendNum() {
   if (true) {
     EXPECT_EQ(strings::num_as_string(1), "1");
@@ -1225,6 +1860,62 @@ void StringUtilsTest_AppendNum() {
         (strings::num_as_string<std::chars_format::general>(double(65536.25))),
         "65536.25");
   }
+  if (true) {
+    // Base 10 matches `std::to_chars`, at every digit count and at the
+    // limits of each type.
+    auto to_chars = [](auto num) {
+      std::array<char, 32> b;
+      auto res = std::to_chars(b.data(), b.data() + b.size(), num);
+      return std::string(b.data(), res.ptr);
+    };
+    bool same = true;
+    auto check = [&](auto num) {
+      same = same && strings::num_as_string(num) == to_chars(num);
+    };
+    for (uint64_t p = 1;; p *= 10) {
+      check(p - 1);
+      check(p);
+      check(p + 1);
+      check(-static_cast<int64_t>(p / 2));
+      if (p > std::numeric_limits<uint64_t>::max() / 10) break;
+    }
+    auto limits = [&check]<typename T>(T) {
+      check(std::numeric_limits<T>::min());
+      check(std::numeric_limits<T>::max());
+    };
+    limits(char{});
+    limits(int8_t{});
+    limits(uint8_t{});
+    limits(int16_t{});
+    limits(uint16_t{});
+    limits(int32_t{});
+    limits(uint32_t{});
+    limits(int64_t{});
+    limits(uint64_t{});
+    EXPECT_TRUE(same);
+    EXPECT_EQ((strings::num_as_string<10, 5>(-42)), "  -42");
+    EXPECT_EQ((strings::num_as_string<10, 5, '0'>(42u)), "00042");
+    EXPECT_EQ((strings::num_as_string<10, 2>(-12345)), "-12345");
+    std::stringstream os;
+    strings::append_num<10, 6, '*'>(os, -7);
+    strings::append_num(os, 1234567890123ll);
+    EXPECT_EQ(os.str(), "****-71234567890123");
+  }
+  if (true) {
+    // In bulk.
+    const std::vector<int64_t> counters{0, -1, 42, 9223372036854775807};
+    std::string s = "x=";
+    strings::append_nums(s, counters, ", ");
+    EXPECT_EQ(s, "x=0, -1, 42, 9223372036854775807");
+    s.clear();
+    strings::append_nums(s, std::span{counters}.first(1), ",");
+    strings::append_nums(s, std::vector<int64_t>{}, ",");
+    strings::append_nums(s, std::array{1u, 2u}, ";");
+    EXPECT_EQ(s, "01;2");
+    std::stringstream os;
+    strings::append_nums(os, counters, " ");
+    EXPECT_EQ(os.str(), "0 -1 42 9223372036854775807");
+  }
 }
 
 void StringUtilsTest_Append() {
@@ -1640,6 +2331,55 @@ void StringUtilsTest_Streams() {
     strings::append_join(s, a, b);
     EXPECT_EQ(s.str(), "[[1, 2, 3], [4, 5, 6]]");
   }
+  if (true) {
+    // Chunked to a callback, in fixed-size pieces.
+    std::vector<std::string> chunks;
+    const std::map<std::string, std::vector<int>> m{{"a\"b", a}, {"c", b}};
+    size_t flushed{};
+    if (true) {
+      strings::chunked_ostream os{[&chunks](std::string_view chunk) {
+                                    chunks.emplace_back(chunk);
+                                    return true;
+                                  },
+          8};
+      strings::append_json(os, m);
+      EXPECT_TRUE(!!os);
+      flushed = os.flushed();
+    }
+    std::string all;
+    bool sized = true;
+    for (const auto& chunk : chunks) {
+      sized = sized && chunk.size() <= 8 && !chunk.empty();
+      all += chunk;
+    }
+    EXPECT_TRUE(sized);
+    EXPECT_EQ(all, strings::join_json(m));
+    EXPECT_LT(flushed, all.size());
+    EXPECT_GT(chunks.size(), 3u);
+  }
+  if (true) {
+    // Chunked to another stream, with big writes handed over directly.
+    std::stringstream out;
+    std::string big(100, 'x');
+    if (true) {
+      strings::chunked_ostream os{out, 16};
+      strings::append(os, "ab", big, 'c');
+      EXPECT_EQ(os.flushed(), 102u);
+      os.flush();
+      EXPECT_EQ(os.flushed(), 103u);
+      EXPECT_EQ(out.str(), "ab" + big + "c");
+      strings::append(os, "de");
+    }
+    EXPECT_EQ(out.str(), "ab" + big + "cde");
+  }
+  if (true) {
+    // A failed flush makes the stream go bad.
+    strings::chunked_ostream os{[](std::string_view) { return false; }, 4};
+    strings::append(os, "abc");
+    EXPECT_TRUE(!!os);
+    strings::append(os, "defg");
+    EXPECT_FALSE(!!os);
+  }
 }
 
 enum class rgb {
@@ -1667,6 +2407,96 @@ void StringUtilsTest_AppendEnum() {
   EXPECT_EQ(s, "red + green, green + blue");
 }
 
+void StringUtilsTest_Format() {
+  if (true) {
+    EXPECT_EQ(strings::format<"">(), "");
+    EXPECT_EQ(strings::format<"plain">(), "plain");
+    EXPECT_EQ(strings::format<"{{}}{{{}}}">(1), "{}{1}");
+    EXPECT_EQ((strings::format<"user={} id={:08x}">("bob"sv, 0xbeefU)),
+        "user=bob id=0000beef");
+    EXPECT_EQ((strings::format<"{1}-{0}-{}">('a', "b")), "b-a-b");
+  }
+  if (true) {
+    // Numeric specs.
+    EXPECT_EQ(strings::format<"{:x}">(255), "ff");
+    EXPECT_EQ(strings::format<"{:x}">(-255), "-ff");
+    EXPECT_EQ(strings::format<"{:o}">(8), "10");
+    EXPECT_EQ(strings::format<"{:b}">(5U), "101");
+    EXPECT_EQ(strings::format<"{:5d}">(42), "   42");
+    EXPECT_EQ(strings::format<"{:05}">(42), "00042");
+    EXPECT_EQ(strings::format<"{:2}">(12345), "12345");
+    EXPECT_EQ(strings::format<"{:.3f}">(3.14159), "3.142");
+    EXPECT_EQ(strings::format<"{:8.2f}">(2.5), "    2.50");
+    EXPECT_EQ(strings::format<"{:e}">(1e10), "1e+10");
+    EXPECT_EQ(strings::format<"{:.2}">(0.125), "0.12");
+    EXPECT_EQ(strings::format<"{:6}">(1.5), "   1.5");
+  }
+  if (true) {
+    // Plain fields append whatever `append` does.
+    EXPECT_EQ((strings::format<"{} {} {}">(true, nullptr, rgb::yellow)),
+        "true null red + green");
+    EXPECT_EQ((strings::format<"[{}]">(std::vector<int>{1, 2, 3})), "[123]");
+    EXPECT_EQ((strings::format<"{}={}">(std::string{"k"}, 1.5)), "k=1.5");
+  }
+  if (true) {
+    // Appends to any target.
+    std::string s{"> "};
+    strings::append_format<"{}, {:04x}!">(s, "hi", 0xaU);
+    EXPECT_EQ(s, "> hi, 000a!");
+    std::string big;
+    strings::append_format<"abc {} {:010}">(big, "defgh"sv, 12);
+    EXPECT_EQ(big, "abc defgh 0000000012");
+    std::ostringstream os;
+    strings::append_format<"{}:{}">(os, 'x', 9);
+    EXPECT_EQ(os.str(), "x:9");
+  }
+}
+
+void StringUtilsTest_AppendedSize() {
+  using strings::join_opt;
+  if (true) {
+    // Exact for strings and characters, an upper bound for numbers.
+    EXPECT_EQ(strings::appended_size("abc", "de"sv, "f"s, 'g'), 7u);
+    EXPECT_EQ(strings::appended_size(nullptr, (const char*){}, true), 13u);
+    EXPECT_EQ(strings::appended_size(rgb::yellow), 11u);
+    EXPECT_GE(strings::appended_size(int64_t{-1}),
+        strings::concat(std::numeric_limits<int64_t>::min()).size());
+    EXPECT_GE(strings::appended_size(-1.0),
+        strings::concat(-std::numeric_limits<double>::denorm_min()).size());
+    static_assert(strings::appended_size("ab", 'c', std::pair{"d", 'e'}) == 5);
+  }
+  if (true) {
+    // Containers, recursively.
+    const std::map<std::string, std::vector<std::string>> m{{"a", {"bc"}},
+        {"de", {"f", "gh"}}};
+    std::optional<std::string> o{"xyz"};
+    std::variant<int, std::string> v{"vw"};
+    EXPECT_EQ(strings::appended_size(m, o, v), 13u);
+    EXPECT_EQ(strings::appended_size(std::optional<int>{}), 4u);
+    EXPECT_GE(strings::joined_size(", ", m, o, v),
+        strings::join<join_opt::json>(m, o, v).size());
+  }
+  if (true) {
+    // Reserving doesn't change the output.
+    const std::vector<std::string> words{"alpha", "beta", "gamma"};
+    auto s = strings::concat(words, '-', 42, words);
+    EXPECT_EQ(s, "alphabetagamma-42alphabetagamma");
+    EXPECT_GE(s.capacity(), strings::appended_size(words, '-', 42, words));
+    EXPECT_EQ(strings::join(words, 1.5), "[[alpha, beta, gamma], 1.5]");
+  }
+  if (true) {
+    // Into a fixed buffer, detecting overflow.
+    std::array<char, 8> buffer{};
+    auto r = strings::concat_into(buffer, "ab", 12, 'c');
+    EXPECT_TRUE(r.has_value());
+    EXPECT_EQ(*r, "ab12c");
+    EXPECT_TRUE(r->data() == buffer.data());
+    EXPECT_TRUE(strings::concat_into(buffer, "abcd", 1234).has_value());
+    EXPECT_FALSE(strings::concat_into(buffer, "abcd", 12345).has_value());
+    EXPECT_FALSE(strings::concat_into(std::span<char>{}, 'a').has_value());
+  }
+}
+
 // Enlisted Marine Corps ranks.
 enum class marine_rank {
   Civilian,
@@ -1885,6 +2715,35 @@ void StringUtilsTest_AppendJson() {
     strings::append_escaped(s, "a\tb\\c\"d\n\b\f\r\x1f");
     EXPECT_EQ(s, R"(a\tb\\c\"d\n\b\f\r\u001f)");
   }
+  if (true) {
+    // Long runs, escapes at every offset, and UTF-8 passed through.
+    const std::string safe = "0123456789abcdefghij\xc3\xa9";
+    EXPECT_FALSE(strings::needs_escaping(safe));
+    std::string s;
+    strings::append_escaped(s, safe);
+    EXPECT_EQ(s, safe);
+    bool same = true;
+    for (size_t i = 0; i < safe.size(); ++i)
+      for (std::string_view esc : {"\"", "\\", "/", "\n", "\x01"}) {
+        auto raw = safe;
+        raw.insert(i, esc);
+        s.clear();
+        strings::append_escaped(s, raw);
+        std::string expected;
+        for (const char c : raw) {
+          if (!strings::needs_escaping(c))
+            expected += c;
+          else if (c == '\n')
+            expected += "\\n";
+          else if (c == '\x01')
+            expected += "\\u0001";
+          else
+            expected.append(1, '\\').append(1, c);
+        }
+        same = same && strings::needs_escaping(raw) && s == expected;
+      }
+    EXPECT_TRUE(same);
+  }
   if (true) {
     std::string s;
     const char* p{};
@@ -1900,10 +2759,16 @@ void StringUtilsTest_AppendJson() {
 }
 
 MAKE_TEST_LIST(StringUtilsTest_ExtractPiece, StringUtilsTest_MorePieces,
-    StringUtilsTest_Split, StringUtilsTest_SplitPg, StringUtilsTest_ParseNum,
-    StringUtilsTest_Case, StringUtilsTest_Locate, StringUtilsTest_RLocate,
-    StringUtilsTest_LocateEdges, StringUtilsTest_Substitute,
-    StringUtilsTest_Excise, StringUtilsTest_Target, StringUtilsTest_Print,
-    StringUtilsTest_Trim, StringUtilsTest_AppendNum, StringUtilsTest_Append,
-    StringUtilsTest_Edges, StringUtilsTest_Streams, StringUtilsTest_AppendEnum,
-    StringUtilsTest_AppendStream, StringUtilsTest_AppendJson);
+    StringUtilsTest_Split, StringUtilsTest_SplitPg, StringUtilsTest_SplitView,
+    StringUtilsTest_SplitFields, StringUtilsTest_ParseNum,
+    StringUtilsTest_ParseNums, StringUtilsTest_Hash, StringUtilsTest_Case,
+    StringUtilsTest_Locate, StringUtilsTest_RLocate,
+    StringUtilsTest_LocateEdges, StringUtilsTest_MultiLocator,
+    StringUtilsTest_Substitute, StringUtilsTest_SubstituteLarge,
+    StringUtilsTest_Excise, StringUtilsTest_Delim, StringUtilsTest_Target,
+    StringUtilsTest_Print, StringUtilsTest_Trim, StringUtilsTest_SplitTrim,
+    StringUtilsTest_Parallel, StringUtilsTest_AppendNum,
+    StringUtilsTest_Append, StringUtilsTest_Edges, StringUtilsTest_Streams,
+    StringUtilsTest_AppendEnum, StringUtilsTest_Format,
+    StringUtilsTest_AppendedSize, StringUtilsTest_AppendStream,
+    StringUtilsTest_AppendJson);
@@ -15,7 +15,18 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#define CORVID_INSTRUMENTATION 1
 #include "../corvid/containers/timers.h"
+#include "../corvid/containers/sharded_timers.h"
 
 std::ostream&
 operator<<(std::ostream& os, const corvid::timers_ns::time_point_t& when) {
@@ -29,12 +40,33 @@ operator<<(std::ostream& os, const corvid::timers_ns::timer_id_t& id) {
   return os;
 }
 
+std::ostream& operator<<(std::ostream& os,
+    const std::vector<corvid::timers_ns::timer_id_t>& ids) {
+  for (auto id : ids) os << id << " ";
+  return os;
+}
+
 #include "AccutestShim.h"
 
+// Count heap allocations, to show that timers can be armed without them.
+std::atomic<size_t> allocation_count{};
+
+PRAGMA_GCC_IGNORED("-Wmismatched-new-delete")
+
+void* operator new(size_t size) {
+  ++allocation_count;
+  if (auto p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc{};
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
 using namespace std::literals;
 using namespace std::chrono;
 using namespace std::chrono_literals;
 using namespace corvid;
+using corvid::timers_ns::duration_t;
+using corvid::timers_ns::time_point_t;
 
 auto make_date(auto date) {
   return steady_clock::time_point{} + sys_days{date}.time_since_epoch();
@@ -119,4 +151,729 @@ void TimersTest_Edge() {
   EXPECT_EQ(ids.size(), 2u);
 }
 
-MAKE_TEST_LIST(TimersTest_General, TimersTest_Edge);
+void TimersTest_Wheel() {
+  if (true) {
+    wheel_timers t;
+    auto now = make_date(2024y / 1 / 1);
+    std::vector<timer_id_t> ids;
+    auto now_cb = [&now]() { return now; };
+    t.set_clock_callback(now_cb);
+    auto cb = [&ids](timer_event& event) { ids.push_back(event.timer_id); };
+
+    auto id1 = t.set(30s, cb).timer_id;
+    auto id2 = t.set(60s, cb).timer_id;
+    auto id3 = t.set(90s, cb).timer_id;
+    EXPECT_EQ(t.events().size(), 3u);
+    // The first tick catches the wheel up from its epoch.
+    EXPECT_EQ(t.tick(), 0u);
+    // Until it cascades down, the next event is reported as the start of its
+    // slot.
+    EXPECT_GT(t.next_at(), now);
+    EXPECT_LE(t.next_at(), now + 30s);
+    EXPECT_TRUE(t.cancel(id2));
+    EXPECT_FALSE(t.cancel(id2));
+    now += 29s;
+    EXPECT_EQ(t.tick(), 0u);
+    now += 1s;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(ids.size(), 1u);
+    EXPECT_EQ(ids[0], id1);
+    now += 30s;
+    EXPECT_EQ(t.tick(), 0u);
+    EXPECT_EQ(t.events().size(), 1u);
+    now += 30s;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(ids.size(), 2u);
+    EXPECT_EQ(ids[1], id3);
+    EXPECT_EQ(t.events().size(), 0u);
+    EXPECT_EQ(t.next_at(), time_point_t{});
+  }
+  if (true) {
+    // Never fires early, even with sub-tick times.
+    wheel_timers t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    size_t fired{};
+    t.set(now + 1500us, [&fired](timer_event&) { ++fired; });
+    EXPECT_EQ(t.tick(), 0u);
+    now += 1ms;
+    EXPECT_EQ(t.tick(), 0u);
+    now += 400us;
+    EXPECT_EQ(t.tick(), 0u);
+    now += 100us;
+    EXPECT_EQ(t.tick(), 0u);
+    now += 500us;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(fired, 1u);
+  }
+  if (true) {
+    // Repeating, across several levels of the wheel.
+    wheel_timers t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    size_t fired{};
+    t.set(1h, [&fired](timer_event&) { ++fired; }, 24h);
+    now += 59min;
+    EXPECT_EQ(t.tick(), 0u);
+    now += 1min;
+    EXPECT_EQ(t.tick(), 1u);
+    now += 23h + 59min + 59s;
+    EXPECT_EQ(t.tick(), 0u);
+    now += 1s;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(fired, 2u);
+    now += 3 * 24h;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_GT(t.next_at(), now);
+    EXPECT_LE(t.next_at(), now + 24h);
+    now += 24h - 1ms;
+    EXPECT_EQ(t.tick(), 0u);
+    EXPECT_EQ(t.next_at(), now + 1ms);
+  }
+  if (true) {
+    // Matches the heap, event for event, over a pseudo-random workload.
+    timers h;
+    wheel_timers w;
+    auto now = make_date(2024y / 1 / 1);
+    h.set_clock_callback([&now]() { return now; });
+    w.set_clock_callback([&now]() { return now; });
+    std::vector<timer_id_t> h_ids, w_ids;
+    auto h_cb = [&h_ids](timer_event& event) {
+      h_ids.push_back(event.timer_id);
+    };
+    auto w_cb = [&w_ids](timer_event& event) {
+      w_ids.push_back(event.timer_id);
+    };
+
+    uint64_t seed = 42;
+    auto next_rand = [&seed](uint64_t n) {
+      seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+      return (seed >> 33) % n;
+    };
+    for (size_t i = 0; i < 2000; ++i) {
+      const auto delay = duration_t{next_rand(100'000)};
+      const auto id = h.set(delay, h_cb).timer_id;
+      EXPECT_EQ(w.set(delay, w_cb).timer_id, id);
+      if (next_rand(4) == 0) {
+        EXPECT_TRUE(h.cancel(id));
+        EXPECT_TRUE(w.cancel(id));
+      }
+      if (next_rand(8) == 0) {
+        now += duration_t{next_rand(5000)};
+        EXPECT_EQ(w.tick(), h.tick());
+        EXPECT_EQ(w_ids.size(), h_ids.size());
+      }
+    }
+    while (!h.events().empty()) {
+      now += 1s;
+      EXPECT_EQ(w.tick(), h.tick());
+    }
+    EXPECT_EQ(w.events().size(), 0u);
+    EXPECT_EQ(w_ids.size(), h_ids.size());
+    std::ranges::sort(w_ids);
+    std::ranges::sort(h_ids);
+    EXPECT_EQ(w_ids, h_ids);
+  }
+}
+
+template<typename TIMERS>
+void CompactTest() {
+  TIMERS t;
+  auto now = make_date(2024y / 1 / 1);
+  t.set_clock_callback([&now]() { return now; });
+  size_t fired{};
+  auto cb = [&fired](timer_event&) { ++fired; };
+
+  std::vector<timer_id_t> ids;
+  for (size_t i = 0; i < 1000; ++i)
+    ids.push_back(t.set(duration_t{1000 + i}, cb).timer_id);
+  auto stats = t.stats();
+  EXPECT_EQ(stats.live_entries, 1000u);
+  EXPECT_EQ(stats.dead_entries, 0u);
+  EXPECT_EQ(stats.compactions, 0u);
+
+  // Cancel just under half, so no compaction.
+  for (size_t i = 0; i < 499; ++i) EXPECT_TRUE(t.cancel(ids[i]));
+  stats = t.stats();
+  EXPECT_EQ(stats.live_entries, 501u);
+  EXPECT_EQ(stats.dead_entries, 499u);
+  EXPECT_EQ(stats.compactions, 0u);
+
+  // Cross the halfway mark to trigger compaction.
+  for (size_t i = 499; i < 501; ++i) EXPECT_TRUE(t.cancel(ids[i]));
+  stats = t.stats();
+  EXPECT_EQ(stats.live_entries, 499u);
+  EXPECT_EQ(stats.dead_entries, 0u);
+  EXPECT_EQ(stats.compactions, 1u);
+
+  // Dead entries that come due are discarded by `tick`.
+  for (size_t i = 501; i < 551; ++i) EXPECT_TRUE(t.cancel(ids[i]));
+  EXPECT_EQ(t.stats().dead_entries, 50u);
+  now += 2s;
+  EXPECT_EQ(t.tick(), 449u);
+  EXPECT_EQ(fired, 449u);
+  stats = t.stats();
+  EXPECT_EQ(stats.live_entries, 0u);
+  EXPECT_EQ(stats.dead_entries, 0u);
+
+  // Explicit compaction.
+  auto id = t.set(1s, cb).timer_id;
+  t.set(2s, cb);
+  EXPECT_TRUE(t.cancel(id));
+  EXPECT_EQ(t.stats().dead_entries, 1u);
+  t.compact();
+  stats = t.stats();
+  EXPECT_EQ(stats.live_entries, 1u);
+  EXPECT_EQ(stats.dead_entries, 0u);
+  EXPECT_EQ(stats.compactions, 2u);
+  now += 2s;
+  EXPECT_EQ(t.tick(), 1u);
+
+  // A callback that cancels its own recurring event leaves nothing dead.
+  t.set(1s, [&t](timer_event& e) { EXPECT_TRUE(t.cancel(e.timer_id)); }, 1s);
+  now += 1s;
+  EXPECT_EQ(t.tick(), 1u);
+  stats = t.stats();
+  EXPECT_EQ(stats.live_entries, 0u);
+  EXPECT_EQ(stats.dead_entries, 0u);
+  EXPECT_TRUE(t.events().empty());
+  now += 1s;
+  EXPECT_EQ(t.tick(), 0u);
+}
+
+void TimersTest_Compact() {
+  CompactTest<timers>();
+  CompactTest<wheel_timers>();
+}
+
+template<typename TIMERS>
+void NoAllocTest() {
+  TIMERS t;
+  auto now = make_date(2024y / 1 / 1);
+  t.set_clock_callback([&now]() { return now; });
+  size_t fired{};
+  std::array<size_t, 4> payload{1, 2, 3, 4};
+  auto arm = [&] {
+    for (size_t i = 0; i < 100; ++i) {
+      auto& event = t.set(duration_t{1 + i % 10},
+          [&fired, payload](timer_event&) { fired += payload[0]; });
+      event.deleter = [&fired](timer_event&) { ++fired; };
+    }
+  };
+
+  // Warm up, so the free list and queue reach their peak size.
+  arm();
+  now += 1s;
+  EXPECT_EQ(t.tick(), 100u);
+  EXPECT_EQ(fired, 200u);
+
+  const auto before = allocation_count.load();
+  for (size_t round = 0; round < 10; ++round) {
+    arm();
+    now += 1s;
+    t.tick();
+  }
+  EXPECT_EQ(allocation_count.load(), before);
+  EXPECT_EQ(fired, 2200u);
+}
+
+void TimersTest_NoAlloc() {
+  NoAllocTest<timers>();
+  NoAllocTest<wheel_timers>();
+}
+
+template<typename T>
+void MoveTest() {
+  auto now = make_date(2024y / 1 / 1);
+  size_t fired{}, deleted{};
+  auto cb = [&fired](timer_event&) { ++fired; };
+  auto count_deleted = [&deleted](timer_event&) { ++deleted; };
+
+  T t;
+  t.set_clock_callback([&now]() { return now; });
+  for (size_t i = 0; i < 10; ++i)
+    t.set(duration_t{100 + i}, cb).deleter = count_deleted;
+
+  // Assigning over live events removes them first.
+  T u;
+  u.set_clock_callback([&now]() { return now; });
+  for (size_t i = 0; i < 5; ++i)
+    u.set(duration_t{100 + i}, cb).deleter = count_deleted;
+  u = std::move(t);
+  EXPECT_EQ(deleted, 5u);
+  EXPECT_EQ(u.events().size(), 10u);
+
+  // The moved events still fire, and new ones reuse the recycled nodes.
+  now += 1s;
+  EXPECT_EQ(u.tick(), 10u);
+  EXPECT_EQ(fired, 10u);
+  EXPECT_EQ(deleted, 15u);
+  for (size_t i = 0; i < 10; ++i) u.set(duration_t{100 + i}, cb);
+  now += 1s;
+  EXPECT_EQ(u.tick(), 10u);
+
+  T v{std::move(u)};
+  v.set(1s, cb);
+  now += 1s;
+  EXPECT_EQ(v.tick(), 1u);
+}
+
+void TimersTest_Move() {
+  MoveTest<timers>();
+  MoveTest<wheel_timers>();
+}
+
+// Heap whose `push` throws on demand, to test exception safety.
+struct throwing_heap: corvid::timers_ns::scheduled_heap {
+  inline static bool fail{};
+  void push(const corvid::timers_ns::scheduled_event& se) {
+    if (std::exchange(fail, false)) throw std::runtime_error("push");
+    scheduled_heap::push(se);
+  }
+};
+
+void TimersTest_Submit() {
+  if (true) {
+    timers t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    std::vector<timer_id_t> ids;
+    auto cb = [&ids](timer_event& event) { ids.push_back(event.timer_id); };
+
+    // Submissions aren't visible until the next tick.
+    auto id1 = t.submit_set(now + 10s, cb);
+    auto id2 = t.submit_set(20s, cb);
+    EXPECT_EQ(id1, timer_id_t{1});
+    EXPECT_EQ(id2, timer_id_t{2});
+    EXPECT_EQ(t.events().size(), 0u);
+    EXPECT_EQ(t.set(30s, cb).timer_id, timer_id_t{3});
+    EXPECT_EQ(t.tick(), 0u);
+    EXPECT_EQ(t.events().size(), 3u);
+    EXPECT_EQ(t.next_at(), now + 10s);
+
+    // Cancel applies in order with sets.
+    t.submit_cancel(id1);
+    auto id4 = t.submit_set(5s, cb);
+    t.submit_cancel(id4);
+    EXPECT_EQ(t.events().size(), 3u);
+    now += 30s;
+    EXPECT_EQ(t.tick(), 2u);
+    EXPECT_EQ(ids, (std::vector{id2, timer_id_t{3}}));
+  }
+  if (true) {
+    // If applying a submission throws, the rest are kept for the next tick.
+    corvid::timers_ns::basic_timers<throwing_heap> t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    size_t fired{};
+    auto cb = [&fired](timer_event&) { ++fired; };
+    t.submit_set(1s, cb);
+    auto id2 = t.submit_set(1s, cb);
+    t.submit_set(1s, cb);
+    t.submit_cancel(id2);
+    throwing_heap::fail = true;
+    EXPECT_THROW(t.tick(), std::runtime_error);
+    EXPECT_EQ(t.events().size(), 0u);
+    t.submit_set(1s, cb);
+    EXPECT_EQ(t.tick(), 0u);
+    EXPECT_EQ(t.events().size(), 2u);
+    now += 1s;
+    EXPECT_EQ(t.tick(), 2u);
+    EXPECT_EQ(fired, 2u);
+  }
+  if (true) {
+    // Many producers, one consumer.
+    constexpr size_t producers = 4;
+    constexpr size_t per_producer = 1000;
+    wheel_timers t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    std::vector<timer_id_t> ids;
+    auto cb = [&ids](timer_event& event) { ids.push_back(event.timer_id); };
+
+    std::vector<std::thread> threads;
+    std::array<std::vector<timer_id_t>, producers> submitted;
+    for (size_t p = 0; p < producers; ++p) {
+      threads.emplace_back([&, p] {
+        for (size_t i = 0; i < per_producer; ++i) {
+          auto id = t.submit_set(now + duration_t{i}, cb);
+          if (i % 2)
+            t.submit_cancel(id);
+          else
+            submitted[p].push_back(id);
+        }
+      });
+    }
+    // The owner keeps running alongside the producers.
+    for (size_t i = 0; i < 100; ++i) t.tick();
+    for (auto& thread : threads) thread.join();
+    now += 1h;
+    t.tick();
+    EXPECT_EQ(t.events().size(), 0u);
+
+    std::vector<timer_id_t> expected;
+    for (auto& v : submitted)
+      expected.insert(expected.end(), v.begin(), v.end());
+    std::ranges::sort(expected);
+    std::ranges::sort(ids);
+    EXPECT_EQ(ids.size(), producers * per_producer / 2);
+    EXPECT_EQ(ids, expected);
+    EXPECT_TRUE(std::ranges::adjacent_find(ids) == ids.end());
+  }
+}
+
+template<typename T>
+void BatchTest() {
+  if (true) {
+    T t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    std::vector<timer_id_t> ids;
+    auto cb = [&ids](timer_event& event) { ids.push_back(event.timer_id); };
+    size_t batches{};
+    auto fire = [&](std::span<timer_event* const> batch) {
+      ++batches;
+      for (auto event : batch) event->callback(*event);
+    };
+
+    // Nothing ready, so no batch.
+    EXPECT_EQ(t.tick_batch(fire), 0u);
+    EXPECT_EQ(batches, 0u);
+
+    // Same deadline, so one batch.
+    for (size_t i = 0; i < 5; ++i) t.set(10s, cb);
+    t.set(20s, cb);
+    now += 10s;
+    EXPECT_EQ(t.tick_batch(fire), 5u);
+    EXPECT_EQ(batches, 1u);
+    EXPECT_EQ(ids.size(), 5u);
+    EXPECT_EQ(t.events().size(), 1u);
+
+    // Limited.
+    for (size_t i = 0; i < 5; ++i) t.set(1s, cb);
+    now += 10s;
+    EXPECT_EQ(t.tick_batch(fire, 4), 4u);
+    EXPECT_EQ(t.tick_batch(fire, 4), 2u);
+    EXPECT_EQ(t.tick_batch(fire, 4), 0u);
+    EXPECT_EQ(batches, 3u);
+    EXPECT_EQ(ids.size(), 11u);
+    EXPECT_EQ(t.events().size(), 0u);
+  }
+  if (true) {
+    // Repeating events are rescheduled, unless the batch handler clears
+    // `next_at`.
+    T t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    auto id1 = t.set(1s, nullptr, 1s).timer_id;
+    auto id2 = t.set(1s, nullptr, 1s).timer_id;
+    auto stop = [&](std::span<timer_event* const> batch) {
+      for (auto event : batch) {
+        EXPECT_EQ(event->next_at, now);
+        if (event->timer_id == id2 && event->callbacks == 2)
+          event->next_at = {};
+      }
+    };
+    for (size_t i = 0; i < 3; ++i) {
+      now += 1s;
+      t.tick_batch(stop);
+    }
+    EXPECT_EQ(t.events().size(), 1u);
+    EXPECT_EQ(t.event(id1).callbacks, 3u);
+  }
+  if (true) {
+    // Slack rounds deadlines up to a shared boundary.
+    T t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    const duration_t slack = 1s;
+    const auto granularity =
+        duration_t{std::bit_floor(static_cast<uint64_t>(slack.count()))};
+    auto base = now + 10s;
+    auto boundary =
+        base + (granularity - base.time_since_epoch() % granularity);
+    std::vector<time_point_t> requested{boundary - granularity + 1ns,
+        boundary - granularity / 2, boundary - 1ns, boundary};
+    for (auto at : requested) {
+      auto& event = t.set(at, nullptr, {}, {}, slack);
+      EXPECT_EQ(event.next_at, boundary);
+    }
+
+    // Without slack, it's exact.
+    EXPECT_EQ(t.set(base, nullptr).next_at, base);
+
+    // Unless the rounding would reach the stop time.
+    EXPECT_EQ(t.set(boundary - 1ms, nullptr, {}, boundary, slack).next_at,
+        boundary - 1ms);
+
+    // Repeats are rounded, too.
+    auto& repeating = t.set(boundary, nullptr, 1s, {}, slack);
+    EXPECT_EQ(repeating.next_at, boundary);
+    const auto repeating_id = repeating.timer_id;
+
+    size_t fired{};
+    auto count = [&](std::span<timer_event* const> batch) {
+      fired += batch.size();
+    };
+    now = base;
+    EXPECT_EQ(t.tick_batch(count), 1u);
+    now = boundary - 1ms;
+    EXPECT_EQ(t.tick_batch(count), 1u);
+    now = boundary;
+    EXPECT_EQ(t.tick_batch(count), requested.size() + 1);
+    EXPECT_EQ(fired, requested.size() + 3);
+
+    auto next_at = t.event(repeating_id).next_at;
+    EXPECT_GE(next_at, boundary + 1s);
+    EXPECT_LT(next_at, boundary + 1s + slack);
+    EXPECT_EQ(next_at.time_since_epoch() % granularity, duration_t{});
+  }
+}
+
+void TimersTest_Batch() {
+  BatchTest<timers>();
+  BatchTest<wheel_timers>();
+}
+
+// Coroutine that starts eagerly and destroys itself when it finishes. The
+// handle can be used to destroy it early.
+struct detached {
+  struct promise_type {
+    detached get_return_object() {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() { std::terminate(); }
+  };
+  std::coroutine_handle<> handle;
+};
+
+template<typename T>
+detached sleeper(T& t, duration_t delay, std::vector<std::string>& log,
+    timer_id_t* id = nullptr) {
+  auto s = t.sleep_for(delay);
+  if (id) *id = s.timer_id();
+  log.push_back("sleep");
+  log.push_back(co_await s ? "woke" : "canceled");
+  log.push_back(co_await t.sleep_for(delay) ? "woke" : "canceled");
+}
+
+template<typename T>
+detached timeout_sleeper(T& t, duration_t delay, duration_t timeout,
+    std::vector<std::string>& log) {
+  auto r = co_await t.with_timeout(t.sleep_for(delay), timeout);
+  log.push_back(r ? "done" : "timed out");
+}
+
+template<typename T>
+void CoroTest() {
+  if (true) {
+    T t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    std::vector<std::string> log;
+    log.reserve(3);
+    sleeper(t, 10ms, log);
+    EXPECT_EQ(log.size(), 1u);
+    EXPECT_EQ(t.events().size(), 1u);
+    EXPECT_EQ(t.tick(), 0u);
+    now += 10ms;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(log.size(), 2u);
+    EXPECT_EQ(log[1], "woke");
+
+    // Resuming allocates nothing.
+    const auto allocations = allocation_count.load();
+    now += 10ms;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(allocation_count.load(), allocations);
+    EXPECT_EQ(log.size(), 3u);
+    EXPECT_TRUE(t.events().empty());
+  }
+  if (true) {
+    // Cancel through the ID, which resumes on the next tick.
+    T t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    std::vector<std::string> log;
+    timer_id_t id{};
+    sleeper(t, 10ms, log, &id);
+    EXPECT_TRUE(t.cancel(id));
+    EXPECT_EQ(log.size(), 1u);
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(log.size(), 2u);
+    EXPECT_EQ(log[1], "canceled");
+    now += 10ms;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(log.size(), 3u);
+    EXPECT_EQ(log[2], "woke");
+  }
+  if (true) {
+    // Destroying a suspended coroutine cancels its timer.
+    T t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    std::vector<std::string> log;
+    auto d = sleeper(t, 10ms, log);
+    EXPECT_EQ(t.events().size(), 1u);
+    d.handle.destroy();
+    EXPECT_TRUE(t.events().empty());
+    now += 10ms;
+    EXPECT_EQ(t.tick(), 0u);
+    EXPECT_EQ(log.size(), 1u);
+  }
+  if (true) {
+    // Timeouts.
+    T t;
+    auto now = make_date(2024y / 1 / 1);
+    t.set_clock_callback([&now]() { return now; });
+    std::vector<std::string> log;
+    timeout_sleeper(t, 10ms, 20ms, log);
+    timeout_sleeper(t, 30ms, 20ms, log);
+    EXPECT_EQ(t.events().size(), 4u);
+    now += 10ms;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(log.size(), 1u);
+    EXPECT_EQ(log[0], "done");
+    EXPECT_EQ(t.events().size(), 2u);
+    now += 10ms;
+    EXPECT_EQ(t.tick(), 1u);
+    EXPECT_EQ(log.size(), 2u);
+    EXPECT_EQ(log[1], "timed out");
+    EXPECT_TRUE(t.events().empty());
+  }
+}
+
+void TimersTest_Lateness() {
+  auto& lateness = library_probes().timer_lateness;
+  lateness.reset();
+  timers t;
+  auto now = make_date(2024y / 1 / 1);
+  t.set_clock_callback([&now]() { return now; });
+  auto cb = [](timer_event&) {};
+  t.set(10ms, cb);
+  t.set(20ms, cb);
+  now += 25ms;
+  EXPECT_EQ(t.tick(), 2u);
+  t.set(10ms, cb);
+  now += 10ms;
+  EXPECT_EQ(t.tick_batch([](auto) {}), 1u);
+  const auto s = lateness.snapshot();
+  EXPECT_EQ(s.count, 3u);
+  EXPECT_EQ(s.sum, uint64_t((15ms + 5ms).count() * 1'000'000));
+  EXPECT_EQ(s.max, uint64_t((15ms).count() * 1'000'000));
+  EXPECT_EQ(s.buckets[0], 1u);
+}
+
+void TimersTest_Coro() {
+  CoroTest<timers>();
+  CoroTest<wheel_timers>();
+}
+
+// Wait, for up to a few seconds, until `done` returns true.
+template<typename F>
+bool eventually(F done) {
+  const auto give_up = std::chrono::steady_clock::now() + 5s;
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > give_up) return false;
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+template<typename T>
+void ShardedTest() {
+  if (true) {
+    // IDs identify their shard, and sets from outside go round-robin.
+    T t{4};
+    EXPECT_EQ(t.shard_count(), 4u);
+    for (size_t i = 0; i < 8; ++i) {
+      const auto id = t.set_on(i, time_point_t::max(), [](timer_event&) {});
+      EXPECT_EQ(t.shard_of(id), i % 4);
+    }
+    std::atomic<size_t> fired{};
+    std::array<size_t, 4> per_shard{};
+    for (size_t i = 0; i < 100; ++i)
+      ++per_shard[t.shard_of(
+          t.set(0ms, [&fired](timer_event&) { ++fired; }))];
+    EXPECT_EQ(per_shard, (std::array<size_t, 4>{25, 25, 25, 25}));
+    EXPECT_TRUE(eventually([&] { return fired == 100; }));
+    EXPECT_TRUE(eventually([&] { return t.callbacks() == 100; }));
+  }
+  if (true) {
+    // A slow callback doesn't hold up the rest of its batch, which is
+    // stolen by idle shards.
+    T t{4};
+    constexpr size_t fast_count = 6;
+    std::atomic<size_t> fast{};
+    std::atomic<bool> slow_saw_all{};
+    const auto at = t.get_now() + 20ms;
+    t.set_on(0, at, [&](timer_event&) {
+      slow_saw_all = eventually([&] { return fast == fast_count; });
+    });
+    for (size_t i = 0; i < fast_count; ++i)
+      t.set_on(0, at, [&fast](timer_event&) { ++fast; });
+    EXPECT_TRUE(eventually([&] { return t.callbacks() == fast_count + 1; }));
+    EXPECT_TRUE(slow_saw_all);
+    EXPECT_GT(t.stolen(), 0u);
+  }
+  if (true) {
+    // Cancel from another thread.
+    T t{2};
+    std::atomic<size_t> fired{};
+    const auto id = t.set(100ms, [&fired](timer_event&) { ++fired; });
+    std::thread{[&] { t.cancel(id); }}.join();
+    std::this_thread::sleep_for(200ms);
+    EXPECT_EQ(fired, 0u);
+  }
+  if (true) {
+    // The callback contract holds: rescheduling by `next_at`, counting by
+    // `callbacks`, and `user_data`. Timers set from a callback stay on its
+    // shard.
+    T t{3};
+    std::atomic<size_t> done{};
+    std::atomic<size_t> same_shard{};
+    std::array<std::atomic<size_t>, 3> seen{};
+    for (size_t i = 0; i < 3; ++i) {
+      t.set_on(i, t.get_now(), [&, i](timer_event& e) {
+        if (!e.user_data) {
+          e.user_data = &seen[i];
+          const auto id = t.set(0ms, [](timer_event&) {});
+          if (t.shard_of(id) == t.shard_of(e.timer_id)) ++same_shard;
+        }
+        ++*static_cast<std::atomic<size_t>*>(e.user_data);
+        if (e.callbacks < 3)
+          e.next_at += 1ms;
+        else
+          ++done;
+      });
+    }
+    EXPECT_TRUE(eventually([&] { return done == 3; }));
+    EXPECT_EQ(same_shard, 3u);
+    for (auto& n : seen) EXPECT_EQ(n, 3u);
+    EXPECT_TRUE(eventually([&] { return t.callbacks() == 3 * 3 + 3; }));
+  }
+  if (true) {
+    // With three shards, the tag has two bits, so one of its values names no
+    // shard. Cancelling such an ID does nothing.
+    T t{3};
+    EXPECT_EQ(t.shard_of(timer_id_t{7}), 3u);
+    EXPECT_EQ(t.shard_of(timer_id_t{6}), 2u);
+    t.cancel(timer_id_t{7});
+    std::atomic<size_t> fired{};
+    t.set_on(2, t.get_now(), [&fired](timer_event&) { ++fired; });
+    EXPECT_TRUE(eventually([&] { return fired == 1; }));
+  }
+}
+
+void TimersTest_Sharded() {
+  ShardedTest<sharded_timers>();
+  ShardedTest<sharded_wheel_timers>();
+}
+
+MAKE_TEST_LIST(TimersTest_General, TimersTest_Edge, TimersTest_Wheel,
+    TimersTest_Compact, TimersTest_NoAlloc, TimersTest_Move, TimersTest_Submit,
+    TimersTest_Batch, TimersTest_Coro, TimersTest_Lateness,
+    TimersTest_Sharded);